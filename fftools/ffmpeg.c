@@ -63,6 +63,8 @@
 #include "libavutil/time.h"
 #include "libavutil/thread.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/threadpool.h"
+#include "libavutil/trace.h"
 #include "libavcodec/mathops.h"
 #include "libavcodec/version.h"
 #include "libavformat/os_support.h"
@@ -131,6 +133,8 @@ unsigned nb_output_dumped = 0;
 
 static BenchmarkTimeStamps current_time;
 AVIOContext *progress_avio = NULL;
+AVThreadPool *thread_pool = NULL;
+AVBufferCache *buffer_cache = NULL;
 
 InputFile   **input_files   = NULL;
 int        nb_input_files   = 0;
@@ -208,6 +212,7 @@ static void sub2video_push_ref(InputStream *ist, int64_t pts)
     av_assert1(frame->data[0]);
     ist->sub2video.last_pts = frame->pts = pts;
     for (i = 0; i < ist->nb_filters; i++) {
+        fg_thread_wait(ist->filters[i]->graph);
         ret = av_buffersrc_add_frame_flags(ist->filters[i]->filter, frame,
                                            AV_BUFFERSRC_FLAG_KEEP_REF |
                                            AV_BUFFERSRC_FLAG_PUSH);
@@ -282,8 +287,10 @@ static void sub2video_heartbeat(InputStream *ist, int64_t pts)
                or if we need to initialize the system, update the
                overlayed subpicture and its start/end times */
             sub2video_update(ist2, pts2 + 1, NULL);
-        for (j = 0, nb_reqs = 0; j < ist2->nb_filters; j++)
+        for (j = 0, nb_reqs = 0; j < ist2->nb_filters; j++) {
+            fg_thread_wait(ist2->filters[j]->graph);
             nb_reqs += av_buffersrc_get_nb_failed_requests(ist2->filters[j]->filter);
+        }
         if (nb_reqs)
             sub2video_push_ref(ist2, pts2);
     }
@@ -297,6 +304,7 @@ static void sub2video_flush(InputStream *ist)
     if (ist->sub2video.end_pts < INT64_MAX)
         sub2video_update(ist, INT64_MAX, NULL);
     for (i = 0; i < ist->nb_filters; i++) {
+        fg_thread_wait(ist->filters[i]->graph);
         ret = av_buffersrc_add_frame(ist->filters[i]->filter, NULL);
         if (ret != AVERROR_EOF && ret < 0)
             av_log(NULL, AV_LOG_WARNING, "Flush the frame error.\n");
@@ -502,6 +510,8 @@ static void ffmpeg_cleanup(int ret)
 
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+        fg_thread_stop(fg);
+        print_filtergraph_profile(fg);
         avfilter_graph_free(&fg->graph);
         for (j = 0; j < fg->nb_inputs; j++) {
             InputFilter *ifilter = fg->inputs[j];
@@ -561,6 +571,10 @@ static void ffmpeg_cleanup(int ret)
 
     uninit_opts();
 
+    av_thread_pool_free(&thread_pool);
+    av_trace_close();
+    av_buffer_cache_uninit(&buffer_cache);
+
     avformat_network_deinit();
 
     if (received_sigterm) {
@@ -821,22 +835,34 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
 
     update_benchmark(NULL);
 
-    ret = avcodec_send_frame(enc, frame);
-    if (ret < 0 && !(ret == AVERROR_EOF && !frame)) {
-        av_log(NULL, AV_LOG_ERROR, "Error submitting %s frame to the encoder\n",
-               type_desc);
-        return ret;
+    if (threaded_encoders) {
+        /* errors are reported by the encoder thread */
+        ret = enc_thread_send_frame(ost, frame);
+        if (ret < 0)
+            return ret;
+    } else {
+        ret = avcodec_send_frame(enc, frame);
+        if (ret < 0 && !(ret == AVERROR_EOF && !frame)) {
+            av_log(NULL, AV_LOG_ERROR, "Error submitting %s frame to the encoder\n",
+                   type_desc);
+            return ret;
+        }
     }
 
     while (1) {
-        ret = avcodec_receive_packet(enc, pkt);
+        if (ost->enc_thread) {
+            /* only wait for the encoder when flushing */
+            ret = enc_thread_receive_packet(ost, pkt, !frame);
+        } else {
+            ret = avcodec_receive_packet(enc, pkt);
+
+            /* if two pass, output log on success and EOF */
+            if ((ret >= 0 || ret == AVERROR_EOF) && ost->logfile && enc->stats_out)
+                fprintf(ost->logfile, "%s", enc->stats_out);
+        }
         update_benchmark("%s_%s %d.%d", action, type_desc,
                          ost->file_index, ost->index);
 
-        /* if two pass, output log on success and EOF */
-        if ((ret >= 0 || ret == AVERROR_EOF) && ost->logfile && enc->stats_out)
-            fprintf(ost->logfile, "%s", enc->stats_out);
-
         if (ret == AVERROR(EAGAIN)) {
             av_assert0(frame); // should never happen during flushing
             return 0;
@@ -844,7 +870,8 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
             of_output_packet(of, pkt, ost, 1);
             return ret;
         } else if (ret < 0) {
-            av_log(NULL, AV_LOG_ERROR, "%s encoding failed\n", type_desc);
+            if (!ost->enc_thread)
+                av_log(NULL, AV_LOG_ERROR, "%s encoding failed\n", type_desc);
             return ret;
         }
 
@@ -1258,7 +1285,14 @@ static int reap_filters(int flush)
         AVCodecContext *enc = ost->enc_ctx;
         int ret = 0;
 
-        if (!ost->filter || !ost->filter->graph->graph)
+        if (!ost->filter)
+            continue;
+
+        ret = fg_thread_wait(ost->filter->graph);
+        if (ret < 0)
+            return ret;
+
+        if (!ost->filter->graph->graph)
             continue;
         filter = ost->filter->filter;
 
@@ -1455,6 +1489,104 @@ static void print_final_stats(int64_t total_size)
     }
 }
 
+static void json_string(AVBPrint *bp, const char *s)
+{
+    av_bprint_chars(bp, '"', 1);
+    for (; s && *s; s++) {
+        if (*s == '"' || *s == '\\')
+            av_bprintf(bp, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            av_bprintf(bp, "\\u%04x", *s);
+        else
+            av_bprint_chars(bp, *s, 1);
+    }
+    av_bprint_chars(bp, '"', 1);
+}
+
+/* Write the progress information as a single line JSON object. */
+static void print_progress_json(AVBPrint *bp, int is_last_report, float t,
+                                int64_t pts, double bitrate, double speed)
+{
+    av_bprintf(bp, "{\"progress\":\"%s\",\"elapsed\":%.3f",
+               is_last_report ? "end" : "continue", t);
+    if (pts != AV_NOPTS_VALUE)
+        av_bprintf(bp, ",\"out_time_us\":%"PRId64, pts);
+    if (bitrate >= 0)
+        av_bprintf(bp, ",\"bitrate_kbps\":%.1f", bitrate);
+    if (speed >= 0)
+        av_bprintf(bp, ",\"speed\":%.3g", speed);
+    av_bprintf(bp, ",\"dup_frames\":%"PRId64",\"drop_frames\":%"PRId64,
+               nb_frames_dup, nb_frames_drop);
+
+    av_bprintf(bp, ",\"inputs\":[");
+    for (int i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+
+        av_bprintf(bp, "%s{\"index\":%d,\"url\":", i ? "," : "", i);
+        json_string(bp, f->ctx->url);
+        av_bprintf(bp, ",\"format\":");
+        json_string(bp, f->ctx->iformat->name);
+        av_bprintf(bp, ",\"streams\":[");
+        for (int j = 0; j < f->nb_streams; j++) {
+            InputStream *ist = f->streams[j];
+
+            av_bprintf(bp, "%s{\"index\":%d,\"type\":", j ? "," : "", j);
+            json_string(bp, av_get_media_type_string(ist->par->codec_type));
+            av_bprintf(bp, ",\"packets\":%"PRIu64",\"bytes\":%"PRIu64,
+                       ist->nb_packets, ist->data_size);
+            if (ist->decoding_needed) {
+                av_bprintf(bp, ",\"decoder\":");
+                json_string(bp, ist->dec->name);
+                av_bprintf(bp, ",\"frames_decoded\":%"PRIu64, ist->frames_decoded);
+                if (ist->par->codec_type == AVMEDIA_TYPE_AUDIO)
+                    av_bprintf(bp, ",\"samples_decoded\":%"PRIu64, ist->samples_decoded);
+            }
+            av_bprintf(bp, "}");
+        }
+        av_bprintf(bp, "]}");
+    }
+
+    av_bprintf(bp, "],\"outputs\":[");
+    for (int i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        int64_t size = of_filesize(of);
+
+        av_bprintf(bp, "%s{\"index\":%d,\"url\":", i ? "," : "", i);
+        json_string(bp, of->url);
+        av_bprintf(bp, ",\"format\":");
+        json_string(bp, of->format->name);
+        if (size >= 0)
+            av_bprintf(bp, ",\"size\":%"PRId64, size);
+        av_bprintf(bp, ",\"streams\":[");
+        for (int j = 0; j < of->nb_streams; j++) {
+            OutputStream *ost = of->streams[j];
+            uint64_t packets = atomic_load(&ost->packets_written);
+            enum AVMediaType type = ost->st->codecpar->codec_type;
+
+            av_bprintf(bp, "%s{\"index\":%d,\"type\":", j ? "," : "", j);
+            json_string(bp, av_get_media_type_string(type));
+            av_bprintf(bp, ",\"packets\":%"PRIu64",\"bytes\":%"PRIu64,
+                       packets, ost->data_size_mux);
+            if (t > 0)
+                av_bprintf(bp, ",\"packets_per_second\":%.2f", packets / t);
+            if (ost->enc_ctx) {
+                av_bprintf(bp, ",\"encoder\":");
+                json_string(bp, ost->enc_ctx->codec->name);
+                av_bprintf(bp, ",\"frames_encoded\":%"PRIu64, ost->frames_encoded);
+                if (type == AVMEDIA_TYPE_AUDIO)
+                    av_bprintf(bp, ",\"samples_encoded\":%"PRIu64, ost->samples_encoded);
+                if (type == AVMEDIA_TYPE_VIDEO)
+                    av_bprintf(bp, ",\"q\":%.1f", ost->quality / (float)FF_QP2LAMBDA);
+                if (ost->enc_thread && !is_last_report)
+                    av_bprintf(bp, ",\"enc_queue\":%d", enc_thread_queue_occupancy(ost));
+            }
+            av_bprintf(bp, "}");
+        }
+        av_bprintf(bp, "]}");
+    }
+    av_bprintf(bp, "]}\n");
+}
+
 static void print_report(int is_last_report, int64_t timer_start, int64_t cur_time)
 {
     AVBPrint buf, buf_script;
@@ -1610,6 +1742,23 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     if (nb_frames_dup || nb_frames_drop)
         av_bprintf(&buf, " dup=%"PRId64" drop=%"PRId64, nb_frames_dup, nb_frames_drop);
+
+    if (threaded_encoders && !is_last_report) {
+        const char *sep = " enc_queue=";
+
+        for (OutputStream *ost = ost_iter(NULL); ost; ost = ost_iter(ost)) {
+            int nb_queued;
+
+            if (!ost->enc_thread)
+                continue;
+
+            nb_queued = enc_thread_queue_occupancy(ost);
+            av_bprintf(&buf, "%s%d", sep, nb_queued);
+            av_bprintf(&buf_script, "stream_%d_%d_enc_queue=%d\n",
+                       ost->file_index, ost->index, nb_queued);
+            sep = ":";
+        }
+    }
     av_bprintf(&buf_script, "dup_frames=%"PRId64"\n", nb_frames_dup);
     av_bprintf(&buf_script, "drop_frames=%"PRId64"\n", nb_frames_drop);
 
@@ -1633,8 +1782,13 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     av_bprint_finalize(&buf, NULL);
 
     if (progress_avio) {
-        av_bprintf(&buf_script, "progress=%s\n",
-                   is_last_report ? "end" : "continue");
+        if (progress_json) {
+            av_bprint_clear(&buf_script);
+            print_progress_json(&buf_script, is_last_report, t, pts, bitrate, speed);
+        } else {
+            av_bprintf(&buf_script, "progress=%s\n",
+                       is_last_report ? "end" : "continue");
+        }
         avio_write(progress_avio, buf_script.str,
                    FFMIN(buf_script.len, buf_script.size - 1));
         avio_flush(progress_avio);
@@ -1856,7 +2010,7 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
 {
     FilterGraph *fg = ifilter->graph;
     AVFrameSideData *sd;
-    int need_reinit, ret;
+    int need_reinit, resize_only = 0, ret;
     int buffersrc_flags = AV_BUFFERSRC_FLAG_PUSH;
 
     if (keep_reference)
@@ -1871,8 +2025,10 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
                        av_channel_layout_compare(&ifilter->ch_layout, &frame->ch_layout);
         break;
     case AVMEDIA_TYPE_VIDEO:
-        need_reinit |= ifilter->width  != frame->width ||
-                       ifilter->height != frame->height;
+        resize_only  = !need_reinit &&
+                       (ifilter->width  != frame->width ||
+                        ifilter->height != frame->height);
+        need_reinit |= resize_only;
         break;
     }
 
@@ -1880,14 +2036,20 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
         need_reinit = 0;
 
     if (!!ifilter->hw_frames_ctx != !!frame->hw_frames_ctx ||
-        (ifilter->hw_frames_ctx && ifilter->hw_frames_ctx->data != frame->hw_frames_ctx->data))
+        (ifilter->hw_frames_ctx && ifilter->hw_frames_ctx->data != frame->hw_frames_ctx->data)) {
         need_reinit = 1;
+        resize_only = 0;
+    }
 
     if (sd = av_frame_get_side_data(frame, AV_FRAME_DATA_DISPLAYMATRIX)) {
-        if (!ifilter->displaymatrix || memcmp(sd->data, ifilter->displaymatrix, sizeof(int32_t) * 9))
+        if (!ifilter->displaymatrix || memcmp(sd->data, ifilter->displaymatrix, sizeof(int32_t) * 9)) {
             need_reinit = 1;
-    } else if (ifilter->displaymatrix)
+            resize_only = 0;
+        }
+    } else if (ifilter->displaymatrix) {
         need_reinit = 1;
+        resize_only = 0;
+    }
 
     if (need_reinit) {
         ret = ifilter_parameters_from_frame(ifilter, frame);
@@ -1895,6 +2057,27 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
             return ret;
     }
 
+    /* only the frame size changed and a scaler in the graph can follow it;
+     * the buffer source is not touched while a graph thread is running */
+    if (need_reinit && resize_only && fg->graph && ifilter->resize_in_place &&
+        !threaded_filtergraphs) {
+        AVBufferSrcParameters *par = av_buffersrc_parameters_alloc();
+        if (!par)
+            return AVERROR(ENOMEM);
+        par->format = AV_PIX_FMT_NONE;
+        par->width  = frame->width;
+        par->height = frame->height;
+        ret = av_buffersrc_parameters_set(ifilter->filter, par);
+        av_freep(&par);
+        if (ret < 0)
+            return ret;
+
+        av_log(NULL, AV_LOG_VERBOSE, "Input stream #%d:%d changed to %dx%d, "
+               "reconfiguring the scaler only\n", ifilter->ist->file_index,
+               ifilter->ist->st->index, frame->width, frame->height);
+        need_reinit = 0;
+    }
+
     /* (re)init the graph if possible, otherwise buffer the frame and return */
     if (need_reinit || !fg->graph) {
         if (!ifilter_has_all_input_formats(fg)) {
@@ -1922,7 +2105,10 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
         }
     }
 
-    ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, buffersrc_flags);
+    if (threaded_filtergraphs)
+        ret = fg_thread_send_frame(ifilter, frame, keep_reference);
+    else
+        ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, buffersrc_flags);
     if (ret < 0) {
         if (ret != AVERROR_EOF)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -1939,7 +2125,10 @@ static int ifilter_send_eof(InputFilter *ifilter, int64_t pts)
     ifilter->eof = 1;
 
     if (ifilter->filter) {
-        ret = av_buffersrc_close(ifilter->filter, pts, AV_BUFFERSRC_FLAG_PUSH);
+        if (threaded_filtergraphs)
+            ret = fg_thread_send_eof(ifilter, pts);
+        else
+            ret = av_buffersrc_close(ifilter->filter, pts, AV_BUFFERSRC_FLAG_PUSH);
         if (ret < 0)
             return ret;
     } else {
@@ -2008,17 +2197,26 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
 {
     AVFrame *decoded_frame = ist->decoded_frame;
     AVCodecContext *avctx = ist->dec_ctx;
-    int ret, err = 0;
+    /* the packet the decoded frame is the first output for */
+    const AVPacket *src_pkt = pkt;
+    int ret, err = 0, sample_rate;
     AVRational decoded_frame_tb;
 
     update_benchmark(NULL);
-    ret = decode(avctx, decoded_frame, got_output, pkt);
+    if (threaded_decoders)
+        ret = dec_thread_decode(ist, decoded_frame, got_output, pkt, &src_pkt);
+    else
+        ret = decode(avctx, decoded_frame, got_output, pkt);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
 
-    if (ret >= 0 && avctx->sample_rate <= 0) {
-        av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", avctx->sample_rate);
+    /* the decoder context may be ahead of the returned frame when
+     * decoding in a separate thread */
+    sample_rate = threaded_decoders ? decoded_frame->sample_rate : avctx->sample_rate;
+
+    if (ret >= 0 && (*got_output || !threaded_decoders) && sample_rate <= 0) {
+        av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", sample_rate);
         ret = AVERROR_INVALIDDATA;
     }
 
@@ -2031,31 +2229,39 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     ist->samples_decoded += decoded_frame->nb_samples;
     ist->frames_decoded++;
 
+    /* with threaded decoding, later packets have already been sent to the
+     * decoder; restart from the timestamps of the packet this frame was
+     * decoded from, so that the stream time does not run ahead */
+    if (threaded_decoders && src_pkt && src_pkt->dts != AV_NOPTS_VALUE) {
+        ist->next_dts = ist->dts = av_rescale_q(src_pkt->dts, ist->st->time_base, AV_TIME_BASE_Q);
+        ist->next_pts = ist->pts = ist->dts;
+    }
+
     /* increment next_dts to use for the case where the input stream does not
        have timestamps or there are multiple frames in the packet */
     ist->next_pts += ((int64_t)AV_TIME_BASE * decoded_frame->nb_samples) /
-                     avctx->sample_rate;
+                     sample_rate;
     ist->next_dts += ((int64_t)AV_TIME_BASE * decoded_frame->nb_samples) /
-                     avctx->sample_rate;
+                     sample_rate;
 
     if (decoded_frame->pts != AV_NOPTS_VALUE) {
         decoded_frame_tb   = ist->st->time_base;
-    } else if (pkt && pkt->pts != AV_NOPTS_VALUE) {
-        decoded_frame->pts = pkt->pts;
+    } else if (src_pkt && src_pkt->pts != AV_NOPTS_VALUE) {
+        decoded_frame->pts = src_pkt->pts;
         decoded_frame_tb   = ist->st->time_base;
     }else {
         decoded_frame->pts = ist->dts;
         decoded_frame_tb   = AV_TIME_BASE_Q;
     }
-    if (pkt && pkt->duration && ist->prev_pkt_pts != AV_NOPTS_VALUE &&
-        pkt->pts != AV_NOPTS_VALUE && pkt->pts - ist->prev_pkt_pts > pkt->duration)
+    if (src_pkt && src_pkt->duration && ist->prev_pkt_pts != AV_NOPTS_VALUE &&
+        src_pkt->pts != AV_NOPTS_VALUE && src_pkt->pts - ist->prev_pkt_pts > src_pkt->duration)
         ist->filter_in_rescale_delta_last = AV_NOPTS_VALUE;
-    if (pkt)
-        ist->prev_pkt_pts = pkt->pts;
+    if (src_pkt)
+        ist->prev_pkt_pts = src_pkt->pts;
     if (decoded_frame->pts != AV_NOPTS_VALUE)
         decoded_frame->pts = av_rescale_delta(decoded_frame_tb, decoded_frame->pts,
-                                              (AVRational){1, avctx->sample_rate}, decoded_frame->nb_samples, &ist->filter_in_rescale_delta_last,
-                                              (AVRational){1, avctx->sample_rate});
+                                              (AVRational){1, sample_rate}, decoded_frame->nb_samples, &ist->filter_in_rescale_delta_last,
+                                              (AVRational){1, sample_rate});
     ist->nb_samples = decoded_frame->nb_samples;
     err = send_frame_to_filters(ist, decoded_frame);
 
@@ -2067,7 +2273,8 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
                         int *decode_failed)
 {
     AVFrame *decoded_frame = ist->decoded_frame;
-    int i, ret = 0, err = 0;
+    const AVPacket *src_pkt;
+    int i, ret = 0, err = 0, has_b_frames;
     int64_t best_effort_timestamp;
     int64_t dts = AV_NOPTS_VALUE;
 
@@ -2094,30 +2301,36 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
-    ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt);
+    if (threaded_decoders) {
+        ret = dec_thread_decode(ist, decoded_frame, got_output, pkt, &src_pkt);
+        dec_thread_get_props(ist, &has_b_frames, NULL, NULL);
+    } else {
+        ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt);
+        has_b_frames = ist->dec_ctx->has_b_frames;
+    }
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
 
     // The following line may be required in some cases where there is no parser
     // or the parser does not has_b_frames correctly
-    if (ist->par->video_delay < ist->dec_ctx->has_b_frames) {
+    if (ist->par->video_delay < has_b_frames) {
         if (ist->dec_ctx->codec_id == AV_CODEC_ID_H264) {
-            ist->par->video_delay = ist->dec_ctx->has_b_frames;
+            ist->par->video_delay = has_b_frames;
         } else
             av_log(ist->dec_ctx, AV_LOG_WARNING,
                    "video_delay is larger in decoder than demuxer %d > %d.\n"
                    "If you want to help, upload a sample "
                    "of this file to https://streams.videolan.org/upload/ "
                    "and contact the ffmpeg-devel mailing list. (ffmpeg-devel@ffmpeg.org)\n",
-                   ist->dec_ctx->has_b_frames,
+                   has_b_frames,
                    ist->par->video_delay);
     }
 
     if (ret != AVERROR_EOF)
         check_decode_result(ist, got_output, ret);
 
-    if (*got_output && ret >= 0) {
+    if (*got_output && ret >= 0 && !threaded_decoders) {
         if (ist->dec_ctx->width  != decoded_frame->width ||
             ist->dec_ctx->height != decoded_frame->height ||
             ist->dec_ctx->pix_fmt != decoded_frame->format) {
@@ -2334,16 +2547,23 @@ static int process_input_packet(InputStream *ist, const AVPacket *pkt, int no_eo
         case AVMEDIA_TYPE_VIDEO:
             ret = decode_video    (ist, repeating ? NULL : avpkt, &got_output, &duration_pts, !pkt,
                                    &decode_failed);
-            if (!repeating || !pkt || got_output) {
+            // with threaded decoding, the frames returned while repeating
+            // belong to earlier packets
+            if (!repeating || !pkt || (got_output && !threaded_decoders)) {
+                AVRational framerate;
+                int ticks_per_frame;
+
+                dec_thread_get_props(ist, NULL, &framerate, &ticks_per_frame);
+
                 if (pkt && pkt->duration) {
                     duration_dts = av_rescale_q(pkt->duration, ist->st->time_base, AV_TIME_BASE_Q);
-                } else if(ist->dec_ctx->framerate.num != 0 && ist->dec_ctx->framerate.den != 0) {
+                } else if(framerate.num != 0 && framerate.den != 0) {
                     int ticks = ist->last_pkt_repeat_pict >= 0 ?
                                 ist->last_pkt_repeat_pict + 1  :
-                                ist->dec_ctx->ticks_per_frame;
+                                ticks_per_frame;
                     duration_dts = ((int64_t)AV_TIME_BASE *
-                                    ist->dec_ctx->framerate.den * ticks) /
-                                    ist->dec_ctx->framerate.num / ist->dec_ctx->ticks_per_frame;
+                                    framerate.den * ticks) /
+                                    framerate.num / ticks_per_frame;
                 }
 
                 if(ist->dts != AV_NOPTS_VALUE && duration_dts) {
@@ -2562,6 +2782,9 @@ static int init_input_stream(InputStream *ist, char *error, int error_len)
             return ret;
         }
 
+        ist->dec_ctx->thread_pool  = thread_pool;
+        ist->dec_ctx->buffer_cache = buffer_cache;
+
         if ((ret = avcodec_open2(ist->dec_ctx, codec, &ist->decoder_opts)) < 0) {
             if (ret == AVERROR_EXPERIMENTAL)
                 abort_codec_experimental(codec, 0);
@@ -2958,6 +3181,8 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
             return ret;
         }
 
+        ost->enc_ctx->thread_pool = thread_pool;
+
         if ((ret = avcodec_open2(ost->enc_ctx, codec, &ost->encoder_opts)) < 0) {
             if (ret == AVERROR_EXPERIMENTAL)
                 abort_codec_experimental(codec, 1);
@@ -2968,9 +3193,11 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
             return ret;
         }
         if (codec->type == AVMEDIA_TYPE_AUDIO &&
-            !(codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE))
+            !(codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE)) {
+            fg_thread_wait(ost->filter->graph);
             av_buffersink_set_frame_size(ost->filter->filter,
                                             ost->enc_ctx->frame_size);
+        }
         assert_avoptions(ost->encoder_opts);
         if (ost->enc_ctx->bit_rate && ost->enc_ctx->bit_rate < 1000 &&
             ost->enc_ctx->codec_id != AV_CODEC_ID_CODEC2 /* don't complain about 700 bit/s modes */)
@@ -3277,6 +3504,7 @@ static int check_keyboard_interaction(int64_t cur_time)
                    target, time, command, arg);
             for (i = 0; i < nb_filtergraphs; i++) {
                 FilterGraph *fg = filtergraphs[i];
+                fg_thread_wait(fg);
                 if (fg->graph) {
                     if (time < 0) {
                         ret = avfilter_graph_send_command(fg->graph, target, command, arg, buf, sizeof(buf),
@@ -3605,6 +3833,10 @@ static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
     InputStream *ist;
 
     *best_ist = NULL;
+    ret = fg_thread_wait(graph);
+    if (ret < 0)
+        return ret;
+
     ret = avfilter_graph_request_oldest(graph->graph);
     if (ret >= 0)
         return reap_filters(0);
@@ -3901,6 +4133,23 @@ int main(int argc, char **argv)
         exit_program(1);
     }
 
+    if (thread_pool_threads >= 0) {
+        ret = av_thread_pool_alloc(&thread_pool, thread_pool_threads);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Error creating the thread pool: %s\n",
+                   av_err2str(ret));
+            exit_program(1);
+        }
+    }
+
+    if (buffer_cache_size >= 0) {
+        buffer_cache = av_buffer_cache_alloc(buffer_cache_size);
+        if (!buffer_cache) {
+            av_log(NULL, AV_LOG_FATAL, "Error creating the buffer cache\n");
+            exit_program(1);
+        }
+    }
+
     current_time = ti = get_benchmark_time_stamps();
     if (transcode() < 0)
         exit_program(1);
@@ -46,6 +46,7 @@
 #include "libavutil/rational.h"
 #include "libavutil/thread.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/threadpool.h"
 
 #include "libswresample/swresample.h"
 
@@ -76,6 +77,10 @@ typedef struct HWDevice {
     const char *name;
     enum AVHWDeviceType type;
     AVBufferRef *device_ref;
+    /* name of the device group this device is a member of, if any */
+    const char *group;
+    /* number of decoders and encoders using the device */
+    int nb_users;
 } HWDevice;
 
 /* select an input stream for an output stream */
@@ -160,6 +165,7 @@ typedef struct OptionsContext {
     float mux_preload;
     float mux_max_delay;
     float shortest_buf_duration;
+    int64_t shortest_buf_size;
     int shortest;
     int bitexact;
 
@@ -275,6 +281,9 @@ typedef struct InputFilter {
     AVBufferRef *hw_frames_ctx;
     int32_t *displaymatrix;
 
+    /* a frame size change is handled by a scaler in the configured graph */
+    int resize_in_place;
+
     int eof;
 } InputFilter;
 
@@ -302,6 +311,8 @@ typedef struct OutputFilter {
     const int *sample_rates;
 } OutputFilter;
 
+typedef struct FilterGraphThread FilterGraphThread;
+
 typedef struct FilterGraph {
     int            index;
     const char    *graph_desc;
@@ -316,8 +327,13 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+    /* worker thread running the graph, only with -threaded_filtergraphs */
+    FilterGraphThread *thread;
 } FilterGraph;
 
+typedef struct DecoderThread DecoderThread;
+
 typedef struct InputStream {
     int file_index;
     AVStream *st;
@@ -335,6 +351,8 @@ typedef struct InputStream {
      */
     AVCodecParameters *par;
     AVCodecContext *dec_ctx;
+    /* decoder worker thread, only with -threaded_decoders */
+    DecoderThread  *dec_thread;
     const AVCodec *dec;
     AVFrame *decoded_frame;
     AVPacket *pkt;
@@ -508,6 +526,8 @@ typedef struct KeyframeForceCtx {
     int          dropped_keyframe;
 } KeyframeForceCtx;
 
+typedef struct EncoderThread EncoderThread;
+
 typedef struct OutputStream {
     int file_index;          /* file index */
     int index;               /* stream index in the output file */
@@ -538,6 +558,8 @@ typedef struct OutputStream {
     AVRational enc_timebase;
 
     AVCodecContext *enc_ctx;
+    /* encoder worker thread, only with -threaded_encoders */
+    EncoderThread  *enc_thread;
     AVFrame *filtered_frame;
     AVFrame *last_frame;
     AVFrame *sq_frame;
@@ -678,12 +700,23 @@ extern int64_t stats_period;
 extern int qp_hist;
 extern int stdin_interaction;
 extern AVIOContext *progress_avio;
+extern int progress_json;
 extern float max_error_rate;
 
 extern char *filter_nbthreads;
 extern int filter_complex_nbthreads;
 extern int vstats_version;
 extern int auto_conversion_filters;
+extern int threaded_filtergraphs;
+extern int filter_pipeline;
+extern int filter_profile;
+extern int filter_audio_frame_size;
+extern int threaded_encoders;
+extern int threaded_decoders;
+extern int thread_pool_threads;
+extern AVThreadPool *thread_pool;
+extern int64_t buffer_cache_size;
+extern AVBufferCache *buffer_cache;
 
 extern const AVIOInterruptCB int_cb;
 
@@ -717,6 +750,7 @@ const AVCodec *find_codec_or_die(const char *name, enum AVMediaType type, int en
 int parse_and_set_vsync(const char *arg, int *vsync_var, int file_idx, int st_idx, int is_global);
 
 int configure_filtergraph(FilterGraph *fg);
+void print_filtergraph_profile(FilterGraph *fg);
 void check_filter_outputs(void);
 int filtergraph_is_simple(FilterGraph *fg);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
@@ -726,6 +760,72 @@ void sub2video_update(InputStream *ist, int64_t heartbeat_pts, AVSubtitle *sub);
 
 int ifilter_parameters_from_frame(InputFilter *ifilter, const AVFrame *frame);
 
+/**
+ * Submit a frame to the filtergraph worker thread, which will push it into the
+ * buffersrc of the given input. Starts the thread if it is not running yet.
+ *
+ * @param frame the frame to send; its reference is moved into the queue unless
+ *              keep_reference is set
+ */
+int fg_thread_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_reference);
+/**
+ * Submit EOF with the given timestamp for the given input to the filtergraph
+ * worker thread.
+ */
+int fg_thread_send_eof(InputFilter *ifilter, int64_t pts);
+/**
+ * Wait until the worker thread has processed everything submitted to it so
+ * far. Must be called before the graph is accessed from the main thread.
+ *
+ * @return the first error encountered by the worker thread, 0 otherwise
+ */
+int fg_thread_wait(FilterGraph *fg);
+void fg_thread_stop(FilterGraph *fg);
+
+/**
+ * Submit a frame to the encoder thread of the given output stream, starting
+ * the thread if necessary. A NULL frame flushes the encoder.
+ *
+ * Blocks while the queue of frames waiting for the encoder is full.
+ */
+int enc_thread_send_frame(OutputStream *ost, const AVFrame *frame);
+/**
+ * Retrieve an encoded packet from the encoder thread.
+ *
+ * @param block wait for a packet or EOF instead of returning AVERROR(EAGAIN)
+ * @return 0 when a packet was returned, AVERROR_EOF once the encoder has been
+ *         fully flushed, another negative error code on failure
+ */
+int enc_thread_receive_packet(OutputStream *ost, AVPacket *pkt, int block);
+/**
+ * @return the number of frames waiting in the encoder thread's queue
+ */
+int enc_thread_queue_occupancy(OutputStream *ost);
+void enc_thread_stop(OutputStream *ost);
+
+/**
+ * Submit a packet to the decoder thread of the given input stream, starting
+ * the thread if necessary, and retrieve a frame it has decoded, if any.
+ * An empty packet drains the decoder, a NULL packet only retrieves frames.
+ *
+ * Only waits for the decoder while it is being drained.
+ *
+ * @param src_pkt set to the timing properties of the packet the returned
+ *                frame was the first output for, NULL otherwise; valid until
+ *                the next call
+ * @return 0 or a decoding error, AVERROR_EOF once the decoder has been
+ *         fully drained
+ */
+int dec_thread_decode(InputStream *ist, AVFrame *frame, int *got_frame,
+                      const AVPacket *pkt, const AVPacket **src_pkt);
+/**
+ * Get the decoder properties that may change while decoding, as of the last
+ * packet processed by the decoder thread.
+ */
+void dec_thread_get_props(InputStream *ist, int *has_b_frames,
+                          AVRational *framerate, int *ticks_per_frame);
+void dec_thread_stop(InputStream *ist);
+
 int ffmpeg_parse_options(int argc, char **argv);
 
 HWDevice *hw_device_get_by_name(const char *name);
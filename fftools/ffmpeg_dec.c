@@ -0,0 +1,425 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ffmpeg.h"
+#include "objpool.h"
+#include "thread_queue.h"
+
+#include "libavutil/error.h"
+#include "libavutil/fifo.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "libavcodec/avcodec.h"
+
+#define DEC_THREAD_QUEUE_SIZE 8
+
+typedef struct DecodedFrame {
+    /* NULL for errors and EOF */
+    AVFrame  *frame;
+    /* properties of the packet this frame was the first output for, if any */
+    AVPacket *pkt;
+    int       ret;
+} DecodedFrame;
+
+struct DecoderThread {
+    InputStream    *ist;
+
+    /* packets sent to the decoder; an empty packet drains it */
+    ThreadQueue    *queue;
+    pthread_t       thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+
+    /* decoded frames and decoding errors waiting for the main thread,
+     * only accessed with lock held */
+    AVFifo         *frames;
+    /* a drain packet was sent and its EOF has not been returned yet */
+    int             draining;
+    /* fatal error, the thread does not accept any more packets */
+    int             ret;
+
+    /* decoder properties exported to the main thread, updated after each
+     * packet with lock held */
+    int             has_b_frames;
+    AVRational      framerate;
+    int             ticks_per_frame;
+
+    /* owned by the worker thread */
+    AVPacket       *pkt;
+
+    /* owned by the main thread, returned from dec_thread_decode() */
+    AVPacket       *src_pkt;
+};
+
+static void pkt_move(void *dst, void *src)
+{
+    av_packet_move_ref(dst, src);
+}
+
+static void frames_free(AVFifo **pframes)
+{
+    DecodedFrame df;
+
+    if (!*pframes)
+        return;
+
+    while (av_fifo_read(*pframes, &df, 1) >= 0) {
+        av_frame_free(&df.frame);
+        av_packet_free(&df.pkt);
+    }
+    av_fifo_freep2(pframes);
+}
+
+/* called with lock held */
+static void update_props(DecoderThread *dt, const AVCodecContext *dec)
+{
+    dt->has_b_frames    = dec->has_b_frames;
+    dt->framerate       = dec->framerate;
+    dt->ticks_per_frame = dec->ticks_per_frame;
+}
+
+/* called with lock held; the decoder context must not be accessed after
+ * pushing EOF, as the main thread may flush it */
+static int push_frame(DecoderThread *dt, const AVCodecContext *dec,
+                      AVFrame *frame, AVPacket *pkt, int ret)
+{
+    DecodedFrame df = { .frame = frame, .pkt = pkt, .ret = ret };
+
+    update_props(dt, dec);
+
+    ret = av_fifo_write(dt->frames, &df, 1);
+    pthread_cond_broadcast(&dt->cond);
+    return ret;
+}
+
+static int decode_packet(DecoderThread *dt, AVCodecContext *dec, const AVPacket *pkt)
+{
+    int first = 1;
+    int ret;
+
+    ret = avcodec_send_packet(dec, pkt);
+    // In particular, we don't expect AVERROR(EAGAIN), because we read all
+    // decoded frames with avcodec_receive_frame() until done.
+    if (ret < 0 && ret != AVERROR_EOF) {
+        pthread_mutex_lock(&dt->lock);
+        ret = push_frame(dt, dec, NULL, NULL, ret);
+        pthread_mutex_unlock(&dt->lock);
+        return ret;
+    }
+
+    while (1) {
+        AVPacket *src_pkt = NULL;
+        AVFrame *frame = av_frame_alloc();
+        if (!frame)
+            return AVERROR(ENOMEM);
+
+        ret = avcodec_receive_frame(dec, frame);
+        if (ret == AVERROR(EAGAIN)) {
+            av_frame_free(&frame);
+            pthread_mutex_lock(&dt->lock);
+            update_props(dt, dec);
+            pthread_mutex_unlock(&dt->lock);
+            return 0;
+        }
+        if (ret < 0)
+            av_frame_free(&frame);
+
+        /* the main thread uses the packet timestamps for the first frame
+         * output after sending it, like with synchronous decoding */
+        if (frame && first) {
+            src_pkt = av_packet_alloc();
+            if (!src_pkt) {
+                av_frame_free(&frame);
+                return AVERROR(ENOMEM);
+            }
+            src_pkt->pts      = pkt->pts;
+            src_pkt->dts      = pkt->dts;
+            src_pkt->duration = pkt->duration;
+            src_pkt->flags    = pkt->flags;
+            first = 0;
+        }
+
+        pthread_mutex_lock(&dt->lock);
+        ret = push_frame(dt, dec, frame, src_pkt, ret < 0 ? ret : 0);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            av_packet_free(&src_pkt);
+        }
+        pthread_mutex_unlock(&dt->lock);
+
+        if (ret < 0 || !frame)
+            return ret;
+    }
+}
+
+static void *decoder_thread(void *arg)
+{
+    DecoderThread   *dt = arg;
+    InputStream    *ist = dt->ist;
+    AVCodecContext *dec = ist->dec_ctx;
+    AVPacket       *pkt = dt->pkt;
+    char name[16];
+
+    snprintf(name, sizeof(name), "dec%d:%d", ist->file_index, ist->st->index);
+    ff_thread_setname(name);
+
+    while (1) {
+        int stream_idx, ret;
+
+        ret = tq_receive(dt->queue, &stream_idx, pkt);
+        if (ret < 0)
+            break;
+
+        ret = decode_packet(dt, dec, pkt);
+        av_packet_unref(pkt);
+
+        if (ret < 0) {
+            pthread_mutex_lock(&dt->lock);
+            dt->ret = ret;
+            pthread_cond_broadcast(&dt->cond);
+            pthread_mutex_unlock(&dt->lock);
+
+            av_log(NULL, AV_LOG_ERROR, "Error in the decoder thread for stream "
+                   "#%d:%d: %s\n", ist->file_index, ist->st->index, av_err2str(ret));
+            break;
+        }
+    }
+
+    /* let the main thread know we will not accept any more packets */
+    tq_receive_finish(dt->queue, 0);
+
+    return NULL;
+}
+
+static int dec_thread_start(InputStream *ist)
+{
+    DecoderThread *dt;
+    ObjPool *op;
+    int ret;
+
+    dt = av_mallocz(sizeof(*dt));
+    if (!dt)
+        return AVERROR(ENOMEM);
+    dt->ist = ist;
+
+    dt->has_b_frames    = ist->dec_ctx->has_b_frames;
+    dt->framerate       = ist->dec_ctx->framerate;
+    dt->ticks_per_frame = ist->dec_ctx->ticks_per_frame;
+
+    dt->pkt    = av_packet_alloc();
+    dt->frames = av_fifo_alloc2(DEC_THREAD_QUEUE_SIZE, sizeof(DecodedFrame),
+                                AV_FIFO_FLAG_AUTO_GROW);
+    if (!dt->pkt || !dt->frames)
+        goto fail_alloc;
+
+    op = objpool_alloc_packets();
+    if (!op)
+        goto fail_alloc;
+
+    dt->queue = tq_alloc(1, DEC_THREAD_QUEUE_SIZE, op, pkt_move);
+    if (!dt->queue) {
+        objpool_free(&op);
+        goto fail_alloc;
+    }
+
+    ret = pthread_mutex_init(&dt->lock, NULL);
+    if (ret)
+        goto fail_mutex;
+    ret = pthread_cond_init(&dt->cond, NULL);
+    if (ret)
+        goto fail_cond;
+
+    ret = pthread_create(&dt->thread, NULL, decoder_thread, dt);
+    if (ret) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create() failed: %s\n", strerror(ret));
+        goto fail_thread;
+    }
+
+    ist->dec_thread = dt;
+
+    return 0;
+
+fail_thread:
+    pthread_cond_destroy(&dt->cond);
+fail_cond:
+    pthread_mutex_destroy(&dt->lock);
+fail_mutex:
+    tq_free(&dt->queue);
+    av_packet_free(&dt->pkt);
+    frames_free(&dt->frames);
+    av_freep(&dt);
+    return AVERROR(ret);
+fail_alloc:
+    av_packet_free(&dt->pkt);
+    frames_free(&dt->frames);
+    av_freep(&dt);
+    return AVERROR(ENOMEM);
+}
+
+static int dec_thread_send_packet(DecoderThread *dt, const AVPacket *pkt)
+{
+    AVPacket *tmp;
+    int ret;
+
+    tmp = av_packet_alloc();
+    if (!tmp)
+        return AVERROR(ENOMEM);
+
+    /* av_packet_ref() would turn an empty drain packet into a zero-sized one
+     * with data, which the decoder rejects */
+    if (pkt->data || pkt->size || pkt->side_data_elems) {
+        ret = av_packet_ref(tmp, pkt);
+        if (ret < 0) {
+            av_packet_free(&tmp);
+            return ret;
+        }
+    } else {
+        int draining;
+
+        pthread_mutex_lock(&dt->lock);
+        draining     = dt->draining;
+        dt->draining = 1;
+        pthread_mutex_unlock(&dt->lock);
+
+        /* the decoder is already being drained, the frames it is still
+         * outputting are returned for this packet as well */
+        if (draining) {
+            av_packet_free(&tmp);
+            return 0;
+        }
+    }
+
+    ret = tq_send(dt->queue, 0, tmp);
+    av_packet_free(&tmp);
+    if (ret < 0) {
+        pthread_mutex_lock(&dt->lock);
+        /* the thread stopped accepting packets, report why */
+        if (ret == AVERROR_EOF && dt->ret)
+            ret = dt->ret;
+        pthread_mutex_unlock(&dt->lock);
+    }
+
+    return ret;
+}
+
+int dec_thread_decode(InputStream *ist, AVFrame *frame, int *got_frame,
+                      const AVPacket *pkt, const AVPacket **src_pkt)
+{
+    DecoderThread *dt;
+    DecodedFrame df;
+    int ret = 0;
+
+    *got_frame = 0;
+    *src_pkt   = NULL;
+
+    if (!ist->dec_thread) {
+        ret = dec_thread_start(ist);
+        if (ret < 0)
+            return ret;
+    }
+    dt = ist->dec_thread;
+
+    av_packet_free(&dt->src_pkt);
+
+    if (pkt) {
+        ret = dec_thread_send_packet(dt, pkt);
+        if (ret < 0)
+            return ret;
+    }
+
+    pthread_mutex_lock(&dt->lock);
+    while (1) {
+        if (av_fifo_read(dt->frames, &df, 1) >= 0) {
+            if (df.frame) {
+                av_frame_move_ref(frame, df.frame);
+                av_frame_free(&df.frame);
+                *got_frame = 1;
+            }
+            dt->src_pkt = df.pkt;
+            *src_pkt    = df.pkt;
+            if (df.ret == AVERROR_EOF)
+                dt->draining = 0;
+            ret = df.ret;
+            break;
+        }
+
+        if (dt->ret < 0) {
+            ret = dt->ret;
+            break;
+        }
+        /* outside of draining, do not wait for the decoder to catch up */
+        if (!dt->draining)
+            break;
+
+        pthread_cond_wait(&dt->cond, &dt->lock);
+    }
+    pthread_mutex_unlock(&dt->lock);
+
+    return ret;
+}
+
+void dec_thread_get_props(InputStream *ist, int *has_b_frames,
+                          AVRational *framerate, int *ticks_per_frame)
+{
+    DecoderThread *dt = ist->dec_thread;
+
+    if (!dt) {
+        if (has_b_frames)
+            *has_b_frames    = ist->dec_ctx->has_b_frames;
+        if (framerate)
+            *framerate       = ist->dec_ctx->framerate;
+        if (ticks_per_frame)
+            *ticks_per_frame = ist->dec_ctx->ticks_per_frame;
+        return;
+    }
+
+    pthread_mutex_lock(&dt->lock);
+    if (has_b_frames)
+        *has_b_frames    = dt->has_b_frames;
+    if (framerate)
+        *framerate       = dt->framerate;
+    if (ticks_per_frame)
+        *ticks_per_frame = dt->ticks_per_frame;
+    pthread_mutex_unlock(&dt->lock);
+}
+
+void dec_thread_stop(InputStream *ist)
+{
+    DecoderThread *dt = ist->dec_thread;
+
+    if (!dt)
+        return;
+
+    tq_send_finish(dt->queue, 0);
+    pthread_join(dt->thread, NULL);
+
+    tq_free(&dt->queue);
+    frames_free(&dt->frames);
+    av_packet_free(&dt->pkt);
+    av_packet_free(&dt->src_pkt);
+    pthread_cond_destroy(&dt->cond);
+    pthread_mutex_destroy(&dt->lock);
+
+    av_freep(&ist->dec_thread);
+}
@@ -461,6 +461,8 @@ static void ist_free(InputStream **pist)
     if (!ist)
         return;
 
+    dec_thread_stop(ist);
+
     av_frame_free(&ist->decoded_frame);
     av_packet_free(&ist->pkt);
     av_dict_free(&ist->decoder_opts);
@@ -0,0 +1,349 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ffmpeg.h"
+#include "objpool.h"
+#include "thread_queue.h"
+
+#include "libavutil/error.h"
+#include "libavutil/fifo.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "libavcodec/avcodec.h"
+
+#define ENC_THREAD_QUEUE_SIZE 8
+
+struct EncoderThread {
+    OutputStream   *ost;
+
+    /* frames sent to the encoder; an empty frame signals a flush */
+    ThreadQueue    *queue;
+    pthread_t       thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+
+    /* encoded packets waiting for the main thread,
+     * only accessed with lock held */
+    AVFifo         *packets;
+    /* number of frames sent but not yet picked up by the encoder */
+    int             nb_queued;
+    /* the encoder has been fully flushed */
+    int             eof;
+    /* error returned by the encoder */
+    int             ret;
+
+    /* owned by the worker thread */
+    AVFrame        *frame;
+};
+
+static void frame_move(void *dst, void *src)
+{
+    av_frame_move_ref(dst, src);
+}
+
+static void packets_free(AVFifo **ppackets)
+{
+    AVPacket *pkt;
+
+    if (!*ppackets)
+        return;
+
+    while (av_fifo_read(*ppackets, &pkt, 1) >= 0)
+        av_packet_free(&pkt);
+    av_fifo_freep2(ppackets);
+}
+
+/* called with lock held */
+static void enc_thread_set_error(EncoderThread *et, int ret)
+{
+    if (!et->ret)
+        et->ret = ret;
+    pthread_cond_broadcast(&et->cond);
+}
+
+static int encode_packets(EncoderThread *et, AVCodecContext *enc)
+{
+    OutputStream *ost = et->ost;
+    int ret;
+
+    while (1) {
+        AVPacket *pkt = av_packet_alloc();
+        if (!pkt)
+            return AVERROR(ENOMEM);
+
+        ret = avcodec_receive_packet(enc, pkt);
+
+        /* if two pass, output log on success and EOF */
+        if ((ret >= 0 || ret == AVERROR_EOF) && ost->logfile && enc->stats_out)
+            fprintf(ost->logfile, "%s", enc->stats_out);
+
+        if (ret < 0) {
+            av_packet_free(&pkt);
+            if (ret == AVERROR(EAGAIN))
+                return 0;
+            if (ret == AVERROR_EOF) {
+                pthread_mutex_lock(&et->lock);
+                et->eof = 1;
+                pthread_cond_broadcast(&et->cond);
+                pthread_mutex_unlock(&et->lock);
+            }
+            return ret;
+        }
+
+        pthread_mutex_lock(&et->lock);
+        ret = av_fifo_write(et->packets, &pkt, 1);
+        pthread_cond_broadcast(&et->cond);
+        pthread_mutex_unlock(&et->lock);
+        if (ret < 0) {
+            av_packet_free(&pkt);
+            return ret;
+        }
+    }
+}
+
+static void *encoder_thread(void *arg)
+{
+    EncoderThread    *et = arg;
+    OutputStream    *ost = et->ost;
+    AVCodecContext  *enc = ost->enc_ctx;
+    AVFrame       *frame = et->frame;
+    char name[16];
+
+    snprintf(name, sizeof(name), "enc%d:%d", ost->file_index, ost->index);
+    ff_thread_setname(name);
+
+    while (1) {
+        int stream_idx, flush, ret;
+
+        ret = tq_receive(et->queue, &stream_idx, frame);
+        if (ret < 0)
+            break;
+
+        pthread_mutex_lock(&et->lock);
+        et->nb_queued--;
+        pthread_mutex_unlock(&et->lock);
+
+        flush = !frame->buf[0];
+
+        ret = avcodec_send_frame(enc, flush ? NULL : frame);
+        av_frame_unref(frame);
+        if (ret < 0 && !(ret == AVERROR_EOF && flush)) {
+            av_log(NULL, AV_LOG_ERROR, "Error submitting %s frame to the encoder\n",
+                   av_get_media_type_string(enc->codec_type));
+            goto fail;
+        }
+
+        ret = encode_packets(et, enc);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "%s encoding failed\n",
+                   av_get_media_type_string(enc->codec_type));
+            goto fail;
+        }
+        continue;
+fail:
+        pthread_mutex_lock(&et->lock);
+        enc_thread_set_error(et, ret);
+        pthread_mutex_unlock(&et->lock);
+        break;
+    }
+
+    /* let the main thread know we will not accept any more frames */
+    tq_receive_finish(et->queue, 0);
+
+    pthread_mutex_lock(&et->lock);
+    if (!et->eof && !et->ret)
+        enc_thread_set_error(et, AVERROR_EOF);
+    pthread_mutex_unlock(&et->lock);
+
+    return NULL;
+}
+
+static int enc_thread_start(OutputStream *ost)
+{
+    EncoderThread *et;
+    ObjPool *op;
+    int ret;
+
+    et = av_mallocz(sizeof(*et));
+    if (!et)
+        return AVERROR(ENOMEM);
+    et->ost = ost;
+
+    et->frame   = av_frame_alloc();
+    et->packets = av_fifo_alloc2(ENC_THREAD_QUEUE_SIZE, sizeof(AVPacket*),
+                                 AV_FIFO_FLAG_AUTO_GROW);
+    if (!et->frame || !et->packets)
+        goto fail_alloc;
+
+    op = objpool_alloc_frames();
+    if (!op)
+        goto fail_alloc;
+
+    et->queue = tq_alloc(1, ENC_THREAD_QUEUE_SIZE, op, frame_move);
+    if (!et->queue) {
+        objpool_free(&op);
+        goto fail_alloc;
+    }
+
+    ret = pthread_mutex_init(&et->lock, NULL);
+    if (ret)
+        goto fail_mutex;
+    ret = pthread_cond_init(&et->cond, NULL);
+    if (ret)
+        goto fail_cond;
+
+    ret = pthread_create(&et->thread, NULL, encoder_thread, et);
+    if (ret) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create() failed: %s\n", strerror(ret));
+        goto fail_thread;
+    }
+
+    ost->enc_thread = et;
+
+    return 0;
+
+fail_thread:
+    pthread_cond_destroy(&et->cond);
+fail_cond:
+    pthread_mutex_destroy(&et->lock);
+fail_mutex:
+    tq_free(&et->queue);
+    av_frame_free(&et->frame);
+    packets_free(&et->packets);
+    av_freep(&et);
+    return AVERROR(ret);
+fail_alloc:
+    av_frame_free(&et->frame);
+    packets_free(&et->packets);
+    av_freep(&et);
+    return AVERROR(ENOMEM);
+}
+
+int enc_thread_send_frame(OutputStream *ost, const AVFrame *frame)
+{
+    EncoderThread *et;
+    AVFrame *tmp;
+    int ret;
+
+    if (!ost->enc_thread) {
+        ret = enc_thread_start(ost);
+        if (ret < 0)
+            return ret;
+    }
+    et = ost->enc_thread;
+
+    tmp = frame ? av_frame_clone(frame) : av_frame_alloc();
+    if (!tmp)
+        return AVERROR(ENOMEM);
+
+    pthread_mutex_lock(&et->lock);
+    et->nb_queued++;
+    pthread_mutex_unlock(&et->lock);
+
+    ret = tq_send(et->queue, 0, tmp);
+    av_frame_free(&tmp);
+    if (ret < 0) {
+        pthread_mutex_lock(&et->lock);
+        et->nb_queued--;
+        /* the thread stopped accepting frames, report why */
+        if (ret == AVERROR_EOF && et->ret)
+            ret = et->ret;
+        pthread_mutex_unlock(&et->lock);
+    }
+
+    return ret;
+}
+
+int enc_thread_receive_packet(OutputStream *ost, AVPacket *pkt, int block)
+{
+    EncoderThread *et = ost->enc_thread;
+    AVPacket *tmp;
+    int ret = 0;
+
+    if (!et)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&et->lock);
+    while (1) {
+        if (av_fifo_read(et->packets, &tmp, 1) >= 0) {
+            av_packet_move_ref(pkt, tmp);
+            av_packet_free(&tmp);
+            break;
+        }
+
+        if (et->eof) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        if (et->ret < 0) {
+            ret = et->ret;
+            break;
+        }
+        if (!block) {
+            ret = AVERROR(EAGAIN);
+            break;
+        }
+
+        pthread_cond_wait(&et->cond, &et->lock);
+    }
+    pthread_mutex_unlock(&et->lock);
+
+    return ret;
+}
+
+int enc_thread_queue_occupancy(OutputStream *ost)
+{
+    EncoderThread *et = ost->enc_thread;
+    int ret;
+
+    if (!et)
+        return 0;
+
+    pthread_mutex_lock(&et->lock);
+    ret = et->nb_queued;
+    pthread_mutex_unlock(&et->lock);
+
+    return ret;
+}
+
+void enc_thread_stop(OutputStream *ost)
+{
+    EncoderThread *et = ost->enc_thread;
+
+    if (!et)
+        return;
+
+    tq_send_finish(et->queue, 0);
+    pthread_join(et->thread, NULL);
+
+    tq_free(&et->queue);
+    packets_free(&et->packets);
+    av_frame_free(&et->frame);
+    pthread_cond_destroy(&et->cond);
+    pthread_mutex_destroy(&et->lock);
+
+    av_freep(&ost->enc_thread);
+}
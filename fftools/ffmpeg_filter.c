@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 #include "ffmpeg.h"
+#include "thread_queue.h"
 
 #include "libavfilter/avfilter.h"
 #include "libavfilter/buffersink.h"
@@ -925,9 +926,41 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
     }
 }
 
+void print_filtergraph_profile(FilterGraph *fg)
+{
+    char *dump;
+
+    if (!fg->graph)
+        return;
+
+    if (do_benchmark) {
+        for (unsigned i = 0; i < fg->graph->nb_filters; i++) {
+            const AVFilterContext *filter = fg->graph->filters[i];
+            const AVFilterProfile *p = avfilter_get_profile(filter);
+
+            if (p->nb_frame_copies)
+                av_log(NULL, AV_LOG_INFO,
+                       "bench: filtergraph #%d filter %s copied %"PRId64" frames (%"PRId64"B)\n",
+                       fg->index, filter->name, p->nb_frame_copies, p->frame_copy_bytes);
+        }
+    }
+
+    if (!fg->graph->profile)
+        return;
+
+    dump = avfilter_graph_dump_profile(fg->graph, NULL);
+    if (dump)
+        av_log(NULL, AV_LOG_INFO, "Filtergraph #%d profile:\n%s", fg->index, dump);
+    av_free(dump);
+}
+
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
+
+    fg_thread_wait(fg);
+    print_filtergraph_profile(fg);
+
     for (i = 0; i < fg->nb_outputs; i++)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
@@ -942,6 +975,54 @@ static int filter_is_buffersrc(const AVFilterContext *f)
             !strcmp(f->filter->name, "abuffer"));
 }
 
+static int scale_has_fixed_size(AVFilterContext *f)
+{
+    int64_t eval, force_oar;
+    uint8_t *w = NULL, *h = NULL;
+    char *end;
+    int ret = 0;
+
+    if (av_opt_get_int(f, "eval", AV_OPT_SEARCH_CHILDREN, &eval) < 0 || eval ||
+        av_opt_get_int(f, "force_original_aspect_ratio",
+                       AV_OPT_SEARCH_CHILDREN, &force_oar) < 0 || force_oar)
+        return 0;
+
+    if (av_opt_get(f, "w", AV_OPT_SEARCH_CHILDREN, &w) >= 0 &&
+        av_opt_get(f, "h", AV_OPT_SEARCH_CHILDREN, &h) >= 0)
+        ret = strtol(w, &end, 10) > 0 && !*end &&
+              strtol(h, &end, 10) > 0 && !*end;
+
+    av_free(w);
+    av_free(h);
+    return ret;
+}
+
+/*
+ * Check whether a video input can change its frame size without the graph
+ * being reconfigured: its frames must reach a scale filter producing a
+ * constant output size through pass-through filters only. That scaler then
+ * reinitializes itself for the new size and the rest of the graph is
+ * unaffected. Must be called before the graph processes any frame, since
+ * scale replaces its size expressions with their values when the input
+ * changes.
+ */
+static int ifilter_can_resize_in_place(InputFilter *ifilter)
+{
+    AVFilterContext *f = ifilter->filter;
+
+    if (ifilter->type != AVMEDIA_TYPE_VIDEO)
+        return 0;
+
+    while (f->nb_outputs == 1 && f->outputs[0]) {
+        f = f->outputs[0]->dst;
+        if (!strcmp(f->filter->name, "scale"))
+            return scale_has_fixed_size(f);
+        if (strcmp(f->filter->name, "null") && strcmp(f->filter->name, "format"))
+            return 0;
+    }
+    return 0;
+}
+
 static int graph_is_meta(AVFilterGraph *graph)
 {
     for (unsigned i = 0; i < graph->nb_filters; i++) {
@@ -969,6 +1050,12 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->thread_pool  = thread_pool;
+    fg->graph->buffer_cache = buffer_cache;
+    if (filter_pipeline)
+        fg->graph->thread_type |= AVFILTER_THREAD_PIPELINE;
+    fg->graph->profile = filter_profile;
+    fg->graph->audio_frame_size = filter_audio_frame_size;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -1056,6 +1143,9 @@ int configure_filtergraph(FilterGraph *fg)
 
     fg->is_meta = graph_is_meta(fg->graph);
 
+    for (i = 0; i < fg->nb_inputs; i++)
+        fg->inputs[i]->resize_in_place = ifilter_can_resize_in_place(fg->inputs[i]);
+
     /* limit the lists of allowed formats to the ones selected, to
      * make sure they stay the same if the filtergraph is reconfigured later */
     for (i = 0; i < fg->nb_outputs; i++) {
@@ -1158,3 +1248,237 @@ int filtergraph_is_simple(FilterGraph *fg)
 {
     return !fg->graph_desc;
 }
+
+struct FilterGraphThread {
+    ThreadQueue    *queue;
+    pthread_t       thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    /* number of submitted items not yet processed by the thread */
+    unsigned        nb_pending;
+    /* first error returned by the filtergraph */
+    int             ret;
+
+    /* owned by the worker thread */
+    AVFrame        *frame;
+};
+
+static void frame_move(void *dst, void *src)
+{
+    av_frame_move_ref(dst, src);
+}
+
+static void *filter_thread(void *arg)
+{
+    FilterGraph       *fg = arg;
+    FilterGraphThread *fgt = fg->thread;
+    AVFrame        *frame = fgt->frame;
+    char name[16];
+
+    snprintf(name, sizeof(name), "fg%d", fg->index);
+    ff_thread_setname(name);
+
+    while (1) {
+        InputFilter *ifilter;
+        int input_idx, ret;
+
+        ret = tq_receive(fgt->queue, &input_idx, frame);
+        if (ret < 0) {
+            /* EOF for a single input is sent in-band, -1 means we are done */
+            if (input_idx >= 0)
+                continue;
+            break;
+        }
+
+        ifilter = fg->inputs[input_idx];
+
+        if (frame->buf[0]) {
+            ret = av_buffersrc_add_frame_flags(ifilter->filter, frame,
+                                               AV_BUFFERSRC_FLAG_PUSH);
+        } else {
+            /* an empty frame signals EOF with the timestamp stored in pts */
+            ret = av_buffersrc_close(ifilter->filter, frame->pts,
+                                     AV_BUFFERSRC_FLAG_PUSH);
+        }
+        av_frame_unref(frame);
+
+        if (ret < 0 && ret != AVERROR_EOF)
+            av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n",
+                   av_err2str(ret));
+
+        pthread_mutex_lock(&fgt->lock);
+        if (ret < 0 && ret != AVERROR_EOF && !fgt->ret)
+            fgt->ret = ret;
+        if (!--fgt->nb_pending)
+            pthread_cond_signal(&fgt->cond);
+        pthread_mutex_unlock(&fgt->lock);
+    }
+
+    return NULL;
+}
+
+static int fg_thread_start(FilterGraph *fg)
+{
+    FilterGraphThread *fgt;
+    ObjPool *op;
+    int ret;
+
+    fgt = av_mallocz(sizeof(*fgt));
+    if (!fgt)
+        return AVERROR(ENOMEM);
+
+    fgt->frame = av_frame_alloc();
+    if (!fgt->frame)
+        goto fail_alloc;
+
+    op = objpool_alloc_frames();
+    if (!op)
+        goto fail_alloc;
+
+    fgt->queue = tq_alloc(fg->nb_inputs, 8, op, frame_move);
+    if (!fgt->queue) {
+        objpool_free(&op);
+        goto fail_alloc;
+    }
+
+    ret = pthread_mutex_init(&fgt->lock, NULL);
+    if (ret)
+        goto fail_mutex;
+    ret = pthread_cond_init(&fgt->cond, NULL);
+    if (ret)
+        goto fail_cond;
+
+    fg->thread = fgt;
+
+    ret = pthread_create(&fgt->thread, NULL, filter_thread, fg);
+    if (ret) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create() failed: %s\n", strerror(ret));
+        fg->thread = NULL;
+        goto fail_thread;
+    }
+
+    return 0;
+
+fail_thread:
+    pthread_cond_destroy(&fgt->cond);
+fail_cond:
+    pthread_mutex_destroy(&fgt->lock);
+fail_mutex:
+    tq_free(&fgt->queue);
+    av_frame_free(&fgt->frame);
+    av_freep(&fgt);
+    return AVERROR(ret);
+fail_alloc:
+    av_frame_free(&fgt->frame);
+    av_freep(&fgt);
+    return AVERROR(ENOMEM);
+}
+
+void fg_thread_stop(FilterGraph *fg)
+{
+    FilterGraphThread *fgt = fg->thread;
+
+    if (!fgt)
+        return;
+
+    for (int i = 0; i < fg->nb_inputs; i++)
+        tq_send_finish(fgt->queue, i);
+
+    pthread_join(fgt->thread, NULL);
+
+    tq_free(&fgt->queue);
+    av_frame_free(&fgt->frame);
+    pthread_cond_destroy(&fgt->cond);
+    pthread_mutex_destroy(&fgt->lock);
+
+    av_freep(&fg->thread);
+}
+
+int fg_thread_wait(FilterGraph *fg)
+{
+    FilterGraphThread *fgt = fg->thread;
+    int ret;
+
+    if (!fgt)
+        return 0;
+
+    pthread_mutex_lock(&fgt->lock);
+    while (fgt->nb_pending)
+        pthread_cond_wait(&fgt->cond, &fgt->lock);
+    ret = fgt->ret;
+    pthread_mutex_unlock(&fgt->lock);
+
+    return ret;
+}
+
+static int fg_thread_submit(InputFilter *ifilter, AVFrame *frame)
+{
+    FilterGraph *fg = ifilter->graph;
+    FilterGraphThread *fgt;
+    int input_idx, ret;
+
+    if (!fg->thread) {
+        ret = fg_thread_start(fg);
+        if (ret < 0)
+            return ret;
+    }
+    fgt = fg->thread;
+
+    for (input_idx = 0; input_idx < fg->nb_inputs; input_idx++)
+        if (fg->inputs[input_idx] == ifilter)
+            break;
+    av_assert0(input_idx < fg->nb_inputs);
+
+    pthread_mutex_lock(&fgt->lock);
+    ret = fgt->ret;
+    if (ret >= 0)
+        fgt->nb_pending++;
+    pthread_mutex_unlock(&fgt->lock);
+    if (ret < 0)
+        return ret;
+
+    ret = tq_send(fgt->queue, input_idx, frame);
+    if (ret < 0) {
+        pthread_mutex_lock(&fgt->lock);
+        if (!--fgt->nb_pending)
+            pthread_cond_signal(&fgt->cond);
+        pthread_mutex_unlock(&fgt->lock);
+    }
+
+    return ret;
+}
+
+int fg_thread_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_reference)
+{
+    AVFrame *tmp = frame;
+    int ret;
+
+    if (keep_reference) {
+        tmp = av_frame_clone(frame);
+        if (!tmp)
+            return AVERROR(ENOMEM);
+    }
+
+    ret = fg_thread_submit(ifilter, tmp);
+
+    if (keep_reference)
+        av_frame_free(&tmp);
+
+    return ret;
+}
+
+int fg_thread_send_eof(InputFilter *ifilter, int64_t pts)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    frame->pts = pts;
+
+    ret = fg_thread_submit(ifilter, frame);
+    av_frame_free(&frame);
+
+    return ret;
+}
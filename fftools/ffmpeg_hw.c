@@ -27,20 +27,68 @@
 static int nb_hw_devices;
 static HWDevice **hw_devices;
 
+static HWDevice *hw_device_get_from_group(const char *group)
+{
+    // Pick the least loaded member: the one with the fewest decoders and
+    // encoders, then the one with the least memory used by frames.
+    HWDevice *best = NULL;
+    size_t best_size = 0;
+    int i;
+    for (i = 0; i < nb_hw_devices; i++) {
+        HWDevice *dev = hw_devices[i];
+        size_t size = 0;
+        if (!dev->group || strcmp(dev->group, group))
+            continue;
+        av_hwdevice_get_frames_memory(dev->device_ref, &size, NULL);
+        if (!best || dev->nb_users < best->nb_users ||
+            (dev->nb_users == best->nb_users && size < best_size)) {
+            best      = dev;
+            best_size = size;
+        }
+    }
+    return best;
+}
+
 static HWDevice *hw_device_get_by_type(enum AVHWDeviceType type)
 {
     HWDevice *found = NULL;
     int i;
     for (i = 0; i < nb_hw_devices; i++) {
         if (hw_devices[i]->type == type) {
-            if (found)
+            if (found && !(found->group && hw_devices[i]->group &&
+                           !strcmp(found->group, hw_devices[i]->group)))
                 return NULL;
             found = hw_devices[i];
         }
     }
+    if (found && found->group)
+        return hw_device_get_from_group(found->group);
     return found;
 }
 
+static HWDevice *hw_device_get_by_ref(const AVBufferRef *device_ref)
+{
+    int i;
+    if (!device_ref)
+        return NULL;
+    for (i = 0; i < nb_hw_devices; i++) {
+        if (hw_devices[i]->device_ref->data == device_ref->data)
+            return hw_devices[i];
+    }
+    return NULL;
+}
+
+// The group member used by the decoder of ist, so that the frames of one
+// pipeline stay on a single device.
+static HWDevice *hw_device_get_for_input(InputStream *ist)
+{
+    HWDevice *dev;
+    if (!ist || !ist->dec_ctx)
+        return NULL;
+    dev = hw_device_get_by_ref(ist->dec_ctx->hw_device_ctx);
+    return dev && dev->group ? dev : NULL;
+}
+
 HWDevice *hw_device_get_by_name(const char *name)
 {
     int i;
@@ -48,7 +96,7 @@ HWDevice *hw_device_get_by_name(const char *name)
         if (!strcmp(hw_devices[i]->name, name))
             return hw_devices[i];
     }
-    return NULL;
+    return hw_device_get_from_group(name);
 }
 
 static HWDevice *hw_device_add(void)
@@ -91,6 +139,49 @@ static char *hw_device_default_name(enum AVHWDeviceType type)
     return name;
 }
 
+static int hw_device_init_group(enum AVHWDeviceType type, const char *name,
+                                const char *devices, AVDictionary *options)
+{
+    char *list, *device, *saveptr = NULL;
+    int err = 0, i;
+
+    list = av_strdup(devices);
+    if (!list)
+        return AVERROR(ENOMEM);
+
+    for (i = 0, device = av_strtok(list, "|", &saveptr); device;
+         i++, device = av_strtok(NULL, "|", &saveptr)) {
+        AVBufferRef *device_ref = NULL;
+        HWDevice *dev;
+
+        err = av_hwdevice_ctx_create(&device_ref, type, device, options, 0);
+        if (err < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Device %s of group %s creation "
+                   "failed: %d.\n", device, name, err);
+            break;
+        }
+
+        dev = hw_device_add();
+        if (!dev) {
+            av_buffer_unref(&device_ref);
+            err = AVERROR(ENOMEM);
+            break;
+        }
+
+        dev->name       = av_asprintf("%s.%d", name, i);
+        dev->group      = av_strdup(name);
+        dev->type       = type;
+        dev->device_ref = device_ref;
+        if (!dev->name || !dev->group) {
+            err = AVERROR(ENOMEM);
+            break;
+        }
+    }
+
+    av_free(list);
+    return err;
+}
+
 int hw_device_init_from_string(const char *arg, HWDevice **dev_out)
 {
     // "type=name"
@@ -173,6 +264,16 @@ int hw_device_init_from_string(const char *arg, HWDevice **dev_out)
             }
         }
 
+        if (q ? device && strchr(device, '|') : !!strchr(p, '|')) {
+            // Device group, one device per '|'-separated entry.
+            err = hw_device_init_group(type, name, q ? device : p, options);
+            if (err < 0)
+                goto done;
+            if (dev_out)
+                *dev_out = hw_device_get_by_name(name);
+            goto done;
+        }
+
         err = av_hwdevice_ctx_create(&device_ref, type,
                                      q ? device : p[0] ? p : NULL,
                                      options, 0);
@@ -290,6 +391,7 @@ void hw_device_free_all(void)
     int i;
     for (i = 0; i < nb_hw_devices; i++) {
         av_freep(&hw_devices[i]->name);
+        av_freep(&hw_devices[i]->group);
         av_buffer_unref(&hw_devices[i]->device_ref);
         av_freep(&hw_devices[i]);
     }
@@ -438,6 +540,7 @@ int hw_device_setup_for_decode(InputStream *ist)
     ist->dec_ctx->hw_device_ctx = av_buffer_ref(dev->device_ref);
     if (!ist->dec_ctx->hw_device_ctx)
         return AVERROR(ENOMEM);
+    dev->nb_users++;
 
     return 0;
 }
@@ -480,8 +583,11 @@ int hw_device_setup_for_encode(OutputStream *ost)
         }
 
         if (!dev &&
-            config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)
-            dev = hw_device_get_by_type(config->device_type);
+            config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) {
+            dev = hw_device_get_for_input(ost->ist);
+            if (!dev || dev->type != config->device_type)
+                dev = hw_device_get_by_type(config->device_type);
+        }
     }
 
     if (dev) {
@@ -491,6 +597,7 @@ int hw_device_setup_for_encode(OutputStream *ost)
         ost->enc_ctx->hw_device_ctx = av_buffer_ref(dev->device_ref);
         if (!ost->enc_ctx->hw_device_ctx)
             return AVERROR(ENOMEM);
+        dev->nb_users++;
     } else {
         // No device required, or no device available.
     }
@@ -550,25 +657,32 @@ int hwaccel_decode_init(AVCodecContext *avctx)
 
 int hw_device_setup_for_filter(FilterGraph *fg)
 {
-    HWDevice *dev;
+    HWDevice *dev = NULL;
     int i;
 
     // Pick the last hardware device if the user doesn't pick the device for
-    // filters explicitly with the filter_hw_device option.
+    // filters explicitly with the filter_hw_device option. If the inputs are
+    // decoded on a device group member, keep the frames on that device.
     if (filter_hw_device)
         dev = filter_hw_device;
-    else if (nb_hw_devices > 0) {
+    else {
+        for (i = 0; i < fg->nb_inputs && !dev; i++)
+            dev = hw_device_get_for_input(fg->inputs[i]->ist);
+    }
+
+    if (!dev && nb_hw_devices > 0) {
         dev = hw_devices[nb_hw_devices - 1];
 
-        if (nb_hw_devices > 1)
+        if (dev->group)
+            dev = hw_device_get_from_group(dev->group);
+        else if (nb_hw_devices > 1)
             av_log(NULL, AV_LOG_WARNING, "There are %d hardware devices. device "
                    "%s of type %s is picked for filters by default. Set hardware "
                    "device explicitly with the filter_hw_device option if device "
                    "%s is not usable for filters.\n",
                    nb_hw_devices, dev->name,
                    av_hwdevice_get_type_name(dev->type), dev->name);
-    } else
-        dev = NULL;
+    }
 
     if (dev) {
         for (i = 0; i < fg->graph->nb_filters; i++) {
@@ -644,6 +644,8 @@ static void ost_free(OutputStream **post)
         return;
     ms = ms_from_ost(ost);
 
+    enc_thread_stop(ost);
+
     if (ost->logfile) {
         if (fclose(ost->logfile))
             av_log(NULL, AV_LOG_ERROR,
@@ -1155,7 +1155,8 @@ static void create_streams(Muxer *mux, const OptionsContext *o)
     }
 }
 
-static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_us)
+static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_us,
+                             int64_t buf_size_bytes)
 {
     OutputFile *of = &mux->of;
     int nb_av_enc = 0, nb_interleaved = 0;
@@ -1164,6 +1165,7 @@ static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_u
 #define IS_AV_ENC(ost, type)  \
     (ost->enc_ctx && (type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO))
 #define IS_INTERLEAVED(type) (type != AVMEDIA_TYPE_ATTACHMENT)
+#define IS_SPARSE(type)      (type == AVMEDIA_TYPE_SUBTITLE || type == AVMEDIA_TYPE_DATA)
 
     for (int i = 0; i < oc->nb_streams; i++) {
         OutputStream *ost = of->streams[i];
@@ -1188,7 +1190,7 @@ static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_u
      * one encoded audio/video stream is frame-limited, then we
      * synchronize them before encoding */
     if ((of->shortest && nb_av_enc > 1) || limit_frames_av_enc) {
-        of->sq_encode = sq_alloc(SYNC_QUEUE_FRAMES, buf_size_us);
+        of->sq_encode = sq_alloc(SYNC_QUEUE_FRAMES, buf_size_us, buf_size_bytes);
         if (!of->sq_encode)
             return AVERROR(ENOMEM);
 
@@ -1201,7 +1203,7 @@ static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_u
                 continue;
 
             ost->sq_idx_encode = sq_add_stream(of->sq_encode,
-                                               of->shortest || ms->max_frames < INT64_MAX);
+                                               of->shortest || ms->max_frames < INT64_MAX, 0);
             if (ost->sq_idx_encode < 0)
                 return ost->sq_idx_encode;
 
@@ -1217,7 +1219,7 @@ static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_u
     /* if there are any additional interleaved streams, then ALL the streams
      * are also synchronized before sending them to the muxer */
     if (nb_interleaved > nb_av_enc) {
-        mux->sq_mux = sq_alloc(SYNC_QUEUE_PACKETS, buf_size_us);
+        mux->sq_mux = sq_alloc(SYNC_QUEUE_PACKETS, buf_size_us, buf_size_bytes);
         if (!mux->sq_mux)
             return AVERROR(ENOMEM);
 
@@ -1234,7 +1236,8 @@ static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_u
                 continue;
 
             ost->sq_idx_mux = sq_add_stream(mux->sq_mux,
-                                            of->shortest || ms->max_frames < INT64_MAX);
+                                            of->shortest || ms->max_frames < INT64_MAX,
+                                            IS_SPARSE(type));
             if (ost->sq_idx_mux < 0)
                 return ost->sq_idx_mux;
 
@@ -1245,6 +1248,7 @@ static int setup_sync_queues(Muxer *mux, AVFormatContext *oc, int64_t buf_size_u
 
 #undef IS_AV_ENC
 #undef IS_INTERLEAVED
+#undef IS_SPARSE
 
     return 0;
 }
@@ -2072,7 +2076,8 @@ int of_open(const OptionsContext *o, const char *filename)
         exit_program(1);
     }
 
-    err = setup_sync_queues(mux, oc, o->shortest_buf_duration * AV_TIME_BASE);
+    err = setup_sync_queues(mux, oc, o->shortest_buf_duration * AV_TIME_BASE,
+                            o->shortest_buf_size);
     if (err < 0) {
         av_log(NULL, AV_LOG_FATAL, "Error setting up output sync queues\n");
         exit_program(1);
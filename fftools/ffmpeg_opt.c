@@ -52,6 +52,7 @@
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/trace.h"
 
 const char *const opt_name_codec_names[]                      = {"c", "codec", "acodec", "vcodec", "scodec", "dcodec", NULL};
 const char *const opt_name_frame_rates[]                      = {"r", NULL};
@@ -87,7 +88,16 @@ char *filter_nbthreads;
 int filter_complex_nbthreads = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
+int threaded_filtergraphs = 0;
+int filter_pipeline = 0;
+int filter_profile = 0;
+int filter_audio_frame_size = 0;
+int threaded_encoders = 0;
+int threaded_decoders = 0;
+int thread_pool_threads = -1;
+int64_t buffer_cache_size = -1;
 int64_t stats_period = 500000;
+int progress_json = 0;
 
 
 static int file_overwrite     = 0;
@@ -149,6 +159,7 @@ static void init_options(OptionsContext *o)
     o->input_sync_ref = -1;
     o->find_stream_info = 1;
     o->shortest_buf_duration = 10.f;
+    o->shortest_buf_size     = 256 << 20;
 }
 
 static int show_hwaccels(void *optctx, const char *opt, const char *arg)
@@ -906,6 +917,15 @@ static int opt_vstats_file(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_trace_file(void *optctx, const char *opt, const char *arg)
+{
+    int ret = av_trace_open(arg);
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Failed to open trace file '%s': %s\n",
+               arg, av_err2str(ret));
+    return ret;
+}
+
 static int opt_vstats(void *optctx, const char *opt, const char *arg)
 {
     char filename[40];
@@ -1330,6 +1350,19 @@ static int opt_progress(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_progress_format(void *optctx, const char *opt, const char *arg)
+{
+    if (!strcmp(arg, "kv")) {
+        progress_json = 0;
+    } else if (!strcmp(arg, "json")) {
+        progress_json = 1;
+    } else {
+        av_log(NULL, AV_LOG_ERROR, "Unknown progress format '%s'\n", arg);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
 int opt_timelimit(void *optctx, const char *opt, const char *arg)
 {
 #if HAVE_SETRLIMIT
@@ -1426,8 +1459,12 @@ const OptionDef options[] = {
         "add timings for benchmarking" },
     { "benchmark_all",  OPT_BOOL | OPT_EXPERT,                       { &do_benchmark_all },
       "add timings for each task" },
+    { "trace_file",     HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_trace_file },
+      "write a trace of the processing stages to file", "filename" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
+    { "progress_format", HAS_ARG | OPT_EXPERT,                       { .func_arg = opt_progress_format },
+      "set the format of the progress information (kv or json)", "format" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
       "enable or disable interaction on standard input" },
     { "timelimit",      HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_timelimit },
@@ -1462,6 +1499,8 @@ const OptionDef options[] = {
         "finish encoding within shortest input" },
     { "shortest_buf_duration", HAS_ARG | OPT_FLOAT | OPT_EXPERT | OPT_OFFSET | OPT_OUTPUT, { .off = OFFSET(shortest_buf_duration) },
         "maximum buffering duration (in seconds) for the -shortest option" },
+    { "shortest_buf_size", HAS_ARG | OPT_INT64 | OPT_EXPERT | OPT_OFFSET | OPT_OUTPUT, { .off = OFFSET(shortest_buf_size) },
+        "maximum size (in bytes) of the data buffered for the -shortest option, 0 for no limit" },
     { "bitexact",       OPT_BOOL | OPT_EXPERT | OPT_OFFSET |
                         OPT_OUTPUT | OPT_INPUT,                      { .off = OFFSET(bitexact) },
         "bitexact mode" },
@@ -1512,6 +1551,24 @@ const OptionDef options[] = {
         "read complex filtergraph description from a file", "filename" },
     { "auto_conversion_filters", OPT_BOOL | OPT_EXPERT,              { &auto_conversion_filters },
         "enable automatic conversion filters globally" },
+    { "threaded_filtergraphs", OPT_BOOL | OPT_EXPERT,                { &threaded_filtergraphs },
+        "run each filtergraph in a separate thread" },
+    { "filter_pipeline", OPT_BOOL | OPT_EXPERT,                      { &filter_pipeline },
+        "activate the independent filters of a filtergraph concurrently" },
+    { "filter_profile", OPT_BOOL | OPT_EXPERT,                       { &filter_profile },
+        "print the time spent in each filter and the number of frames on each link" },
+    { "filter_audio_frame_size", HAS_ARG | OPT_INT | OPT_EXPERT,     { &filter_audio_frame_size },
+        "merge the decoded audio frames into frames of this number of samples before filtering", "samples" },
+    { "threaded_encoders", OPT_BOOL | OPT_EXPERT,                    { &threaded_encoders },
+        "run each audio/video encoder in a separate thread" },
+    { "threaded_decoders", OPT_BOOL | OPT_EXPERT,                    { &threaded_decoders },
+        "run each audio/video decoder in a separate thread" },
+    { "thread_pool", OPT_INT | HAS_ARG | OPT_EXPERT,                 { &thread_pool_threads },
+        "run the slice threads of codecs, filtergraphs and scalers on a shared pool "
+        "of the given number of threads (0 for one per CPU)", "nb_threads" },
+    { "buffer_cache", OPT_INT64 | HAS_ARG | OPT_EXPERT,              { &buffer_cache_size },
+        "share the video frame buffers of decoders and filtergraphs, keeping at most "
+        "the given number of bytes of unused buffers (0 for no limit)", "size" },
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
     { "stats_period",    HAS_ARG | OPT_EXPERT,                       { .func_arg = opt_stats_period },
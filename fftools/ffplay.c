@@ -43,6 +43,7 @@
 #include "libavutil/samplefmt.h"
 #include "libavutil/time.h"
 #include "libavutil/bprint.h"
+#include "libavutil/hwcontext.h"
 #include "libavformat/avformat.h"
 #include "libavdevice/avdevice.h"
 #include "libswscale/swscale.h"
@@ -95,6 +96,9 @@ const int program_birth_year = 2003;
 #define EXTERNAL_CLOCK_SPEED_MAX  1.010
 #define EXTERNAL_CLOCK_SPEED_STEP 0.001
 
+/* maximum external clock speed used to drain the queues in live mode */
+#define LIVE_CLOCK_SPEED_MAX 1.050
+
 /* we use about AUDIO_DIFF_AVG_NB A-V differences to make the average */
 #define AUDIO_DIFF_AVG_NB   20
 
@@ -340,10 +344,12 @@ static int exit_on_mousedown;
 static int loop = 1;
 static int framedrop = -1;
 static int infinite_buffer = -1;
+static float live_latency = 0;
 static enum ShowMode show_mode = SHOW_MODE_NONE;
 static const char *audio_codec_name;
 static const char *subtitle_codec_name;
 static const char *video_codec_name;
+static const char *hwaccel;
 double rdftspeed = 0.02;
 static int64_t cursor_last_shown;
 static int cursor_hidden = 0;
@@ -390,6 +396,10 @@ static const struct TextureFormatEntry {
     { AV_PIX_FMT_YUV420P,        SDL_PIXELFORMAT_IYUV },
     { AV_PIX_FMT_YUYV422,        SDL_PIXELFORMAT_YUY2 },
     { AV_PIX_FMT_UYVY422,        SDL_PIXELFORMAT_UYVY },
+#if SDL_VERSION_ATLEAST(2,0,16)
+    { AV_PIX_FMT_NV12,           SDL_PIXELFORMAT_NV12 },
+    { AV_PIX_FMT_NV21,           SDL_PIXELFORMAT_NV21 },
+#endif
     { AV_PIX_FMT_NONE,           SDL_PIXELFORMAT_UNKNOWN },
 };
 
@@ -931,6 +941,21 @@ static int upload_texture(SDL_Texture **tex, AVFrame *frame, struct SwsContext *
                 return -1;
             }
             break;
+#if SDL_VERSION_ATLEAST(2,0,16)
+        case SDL_PIXELFORMAT_NV12:
+        case SDL_PIXELFORMAT_NV21:
+            if (frame->linesize[0] > 0 && frame->linesize[1] > 0) {
+                ret = SDL_UpdateNVTexture(*tex, NULL, frame->data[0], frame->linesize[0],
+                                                      frame->data[1], frame->linesize[1]);
+            } else if (frame->linesize[0] < 0 && frame->linesize[1] < 0) {
+                ret = SDL_UpdateNVTexture(*tex, NULL, frame->data[0] + frame->linesize[0] * (frame->height                    - 1), -frame->linesize[0],
+                                                      frame->data[1] + frame->linesize[1] * (AV_CEIL_RSHIFT(frame->height, 1) - 1), -frame->linesize[1]);
+            } else {
+                av_log(NULL, AV_LOG_ERROR, "Mixed negative and positive linesizes are not supported.\n");
+                return -1;
+            }
+            break;
+#endif
         default:
             if (frame->linesize[0] < 0) {
                 ret = SDL_UpdateTexture(*tex, NULL, frame->data[0] + frame->linesize[0] * (frame->height - 1), -frame->linesize[0]);
@@ -946,7 +971,8 @@ static void set_sdl_yuv_conversion_mode(AVFrame *frame)
 {
 #if SDL_VERSION_ATLEAST(2,0,8)
     SDL_YUV_CONVERSION_MODE mode = SDL_YUV_CONVERSION_AUTOMATIC;
-    if (frame && (frame->format == AV_PIX_FMT_YUV420P || frame->format == AV_PIX_FMT_YUYV422 || frame->format == AV_PIX_FMT_UYVY422)) {
+    if (frame && (frame->format == AV_PIX_FMT_YUV420P || frame->format == AV_PIX_FMT_YUYV422 || frame->format == AV_PIX_FMT_UYVY422 ||
+                  frame->format == AV_PIX_FMT_NV12    || frame->format == AV_PIX_FMT_NV21)) {
         if (frame->color_range == AVCOL_RANGE_JPEG)
             mode = SDL_YUV_CONVERSION_JPEG;
         else if (frame->colorspace == AVCOL_SPC_BT709)
@@ -1457,6 +1483,35 @@ static void check_external_clock_speed(VideoState *is) {
    }
 }
 
+/* duration of the demuxed but not yet decoded data, in seconds */
+static double get_queued_duration(VideoState *is)
+{
+    double audio = 0, video = 0;
+
+    if (is->audio_st)
+        audio = is->audioq.duration * av_q2d(is->audio_st->time_base);
+    if (is->video_st)
+        video = is->videoq.duration * av_q2d(is->video_st->time_base);
+    return FFMAX(audio, video);
+}
+
+/* live mode: play slightly faster while more than the target latency is
+ * queued and slightly slower when the queues are about to run dry */
+static void check_live_latency(VideoState *is) {
+    double queued = get_queued_duration(is);
+    double speed  = is->extclk.speed;
+
+    if (queued > live_latency) {
+        set_clock_speed(&is->extclk, FFMIN(LIVE_CLOCK_SPEED_MAX, speed + EXTERNAL_CLOCK_SPEED_STEP));
+    } else if (queued < live_latency / 2 &&
+               (is->video_stream < 0 || is->videoq.nb_packets <= EXTERNAL_CLOCK_MIN_FRAMES) &&
+               (is->audio_stream < 0 || is->audioq.nb_packets <= EXTERNAL_CLOCK_MIN_FRAMES)) {
+        set_clock_speed(&is->extclk, FFMAX(EXTERNAL_CLOCK_SPEED_MIN, speed - EXTERNAL_CLOCK_SPEED_STEP));
+    } else if (speed != 1.0) {
+        set_clock_speed(&is->extclk, speed + EXTERNAL_CLOCK_SPEED_STEP * (1.0 - speed) / fabs(1.0 - speed));
+    }
+}
+
 /* seek in the stream */
 static void stream_seek(VideoState *is, int64_t pos, int64_t rel, int by_bytes)
 {
@@ -1567,8 +1622,12 @@ static void video_refresh(void *opaque, double *remaining_time)
 
     Frame *sp, *sp2;
 
-    if (!is->paused && get_master_sync_type(is) == AV_SYNC_EXTERNAL_CLOCK && is->realtime)
-        check_external_clock_speed(is);
+    if (!is->paused && get_master_sync_type(is) == AV_SYNC_EXTERNAL_CLOCK) {
+        if (live_latency > 0)
+            check_live_latency(is);
+        else if (is->realtime)
+            check_external_clock_speed(is);
+    }
 
     if (!display_disable && is->show_mode != SHOW_MODE_VIDEO && is->audio_st) {
         time = av_gettime_relative() / 1000000.0;
@@ -1705,7 +1764,7 @@ display:
 
             av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
             av_bprintf(&buf,
-                      "%7.2f %s:%7.3f fd=%4d aq=%5dKB vq=%5dKB sq=%5dB f=%"PRId64"/%"PRId64"   \r",
+                      "%7.2f %s:%7.3f fd=%4d aq=%5dKB vq=%5dKB sq=%5dB f=%"PRId64"/%"PRId64"   ",
                       get_master_clock(is),
                       (is->audio_st && is->video_st) ? "A-V" : (is->video_st ? "M-V" : (is->audio_st ? "M-A" : "   ")),
                       av_diff,
@@ -1716,6 +1775,11 @@ display:
                       is->video_st ? is->viddec.avctx->pts_correction_num_faulty_dts : 0,
                       is->video_st ? is->viddec.avctx->pts_correction_num_faulty_pts : 0);
 
+            if (live_latency > 0)
+                av_bprintf(&buf, "lq=%6.3fs spd=%5.3f   ",
+                           get_queued_duration(is), is->extclk.speed);
+            av_bprintf(&buf, "\r");
+
             if (show_status == 1 && AV_LOG_INFO > av_log_get_level())
                 fprintf(stderr, "%s", buf.str);
             else
@@ -1760,6 +1824,30 @@ static int queue_picture(VideoState *is, AVFrame *src_frame, double pts, double
     return 0;
 }
 
+static int hwaccel_retrieve_frame(AVFrame *frame)
+{
+    AVFrame *sw_frame = av_frame_alloc();
+    int ret;
+
+    if (!sw_frame)
+        return AVERROR(ENOMEM);
+
+    /* the first transfer format is the native one (usually NV12), which can
+     * be uploaded to the texture without any conversion */
+    ret = av_hwframe_transfer_data(sw_frame, frame, 0);
+    if (ret < 0)
+        goto fail;
+    ret = av_frame_copy_props(sw_frame, frame);
+    if (ret < 0)
+        goto fail;
+
+    av_frame_unref(frame);
+    av_frame_move_ref(frame, sw_frame);
+fail:
+    av_frame_free(&sw_frame);
+    return ret;
+}
+
 static int get_video_frame(VideoState *is, AVFrame *frame)
 {
     int got_picture;
@@ -1767,6 +1855,15 @@ static int get_video_frame(VideoState *is, AVFrame *frame)
     if ((got_picture = decoder_decode_frame(&is->viddec, frame, NULL)) < 0)
         return -1;
 
+    if (got_picture && frame->hw_frames_ctx) {
+        int ret = hwaccel_retrieve_frame(frame);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Failed to retrieve hardware frame: %s\n", av_err2str(ret));
+            av_frame_unref(frame);
+            got_picture = 0;
+        }
+    }
+
     if (got_picture) {
         double dpts = NAN;
 
@@ -2612,6 +2709,19 @@ static int stream_component_open(VideoState *is, int stream_index)
     if (fast)
         avctx->flags2 |= AV_CODEC_FLAG2_FAST;
 
+    if (hwaccel && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        enum AVHWDeviceType type = av_hwdevice_find_type_by_name(hwaccel);
+        if (type == AV_HWDEVICE_TYPE_NONE) {
+            av_log(NULL, AV_LOG_ERROR, "Unknown hwaccel '%s'\n", hwaccel);
+            ret = AVERROR(EINVAL);
+            goto fail;
+        }
+        if ((ret = av_hwdevice_ctx_create(&avctx->hw_device_ctx, type, NULL, NULL, 0)) < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Failed to create %s device: %s\n", hwaccel, av_err2str(ret));
+            goto fail;
+        }
+    }
+
     opts = filter_codec_opts(codec_opts, avctx->codec_id, ic, ic->streams[stream_index], codec);
     if (!av_dict_get(opts, "threads", NULL, 0))
         av_dict_set(&opts, "threads", "auto", 0);
@@ -2782,6 +2892,11 @@ static int read_thread(void *arg)
     }
     ic->interrupt_callback.callback = decode_interrupt_cb;
     ic->interrupt_callback.opaque = is;
+    if (live_latency > 0) {
+        /* do not wait for the probing and demuxer buffering of live sources */
+        av_dict_set(&format_opts, "fflags", "nobuffer", AV_DICT_DONT_OVERWRITE);
+        av_dict_set_int(&format_opts, "analyzeduration", FFMAX(1, (int64_t)(live_latency * AV_TIME_BASE)), AV_DICT_DONT_OVERWRITE);
+    }
     if (!av_dict_get(format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
         av_dict_set(&format_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
         scan_all_pmts_set = 1;
@@ -2924,7 +3039,7 @@ static int read_thread(void *arg)
         goto fail;
     }
 
-    if (infinite_buffer < 0 && is->realtime)
+    if (infinite_buffer < 0 && (is->realtime || live_latency > 0))
         infinite_buffer = 1;
 
     for (;;) {
@@ -3118,7 +3233,7 @@ static VideoState *stream_open(const char *filename,
     startup_volume = av_clip(SDL_MIX_MAXVOLUME * startup_volume / 100, 0, SDL_MIX_MAXVOLUME);
     is->audio_volume = startup_volume;
     is->muted = 0;
-    is->av_sync_type = av_sync_type;
+    is->av_sync_type = live_latency > 0 ? AV_SYNC_EXTERNAL_CLOCK : av_sync_type;
     is->read_tid     = SDL_CreateThread(read_thread, "read_thread", is);
     if (!is->read_tid) {
         av_log(NULL, AV_LOG_FATAL, "SDL_CreateThread(): %s\n", SDL_GetError());
@@ -3597,6 +3712,7 @@ static const OptionDef options[] = {
     { "loop", OPT_INT | HAS_ARG | OPT_EXPERT, { &loop }, "set number of times the playback shall be looped", "loop count" },
     { "framedrop", OPT_BOOL | OPT_EXPERT, { &framedrop }, "drop frames when cpu is too slow", "" },
     { "infbuf", OPT_BOOL | OPT_EXPERT, { &infinite_buffer }, "don't limit the input buffer size (useful with realtime streams)", "" },
+    { "latency", OPT_FLOAT | HAS_ARG | OPT_EXPERT, { &live_latency }, "enable low latency live mode with the given target queue duration", "seconds" },
     { "window_title", OPT_STRING | HAS_ARG, { &window_title }, "set window title", "window title" },
     { "left", OPT_INT | HAS_ARG | OPT_EXPERT, { &screen_left }, "set the x position for the left of the window", "x pos" },
     { "top", OPT_INT | HAS_ARG | OPT_EXPERT, { &screen_top }, "set the y position for the top of the window", "y pos" },
@@ -3611,6 +3727,7 @@ static const OptionDef options[] = {
     { "acodec", HAS_ARG | OPT_STRING | OPT_EXPERT, {    &audio_codec_name }, "force audio decoder",    "decoder_name" },
     { "scodec", HAS_ARG | OPT_STRING | OPT_EXPERT, { &subtitle_codec_name }, "force subtitle decoder", "decoder_name" },
     { "vcodec", HAS_ARG | OPT_STRING | OPT_EXPERT, {    &video_codec_name }, "force video decoder",    "decoder_name" },
+    { "hwaccel", HAS_ARG | OPT_STRING | OPT_EXPERT, { &hwaccel }, "use HW accelerated video decoding", "hwaccel_name" },
     { "autorotate", OPT_BOOL, { &autorotate }, "automatically rotate video", "" },
     { "find_stream_info", OPT_BOOL | OPT_INPUT | OPT_EXPERT, { &find_stream_info },
         "read and decode the streams to fill missing information with heuristics" },
@@ -103,6 +103,7 @@ static int do_show_chapters = 0;
 static int do_show_error   = 0;
 static int do_show_format  = 0;
 static int do_show_frames  = 0;
+static int do_show_index   = 0;
 static int do_show_packets = 0;
 static int do_show_programs = 0;
 static int do_show_streams = 0;
@@ -152,7 +153,7 @@ static int find_stream_info  = 1;
 
 /* section structure definition */
 
-#define SECTION_MAX_NB_CHILDREN 10
+#define SECTION_MAX_NB_CHILDREN 11
 
 struct section {
     int id;             ///< unique id identifying a section
@@ -191,6 +192,8 @@ typedef enum {
     SECTION_ID_FRAME_SIDE_DATA_PIECE,
     SECTION_ID_FRAME_LOG,
     SECTION_ID_FRAME_LOGS,
+    SECTION_ID_INDEX,
+    SECTION_ID_INDEX_ENTRY,
     SECTION_ID_LIBRARY_VERSION,
     SECTION_ID_LIBRARY_VERSIONS,
     SECTION_ID_PACKET,
@@ -242,6 +245,8 @@ static struct section sections[] = {
     [SECTION_ID_FRAME_SIDE_DATA_PIECE] =        { SECTION_ID_FRAME_SIDE_DATA_PIECE, "section", 0, { -1 } },
     [SECTION_ID_FRAME_LOGS] =         { SECTION_ID_FRAME_LOGS, "logs", SECTION_FLAG_IS_ARRAY, { SECTION_ID_FRAME_LOG, -1 } },
     [SECTION_ID_FRAME_LOG] =          { SECTION_ID_FRAME_LOG, "log", 0, { -1 },  },
+    [SECTION_ID_INDEX] =              { SECTION_ID_INDEX, "index", SECTION_FLAG_IS_ARRAY, { SECTION_ID_INDEX_ENTRY, -1 } },
+    [SECTION_ID_INDEX_ENTRY] =        { SECTION_ID_INDEX_ENTRY, "index_entry", 0, { -1 } },
     [SECTION_ID_LIBRARY_VERSIONS] =   { SECTION_ID_LIBRARY_VERSIONS, "library_versions", SECTION_FLAG_IS_ARRAY, { SECTION_ID_LIBRARY_VERSION, -1 } },
     [SECTION_ID_LIBRARY_VERSION] =    { SECTION_ID_LIBRARY_VERSION, "library_version", 0, { -1 } },
     [SECTION_ID_PACKETS] =            { SECTION_ID_PACKETS, "packets", SECTION_FLAG_IS_ARRAY, { SECTION_ID_PACKET, -1} },
@@ -266,7 +271,7 @@ static struct section sections[] = {
     [SECTION_ID_ROOT] =               { SECTION_ID_ROOT, "root", SECTION_FLAG_IS_WRAPPER,
                                         { SECTION_ID_CHAPTERS, SECTION_ID_FORMAT, SECTION_ID_FRAMES, SECTION_ID_PROGRAMS, SECTION_ID_STREAMS,
                                           SECTION_ID_PACKETS, SECTION_ID_ERROR, SECTION_ID_PROGRAM_VERSION, SECTION_ID_LIBRARY_VERSIONS,
-                                          SECTION_ID_PIXEL_FORMATS, -1} },
+                                          SECTION_ID_PIXEL_FORMATS, SECTION_ID_INDEX, -1} },
     [SECTION_ID_STREAMS] =            { SECTION_ID_STREAMS, "streams", SECTION_FLAG_IS_ARRAY, { SECTION_ID_STREAM, -1 } },
     [SECTION_ID_STREAM] =             { SECTION_ID_STREAM, "stream", 0, { SECTION_ID_STREAM_DISPOSITION, SECTION_ID_STREAM_TAGS, SECTION_ID_STREAM_SIDE_DATA_LIST, -1 } },
     [SECTION_ID_STREAM_DISPOSITION] = { SECTION_ID_STREAM_DISPOSITION, "disposition", 0, { -1 }, .unique_name = "stream_disposition" },
@@ -759,12 +764,22 @@ static inline void writer_print_section_footer(WriterContext *wctx)
     wctx->level--;
 }
 
-static inline void writer_print_integer(WriterContext *wctx,
-                                        const char *key, long long int val)
+/**
+ * Return nonzero if the entry key of the current section is to be shown.
+ * Callers formatting a value before printing it use this to skip the
+ * formatting of the entries which are not shown.
+ */
+static inline int writer_shows_entry(WriterContext *wctx, const char *key)
 {
     const struct section *section = wctx->section[wctx->level];
 
-    if (section->show_all_entries || av_dict_get(section->entries_to_show, key, NULL, 0)) {
+    return section->show_all_entries || av_dict_get(section->entries_to_show, key, NULL, 0);
+}
+
+static inline void writer_print_integer(WriterContext *wctx,
+                                        const char *key, long long int val)
+{
+    if (writer_shows_entry(wctx, key)) {
         wctx->writer->print_integer(wctx, key, val);
         wctx->nb_item[wctx->level]++;
     }
@@ -840,7 +855,7 @@ static inline int writer_print_string(WriterContext *wctx,
         && !(wctx->writer->flags & WRITER_FLAG_DISPLAY_OPTIONAL_FIELDS)))
         return 0;
 
-    if (section->show_all_entries || av_dict_get(section->entries_to_show, key, NULL, 0)) {
+    if (writer_shows_entry(wctx, key)) {
         if (flags & PRINT_STRING_VALIDATE) {
             char *key1 = NULL, *val1 = NULL;
             ret = validate_string(wctx, &key1, key);
@@ -870,6 +885,9 @@ static inline void writer_print_rational(WriterContext *wctx,
                                          const char *key, AVRational q, char sep)
 {
     AVBPrint buf;
+
+    if (!writer_shows_entry(wctx, key))
+        return;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
     av_bprintf(&buf, "%d%c%d", q.num, sep, q.den);
     writer_print_string(wctx, key, buf.str, 0);
@@ -880,6 +898,8 @@ static void writer_print_time(WriterContext *wctx, const char *key,
 {
     char buf[128];
 
+    if (!writer_shows_entry(wctx, key))
+        return;
     if ((!is_duration && ts == AV_NOPTS_VALUE) || (is_duration && ts == 0)) {
         writer_print_string(wctx, key, "N/A", PRINT_STRING_OPT);
     } else {
@@ -907,6 +927,8 @@ static void writer_print_data(WriterContext *wctx, const char *name,
     AVBPrint bp;
     int offset = 0, l, i;
 
+    if (!writer_shows_entry(wctx, name))
+        return;
     av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
     av_bprintf(&bp, "\n");
     while (size) {
@@ -934,7 +956,7 @@ static void writer_print_data_hash(WriterContext *wctx, const char *name,
 {
     char *p, buf[AV_HASH_MAX_SIZE * 2 + 64] = { 0 };
 
-    if (!hash)
+    if (!hash || !writer_shows_entry(wctx, name))
         return;
     av_hash_init(hash);
     av_hash_update(hash, data, size);
@@ -951,6 +973,8 @@ static void writer_print_integers(WriterContext *wctx, const char *name,
     AVBPrint bp;
     int offset = 0, l, i;
 
+    if (!writer_shows_entry(wctx, name))
+        return;
     av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
     av_bprintf(&bp, "\n");
     while (size) {
@@ -1892,12 +1916,16 @@ static void writer_register_all(void)
 }
 
 #define print_fmt(k, f, ...) do {              \
+    if (!writer_shows_entry(w, k))             \
+        break;                                 \
     av_bprint_clear(&pbuf);                    \
     av_bprintf(&pbuf, f, __VA_ARGS__);         \
     writer_print_string(w, k, pbuf.str, 0);    \
 } while (0)
 
 #define print_list_fmt(k, f, n, m, ...) do {    \
+    if (!writer_shows_entry(w, k))              \
+        break;                                  \
     av_bprint_clear(&pbuf);                     \
     for (int idx = 0; idx < n; idx++) {         \
         for (int idx2 = 0; idx2 < m; idx2++) {  \
@@ -1920,6 +1948,8 @@ static void writer_register_all(void)
 #define print_duration_ts(k, v)       writer_print_ts(w, k, v, 1)
 #define print_val(k, v, u) do {                                     \
     struct unit_value uv;                                           \
+    if (!writer_shows_entry(w, k))                                  \
+        break;                                                      \
     uv.val.i = v;                                                   \
     uv.unit = u;                                                    \
     writer_print_string(w, k, value_string(val_str, sizeof(val_str), uv), 0); \
@@ -3248,6 +3278,41 @@ static int show_chapters(WriterContext *w, InputFile *ifile)
     return ret;
 }
 
+static int show_index(WriterContext *w, InputFile *ifile)
+{
+    AVFormatContext *fmt_ctx = ifile->fmt_ctx;
+    char val_str[128], flags[3];
+
+    writer_print_section_header(w, SECTION_ID_INDEX);
+    for (int i = 0; i < fmt_ctx->nb_streams; i++) {
+        AVStream *st = fmt_ctx->streams[i];
+        int nb_entries = avformat_index_get_entries_count(st);
+
+        if (!selected_streams[i])
+            continue;
+
+        for (int j = 0; j < nb_entries; j++) {
+            const AVIndexEntry *e = avformat_index_get_entry(st, j);
+
+            writer_print_section_header(w, SECTION_ID_INDEX_ENTRY);
+            print_int("stream_index", i);
+            print_ts  ("timestamp",      e->timestamp);
+            print_time("timestamp_time", e->timestamp, &st->time_base);
+            print_int("pos", e->pos);
+            if (e->size) print_val    ("size", e->size, unit_byte_str);
+            else         print_str_opt("size", "N/A");
+            flags[0] = e->flags & AVINDEX_KEYFRAME      ? 'K' : '_';
+            flags[1] = e->flags & AVINDEX_DISCARD_FRAME ? 'D' : '_';
+            flags[2] = 0;
+            print_str("flags", flags);
+            writer_print_section_footer(w);
+        }
+    }
+    writer_print_section_footer(w);
+
+    return 0;
+}
+
 static int show_format(WriterContext *w, InputFile *ifile)
 {
     AVFormatContext *fmt_ctx = ifile->fmt_ctx;
@@ -3380,6 +3445,9 @@ static int open_input_file(InputFile *ifile, const char *filename,
                 // the log information would need to be reordered and matches up to contexts and frames
                 // That is in fact possible but not trivial
                 av_dict_set(&codec_opts, "threads", "1", 0);
+            } else if (!av_dict_get(opts, "threads", NULL, 0)) {
+                // decode with all the available cores, as ffmpeg does
+                av_dict_set(&opts, "threads", "auto", 0);
             }
 
             ist->dec_ctx->pkt_timebase = stream->time_base;
@@ -3482,6 +3550,10 @@ static int probe_file(WriterContext *wctx, const char *filename,
         ret = show_chapters(wctx, &ifile);
         CHECK_END;
     }
+    if (do_show_index) {
+        ret = show_index(wctx, &ifile);
+        CHECK_END;
+    }
     if (do_show_format) {
         ret = show_format(wctx, &ifile);
         CHECK_END;
@@ -3956,6 +4028,7 @@ DEFINE_OPT_SHOW_SECTION(chapters,         CHAPTERS)
 DEFINE_OPT_SHOW_SECTION(error,            ERROR)
 DEFINE_OPT_SHOW_SECTION(format,           FORMAT)
 DEFINE_OPT_SHOW_SECTION(frames,           FRAMES)
+DEFINE_OPT_SHOW_SECTION(index,            INDEX)
 DEFINE_OPT_SHOW_SECTION(library_versions, LIBRARY_VERSIONS)
 DEFINE_OPT_SHOW_SECTION(packets,          PACKETS)
 DEFINE_OPT_SHOW_SECTION(pixel_formats,    PIXEL_FORMATS)
@@ -3993,6 +4066,7 @@ static const OptionDef real_options[] = {
     { "show_programs", 0, { .func_arg = &opt_show_programs }, "show programs info" },
     { "show_streams", 0, { .func_arg = &opt_show_streams }, "show streams info" },
     { "show_chapters", 0, { .func_arg = &opt_show_chapters }, "show chapters info" },
+    { "show_index", 0, { .func_arg = &opt_show_index }, "show the seek index entries of the selected streams" },
     { "count_frames", OPT_BOOL, { &do_count_frames }, "count the number of frames per stream" },
     { "count_packets", OPT_BOOL, { &do_count_packets }, "count the number of packets per stream" },
     { "show_program_version",  0, { .func_arg = &opt_show_program_version },  "show ffprobe version" },
@@ -4066,6 +4140,7 @@ int main(int argc, char **argv)
     SET_DO_SHOW(ERROR, error);
     SET_DO_SHOW(FORMAT, format);
     SET_DO_SHOW(FRAMES, frames);
+    SET_DO_SHOW(INDEX, index);
     SET_DO_SHOW(LIBRARY_VERSIONS, library_versions);
     SET_DO_SHOW(PACKETS, packets);
     SET_DO_SHOW(PIXEL_FORMATS, pixel_formats);
@@ -4147,7 +4222,7 @@ int main(int argc, char **argv)
             ffprobe_show_pixel_formats(wctx);
 
         if (!input_filename &&
-            ((do_show_format || do_show_programs || do_show_streams || do_show_chapters || do_show_packets || do_show_error) ||
+            ((do_show_format || do_show_programs || do_show_streams || do_show_chapters || do_show_index || do_show_packets || do_show_error) ||
              (!do_show_program_version && !do_show_library_versions && !do_show_pixel_formats))) {
             show_usage();
             av_log(NULL, AV_LOG_ERROR, "You have to specify one input file.\n");
@@ -20,7 +20,17 @@
 
 #include "config.h"
 
+#if HAVE_SCHED_GETAFFINITY
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+#include <sched.h>
+#endif
+
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "cmdutils.h"
 #include "opt_common.h"
@@ -520,6 +530,8 @@ static void show_help_filter(const char *name)
 
     if (f->flags & AVFILTER_FLAG_SLICE_THREADS)
         printf("    slice threading supported\n");
+    if (f->flags & AVFILTER_FLAG_FRAME_THREADS)
+        printf("    frame threading supported\n");
 
     printf("    Inputs:\n");
     count = avfilter_filter_pad_count(f, 0);
@@ -1082,6 +1094,90 @@ int opt_cpucount(void *optctx, const char *opt, const char *arg)
     return ret;
 }
 
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+static int parse_cpu_list(const char *list, cpu_set_t *set)
+{
+    const char *p = list;
+
+    CPU_ZERO(set);
+    while (*p) {
+        char *end;
+        long first, last;
+
+        first = last = strtol(p, &end, 10);
+        if (end == p)
+            return AVERROR(EINVAL);
+        p = end;
+        if (*p == '-') {
+            last = strtol(++p, &end, 10);
+            if (end == p)
+                return AVERROR(EINVAL);
+            p = end;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE)
+            return AVERROR(EINVAL);
+        for (long i = first; i <= last; i++)
+            CPU_SET(i, set);
+
+        p += strspn(p, " \n");
+        if (*p == ',')
+            p++;
+        else if (*p)
+            return AVERROR(EINVAL);
+    }
+
+    return CPU_COUNT(set) ? 0 : AVERROR(EINVAL);
+}
+#endif
+
+int opt_cpuaffinity(void *optctx, const char *opt, const char *arg)
+{
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+    char node_cpus[4096];
+    const char *list = arg;
+    cpu_set_t set;
+    int ret;
+
+    if (av_strstart(arg, "node:", &list)) {
+        char path[64];
+        FILE *f;
+        size_t len;
+        int node = strtol(list, NULL, 10);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        f = fopen(path, "r");
+        if (!f) {
+            av_log(NULL, AV_LOG_ERROR, "Cannot get the CPUs of NUMA node %s\n", list);
+            return AVERROR(errno);
+        }
+        len = fread(node_cpus, 1, sizeof(node_cpus) - 1, f);
+        fclose(f);
+        node_cpus[len] = 0;
+        list = node_cpus;
+    }
+
+    ret = parse_cpu_list(list, &set);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid CPU list '%s'\n", arg);
+        return ret;
+    }
+
+    /* Threads inherit the affinity of the thread creating them, so setting
+     * it before any thread is started applies it to the whole process. */
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        ret = AVERROR(errno);
+        av_log(NULL, AV_LOG_ERROR, "Cannot set the CPU affinity: %s\n",
+               av_err2str(ret));
+        return ret;
+    }
+
+    return 0;
+#else
+    av_log(NULL, AV_LOG_ERROR, "Setting the CPU affinity is not supported on this platform\n");
+    return AVERROR(ENOSYS);
+#endif
+}
+
 static void expand_filename_template(AVBPrint *bp, const char *template,
                                      struct tm *tm)
 {
@@ -35,9 +35,15 @@ typedef struct SyncQueueStream {
     /* stream head: largest timestamp seen */
     int64_t          head_ts;
     int              limiting;
+    /* the stream has large gaps between frames, its head timestamp is
+     * advanced by heartbeats from the other streams */
+    int              sparse;
     /* no more frames will be sent for this stream */
     int              finished;
 
+    /* size of the buffered frame data in bytes */
+    size_t           bytes;
+
     uint64_t         frames_sent;
     uint64_t         frames_max;
 } SyncQueueStream;
@@ -55,6 +61,10 @@ struct SyncQueue {
 
     // maximum buffering duration in microseconds
     int64_t buf_size_us;
+    // maximum size of the buffered frame data in bytes, 0 for no limit
+    size_t  buf_size_bytes;
+    // size of the frame data currently buffered in all streams
+    size_t  bytes;
 
     SyncQueueStream *streams;
     unsigned int  nb_streams;
@@ -79,6 +89,21 @@ static int64_t frame_ts(const SyncQueue *sq, SyncQueueFrame frame)
            frame.f->pts + frame.f->duration;
 }
 
+static size_t frame_size(const SyncQueue *sq, SyncQueueFrame frame)
+{
+    size_t size = 0;
+
+    if (sq->type == SYNC_QUEUE_PACKETS)
+        return frame.p->size;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame.f->buf) && frame.f->buf[i]; i++)
+        size += frame.f->buf[i]->size;
+    for (int i = 0; i < frame.f->nb_extended_buf; i++)
+        size += frame.f->extended_buf[i]->size;
+
+    return size;
+}
+
 static int frame_null(const SyncQueue *sq, SyncQueueFrame frame)
 {
     return (sq->type == SYNC_QUEUE_PACKETS) ? (frame.p == NULL) : (frame.f == NULL);
@@ -168,38 +193,17 @@ static void stream_update_ts(SyncQueue *sq, unsigned int stream_idx, int64_t ts)
         queue_head_update(sq);
 }
 
-/* If the queue for the given stream (or all streams when stream_idx=-1)
- * is overflowing, trigger a fake heartbeat on lagging streams.
+/* Signal a fake timestamp for all streams that prevent the tail of the given
+ * stream from being output, if the stream is overflowing or force is set.
  *
  * @return 1 if heartbeat triggered, 0 otherwise
  */
-static int overflow_heartbeat(SyncQueue *sq, int stream_idx)
+static int stream_heartbeat(SyncQueue *sq, unsigned int stream_idx, int force)
 {
-    SyncQueueStream *st;
+    SyncQueueStream *st = &sq->streams[stream_idx];
     SyncQueueFrame frame;
     int64_t tail_ts = AV_NOPTS_VALUE;
 
-    /* if no stream specified, pick the one that is most ahead */
-    if (stream_idx < 0) {
-        int64_t ts = AV_NOPTS_VALUE;
-
-        for (int i = 0; i < sq->nb_streams; i++) {
-            st = &sq->streams[i];
-            if (st->head_ts != AV_NOPTS_VALUE &&
-                (ts == AV_NOPTS_VALUE ||
-                 av_compare_ts(ts, sq->streams[stream_idx].tb,
-                               st->head_ts, st->tb) < 0)) {
-                ts = st->head_ts;
-                stream_idx = i;
-            }
-        }
-        /* no stream has a timestamp yet -> nothing to do */
-        if (stream_idx < 0)
-            return 0;
-    }
-
-    st = &sq->streams[stream_idx];
-
     /* get the chosen stream's tail timestamp */
     for (size_t i = 0; tail_ts == AV_NOPTS_VALUE &&
                        av_fifo_peek(st->fifo, &frame, 1, i) >= 0; i++)
@@ -207,7 +211,8 @@ static int overflow_heartbeat(SyncQueue *sq, int stream_idx)
 
     /* overflow triggers when the tail is over specified duration behind the head */
     if (tail_ts == AV_NOPTS_VALUE || tail_ts >= st->head_ts ||
-        av_rescale_q(st->head_ts - tail_ts, st->tb, AV_TIME_BASE_Q) < sq->buf_size_us)
+        (!force &&
+         av_rescale_q(st->head_ts - tail_ts, st->tb, AV_TIME_BASE_Q) < sq->buf_size_us))
         return 0;
 
     /* signal a fake timestamp for all streams that prevent tail_ts from being output */
@@ -231,11 +236,81 @@ static int overflow_heartbeat(SyncQueue *sq, int stream_idx)
     return 1;
 }
 
+/* If the queue for the given stream (or any stream when stream_idx=-1)
+ * is overflowing, trigger a fake heartbeat on lagging streams.
+ *
+ * @return 1 if heartbeat triggered, 0 otherwise
+ */
+static int overflow_heartbeat(SyncQueue *sq, int stream_idx)
+{
+    int ret = 0;
+
+    /* when over the memory limit, unblock the stream holding the most data */
+    if (sq->buf_size_bytes && sq->bytes >= sq->buf_size_bytes) {
+        unsigned int largest = 0;
+
+        if (stream_idx < 0) {
+            for (unsigned int i = 1; i < sq->nb_streams; i++)
+                if (sq->streams[i].bytes > sq->streams[largest].bytes)
+                    largest = i;
+        } else
+            largest = stream_idx;
+
+        if (stream_heartbeat(sq, largest, 1))
+            return 1;
+    }
+
+    if (stream_idx >= 0)
+        return stream_heartbeat(sq, stream_idx, 0);
+
+    /* every stream is subject to the duration limit */
+    for (unsigned int i = 0; i < sq->nb_streams; i++)
+        ret |= stream_heartbeat(sq, i, 0);
+
+    return ret;
+}
+
+/* Advance the sparse streams to the position of the slowest regular stream,
+ * so that they do not hold back the output while there is nothing to send
+ * for them.
+ */
+static void sparse_heartbeat(SyncQueue *sq)
+{
+    const SyncQueueStream *st_min = NULL;
+
+    for (unsigned int i = 0; i < sq->nb_streams; i++) {
+        const SyncQueueStream *st = &sq->streams[i];
+
+        if (st->sparse || !st->limiting || st->finished)
+            continue;
+        /* wait for all regular streams to have a timestamp */
+        if (st->head_ts == AV_NOPTS_VALUE)
+            return;
+        if (!st_min ||
+            av_compare_ts(st->head_ts, st->tb, st_min->head_ts, st_min->tb) < 0)
+            st_min = st;
+    }
+    if (!st_min)
+        return;
+
+    for (unsigned int i = 0; i < sq->nb_streams; i++) {
+        const SyncQueueStream *st = &sq->streams[i];
+
+        if (!st->sparse || st->finished ||
+            (st->head_ts != AV_NOPTS_VALUE &&
+             av_compare_ts(st_min->head_ts, st_min->tb, st->head_ts, st->tb) <= 0))
+            continue;
+
+        stream_update_ts(sq, i, av_rescale_q(st_min->head_ts, st_min->tb, st->tb));
+    }
+}
+
 int sq_send(SyncQueue *sq, unsigned int stream_idx, SyncQueueFrame frame)
 {
     SyncQueueStream *st;
     SyncQueueFrame dst;
     int64_t ts;
+    size_t size;
     int ret;
 
     av_assert0(stream_idx < sq->nb_streams);
@@ -256,7 +331,8 @@ int sq_send(SyncQueue *sq, unsigned int stream_idx, SyncQueueFrame frame)
 
     frame_move(sq, dst, frame);
 
-    ts = frame_ts(sq, dst);
+    ts   = frame_ts(sq, dst);
+    size = frame_size(sq, dst);
 
     ret = av_fifo_write(st->fifo, &dst, 1);
     if (ret < 0) {
@@ -265,7 +341,12 @@ int sq_send(SyncQueue *sq, unsigned int stream_idx, SyncQueueFrame frame)
         return ret;
     }
 
+    st->bytes += size;
+    sq->bytes += size;
+
     stream_update_ts(sq, stream_idx, ts);
+    if (!st->sparse)
+        sparse_heartbeat(sq);
 
     st->frames_sent++;
     if (st->frames_sent >= st->frames_max)
@@ -301,6 +382,11 @@ static int receive_for_stream(SyncQueue *sq, unsigned int stream_idx,
          * Frames with no timestamps are just passed through with no conditions.
          */
         if (cmp <= 0 || ts == AV_NOPTS_VALUE) {
+            size_t size = frame_size(sq, peek);
+
+            st->bytes -= size;
+            sq->bytes -= size;
+
             frame_move(sq, frame, peek);
             objpool_release(sq->pool, (void**)&peek);
             av_fifo_drain2(st->fifo, 1);
@@ -348,7 +434,7 @@ int sq_receive(SyncQueue *sq, int stream_idx, SyncQueueFrame frame)
     return ret;
 }
 
-int sq_add_stream(SyncQueue *sq, int limiting)
+int sq_add_stream(SyncQueue *sq, int limiting, int sparse)
 {
     SyncQueueStream *tmp, *st;
 
@@ -371,6 +457,7 @@ int sq_add_stream(SyncQueue *sq, int limiting)
     st->head_ts = AV_NOPTS_VALUE;
     st->frames_max = UINT64_MAX;
     st->limiting   = limiting;
+    st->sparse     = sparse;
 
     return sq->nb_streams++;
 }
@@ -402,7 +489,8 @@ void sq_limit_frames(SyncQueue *sq, unsigned int stream_idx, uint64_t frames)
         finish_stream(sq, stream_idx);
 }
 
-SyncQueue *sq_alloc(enum SyncQueueType type, int64_t buf_size_us)
+SyncQueue *sq_alloc(enum SyncQueueType type, int64_t buf_size_us,
+                    size_t buf_size_bytes)
 {
     SyncQueue *sq = av_mallocz(sizeof(*sq));
 
@@ -411,6 +499,7 @@ SyncQueue *sq_alloc(enum SyncQueueType type, int64_t buf_size_us)
 
     sq->type                 = type;
     sq->buf_size_us          = buf_size_us;
+    sq->buf_size_bytes       = buf_size_bytes;
 
     sq->head_stream          = -1;
     sq->head_finished_stream = -1;
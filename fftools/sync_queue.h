@@ -44,8 +44,11 @@ typedef struct SyncQueue SyncQueue;
  * Allocate a sync queue of the given type.
  *
  * @param buf_size_us maximum duration that will be buffered in microseconds
+ * @param buf_size_bytes maximum size of the buffered frame data in bytes,
+ *                       0 for no limit
  */
-SyncQueue *sq_alloc(enum SyncQueueType type, int64_t buf_size_us);
+SyncQueue *sq_alloc(enum SyncQueueType type, int64_t buf_size_us,
+                    size_t buf_size_bytes);
 void       sq_free(SyncQueue **sq);
 
 /**
@@ -53,11 +56,15 @@ void       sq_free(SyncQueue **sq);
  *
  * @param limiting whether the stream is limiting, i.e. no other stream can be
  *                 longer than this one
+ * @param sparse whether the stream has large gaps between frames (e.g.
+ *               subtitles); such streams do not hold back the output of the
+ *               other streams, their position is assumed to follow the
+ *               slowest non-sparse stream until they receive a later frame
  * @return
  * - a non-negative stream index on success
  * - a negative error code on error
  */
-int sq_add_stream(SyncQueue *sq, int limiting);
+int sq_add_stream(SyncQueue *sq, int limiting, int sparse);
 
 /**
  * Set the timebase for the stream with index stream_idx. Should be called
@@ -50,6 +50,8 @@ struct ThreadQueue {
 
     pthread_mutex_t lock;
     pthread_cond_t  cond;
+    /* number of threads sleeping on cond */
+    unsigned int    nb_waiting;
 };
 
 void tq_free(ThreadQueue **ptq)
@@ -132,8 +134,11 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
         goto finish;
     }
 
-    while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo))
+    while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo)) {
+        tq->nb_waiting++;
         pthread_cond_wait(&tq->cond, &tq->lock);
+        tq->nb_waiting--;
+    }
 
     if (*finished & FINISHED_RECV) {
         ret = AVERROR_EOF;
@@ -149,7 +154,8 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
 
         ret = av_fifo_write(tq->fifo, &elem, 1);
         av_assert0(ret >= 0);
-        pthread_cond_broadcast(&tq->cond);
+        if (tq->nb_waiting)
+            pthread_cond_broadcast(&tq->cond);
     }
 
 finish:
@@ -199,14 +205,16 @@ int tq_receive(ThreadQueue *tq, int *stream_idx, void *data)
     while (1) {
         ret = receive_locked(tq, stream_idx, data);
         if (ret == AVERROR(EAGAIN)) {
+            tq->nb_waiting++;
             pthread_cond_wait(&tq->cond, &tq->lock);
+            tq->nb_waiting--;
             continue;
         }
 
         break;
     }
 
-    if (ret == 0)
+    if (ret == 0 && tq->nb_waiting)
         pthread_cond_broadcast(&tq->cond);
 
     pthread_mutex_unlock(&tq->lock);
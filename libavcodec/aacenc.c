@@ -1111,7 +1111,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         too_many_bits = too_many_bits + too_many_bits/2;
 
         if (   its == 0 /* for steady-state Q-scale tracking */
-            || (its < 5 && (frame_bits < too_few_bits || frame_bits > too_many_bits))
+            || (its < s->max_its && (frame_bits < too_few_bits || frame_bits > too_many_bits))
             || frame_bits >= 6144 * s->channels - 3  )
         {
             float ratio = ((float)rate_bits) / frame_bits;
@@ -1134,6 +1134,9 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
             /* Keep iterating if we must reduce and lambda is in the sky */
             if (ratio > 0.9f && ratio < 1.1f) {
                 break;
+            } else if (its >= s->max_its && frame_bits < 6144 * s->channels - 3) {
+                /* Keep the frame, the new lambda only applies to the next one */
+                break;
             } else {
                 if (is_mode || ms_mode || tns_mode || pred_mode) {
                     for (i = 0; i < s->chan_map[0]; i++) {
@@ -1332,6 +1335,16 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     }
     s->profile = avctx->profile;
 
+    /* Speed/quality tradeoff: lower compression levels use the fast coder
+     * and give up on re-encoding frames that miss the rate control target. */
+    if (avctx->compression_level == FF_COMPRESSION_DEFAULT || avctx->compression_level >= 2) {
+        s->max_its = 5;
+    } else {
+        s->max_its = av_clip(2 * avctx->compression_level, 0, 2);
+    }
+    if (s->options.coder < 0)
+        s->options.coder = s->max_its < 5 ? AAC_CODER_FAST : AAC_CODER_TWOLOOP;
+
     /* Coder limitations */
     s->coder = &ff_aac_coders[s->options.coder];
     if (s->options.coder == AAC_CODER_ANMR) {
@@ -1388,7 +1401,8 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
 
 #define AACENC_FLAGS AV_OPT_FLAG_ENCODING_PARAM | AV_OPT_FLAG_AUDIO_PARAM
 static const AVOption aacenc_options[] = {
-    {"aac_coder", "Coding algorithm", offsetof(AACEncContext, options.coder), AV_OPT_TYPE_INT, {.i64 = AAC_CODER_TWOLOOP}, 0, AAC_CODER_NB-1, AACENC_FLAGS, "coder"},
+    {"aac_coder", "Coding algorithm", offsetof(AACEncContext, options.coder), AV_OPT_TYPE_INT, {.i64 = -1}, -1, AAC_CODER_NB-1, AACENC_FLAGS, "coder"},
+        {"auto",     "Selected by compression level", 0, AV_OPT_TYPE_CONST, {.i64 = -1},           INT_MIN, INT_MAX, AACENC_FLAGS, "coder"},
         {"anmr",     "ANMR method",               0, AV_OPT_TYPE_CONST, {.i64 = AAC_CODER_ANMR},    INT_MIN, INT_MAX, AACENC_FLAGS, "coder"},
         {"twoloop",  "Two loop searching method", 0, AV_OPT_TYPE_CONST, {.i64 = AAC_CODER_TWOLOOP}, INT_MIN, INT_MAX, AACENC_FLAGS, "coder"},
         {"fast",     "Default fast search",       0, AV_OPT_TYPE_CONST, {.i64 = AAC_CODER_FAST},    INT_MIN, INT_MAX, AACENC_FLAGS, "coder"},
@@ -133,6 +133,7 @@ typedef struct AACEncContext {
     int random_state;
     float lambda;
     int last_frame_pb_count;                     ///< number of bits for the previous frame
+    int max_its;                                 ///< maximum number of rate control re-encodes of a frame
     float lambda_sum;                            ///< sum(lambda), for Qvg reporting
     int lambda_count;                            ///< count(lambda), for Qvg reporting
     enum RawDataBlockType cur_type;              ///< channel group type cur_channel belongs to
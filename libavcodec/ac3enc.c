@@ -1128,6 +1128,9 @@ static void count_mantissa_bits_init(uint16_t mant_cnt[AC3_MAX_BLOCKS][16])
  * Update mantissa bit counts for all blocks in 1 channel in a given bandwidth
  * range.
  *
+ * Blocks which reuse exponents share their bap array with the reference
+ * block, so their counts are copied from it instead of being recounted.
+ *
  * @param s                 AC-3 encoder private context
  * @param ch                channel index
  * @param[in,out] mant_cnt  running counts for each bap value for each block
@@ -1138,15 +1141,24 @@ static void count_mantissa_bits_update_ch(AC3EncodeContext *s, int ch,
                                           uint16_t mant_cnt[AC3_MAX_BLOCKS][16],
                                           int start, int end)
 {
-    int blk;
+    LOCAL_ALIGNED_16(uint16_t, ch_cnt, [16]);
+    const uint8_t *prev_bap = NULL;
+    int blk, i, prev_len = 0;
 
     for (blk = 0; blk < s->num_blocks; blk++) {
         AC3Block *block = &s->blocks[blk];
+        int len;
         if (ch == CPL_CH && !block->cpl_in_use)
             continue;
-        s->ac3dsp.update_bap_counts(mant_cnt[blk],
-                                    s->ref_bap[ch][blk] + start,
-                                    FFMIN(end, block->end_freq[ch]) - start);
+        len = FFMIN(end, block->end_freq[ch]) - start;
+        if (s->ref_bap[ch][blk] != prev_bap || len != prev_len) {
+            memset(ch_cnt, 0, 16 * sizeof(*ch_cnt));
+            s->ac3dsp.update_bap_counts(ch_cnt, s->ref_bap[ch][blk] + start, len);
+            prev_bap = s->ref_bap[ch][blk];
+            prev_len = len;
+        }
+        for (i = 0; i < 16; i++)
+            mant_cnt[blk][i] += ch_cnt[i];
     }
 }
 
@@ -2057,6 +2057,69 @@ typedef struct AVCodecContext {
      *             The decoder can then override during decoding as needed.
      */
     AVChannelLayout ch_layout;
+
+    /**
+     * Shared thread pool, see libavutil/threadpool.h. If set, slice threading
+     * runs its jobs on the threads of this pool instead of creating its own.
+     * Frame threading is not affected. Wrappers of external libraries that
+     * run their own threads limit them to the number of threads of the pool.
+     *
+     * The pool must outlive the codec context.
+     *
+     * - encoding: Set by user before avcodec_open2().
+     * - decoding: Set by user before avcodec_open2().
+     */
+    struct AVThreadPool *thread_pool;
+
+    /**
+     * Number of frame threads, when both frame and slice threading are
+     * enabled in thread_type. If supported by the codec, the thread_count
+     * threads are split between this many frame threads, each coding its
+     * frames with slice threading. This bounds the delay and the memory
+     * added by frame threading while using all the threads.
+     *
+     * 0 uses frame threading only, with thread_count frame threads, and 1
+     * uses slice threading only.
+     *
+     * - encoding: Set by user before avcodec_open2().
+     * - decoding: Set by user before avcodec_open2().
+     */
+    int frame_threads;
+
+    /**
+     * Maximum number of frames of output delay added by frame threading.
+     * Frame threading normally holds back thread_count - 1 frames before
+     * returning the first one; if set, at most this many frames are held
+     * back, so at most this many plus one frames are decoded or encoded
+     * concurrently, each by its own frame thread. The decoding of each frame
+     * still starts as soon as the previous frame has been set up, so 1 keeps
+     * the latency added to streams without reordering to a single frame.
+     * This does not include the reordering delay of the stream itself, see
+     * has_b_frames.
+     *
+     * The number of frame threads is limited to this value plus one, for
+     * decoding and encoding alike. If the codec supports combining frame and
+     * slice threading (see frame_threads) and slice threading is enabled in
+     * thread_type, the remaining threads are used for slice threading within
+     * each frame thread. Otherwise, fewer than thread_count threads are used.
+     *
+     * 0 does not limit the delay.
+     *
+     * - encoding: Set by user before avcodec_open2().
+     * - decoding: Set by user before avcodec_open2().
+     */
+    int frame_thread_delay;
+
+    /**
+     * Shared buffer cache, see av_buffer_pool_init_cache(). If set, the
+     * default get_buffer2() implementation takes the buffers of the video
+     * frames from this cache instead of a pool of its own, so that they can
+     * be reused by other contexts using the same cache.
+     *
+     * - encoding: unused
+     * - decoding: Set by user before avcodec_open2().
+     */
+    struct AVBufferCache *buffer_cache;
 } AVCodecContext;
 
 /**
@@ -3147,6 +3210,15 @@ int avcodec_fill_audio_frame(AVFrame *frame, int nb_channels,
  * @note for decoders, this function just releases any references the decoder
  * might keep internally, but the caller's references remain valid.
  *
+ * @note a decoder flushed this way can be fed a different stream of the same
+ * codec, e.g. on a channel change. This is much cheaper than closing it and
+ * opening a new one: the frame or slice threads, the per-thread contexts and
+ * the frame pools are kept, and only the stream state is reset. The
+ * parameter sets of the new stream, if not sent in-band, can be provided
+ * with AV_PKT_DATA_NEW_EXTRADATA side data on its first packet, for the
+ * decoders that support it (e.g. H.264, HEVC, AAC). Options set on the
+ * context at open time, such as the thread count, are not changed.
+ *
  * @note for encoders, this function will only do something if the encoder
  * declares support for AV_CODEC_CAP_ENCODER_FLUSH. When called, the encoder
  * will drain any remaining packets, and can then be re-used for a different
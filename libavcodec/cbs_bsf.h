@@ -57,6 +57,14 @@ typedef struct CBSBSFContext {
     CodedBitstreamContext *input;
     CodedBitstreamContext *output;
     CodedBitstreamFragment fragment;
+
+    // Unit types which update_fragment() needs to see in decomposed form.
+    // Units of any other type are passed through to the output in their
+    // original bitstream form without being parsed or rewritten.  If NULL,
+    // all units are decomposed.  Must be set before calling
+    // ff_cbs_bsf_generic_init().
+    const CodedBitstreamUnitType *decompose_unit_types;
+    int                        nb_decompose_unit_types;
 } CBSBSFContext;
 
 /**
@@ -80,6 +80,11 @@
  * Codec supports embedded ICC profiles (AV_FRAME_DATA_ICC_PROFILE).
  */
 #define FF_CODEC_CAP_ICC_PROFILES           (1 << 9)
+/**
+ * The contexts of the frame threads of the codec support slice threading,
+ * so both can be used at once, see AVCodecContext.frame_threads.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS    (1 << 10)
 
 /**
  * FFCodec.codec_tags termination value
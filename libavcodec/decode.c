@@ -39,6 +39,7 @@
 #include "libavutil/internal.h"
 #include "libavutil/intmath.h"
 #include "libavutil/opt.h"
+#include "libavutil/trace.h"
 
 #include "avcodec.h"
 #include "bytestream.h"
@@ -550,14 +551,17 @@ static int decode_receive_frame_internal(AVCodecContext *avctx, AVFrame *frame)
 {
     AVCodecInternal *avci = avctx->internal;
     const FFCodec *const codec = ffcodec(avctx->codec);
+    AVTraceSpan span;
     int ret, ok;
 
     av_assert0(!frame->buf[0]);
 
+    av_trace_begin(&span, "decode", avctx->codec->name);
     if (codec->cb_type == FF_CODEC_CB_TYPE_RECEIVE_FRAME) {
         ret = codec->cb.receive_frame(avctx, frame);
     } else
         ret = decode_simple_receive_frame(avctx, frame);
+    av_trace_end(&span);
 
     if (ret == AVERROR_EOF)
         avci->draining_done = 1;
@@ -25,6 +25,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/trace.h"
 
 #include "avcodec.h"
 #include "codec_internal.h"
@@ -303,6 +304,7 @@ static int encode_simple_receive_packet(AVCodecContext *avctx, AVPacket *avpkt)
 static int encode_receive_packet_internal(AVCodecContext *avctx, AVPacket *avpkt)
 {
     AVCodecInternal *avci = avctx->internal;
+    AVTraceSpan span;
     int ret;
 
     if (avci->draining_done)
@@ -317,6 +319,7 @@ static int encode_receive_packet_internal(AVCodecContext *avctx, AVPacket *avpkt
             return AVERROR(EINVAL);
     }
 
+    av_trace_begin(&span, "encode", avctx->codec->name);
     if (ffcodec(avctx->codec)->cb_type == FF_CODEC_CB_TYPE_RECEIVE_PACKET) {
         ret = ffcodec(avctx->codec)->cb.receive_packet(avctx, avpkt);
         if (ret < 0)
@@ -327,6 +330,7 @@ static int encode_receive_packet_internal(AVCodecContext *avctx, AVPacket *avpkt
             av_assert0(!avpkt->data || avpkt->buf);
     } else
         ret = encode_simple_receive_packet(avctx, avpkt);
+    av_trace_end(&span);
     if (ret >= 0)
         avpkt->flags |= avci->intra_only_flag;
 
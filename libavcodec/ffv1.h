@@ -113,6 +113,7 @@ typedef struct FFV1Context {
     int slice_damaged;
     int key_frame_ok;
     int context_model;
+    int thread_slices;
 
     int bits_per_raw_sample;
     int packed_at_lsb;
@@ -850,6 +850,11 @@ static av_cold int encode_init(AVCodecContext *avctx)
         int plane_count = 1 + 2*s->chroma_planes + s->transparency;
         int max_h_slices = AV_CEIL_RSHIFT(avctx->width , s->chroma_h_shift);
         int max_v_slices = AV_CEIL_RSHIFT(avctx->height, s->chroma_v_shift);
+        /* without an explicit slice count, optionally use at least one slice
+         * per thread if the picture is large enough */
+        int min_slices = avctx->slices || !s->thread_slices ? 0 :
+                         FFMIN(avctx->thread_count, MAX_SLICES);
+        int fallback_h_slices = 0, fallback_v_slices = 0;
         s->num_v_slices = (avctx->width > 352 || avctx->height > 288 || !avctx->slices) ? 2 : 1;
 
         s->num_v_slices = FFMIN(s->num_v_slices, max_v_slices);
@@ -862,10 +867,23 @@ static av_cold int encode_init(AVCodecContext *avctx)
                     continue;
                 if (maxw * maxh * (int64_t)(s->bits_per_raw_sample+1) * plane_count > 8<<24)
                     continue;
-                if (avctx->slices == s->num_h_slices * s->num_v_slices && avctx->slices <= MAX_SLICES || !avctx->slices)
+                if (avctx->slices == s->num_h_slices * s->num_v_slices && avctx->slices <= MAX_SLICES)
                     goto slices_ok;
+                if (!avctx->slices) {
+                    if (!fallback_h_slices) {
+                        fallback_h_slices = s->num_h_slices;
+                        fallback_v_slices = s->num_v_slices;
+                    }
+                    if (s->num_h_slices * s->num_v_slices >= min_slices)
+                        goto slices_ok;
+                }
             }
         }
+        if (fallback_h_slices) {
+            s->num_h_slices = fallback_h_slices;
+            s->num_v_slices = fallback_v_slices;
+            goto slices_ok;
+        }
         av_log(avctx, AV_LOG_ERROR,
                "Unsupported number %d of slices requested, please specify a "
                "supported number with -slices (ex:4,6,9,12,16, ...)\n",
@@ -1255,6 +1273,9 @@ static const AVOption options[] = {
             { .i64 = 1 }, INT_MIN, INT_MAX, VE, "coder" },
     { "context", "Context model", OFFSET(context_model), AV_OPT_TYPE_INT,
             { .i64 = 0 }, 0, 1, VE },
+    { "thread_slices", "Use at least one slice per thread if slices is not set, "
+      "the output then depends on the thread count", OFFSET(thread_slices), AV_OPT_TYPE_BOOL,
+            { .i64 = 0 }, 0, 1, VE },
 
     { NULL }
 };
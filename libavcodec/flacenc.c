@@ -22,6 +22,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/crc.h"
+#include "libavutil/frame.h"
 #include "libavutil/intmath.h"
 #include "libavutil/md5.h"
 #include "libavutil/opt.h"
@@ -102,6 +103,20 @@ typedef struct FlacFrame {
     int verbatim_only;
 } FlacFrame;
 
+struct FlacEncodeContext;
+
+/**
+ * State of one frame encoded in parallel with slice threading.
+ */
+typedef struct FlacEncodeThread {
+    struct FlacEncodeContext *s; ///< private copy of the encoder state
+    AVFrame *frame;              ///< queued input samples
+    uint8_t *buf;                ///< encoded frame
+    int size;                    ///< size of the encoded frame or error code
+    int64_t pts;
+    int64_t duration;
+} FlacEncodeThread;
+
 typedef struct FlacEncodeContext {
     AVClass *class;
     PutBitContext pb;
@@ -128,6 +143,12 @@ typedef struct FlacEncodeContext {
 
     int flushed;
     int64_t next_pts;
+
+    FlacEncodeThread *threads;
+    int nb_threads;                 ///< number of frames encoded in parallel
+    int nb_queued;                  ///< number of input frames waiting to be encoded
+    int nb_ready;                   ///< number of encoded frames of the last batch
+    int next_ready;                 ///< next encoded frame to be returned
 } FlacEncodeContext;
 
 
@@ -266,6 +287,48 @@ static av_cold void dprint_compression_options(FlacEncodeContext *s)
 }
 
 
+/**
+ * Set up one encoder state per thread, so that consecutive frames can be
+ * encoded in parallel. The frames are still numbered, checksummed and
+ * returned in order by the main context.
+ */
+static av_cold int init_threads(AVCodecContext *avctx)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    int ret;
+
+    s->threads = av_calloc(avctx->thread_count, sizeof(*s->threads));
+    if (!s->threads)
+        return AVERROR(ENOMEM);
+    s->nb_threads = avctx->thread_count;
+
+    for (int i = 0; i < s->nb_threads; i++) {
+        FlacEncodeThread *t = &s->threads[i];
+
+        t->s = av_memdup(s, sizeof(*s));
+        if (!t->s)
+            return AVERROR(ENOMEM);
+        memset(&t->s->lpc_ctx, 0, sizeof(t->s->lpc_ctx));
+
+        t->frame = av_frame_alloc();
+        t->buf   = av_malloc(s->max_framesize);
+        if (!t->frame || !t->buf)
+            return AVERROR(ENOMEM);
+
+        t->s->md5ctx          = NULL;
+        t->s->md5_buffer      = NULL;
+        t->s->md5_buffer_size = 0;
+        t->s->threads         = NULL;
+        t->s->nb_threads      = 0;
+        ret = ff_lpc_init(&t->s->lpc_ctx, avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 static av_cold int flac_encode_init(AVCodecContext *avctx)
 {
     int freq = avctx->sample_rate;
@@ -453,13 +516,18 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
 
     ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
                       s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    if (ret < 0)
+        return ret;
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacencdsp_init(&s->flac_dsp);
 
     dprint_compression_options(s);
 
-    return ret;
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1)
+        return init_threads(avctx);
+
+    return 0;
 }
 
 
@@ -1306,9 +1374,9 @@ static void write_frame_footer(FlacEncodeContext *s)
 }
 
 
-static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
+static int write_frame(FlacEncodeContext *s, uint8_t *buf, int buf_size)
 {
-    init_put_bits(&s->pb, avpkt->data, avpkt->size);
+    init_put_bits(&s->pb, buf, buf_size);
     write_frame_header(s);
     write_subframes(s);
     write_frame_footer(s);
@@ -1316,10 +1384,11 @@ static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
 }
 
 
-static int update_md5_sum(FlacEncodeContext *s, const void *samples)
+static int update_md5_sum(FlacEncodeContext *s, const void *samples,
+                          int nb_samples)
 {
     const uint8_t *buf;
-    int buf_size = s->frame.blocksize * s->channels *
+    int buf_size = nb_samples * s->channels *
                    ((s->avctx->bits_per_raw_sample + 7) / 8);
 
     if (s->avctx->bits_per_raw_sample > 16 || HAVE_BIGENDIAN) {
@@ -1340,7 +1409,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++) {
+        for (i = 0; i < nb_samples * s->channels; i++) {
             int32_t v = samples0[i] >> 8;
             AV_WL24(tmp + 3*i, v);
         }
@@ -1352,41 +1421,20 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
-static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
-                             const AVFrame *frame, int *got_packet_ptr)
+/**
+ * Encode one block of samples into the frame of the given context.
+ *
+ * @return the maximum size of the frame in bytes or a negative error code
+ */
+static int encode_block(FlacEncodeContext *s, const AVFrame *frame)
 {
-    FlacEncodeContext *s;
-    int frame_bytes, out_bytes, ret;
-
-    s = avctx->priv_data;
-
-    /* when the last block is reached, update the header in extradata */
-    if (!frame) {
-        s->max_framesize = s->max_encoded_framesize;
-        av_md5_final(s->md5ctx, s->md5sum);
-        write_streaminfo(s, avctx->extradata);
-
-        if (!s->flushed) {
-            uint8_t *side_data = av_packet_new_side_data(avpkt, AV_PKT_DATA_NEW_EXTRADATA,
-                                                         avctx->extradata_size);
-            if (!side_data)
-                return AVERROR(ENOMEM);
-            memcpy(side_data, avctx->extradata, avctx->extradata_size);
-
-            avpkt->pts = s->next_pts;
-
-            *got_packet_ptr = 1;
-            s->flushed = 1;
-        }
-
-        return 0;
-    }
+    int frame_bytes;
 
     /* change max_framesize for small final frame */
-    if (frame->nb_samples < s->frame.blocksize) {
+    if (frame->nb_samples < s->max_blocksize) {
         s->max_framesize = flac_get_max_frame_size(frame->nb_samples,
                                                    s->channels,
-                                                   avctx->bits_per_raw_sample);
+                                                   s->avctx->bits_per_raw_sample);
     }
 
     init_frame(s, frame->nb_samples);
@@ -1405,20 +1453,27 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         s->frame.verbatim_only = 1;
         frame_bytes = encode_frame(s);
         if (frame_bytes < 0) {
-            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
+            av_log(s->avctx, AV_LOG_ERROR, "Bad frame count\n");
             return frame_bytes;
         }
     }
 
-    if ((ret = ff_get_encode_buffer(avctx, avpkt, frame_bytes, 0)) < 0)
-        return ret;
+    return frame_bytes;
+}
 
-    out_bytes = write_frame(s, avpkt);
+
+/**
+ * Update the stream information with an encoded frame, in coding order.
+ */
+static int update_stream_info(FlacEncodeContext *s, const AVFrame *frame,
+                              int out_bytes)
+{
+    int ret;
 
     s->frame_count++;
     s->sample_count += frame->nb_samples;
-    if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
+    if ((ret = update_md5_sum(s, frame->data[0], frame->nb_samples)) < 0) {
+        av_log(s->avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
         return ret;
     }
     if (out_bytes > s->max_encoded_framesize)
@@ -1426,6 +1481,145 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     if (out_bytes < s->min_framesize)
         s->min_framesize = out_bytes;
 
+    return 0;
+}
+
+
+static int encode_frame_thread(AVCodecContext *avctx, void *arg,
+                               int jobnr, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeThread  *t = &s->threads[jobnr];
+
+    t->size = encode_block(t->s, t->frame);
+    if (t->size >= 0)
+        t->size = write_frame(t->s, t->buf, t->size);
+
+    return 0;
+}
+
+
+static int encode_queued_frames(AVCodecContext *avctx)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    int ret;
+
+    for (int i = 0; i < s->nb_queued; i++)
+        s->threads[i].s->frame_count = s->frame_count + i;
+
+    avctx->execute2(avctx, encode_frame_thread, NULL, NULL, s->nb_queued);
+
+    for (int i = 0; i < s->nb_queued; i++) {
+        FlacEncodeThread *t = &s->threads[i];
+
+        if (t->size < 0)
+            return t->size;
+        if ((ret = update_stream_info(s, t->frame, t->size)) < 0)
+            return ret;
+
+        t->pts      = t->frame->pts;
+        t->duration = ff_samples_to_time_base(avctx, t->frame->nb_samples);
+        av_frame_unref(t->frame);
+    }
+
+    s->nb_ready   = s->nb_queued;
+    s->next_ready = 0;
+    s->nb_queued  = 0;
+
+    return 0;
+}
+
+
+/**
+ * Queue up one frame per thread, encode them in parallel and return the
+ * encoded frames one by one while the next batch is being queued.
+ */
+static int encode_frame_threaded(AVCodecContext *avctx, AVPacket *avpkt,
+                                 const AVFrame *frame, int *got_packet_ptr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeThread *t;
+    int ret;
+
+    if (frame) {
+        av_assert0(s->nb_queued < s->nb_threads);
+        if ((ret = av_frame_ref(s->threads[s->nb_queued].frame, frame)) < 0)
+            return ret;
+        s->nb_queued++;
+    }
+
+    if (s->next_ready == s->nb_ready && s->nb_queued &&
+        (!frame || s->nb_queued == s->nb_threads)) {
+        if ((ret = encode_queued_frames(avctx)) < 0)
+            return ret;
+    }
+
+    if (s->next_ready == s->nb_ready)
+        return 0;
+
+    t = &s->threads[s->next_ready++];
+    if ((ret = ff_get_encode_buffer(avctx, avpkt, t->size, 0)) < 0)
+        return ret;
+    memcpy(avpkt->data, t->buf, t->size);
+
+    avpkt->pts      = t->pts;
+    avpkt->duration = t->duration;
+
+    s->next_pts = avpkt->pts + avpkt->duration;
+
+    *got_packet_ptr = 1;
+    return 0;
+}
+
+
+static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
+                             const AVFrame *frame, int *got_packet_ptr)
+{
+    FlacEncodeContext *s;
+    int frame_bytes, out_bytes, ret;
+
+    s = avctx->priv_data;
+
+    if (s->nb_threads) {
+        ret = encode_frame_threaded(avctx, avpkt, frame, got_packet_ptr);
+        if (ret < 0 || *got_packet_ptr || frame)
+            return ret;
+    }
+
+    /* when the last block is reached, update the header in extradata */
+    if (!frame) {
+        s->max_framesize = s->max_encoded_framesize;
+        av_md5_final(s->md5ctx, s->md5sum);
+        write_streaminfo(s, avctx->extradata);
+
+        if (!s->flushed) {
+            uint8_t *side_data = av_packet_new_side_data(avpkt, AV_PKT_DATA_NEW_EXTRADATA,
+                                                         avctx->extradata_size);
+            if (!side_data)
+                return AVERROR(ENOMEM);
+            memcpy(side_data, avctx->extradata, avctx->extradata_size);
+
+            avpkt->pts = s->next_pts;
+
+            *got_packet_ptr = 1;
+            s->flushed = 1;
+        }
+
+        return 0;
+    }
+
+    frame_bytes = encode_block(s, frame);
+    if (frame_bytes < 0)
+        return frame_bytes;
+
+    if ((ret = ff_get_encode_buffer(avctx, avpkt, frame_bytes, 0)) < 0)
+        return ret;
+
+    out_bytes = write_frame(s, avpkt->data, avpkt->size);
+
+    if ((ret = update_stream_info(s, frame, out_bytes)) < 0)
+        return ret;
+
     avpkt->pts      = frame->pts;
     avpkt->duration = ff_samples_to_time_base(avctx, frame->nb_samples);
 
@@ -1442,6 +1636,16 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     FlacEncodeContext *s = avctx->priv_data;
 
+    for (int i = 0; i < s->nb_threads; i++) {
+        FlacEncodeThread *t = &s->threads[i];
+        if (t->s)
+            ff_lpc_end(&t->s->lpc_ctx);
+        av_freep(&t->s);
+        av_frame_free(&t->frame);
+        av_freep(&t->buf);
+    }
+    av_freep(&s->threads);
+
     av_freep(&s->md5ctx);
     av_freep(&s->md5_buffer);
     ff_lpc_end(&s->lpc_ctx);
@@ -1493,7 +1697,8 @@ const FFCodec ff_flac_encoder = {
     .p.type         = AVMEDIA_TYPE_AUDIO,
     .p.id           = AV_CODEC_ID_FLAC,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SMALL_LAST_FRAME,
+                      AV_CODEC_CAP_SMALL_LAST_FRAME |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .priv_data_size = sizeof(FlacEncodeContext),
     .init           = flac_encode_init,
     FF_CODEC_ENCODE_CB(flac_encode_frame),
@@ -26,7 +26,9 @@
 #include "libavutil/cpu.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/trace.h"
 #include "avcodec.h"
+#include "codec_internal.h"
 #include "encode.h"
 #include "internal.h"
 #include "pthread_internal.h"
@@ -86,6 +88,7 @@ static void * attribute_align_arg worker(void *v){
     ThreadContext *c = avctx->internal->frame_thread_encoder;
 
     while (!atomic_load(&c->exit)) {
+        AVTraceSpan span;
         int ret;
         AVPacket *pkt;
         AVFrame *frame;
@@ -111,7 +114,9 @@ static void * attribute_align_arg worker(void *v){
         frame = task->indata;
         pkt   = task->outdata;
 
+        av_trace_begin(&span, "encode", avctx->codec->name);
         ret = ff_encode_encode_cb(avctx, pkt, frame, &task->got_packet);
+        av_trace_end(&span);
 #if FF_API_THREAD_SAFE_CALLBACKS
         pthread_mutex_lock(&c->buffer_mutex);
         av_frame_unref(frame);
@@ -124,6 +129,8 @@ static void * attribute_align_arg worker(void *v){
         pthread_mutex_unlock(&c->finished_task_mutex);
     }
 end:
+    // the thread context does not own the frame thread encoder
+    avctx->internal->frame_thread_encoder = NULL;
 #if FF_API_THREAD_SAFE_CALLBACKS
     pthread_mutex_lock(&c->buffer_mutex);
 #endif
@@ -140,10 +147,13 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
     int i=0;
     ThreadContext *c;
     AVCodecContext *thread_avctx = NULL;
+    int frame_threads = avctx->frame_threads;
+    int slice_threads = 0;
     int ret;
 
     if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & AV_CODEC_CAP_FRAME_THREADS))
+       || !(avctx->codec->capabilities & AV_CODEC_CAP_FRAME_THREADS)
+       || avctx->frame_threads == 1)
         return 0;
 
     if(   !avctx->thread_count
@@ -186,6 +196,25 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
         avctx->thread_count = FFMIN(avctx->thread_count, MAX_THREADS);
     }
 
+    // no more frames than the delay limit allows are encoded concurrently
+    if (avctx->frame_thread_delay &&
+        (!frame_threads || frame_threads > avctx->frame_thread_delay + 1))
+        frame_threads = avctx->frame_thread_delay + 1;
+
+    // split the threads between frame threads encoding with slice threads
+    if (frame_threads && frame_threads < avctx->thread_count &&
+        avctx->thread_type & FF_THREAD_SLICE &&
+        avctx->codec->capabilities & AV_CODEC_CAP_SLICE_THREADS &&
+        ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS) {
+        slice_threads = avctx->thread_count / frame_threads;
+        if (slice_threads > 1)
+            avctx->thread_count = frame_threads;
+    }
+
+    // otherwise only keep as many frame threads as the delay limit allows
+    if (avctx->frame_thread_delay && avctx->frame_thread_delay < avctx->thread_count - 1)
+        avctx->thread_count = avctx->frame_thread_delay + 1;
+
     if(avctx->thread_count <= 1)
         return 0;
 
@@ -233,7 +262,11 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
             if (ret < 0)
                 goto fail;
         }
-        thread_avctx->thread_count = 1;
+        if (slice_threads > 1) {
+            thread_avctx->thread_count = slice_threads;
+            thread_avctx->thread_type  = FF_THREAD_SLICE;
+        } else
+            thread_avctx->thread_count = 1;
         thread_avctx->active_thread_type &= ~FF_THREAD_FRAME;
 
         if ((ret = avcodec_open2(thread_avctx, avctx->codec, NULL)) < 0)
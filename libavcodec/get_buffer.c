@@ -152,10 +152,14 @@ FF_ENABLE_DEPRECATION_WARNINGS
                     ret = AVERROR(EINVAL);
                     goto fail;
                 }
-                pool->pools[i] = av_buffer_pool_init(size[i] + 16 + STRIDE_ALIGN - 1,
-                                                     CONFIG_MEMORY_POISONING ?
-                                                        NULL :
-                                                        av_buffer_allocz);
+                if (avctx->buffer_cache)
+                    pool->pools[i] = av_buffer_pool_init_cache(size[i] + 16 + STRIDE_ALIGN - 1,
+                                                               avctx->buffer_cache);
+                else
+                    pool->pools[i] = av_buffer_pool_init(size[i] + 16 + STRIDE_ALIGN - 1,
+                                                         CONFIG_MEMORY_POISONING ?
+                                                            NULL :
+                                                            av_buffer_allocz);
                 if (!pool->pools[i]) {
                     ret = AVERROR(ENOMEM);
                     goto fail;
@@ -1,5 +1,5 @@
 /*
- * H.264/HEVC common parsing code
+ * H.264/HEVC/VVC common parsing code
  *
  * This file is part of FFmpeg.
  *
@@ -57,12 +57,12 @@ typedef struct H2645NAL {
     int ref_idc;
 
     /**
-     * HEVC only, nuh_temporal_id_plus_1 - 1
+     * HEVC and VVC only, nuh_temporal_id_plus_1 - 1
      */
     int temporal_id;
 
     /*
-     * HEVC only, identifier of layer to which nal unit belongs
+     * HEVC and VVC only, identifier of layer to which nal unit belongs
      */
     int nuh_layer_id;
 
@@ -546,6 +546,12 @@ static const CBSBSFType h264_metadata_type = {
     .update_fragment = &h264_metadata_update_fragment,
 };
 
+static const CodedBitstreamUnitType h264_decompose_unit_types[] = {
+    H264_NAL_SPS,
+    H264_NAL_PPS,
+    H264_NAL_SEI,
+};
+
 static int h264_metadata_init(AVBSFContext *bsf)
 {
     H264MetadataContext *ctx = bsf->priv_data;
@@ -583,6 +589,17 @@ static int h264_metadata_init(AVBSFContext *bsf)
         }
     }
 
+    // Slice headers are only needed to choose the AUD primary_pic_type,
+    // and SEI only when SEI messages are being edited.
+    if (ctx->aud != BSF_ELEMENT_INSERT) {
+        ctx->common.decompose_unit_types    = h264_decompose_unit_types;
+        ctx->common.nb_decompose_unit_types =
+            FF_ARRAY_ELEMS(h264_decompose_unit_types);
+        if (!ctx->sei_user_data && !ctx->delete_filler &&
+            ctx->display_orientation == BSF_ELEMENT_PASS)
+            ctx->common.nb_decompose_unit_types--;
+    }
+
     return ff_cbs_bsf_generic_init(bsf, &h264_metadata_type);
 }
 
@@ -49,7 +49,10 @@ static void count_or_copy(uint8_t **out, uint64_t *out_size,
     uint8_t start_code_size = ps < 0 ? 0 : *out_size == 0 || ps ? 4 : 3;
 
     if (copy) {
-        memcpy(*out + start_code_size, in, in_size);
+        /* when filtering in place, the unit may already be where it belongs
+         * or overlap its destination */
+        if (*out + start_code_size != in)
+            memmove(*out + start_code_size, in, in_size);
         if (start_code_size == 4) {
             AV_WB32(*out, 1);
         } else if (start_code_size) {
@@ -175,7 +178,7 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
     const uint8_t *buf_end;
     uint8_t *out;
     uint64_t out_size;
-    int ret;
+    int in_place, ret;
 
     ret = ff_bsf_get_packet(ctx, &in);
     if (ret < 0)
@@ -188,13 +191,16 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
         return 0;
     }
 
-    buf_end  = in->data + in->size;
+    /* With 4-byte length prefixes, no unit moves forward unless parameter
+     * sets are inserted, so the packet can be rewritten in place. */
+    in_place = s->length_size == 4;
 
 #define LOG_ONCE(...) \
     if (j) \
         av_log(__VA_ARGS__)
     for (int j = 0; j < 2; j++) {
         buf      = in->data;
+        buf_end  = in->data + in->size;
         new_idr  = s->new_idr;
         sps_seen = s->idr_sps_seen;
         pps_seen = s->idr_pps_seen;
@@ -232,6 +238,7 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
                     } else {
                         count_or_copy(&out, &out_size, s->sps, s->sps_size, -1, j);
                         sps_seen = 1;
+                        in_place = 0;
                     }
                 }
             }
@@ -244,9 +251,11 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
 
             /* prepend only to the first type 5 NAL unit of an IDR picture, if no sps/pps are already present */
             if (new_idr && unit_type == H264_NAL_IDR_SLICE && !sps_seen && !pps_seen) {
-                if (ctx->par_out->extradata)
+                if (ctx->par_out->extradata) {
                     count_or_copy(&out, &out_size, ctx->par_out->extradata,
                                   ctx->par_out->extradata_size, -1, j);
+                    in_place = 0;
+                }
                 new_idr = 0;
             /* if only SPS has been seen, also insert PPS */
             } else if (new_idr && unit_type == H264_NAL_IDR_SLICE && sps_seen && !pps_seen) {
@@ -254,6 +263,7 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
                     LOG_ONCE(ctx, AV_LOG_WARNING, "PPS not present in the stream, nor in AVCC, stream may be unreadable\n");
                 } else {
                     count_or_copy(&out, &out_size, s->pps, s->pps_size, -1, j);
+                    in_place = 0;
                 }
             }
 
@@ -269,6 +279,13 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
         } while (buf < buf_end);
 
         if (!j) {
+            if (in_place) {
+                ret = av_packet_make_writable(in);
+                if (ret < 0)
+                    goto fail;
+                out = in->data;
+                continue;
+            }
             if (out_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
                 ret = AVERROR_INVALIDDATA;
                 goto fail;
@@ -281,16 +298,21 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
     }
 #undef LOG_ONCE
 
+    if (in_place) {
+        av_shrink_packet(in, out_size);
+        av_packet_move_ref(opkt, in);
+    } else {
+        ret = av_packet_copy_props(opkt, in);
+        if (ret < 0)
+            goto fail;
+    }
+
     av_assert1(out_size == opkt->size);
 
     s->new_idr      = new_idr;
     s->idr_sps_seen = sps_seen;
     s->idr_pps_seen = pps_seen;
 
-    ret = av_packet_copy_props(opkt, in);
-    if (ret < 0)
-        goto fail;
-
 fail:
     if (ret < 0)
         av_packet_unref(opkt);
@@ -245,6 +245,19 @@ static int scan_mmco_reset(AVCodecParserContext *s, GetBitContext *gb,
     return 0;
 }
 
+/**
+ * Check whether a parameter set NAL unit is identical to the stored one,
+ * so that it does not need to be parsed again.
+ * The stored data is the NAL unit as extracted here plus the re-added
+ * stop bit.
+ */
+static int is_repeated_ps(const uint8_t *data, size_t data_size,
+                          size_t max_size, const H2645NAL *nal)
+{
+    return nal->size < max_size && data_size == nal->size + 1 &&
+           !memcmp(data, nal->data, nal->size);
+}
+
 /**
  * Parse NAL units of found picture and decode some basic information.
  *
@@ -320,6 +333,14 @@ static inline int parse_nal_units(AVCodecParserContext *s,
                     src_length = 1000;
             }
             break;
+        case H264_NAL_SPS:
+        case H264_NAL_PPS:
+        case H264_NAL_SEI:
+            break;
+        default:
+            /* Not looked at below, so skip it without unescaping it. */
+            buf_index = p->is_avc ? next_avc : buf_index + 1;
+            continue;
         }
         consumed = ff_h2645_extract_rbsp(buf + buf_index, src_length, &rbsp, &nal, 1);
         if (consumed < 0)
@@ -335,13 +356,38 @@ static inline int parse_nal_units(AVCodecParserContext *s,
         nal.type    = get_bits(&nal.gb, 5);
 
         switch (nal.type) {
-        case H264_NAL_SPS:
+        case H264_NAL_SPS: {
+            GetBitContext gb = nal.gb;
+            const SPS *cur;
+            unsigned int sps_id;
+
+            skip_bits(&gb, 24); // profile_idc, constraint_set_flags, level_idc
+            sps_id = get_ue_golomb_31(&gb);
+            cur    = sps_id < MAX_SPS_COUNT && p->ps.sps_list[sps_id] ?
+                     (const SPS*)p->ps.sps_list[sps_id]->data : NULL;
+            if (cur && is_repeated_ps(cur->data, cur->data_size,
+                                      sizeof(cur->data), &nal))
+                break;
             ff_h264_decode_seq_parameter_set(&nal.gb, avctx, &p->ps, 0);
             break;
-        case H264_NAL_PPS:
+        }
+        case H264_NAL_PPS: {
+            GetBitContext gb = nal.gb;
+            const PPS *cur;
+
+            pps_id = get_ue_golomb(&gb);
+            cur    = pps_id < MAX_PPS_COUNT && p->ps.pps_list[pps_id] ?
+                     (const PPS*)p->ps.pps_list[pps_id]->data : NULL;
+            /* The PPS must also still refer to the current SPS. */
+            if (cur && p->ps.sps_list[cur->sps_id] &&
+                cur->sps == (const SPS*)p->ps.sps_list[cur->sps_id]->data &&
+                is_repeated_ps(cur->data, cur->data_size,
+                                      sizeof(cur->data), &nal))
+                break;
             ff_h264_decode_picture_parameter_set(&nal.gb, avctx, &p->ps,
                                                  nal.size_bits);
             break;
+        }
         case H264_NAL_SEI:
             ff_h264_sei_decode(&p->sei, &nal.gb, &p->ps, avctx);
             break;
@@ -31,6 +31,7 @@
 #include "libavutil/display.h"
 #include "libavutil/film_grain_params.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/timecode.h"
 #include "internal.h"
 #include "cabac.h"
@@ -47,6 +48,7 @@
 #include "mathops.h"
 #include "mpegutils.h"
 #include "rectangle.h"
+#include "sizepool.h"
 #include "thread.h"
 #include "threadframe.h"
 
@@ -160,35 +162,12 @@ static int alloc_scratch_buffers(H264SliceContext *sl, int linesize)
     return 0;
 }
 
-static int init_table_pools(H264Context *h)
+static int alloc_picture(H264Context *h, H264Picture *pic)
 {
     const int big_mb_num    = h->mb_stride * (h->mb_height + 1) + 1;
     const int mb_array_size = h->mb_stride * h->mb_height;
     const int b4_stride     = h->mb_width * 4 + 1;
     const int b4_array_size = b4_stride * h->mb_height * 4;
-
-    h->qscale_table_pool = av_buffer_pool_init(big_mb_num + h->mb_stride,
-                                               av_buffer_allocz);
-    h->mb_type_pool      = av_buffer_pool_init((big_mb_num + h->mb_stride) *
-                                               sizeof(uint32_t), av_buffer_allocz);
-    h->motion_val_pool   = av_buffer_pool_init(2 * (b4_array_size + 4) *
-                                               sizeof(int16_t), av_buffer_allocz);
-    h->ref_index_pool    = av_buffer_pool_init(4 * mb_array_size, av_buffer_allocz);
-
-    if (!h->qscale_table_pool || !h->mb_type_pool || !h->motion_val_pool ||
-        !h->ref_index_pool) {
-        av_buffer_pool_uninit(&h->qscale_table_pool);
-        av_buffer_pool_uninit(&h->mb_type_pool);
-        av_buffer_pool_uninit(&h->motion_val_pool);
-        av_buffer_pool_uninit(&h->ref_index_pool);
-        return AVERROR(ENOMEM);
-    }
-
-    return 0;
-}
-
-static int alloc_picture(H264Context *h, H264Picture *pic)
-{
     int i, ret = 0;
 
     av_assert0(!pic->f->data[0]);
@@ -231,14 +210,9 @@ static int alloc_picture(H264Context *h, H264Picture *pic)
         }
     }
 
-    if (!h->qscale_table_pool) {
-        ret = init_table_pools(h);
-        if (ret < 0)
-            goto fail;
-    }
-
-    pic->qscale_table_buf = av_buffer_pool_get(h->qscale_table_pool);
-    pic->mb_type_buf      = av_buffer_pool_get(h->mb_type_pool);
+    pic->qscale_table_buf = ff_size_pool_get(h->table_pool, big_mb_num + h->mb_stride);
+    pic->mb_type_buf      = ff_size_pool_get(h->table_pool, (big_mb_num + h->mb_stride) *
+                                                            sizeof(uint32_t));
     if (!pic->qscale_table_buf || !pic->mb_type_buf)
         goto fail;
 
@@ -246,8 +220,9 @@ static int alloc_picture(H264Context *h, H264Picture *pic)
     pic->qscale_table = pic->qscale_table_buf->data + 2 * h->mb_stride + 1;
 
     for (i = 0; i < 2; i++) {
-        pic->motion_val_buf[i] = av_buffer_pool_get(h->motion_val_pool);
-        pic->ref_index_buf[i]  = av_buffer_pool_get(h->ref_index_pool);
+        pic->motion_val_buf[i] = ff_size_pool_get(h->table_pool, 2 * (b4_array_size + 4) *
+                                                                 sizeof(int16_t));
+        pic->ref_index_buf[i]  = ff_size_pool_get(h->table_pool, 4 * mb_array_size);
         if (!pic->motion_val_buf[i] || !pic->ref_index_buf[i])
             goto fail;
 
@@ -331,6 +306,10 @@ int ff_h264_update_thread_context(AVCodecContext *dst,
         need_reinit = 1;
     }
 
+    ret = av_buffer_replace(&h->table_pool, h1->table_pool);
+    if (ret < 0)
+        return ret;
+
     /* copy block_offset since frame_start may not be called */
     memcpy(h->block_offset, h1->block_offset, sizeof(h->block_offset));
 
@@ -930,6 +909,7 @@ static void init_dimensions(H264Context *h)
 static int h264_slice_header_init(H264Context *h)
 {
     const SPS *sps = h->ps.sps;
+    size_t freed;
     int i, ret;
 
     if (!sps) {
@@ -937,6 +917,10 @@ static int h264_slice_header_init(H264Context *h)
         goto fail;
     }
 
+    freed = ff_size_pool_trim(h->table_pool, sps->mb_width, sps->mb_height);
+    if (freed)
+        av_log(h->avctx, AV_LOG_DEBUG, "Freed %zu bytes of picture tables\n", freed);
+
     ff_set_sar(h->avctx, sps->vui.sar);
     av_pix_fmt_get_chroma_sub_sample(h->avctx->pix_fmt,
                                      &h->chroma_x_shift, &h->chroma_y_shift);
@@ -2507,12 +2491,318 @@ static void er_add_slice(H264SliceContext *sl,
     }
 }
 
+#if HAVE_THREADS
+#define PIPELINE_SIZE 128
+
+enum H264PipelineCmd {
+    PIPELINE_MB,
+    PIPELINE_ROW_END,
+};
+
+/**
+ * The part of the slice context state left by ff_h264_decode_mb_cabac()
+ * which is needed by ff_h264_hl_decode_mb().
+ */
+typedef struct H264PipelineMB {
+    DECLARE_ALIGNED(16, int16_t, mb)[16 * 48 * 2];
+    DECLARE_ALIGNED(16, int16_t, mb_luma_dc)[3][16 * 2];
+    DECLARE_ALIGNED(16, int16_t, mv_cache)[2][5 * 8][2];
+    DECLARE_ALIGNED(8,  int8_t, ref_cache)[2][5 * 8];
+    DECLARE_ALIGNED(8, uint8_t, non_zero_count_cache)[15 * 8];
+    int8_t intra4x4_pred_mode_cache[5 * 8];
+    uint16_t sub_mb_type[4];
+    const uint8_t *intra_pcm_ptr;
+
+    enum H264PipelineCmd cmd;
+    int mb_x, mb_y, mb_xy;
+    int qscale;
+    int chroma_qp[2];
+    int cbp;
+    int chroma_pred_mode;
+    int intra16x16_pred_mode;
+    unsigned int topleft_samples_available;
+    unsigned int topright_samples_available;
+    int top_type;
+} H264PipelineMB;
+
+typedef struct H264Pipeline {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int exit;
+
+    /* the reconstruction thread's copy of the slice context */
+    H264SliceContext sl;
+
+    H264PipelineMB *cmds;
+    unsigned int nb_queued;
+    unsigned int nb_done;
+    int running;
+    /* -1 while the slice is being parsed, then the end of the loop filter
+     * in the last row */
+    int end_x;
+} H264Pipeline;
+
+static void pipeline_load_mb(const H264Context *h, H264SliceContext *sl,
+                             const H264PipelineMB *mb)
+{
+    memcpy(sl->mb, mb->mb, (16 * 48 * sizeof(*sl->mb)) << h->pixel_shift);
+    memcpy(sl->mb_luma_dc, mb->mb_luma_dc, sizeof(sl->mb_luma_dc));
+    memcpy(sl->mv_cache, mb->mv_cache, sizeof(sl->mv_cache));
+    memcpy(sl->ref_cache, mb->ref_cache, sizeof(sl->ref_cache));
+    memcpy(sl->non_zero_count_cache, mb->non_zero_count_cache,
+           sizeof(sl->non_zero_count_cache));
+    memcpy(sl->intra4x4_pred_mode_cache, mb->intra4x4_pred_mode_cache,
+           sizeof(sl->intra4x4_pred_mode_cache));
+    memcpy(sl->sub_mb_type, mb->sub_mb_type, sizeof(sl->sub_mb_type));
+    sl->intra_pcm_ptr              = mb->intra_pcm_ptr;
+    sl->mb_x                       = mb->mb_x;
+    sl->mb_y                       = mb->mb_y;
+    sl->mb_xy                      = mb->mb_xy;
+    sl->qscale                     = mb->qscale;
+    sl->chroma_qp[0]               = mb->chroma_qp[0];
+    sl->chroma_qp[1]               = mb->chroma_qp[1];
+    sl->cbp                        = mb->cbp;
+    sl->chroma_pred_mode           = mb->chroma_pred_mode;
+    sl->intra16x16_pred_mode       = mb->intra16x16_pred_mode;
+    sl->topleft_samples_available  = mb->topleft_samples_available;
+    sl->topright_samples_available = mb->topright_samples_available;
+    sl->top_type                   = mb->top_type;
+}
+
+static void pipeline_store_mb(const H264Context *h, H264PipelineMB *mb,
+                              H264SliceContext *sl)
+{
+    const size_t coeff_size = (16 * 48 * sizeof(*sl->mb)) << h->pixel_shift;
+
+    /* the coefficients are expected to be cleared by the reconstruction */
+    memcpy(mb->mb, sl->mb, coeff_size);
+    memset(sl->mb, 0, coeff_size);
+    memcpy(mb->mb_luma_dc, sl->mb_luma_dc, sizeof(mb->mb_luma_dc));
+    memcpy(mb->mv_cache, sl->mv_cache, sizeof(mb->mv_cache));
+    memcpy(mb->ref_cache, sl->ref_cache, sizeof(mb->ref_cache));
+    memcpy(mb->non_zero_count_cache, sl->non_zero_count_cache,
+           sizeof(mb->non_zero_count_cache));
+    memcpy(mb->intra4x4_pred_mode_cache, sl->intra4x4_pred_mode_cache,
+           sizeof(mb->intra4x4_pred_mode_cache));
+    memcpy(mb->sub_mb_type, sl->sub_mb_type, sizeof(mb->sub_mb_type));
+    mb->intra_pcm_ptr              = sl->intra_pcm_ptr;
+    mb->mb_x                       = sl->mb_x;
+    mb->mb_y                       = sl->mb_y;
+    mb->mb_xy                      = sl->mb_xy;
+    mb->qscale                     = sl->qscale;
+    mb->chroma_qp[0]               = sl->chroma_qp[0];
+    mb->chroma_qp[1]               = sl->chroma_qp[1];
+    mb->cbp                        = sl->cbp;
+    mb->chroma_pred_mode           = sl->chroma_pred_mode;
+    mb->intra16x16_pred_mode       = sl->intra16x16_pred_mode;
+    mb->topleft_samples_available  = sl->topleft_samples_available;
+    mb->topright_samples_available = sl->topright_samples_available;
+    mb->top_type                   = sl->top_type;
+}
+
+/**
+ * Reconstruct and deblock the macroblocks of the current slice in the
+ * order they are queued, doing what decode_slice() does without pipeline.
+ * Called with the lock held.
+ */
+static void pipeline_reconstruct_slice(H264Pipeline *p)
+{
+    H264SliceContext *sl = &p->sl;
+    const H264Context *h = sl->h264;
+    int lf_x_start = sl->mb_x;
+    int mb_y       = sl->mb_y;
+
+    for (;;) {
+        const H264PipelineMB *cmd;
+
+        while (p->nb_done == p->nb_queued && p->end_x < 0)
+            pthread_cond_wait(&p->cond, &p->lock);
+        if (p->nb_done == p->nb_queued)
+            break;
+        cmd = &p->cmds[p->nb_done % PIPELINE_SIZE];
+        pthread_mutex_unlock(&p->lock);
+
+        if (cmd->cmd == PIPELINE_MB) {
+            pipeline_load_mb(h, sl, cmd);
+            ff_h264_hl_decode_mb(h, sl);
+        } else {
+            sl->mb_y = mb_y;
+            loop_filter(h, sl, lf_x_start, h->mb_width);
+            lf_x_start = 0;
+            decode_finish_row(h, sl);
+            mb_y++;
+        }
+
+        pthread_mutex_lock(&p->lock);
+        p->nb_done++;
+        pthread_cond_signal(&p->cond);
+    }
+
+    if (p->end_x > lf_x_start) {
+        pthread_mutex_unlock(&p->lock);
+        sl->mb_y = mb_y;
+        loop_filter(h, sl, lf_x_start, p->end_x);
+        pthread_mutex_lock(&p->lock);
+    }
+}
+
+static void *pipeline_worker(void *arg)
+{
+    H264Pipeline *p = arg;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->running && !p->exit)
+            pthread_cond_wait(&p->cond, &p->lock);
+        if (p->exit)
+            break;
+
+        pipeline_reconstruct_slice(p);
+        p->running = 0;
+        pthread_cond_signal(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+static void pipeline_start(H264Pipeline *p, const H264SliceContext *sl)
+{
+    pthread_mutex_lock(&p->lock);
+    p->sl        = *sl;
+    p->nb_queued = 0;
+    p->nb_done   = 0;
+    p->end_x     = -1;
+    p->running   = 1;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void pipeline_queue(H264Pipeline *p, const H264Context *h,
+                           H264SliceContext *sl, enum H264PipelineCmd cmd)
+{
+    H264PipelineMB *mb = &p->cmds[p->nb_queued % PIPELINE_SIZE];
+
+    pthread_mutex_lock(&p->lock);
+    while (p->nb_queued - p->nb_done >= PIPELINE_SIZE)
+        pthread_cond_wait(&p->cond, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    mb->cmd = cmd;
+    if (cmd == PIPELINE_MB)
+        pipeline_store_mb(h, mb, sl);
+
+    pthread_mutex_lock(&p->lock);
+    p->nb_queued++;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * Wait until all the queued macroblocks are reconstructed.
+ *
+ * @param end_x end of the loop filter in the last, unfinished row
+ */
+static void pipeline_finish(H264Pipeline *p, int end_x)
+{
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->end_x = end_x;
+    pthread_cond_signal(&p->cond);
+    while (p->running)
+        pthread_cond_wait(&p->cond, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+av_cold int ff_h264_pipeline_init(H264Context *h)
+{
+    H264Pipeline *p;
+    int ret;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+
+    p->cmds = av_malloc_array(PIPELINE_SIZE, sizeof(*p->cmds));
+    if (!p->cmds) {
+        av_free(p);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    ret = pthread_create(&p->thread, NULL, pipeline_worker, p);
+    if (ret) {
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->lock);
+        av_free(p->cmds);
+        av_free(p);
+        return AVERROR(ret);
+    }
+
+    h->pipeline = p;
+    return 0;
+}
+
+av_cold void ff_h264_pipeline_uninit(H264Context *h)
+{
+    H264Pipeline *p = h->pipeline;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->exit = 1;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    pthread_join(p->thread, NULL);
+
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+    av_freep(&p->cmds);
+    av_freep(&h->pipeline);
+}
+#else
+typedef struct H264Pipeline H264Pipeline;
+
+enum H264PipelineCmd {
+    PIPELINE_MB,
+    PIPELINE_ROW_END,
+};
+
+static void pipeline_start(H264Pipeline *p, const H264SliceContext *sl)
+{
+}
+
+static void pipeline_queue(H264Pipeline *p, const H264Context *h,
+                           H264SliceContext *sl, enum H264PipelineCmd cmd)
+{
+}
+
+static void pipeline_finish(H264Pipeline *p, int end_x)
+{
+}
+
+av_cold int ff_h264_pipeline_init(H264Context *h)
+{
+    return 0;
+}
+
+av_cold void ff_h264_pipeline_uninit(H264Context *h)
+{
+}
+#endif
+
 static int decode_slice(struct AVCodecContext *avctx, void *arg)
 {
     H264SliceContext *sl = arg;
     const H264Context *h = sl->h264;
     int lf_x_start = sl->mb_x;
     int orig_deblock = sl->deblocking_filter;
+    H264Pipeline *pipeline = NULL;
     int ret;
 
     sl->linesize   = h->cur_pic_ptr->f->linesize[0];
@@ -2555,11 +2845,19 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
 
         ff_h264_init_cabac_states(h, sl);
 
+        /* let the pipeline thread reconstruct and deblock the macroblocks */
+        if (h->pipeline && h->picture_structure == PICT_FRAME &&
+            !FRAME_MBAFF(h) && !h->avctx->draw_horiz_band) {
+            pipeline = h->pipeline;
+            pipeline_start(pipeline, sl);
+        }
+
         for (;;) {
             int ret, eos;
             if (sl->mb_x + sl->mb_y * h->mb_width >= sl->next_slice_idx) {
                 av_log(h->avctx, AV_LOG_ERROR, "Slice overlaps with next at %d\n",
                        sl->next_slice_idx);
+                pipeline_finish(pipeline, 0);
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x,
                              sl->mb_y, ER_MB_ERROR);
                 return AVERROR_INVALIDDATA;
@@ -2567,7 +2865,9 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
 
             ret = ff_h264_decode_mb_cabac(h, sl);
 
-            if (ret >= 0)
+            if (ret >= 0 && pipeline)
+                pipeline_queue(pipeline, h, sl, PIPELINE_MB);
+            else if (ret >= 0)
                 ff_h264_hl_decode_mb(h, sl);
 
             // FIXME optimal? or let mb_decode decode 16x32 ?
@@ -2584,9 +2884,10 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
 
             if ((h->workaround_bugs & FF_BUG_TRUNCATED) &&
                 sl->cabac.bytestream > sl->cabac.bytestream_end + 2) {
+                pipeline_finish(pipeline, sl->mb_x + 1);
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x - 1,
                              sl->mb_y, ER_MB_END);
-                if (sl->mb_x >= lf_x_start)
+                if (sl->mb_x >= lf_x_start && !pipeline)
                     loop_filter(h, sl, lf_x_start, sl->mb_x + 1);
                 goto finish;
             }
@@ -2597,15 +2898,20 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                        "error while decoding MB %d %d, bytestream %"PTRDIFF_SPECIFIER"\n",
                        sl->mb_x, sl->mb_y,
                        sl->cabac.bytestream_end - sl->cabac.bytestream);
+                pipeline_finish(pipeline, 0);
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x,
                              sl->mb_y, ER_MB_ERROR);
                 return AVERROR_INVALIDDATA;
             }
 
             if (++sl->mb_x >= h->mb_width) {
-                loop_filter(h, sl, lf_x_start, sl->mb_x);
+                if (pipeline) {
+                    pipeline_queue(pipeline, h, sl, PIPELINE_ROW_END);
+                } else {
+                    loop_filter(h, sl, lf_x_start, sl->mb_x);
+                    decode_finish_row(h, sl);
+                }
                 sl->mb_x = lf_x_start = 0;
-                decode_finish_row(h, sl);
                 ++sl->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE(h)) {
                     ++sl->mb_y;
@@ -2617,9 +2923,10 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             if (eos || sl->mb_y >= h->mb_height) {
                 ff_tlog(h->avctx, "slice end %d %d\n",
                         get_bits_count(&sl->gb), sl->gb.size_in_bits);
+                pipeline_finish(pipeline, sl->mb_x);
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x - 1,
                              sl->mb_y, ER_MB_END);
-                if (sl->mb_x > lf_x_start)
+                if (sl->mb_x > lf_x_start && !pipeline)
                     loop_filter(h, sl, lf_x_start, sl->mb_x);
                 goto finish;
             }
@@ -49,6 +49,7 @@
 #include "mpegutils.h"
 #include "profiles.h"
 #include "rectangle.h"
+#include "sizepool.h"
 #include "thread.h"
 #include "threadframe.h"
 
@@ -149,11 +150,6 @@ void ff_h264_free_tables(H264Context *h)
     av_freep(&h->mb2b_xy);
     av_freep(&h->mb2br_xy);
 
-    av_buffer_pool_uninit(&h->qscale_table_pool);
-    av_buffer_pool_uninit(&h->mb_type_pool);
-    av_buffer_pool_uninit(&h->motion_val_pool);
-    av_buffer_pool_uninit(&h->ref_index_pool);
-
 #if CONFIG_ERROR_RESILIENCE
     av_freep(&h->er.mb_index2xy);
     av_freep(&h->er.error_status_table);
@@ -326,6 +322,17 @@ static int h264_init_context(AVCodecContext *avctx, H264Context *h)
     for (i = 0; i < h->nb_slice_ctx; i++)
         h->slice_ctx[i].h264 = h;
 
+    h->table_pool = ff_size_pool_alloc();
+    if (!h->table_pool)
+        return AVERROR(ENOMEM);
+
+    /* with slice threads, several slices are decoded at once */
+    if (h->cabac_pipeline && h->nb_slice_ctx == 1) {
+        ret = ff_h264_pipeline_init(h);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -351,6 +358,8 @@ static av_cold int h264_decode_end(AVCodecContext *avctx)
 
     h->cur_pic_ptr = NULL;
 
+    ff_h264_pipeline_uninit(h);
+
     av_freep(&h->slice_ctx);
     h->nb_slice_ctx = 0;
 
@@ -362,6 +371,11 @@ static av_cold int h264_decode_end(AVCodecContext *avctx)
     h264_free_pic(h, &h->cur_pic);
     h264_free_pic(h, &h->last_pic_for_ec);
 
+    if (h->table_pool && !avctx->internal->is_copy)
+        av_log(avctx, AV_LOG_VERBOSE, "Picture tables high-water mark: %zu bytes\n",
+               ff_size_pool_max_allocated(h->table_pool));
+    av_buffer_unref(&h->table_pool);
+
     return 0;
 }
 
@@ -1056,6 +1070,7 @@ static const AVOption h264_options[] = {
     { "nal_length_size", "nal_length_size", OFFSET(nal_length_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 4, VDX },
     { "enable_er", "Enable error resilience on damaged frames (unsafe)", OFFSET(enable_er), AV_OPT_TYPE_BOOL, { .i64 = -1 }, -1, 1, VD },
     { "x264_build", "Assume this x264 version if no x264 version found in any SEI", OFFSET(x264_build), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, VD },
+    { "cabac_pipeline", "Reconstruct CABAC slices in a separate thread from the parsing", OFFSET(cabac_pipeline), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, VD },
     { NULL },
 };
 
@@ -547,10 +547,18 @@ typedef struct H264Context {
 
     H264SEIContext sei;
 
-    AVBufferPool *qscale_table_pool;
-    AVBufferPool *mb_type_pool;
-    AVBufferPool *motion_val_pool;
-    AVBufferPool *ref_index_pool;
+    /**
+     * Size class pool of the per-picture tables, shared between the frame
+     * threads and kept over reinitializations, see sizepool.h.
+     */
+    AVBufferRef *table_pool;
+
+    /**
+     * Reconstruction thread of the CABAC parsing pipeline, see
+     * ff_h264_pipeline_init().
+     */
+    int cabac_pipeline;
+    struct H264Pipeline *pipeline;
     int ref2frm[MAX_SLICES][2][64];     ///< reference to frame number lists, used in the loop filter, the first 2 are for -2,-1
 } H264Context;
 
@@ -797,6 +805,13 @@ void ff_h264_draw_horiz_band(const H264Context *h, H264SliceContext *sl, int y,
  */
 int ff_h264_queue_decode_slice(H264Context *h, const H2645NAL *nal);
 int ff_h264_execute_decode_slices(H264Context *h);
+
+/**
+ * Start the thread which reconstructs and deblocks the macroblocks of
+ * CABAC coded frame slices while the caller thread parses the next ones.
+ */
+int ff_h264_pipeline_init(H264Context *h);
+void ff_h264_pipeline_uninit(H264Context *h);
 int ff_h264_update_thread_context(AVCodecContext *dst,
                                   const AVCodecContext *src);
 int ff_h264_update_thread_context_for_user(AVCodecContext *dst,
@@ -848,6 +848,34 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, int x0, int y0,
 #undef CB
 #undef CR
 
+/**
+ * Report that the CTB row ctb_row is filtered, allowing references up to
+ * the luma row progress. With slice threads, the rows are filtered
+ * concurrently, so only the progress of the last row of the filtered rows
+ * at the top of the frame is reported.
+ */
+static void report_row_progress(const HEVCContext *s, int ctb_row, int progress)
+{
+    /* Casting const away here is safe, because these are atomic operations. */
+    atomic_int *row_progress = (atomic_int *)s->row_progress;
+    int last = 0;
+
+    if (!row_progress) {
+        ff_thread_report_progress(&s->ref->tf, progress, 0);
+        return;
+    }
+
+    atomic_store(&row_progress[ctb_row], progress);
+    for (int i = 0; i < s->ps.sps->ctb_height; i++) {
+        int p = atomic_load(&row_progress[i]);
+        if (!p)
+            break;
+        last = p;
+    }
+    if (last)
+        ff_thread_report_progress(&s->ref->tf, last, 0);
+}
+
 void ff_hevc_hls_filter(HEVCLocalContext *lc, int x, int y, int ctb_size)
 {
     const HEVCContext *const s = lc->parent;
@@ -874,15 +902,15 @@ void ff_hevc_hls_filter(HEVCLocalContext *lc, int x, int y, int ctb_size)
         if (y && x_end) {
             sao_filter_CTB(lc, s, x, y - ctb_size);
             if (s->threads_type & FF_THREAD_FRAME )
-                ff_thread_report_progress(&s->ref->tf, y, 0);
+                report_row_progress(s, (y >> s->ps.sps->log2_ctb_size) - 1, y);
         }
         if (x_end && y_end) {
             sao_filter_CTB(lc, s, x , y);
             if (s->threads_type & FF_THREAD_FRAME )
-                ff_thread_report_progress(&s->ref->tf, y + ctb_size, 0);
+                report_row_progress(s, y >> s->ps.sps->log2_ctb_size, y + ctb_size);
         }
     } else if (s->threads_type & FF_THREAD_FRAME && x_end)
-        ff_thread_report_progress(&s->ref->tf, y + ctb_size - 4, 0);
+        report_row_progress(s, y >> s->ps.sps->log2_ctb_size, y + ctb_size - 4);
 }
 
 void ff_hevc_hls_filters(HEVCLocalContext *lc, int x_ctb, int y_ctb, int ctb_size)
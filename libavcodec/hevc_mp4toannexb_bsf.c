@@ -116,6 +116,56 @@ static int hevc_mp4toannexb_init(AVBSFContext *ctx)
     return 0;
 }
 
+/**
+ * Replace the length prefixes by start codes in place, which is possible
+ * if they are 4 bytes long and no extradata has to be inserted.
+ *
+ * @return 1 if the packet was converted, 0 if it has to be converted
+ *         into a new packet, a negative error code on invalid data
+ */
+static int hevc_mp4toannexb_in_place(AVBSFContext *ctx, AVPacket *in)
+{
+    HEVCBSFContext *s = ctx->priv_data;
+    GetByteContext gb;
+    uint8_t *p, *end;
+    int ret;
+
+    if (s->length_size != 4)
+        return 0;
+
+    bytestream2_init(&gb, in->data, in->size);
+
+    while (bytestream2_get_bytes_left(&gb)) {
+        uint32_t nalu_size;
+        int      nalu_type;
+
+        if (bytestream2_get_bytes_left(&gb) < 4)
+            return AVERROR_INVALIDDATA;
+        nalu_size = bytestream2_get_be32u(&gb);
+
+        if (nalu_size < 2 || nalu_size > bytestream2_get_bytes_left(&gb))
+            return AVERROR_INVALIDDATA;
+
+        nalu_type = (bytestream2_peek_byte(&gb) >> 1) & 0x3f;
+        if (nalu_type >= 16 && nalu_type <= 23 && ctx->par_out->extradata_size)
+            return 0;
+
+        bytestream2_skipu(&gb, nalu_size);
+    }
+
+    ret = av_packet_make_writable(in);
+    if (ret < 0)
+        return ret;
+
+    for (p = in->data, end = in->data + in->size; p < end; ) {
+        uint32_t nalu_size = AV_RB32(p);
+        AV_WB32(p, 1);
+        p += 4 + nalu_size;
+    }
+
+    return 1;
+}
+
 static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
 {
     HEVCBSFContext *s = ctx->priv_data;
@@ -135,6 +185,15 @@ static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
         return 0;
     }
 
+    ret = hevc_mp4toannexb_in_place(ctx, in);
+    if (ret < 0)
+        goto fail;
+    if (ret > 0) {
+        av_packet_move_ref(out, in);
+        av_packet_free(&in);
+        return 0;
+    }
+
     bytestream2_init(&gb, in->data, in->size);
 
     while (bytestream2_get_bytes_left(&gb)) {
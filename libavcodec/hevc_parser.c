@@ -21,8 +21,10 @@
  */
 
 #include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
 
 #include "golomb.h"
+#include "h264dsp.h"
 #include "hevc.h"
 #include "hevc_parse.h"
 #include "hevc_ps.h"
@@ -37,6 +39,7 @@
 
 typedef struct HEVCParserContext {
     ParseContext pc;
+    H264DSPContext h264dsp;
 
     H2645Packet pkt;
     HEVCParamSets ps;
@@ -265,8 +268,26 @@ static int hevc_find_frame_end(AVCodecParserContext *s, const uint8_t *buf,
     int i;
 
     for (i = 0; i < buf_size; i++) {
+        uint32_t tail = pc->state64;
         int nut;
 
+        /* A start code can only complete once a zero byte has been seen,
+         * so skip ahead while none of the last 4 bytes was zero. */
+        if (!((tail - 0x01010101U) & ~tail & 0x80808080U)) {
+            int next = i + ctx->h264dsp.startcode_find_candidate(buf + i, buf_size - i);
+
+            next = FFMIN(next, buf_size);
+            if (next - i >= 8) {
+                pc->state64 = AV_RB64(buf + next - 8);
+                i = next;
+            } else {
+                for (; i < next; i++)
+                    pc->state64 = (pc->state64 << 8) | buf[i];
+            }
+            if (i >= buf_size)
+                break;
+        }
+
         pc->state64 = (pc->state64 << 8) | buf[i];
 
         if (((pc->state64 >> 3 * 8) & 0xFFFFFF) != START_CODE)
@@ -335,6 +356,14 @@ static int hevc_parse(AVCodecParserContext *s, AVCodecContext *avctx,
     return next;
 }
 
+static av_cold int hevc_parser_init(AVCodecParserContext *s)
+{
+    HEVCParserContext *ctx = s->priv_data;
+
+    ff_h264dsp_init(&ctx->h264dsp, 8, 1);
+    return 0;
+}
+
 static void hevc_parser_close(AVCodecParserContext *s)
 {
     HEVCParserContext *ctx = s->priv_data;
@@ -349,6 +378,7 @@ static void hevc_parser_close(AVCodecParserContext *s)
 const AVCodecParser ff_hevc_parser = {
     .codec_ids      = { AV_CODEC_ID_HEVC },
     .priv_data_size = sizeof(HEVCParserContext),
+    .parser_init    = hevc_parser_init,
     .parser_parse   = hevc_parse,
     .parser_close   = hevc_parser_close,
 };
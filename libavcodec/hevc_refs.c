@@ -26,6 +26,7 @@
 #include "thread.h"
 #include "hevc.h"
 #include "hevcdec.h"
+#include "sizepool.h"
 #include "threadframe.h"
 
 void ff_hevc_unref_frame(HEVCContext *s, HEVCFrame *frame, int flags)
@@ -98,12 +99,16 @@ static HEVCFrame *alloc_frame(HEVCContext *s)
         if (!frame->rpl_buf)
             goto fail;
 
-        frame->tab_mvf_buf = av_buffer_pool_get(s->tab_mvf_pool);
+        frame->tab_mvf_buf = ff_size_pool_get(s->table_pool, s->ps.sps->min_pu_width *
+                                                             s->ps.sps->min_pu_height *
+                                                             sizeof(MvField));
         if (!frame->tab_mvf_buf)
             goto fail;
         frame->tab_mvf = (MvField *)frame->tab_mvf_buf->data;
 
-        frame->rpl_tab_buf = av_buffer_pool_get(s->rpl_tab_pool);
+        frame->rpl_tab_buf = ff_size_pool_get(s->table_pool, s->ps.sps->ctb_width *
+                                                             s->ps.sps->ctb_height *
+                                                             sizeof(RefPicListTab));
         if (!frame->rpl_tab_buf)
             goto fail;
         frame->rpl_tab   = (RefPicListTab **)frame->rpl_tab_buf->data;
@@ -50,6 +50,7 @@
 #include "hwconfig.h"
 #include "internal.h"
 #include "profiles.h"
+#include "sizepool.h"
 #include "thread.h"
 #include "threadframe.h"
 
@@ -80,6 +81,7 @@ static void pic_arrays_free(HEVCContext *s)
     av_freep(&s->qp_y_tab);
     av_freep(&s->tab_slice_address);
     av_freep(&s->filter_slice_edges);
+    av_freep(&s->row_progress);
 
     av_freep(&s->horizontal_bs);
     av_freep(&s->vertical_bs);
@@ -87,9 +89,6 @@ static void pic_arrays_free(HEVCContext *s)
     av_freep(&s->sh.entry_point_offset);
     av_freep(&s->sh.size);
     av_freep(&s->sh.offset);
-
-    av_buffer_pool_uninit(&s->tab_mvf_pool);
-    av_buffer_pool_uninit(&s->rpl_tab_pool);
 }
 
 /* allocate arrays that depend on frame dimensions */
@@ -101,7 +100,6 @@ static int pic_arrays_init(HEVCContext *s, const HEVCSPS *sps)
     int pic_size_in_ctb  = ((width  >> log2_min_cb_size) + 1) *
                            ((height >> log2_min_cb_size) + 1);
     int ctb_count        = sps->ctb_width * sps->ctb_height;
-    int min_pu_size      = sps->min_pu_width * sps->min_pu_height;
 
     s->bs_width  = (width  >> 2) + 1;
     s->bs_height = (height >> 2) + 1;
@@ -117,31 +115,32 @@ static int pic_arrays_init(HEVCContext *s, const HEVCSPS *sps)
         goto fail;
 
     s->cbf_luma = av_malloc_array(sps->min_tb_width, sps->min_tb_height);
-    s->tab_ipm  = av_mallocz(min_pu_size);
-    s->is_pcm   = av_malloc_array(sps->min_pu_width + 1, sps->min_pu_height + 1);
-    if (!s->tab_ipm || !s->cbf_luma || !s->is_pcm)
+    s->tab_ipm  = av_mallocz(sps->min_pu_width * sps->min_pu_height);
+    if (!s->tab_ipm || !s->cbf_luma)
         goto fail;
 
+    /* is_pcm is only used when the loop filters can be bypassed and is
+     * allocated on demand in hevc_frame_start() */
+
     s->filter_slice_edges = av_mallocz(ctb_count);
-    s->tab_slice_address  = av_malloc_array(pic_size_in_ctb,
+    s->tab_slice_address  = av_malloc_array(ctb_count,
                                       sizeof(*s->tab_slice_address));
     s->qp_y_tab           = av_malloc_array(pic_size_in_ctb,
                                       sizeof(*s->qp_y_tab));
     if (!s->qp_y_tab || !s->filter_slice_edges || !s->tab_slice_address)
         goto fail;
 
+    if (s->threads_type == FF_THREAD_FRAME && s->threads_number > 1) {
+        s->row_progress = av_calloc(sps->ctb_height, sizeof(*s->row_progress));
+        if (!s->row_progress)
+            goto fail;
+    }
+
     s->horizontal_bs = av_calloc(s->bs_width, s->bs_height);
     s->vertical_bs   = av_calloc(s->bs_width, s->bs_height);
     if (!s->horizontal_bs || !s->vertical_bs)
         goto fail;
 
-    s->tab_mvf_pool = av_buffer_pool_init(min_pu_size * sizeof(MvField),
-                                          av_buffer_allocz);
-    s->rpl_tab_pool = av_buffer_pool_init(ctb_count * sizeof(RefPicListTab),
-                                          av_buffer_allocz);
-    if (!s->tab_mvf_pool || !s->rpl_tab_pool)
-        goto fail;
-
     return 0;
 
 fail:
@@ -507,6 +506,7 @@ static enum AVPixelFormat get_format(HEVCContext *s, const HEVCSPS *sps)
 static int set_sps(HEVCContext *s, const HEVCSPS *sps,
                    enum AVPixelFormat pix_fmt)
 {
+    size_t freed;
     int ret, i;
 
     pic_arrays_free(s);
@@ -516,6 +516,10 @@ static int set_sps(HEVCContext *s, const HEVCSPS *sps,
     if (!sps)
         return 0;
 
+    freed = ff_size_pool_trim(s->table_pool, sps->width, sps->height);
+    if (freed)
+        av_log(s->avctx, AV_LOG_DEBUG, "Freed %zu bytes of frame tables\n", freed);
+
     ret = pic_arrays_init(s, sps);
     if (ret < 0)
         goto fail;
@@ -2866,15 +2870,27 @@ static int set_side_data(HEVCContext *s)
 static int hevc_frame_start(HEVCContext *s)
 {
     HEVCLocalContext *lc = s->HEVClc;
-    int pic_size_in_ctb  = ((s->ps.sps->width  >> s->ps.sps->log2_min_cb_size) + 1) *
-                           ((s->ps.sps->height >> s->ps.sps->log2_min_cb_size) + 1);
+    int ctb_count        = s->ps.sps->ctb_width * s->ps.sps->ctb_height;
     int ret;
 
     memset(s->horizontal_bs, 0, s->bs_width * s->bs_height);
     memset(s->vertical_bs,   0, s->bs_width * s->bs_height);
     memset(s->cbf_luma,      0, s->ps.sps->min_tb_width * s->ps.sps->min_tb_height);
-    memset(s->is_pcm,        0, (s->ps.sps->min_pu_width + 1) * (s->ps.sps->min_pu_height + 1));
-    memset(s->tab_slice_address, -1, pic_size_in_ctb * sizeof(*s->tab_slice_address));
+    memset(s->tab_slice_address, -1, ctb_count * sizeof(*s->tab_slice_address));
+    if (s->row_progress) {
+        for (int i = 0; i < s->ps.sps->ctb_height; i++)
+            atomic_init(&s->row_progress[i], 0);
+    }
+
+    if (s->ps.pps->transquant_bypass_enable_flag ||
+        (s->ps.sps->pcm_enabled_flag && s->ps.sps->pcm.loop_filter_disable_flag)) {
+        if (!s->is_pcm) {
+            s->is_pcm = av_malloc_array(s->ps.sps->min_pu_width + 1, s->ps.sps->min_pu_height + 1);
+            if (!s->is_pcm)
+                return AVERROR(ENOMEM);
+        }
+        memset(s->is_pcm, 0, (s->ps.sps->min_pu_width + 1) * (s->ps.sps->min_pu_height + 1));
+    }
 
     s->is_decoded        = 0;
     s->first_nal_type    = s->nal_unit_type;
@@ -3487,6 +3503,11 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
 
     ff_hevc_reset_sei(&s->sei);
 
+    if (s->table_pool && !avctx->internal->is_copy)
+        av_log(avctx, AV_LOG_VERBOSE, "Frame tables high-water mark: %zu bytes\n",
+               ff_size_pool_max_allocated(s->table_pool));
+    av_buffer_unref(&s->table_pool);
+
     return 0;
 }
 
@@ -3527,6 +3548,10 @@ static av_cold int hevc_init_context(AVCodecContext *avctx)
     if (!s->md5_ctx)
         return AVERROR(ENOMEM);
 
+    s->table_pool = ff_size_pool_alloc();
+    if (!s->table_pool)
+        return AVERROR(ENOMEM);
+
     ff_bswapdsp_init(&s->bdsp);
 
     s->dovi_ctx.logctx = avctx;
@@ -3554,6 +3579,10 @@ static int hevc_update_thread_context(AVCodecContext *dst,
         }
     }
 
+    ret = av_buffer_replace(&s->table_pool, s0->table_pool);
+    if (ret < 0)
+        return ret;
+
     if (s->ps.sps != s0->ps.sps)
         s->ps.sps = NULL;
     for (i = 0; i < FF_ARRAY_ELEMS(s->ps.vps_list); i++) {
@@ -3716,7 +3745,8 @@ const FFCodec ff_hevc_decoder = {
     .p.capabilities        = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                              AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal         = FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP |
+                             FF_CODEC_CAP_FRAME_SLICE_THREADS,
     .p.profiles            = NULL_IF_CONFIG_SMALL(ff_hevc_profiles),
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_HEVC_DXVA2_HWACCEL
@@ -512,8 +512,11 @@ typedef struct HEVCContext {
     HEVCSEI sei;
     struct AVMD5 *md5_ctx;
 
-    AVBufferPool *tab_mvf_pool;
-    AVBufferPool *rpl_tab_pool;
+    /**
+     * Size class pool of the per-frame tables, shared between the frame
+     * threads and kept over SPS changes, see sizepool.h.
+     */
+    AVBufferRef *table_pool;
 
     ///< candidate references for the current frame
     RefPicList rps[5];
@@ -561,6 +564,13 @@ typedef struct HEVCContext {
     // CTB-level flags affecting loop filter operation
     uint8_t *filter_slice_edges;
 
+    /**
+     * Progress allowed by each CTB row once its loop filtering is done,
+     * 0 until then. Used when the rows are filtered by several slice threads
+     * of a frame thread, so that only the filtered rows above are reported.
+     */
+    atomic_int *row_progress;
+
     /** used on BE to byteswap the lines for checksumming */
     uint8_t *checksum_buf;
     int      checksum_buf_size;
@@ -72,6 +72,12 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * The slice threading context, kept apart from thread_ctx so that the
+     * contexts of the frame threads can use slice threading as well.
+     */
+    void *slice_thread_ctx;
+
     /**
      * This packet is used to hold the packet given to decoders
      * implementing the .decode API; it is unused by the generic
@@ -90,8 +90,18 @@ typedef struct Jpeg2000Tile {
     GetByteContext      packed_headers_stream;  // byte context corresponding to packed headers
     uint16_t tp_idx;                    // Tile-part index
     int coord[2][2];                    // border coordinates {{x0, x1}, {y0, y1}}
+    uint8_t coded[4];                   // whether a component has any coded code-block
 } Jpeg2000Tile;
 
+/* one code-block with data, decoded and dequantized by one slice job */
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Tile *tile;
+    Jpeg2000Band *band;
+    Jpeg2000Cblk *cblk;
+    int compno;
+    int bandpos;
+} Jpeg2000CblkJob;
+
 typedef struct Jpeg2000DecoderContext {
     AVClass         *class;
     AVCodecContext  *avctx;
@@ -134,6 +144,10 @@ typedef struct Jpeg2000DecoderContext {
     Jpeg2000Tile    *tile;
     Jpeg2000DSPContext dsp;
 
+    Jpeg2000CblkJob *cblk_jobs;
+    unsigned int    cblk_jobs_size;
+    int             nb_cblk_jobs;
+
     /*options parameters*/
     int             reduction_factor;
 } Jpeg2000DecoderContext;
@@ -1941,75 +1955,123 @@ static inline void roi_scale_cblk(Jpeg2000Cblk *cblk,
     }
 }
 
-static inline void tile_codeblocks(const Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
+/* Collect the code-blocks with data of all tiles, so that their Tier-1
+ * decoding can be spread over the slice threads even with a single tile. */
+static int setup_cblk_jobs(Jpeg2000DecoderContext *s)
 {
-    Jpeg2000T1Context t1;
-
-    int compno, reslevelno, bandno;
+    int nb_jobs = 0;
 
-    /* Loop on tile components */
-    for (compno = 0; compno < s->ncomponents; compno++) {
-        Jpeg2000Component *comp     = tile->comp + compno;
-        Jpeg2000CodingStyle *codsty = tile->codsty + compno;
-        int coded = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++) {
+            Jpeg2000Tile *tile = s->tile + tileno;
 
-        t1.stride = (1<<codsty->log2_cblk_width) + 2;
+            for (int compno = 0; compno < s->ncomponents; compno++) {
+                Jpeg2000Component *comp     = tile->comp + compno;
+                Jpeg2000CodingStyle *codsty = tile->codsty + compno;
 
-        /* Loop on resolution levels */
-        for (reslevelno = 0; reslevelno < codsty->nreslevels2decode; reslevelno++) {
-            Jpeg2000ResLevel *rlevel = comp->reslevel + reslevelno;
-            /* Loop on bands */
-            for (bandno = 0; bandno < rlevel->nbands; bandno++) {
-                int nb_precincts, precno;
-                Jpeg2000Band *band = rlevel->band + bandno;
-                int cblkno = 0, bandpos;
+                tile->coded[compno] = 0;
 
-                bandpos = bandno + (reslevelno > 0);
+                for (int reslevelno = 0; reslevelno < codsty->nreslevels2decode; reslevelno++) {
+                    Jpeg2000ResLevel *rlevel = comp->reslevel + reslevelno;
+                    int nb_precincts = rlevel->num_precincts_x * rlevel->num_precincts_y;
 
-                if (band->coord[0][0] == band->coord[0][1] ||
-                    band->coord[1][0] == band->coord[1][1])
-                    continue;
+                    for (int bandno = 0; bandno < rlevel->nbands; bandno++) {
+                        Jpeg2000Band *band = rlevel->band + bandno;
 
-                nb_precincts = rlevel->num_precincts_x * rlevel->num_precincts_y;
-                /* Loop on precincts */
-                for (precno = 0; precno < nb_precincts; precno++) {
-                    Jpeg2000Prec *prec = band->prec + precno;
-
-                    /* Loop on codeblocks */
-                    for (cblkno = 0;
-                         cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height;
-                         cblkno++) {
-                        int x, y;
-                        Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        int ret = decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos, comp->roi_shift);
-                        if (ret)
-                            coded = 1;
-                        else
+                        if (band->coord[0][0] == band->coord[0][1] ||
+                            band->coord[1][0] == band->coord[1][1])
                             continue;
-                        x = cblk->coord[0][0] - band->coord[0][0];
-                        y = cblk->coord[1][0] - band->coord[1][0];
-
-                        if (comp->roi_shift)
-                            roi_scale_cblk(cblk, comp, &t1);
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
-                        else if (codsty->transform == FF_DWT97_INT)
-                            dequantization_int_97(x, y, cblk, comp, &t1, band);
-                        else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
-                   } /* end cblk */
-                } /*end prec */
-            } /* end band */
-        } /* end reslevel */
 
-        /* inverse DWT */
-        if (coded)
-            ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+                        for (int precno = 0; precno < nb_precincts; precno++) {
+                            Jpeg2000Prec *prec = band->prec + precno;
+
+                            for (int cblkno = 0;
+                                 cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height;
+                                 cblkno++) {
+                                Jpeg2000Cblk *cblk = prec->cblk + cblkno;
+
+                                /* code-blocks without data decode to zeros */
+                                if (!cblk->length)
+                                    continue;
+
+                                tile->coded[compno] = 1;
+                                if (pass) {
+                                    Jpeg2000CblkJob *job = &s->cblk_jobs[nb_jobs];
+                                    job->tile    = tile;
+                                    job->band    = band;
+                                    job->cblk    = cblk;
+                                    job->compno  = compno;
+                                    job->bandpos = bandno + (reslevelno > 0);
+                                }
+                                nb_jobs++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!pass) {
+            av_fast_malloc(&s->cblk_jobs, &s->cblk_jobs_size,
+                           nb_jobs * sizeof(*s->cblk_jobs));
+            if (!s->cblk_jobs)
+                return AVERROR(ENOMEM);
+            s->nb_cblk_jobs = nb_jobs;
+            nb_jobs = 0;
+        }
+    }
 
-    } /*end comp */
+    return 0;
+}
+
+static int jpeg2000_decode_cblk(AVCodecContext *avctx, void *td,
+                                int jobnr, int threadnr)
+{
+    const Jpeg2000DecoderContext *s = avctx->priv_data;
+    const Jpeg2000CblkJob *job  = (const Jpeg2000CblkJob *)td + jobnr;
+    Jpeg2000Component *comp     = job->tile->comp + job->compno;
+    Jpeg2000CodingStyle *codsty = job->tile->codsty + job->compno;
+    Jpeg2000Band *band          = job->band;
+    Jpeg2000Cblk *cblk          = job->cblk;
+    Jpeg2000T1Context t1;
+    int x, y;
+
+    t1.stride = (1<<codsty->log2_cblk_width) + 2;
+
+    decode_cblk(s, codsty, &t1, cblk,
+                cblk->coord[0][1] - cblk->coord[0][0],
+                cblk->coord[1][1] - cblk->coord[1][0],
+                job->bandpos, comp->roi_shift);
+
+    x = cblk->coord[0][0] - band->coord[0][0];
+    y = cblk->coord[1][0] - band->coord[1][0];
+
+    if (comp->roi_shift)
+        roi_scale_cblk(cblk, comp, &t1);
+    if (codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, comp, &t1, band);
+    else if (codsty->transform == FF_DWT97_INT)
+        dequantization_int_97(x, y, cblk, comp, &t1, band);
+    else
+        dequantization_int(x, y, cblk, comp, &t1, band);
+
+    return 0;
+}
+
+static int jpeg2000_decode_dwt(AVCodecContext *avctx, void *td,
+                               int jobnr, int threadnr)
+{
+    const Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000Tile *tile          = s->tile + jobnr / s->ncomponents;
+    int compno                  = jobnr % s->ncomponents;
+    Jpeg2000Component *comp     = tile->comp + compno;
+    Jpeg2000CodingStyle *codsty = tile->codsty + compno;
+
+    /* inverse DWT */
+    if (tile->coded[compno])
+        ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+
+    return 0;
 }
 
 #define WRITE_FRAME(D, PIXEL)                                                                     \
@@ -2086,8 +2148,6 @@ static int jpeg2000_decode_tile(AVCodecContext *avctx, void *td,
     AVFrame *picture = td;
     Jpeg2000Tile *tile = s->tile + jobnr;
 
-    tile_codeblocks(s, tile);
-
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
         mct_decode(s, tile);
@@ -2477,6 +2537,16 @@ static av_cold int jpeg2000_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int jpeg2000_decode_close(AVCodecContext *avctx)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    av_freep(&s->cblk_jobs);
+    s->cblk_jobs_size = 0;
+
+    return 0;
+}
+
 static int jpeg2000_decode_frame(AVCodecContext *avctx, AVFrame *picture,
                                  int *got_frame, AVPacket *avpkt)
 {
@@ -2548,6 +2618,12 @@ static int jpeg2000_decode_frame(AVCodecContext *avctx, AVFrame *picture,
         }
     }
 
+    if ((ret = setup_cblk_jobs(s)) < 0)
+        goto end;
+
+    avctx->execute2(avctx, jpeg2000_decode_cblk, s->cblk_jobs, NULL, s->nb_cblk_jobs);
+    avctx->execute2(avctx, jpeg2000_decode_dwt, NULL, NULL,
+                    s->numXtiles * s->numYtiles * s->ncomponents);
     avctx->execute2(avctx, jpeg2000_decode_tile, picture, NULL, s->numXtiles * s->numYtiles);
 
     jpeg2000_dec_cleanup(s);
@@ -2588,6 +2664,7 @@ const FFCodec ff_jpeg2000_decoder = {
     .p.capabilities   = AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_DR1,
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init             = jpeg2000_decode_init,
+    .close            = jpeg2000_decode_close,
     FF_CODEC_DECODE_CB(jpeg2000_decode_frame),
     .p.priv_class     = &jpeg2000_class,
     .p.max_lowres     = 5,
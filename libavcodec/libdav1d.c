@@ -27,6 +27,7 @@
 #include "libavutil/mastering_display_metadata.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/threadpool.h"
 
 #include "atsc_a53.h"
 #include "avcodec.h"
@@ -216,6 +217,13 @@ static av_cold int libdav1d_init(AVCodecContext *c)
 #endif
     int res;
 
+    // libdav1d runs its own threads, but with a shared thread pool keep them
+    // within the thread budget of the pool.
+    if (c->thread_pool) {
+        int budget = av_thread_pool_nb_threads(c->thread_pool);
+        threads = threads > 0 ? FFMIN(threads, budget) : budget;
+    }
+
     av_log(c, AV_LOG_INFO, "libdav1d %s\n", dav1d_version());
 
     dav1d_default_settings(&s);
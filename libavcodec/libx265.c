@@ -499,14 +499,20 @@ static av_cold int libx265_encode_set_roi(libx265Context *ctx, const AVFrame *fr
     return 0;
 }
 
-static void free_picture(x265_picture *pic)
+static void free_sei_payloads(x265_sei *sei)
 {
-    x265_sei *sei = &pic->userSEI;
+    /* the unregistered user data payloads point to the frame side data */
     for (int i = 0; i < sei->numPayloads; i++)
-        av_free(sei->payloads[i].payload);
+        if (sei->payloads[i].payloadType != SEI_TYPE_USER_DATA_UNREGISTERED)
+            av_free(sei->payloads[i].payload);
+    sei->numPayloads = 0;
+}
+
+static void free_picture(x265_picture *pic)
+{
+    free_sei_payloads(&pic->userSEI);
     av_freep(&pic->userData);
     av_freep(&pic->quantOffsets);
-    sei->numPayloads = 0;
 }
 
 static int libx265_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
@@ -606,11 +612,8 @@ static int libx265_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                 ctx->sei_data = tmp;
                 sei->payloads = ctx->sei_data;
                 sei_payload = &sei->payloads[sei->numPayloads];
-                sei_payload->payload = av_memdup(side_data->data, side_data->size);
-                if (!sei_payload->payload) {
-                    free_picture(&x265pic);
-                    return AVERROR(ENOMEM);
-                }
+                /* x265 copies the payloads, no need to duplicate them */
+                sei_payload->payload = side_data->data;
                 sei_payload->payloadSize = side_data->size;
                 /* Equal to libx265 USER_DATA_UNREGISTERED */
                 sei_payload->payloadType = SEI_TYPE_USER_DATA_UNREGISTERED;
@@ -622,8 +625,7 @@ static int libx265_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     ret = ctx->api->encoder_encode(ctx->encoder, &nal, &nnal,
                                    pic ? &x265pic : NULL, &x265pic_out);
 
-    for (i = 0; i < sei->numPayloads; i++)
-        av_free(sei->payloads[i].payload);
+    free_sei_payloads(sei);
     av_freep(&x265pic.quantOffsets);
 
     if (ret < 0)
@@ -50,6 +50,7 @@
 #include "jpeglsdec.h"
 #include "profiles.h"
 #include "put_bits.h"
+#include "thread.h"
 #include "tiff.h"
 #include "exif.h"
 #include "bytestream.h"
@@ -712,7 +713,7 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
                 s->avctx->pix_fmt,
                 AV_PIX_FMT_NONE,
             };
-            s->hwaccel_pix_fmt = ff_get_format(s->avctx, pix_fmts);
+            s->hwaccel_pix_fmt = ff_thread_get_format(s->avctx, pix_fmts);
             if (s->hwaccel_pix_fmt < 0)
                 return AVERROR(EINVAL);
 
@@ -727,8 +728,8 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
             return 0;
         }
 
-        av_frame_unref(s->picture_ptr);
-        if (ff_get_buffer(s->avctx, s->picture_ptr, AV_GET_BUFFER_FLAG_REF) < 0)
+        ff_thread_release_buffer(s->avctx, s->picture_ptr);
+        if (ff_thread_get_buffer(s->avctx, s->picture_ptr, AV_GET_BUFFER_FLAG_REF) < 0)
             return -1;
         s->picture_ptr->pict_type = AV_PICTURE_TYPE_I;
         s->picture_ptr->key_frame = 1;
@@ -2184,6 +2185,29 @@ static int mjpeg_decode_com(MJpegDecodeContext *s)
     return 0;
 }
 
+/**
+ * Check that nothing but restart markers and EOI follows the scan starting
+ * at buf, i.e. that no further table, frame or scan header can change the
+ * decoder state once this scan has begun.
+ */
+static int scan_is_final(const uint8_t *buf, const uint8_t *buf_end)
+{
+    while (buf_end - buf > 1) {
+        const uint8_t *ff = memchr(buf, 0xff, buf_end - buf - 1);
+        int code;
+
+        if (!ff)
+            return 1;
+        code = ff[1];
+        if (code == EOI)
+            return 1;
+        if (code != 0x00 && code != 0xff && (code < RST0 || code > RST7))
+            return 0;
+        buf = ff + 1;
+    }
+    return 1;
+}
+
 /* return the 8 bit start code value and update the search
    state. Return -1 if no start code found */
 static int find_marker(const uint8_t **pbuf_ptr, const uint8_t *buf_end)
@@ -2557,6 +2581,10 @@ eoi_parser:
                 break;
             }
 
+            if (s->cur_scan == 1 && s->got_picture && !s->interlaced &&
+                !s->ls && !avctx->hwaccel && scan_is_final(buf_ptr, buf_end))
+                ff_thread_finish_setup(avctx);
+
             if ((ret = ff_mjpeg_decode_sos(s, NULL, 0, NULL)) < 0 &&
                 (avctx->err_recognition & AV_EF_EXPLODE))
                 goto fail;
@@ -2929,6 +2957,112 @@ static void decode_flush(AVCodecContext *avctx)
 }
 
 #if CONFIG_MJPEG_DECODER
+#if HAVE_THREADS
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    MJpegDecodeContext *sdst = dst->priv_data;
+    const MJpegDecodeContext *ssrc = src->priv_data;
+    int i, j, ret;
+
+    if (dst == src)
+        return 0;
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 4; j++) {
+            uint8_t bits_table[17];
+
+            if (!memcmp(sdst->raw_huffman_lengths[i][j], ssrc->raw_huffman_lengths[i][j], 16) &&
+                !memcmp(sdst->raw_huffman_values[i][j],  ssrc->raw_huffman_values[i][j], 256) &&
+                !!sdst->vlcs[i][j].table == !!ssrc->vlcs[i][j].table)
+                continue;
+
+            memcpy(sdst->raw_huffman_lengths[i][j], ssrc->raw_huffman_lengths[i][j], 16);
+            memcpy(sdst->raw_huffman_values[i][j],  ssrc->raw_huffman_values[i][j], 256);
+            ff_free_vlc(&sdst->vlcs[i][j]);
+            if (i)
+                ff_free_vlc(&sdst->vlcs[2][j]);
+            if (!ssrc->vlcs[i][j].table)
+                continue;
+
+            bits_table[0] = 0;
+            memcpy(bits_table + 1, ssrc->raw_huffman_lengths[i][j], 16);
+            ret = ff_mjpeg_build_vlc(&sdst->vlcs[i][j], bits_table,
+                                     ssrc->raw_huffman_values[i][j], i, dst);
+            if (ret < 0)
+                return ret;
+            if (i) {
+                ret = ff_mjpeg_build_vlc(&sdst->vlcs[2][j], bits_table,
+                                         ssrc->raw_huffman_values[i][j], 0, dst);
+                if (ret < 0)
+                    return ret;
+            }
+        }
+    }
+
+    memcpy(sdst->quant_matrixes, ssrc->quant_matrixes, sizeof(sdst->quant_matrixes));
+    memcpy(sdst->qscale,         ssrc->qscale,         sizeof(sdst->qscale));
+    memcpy(sdst->permutated_scantable, ssrc->permutated_scantable,
+           sizeof(sdst->permutated_scantable));
+    sdst->idsp = ssrc->idsp;
+
+    sdst->orig_height   = ssrc->orig_height;
+    sdst->first_picture = ssrc->first_picture;
+    sdst->interlaced    = ssrc->interlaced;
+    sdst->bottom_field  = ssrc->bottom_field;
+    sdst->lossless      = ssrc->lossless;
+    sdst->ls            = ssrc->ls;
+    sdst->progressive   = ssrc->progressive;
+    sdst->rgb           = ssrc->rgb;
+    sdst->rct           = ssrc->rct;
+    sdst->pegasus_rct   = ssrc->pegasus_rct;
+    sdst->bits          = ssrc->bits;
+    sdst->colr          = ssrc->colr;
+    sdst->xfrm          = ssrc->xfrm;
+    sdst->maxval        = ssrc->maxval;
+    sdst->near          = ssrc->near;
+    sdst->t1            = ssrc->t1;
+    sdst->t2            = ssrc->t2;
+    sdst->t3            = ssrc->t3;
+    sdst->reset         = ssrc->reset;
+    memcpy(sdst->upscale_h, ssrc->upscale_h, sizeof(sdst->upscale_h));
+    memcpy(sdst->upscale_v, ssrc->upscale_v, sizeof(sdst->upscale_v));
+
+    sdst->width         = ssrc->width;
+    sdst->height        = ssrc->height;
+    sdst->nb_components = ssrc->nb_components;
+    sdst->h_max         = ssrc->h_max;
+    sdst->v_max         = ssrc->v_max;
+    memcpy(sdst->component_id, ssrc->component_id, sizeof(sdst->component_id));
+    memcpy(sdst->h_count,      ssrc->h_count,      sizeof(sdst->h_count));
+    memcpy(sdst->v_count,      ssrc->v_count,      sizeof(sdst->v_count));
+    memcpy(sdst->quant_index,  ssrc->quant_index,  sizeof(sdst->quant_index));
+    memcpy(sdst->linesize,     ssrc->linesize,     sizeof(sdst->linesize));
+
+    sdst->buggy_avid         = ssrc->buggy_avid;
+    sdst->cs_itu601          = ssrc->cs_itu601;
+    sdst->interlace_polarity = ssrc->interlace_polarity;
+    sdst->multiscope         = ssrc->multiscope;
+    sdst->pix_desc           = ssrc->pix_desc;
+    sdst->hwaccel_pix_fmt    = ssrc->hwaccel_pix_fmt;
+    sdst->hwaccel_sw_pix_fmt = ssrc->hwaccel_sw_pix_fmt;
+
+    /* The second field of an interlaced picture is decoded into the frame
+     * allocated for the first one. */
+    sdst->cur_scan    = 0;
+    sdst->got_picture = 0;
+    ff_thread_release_buffer(dst, sdst->picture_ptr);
+    if (ssrc->interlaced && ssrc->got_picture &&
+        ssrc->bottom_field == !ssrc->interlace_polarity) {
+        ret = av_frame_ref(sdst->picture_ptr, ssrc->picture_ptr);
+        if (ret < 0)
+            return ret;
+        sdst->got_picture = 1;
+    }
+
+    return 0;
+}
+#endif
+
 #define OFFSET(x) offsetof(MJpegDecodeContext, x)
 #define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
 static const AVOption options[] = {
@@ -2953,8 +3087,9 @@ const FFCodec ff_mjpeg_decoder = {
     .init           = ff_mjpeg_decode_init,
     .close          = ff_mjpeg_decode_end,
     FF_CODEC_DECODE_CB(ff_mjpeg_decode_frame),
+    UPDATE_THREAD_CONTEXT(update_thread_context),
     .flush          = decode_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
     .p.max_lowres   = 3,
     .p.priv_class   = &mjpegdec_class,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
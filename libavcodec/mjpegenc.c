@@ -54,6 +54,9 @@ typedef struct MJPEGEncContext {
     MJpegContext   mjpeg;
 } MJPEGEncContext;
 
+/* table_id of the entries marking the end of a macroblock row */
+#define HUFF_TABLE_RESTART 4
+
 static av_cold void init_uni_ac_vlc(const uint8_t huff_size_ac[256],
                                     uint8_t *uni_ac_vlc_len)
 {
@@ -95,8 +98,18 @@ void ff_mjpeg_amv_encode_picture_header(MpegEncContext *s)
     MJPEGEncContext *const m = (MJPEGEncContext*)s;
     av_assert2(s->mjpeg_ctx == &m->mjpeg);
     /* s->huffman == HUFFMAN_TABLE_OPTIMAL can only be true for MJPEG. */
-    if (!CONFIG_MJPEG_ENCODER || m->mjpeg.huffman != HUFFMAN_TABLE_OPTIMAL)
+    if (!CONFIG_MJPEG_ENCODER || m->mjpeg.huffman != HUFFMAN_TABLE_OPTIMAL) {
         mjpeg_encode_picture_header(s);
+        return;
+    }
+
+    /* Every slice context records its codes into its own part of the buffer. */
+    for (int i = 0; i < s->slice_context_count; i++) {
+        MpegEncContext *const ctx = s->thread_context[i];
+        ctx->huff_buffer = m->mjpeg.huff_buffer +
+                           ctx->start_mb_y * m->mjpeg.huff_row_codes;
+        ctx->huff_ncode  = 0;
+    }
 }
 
 #if CONFIG_MJPEG_ENCODER
@@ -122,9 +135,9 @@ static void mjpeg_encode_picture_frame(MpegEncContext *s)
 
     s->header_bits = get_bits_diff(s);
     // Estimate the total size first
-    for (int i = 0; i < m->huff_ncode; i++) {
-        table_id = m->huff_buffer[i].table_id;
-        code = m->huff_buffer[i].code;
+    for (int i = 0; i < s->huff_ncode; i++) {
+        table_id = s->huff_buffer[i].table_id;
+        code = s->huff_buffer[i].code;
         nbits = code & 0xf;
 
         total_bits += huff_size[table_id][code] + nbits;
@@ -133,31 +146,33 @@ static void mjpeg_encode_picture_frame(MpegEncContext *s)
     bytes_needed = (total_bits + 7) / 8;
     ff_mpv_reallocate_putbitbuffer(s, bytes_needed, bytes_needed);
 
-    for (int i = 0; i < m->huff_ncode; i++) {
-        table_id = m->huff_buffer[i].table_id;
-        code = m->huff_buffer[i].code;
+    for (int i = 0; i < s->huff_ncode; i++) {
+        table_id = s->huff_buffer[i].table_id;
+        code = s->huff_buffer[i].code;
         nbits = code & 0xf;
 
         put_bits(&s->pb, huff_size[table_id][code], huff_code[table_id][code]);
         if (nbits != 0) {
-            put_sbits(&s->pb, nbits, m->huff_buffer[i].mant);
+            put_sbits(&s->pb, nbits, s->huff_buffer[i].mant);
         }
     }
 
-    m->huff_ncode = 0;
+    s->huff_ncode = 0;
     s->i_tex_bits = get_bits_diff(s);
 }
 
 /**
  * Builds all 4 optimal Huffman tables.
  *
- * Uses the data stored in the JPEG buffer to compute the tables.
+ * Uses the data stored in the JPEG buffers of all slice contexts to compute
+ * the tables.
  * Stores the Huffman tables in the bits_* and val_* arrays in the MJpegContext.
  *
- * @param m MJpegContext containing the JPEG buffer.
+ * @param s The MpegEncContext.
  */
-static void mjpeg_build_optimal_huffman(MJpegContext *m)
+static void mjpeg_build_optimal_huffman(MpegEncContext *s)
 {
+    MJpegContext *const m = s->mjpeg_ctx;
     MJpegEncHuffmanContext dc_luminance_ctx;
     MJpegEncHuffmanContext dc_chrominance_ctx;
     MJpegEncHuffmanContext ac_luminance_ctx;
@@ -169,11 +184,16 @@ static void mjpeg_build_optimal_huffman(MJpegContext *m)
     for (int i = 0; i < 4; i++)
         ff_mjpeg_encode_huffman_init(ctx[i]);
 
-    for (int i = 0; i < m->huff_ncode; i++) {
-        int table_id = m->huff_buffer[i].table_id;
-        int code     = m->huff_buffer[i].code;
+    for (int j = 0; j < s->slice_context_count; j++) {
+        const MpegEncContext *const sctx = s->thread_context[j];
+
+        for (int i = 0; i < sctx->huff_ncode; i++) {
+            int table_id = sctx->huff_buffer[i].table_id;
+            int code     = sctx->huff_buffer[i].code;
 
-        ff_mjpeg_encode_huffman_increment(ctx[table_id], code);
+            if (table_id != HUFF_TABLE_RESTART)
+                ff_mjpeg_encode_huffman_increment(ctx[table_id], code);
+        }
     }
 
     ff_mjpeg_encode_huffman_close(&dc_luminance_ctx,
@@ -206,7 +226,121 @@ static void mjpeg_build_optimal_huffman(MJpegContext *m)
                                  m->bits_ac_chrominance,
                                  m->val_ac_chrominance);
 }
+
+/**
+ * Builds the optimal Huffman tables and writes the picture header using them.
+ *
+ * @param s The MpegEncContext.
+ */
+static void mjpeg_encode_optimal_header(MpegEncContext *s)
+{
+    MJpegContext *const m = s->mjpeg_ctx;
+
+    mjpeg_build_optimal_huffman(s);
+
+    // Replace the VLCs with the optimal ones.
+    // The default ones may be used for trellis during quantization.
+    init_uni_ac_vlc(m->huff_size_ac_luminance,   m->uni_ac_vlc_len);
+    init_uni_ac_vlc(m->huff_size_ac_chrominance, m->uni_chroma_ac_vlc_len);
+    s->intra_ac_vlc_length      =
+    s->intra_ac_vlc_last_length = m->uni_ac_vlc_len;
+    s->intra_chroma_ac_vlc_length      =
+    s->intra_chroma_ac_vlc_last_length = m->uni_chroma_ac_vlc_len;
+
+    mjpeg_encode_picture_header(s);
+}
+
+/**
+ * Writes the codes recorded by one slice context, including the restart
+ * markers between its macroblock rows.
+ */
+static int mjpeg_encode_slice_codes(AVCodecContext *avctx, void *arg)
+{
+    MpegEncContext *const s = *(void**)arg;
+    MJpegContext *const m = s->mjpeg_ctx;
+    const uint8_t  *huff_size[4] = { m->huff_size_dc_luminance,
+                                     m->huff_size_dc_chrominance,
+                                     m->huff_size_ac_luminance,
+                                     m->huff_size_ac_chrominance };
+    const uint16_t *huff_code[4] = { m->huff_code_dc_luminance,
+                                     m->huff_code_dc_chrominance,
+                                     m->huff_code_ac_luminance,
+                                     m->huff_code_ac_chrominance };
+    int bits = put_bits_count(&s->pb);
+    size_t total_bits = 0;
+
+    for (int i = 0; i < s->huff_ncode; i++) {
+        const MJpegHuffmanCode *c = &s->huff_buffer[i];
+
+        if (c->table_id == HUFF_TABLE_RESTART)
+            total_bits += 24; // padding and marker
+        else
+            total_bits += huff_size[c->table_id][c->code] + (c->code & 0xf);
+    }
+
+    // Escaping may double the size of the entropy-coded data.
+    if (put_bytes_left(&s->pb, 0) < (total_bits + 7) / 8 * 2) {
+        av_log(avctx, AV_LOG_ERROR, "encoded frame too large\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (int i = 0; i < s->huff_ncode; i++) {
+        const MJpegHuffmanCode *c = &s->huff_buffer[i];
+        int table_id = c->table_id;
+        int code     = c->code;
+        int nbits    = code & 0xf;
+
+        if (table_id == HUFF_TABLE_RESTART) {
+            ff_mjpeg_escape_FF(&s->pb, s->esc_pos);
+            if (code != 0xFF)
+                put_marker(&s->pb, RST0 + code);
+            s->esc_pos = put_bytes_count(&s->pb, 0);
+            continue;
+        }
+
+        put_bits(&s->pb, huff_size[table_id][code], huff_code[table_id][code]);
+        if (nbits != 0)
+            put_sbits(&s->pb, nbits, c->mant);
+    }
+
+    flush_put_bits(&s->pb);
+
+    s->huff_ncode  = 0;
+    s->i_tex_bits += put_bits_count(&s->pb) - bits;
+    return 0;
+}
+#endif
+
+/**
+ * Writes the picture header and the entropy-coded data of all slices when
+ * optimal Huffman tables are used with slice threading.
+ *
+ * Must be called after the slice contexts have been encoded and before they
+ * are merged; the entropy coding of the slices runs in parallel.
+ *
+ * @param s The MpegEncContext.
+ * @return int Error code, 0 if successful.
+ */
+int ff_mjpeg_encode_picture_slices(MpegEncContext *s)
+{
+#if CONFIG_MJPEG_ENCODER
+    MJpegContext *const m = s->mjpeg_ctx;
+    int ret[MAX_THREADS];
+
+    if (m->huffman != HUFFMAN_TABLE_OPTIMAL || s->slice_context_count == 1)
+        return 0;
+
+    mjpeg_encode_optimal_header(s);
+    s->header_bits = get_bits_diff(s);
+
+    s->avctx->execute(s->avctx, mjpeg_encode_slice_codes, s->thread_context,
+                      ret, s->slice_context_count, sizeof(void*));
+    for (int i = 0; i < s->slice_context_count; i++)
+        if (ret[i] < 0)
+            return ret[i];
 #endif
+    return 0;
+}
 
 /**
  * Writes the complete JPEG frame when optimal huffman tables are enabled,
@@ -226,19 +360,17 @@ int ff_mjpeg_encode_stuffing(MpegEncContext *s)
 
 #if CONFIG_MJPEG_ENCODER
     if (m->huffman == HUFFMAN_TABLE_OPTIMAL) {
+        if (s->slice_context_count > 1) {
+            // The codes are written by ff_mjpeg_encode_picture_slices() once
+            // the tables are known; remember where the restart marker goes.
+            MJpegHuffmanCode *c = &s->huff_buffer[s->huff_ncode++];
+            c->table_id = HUFF_TABLE_RESTART;
+            c->code     = mb_y < s->mb_height - 1 ? mb_y & 7 : 0xFF;
+            ret = 0;
+            goto fail;
+        }
 
-        mjpeg_build_optimal_huffman(m);
-
-        // Replace the VLCs with the optimal ones.
-        // The default ones may be used for trellis during quantization.
-        init_uni_ac_vlc(m->huff_size_ac_luminance,   m->uni_ac_vlc_len);
-        init_uni_ac_vlc(m->huff_size_ac_chrominance, m->uni_chroma_ac_vlc_len);
-        s->intra_ac_vlc_length      =
-        s->intra_ac_vlc_last_length = m->uni_ac_vlc_len;
-        s->intra_chroma_ac_vlc_length      =
-        s->intra_chroma_ac_vlc_last_length = m->uni_chroma_ac_vlc_len;
-
-        mjpeg_encode_picture_header(s);
+        mjpeg_encode_optimal_header(s);
         mjpeg_encode_picture_frame(s);
     }
 #endif
@@ -266,7 +398,7 @@ fail:
 static int alloc_huffman(MpegEncContext *s)
 {
     MJpegContext *m = s->mjpeg_ctx;
-    size_t num_mbs, num_blocks, num_codes;
+    size_t num_codes;
     int blocks_per_mb;
 
     // We need to init this here as the mjpeg init is called before the common init,
@@ -280,10 +412,10 @@ static int alloc_huffman(MpegEncContext *s)
     default: av_assert0(0);
     };
 
-    // Make sure we have enough space to hold this frame.
-    num_mbs = s->mb_width * s->mb_height;
-    num_blocks = num_mbs * blocks_per_mb;
-    num_codes = num_blocks * 64;
+    // Make sure we have enough space to hold this frame; every macroblock
+    // row also has room for the restart entry ending it.
+    m->huff_row_codes = (size_t)s->mb_width * blocks_per_mb * 64 + 1;
+    num_codes = s->mb_height * m->huff_row_codes;
 
     m->huff_buffer = av_malloc_array(num_codes, sizeof(MJpegHuffmanCode));
     if (!m->huff_buffer)
@@ -294,14 +426,11 @@ static int alloc_huffman(MpegEncContext *s)
 av_cold int ff_mjpeg_encode_init(MpegEncContext *s)
 {
     MJpegContext *const m = &((MJPEGEncContext*)s)->mjpeg;
-    int ret, use_slices;
+    int ret;
 
     s->mjpeg_ctx = m;
-    use_slices = s->avctx->slices > 0 ? s->avctx->slices > 1 :
-                 (s->avctx->active_thread_type & FF_THREAD_SLICE) &&
-                 s->avctx->thread_count > 1;
 
-    if (s->codec_id == AV_CODEC_ID_AMV || use_slices)
+    if (s->codec_id == AV_CODEC_ID_AMV)
         m->huffman = HUFFMAN_TABLE_DEFAULT;
 
     if (s->mpv_flags & FF_MPV_FLAG_QP_RD) {
@@ -352,9 +481,6 @@ av_cold int ff_mjpeg_encode_init(MpegEncContext *s)
     s->intra_chroma_ac_vlc_length      =
     s->intra_chroma_ac_vlc_last_length = m->uni_chroma_ac_vlc_len;
 
-    // Buffers start out empty.
-    m->huff_ncode = 0;
-
     if (m->huffman == HUFFMAN_TABLE_OPTIMAL)
         return alloc_huffman(s);
 
@@ -372,11 +498,11 @@ static av_cold int mjpeg_encode_close(AVCodecContext *avctx)
 /**
  * Add code and table_id to the JPEG buffer.
  *
- * @param s The MJpegContext which contains the JPEG buffer.
+ * @param s The MpegEncContext which contains the JPEG buffer.
  * @param table_id Which Huffman table the code belongs to.
  * @param code The encoded exponent of the coefficients and the run-bits.
  */
-static inline void ff_mjpeg_encode_code(MJpegContext *s, uint8_t table_id, int code)
+static inline void ff_mjpeg_encode_code(MpegEncContext *s, uint8_t table_id, int code)
 {
     MJpegHuffmanCode *c = &s->huff_buffer[s->huff_ncode++];
     c->table_id = table_id;
@@ -386,12 +512,12 @@ static inline void ff_mjpeg_encode_code(MJpegContext *s, uint8_t table_id, int c
 /**
  * Add the coefficient's data to the JPEG buffer.
  *
- * @param s The MJpegContext which contains the JPEG buffer.
+ * @param s The MpegEncContext which contains the JPEG buffer.
  * @param table_id Which Huffman table the code belongs to.
  * @param val The coefficient.
  * @param run The run-bits.
  */
-static void ff_mjpeg_encode_coef(MJpegContext *s, uint8_t table_id, int val, int run)
+static void ff_mjpeg_encode_coef(MpegEncContext *s, uint8_t table_id, int val, int run)
 {
     int mant, code;
 
@@ -423,7 +549,6 @@ static void record_block(MpegEncContext *s, int16_t *block, int n)
 {
     int i, j, table_id;
     int component, dc, last_index, val, run;
-    MJpegContext *m = s->mjpeg_ctx;
 
     /* DC coef */
     component = (n <= 3 ? 0 : (n&1) + 1);
@@ -431,7 +556,7 @@ static void record_block(MpegEncContext *s, int16_t *block, int n)
     dc = block[0]; /* overflow is impossible */
     val = dc - s->last_dc[component];
 
-    ff_mjpeg_encode_coef(m, table_id, val, 0);
+    ff_mjpeg_encode_coef(s, table_id, val, 0);
 
     s->last_dc[component] = dc;
 
@@ -449,17 +574,17 @@ static void record_block(MpegEncContext *s, int16_t *block, int n)
             run++;
         } else {
             while (run >= 16) {
-                ff_mjpeg_encode_code(m, table_id, 0xf0);
+                ff_mjpeg_encode_code(s, table_id, 0xf0);
                 run -= 16;
             }
-            ff_mjpeg_encode_coef(m, table_id, val, run);
+            ff_mjpeg_encode_coef(s, table_id, val, run);
             run = 0;
         }
     }
 
     /* output EOB only if not already 64 values */
     if (last_index < 63 || run != 0)
-        ff_mjpeg_encode_code(m, table_id, 0);
+        ff_mjpeg_encode_code(s, table_id, 0);
 }
 
 static void encode_block(MpegEncContext *s, int16_t *block, int n)
@@ -44,10 +44,11 @@
  *
  * Optimal Huffman table generation requires the frame data to be loaded into
  * a buffer so that the tables can be computed.
- * There are at most mb_width*mb_height*12*64 of these per frame.
+ * There are at most mb_width*mb_height*12*64 of these per frame, plus one
+ * restart entry per macroblock row with slices.
  */
 typedef struct MJpegHuffmanCode {
-    // 0=DC lum, 1=DC chrom, 2=AC lum, 3=AC chrom
+    // 0=DC lum, 1=DC chrom, 2=AC lum, 3=AC chrom, 4=restart marker
     uint8_t table_id; ///< The Huffman table id associated with the data.
     uint8_t code;     ///< The exponent.
     uint16_t mant;    ///< The mantissa.
@@ -88,8 +89,8 @@ typedef struct MJpegContext {
     uint8_t bits_ac_chrominance[17]; ///< AC chrominance Huffman bits.
     uint8_t val_ac_chrominance[256]; ///< AC chrominance Huffman values.
 
-    size_t huff_ncode;               ///< Number of current entries in the buffer.
     MJpegHuffmanCode *huff_buffer;   ///< Buffer for Huffman code values.
+    size_t huff_row_codes;           ///< Room for the codes of a macroblock row.
 } MJpegContext;
 
 /**
@@ -111,5 +112,6 @@ int  ff_mjpeg_encode_init(MpegEncContext *s);
 void ff_mjpeg_amv_encode_picture_header(MpegEncContext *s);
 void ff_mjpeg_encode_mb(MpegEncContext *s, int16_t block[12][64]);
 int  ff_mjpeg_encode_stuffing(MpegEncContext *s);
+int  ff_mjpeg_encode_picture_slices(MpegEncContext *s);
 
 #endif /* AVCODEC_MJPEGENC_H */
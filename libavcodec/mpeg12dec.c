@@ -57,6 +57,7 @@
 #include "profiles.h"
 #include "startcode.h"
 #include "thread.h"
+#include "threadframe.h"
 
 #define A53_MAX_CC_COUNT 2000
 
@@ -1088,6 +1089,27 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx,
     if (!ctx->mpeg_enc_ctx_allocated)
         memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
 
+    /* Sequence and GOP level state persists across pictures and may have
+     * been updated by a packet decoded in another thread. */
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
+    s->progressive_sequence    = s1->progressive_sequence;
+
+    ctx->aspect_ratio_info     = ctx_from->aspect_ratio_info;
+    ctx->save_aspect           = ctx_from->save_aspect;
+    ctx->save_width            = ctx_from->save_width;
+    ctx->save_height           = ctx_from->save_height;
+    ctx->save_progressive_seq  = ctx_from->save_progressive_seq;
+    ctx->rc_buffer_size        = ctx_from->rc_buffer_size;
+    ctx->frame_rate_ext        = ctx_from->frame_rate_ext;
+    ctx->frame_rate_index      = ctx_from->frame_rate_index;
+    ctx->sync                  = ctx_from->sync;
+    ctx->closed_gop            = ctx_from->closed_gop;
+    ctx->tmpgexs               = ctx_from->tmpgexs;
+    ctx->timecode_frame_start  = ctx_from->timecode_frame_start;
+
     return 0;
 }
 #endif
@@ -1638,7 +1660,9 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
             s1->has_afd = 0;
         }
 
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+        /* for field pairs, wait until the second field has been set up */
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+            s->picture_structure == PICT_FRAME)
             ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
@@ -1662,6 +1686,9 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
                 s->current_picture.f->data[i] +=
                     s->current_picture_ptr->f->linesize[i];
         }
+
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+            ff_thread_finish_setup(avctx);
     }
 
     if (avctx->hwaccel) {
@@ -1829,7 +1856,10 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
             int left;
 
             ff_mpeg_draw_horiz_band(s, mb_size * (s->mb_y >> field_pic), mb_size);
-            ff_mpv_report_decode_progress(s);
+            /* a field only covers every other line of the reported rows,
+             * field pictures report their progress when the frame ends */
+            if (!field_pic)
+                ff_mpv_report_decode_progress(s);
 
             s->mb_x  = 0;
             s->mb_y += 1 << field_pic;
@@ -2817,6 +2847,9 @@ static int mpeg_decode_frame(AVCodecContext *avctx, AVFrame *picture,
 
     ret = decode_chunks(avctx, picture, got_output, buf, buf_size);
     if (ret<0 || *got_output) {
+        /* do not leave other frame threads waiting on an abandoned picture */
+        if (ret < 0 && s2->current_picture_ptr)
+            ff_thread_report_progress(&s2->current_picture_ptr->tf, INT_MAX, 0);
         s2->current_picture_ptr = NULL;
 
         if (s->timecode_frame_start != -1 && *got_output) {
@@ -2871,8 +2904,10 @@ const FFCodec ff_mpeg1video_decoder = {
 #if FF_API_FLAG_TRUNCATED
                              AV_CODEC_CAP_TRUNCATED |
 #endif
-                             AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal         = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                             AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
+                             AV_CODEC_CAP_FRAME_THREADS,
+    .caps_internal         = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush                 = flush,
     .p.max_lowres          = 3,
     UPDATE_THREAD_CONTEXT(mpeg_decode_update_thread_context),
@@ -2903,11 +2938,14 @@ const FFCodec ff_mpeg2video_decoder = {
 #if FF_API_FLAG_TRUNCATED
                       AV_CODEC_CAP_TRUNCATED |
 #endif
-                      AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                      AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_FRAME_THREADS,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush          = flush,
     .p.max_lowres   = 3,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_mpeg2_video_profiles),
+    UPDATE_THREAD_CONTEXT(mpeg_decode_update_thread_context),
     .hw_configs     = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_MPEG2_DXVA2_HWACCEL
                         HWACCEL_DXVA2(mpeg2),
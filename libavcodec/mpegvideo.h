@@ -412,6 +412,8 @@ typedef struct MpegEncContext {
     /* MJPEG specific */
     struct MJpegContext *mjpeg_ctx;
     int esc_pos;
+    struct MJpegHuffmanCode *huff_buffer; ///< codes of this slice context, for optimal Huffman tables
+    size_t huff_ncode;                    ///< number of codes in huff_buffer
 
     /* MSMPEG4 specific */
     int mv_table_index;
@@ -3825,6 +3825,11 @@ static int encode_picture(MpegEncContext *s, int picture_number)
         update_duplicate_context_after_me(s->thread_context[i], s);
     }
     s->avctx->execute(s->avctx, encode_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+    if (CONFIG_MJPEG_ENCODER && s->out_format == FMT_MJPEG) {
+        ret = ff_mjpeg_encode_picture_slices(s);
+        if (ret < 0)
+            return ret;
+    }
     for(i=1; i<context_count; i++){
         if (s->pb.buf_end == s->thread_context[i]->pb.buf)
             set_put_bits_buffer_size(&s->pb, FFMIN(s->thread_context[i]->pb.buf_end - s->pb.buf, INT_MAX/8-BUF_BITS));
@@ -1814,6 +1814,191 @@ static av_cold int nvenc_setup_extradata(AVCodecContext *avctx)
     return 0;
 }
 
+#if HAVE_THREADS
+static int nvenc_output_thread_lock(AVCodecContext *avctx, NvencSurface *surf)
+{
+    NvencContext *ctx = avctx->priv_data;
+    NvencDynLoadFunctions *dl_fn = &ctx->nvenc_dload_funcs;
+    NV_ENCODE_API_FUNCTION_LIST *p_nvenc = &dl_fn->nvenc_funcs;
+    NV_ENC_LOCK_BITSTREAM *lock_params = &surf->lock_params;
+    NVENCSTATUS nv_status;
+    int res, res2;
+
+    memset(lock_params, 0, sizeof(*lock_params));
+    lock_params->version = NV_ENC_LOCK_BITSTREAM_VER;
+    lock_params->doNotWait = 0;
+    lock_params->outputBitstream = surf->output_surface;
+
+    res = nvenc_push_context(avctx);
+    if (res < 0)
+        return res;
+
+    nv_status = p_nvenc->nvEncLockBitstream(ctx->nvencoder, lock_params);
+    if (nv_status != NV_ENC_SUCCESS) {
+        res = nvenc_print_error(avctx, nv_status, "Failed locking bitstream buffer");
+        goto end;
+    }
+
+    av_fast_padded_malloc(&surf->bitstream, &surf->bitstream_size,
+                          lock_params->bitstreamSizeInBytes);
+    if (surf->bitstream)
+        memcpy(surf->bitstream, lock_params->bitstreamBufferPtr,
+               lock_params->bitstreamSizeInBytes);
+    else
+        res = AVERROR(ENOMEM);
+    lock_params->bitstreamBufferPtr = NULL;
+
+    nv_status = p_nvenc->nvEncUnlockBitstream(ctx->nvencoder, surf->output_surface);
+    if (nv_status != NV_ENC_SUCCESS && res >= 0)
+        res = nvenc_print_error(avctx, nv_status, "Failed unlocking bitstream buffer");
+
+end:
+    res2 = nvenc_pop_context(avctx);
+    return res < 0 ? res : res2;
+}
+
+/*
+ * Waits for encoded pictures to complete and copies them out of the
+ * bitstream buffers, so that receive_packet() never blocks inside
+ * nvEncLockBitstream() while there are still frames to submit.
+ */
+static void *nvenc_output_thread(void *arg)
+{
+    AVCodecContext *avctx = arg;
+    NvencContext *ctx = avctx->priv_data;
+    NvencSurface *surf;
+
+    pthread_mutex_lock(&ctx->output_mutex);
+    while (1) {
+        while (!ctx->output_thread_exit &&
+               !av_fifo_can_read(ctx->output_surface_ready_queue))
+            pthread_cond_wait(&ctx->output_cond, &ctx->output_mutex);
+        if (ctx->output_thread_exit)
+            break;
+
+        av_fifo_read(ctx->output_surface_ready_queue, &surf, 1);
+        pthread_mutex_unlock(&ctx->output_mutex);
+
+        surf->lock_ret = nvenc_output_thread_lock(avctx, surf);
+
+        pthread_mutex_lock(&ctx->output_mutex);
+        av_fifo_write(ctx->output_surface_done_queue, &surf, 1);
+        pthread_cond_signal(&ctx->output_done_cond);
+    }
+    pthread_mutex_unlock(&ctx->output_mutex);
+
+    return NULL;
+}
+#endif
+
+static av_cold int nvenc_output_thread_init(AVCodecContext *avctx)
+{
+    NvencContext *ctx = avctx->priv_data;
+#if HAVE_THREADS
+    int ret;
+
+    ctx->output_surface_done_queue = av_fifo_alloc2(ctx->nb_surfaces, sizeof(NvencSurface*), 0);
+    if (!ctx->output_surface_done_queue)
+        return AVERROR(ENOMEM);
+
+    pthread_mutex_init(&ctx->output_mutex, NULL);
+    pthread_cond_init(&ctx->output_cond, NULL);
+    pthread_cond_init(&ctx->output_done_cond, NULL);
+
+    ret = pthread_create(&ctx->output_tid, NULL, nvenc_output_thread, avctx);
+    if (ret) {
+        pthread_cond_destroy(&ctx->output_done_cond);
+        pthread_cond_destroy(&ctx->output_cond);
+        pthread_mutex_destroy(&ctx->output_mutex);
+        av_log(avctx, AV_LOG_ERROR, "Failed to create output thread\n");
+        return AVERROR(ret);
+    }
+    ctx->output_thread_running = 1;
+#else
+    av_log(avctx, AV_LOG_WARNING, "Output thread requested, but threads are not supported\n");
+    ctx->output_thread = 0;
+#endif
+
+    return 0;
+}
+
+static av_cold void nvenc_output_thread_uninit(AVCodecContext *avctx)
+{
+    NvencContext *ctx = avctx->priv_data;
+
+#if HAVE_THREADS
+    if (ctx->output_thread_running) {
+        pthread_mutex_lock(&ctx->output_mutex);
+        ctx->output_thread_exit = 1;
+        pthread_cond_signal(&ctx->output_cond);
+        pthread_mutex_unlock(&ctx->output_mutex);
+
+        pthread_join(ctx->output_tid, NULL);
+
+        pthread_cond_destroy(&ctx->output_done_cond);
+        pthread_cond_destroy(&ctx->output_cond);
+        pthread_mutex_destroy(&ctx->output_mutex);
+        ctx->output_thread_running = 0;
+    }
+#endif
+
+    av_fifo_freep2(&ctx->output_surface_done_queue);
+}
+
+/* Hand all pictures completed by the encoder over for output. */
+static void nvenc_output_surfaces_ready(AVCodecContext *avctx)
+{
+    NvencContext *ctx = avctx->priv_data;
+    NvencSurface *tmp_out_surf;
+
+#if HAVE_THREADS
+    if (ctx->output_thread_running) {
+        pthread_mutex_lock(&ctx->output_mutex);
+        while (av_fifo_read(ctx->output_surface_queue, &tmp_out_surf, 1) >= 0) {
+            av_fifo_write(ctx->output_surface_ready_queue, &tmp_out_surf, 1);
+            ctx->nb_output_in_flight++;
+        }
+        pthread_cond_signal(&ctx->output_cond);
+        pthread_mutex_unlock(&ctx->output_mutex);
+        return;
+    }
+#endif
+
+    while (av_fifo_read(ctx->output_surface_queue, &tmp_out_surf, 1) >= 0)
+        av_fifo_write(ctx->output_surface_ready_queue, &tmp_out_surf, 1);
+}
+
+/*
+ * Fetch a surface whose bitstream has been copied out by the output thread.
+ * If block is set, wait for one as long as any are still in flight.
+ */
+static int nvenc_output_thread_get(AVCodecContext *avctx, int block,
+                                   NvencSurface **surf)
+{
+#if HAVE_THREADS
+    NvencContext *ctx = avctx->priv_data;
+    int ret = 0;
+
+    pthread_mutex_lock(&ctx->output_mutex);
+    while (!av_fifo_can_read(ctx->output_surface_done_queue)) {
+        if (!block || !ctx->nb_output_in_flight) {
+            ret = AVERROR(EAGAIN);
+            break;
+        }
+        pthread_cond_wait(&ctx->output_done_cond, &ctx->output_mutex);
+    }
+    if (!ret) {
+        av_fifo_read(ctx->output_surface_done_queue, surf, 1);
+        ctx->nb_output_in_flight--;
+    }
+    pthread_mutex_unlock(&ctx->output_mutex);
+
+    return ret;
+#else
+    return AVERROR(EAGAIN);
+#endif
+}
+
 av_cold int ff_nvenc_encode_close(AVCodecContext *avctx)
 {
     NvencContext *ctx               = avctx->priv_data;
@@ -1821,6 +2006,8 @@ av_cold int ff_nvenc_encode_close(AVCodecContext *avctx)
     NV_ENCODE_API_FUNCTION_LIST *p_nvenc = &dl_fn->nvenc_funcs;
     int i, res;
 
+    nvenc_output_thread_uninit(avctx);
+
     /* the encoder has to be flushed before it can be closed */
     if (ctx->nvencoder) {
         NV_ENC_PIC_PARAMS params        = { .version        = NV_ENC_PIC_PARAMS_VER,
@@ -1853,6 +2040,7 @@ av_cold int ff_nvenc_encode_close(AVCodecContext *avctx)
             if (avctx->pix_fmt != AV_PIX_FMT_CUDA && avctx->pix_fmt != AV_PIX_FMT_D3D11)
                 p_nvenc->nvEncDestroyInputBuffer(ctx->nvencoder, ctx->surfaces[i].input_surface);
             av_frame_free(&ctx->surfaces[i].in_ref);
+            av_freep(&ctx->surfaces[i].bitstream);
             p_nvenc->nvEncDestroyBitstreamBuffer(ctx->nvencoder, ctx->surfaces[i].output_surface);
         }
     }
@@ -1932,6 +2120,9 @@ av_cold int ff_nvenc_encode_init(AVCodecContext *avctx)
     if ((ret = nvenc_setup_surfaces(avctx)) < 0)
         return ret;
 
+    if (ctx->output_thread && (ret = nvenc_output_thread_init(avctx)) < 0)
+        return ret;
+
     if (avctx->flags & AV_CODEC_FLAG_GLOBAL_HEADER) {
         if ((ret = nvenc_setup_extradata(avctx)) < 0)
             return ret;
@@ -2221,30 +2412,45 @@ static int process_output_surface(AVCodecContext *avctx, AVPacket *pkt, NvencSur
 
     enum AVPictureType pict_type;
 
-    lock_params.version = NV_ENC_LOCK_BITSTREAM_VER;
+    if (ctx->output_thread_running) {
+        /* already locked and copied out by the output thread */
+        res = tmpoutsurf->lock_ret;
+        if (res < 0)
+            goto error;
+
+        lock_params = tmpoutsurf->lock_params;
 
-    lock_params.doNotWait = 0;
-    lock_params.outputBitstream = tmpoutsurf->output_surface;
+        res = ff_get_encode_buffer(avctx, pkt, lock_params.bitstreamSizeInBytes, 0);
+        if (res < 0)
+            goto error;
 
-    nv_status = p_nvenc->nvEncLockBitstream(ctx->nvencoder, &lock_params);
-    if (nv_status != NV_ENC_SUCCESS) {
-        res = nvenc_print_error(avctx, nv_status, "Failed locking bitstream buffer");
-        goto error;
-    }
+        memcpy(pkt->data, tmpoutsurf->bitstream, lock_params.bitstreamSizeInBytes);
+    } else {
+        lock_params.version = NV_ENC_LOCK_BITSTREAM_VER;
 
-    res = ff_get_encode_buffer(avctx, pkt, lock_params.bitstreamSizeInBytes, 0);
+        lock_params.doNotWait = 0;
+        lock_params.outputBitstream = tmpoutsurf->output_surface;
 
-    if (res < 0) {
-        p_nvenc->nvEncUnlockBitstream(ctx->nvencoder, tmpoutsurf->output_surface);
-        goto error;
-    }
+        nv_status = p_nvenc->nvEncLockBitstream(ctx->nvencoder, &lock_params);
+        if (nv_status != NV_ENC_SUCCESS) {
+            res = nvenc_print_error(avctx, nv_status, "Failed locking bitstream buffer");
+            goto error;
+        }
 
-    memcpy(pkt->data, lock_params.bitstreamBufferPtr, lock_params.bitstreamSizeInBytes);
+        res = ff_get_encode_buffer(avctx, pkt, lock_params.bitstreamSizeInBytes, 0);
 
-    nv_status = p_nvenc->nvEncUnlockBitstream(ctx->nvencoder, tmpoutsurf->output_surface);
-    if (nv_status != NV_ENC_SUCCESS) {
-        res = nvenc_print_error(avctx, nv_status, "Failed unlocking bitstream buffer, expect the gates of mordor to open");
-        goto error;
+        if (res < 0) {
+            p_nvenc->nvEncUnlockBitstream(ctx->nvencoder, tmpoutsurf->output_surface);
+            goto error;
+        }
+
+        memcpy(pkt->data, lock_params.bitstreamBufferPtr, lock_params.bitstreamSizeInBytes);
+
+        nv_status = p_nvenc->nvEncUnlockBitstream(ctx->nvencoder, tmpoutsurf->output_surface);
+        if (nv_status != NV_ENC_SUCCESS) {
+            res = nvenc_print_error(avctx, nv_status, "Failed unlocking bitstream buffer, expect the gates of mordor to open");
+            goto error;
+        }
     }
 
 
@@ -2523,7 +2729,7 @@ static void reconfig_encoder(AVCodecContext *avctx, const AVFrame *frame)
 static int nvenc_send_frame(AVCodecContext *avctx, const AVFrame *frame)
 {
     NVENCSTATUS nv_status;
-    NvencSurface *tmp_out_surf, *in_surf;
+    NvencSurface *in_surf;
     int res, res2;
     int sei_count = 0;
     int i;
@@ -2620,10 +2826,8 @@ static int nvenc_send_frame(AVCodecContext *avctx, const AVFrame *frame)
     }
 
     /* all the pending buffers are now ready for output */
-    if (nv_status == NV_ENC_SUCCESS) {
-        while (av_fifo_read(ctx->output_surface_queue, &tmp_out_surf, 1) >= 0)
-            av_fifo_write(ctx->output_surface_ready_queue, &tmp_out_surf, 1);
-    }
+    if (nv_status == NV_ENC_SUCCESS)
+        nvenc_output_surfaces_ready(avctx);
 
     return 0;
 }
@@ -2653,29 +2857,35 @@ int ff_nvenc_receive_packet(AVCodecContext *avctx, AVPacket *pkt)
     } else
         av_frame_unref(frame);
 
-    if (output_ready(avctx, avctx->internal->draining)) {
-        av_fifo_read(ctx->output_surface_ready_queue, &tmp_out_surf, 1);
-
-        res = nvenc_push_context(avctx);
+    if (ctx->output_thread_running) {
+        /* only block if no new input can be accepted until a surface is freed */
+        res = nvenc_output_thread_get(avctx, avctx->internal->draining ||
+                                             res == AVERROR(EAGAIN), &tmp_out_surf);
         if (res < 0)
-            return res;
-
-        res = process_output_surface(avctx, pkt, tmp_out_surf);
-
-        res2 = nvenc_pop_context(avctx);
-        if (res2 < 0)
-            return res2;
-
-        if (res)
-            return res;
-
-        av_fifo_write(ctx->unused_surface_queue, &tmp_out_surf, 1);
+            return avctx->internal->draining ? AVERROR_EOF : res;
+    } else if (output_ready(avctx, avctx->internal->draining)) {
+        av_fifo_read(ctx->output_surface_ready_queue, &tmp_out_surf, 1);
     } else if (avctx->internal->draining) {
         return AVERROR_EOF;
     } else {
         return AVERROR(EAGAIN);
     }
 
+    res = nvenc_push_context(avctx);
+    if (res < 0)
+        return res;
+
+    res = process_output_surface(avctx, pkt, tmp_out_surf);
+
+    res2 = nvenc_pop_context(avctx);
+    if (res2 < 0)
+        return res2;
+
+    if (res)
+        return res;
+
+    av_fifo_write(ctx->unused_surface_queue, &tmp_out_surf, 1);
+
     return 0;
 }
 
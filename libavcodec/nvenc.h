@@ -33,6 +33,7 @@ typedef void ID3D11Device;
 #include "compat/cuda/dynlink_loader.h"
 #include "libavutil/fifo.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "hwconfig.h"
 
 #include "avcodec.h"
@@ -88,6 +89,12 @@ typedef struct NvencSurface
 
     NV_ENC_OUTPUT_PTR output_surface;
     NV_ENC_BUFFER_FORMAT format;
+
+    /* bitstream copied out by the output thread, if enabled */
+    uint8_t *bitstream;
+    unsigned int bitstream_size;
+    NV_ENC_LOCK_BITSTREAM lock_params;
+    int lock_ret;
 } NvencSurface;
 
 typedef struct NvencDynLoadFunctions
@@ -173,6 +180,18 @@ typedef struct NvencContext
     AVFifo *output_surface_ready_queue;
     AVFifo *timestamp_list;
 
+#if HAVE_THREADS
+    pthread_t output_tid;
+    pthread_mutex_t output_mutex;
+    pthread_cond_t output_cond;
+    pthread_cond_t output_done_cond;
+#endif
+    int output_thread_running;
+    int output_thread_exit;
+    /* surfaces handed to the output thread and not yet returned */
+    int nb_output_in_flight;
+    AVFifo *output_surface_done_queue;
+
     NV_ENC_SEI_PAYLOAD *sei_data;
     int sei_data_size;
 
@@ -240,6 +259,7 @@ typedef struct NvencContext
     int udu_sei;
     int timing_info;
     int highbitdepth;
+    int output_thread;
 } NvencContext;
 
 int ff_nvenc_encode_init(AVCodecContext *avctx);
@@ -387,7 +387,7 @@ static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
     float td1, td2;
     f->dual_stereo = 0;
 
-    if (s->avctx->ch_layout.nb_channels < 2)
+    if (s->avctx->ch_layout.nb_channels < 2 || s->search_effort < 5)
         return;
 
     bands_dist(s, f, &td1);
@@ -404,11 +404,21 @@ static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
     float dist, best_dist = FLT_MAX;
     /* TODO: fix, make some heuristic up here using the lambda value */
     float end_band = 0;
+    int start_band = f->end_band;
 
     if (s->avctx->ch_layout.nb_channels < 2)
         return;
 
-    for (i = f->end_band; i >= end_band; i--) {
+    /* Below the maximum effort only try the bands around the recent average,
+     * every try being a full quantization of the frame. */
+    if (s->search_effort < 10) {
+        int center = FFMIN(lrintf(s->avg_is_band), f->end_band);
+        start_band = FFMIN(center + s->search_effort, f->end_band);
+        end_band   = FFMAX(center - s->search_effort, 0);
+        best_band  = center;
+    }
+
+    for (i = start_band; i >= end_band && start_band > end_band; i--) {
         f->intensity_stereo = i;
         bands_dist(s, f, &dist);
         if (best_dist > dist) {
@@ -520,6 +530,7 @@ av_cold int ff_opus_psy_init(OpusPsyContext *s, AVCodecContext *avctx,
     s->lambda = 1.0f;
     s->options = options;
     s->avctx = avctx;
+    s->search_effort = av_clip(avctx->compression_level, 0, 10);
     s->bufqueue = bufqueue;
     s->max_steps = ceilf(s->options->max_delay_ms/2.5f);
     s->bsize_analysis = CELT_BLOCK_960;
@@ -54,6 +54,7 @@ typedef struct OpusPsyContext {
     AVFloatDSPContext *dsp;
     struct FFBufQueue *bufqueue;
     OpusEncOptions *options;
+    int search_effort; ///< 0-10, from compression_level: trades search time for quality
 
     OpusBandExcitation ex[OPUS_MAX_CHANNELS][CELT_MAX_BANDS];
     FFBesselFilter bfilter_lo[OPUS_MAX_CHANNELS][CELT_MAX_BANDS];
@@ -38,6 +38,8 @@
 #include <zlib.h>
 
 #define IOBUF_SIZE 4096
+/* size of the deflate window, primed from the previous slice */
+#define DICT_SIZE  32768
 
 typedef struct APNGFctlChunk {
     uint32_t sequence_number;
@@ -47,6 +49,19 @@ typedef struct APNGFctlChunk {
     uint8_t dispose_op, blend_op;
 } APNGFctlChunk;
 
+typedef struct PNGEncSlice {
+    FFZStream zstream;           ///< raw deflate stream of the slice
+    uint8_t *rows;               ///< filtered rows, after those of the dictionary
+    unsigned rows_size;
+    uint8_t *crow;
+    unsigned crow_size;
+    uint8_t *out;                ///< room for the zlib header, then the deflate data
+    unsigned out_size;
+    int out_len;                 ///< size of the deflate data, or an error code
+    int in_len;
+    uint32_t adler;              ///< Adler-32 of the filtered rows of the slice
+} PNGEncSlice;
+
 typedef struct PNGEncContext {
     AVClass *class;
     LLVidEncDSPContext llvidencdsp;
@@ -59,6 +74,9 @@ typedef struct PNGEncContext {
 
     FFZStream zstream;
     uint8_t buf[IOBUF_SIZE];
+    int compression_level;
+    PNGEncSlice *slices;         ///< slices compressed in parallel, if slice threading
+    int nb_slices;
     int dpi;                     ///< Physical pixel density, in dots per inch, if set
     int dpm;                     ///< Physical pixel density, in dots per meter, if set
 
@@ -479,6 +497,122 @@ static int encode_headers(AVCodecContext *avctx, const AVFrame *pict)
     return 0;
 }
 
+/**
+ * Filter and compress a block of rows into an independent raw deflate
+ * stream, ended with a sync flush so that the streams of all the slices
+ * can be concatenated, as pigz does. The deflate window is primed with
+ * the filtered rows preceding the slice, so the compression ratio stays
+ * close to the one of a single stream.
+ */
+static int png_encode_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s       = avctx->priv_data;
+    const AVFrame *pict    = arg;
+    PNGEncSlice *sl        = &s->slices[jobnr];
+    z_stream *const zstream = &sl->zstream.zstream;
+    const int nb_slices    = FFMIN(s->nb_slices, pict->height);
+    const int last         = jobnr == nb_slices - 1;
+    const int row_size     = (pict->width * s->bits_per_pixel + 7) >> 3;
+    const int y0           = (int64_t)pict->height *  jobnr      / nb_slices;
+    const int y1           = (int64_t)pict->height * (jobnr + 1) / nb_slices;
+    const int dict_rows    = FFMIN(y0, (DICT_SIZE + row_size) / (row_size + 1));
+    const size_t dict_len  = (size_t)dict_rows   * (row_size + 1);
+    const size_t len       = (size_t)(y1 - y0) * (row_size + 1);
+    uint8_t *dst;
+    uLong bound;
+    int ret;
+
+    av_fast_malloc(&sl->rows, &sl->rows_size, dict_len + len);
+    av_fast_malloc(&sl->crow, &sl->crow_size,
+                   (row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+    if (!sl->rows || !sl->crow)
+        return sl->out_len = AVERROR(ENOMEM);
+
+    dst = sl->rows;
+    for (int y = y0 - dict_rows; y < y1; y++) {
+        const uint8_t *ptr = pict->data[0] + y * pict->linesize[0];
+        const uint8_t *top = y ? ptr - pict->linesize[0] : NULL;
+        // pixel data should be aligned, but there's a control byte before it
+        const uint8_t *crow = png_choose_filter(s, sl->crow + 15, ptr, top,
+                                                row_size, s->bits_per_pixel >> 3);
+        memcpy(dst, crow, row_size + 1);
+        dst += row_size + 1;
+    }
+    sl->in_len = len;
+    sl->adler  = adler32(adler32(0, NULL, 0), sl->rows + dict_len, len);
+
+    deflateReset(zstream);
+    if (dict_len) {
+        const size_t size = FFMIN(dict_len, DICT_SIZE);
+        deflateSetDictionary(zstream, sl->rows + dict_len - size, size);
+    }
+
+    // zlib header, sync flush marker and Adler-32 checksum
+    bound = deflateBound(zstream, len) + 2 + 16 + 4;
+    av_fast_malloc(&sl->out, &sl->out_size, bound);
+    if (!sl->out)
+        return sl->out_len = AVERROR(ENOMEM);
+
+    zstream->next_in   = sl->rows + dict_len;
+    zstream->avail_in  = len;
+    zstream->next_out  = sl->out + 2;
+    zstream->avail_out = bound - 2 - 4;
+    ret = deflate(zstream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (ret != (last ? Z_STREAM_END : Z_OK) ||
+        zstream->avail_in || !zstream->avail_out)
+        return sl->out_len = AVERROR_EXTERNAL;
+    sl->out_len = zstream->next_out - (sl->out + 2);
+
+    return 0;
+}
+
+static int encode_frame_slices(AVCodecContext *avctx, const AVFrame *pict)
+{
+    PNGEncContext *s    = avctx->priv_data;
+    const int nb_slices = FFMIN(s->nb_slices, pict->height);
+    PNGEncSlice *first  = &s->slices[0];
+    PNGEncSlice *last   = &s->slices[nb_slices - 1];
+    uint32_t adler      = 1;
+    int flevel, header;
+
+    avctx->execute2(avctx, png_encode_slice, (void *)pict, NULL, nb_slices);
+
+    for (int i = 0; i < nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+        if (sl->out_len < 0)
+            return sl->out_len;
+        adler = adler32_combine(adler, sl->adler, sl->in_len);
+    }
+
+    // the zlib header deflateInit() would have written
+    flevel = s->compression_level == Z_DEFAULT_COMPRESSION ? 2 :
+             s->compression_level < 2 ? 0 :
+             s->compression_level < 6 ? 1 :
+             s->compression_level == 6 ? 2 : 3;
+    header  = 0x78 << 8 | flevel << 6;
+    header += 31 - header % 31;
+    AV_WB16(first->out, header);
+    AV_WB32(last->out + 2 + last->out_len, adler);
+
+    for (int i = 0; i < nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+        const uint8_t *start = sl->out + 2;
+        int len = sl->out_len;
+
+        if (sl == first) {
+            start -= 2;
+            len   += 2;
+        }
+        if (sl == last)
+            len += 4;
+        if (s->bytestream_end - s->bytestream < len + 12)
+            return AVERROR_BUG;
+        png_write_image_data(avctx, start, len);
+    }
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 {
     PNGEncContext *s       = avctx->priv_data;
@@ -491,6 +625,9 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
     uint8_t *progressive_buf = NULL;
     uint8_t *top_buf         = NULL;
 
+    if (s->nb_slices)
+        return encode_frame_slices(avctx, pict);
+
     row_size = (pict->width * s->bits_per_pixel + 7) >> 3;
 
     crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
@@ -1153,6 +1290,22 @@ static av_cold int png_enc_init(AVCodecContext *avctx)
     compression_level = avctx->compression_level == FF_COMPRESSION_DEFAULT
                       ? Z_DEFAULT_COMPRESSION
                       : av_clip(avctx->compression_level, 0, 9);
+    s->compression_level = compression_level;
+
+    if (avctx->codec_id == AV_CODEC_ID_PNG && !s->is_progressive &&
+        avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->slices = av_calloc(avctx->thread_count, sizeof(*s->slices));
+        if (!s->slices)
+            return AVERROR(ENOMEM);
+        s->nb_slices = avctx->thread_count;
+        for (int i = 0; i < s->nb_slices; i++) {
+            int ret = ff_deflate_init2(&s->slices[i].zstream, compression_level,
+                                       -MAX_WBITS, avctx);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
     return ff_deflate_init(&s->zstream, compression_level, avctx);
 }
 
@@ -1161,6 +1314,15 @@ static av_cold int png_enc_close(AVCodecContext *avctx)
     PNGEncContext *s = avctx->priv_data;
 
     ff_deflate_end(&s->zstream);
+    for (int i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+        ff_deflate_end(&sl->zstream);
+        av_freep(&sl->rows);
+        av_freep(&sl->crow);
+        av_freep(&sl->out);
+    }
+    av_freep(&s->slices);
+    s->nb_slices = 0;
     av_frame_free(&s->last_frame);
     av_frame_free(&s->prev_frame);
     av_freep(&s->last_frame_packet);
@@ -1196,7 +1358,8 @@ const FFCodec ff_png_encoder = {
     CODEC_LONG_NAME("PNG (Portable Network Graphics) image"),
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_PNG,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .priv_data_size = sizeof(PNGEncContext),
     .init           = png_enc_init,
     .close          = png_enc_close,
@@ -1210,7 +1373,8 @@ const FFCodec ff_png_encoder = {
         AV_PIX_FMT_MONOBLACK, AV_PIX_FMT_NONE
     },
     .p.priv_class   = &pngenc_class,
-    .caps_internal  = FF_CODEC_CAP_ICC_PROFILES,
+    .caps_internal  = FF_CODEC_CAP_ICC_PROFILES | FF_CODEC_CAP_INIT_CLEANUP |
+                      FF_CODEC_CAP_FRAME_SLICE_THREADS,
 };
 
 const FFCodec ff_apng_encoder = {
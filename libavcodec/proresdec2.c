@@ -56,65 +56,87 @@ static void permute(uint8_t *dst, const uint8_t *src, const uint8_t permutation[
 #define ALPHA_SHIFT_16_TO_12(alpha_val) (alpha_val >> 4)
 #define ALPHA_SHIFT_8_TO_12(alpha_val)  ((alpha_val << 4) | (alpha_val >> 4))
 
+/* The alpha codewords are short and strictly sequential, so they are read
+ * from a local 64-bit bit buffer which is only reloaded when it runs low,
+ * keeping the memory load out of the per-coefficient dependency chain. */
+#define ALPHA_REFILL(n)                                                 \
+    do {                                                                \
+        if (avail < (n)) {                                              \
+            pos   = FFMIN(pos, size_in_bits);                           \
+            cache = AV_RB64(buf + (pos >> 3)) << (pos & 7);             \
+            avail = 64 - (pos & 7);                                     \
+        }                                                               \
+    } while (0)
+#define ALPHA_SHOW(n) ((int)(cache >> (64 - (n))))
+#define ALPHA_SKIP(n)                                                   \
+    do {                                                                \
+        cache <<= (n);                                                  \
+        avail  -= (n);                                                  \
+        pos    += (n);                                                  \
+    } while (0)
+
 static void inline unpack_alpha(GetBitContext *gb, uint16_t *dst, int num_coeffs,
                                 const int num_bits, const int decode_precision) {
-    const int mask = (1 << num_bits) - 1;
-    int i, idx, val, alpha_val;
+    const int mask       = (1 << num_bits) - 1;
+    const int short_bits = num_bits == 16 ? 7 : 4;
+    const uint8_t *buf   = gb->buffer;
+    const int size_in_bits = gb->size_in_bits;
+    int pos = get_bits_count(gb), avail = 0;
+    uint64_t cache = 0;
+    int i, idx, val, alpha_val, alpha_out = 0;
 
     idx       = 0;
     alpha_val = mask;
     do {
         do {
-            if (get_bits1(gb)) {
-                val = get_bits(gb, num_bits);
-            } else {
-                int sign;
-                val  = get_bits(gb, num_bits == 16 ? 7 : 4);
-                sign = val & 1;
-                val  = (val + 2) >> 1;
-                if (sign)
-                    val = -val;
-            }
+            int flag, delta, sign;
+
+            /* a codeword and its continuation flag take at most 18 bits */
+            ALPHA_REFILL(18);
+            flag  = ALPHA_SHOW(1);
+            val   = ALPHA_SHOW(1 + num_bits) & mask;
+            delta = ALPHA_SHOW(1 + short_bits) & ((1 << short_bits) - 1);
+            sign  = -(delta & 1);
+            delta = (((delta + 2) >> 1) ^ sign) - sign;
+            if (!flag)
+                val = delta;
+            ALPHA_SKIP(flag ? 1 + num_bits : 1 + short_bits);
+
             alpha_val = (alpha_val + val) & mask;
             if (num_bits == 16) {
                 if (decode_precision == 10) {
-                    dst[idx++] = ALPHA_SHIFT_16_TO_10(alpha_val);
+                    alpha_out = ALPHA_SHIFT_16_TO_10(alpha_val);
                 } else { /* 12b */
-                    dst[idx++] = ALPHA_SHIFT_16_TO_12(alpha_val);
+                    alpha_out = ALPHA_SHIFT_16_TO_12(alpha_val);
                 }
             } else {
                 if (decode_precision == 10) {
-                    dst[idx++] = ALPHA_SHIFT_8_TO_10(alpha_val);
+                    alpha_out = ALPHA_SHIFT_8_TO_10(alpha_val);
                 } else { /* 12b */
-                    dst[idx++] = ALPHA_SHIFT_8_TO_12(alpha_val);
+                    alpha_out = ALPHA_SHIFT_8_TO_12(alpha_val);
                 }
             }
-            if (idx >= num_coeffs)
+            dst[idx++] = alpha_out;
+            if (idx >= num_coeffs || pos >= size_in_bits)
                 break;
-        } while (get_bits_left(gb)>0 && get_bits1(gb));
-        val = get_bits(gb, 4);
-        if (!val)
-            val = get_bits(gb, 11);
+            val = ALPHA_SHOW(1);
+            ALPHA_SKIP(1);
+        } while (val);
+        ALPHA_REFILL(15);
+        val = ALPHA_SHOW(4);
+        ALPHA_SKIP(4);
+        if (!val) {
+            val = ALPHA_SHOW(11);
+            ALPHA_SKIP(11);
+        }
         if (idx + val > num_coeffs)
             val = num_coeffs - idx;
-        if (num_bits == 16) {
-            for (i = 0; i < val; i++) {
-                if (decode_precision == 10) {
-                    dst[idx++] = ALPHA_SHIFT_16_TO_10(alpha_val);
-                } else { /* 12b */
-                    dst[idx++] = ALPHA_SHIFT_16_TO_12(alpha_val);
-                }
-            }
-        } else {
-            for (i = 0; i < val; i++) {
-                if (decode_precision == 10) {
-                    dst[idx++] = ALPHA_SHIFT_8_TO_10(alpha_val);
-                } else { /* 12b */
-                    dst[idx++] = ALPHA_SHIFT_8_TO_12(alpha_val);
-                }
-            }
-        }
+        for (i = 0; i < val; i++)
+            dst[idx + i] = alpha_out;
+        idx += val;
     } while (idx < num_coeffs);
+
+    skip_bits_long(gb, pos - get_bits_count(gb));
 }
 
 static void unpack_alpha_10(GetBitContext *gb, uint16_t *dst, int num_coeffs,
@@ -620,9 +642,7 @@ static void decode_slice_alpha(const ProresContext *ctx,
     LOCAL_ALIGNED_32(int16_t, blocks, [8*4*64]);
     int16_t *block;
 
-    for (i = 0; i < blocks_per_slice<<2; i++)
-        ctx->bdsp.clear_block(blocks+(i<<6));
-
+    /* unpack_alpha() writes all coefficients, no need to clear them */
     init_get_bits(&gb, buf, buf_size << 3);
 
     if (ctx->alpha_info == 2) {
@@ -47,6 +47,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/trace.h"
 
 enum {
     ///< Set when the thread is awaiting a packet.
@@ -144,10 +145,13 @@ typedef struct FrameThreadContext {
     int next_decoding;             ///< The next context to submit a packet to.
     int next_finished;             ///< The next context to return output from.
 
+    int slice_threads;             ///< Number of slice threads of each thread context, if more than 1.
+
     int delaying;                  /**<
                                     * Set for the first N packets, where N is the number of threads.
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
+    int max_delay;                 ///< Number of packets submitted before output is returned, at most thread_count - 1.
 
     /* hwaccel state is temporarily stored here in order to transfer its ownership
      * to the next decoding thread without the need for extra synchronization */
@@ -207,6 +211,8 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
 
     pthread_mutex_lock(&p->mutex);
     while (1) {
+        AVTraceSpan span;
+
         while (atomic_load(&p->state) == STATE_INPUT_READY && !p->die)
             pthread_cond_wait(&p->input_cond, &p->mutex);
 
@@ -238,10 +244,14 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
         av_frame_unref(p->frame);
         p->got_frame = 0;
+        av_trace_begin(&span, "decode", avctx->codec->name);
         p->result = codec->cb.decode(avctx, p->frame, &p->got_frame, p->avpkt);
+        av_trace_end(&span);
 
-        if ((p->result < 0 || !p->got_frame) && p->frame->buf[0])
+        if ((p->result < 0 || !p->got_frame) && p->frame->buf[0]) {
             ff_thread_release_buffer(avctx, p->frame);
+            p->got_frame = 0;
+        }
 
         if (atomic_load(&p->state) == STATE_SETTING_UP)
             ff_thread_finish_setup(avctx);
@@ -570,7 +580,7 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
      * If we're still receiving the initial packets, don't return a frame.
      */
 
-    if (fctx->next_decoding > (avctx->thread_count-1-(avctx->codec_id == AV_CODEC_ID_FFV1)))
+    if (fctx->next_decoding > (fctx->max_delay-(avctx->codec_id == AV_CODEC_ID_FFV1)))
         fctx->delaying = 0;
 
     if (fctx->delaying) {
@@ -646,7 +656,9 @@ void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 
     pthread_mutex_lock(&p->progress_mutex);
 
-    atomic_store_explicit(&progress[field], n, memory_order_release);
+    // with slice threading, the rows may be reported by several threads
+    if (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
+        atomic_store_explicit(&progress[field], n, memory_order_release);
 
     pthread_cond_broadcast(&p->progress_cond);
     pthread_mutex_unlock(&p->progress_mutex);
@@ -767,6 +779,8 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
             }
             if (codec->close && p->thread_init != UNINITIALIZED)
                 codec->close(ctx);
+            if (ctx->internal->slice_thread_ctx)
+                ff_slice_thread_free(ctx);
 
 #if FF_API_THREAD_SAFE_CALLBACKS
             release_delayed_buffers(p);
@@ -858,6 +872,20 @@ static av_cold int init_thread(PerThreadContext *p, int *threads_to_free,
         !(p->avpkt = av_packet_alloc()))
         return AVERROR(ENOMEM);
 
+    if (fctx->slice_threads > 1) {
+        copy->thread_count = fctx->slice_threads;
+        err = ff_slice_thread_init(copy);
+        if (err < 0)
+            return err;
+        // the thread context stays a frame thread if no slice thread started
+        if (copy->internal->slice_thread_ctx) {
+            copy->active_thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        } else {
+            copy->active_thread_type = FF_THREAD_FRAME;
+            copy->thread_count       = avctx->thread_count;
+        }
+    }
+
     if (!first)
         copy->internal->is_copy = 1;
 
@@ -893,6 +921,8 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     int thread_count = avctx->thread_count;
     const FFCodec *codec = ffcodec(avctx->codec);
     FrameThreadContext *fctx;
+    int frame_threads = avctx->frame_threads;
+    int slice_threads = 0;
     int err, i = 0;
 
     if (!thread_count) {
@@ -904,6 +934,25 @@ int ff_frame_thread_init(AVCodecContext *avctx)
             thread_count = avctx->thread_count = 1;
     }
 
+    // no more frames than the delay limit allows are decoded concurrently
+    if (avctx->frame_thread_delay &&
+        (!frame_threads || frame_threads > avctx->frame_thread_delay + 1))
+        frame_threads = avctx->frame_thread_delay + 1;
+
+    // split the threads between frame threads decoding with slice threads
+    if (frame_threads && frame_threads < thread_count &&
+        avctx->thread_type & FF_THREAD_SLICE &&
+        avctx->codec->capabilities & AV_CODEC_CAP_SLICE_THREADS &&
+        codec->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS) {
+        slice_threads = thread_count / frame_threads;
+        if (slice_threads > 1)
+            thread_count = avctx->thread_count = frame_threads;
+    }
+
+    // otherwise the frame threads beyond the delay limit would stay idle
+    if (avctx->frame_thread_delay && avctx->frame_thread_delay < thread_count - 1)
+        thread_count = avctx->thread_count = avctx->frame_thread_delay + 1;
+
     if (thread_count <= 1) {
         avctx->active_thread_type = 0;
         return 0;
@@ -922,9 +971,16 @@ int ff_frame_thread_init(AVCodecContext *avctx)
 
     fctx->async_lock = 1;
     fctx->delaying = 1;
+    fctx->slice_threads = slice_threads;
+
+    // with a delay limit, output is returned once that many packets are
+    // submitted, which bounds the number of frames decoded concurrently
+    fctx->max_delay = thread_count - 1;
+    if (avctx->frame_thread_delay && avctx->frame_thread_delay < fctx->max_delay)
+        fctx->max_delay = avctx->frame_thread_delay;
 
     if (codec->p.type == AVMEDIA_TYPE_VIDEO)
-        avctx->delay = avctx->thread_count - 1;
+        avctx->delay = fctx->max_delay;
 
     fctx->threads = av_calloc(thread_count, sizeof(*fctx->threads));
     if (!fctx->threads) {
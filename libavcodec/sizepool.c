@@ -0,0 +1,161 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/avassert.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "sizepool.h"
+
+/* 4 size classes per power of 2: the sizes with 3 significant bits */
+#define CLASS_BITS 2
+#define MIN_CLASS  (1 << CLASS_BITS)
+#define NB_CLASSES (32 << CLASS_BITS)
+
+typedef struct FFSizePool {
+    AVMutex mutex;
+    AVBufferPool *pools[NB_CLASSES];
+    size_t class_allocated[NB_CLASSES];
+    /* period of use in which each class was last used */
+    unsigned last_period[NB_CLASSES];
+    unsigned period;
+    int width, height;
+    size_t allocated;
+    size_t max_allocated;
+} FFSizePool;
+
+static int class_index(size_t class_size)
+{
+    /* the class size may be the first class of the next power of 2 */
+    int log2 = av_log2(class_size);
+    return (log2 << CLASS_BITS) | ((class_size >> (log2 - CLASS_BITS)) & (MIN_CLASS - 1));
+}
+
+static AVBufferRef *pool_alloc(void *opaque, size_t size)
+{
+    FFSizePool *pool = opaque;
+    AVBufferRef *buf = av_buffer_allocz(size);
+
+    if (buf) {
+        ff_mutex_lock(&pool->mutex);
+        pool->class_allocated[class_index(size)] += size;
+        pool->allocated     += size;
+        pool->max_allocated  = FFMAX(pool->max_allocated, pool->allocated);
+        ff_mutex_unlock(&pool->mutex);
+    }
+    return buf;
+}
+
+static void size_pool_free(void *opaque, uint8_t *data)
+{
+    FFSizePool *pool = (FFSizePool *)data;
+
+    /* the buffers still in use are freed when they are released */
+    for (int i = 0; i < NB_CLASSES; i++)
+        av_buffer_pool_uninit(&pool->pools[i]);
+    ff_mutex_destroy(&pool->mutex);
+    av_free(pool);
+}
+
+AVBufferRef *ff_size_pool_alloc(void)
+{
+    FFSizePool *pool = av_mallocz(sizeof(*pool));
+    AVBufferRef *ref;
+
+    if (!pool)
+        return NULL;
+
+    if (ff_mutex_init(&pool->mutex, NULL)) {
+        av_free(pool);
+        return NULL;
+    }
+
+    ref = av_buffer_create((uint8_t *)pool, sizeof(*pool), size_pool_free, NULL, 0);
+    if (!ref) {
+        ff_mutex_destroy(&pool->mutex);
+        av_free(pool);
+    }
+    return ref;
+}
+
+AVBufferRef *ff_size_pool_get(AVBufferRef *ref, size_t size)
+{
+    FFSizePool *pool = (FFSizePool *)ref->data;
+    AVBufferPool *class_pool;
+    size_t class_size, step;
+    AVBufferRef *buf;
+    int idx;
+
+    if (size > INT_MAX / 2)
+        return NULL;
+    size = FFMAX(size, MIN_CLASS);
+    step = (size_t)1 << (av_log2(size) - CLASS_BITS);
+    class_size = (size + step - 1) & ~(step - 1);
+    idx = class_index(class_size);
+    av_assert2(idx < NB_CLASSES);
+
+    ff_mutex_lock(&pool->mutex);
+    if (!pool->pools[idx])
+        pool->pools[idx] = av_buffer_pool_init2(class_size, pool, pool_alloc, NULL);
+    class_pool = pool->pools[idx];
+    pool->last_period[idx] = pool->period;
+    ff_mutex_unlock(&pool->mutex);
+    if (!class_pool)
+        return NULL;
+
+    buf = av_buffer_pool_get(class_pool);
+    if (buf)
+        buf->size = size;
+    return buf;
+}
+
+size_t ff_size_pool_trim(AVBufferRef *ref, int width, int height)
+{
+    FFSizePool *pool = (FFSizePool *)ref->data;
+    size_t freed = 0;
+
+    ff_mutex_lock(&pool->mutex);
+    if (width != pool->width || height != pool->height) {
+        for (int i = 0; i < NB_CLASSES; i++) {
+            if (!pool->pools[i] || pool->period - pool->last_period[i] < 2)
+                continue;
+            /* the buffers still in use are freed when they are released */
+            av_buffer_pool_uninit(&pool->pools[i]);
+            freed                     += pool->class_allocated[i];
+            pool->allocated           -= pool->class_allocated[i];
+            pool->class_allocated[i]   = 0;
+        }
+        pool->width  = width;
+        pool->height = height;
+        pool->period++;
+    }
+    ff_mutex_unlock(&pool->mutex);
+    return freed;
+}
+
+size_t ff_size_pool_max_allocated(AVBufferRef *ref)
+{
+    FFSizePool *pool = (FFSizePool *)ref->data;
+    size_t max_allocated;
+
+    ff_mutex_lock(&pool->mutex);
+    max_allocated = pool->max_allocated;
+    ff_mutex_unlock(&pool->mutex);
+    return max_allocated;
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Pool of refcounted buffers of any size, grouped in size classes, for the
+ * per-frame tables of decoders.
+ */
+
+#ifndef AVCODEC_SIZEPOOL_H
+#define AVCODEC_SIZEPOOL_H
+
+#include <stddef.h>
+
+#include "libavutil/buffer.h"
+
+/**
+ * Allocate a size class pool.
+ *
+ * Unlike an AVBufferPool, which returns buffers of a single size, the pool
+ * returns buffers of any size, rounded up to a size class with less than 25%
+ * of overhead, and keeps the buffers of the classes used with the current and
+ * the previous frame dimensions, see ff_size_pool_trim(). It can thus be kept
+ * over changes of the frame dimensions, and the buffers of the previous
+ * dimensions are reused when switching back to them.
+ *
+ * The pool is returned as a reference, which can be shared between the
+ * contexts of the frame threads. ff_size_pool_get() is thread-safe. The pool
+ * is freed when the last reference is unreferenced and all the buffers taken
+ * from it have been released.
+ *
+ * @return a reference to the pool or NULL on failure
+ */
+AVBufferRef *ff_size_pool_alloc(void);
+
+/**
+ * Get a buffer of size bytes from the pool. Buffers are zeroed when first
+ * allocated, reused buffers keep their previous contents.
+ *
+ * @param pool a reference returned by ff_size_pool_alloc()
+ * @return a reference to a buffer of size bytes or NULL on failure
+ */
+AVBufferRef *ff_size_pool_get(AVBufferRef *pool, size_t size);
+
+/**
+ * Notify the pool of the frame dimensions of the buffers requested next.
+ * When they differ from the current ones, the classes not used with the
+ * current or the previous dimensions are freed, so that the pool does not
+ * keep the buffers of every dimensions it has been used with.
+ *
+ * @return the size of the buffers freed
+ */
+size_t ff_size_pool_trim(AVBufferRef *pool, int width, int height);
+
+/**
+ * Get the largest total size of the buffers allocated by the pool, its
+ * memory high-water mark.
+ */
+size_t ff_size_pool_max_allocated(AVBufferRef *pool);
+
+#endif /* AVCODEC_SIZEPOOL_H */
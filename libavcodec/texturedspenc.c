@@ -256,11 +256,10 @@ static void optimize_colors(const uint8_t *block, ptrdiff_t stride,
         muv = minv = maxv = bp[0];
         for (y = 0; y < 4; y++) {
             for (x = 0; x < 4; x++) {
-                muv += bp[x * 4 + y * stride];
-                if (bp[x * 4 + y * stride] < minv)
-                    minv = bp[x * 4 + y * stride];
-                else if (bp[x * 4 + y * stride] > maxv)
-                    maxv = bp[x * 4 + y * stride];
+                int val = bp[x * 4 + y * stride];
+                muv += val;
+                minv = FFMIN(minv, val);
+                maxv = FFMAX(maxv, val);
             }
         }
 
@@ -331,13 +330,11 @@ static void optimize_colors(const uint8_t *block, ptrdiff_t stride,
                       block[x * 4 + y * stride + 1] * v_g +
                       block[x * 4 + y * stride + 2] * v_b;
 
-            if (dot < mind) {
-                mind = dot;
-                minp = block + x * 4 + y * stride;
-            } else if (dot > maxd) {
-                maxd = dot;
-                maxp = block + x * 4 + y * stride;
-            }
+            /* Written branchless, the comparisons are unpredictable */
+            minp = dot < mind ? block + x * 4 + y * stride : minp;
+            maxp = dot > maxd ? block + x * 4 + y * stride : maxp;
+            mind = FFMIN(mind, dot);
+            maxd = FFMAX(maxd, dot);
         }
     }
 
@@ -511,10 +508,8 @@ static void compress_alpha(uint8_t *dst, ptrdiff_t stride, const uint8_t *block)
     for (y = 0; y < 4; y++) {
         for (x = 0; x < 4; x++) {
             int val = block[3 + x * 4 + y * stride];
-            if (val < mn)
-                mn = val;
-            else if (val > mx)
-                mx = val;
+            mn = FFMIN(mn, val);
+            mx = FFMAX(mx, val);
         }
     }
 
@@ -21,6 +21,8 @@
 #include <inttypes.h>
 #include <string.h>
 
+#include <va/va_vpp.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/internal.h"
@@ -293,6 +295,10 @@ static int vaapi_encode_issue(AVCodecContext *avctx,
         av_assert0(pic->refs[i]->encode_issued);
     }
 
+    // Only reference pictures pass their quality on to later pictures.
+    if (!pic->is_reference)
+        pic->qp_delta = 0;
+
     av_log(avctx, AV_LOG_DEBUG, "Input surface is %#x.\n", pic->input_surface);
 
     pic->recon_image = av_frame_alloc();
@@ -776,6 +782,7 @@ static int vaapi_encode_free(AVCodecContext *avctx,
 
     av_frame_free(&pic->input_image);
     av_frame_free(&pic->recon_image);
+    av_frame_free(&pic->lookahead_image);
 
     av_freep(&pic->param_buffers);
     av_freep(&pic->slices);
@@ -957,6 +964,12 @@ static int vaapi_encode_pick_next(AVCodecContext *avctx,
             start = pic;
             continue;
         }
+        // Pictures still waiting for lookahead decisions can't be used
+        // yet, nor can anything after them.
+        if (ctx->lookahead && !pic->lookahead_done) {
+            pic = NULL;
+            break;
+        }
         // If the next available picture is force-IDR, encode it to start
         // a new GOP immediately.
         if (pic->force_idr)
@@ -1115,6 +1128,225 @@ static int vaapi_encode_check_frame(AVCodecContext *avctx,
     return 0;
 }
 
+// The lookahead analyses pictures downscaled by this factor in each
+// dimension, in blocks of LOOKAHEAD_BLOCK_SIZE pixels square.
+#define LOOKAHEAD_SCALE      4
+#define LOOKAHEAD_BLOCK_SIZE 8
+// Largest QP reduction applied to persistent content in CQP mode.
+#define LOOKAHEAD_MAX_QP_DELTA 4
+
+static int vaapi_encode_lookahead_submit(AVCodecContext *avctx,
+                                         VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VAProcPipelineParameterBuffer params;
+    VASurfaceID output_surface;
+    VABufferID params_id;
+    VAStatus vas;
+    int err;
+
+    pic->lookahead_image = av_frame_alloc();
+    if (!pic->lookahead_image)
+        return AVERROR(ENOMEM);
+
+    err = av_hwframe_get_buffer(ctx->lookahead_frames_ref,
+                                pic->lookahead_image, 0);
+    if (err < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to allocate lookahead "
+               "surface: %d.\n", err);
+        return err;
+    }
+    output_surface = (VASurfaceID)(uintptr_t)pic->lookahead_image->data[3];
+
+    params = (VAProcPipelineParameterBuffer) {
+        .surface                 = pic->input_surface,
+        .output_background_color = 0xff000000,
+        .filter_flags            = VA_FILTER_SCALING_FAST,
+    };
+
+    vas = vaCreateBuffer(ctx->hwctx->display, ctx->lookahead_va_context,
+                         VAProcPipelineParameterBufferType,
+                         sizeof(params), 1, &params, &params_id);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create lookahead parameter "
+               "buffer: %d (%s).\n", vas, vaErrorStr(vas));
+        return AVERROR(EIO);
+    }
+
+    // The downscale runs asynchronously; it is only waited for when the
+    // picture is analysed, after the next input has been submitted.
+    vas = vaBeginPicture(ctx->hwctx->display, ctx->lookahead_va_context,
+                         output_surface);
+    if (vas == VA_STATUS_SUCCESS) {
+        vas = vaRenderPicture(ctx->hwctx->display, ctx->lookahead_va_context,
+                              &params_id, 1);
+        if (vas != VA_STATUS_SUCCESS)
+            vaEndPicture(ctx->hwctx->display, ctx->lookahead_va_context);
+        else
+            vas = vaEndPicture(ctx->hwctx->display, ctx->lookahead_va_context);
+    }
+    vaDestroyBuffer(ctx->hwctx->display, params_id);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to downscale picture for "
+               "lookahead: %d (%s).\n", vas, vaErrorStr(vas));
+        return AVERROR(EIO);
+    }
+
+    return 0;
+}
+
+static void vaapi_encode_lookahead_costs(const AVFrame *cur, const AVFrame *prev,
+                                         int64_t *intra_cost, int64_t *inter_cost)
+{
+    const int bs = LOOKAHEAD_BLOCK_SIZE;
+    int64_t intra = 0, inter = 0;
+    int bx, by, x, y;
+
+    for (by = 0; by + bs <= cur->height; by += bs) {
+        for (bx = 0; bx + bs <= cur->width; bx += bs) {
+            const uint8_t *src = cur->data[0] + by * cur->linesize[0] + bx;
+            const uint8_t *ref = prev ? prev->data[0] + by * prev->linesize[0] + bx : NULL;
+            int sum = 0, mean, dev = 0, sad = 0;
+
+            for (y = 0; y < bs; y++)
+                for (x = 0; x < bs; x++)
+                    sum += src[y * cur->linesize[0] + x];
+            mean = (sum + bs * bs / 2) / (bs * bs);
+
+            for (y = 0; y < bs; y++) {
+                for (x = 0; x < bs; x++) {
+                    int v = src[y * cur->linesize[0] + x];
+                    dev += FFABS(v - mean);
+                    if (ref)
+                        sad += FFABS(v - ref[y * prev->linesize[0] + x]);
+                }
+            }
+
+            intra += dev;
+            // A block can always be coded without reference to the
+            // previous picture.
+            inter += ref ? FFMIN(sad, dev) : dev;
+        }
+    }
+
+    *intra_cost = intra;
+    *inter_cost = inter;
+}
+
+static int vaapi_encode_lookahead_analyse(AVCodecContext *avctx,
+                                          VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    AVFrame *image;
+    int err;
+
+    image = av_frame_alloc();
+    if (!image)
+        return AVERROR(ENOMEM);
+    image->format = AV_PIX_FMT_NV12;
+
+    err = av_hwframe_transfer_data(image, pic->lookahead_image, 0);
+    if (err < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to download lookahead "
+               "picture: %d.\n", err);
+        av_frame_free(&image);
+        return err;
+    }
+    av_frame_free(&pic->lookahead_image);
+
+    vaapi_encode_lookahead_costs(image, ctx->lookahead_prev,
+                                 &pic->lookahead_intra_cost,
+                                 &pic->lookahead_inter_cost);
+
+    av_frame_free(&ctx->lookahead_prev);
+    ctx->lookahead_prev = image;
+
+    pic->lookahead_analysed = 1;
+    return 0;
+}
+
+static int vaapi_encode_lookahead_is_scenecut(VAAPIEncodeContext *ctx,
+                                              VAAPIEncodePicture *pic)
+{
+    if (!ctx->lookahead_scenecut || pic->display_order == 0)
+        return 0;
+    // Most of the picture is better coded without reference to the
+    // previous one.
+    return pic->lookahead_inter_cost * 100 >
+           pic->lookahead_intra_cost * (100 - ctx->lookahead_scenecut);
+}
+
+static void vaapi_encode_lookahead_decide(AVCodecContext *avctx,
+                                          VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VAAPIEncodePicture *next;
+    double change = 0.0;
+    int n;
+
+    if (vaapi_encode_lookahead_is_scenecut(ctx, pic)) {
+        av_log(avctx, AV_LOG_DEBUG, "Lookahead: scene change at "
+               "picture %"PRId64".\n", pic->display_order);
+        pic->force_idr = 1;
+    }
+
+    if (ctx->va_rc_mode != VA_RC_CQP)
+        return;
+
+    // Content which persists through the following pictures is worth
+    // coding at higher quality, since they will refer to it.  Stop at
+    // the next scene change, after which nothing refers back.
+    for (next = pic->next, n = 0; next && n < ctx->lookahead;
+         next = next->next, n++) {
+        if (vaapi_encode_lookahead_is_scenecut(ctx, next))
+            break;
+        change += (double)next->lookahead_inter_cost /
+                  FFMAX(next->lookahead_intra_cost, 1);
+    }
+
+    pic->qp_delta = -lrint(LOOKAHEAD_MAX_QP_DELTA * (n - change) /
+                           ctx->lookahead);
+    av_log(avctx, AV_LOG_DEBUG, "Lookahead: picture %"PRId64" QP "
+           "offset %d.\n", pic->display_order, pic->qp_delta);
+}
+
+static int vaapi_encode_lookahead_update(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VAAPIEncodePicture *pic, *last;
+    int err, n;
+
+    // Analyse every picture except the newest, so that its downscale
+    // can proceed while the caller fetches the next input.
+    for (pic = ctx->pic_start; pic; pic = pic->next) {
+        if (pic->lookahead_analysed)
+            continue;
+        if (pic == ctx->pic_end && !ctx->end_of_stream)
+            break;
+        err = vaapi_encode_lookahead_analyse(avctx, pic);
+        if (err < 0)
+            return err;
+    }
+
+    // Decisions for a picture need the full window after it.
+    for (pic = ctx->pic_start; pic; pic = pic->next) {
+        if (pic->lookahead_done)
+            continue;
+        if (!pic->lookahead_analysed)
+            break;
+        for (last = pic, n = 0; last->next && n < ctx->lookahead; n++)
+            last = last->next;
+        if (!last->lookahead_analysed ||
+            (n < ctx->lookahead && !ctx->end_of_stream))
+            break;
+
+        vaapi_encode_lookahead_decide(avctx, pic);
+        pic->lookahead_done = 1;
+    }
+
+    return 0;
+}
+
 static int vaapi_encode_send_frame(AVCodecContext *avctx, AVFrame *frame)
 {
     VAAPIEncodeContext *ctx = avctx->priv_data;
@@ -1147,13 +1379,20 @@ static int vaapi_encode_send_frame(AVCodecContext *avctx, AVFrame *frame)
 
         av_frame_move_ref(pic->input_image, frame);
 
+        if (ctx->lookahead) {
+            err = vaapi_encode_lookahead_submit(avctx, pic);
+            if (err < 0)
+                goto fail;
+        }
+
         if (ctx->input_order == 0)
             ctx->first_pts = pic->pts;
         if (ctx->input_order == ctx->decode_delay)
             ctx->dts_pts_diff = pic->pts - ctx->first_pts;
         if (ctx->output_delay > 0)
             ctx->ts_ring[ctx->input_order %
-                        (3 * ctx->output_delay + ctx->async_depth)] = pic->pts;
+                        (3 * ctx->output_delay + ctx->async_depth +
+                         ctx->lookahead)] = pic->pts;
 
         pic->display_order = ctx->input_order;
         ++ctx->input_order;
@@ -1200,6 +1439,12 @@ int ff_vaapi_encode_receive_packet(AVCodecContext *avctx, AVPacket *pkt)
     if (err < 0)
         return err;
 
+    if (ctx->lookahead) {
+        err = vaapi_encode_lookahead_update(avctx);
+        if (err < 0)
+            return err;
+    }
+
     if (!ctx->pic_start) {
         if (ctx->end_of_stream)
             return AVERROR_EOF;
@@ -1265,7 +1510,8 @@ int ff_vaapi_encode_receive_packet(AVCodecContext *avctx, AVPacket *pkt)
             pkt->dts = ctx->ts_ring[pic->encode_order] - ctx->dts_pts_diff;
     } else {
         pkt->dts = ctx->ts_ring[(pic->encode_order - ctx->decode_delay) %
-                                (3 * ctx->output_delay + ctx->async_depth)];
+                                (3 * ctx->output_delay + ctx->async_depth +
+                                 ctx->lookahead)];
     }
     av_log(avctx, AV_LOG_DEBUG, "Output packet: pts %"PRId64" dts %"PRId64".\n",
            pkt->pts, pkt->dts);
@@ -2539,6 +2785,68 @@ static av_cold int vaapi_encode_create_recon_frames(AVCodecContext *avctx)
     return err;
 }
 
+static av_cold int vaapi_encode_init_lookahead(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    AVHWFramesContext *frames;
+    AVVAAPIFramesContext *frames_hwctx;
+    VAStatus vas;
+    int err;
+
+    if (ctx->codec->flags & FLAG_INTRA_ONLY) {
+        av_log(avctx, AV_LOG_WARNING, "Lookahead is not useful for "
+               "intra-only codecs, disabling it.\n");
+        ctx->lookahead = 0;
+        return 0;
+    }
+
+    ctx->lookahead_frames_ref = av_hwframe_ctx_alloc(ctx->device_ref);
+    if (!ctx->lookahead_frames_ref)
+        return AVERROR(ENOMEM);
+    frames = (AVHWFramesContext*)ctx->lookahead_frames_ref->data;
+
+    frames->format    = AV_PIX_FMT_VAAPI;
+    frames->sw_format = AV_PIX_FMT_NV12;
+    frames->width     = FFMAX(avctx->width  / LOOKAHEAD_SCALE,
+                              LOOKAHEAD_BLOCK_SIZE) & ~1;
+    frames->height    = FFMAX(avctx->height / LOOKAHEAD_SCALE,
+                              LOOKAHEAD_BLOCK_SIZE) & ~1;
+    // At most two pictures are waiting for analysis at any time.
+    frames->initial_pool_size = 4;
+
+    err = av_hwframe_ctx_init(ctx->lookahead_frames_ref);
+    if (err < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to initialise lookahead "
+               "frame context: %d.\n", err);
+        return err;
+    }
+    frames_hwctx = frames->hwctx;
+
+    vas = vaCreateConfig(ctx->hwctx->display, VAProfileNone,
+                         VAEntrypointVideoProc, NULL, 0,
+                         &ctx->lookahead_va_config);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create lookahead processing "
+               "configuration: %d (%s).\n", vas, vaErrorStr(vas));
+        return AVERROR(EIO);
+    }
+
+    vas = vaCreateContext(ctx->hwctx->display, ctx->lookahead_va_config,
+                          frames->width, frames->height, VA_PROGRESSIVE,
+                          frames_hwctx->surface_ids, frames_hwctx->nb_surfaces,
+                          &ctx->lookahead_va_context);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create lookahead processing "
+               "context: %d (%s).\n", vas, vaErrorStr(vas));
+        return AVERROR(EIO);
+    }
+
+    av_log(avctx, AV_LOG_VERBOSE, "Using lookahead of %d frames at "
+           "%dx%d.\n", ctx->lookahead, frames->width, frames->height);
+
+    return 0;
+}
+
 av_cold int ff_vaapi_encode_init(AVCodecContext *avctx)
 {
     VAAPIEncodeContext *ctx = avctx->priv_data;
@@ -2548,6 +2856,8 @@ av_cold int ff_vaapi_encode_init(AVCodecContext *avctx)
 
     ctx->va_config  = VA_INVALID_ID;
     ctx->va_context = VA_INVALID_ID;
+    ctx->lookahead_va_config  = VA_INVALID_ID;
+    ctx->lookahead_va_context = VA_INVALID_ID;
 
     /* If you add something that can fail above this av_frame_alloc(),
      * modify ff_vaapi_encode_close() accordingly. */
@@ -2656,6 +2966,12 @@ av_cold int ff_vaapi_encode_init(AVCodecContext *avctx)
         goto fail;
     }
 
+    if (ctx->lookahead) {
+        err = vaapi_encode_init_lookahead(avctx);
+        if (err < 0)
+            goto fail;
+    }
+
     ctx->output_buffer_pool =
         av_buffer_pool_init2(sizeof(VABufferID), avctx,
                              &vaapi_encode_alloc_output_buffer, NULL);
@@ -2768,6 +3084,19 @@ av_cold int ff_vaapi_encode_close(AVCodecContext *avctx)
         ctx->va_config = VA_INVALID_ID;
     }
 
+    if (ctx->lookahead_va_context != VA_INVALID_ID) {
+        vaDestroyContext(ctx->hwctx->display, ctx->lookahead_va_context);
+        ctx->lookahead_va_context = VA_INVALID_ID;
+    }
+
+    if (ctx->lookahead_va_config != VA_INVALID_ID) {
+        vaDestroyConfig(ctx->hwctx->display, ctx->lookahead_va_config);
+        ctx->lookahead_va_config = VA_INVALID_ID;
+    }
+
+    av_frame_free(&ctx->lookahead_prev);
+    av_buffer_unref(&ctx->lookahead_frames_ref);
+
     av_frame_free(&ctx->frame);
 
     av_freep(&ctx->codec_sequence_params);
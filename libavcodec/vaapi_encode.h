@@ -49,6 +49,7 @@ enum {
     // A.4.1: table A.6 allows at most 20 tile columns for any level.
     MAX_TILE_COLS          = 20,
     MAX_ASYNC_DEPTH        = 64,
+    MAX_LOOKAHEAD_DEPTH    = 64,
 };
 
 extern const AVCodecHWConfigInternal *const ff_vaapi_encode_hw_configs[];
@@ -127,6 +128,20 @@ typedef struct VAAPIEncodePicture {
 
     int          nb_slices;
     VAAPIEncodeSlice *slices;
+
+    // Downscaled copy of the input used by the lookahead, held until
+    // the picture has been analysed.
+    AVFrame        *lookahead_image;
+    // Lookahead costs: intra is the spatial activity of the picture,
+    // inter the (intra-bounded) difference to the previous picture.
+    int64_t         lookahead_intra_cost;
+    int64_t         lookahead_inter_cost;
+    int             lookahead_analysed;
+    // Set once the lookahead has made its decisions for this picture;
+    // it is not considered for encoding before that.
+    int             lookahead_done;
+    // QP offset applied on top of the fixed QP in CQP mode.
+    int             qp_delta;
 } VAAPIEncodePicture;
 
 typedef struct VAAPIEncodeProfile {
@@ -304,7 +319,7 @@ typedef struct VAAPIEncodeContext {
     int64_t         first_pts;
     int64_t         dts_pts_diff;
     int64_t         ts_ring[MAX_REORDER_DELAY * 3 +
-                            MAX_ASYNC_DEPTH];
+                            MAX_ASYNC_DEPTH + MAX_LOOKAHEAD_DEPTH];
 
     // Slice structure.
     int slice_block_rows;
@@ -360,6 +375,18 @@ typedef struct VAAPIEncodeContext {
     AVFifo          *encode_fifo;
     // Max number of frame buffered in encoder.
     int             async_depth;
+
+    // Number of pictures analysed ahead of the one being encoded.
+    int             lookahead;
+    // Scene change threshold for the lookahead (0 to disable).
+    int             lookahead_scenecut;
+    // Video processing pipeline producing the downscaled lookahead
+    // pictures.
+    VAConfigID      lookahead_va_config;
+    VAContextID     lookahead_va_context;
+    AVBufferRef    *lookahead_frames_ref;
+    // Downloaded copy of the most recently analysed picture.
+    AVFrame        *lookahead_prev;
 } VAAPIEncodeContext;
 
 enum {
@@ -486,7 +513,15 @@ int ff_vaapi_encode_close(AVCodecContext *avctx);
     { "max_frame_size", \
       "Maximum frame size (in bytes)",\
       OFFSET(common.max_frame_size), AV_OPT_TYPE_INT, \
-      { .i64 = 0 }, 0, INT_MAX, FLAGS }
+      { .i64 = 0 }, 0, INT_MAX, FLAGS }, \
+    { "lookahead", \
+      "Number of frames to analyse ahead for scene changes and QP adjustment", \
+      OFFSET(common.lookahead), AV_OPT_TYPE_INT, \
+      { .i64 = 0 }, 0, MAX_LOOKAHEAD_DEPTH, FLAGS }, \
+    { "scenecut", \
+      "Scene change threshold used by the lookahead (0 disables)", \
+      OFFSET(common.lookahead_scenecut), AV_OPT_TYPE_INT, \
+      { .i64 = 40 }, 0, 100, FLAGS }
 
 #define VAAPI_ENCODE_RC_MODE(name, desc) \
     { #name, desc, 0, AV_OPT_TYPE_CONST, { .i64 = RC_MODE_ ## name }, \
@@ -824,7 +824,7 @@ static int vaapi_encode_h264_init_slice_params(AVCodecContext *avctx,
     H264RawSliceHeader                *sh = &priv->raw_slice.header;
     VAEncPictureParameterBufferH264 *vpic = pic->codec_picture_params;
     VAEncSliceParameterBufferH264 *vslice = slice->codec_slice_params;
-    int i, j;
+    int i, j, qp;
 
     if (pic->type == PICTURE_TYPE_IDR) {
         sh->nal_unit_header.nal_unit_type = H264_NAL_IDR_SLICE;
@@ -848,11 +848,13 @@ static int vaapi_encode_h264_init_slice_params(AVCodecContext *avctx,
     sh->direct_spatial_mv_pred_flag = 1;
 
     if (pic->type == PICTURE_TYPE_B)
-        sh->slice_qp_delta = priv->fixed_qp_b - (pps->pic_init_qp_minus26 + 26);
+        qp = priv->fixed_qp_b;
     else if (pic->type == PICTURE_TYPE_P)
-        sh->slice_qp_delta = priv->fixed_qp_p - (pps->pic_init_qp_minus26 + 26);
+        qp = priv->fixed_qp_p;
     else
-        sh->slice_qp_delta = priv->fixed_qp_idr - (pps->pic_init_qp_minus26 + 26);
+        qp = priv->fixed_qp_idr;
+    qp = av_clip(qp + pic->qp_delta, 1, 51);
+    sh->slice_qp_delta = qp - (pps->pic_init_qp_minus26 + 26);
 
     if (pic->is_reference && pic->type != PICTURE_TYPE_IDR) {
         VAAPIEncodePicture *discard_list[MAX_DPB_SIZE];
@@ -955,7 +955,7 @@ static int vaapi_encode_h265_init_slice_params(AVCodecContext *avctx,
     H265RawSliceHeader                 *sh = &priv->raw_slice.header;
     VAEncPictureParameterBufferHEVC  *vpic = pic->codec_picture_params;
     VAEncSliceParameterBufferHEVC  *vslice = slice->codec_slice_params;
-    int i;
+    int i, qp;
 
     sh->nal_unit_header = (H265RawNALUnitHeader) {
         .nal_unit_type         = hpic->slice_nal_unit,
@@ -1072,11 +1072,13 @@ static int vaapi_encode_h265_init_slice_params(AVCodecContext *avctx,
         sps->sample_adaptive_offset_enabled_flag;
 
     if (pic->type == PICTURE_TYPE_B)
-        sh->slice_qp_delta = priv->fixed_qp_b - (pps->init_qp_minus26 + 26);
+        qp = priv->fixed_qp_b;
     else if (pic->type == PICTURE_TYPE_P)
-        sh->slice_qp_delta = priv->fixed_qp_p - (pps->init_qp_minus26 + 26);
+        qp = priv->fixed_qp_p;
     else
-        sh->slice_qp_delta = priv->fixed_qp_idr - (pps->init_qp_minus26 + 26);
+        qp = priv->fixed_qp_idr;
+    qp = av_clip(qp + pic->qp_delta, 1, 51);
+    sh->slice_qp_delta = qp - (pps->init_qp_minus26 + 26);
 
 
     *vslice = (VAEncSliceParameterBufferHEVC) {
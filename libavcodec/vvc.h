@@ -0,0 +1,104 @@
+/*
+ * H.266/VVC shared code
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_VVC_H
+#define AVCODEC_VVC_H
+
+/**
+ * Table 5 – NAL unit type codes and NAL unit type classes
+ * in T-REC-H.266-202008
+ */
+enum VVCNALUnitType {
+    VVC_TRAIL_NUT      = 0,
+    VVC_STSA_NUT       = 1,
+    VVC_RADL_NUT       = 2,
+    VVC_RASL_NUT       = 3,
+    VVC_RSV_VCL_4      = 4,
+    VVC_RSV_VCL_5      = 5,
+    VVC_RSV_VCL_6      = 6,
+    VVC_IDR_W_RADL     = 7,
+    VVC_IDR_N_LP       = 8,
+    VVC_CRA_NUT        = 9,
+    VVC_GDR_NUT        = 10,
+    VVC_RSV_IRAP_11    = 11,
+    VVC_OPI_NUT        = 12,
+    VVC_DCI_NUT        = 13,
+    VVC_VPS_NUT        = 14,
+    VVC_SPS_NUT        = 15,
+    VVC_PPS_NUT        = 16,
+    VVC_PREFIX_APS_NUT = 17,
+    VVC_SUFFIX_APS_NUT = 18,
+    VVC_PH_NUT         = 19,
+    VVC_AUD_NUT        = 20,
+    VVC_EOS_NUT        = 21,
+    VVC_EOB_NUT        = 22,
+    VVC_PREFIX_SEI_NUT = 23,
+    VVC_SUFFIX_SEI_NUT = 24,
+    VVC_FD_NUT         = 25,
+    VVC_RSV_NVCL_26    = 26,
+    VVC_RSV_NVCL_27    = 27,
+    VVC_UNSPEC_28      = 28,
+    VVC_UNSPEC_29      = 29,
+    VVC_UNSPEC_30      = 30,
+    VVC_UNSPEC_31      = 31,
+};
+
+enum VVCSliceType {
+    VVC_SLICE_TYPE_B = 0,
+    VVC_SLICE_TYPE_P = 1,
+    VVC_SLICE_TYPE_I = 2,
+};
+
+enum {
+    // 7.4.3.3: vps_max_layers_minus1 is in [0, 63].
+    VVC_MAX_LAYERS     = 64,
+    // 7.4.3.3: vps_max_sublayers_minus1 is in [0, 6].
+    VVC_MAX_SUBLAYERS  = 7,
+
+    // 7.4.3.3: vps_video_parameter_set_id is u(4).
+    VVC_MAX_VPS_COUNT = 16,
+    // 7.4.3.4: sps_seq_parameter_set_id is u(4).
+    VVC_MAX_SPS_COUNT = 16,
+    // 7.4.3.5: pps_pic_parameter_set_id is in [0, 63].
+    VVC_MAX_PPS_COUNT = 64,
+
+    // 7.4.3.18: the APS ids are in [0, 7] for ALF and scaling lists,
+    // and in [0, 3] for LMCS.
+    VVC_MAX_ALF_COUNT  = 8,
+    VVC_MAX_LMCS_COUNT = 4,
+    VVC_MAX_SL_COUNT   = 8,
+
+    // A.4.2: MaxDpbSize is bounded above by 16.
+    VVC_MAX_DPB_SIZE = 16,
+
+    // 7.4.3.4: CtbLog2SizeY is in [5, 7].
+    VVC_MIN_LOG2_CTB_SIZE = 5,
+    VVC_MAX_LOG2_CTB_SIZE = 7,
+
+    // A.4.1: table A.1 allows at most 20 tile columns and 440 tiles
+    // for any level.
+    VVC_MAX_TILE_COLUMNS = 20,
+    VVC_MAX_TILES_PER_AU = 440,
+
+    // A.4.1: table A.1 allows at most 1000 slices for any level.
+    VVC_MAX_SLICES = 1000,
+};
+
+#endif /* AVCODEC_VVC_H */
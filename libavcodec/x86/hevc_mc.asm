@@ -127,6 +127,23 @@ pb_qpel_shuffle_index: db  0,  1,  2,  3
                        db 18, 19, 20, 21
                        db 19, 20, 21, 22
 
+QPEL_TABLE 10, 1, w, avx512icl
+EPEL_TABLE 10, 1, w, avx512icl
+
+; word pairs (x + 2 * i, x + 2 * i + 1) of the i-th pair of filter taps
+pw_h_shuffle_index_10: dw  0,  1,  1,  2,  2,  3,  3,  4,  4,  5,  5,  6,  6,  7,  7,  8
+                       dw  8,  9,  9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16
+                       dw  2,  3,  3,  4,  4,  5,  5,  6,  6,  7,  7,  8,  8,  9,  9, 10
+                       dw 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18
+                       dw  4,  5,  5,  6,  6,  7,  7,  8,  8,  9,  9, 10, 10, 11, 11, 12
+                       dw 12, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19, 20
+                       dw  6,  7,  7,  8,  8,  9,  9, 10, 10, 11, 11, 12, 12, 13, 13, 14
+                       dw 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 21, 22
+
+; interleaves the words of two rows
+pw_v_interleave_index_10: dw  0, 32,  1, 33,  2, 34,  3, 35,  4, 36,  5, 37,  6, 38,  7, 39
+                          dw  8, 40,  9, 41, 10, 42, 11, 43, 12, 44, 13, 45, 14, 46, 15, 47
+
 SECTION .text
 
 %define MAX_PB_SIZE  64
@@ -1859,3 +1876,139 @@ HEVC_PUT_HEVC_QPEL_AVX512ICL 64, 8
 
 %endif
 %endif
+
+; The 10-bit filters are applied to pairs of words with vpdpwssd, each dword
+; lane accumulating the taps of one of the 16 pixels of a zmm register.
+
+; %1: qpel or epel, %2: offset of the filter in the table, %3: gpr for PIC
+%macro PEL_FILTER_10 3
+%ifidn %1, qpel
+%assign %%taps 8
+%else
+%assign %%taps 4
+%endif
+    dec             %2q
+    shl             %2q, %%taps / 4 + 2
+%ifdef PIC
+    lea             %3q, [hevc_%1_filters_avx512icl_10]
+    %define FILTER %3q
+%else
+    %define FILTER hevc_%1_filters_avx512icl_10
+%endif
+    vpbroadcastd    m14, [FILTER + %2q +  0]
+    vpbroadcastd    m15, [FILTER + %2q +  4]
+%if %%taps == 8
+    vpbroadcastd    m16, [FILTER + %2q +  8]
+    vpbroadcastd    m17, [FILTER + %2q + 12]
+%endif
+%endmacro
+
+; required: m10-m13 shuffle indices, m14-m17 filter, k1 load mask
+; %1: dst register, %2: pixel offset, %3: number of taps
+%macro PEL_H_COMPUTE_10 3
+    vmovdqu16       m4{k1}{z}, [srcq + 2 * %2 - %3 + 2]
+    pxor            m%1, m%1
+    vpermw           m5, m10, m4
+    vpdpwssd        m%1, m5, m14
+    vpermw           m5, m11, m4
+    vpdpwssd        m%1, m5, m15
+%if %3 == 8
+    vpermw           m5, m12, m4
+    vpdpwssd        m%1, m5, m16
+    vpermw           m5, m13, m4
+    vpdpwssd        m%1, m5, m17
+%endif
+    psrad           m%1, 2
+%endmacro
+
+; required: m10 interleave index, m14-m17 filter, tmp = src + 4 * srcstride
+; %1: dst register, %2: pixel offset, %3: number of taps
+%macro PEL_V_COMPUTE_10 3
+    pxor            m%1, m%1
+    movu            ym4, [srcq                + 2 * %2]
+    movu            ym5, [srcq + srcstrideq   + 2 * %2]
+    vpermt2w         m4, m10, m5
+    vpdpwssd        m%1, m4, m14
+    movu            ym4, [srcq + srcstrideq*2 + 2 * %2]
+    movu            ym5, [srcq + r3srcq       + 2 * %2]
+    vpermt2w         m4, m10, m5
+    vpdpwssd        m%1, m4, m15
+%if %3 == 8
+    movu            ym4, [tmpq                + 2 * %2]
+    movu            ym5, [tmpq + srcstrideq   + 2 * %2]
+    vpermt2w         m4, m10, m5
+    vpdpwssd        m%1, m4, m16
+    movu            ym4, [tmpq + srcstrideq*2 + 2 * %2]
+    movu            ym5, [tmpq + r3srcq       + 2 * %2]
+    vpermt2w         m4, m10, m5
+    vpdpwssd        m%1, m4, m17
+%endif
+    psrad           m%1, 2
+%endmacro
+
+; %1: qpel or epel, %2: width
+%macro HEVC_PUT_HEVC_PEL_10_AVX512ICL 2
+%ifidn %1, qpel
+%assign %%taps 8
+%else
+%assign %%taps 4
+%endif
+cglobal hevc_put_hevc_%1_h%2_10, 5, 6, 18, dst, src, srcstride, height, mx, tmp
+    PEL_FILTER_10    %1, mx, tmp
+    movu            m10, [pw_h_shuffle_index_10 +   0]
+    movu            m11, [pw_h_shuffle_index_10 +  64]
+%if %%taps == 8
+    movu            m12, [pw_h_shuffle_index_10 + 128]
+    movu            m13, [pw_h_shuffle_index_10 + 192]
+%endif
+    ; only load the 16 + taps - 1 pixels needed
+    mov            tmpd, (1 << (15 + %%taps)) - 1
+    kmovd            k1, tmpd
+.loop:
+%assign %%x 0
+%rep %2 / 16
+    PEL_H_COMPUTE_10  6, %%x, %%taps
+    vpmovdw [dstq + 2 * %%x], m6
+%assign %%x %%x + 16
+%endrep
+    LOOP_END        dst, src, srcstride
+    RET
+
+cglobal hevc_put_hevc_%1_v%2_10, 6, 8, 18, dst, src, srcstride, height, mx, my, r3src, tmp
+    PEL_FILTER_10    %1, my, tmp
+    movu            m10, [pw_v_interleave_index_10]
+    lea          r3srcq, [srcstrideq*3]
+%if %%taps == 8
+    sub            srcq, r3srcq
+%else
+    sub            srcq, srcstrideq
+%endif
+.loop:
+%if %%taps == 8
+    lea            tmpq, [srcq + srcstrideq*4]
+%endif
+%assign %%x 0
+%rep %2 / 16
+    PEL_V_COMPUTE_10  6, %%x, %%taps
+    vpmovdw [dstq + 2 * %%x], m6
+%assign %%x %%x + 16
+%endrep
+    LOOP_END        dst, src, srcstride
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX512ICL_EXTERNAL
+
+INIT_ZMM avx512icl
+HEVC_PUT_HEVC_PEL_10_AVX512ICL epel, 16
+HEVC_PUT_HEVC_PEL_10_AVX512ICL epel, 32
+HEVC_PUT_HEVC_PEL_10_AVX512ICL epel, 48
+HEVC_PUT_HEVC_PEL_10_AVX512ICL epel, 64
+HEVC_PUT_HEVC_PEL_10_AVX512ICL qpel, 16
+HEVC_PUT_HEVC_PEL_10_AVX512ICL qpel, 32
+HEVC_PUT_HEVC_PEL_10_AVX512ICL qpel, 48
+HEVC_PUT_HEVC_PEL_10_AVX512ICL qpel, 64
+
+%endif
+%endif
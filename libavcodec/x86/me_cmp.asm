@@ -667,6 +667,55 @@ SAD_Y2 16
 INIT_XMM sse2
 SAD_Y2 16
 
+%if HAVE_AVX2_EXTERNAL
+;------------------------------------------------------------------------------------------
+;int ff_sad16{,_x2,_y2}_avx2(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2,
+;                           ptrdiff_t stride, int h);
+;------------------------------------------------------------------------------------------
+; Two rows per register: the low lane holds row n, the high lane row n+1.
+; %1 = ymm register number, %2 = address of row n, %3 = address of row n+1
+%macro LOAD_2ROWS 3
+    movu           xm%1, [%2]
+    vinserti128     m%1, m%1, [%3], 1
+%endmacro
+
+; %1 = suffix: empty, _x2 or _y2
+%macro SAD16_AVX2 0-1
+cglobal sad16%1, 5, 5, 4, v, pix1, pix2, stride, h
+    pxor            m2, m2
+
+align 16
+.loop:
+    LOAD_2ROWS       0, pix2q, pix2q+strideq
+%ifidn %1, _x2
+    LOAD_2ROWS       3, pix2q+1, pix2q+strideq+1
+    pavgb           m0, m3
+%elifidn %1, _y2
+    LOAD_2ROWS       3, pix2q+strideq, pix2q+2*strideq
+    pavgb           m0, m3
+%endif
+    LOAD_2ROWS       1, pix1q, pix1q+strideq
+    psadbw          m0, m1
+    paddw           m2, m0
+    lea          pix1q, [pix1q+strideq*2]
+    lea          pix2q, [pix2q+strideq*2]
+    sub             hd, 2
+    jg .loop
+
+    vextracti128   xm0, m2, 1
+    paddw          xm2, xm0
+    movhlps        xm0, xm2
+    paddw          xm2, xm0
+    movd           eax, xm2
+    RET
+%endmacro
+
+INIT_YMM avx2
+SAD16_AVX2
+SAD16_AVX2 _x2
+SAD16_AVX2 _y2
+%endif
+
 ;-------------------------------------------------------------------------------------------
 ;int ff_sad_approx_xy2_<opt>(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2, ptrdiff_t stride, int h);
 ;-------------------------------------------------------------------------------------------
@@ -58,6 +58,12 @@ int ff_sad16_y2_mmxext(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pi
                        ptrdiff_t stride, int h);
 int ff_sad16_y2_sse2(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2,
                      ptrdiff_t stride, int h);
+int ff_sad16_avx2(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2,
+                  ptrdiff_t stride, int h);
+int ff_sad16_x2_avx2(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2,
+                     ptrdiff_t stride, int h);
+int ff_sad16_y2_avx2(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2,
+                     ptrdiff_t stride, int h);
 int ff_sad8_approx_xy2_mmxext(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2,
                               ptrdiff_t stride, int h);
 int ff_sad16_approx_xy2_mmxext(MpegEncContext *v, const uint8_t *pix1, const uint8_t *pix2,
@@ -307,4 +313,11 @@ av_cold void ff_me_cmp_init_x86(MECmpContext *c, AVCodecContext *avctx)
         c->hadamard8_diff[1] = ff_hadamard8_diff_ssse3;
 #endif
     }
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags) && avctx->codec_id != AV_CODEC_ID_SNOW) {
+        c->sad[0]        = ff_sad16_avx2;
+        c->pix_abs[0][0] = ff_sad16_avx2;
+        c->pix_abs[0][1] = ff_sad16_x2_avx2;
+        c->pix_abs[0][2] = ff_sad16_y2_avx2;
+    }
 }
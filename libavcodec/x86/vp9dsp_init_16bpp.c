@@ -44,6 +44,10 @@ decl_fpel_func(put, 128,    , avx);
 decl_fpel_func(avg,  32, _16, avx2);
 decl_fpel_func(avg,  64, _16, avx2);
 decl_fpel_func(avg, 128, _16, avx2);
+decl_fpel_func(put,  64,    , avx512);
+decl_fpel_func(put, 128,    , avx512);
+decl_fpel_func(avg,  64, _16, avx512);
+decl_fpel_func(avg, 128, _16, avx512);
 
 decl_ipred_fns(v,       16, mmx,    sse);
 decl_ipred_fns(h,       16, mmxext, sse2);
@@ -148,5 +152,12 @@ av_cold void ff_vp9dsp_init_16bpp_x86(VP9DSPContext *dsp)
 #endif
     }
 
+    if (EXTERNAL_AVX512(cpu_flags)) {
+        init_fpel_func(1, 0,  64, put, , avx512);
+        init_fpel_func(0, 0, 128, put, , avx512);
+        init_fpel_func(1, 1,  64, avg, _16, avx512);
+        init_fpel_func(0, 1, 128, avg, _16, avx512);
+    }
+
 #endif /* HAVE_X86ASM */
 }
@@ -566,6 +566,10 @@ filter_vx2_fn avg
 %if %2 == 4
 %define %%srcfn movh
 %define %%dstfn movh
+%elif mmsize == 64
+; the frame buffers are not guaranteed to be 64-byte aligned
+%define %%srcfn movu
+%define %%dstfn movu
 %else
 %define %%srcfn movu
 %define %%dstfn mova
@@ -637,6 +641,8 @@ cglobal vp9_%1%2 %+ %%szsuf, 5, 5, %8, dst, dstride, src, sstride, h
 %define s16 16
 %define d32 32
 %define s32 32
+%define d64 64
+%define s64 64
 INIT_MMX mmx
 fpel_fn put, 4,  strideq, strideq*2, stride3q, 4
 fpel_fn put, 8,  strideq, strideq*2, stride3q, 4
@@ -661,6 +667,12 @@ INIT_YMM avx2
 fpel_fn avg, 32, strideq, strideq*2, stride3q, 4, 8
 fpel_fn avg, 64, mmsize,  strideq,   strideq+mmsize, 2, 8
 %endif
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+fpel_fn put, 64, strideq, strideq*2, stride3q, 4
+fpel_fn put, 128, mmsize, strideq,   strideq+mmsize, 2
+fpel_fn avg, 64, strideq, strideq*2, stride3q, 4, 8
+%endif
 INIT_MMX mmxext
 fpel_fn avg,  8,  strideq, strideq*2, stride3q, 4, 16
 INIT_XMM sse2
@@ -674,7 +686,14 @@ fpel_fn avg,  32, strideq, strideq*2, stride3q, 4, 16
 fpel_fn avg,  64, mmsize,  strideq,   strideq+mmsize, 2, 16
 fpel_fn avg, 128, mmsize,  mmsize*2,  mmsize*3, 1, 16
 %endif
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+fpel_fn avg,  64, strideq, strideq*2, stride3q, 4, 16
+fpel_fn avg, 128, mmsize,  strideq,   strideq+mmsize, 2, 16
+%endif
 %undef s16
 %undef d16
 %undef s32
 %undef d32
+%undef s64
+%undef d64
@@ -39,6 +39,7 @@ extern "C" {
 #include "libavformat/avformat.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/internal.h"
 #include "libavutil/imgutils.h"
@@ -105,24 +106,51 @@ static VANCLineNumber vanc_line_numbers[] = {
     {bmdModeUnknown, 0, -1, -1, -1}
 };
 
+/* Room in front of each frame buffer for the reference to its pool entry,
+ * large enough to keep the frame data aligned. */
+#define ALLOCATOR_HEADER_SIZE 64
+
+/* Frame buffers are taken from a pool, so that the memory of released
+ * frames is reused instead of allocating and freeing a full frame for
+ * every captured frame. */
 class decklink_allocator : public IDeckLinkMemoryAllocator
 {
 public:
-        decklink_allocator(): _refs(1) { }
-        virtual ~decklink_allocator() { }
+        decklink_allocator(): _refs(1), _pool(NULL), _pool_size(0) { pthread_mutex_init(&_mutex, NULL); }
+        virtual ~decklink_allocator()
+        {
+            av_buffer_pool_uninit(&_pool);
+            pthread_mutex_destroy(&_mutex);
+        }
 
         // IDeckLinkMemoryAllocator methods
         virtual HRESULT STDMETHODCALLTYPE AllocateBuffer(unsigned int bufferSize, void* *allocatedBuffer)
         {
-            void *buf = av_malloc(bufferSize + AV_INPUT_BUFFER_PADDING_SIZE);
-            if (!buf)
+            AVBufferRef *ref;
+
+            pthread_mutex_lock(&_mutex);
+            if (bufferSize != _pool_size) {
+                /* Buffers still in use keep the old pool alive until they
+                 * are released. */
+                av_buffer_pool_uninit(&_pool);
+                _pool = av_buffer_pool_init(ALLOCATOR_HEADER_SIZE + bufferSize + AV_INPUT_BUFFER_PADDING_SIZE, NULL);
+                _pool_size = _pool ? bufferSize : 0;
+            }
+            ref = _pool ? av_buffer_pool_get(_pool) : NULL;
+            pthread_mutex_unlock(&_mutex);
+            if (!ref)
                 return E_OUTOFMEMORY;
-            *allocatedBuffer = buf;
+
+            memcpy(ref->data, &ref, sizeof(ref));
+            *allocatedBuffer = ref->data + ALLOCATOR_HEADER_SIZE;
             return S_OK;
         }
         virtual HRESULT STDMETHODCALLTYPE ReleaseBuffer(void* buffer)
         {
-            av_free(buffer);
+            AVBufferRef *ref;
+
+            memcpy(&ref, (uint8_t *)buffer - ALLOCATOR_HEADER_SIZE, sizeof(ref));
+            av_buffer_unref(&ref);
             return S_OK;
         }
         virtual HRESULT STDMETHODCALLTYPE Commit() { return S_OK; }
@@ -141,6 +169,9 @@ public:
 
 private:
         std::atomic<int>  _refs;
+        pthread_mutex_t   _mutex;
+        AVBufferPool     *_pool;
+        unsigned int      _pool_size;
 };
 
 extern "C" {
@@ -518,12 +549,6 @@ static int avpacket_queue_put(AVPacketQueue *q, AVPacket *pkt)
 {
     PacketListEntry *pkt1;
 
-    // Drop Packet if queue size is > maximum queue size
-    if (avpacket_queue_size(q) > (uint64_t)q->max_q_size) {
-        av_packet_unref(pkt);
-        av_log(q->avctx, AV_LOG_WARNING,  "Decklink input buffer overrun!\n");
-        return -1;
-    }
     /* ensure the packet is reference counted */
     if (av_packet_make_refcounted(pkt) < 0) {
         av_packet_unref(pkt);
@@ -540,6 +565,15 @@ static int avpacket_queue_put(AVPacketQueue *q, AVPacket *pkt)
 
     pthread_mutex_lock(&q->mutex);
 
+    // Drop Packet if queue size is > maximum queue size
+    if (q->size > (uint64_t)q->max_q_size) {
+        pthread_mutex_unlock(&q->mutex);
+        av_packet_unref(&pkt1->pkt);
+        av_free(pkt1);
+        av_log(q->avctx, AV_LOG_WARNING,  "Decklink input buffer overrun!\n");
+        return -1;
+    }
+
     if (!q->pkt_list.tail) {
         q->pkt_list.head = pkt1;
     } else {
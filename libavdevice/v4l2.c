@@ -34,6 +34,8 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_drm.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
@@ -115,6 +117,14 @@ struct video_data {
     ssize_t (*read_f)(int fd, void *buffer, size_t n);
     void *(*mmap_f)(void *start, size_t length, int prot, int flags, int fd, int64_t offset);
     int (*munmap_f)(void *_start, size_t length);
+
+    int drm_prime;      /**< Set by a private option. */
+    char *drm_device;   /**< Set by a private option. */
+    int bytesperline;
+    int *dmabuf_fds;
+    uint32_t drm_format;
+    AVBufferRef *device_ref;
+    AVBufferRef *frames_ref;
 };
 
 struct buff_data {
@@ -218,6 +228,8 @@ static int device_init(AVFormatContext *ctx, int *width, int *height,
     if (v4l2_ioctl(s->fd, VIDIOC_S_FMT, &fmt) < 0)
         res = AVERROR(errno);
 
+    s->bytesperline = fmt.fmt.pix.bytesperline;
+
     if ((*width != fmt.fmt.pix.width) || (*height != fmt.fmt.pix.height)) {
         av_log(ctx, AV_LOG_INFO,
                "The V4L2 driver changed the video from %dx%d to %dx%d\n",
@@ -440,6 +452,186 @@ static void mmap_release_buffer(void *opaque, uint8_t *data)
     enqueue_buffer(s, &buf);
 }
 
+static void drm_release_buffer(void *opaque, uint8_t *data)
+{
+    av_free(data);
+    mmap_release_buffer(opaque, NULL);
+}
+
+static void drm_free_frame(void *opaque, uint8_t *data)
+{
+    AVFrame *frame = (AVFrame*)data;
+
+    av_frame_free(&frame);
+}
+
+static const struct {
+    uint32_t v4l2_fmt;
+    uint32_t drm_fmt;
+} drm_formats[] = {
+    /* DRM fourccs use the same byte order as MKTAG(). */
+    { V4L2_PIX_FMT_YUYV,   MKTAG('Y', 'U', 'Y', 'V') },
+    { V4L2_PIX_FMT_UYVY,   MKTAG('U', 'Y', 'V', 'Y') },
+    { V4L2_PIX_FMT_NV12,   MKTAG('N', 'V', '1', '2') },
+    { V4L2_PIX_FMT_YUV420, MKTAG('Y', 'U', '1', '2') },
+#ifdef V4L2_PIX_FMT_XBGR32
+    { V4L2_PIX_FMT_XBGR32, MKTAG('X', 'R', '2', '4') },
+#endif
+};
+
+/**
+ * Export the capture buffers as DMA-BUF file descriptors and set up the
+ * hardware frames context in which they are returned.
+ */
+static int drm_init(AVFormatContext *ctx, enum AVPixelFormat sw_format)
+{
+    struct video_data *s = ctx->priv_data;
+    AVHWFramesContext *frames;
+    int i, res;
+
+    if (s->use_libv4l2) {
+        av_log(ctx, AV_LOG_ERROR, "drm_prime cannot be used with libv4l2.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(drm_formats); i++)
+        if (drm_formats[i].v4l2_fmt == s->pixelformat)
+            break;
+    if (i == FF_ARRAY_ELEMS(drm_formats) || sw_format == AV_PIX_FMT_NONE) {
+        av_log(ctx, AV_LOG_ERROR, "Pixel format %s cannot be exported as "
+               "DRM PRIME frames.\n", av_fourcc2str(s->pixelformat));
+        return AVERROR(ENOSYS);
+    }
+    s->drm_format = drm_formats[i].drm_fmt;
+
+    s->dmabuf_fds = av_malloc_array(s->buffers, sizeof(*s->dmabuf_fds));
+    if (!s->dmabuf_fds)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->buffers; i++)
+        s->dmabuf_fds[i] = -1;
+
+    for (i = 0; i < s->buffers; i++) {
+        struct v4l2_exportbuffer expbuf = {
+            .type  = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .index = i,
+            .flags = O_RDONLY,
+        };
+        if (v4l2_ioctl(s->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+            res = AVERROR(errno);
+            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_EXPBUF): %s\n", av_err2str(res));
+            return res;
+        }
+        s->dmabuf_fds[i] = expbuf.fd;
+    }
+
+    res = av_hwdevice_ctx_create(&s->device_ref, AV_HWDEVICE_TYPE_DRM,
+                                 s->drm_device, NULL, 0);
+    if (res < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to open DRM device %s.\n", s->drm_device);
+        return res;
+    }
+
+    s->frames_ref = av_hwframe_ctx_alloc(s->device_ref);
+    if (!s->frames_ref)
+        return AVERROR(ENOMEM);
+    frames = (AVHWFramesContext*)s->frames_ref->data;
+    frames->format    = AV_PIX_FMT_DRM_PRIME;
+    frames->sw_format = sw_format;
+    frames->width     = s->width;
+    frames->height    = s->height;
+
+    res = av_hwframe_ctx_init(s->frames_ref);
+    if (res < 0)
+        av_log(ctx, AV_LOG_ERROR, "Failed to initialise hardware frames context.\n");
+    return res;
+}
+
+/**
+ * Return the dequeued buffer as a DRM PRIME frame wrapped in pkt.
+ * The buffer is requeued once the frame is freed, or on failure.
+ */
+static int drm_wrap_frame(AVFormatContext *ctx, AVPacket *pkt,
+                          struct v4l2_buffer *buf)
+{
+    struct video_data *s = ctx->priv_data;
+    struct buff_data *buf_descriptor;
+    AVDRMFrameDescriptor *desc;
+    AVDRMLayerDescriptor *layer;
+    AVFrame *frame;
+    int chroma_h = (s->height + 1) >> 1;
+
+    buf_descriptor = av_malloc(sizeof(*buf_descriptor));
+    desc           = av_mallocz(sizeof(*desc));
+    frame          = av_frame_alloc();
+    if (!buf_descriptor || !desc || !frame) {
+        av_free(buf_descriptor);
+        av_free(desc);
+        av_frame_free(&frame);
+        enqueue_buffer(s, buf);
+        return AVERROR(ENOMEM);
+    }
+    buf_descriptor->index = buf->index;
+    buf_descriptor->s     = s;
+
+    desc->nb_objects      = 1;
+    desc->objects[0].fd   = s->dmabuf_fds[buf->index];
+    desc->objects[0].size = s->buf_len[buf->index];
+    desc->objects[0].format_modifier = 0; /* DRM_FORMAT_MOD_LINEAR */
+    desc->nb_layers       = 1;
+    layer                 = &desc->layers[0];
+    layer->format         = s->drm_format;
+    layer->nb_planes      = 1;
+    layer->planes[0].pitch = s->bytesperline;
+
+    switch (s->pixelformat) {
+    case V4L2_PIX_FMT_NV12:
+        layer->nb_planes = 2;
+        layer->planes[1].offset = s->bytesperline * s->height;
+        layer->planes[1].pitch  = s->bytesperline;
+        break;
+    case V4L2_PIX_FMT_YUV420:
+        layer->nb_planes = 3;
+        layer->planes[1].offset = s->bytesperline * s->height;
+        layer->planes[1].pitch  = s->bytesperline / 2;
+        layer->planes[2].offset = layer->planes[1].offset +
+                                  layer->planes[1].pitch * chroma_h;
+        layer->planes[2].pitch  = s->bytesperline / 2;
+        break;
+    }
+
+    frame->buf[0] = av_buffer_create((uint8_t*)desc, sizeof(*desc),
+                                     drm_release_buffer, buf_descriptor, 0);
+    if (!frame->buf[0]) {
+        av_free(buf_descriptor);
+        av_free(desc);
+        av_frame_free(&frame);
+        enqueue_buffer(s, buf);
+        return AVERROR(ENOMEM);
+    }
+    frame->data[0] = (uint8_t*)desc;
+    frame->format  = AV_PIX_FMT_DRM_PRIME;
+    frame->width   = s->width;
+    frame->height  = s->height;
+
+    /* From here on, freeing the frame requeues the buffer. */
+    frame->hw_frames_ctx = av_buffer_ref(s->frames_ref);
+    if (!frame->hw_frames_ctx)
+        goto fail;
+
+    pkt->buf = av_buffer_create((uint8_t*)frame, sizeof(*frame),
+                                drm_free_frame, NULL, 0);
+    if (!pkt->buf)
+        goto fail;
+    pkt->data   = (uint8_t*)frame;
+    pkt->size   = sizeof(*frame);
+    pkt->flags |= AV_PKT_FLAG_TRUSTED;
+    return 0;
+
+fail:
+    av_frame_free(&frame);
+    return AVERROR(ENOMEM);
+}
+
 #if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
 static int64_t av_gettime_monotonic(void)
 {
@@ -557,8 +749,22 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
         }
     }
 
-    /* Image is at s->buff_start[buf.index] */
-    if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+    if (s->drm_prime) {
+        if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+            /* DMA-BUF frames cannot be copied out like below, so drop the
+             * frame to keep the device fed. */
+            av_log(ctx, AV_LOG_WARNING, "Too many buffers held by the caller, "
+                   "dropping a frame.\n");
+            res = enqueue_buffer(s, &buf);
+            return res < 0 ? res : AVERROR(EAGAIN);
+        }
+        res = drm_wrap_frame(ctx, pkt, &buf);
+        if (res < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to wrap the buffer in a frame\n");
+            return res;
+        }
+    } else if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+        /* Image is at s->buff_start[buf.index] */
         /* when we start getting low on queued buffers, fall back on copying data */
         res = av_new_packet(pkt, buf.bytesused);
         if (res < 0) {
@@ -652,7 +858,10 @@ static void mmap_close(struct video_data *s)
     v4l2_ioctl(s->fd, VIDIOC_STREAMOFF, &type);
     for (i = 0; i < s->buffers; i++) {
         v4l2_munmap(s->buf_start[i], s->buf_len[i]);
+        if (s->dmabuf_fds && s->dmabuf_fds[i] >= 0)
+            close(s->dmabuf_fds[i]);
     }
+    av_freep(&s->dmabuf_fds);
     av_freep(&s->buf_start);
     av_freep(&s->buf_len);
 }
@@ -962,6 +1171,7 @@ static int v4l2_read_header(AVFormatContext *ctx)
                                                  s->width, s->height, 1);
 
     if ((res = mmap_init(ctx)) ||
+        (s->drm_prime && (res = drm_init(ctx, st->codecpar->format)) < 0) ||
         (res = mmap_start(ctx)) < 0)
             goto fail;
 
@@ -984,9 +1194,21 @@ static int v4l2_read_header(AVFormatContext *ctx)
     if (st->avg_frame_rate.den)
         st->codecpar->bit_rate = s->frame_size * av_q2d(st->avg_frame_rate) * 8;
 
+    if (s->drm_prime) {
+        st->codecpar->codec_id  = AV_CODEC_ID_WRAPPED_AVFRAME;
+        st->codecpar->codec_tag = 0;
+        st->codecpar->format    = AV_PIX_FMT_DRM_PRIME;
+    }
+
     return 0;
 
 fail:
+    av_buffer_unref(&s->frames_ref);
+    av_buffer_unref(&s->device_ref);
+    for (int i = 0; s->dmabuf_fds && i < s->buffers; i++)
+        if (s->dmabuf_fds[i] >= 0)
+            close(s->dmabuf_fds[i]);
+    av_freep(&s->dmabuf_fds);
     v4l2_close(s->fd);
     return res;
 }
@@ -1011,6 +1233,8 @@ static int v4l2_read_close(AVFormatContext *ctx)
                "close.\n");
 
     mmap_close(s);
+    av_buffer_unref(&s->frames_ref);
+    av_buffer_unref(&s->device_ref);
 
     ff_timefilter_destroy(s->timefilter);
     v4l2_close(s->fd);
@@ -1123,6 +1347,8 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) conversion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_BOOL,   {.i64 = 0}, 0, 1, DEC },
+    { "drm_prime",    "output frames as exported DMA-BUFs (DRM PRIME) instead of raw packets", OFFSET(drm_prime), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "drm_device",   "DRM device of the hardware frames context used with drm_prime", OFFSET(drm_device), AV_OPT_TYPE_STRING, {.str = "/dev/dri/card0"}, 0, 0, DEC },
     { NULL },
 };
 
@@ -38,6 +38,12 @@
 #include <xcb/shape.h>
 #endif
 
+#if CONFIG_LIBXCB_DAMAGE
+#include <xcb/damage.h>
+#endif
+
+#include "libavutil/bprint.h"
+#include "libavutil/dict.h"
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
@@ -47,6 +53,9 @@
 #include "libavformat/avformat.h"
 #include "libavformat/internal.h"
 
+/* Past this many changed rectangles per frame, report their bounding box. */
+#define MAX_DAMAGE_RECTS 64
+
 typedef struct XCBGrabContext {
     const AVClass *class;
 
@@ -76,6 +85,19 @@ typedef struct XCBGrabContext {
     const char *framerate;
 
     int has_shm;
+
+    int damage;
+    int skip_unchanged;
+#if CONFIG_LIBXCB_DAMAGE
+    xcb_damage_damage_t damage_id;
+    uint8_t damage_event;
+    xcb_rectangle_t damage_rects[MAX_DAMAGE_RECTS];
+    int nb_damage_rects;
+    int damage_overflow;
+    int have_frame;
+    int last_x, last_y;
+    int16_t last_pointer_x, last_pointer_y;
+#endif
 } XCBGrabContext;
 
 #define FOLLOW_CENTER -1
@@ -97,6 +119,8 @@ static const AVOption options[] = {
     { "show_region", "Show the grabbing region.", OFFSET(show_region), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D },
     { "region_border", "Set the region border thickness.", OFFSET(region_border), AV_OPT_TYPE_INT, { .i64 = 3 }, 1, 128, D },
     { "select_region", "Select the grabbing region graphically using the pointer.", OFFSET(select_region), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "damage", "Track changed screen areas and export them as packet metadata.", OFFSET(damage), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "skip_unchanged", "Do not output frames when nothing changed on screen.", OFFSET(skip_unchanged), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
     { NULL },
 };
 
@@ -399,6 +423,116 @@ static void xcbgrab_draw_mouse(AVFormatContext *s, AVPacket *pkt,
 }
 #endif /* CONFIG_LIBXCB_XFIXES */
 
+#if CONFIG_LIBXCB_DAMAGE
+static int check_damage(xcb_connection_t *conn, uint8_t *first_event)
+{
+    const xcb_query_extension_reply_t *ext;
+    xcb_damage_query_version_cookie_t cookie;
+    xcb_damage_query_version_reply_t *reply;
+
+    ext = xcb_get_extension_data(conn, &xcb_damage_id);
+    if (!ext || !ext->present)
+        return 0;
+
+    cookie = xcb_damage_query_version(conn, XCB_DAMAGE_MAJOR_VERSION,
+                                      XCB_DAMAGE_MINOR_VERSION);
+    reply  = xcb_damage_query_version_reply(conn, cookie, NULL);
+
+    if (reply) {
+        free(reply);
+        *first_event = ext->first_event;
+        return 1;
+    }
+    return 0;
+}
+
+static void xcbgrab_add_damage(XCBGrabContext *c, const xcb_rectangle_t *area)
+{
+    int x0 = FFMAX(area->x, c->x);
+    int y0 = FFMAX(area->y, c->y);
+    int x1 = FFMIN(area->x + area->width,  c->x + c->width);
+    int y1 = FFMIN(area->y + area->height, c->y + c->height);
+    xcb_rectangle_t *r;
+
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    if (c->damage_overflow || c->nb_damage_rects == MAX_DAMAGE_RECTS) {
+        /* Too many rectangles, only keep their bounding box. */
+        for (int i = 0; i < c->nb_damage_rects; i++) {
+            r  = &c->damage_rects[i];
+            x0 = FFMIN(x0, r->x);
+            y0 = FFMIN(y0, r->y);
+            x1 = FFMAX(x1, r->x + r->width);
+            y1 = FFMAX(y1, r->y + r->height);
+        }
+        c->nb_damage_rects = 0;
+        c->damage_overflow = 1;
+    }
+    r = &c->damage_rects[c->nb_damage_rects++];
+
+    r->x      = x0;
+    r->y      = y0;
+    r->width  = x1 - x0;
+    r->height = y1 - y0;
+}
+
+/**
+ * Collect the pending damage events.
+ *
+ * @return 1 if something in the grabbed region changed, 0 otherwise
+ */
+static int xcbgrab_poll_damage(AVFormatContext *s)
+{
+    XCBGrabContext *c = s->priv_data;
+    xcb_generic_event_t *event;
+
+    while ((event = xcb_poll_for_event(c->conn))) {
+        if ((event->response_type & ~0x80) == c->damage_event + XCB_DAMAGE_NOTIFY) {
+            xcb_damage_notify_event_t *notify = (xcb_damage_notify_event_t *)event;
+            xcbgrab_add_damage(c, &notify->area);
+        }
+        free(event);
+    }
+
+    return c->nb_damage_rects > 0;
+}
+
+static int xcbgrab_export_damage(AVFormatContext *s, AVPacket *pkt)
+{
+    XCBGrabContext *c = s->priv_data;
+    AVDictionary *dict = NULL;
+    AVBPrint bp;
+    uint8_t *data;
+    size_t size;
+    int ret;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    for (int i = 0; i < c->nb_damage_rects; i++) {
+        const xcb_rectangle_t *r = &c->damage_rects[i];
+        av_bprintf(&bp, "%s%d,%d,%d,%d", i ? " " : "",
+                   r->x - c->x, r->y - c->y, r->width, r->height);
+    }
+    c->nb_damage_rects = 0;
+    c->damage_overflow = 0;
+
+    ret = av_dict_set(&dict, "damage", bp.str, 0);
+    av_bprint_finalize(&bp, NULL);
+    if (ret < 0)
+        return ret;
+
+    data = av_packet_pack_dictionary(dict, &size);
+    av_dict_free(&dict);
+    if (!data)
+        return AVERROR(ENOMEM);
+
+    ret = av_packet_add_side_data(pkt, AV_PKT_DATA_STRINGS_METADATA, data, size);
+    if (ret < 0)
+        av_free(data);
+    return ret;
+}
+#endif /* CONFIG_LIBXCB_DAMAGE */
+
 static void xcbgrab_update_region(AVFormatContext *s, int win_x, int win_y)
 {
     XCBGrabContext *c     = s->priv_data;
@@ -462,6 +596,31 @@ static int xcbgrab_read_packet(AVFormatContext *s, AVPacket *pkt)
     if (c->show_region)
         xcbgrab_update_region(s, win_x, win_y);
 
+#if CONFIG_LIBXCB_DAMAGE
+    if (c->damage) {
+        int changed = xcbgrab_poll_damage(s) || !c->have_frame ||
+                      c->x != c->last_x || c->y != c->last_y;
+
+        if (c->draw_mouse && p)
+            changed |= p->win_x != c->last_pointer_x ||
+                       p->win_y != c->last_pointer_y;
+
+        if (c->skip_unchanged && !changed) {
+            free(p);
+            free(geo);
+            return AVERROR(EAGAIN);
+        }
+
+        c->have_frame = 1;
+        c->last_x     = c->x;
+        c->last_y     = c->y;
+        if (p) {
+            c->last_pointer_x = p->win_x;
+            c->last_pointer_y = p->win_y;
+        }
+    }
+#endif
+
 #if CONFIG_LIBXCB_SHM
     if (c->has_shm && xcbgrab_frame_shm(s, pkt) < 0) {
         av_log(s, AV_LOG_WARNING, "Continuing without shared memory.\n");
@@ -478,6 +637,11 @@ static int xcbgrab_read_packet(AVFormatContext *s, AVPacket *pkt)
         xcbgrab_draw_mouse(s, pkt, p, geo, win_x, win_y);
 #endif
 
+#if CONFIG_LIBXCB_DAMAGE
+    if (ret >= 0 && c->damage)
+        ret = xcbgrab_export_damage(s, pkt);
+#endif
+
     free(p);
     free(geo);
 
@@ -492,6 +656,11 @@ static av_cold int xcbgrab_read_close(AVFormatContext *s)
     av_buffer_pool_uninit(&ctx->shm_pool);
 #endif
 
+#if CONFIG_LIBXCB_DAMAGE
+    if (ctx->damage_id)
+        xcb_damage_destroy(ctx->conn, ctx->damage_id);
+#endif
+
     xcb_disconnect(ctx->conn);
 
     return 0;
@@ -894,6 +1063,26 @@ static av_cold int xcbgrab_read_header(AVFormatContext *s)
     }
 #endif
 
+    if (c->damage) {
+#if CONFIG_LIBXCB_DAMAGE
+        if (check_damage(c->conn, &c->damage_event)) {
+            c->damage_id = xcb_generate_id(c->conn);
+            xcb_damage_create(c->conn, c->damage_id, c->window_id,
+                              XCB_DAMAGE_REPORT_LEVEL_RAW_RECTANGLES);
+            xcb_flush(c->conn);
+        } else
+#endif
+        {
+            av_log(s, AV_LOG_WARNING,
+                   "XDamage not available, cannot track changed areas.\n");
+            c->damage = 0;
+        }
+    }
+    if (c->skip_unchanged && !c->damage) {
+        av_log(s, AV_LOG_WARNING, "skip_unchanged requires damage tracking, ignoring.\n");
+        c->skip_unchanged = 0;
+    }
+
     if (c->show_region)
         setup_window(s);
 
@@ -83,8 +83,6 @@ typedef struct DeNoiseChannel {
     double     *min_abs_var;
     void       *fft_in;
     void       *fft_out;
-    AVTXContext *fft, *ifft;
-    av_tx_fn   tx_fn, itx_fn;
 
     double      noise_band_norm[NB_PROFILE_BANDS];
     double      noise_band_avr[NB_PROFILE_BANDS];
@@ -145,6 +143,10 @@ typedef struct AudioFFTDeNoiseContext {
 
     DeNoiseChannel *dnch;
 
+    int          nb_tx;
+    AVTXContext **fft, **ifft;
+    av_tx_fn     tx_fn, itx_fn;
+
     AVFrame *winframe;
 
     double  window_weight;
@@ -365,26 +367,36 @@ static void process_frame(AVFilterContext *ctx,
     AVComplexDouble *fft_data_dbl = dnch->fft_out;
     AVComplexFloat *fft_data_flt = dnch->fft_out;
     double *gain = dnch->gain;
+    double *power = dnch->clean_data;
 
-    for (int i = 0; i < s->bin_count; i++) {
-        double sqr_new_gain, new_gain, power, mag, mag_abs_var, new_mag_abs_var;
+    /* The clean data is derived bin by bin from the power, share the buffer. */
+    switch (s->format) {
+    case AV_SAMPLE_FMT_FLTP:
+        for (int i = 0; i < s->bin_count; i++) {
+            const double re = fft_data_flt[i].re, im = fft_data_flt[i].im;
 
-        switch (s->format) {
-        case AV_SAMPLE_FMT_FLTP:
-            noisy_data[i] = mag = hypot(fft_data_flt[i].re, fft_data_flt[i].im);
-            break;
-        case AV_SAMPLE_FMT_DBLP:
-            noisy_data[i] = mag = hypot(fft_data_dbl[i].re, fft_data_dbl[i].im);
-            break;
+            power[i] = re * re + im * im;
         }
+        break;
+    case AV_SAMPLE_FMT_DBLP:
+        for (int i = 0; i < s->bin_count; i++) {
+            const double re = fft_data_dbl[i].re, im = fft_data_dbl[i].im;
+
+            power[i] = re * re + im * im;
+        }
+        break;
+    }
+
+    for (int i = 0; i < s->bin_count; i++) {
+        double sqr_new_gain, new_gain, mag_abs_var, new_mag_abs_var;
 
-        power = mag * mag;
-        mag_abs_var = power / abs_var[i];
+        noisy_data[i] = sqrt(power[i]);
+        mag_abs_var = power[i] / abs_var[i];
         new_mag_abs_var = ratio * prior[i] + rratio * fmax(mag_abs_var - 1.0, 0.0);
         new_gain = new_mag_abs_var / (1.0 + new_mag_abs_var);
         sqr_new_gain = new_gain * new_gain;
         prior[i] = mag_abs_var * sqr_new_gain;
-        dnch->clean_data[i] = power * sqr_new_gain;
+        dnch->clean_data[i] = power[i] * sqr_new_gain;
         gain[i] = new_gain;
     }
 
@@ -714,6 +726,22 @@ static int config_input(AVFilterLink *inlink)
     if (!s->band_alpha || !s->band_beta)
         return AVERROR(ENOMEM);
 
+    /* One pair of transforms per job, shared by the channels of that job. */
+    s->nb_tx = FFMIN(s->channels, ff_filter_get_nb_threads(ctx));
+    s->fft = av_calloc(s->nb_tx, sizeof(*s->fft));
+    s->ifft = av_calloc(s->nb_tx, sizeof(*s->ifft));
+    if (!s->fft || !s->ifft)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->nb_tx; i++) {
+        ret = av_tx_init(&s->fft[i], &s->tx_fn, tx_type, 0, s->fft_length2, scale, 0);
+        if (ret < 0)
+            return ret;
+        ret = av_tx_init(&s->ifft[i], &s->itx_fn, tx_type, 1, s->fft_length2, scale, 0);
+        if (ret < 0)
+            return ret;
+    }
+
     for (int ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
         DeNoiseChannel *dnch = &s->dnch[ch];
 
@@ -754,12 +782,6 @@ static int config_input(AVFilterLink *inlink)
         dnch->min_abs_var = av_calloc(s->bin_count, sizeof(*dnch->min_abs_var));
         dnch->fft_in = av_calloc(s->fft_length2, s->sample_size);
         dnch->fft_out = av_calloc(s->fft_length2 + 1, s->complex_sample_size);
-        ret = av_tx_init(&dnch->fft, &dnch->tx_fn, tx_type, 0, s->fft_length2, scale, 0);
-        if (ret < 0)
-            return ret;
-        ret = av_tx_init(&dnch->ifft, &dnch->itx_fn, tx_type, 1, s->fft_length2, scale, 0);
-        if (ret < 0)
-            return ret;
         dnch->spread_function = av_calloc(s->number_of_bands * s->number_of_bands,
                                           sizeof(*dnch->spread_function));
 
@@ -773,14 +795,12 @@ static int config_input(AVFilterLink *inlink)
             !dnch->clean_data ||
             !dnch->noisy_data ||
             !dnch->out_samples ||
-            !dnch->fft_in ||
-            !dnch->fft_out ||
             !dnch->abs_var ||
             !dnch->rel_var ||
             !dnch->min_abs_var ||
-            !dnch->spread_function ||
-            !dnch->fft ||
-            !dnch->ifft)
+            !dnch->fft_in ||
+            !dnch->fft_out ||
+            !dnch->spread_function)
             return AVERROR(ENOMEM);
     }
 
@@ -902,37 +922,13 @@ static void init_sample_noise(DeNoiseChannel *dnch)
 }
 
 static void sample_noise_block(AudioFFTDeNoiseContext *s,
-                               DeNoiseChannel *dnch,
-                               AVFrame *in, int ch)
+                               DeNoiseChannel *dnch)
 {
-    double *src_dbl = (double *)in->extended_data[ch];
-    float *src_flt = (float *)in->extended_data[ch];
     double mag2, var = 0.0, avr = 0.0, avi = 0.0;
     AVComplexDouble *fft_out_dbl = dnch->fft_out;
     AVComplexFloat *fft_out_flt = dnch->fft_out;
-    double *fft_in_dbl = dnch->fft_in;
-    float *fft_in_flt = dnch->fft_in;
     int edge, j, k, n, edgemax;
 
-    switch (s->format) {
-    case AV_SAMPLE_FMT_FLTP:
-        for (int i = 0; i < s->window_length; i++)
-            fft_in_flt[i] = s->window[i] * src_flt[i] * (1LL << 23);
-
-        for (int i = s->window_length; i < s->fft_length2; i++)
-            fft_in_flt[i] = 0.f;
-        break;
-    case AV_SAMPLE_FMT_DBLP:
-        for (int i = 0; i < s->window_length; i++)
-            fft_in_dbl[i] = s->window[i] * src_dbl[i] * (1LL << 23);
-
-        for (int i = s->window_length; i < s->fft_length2; i++)
-            fft_in_dbl[i] = 0.;
-        break;
-    }
-
-    dnch->tx_fn(dnch->fft, dnch->fft_out, dnch->fft_in, s->sample_size);
-
     edge = s->noise_band_edge[0];
     j = edge;
     k = 0;
@@ -1040,7 +1036,7 @@ static void set_noise_profile(AudioFFTDeNoiseContext *s,
     memcpy(dnch->band_noise, new_band_noise, sizeof(new_band_noise));
 }
 
-static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static int forward_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     AudioFFTDeNoiseContext *s = ctx->priv;
     AVFrame *in = arg;
@@ -1053,7 +1049,6 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
         DeNoiseChannel *dnch = &s->dnch[ch];
         const double *src_dbl = (const double *)in->extended_data[ch];
         const float *src_flt = (const float *)in->extended_data[ch];
-        double *dst = dnch->out_samples;
         double *fft_in_dbl = dnch->fft_in;
         float *fft_in_flt = dnch->fft_in;
 
@@ -1073,24 +1068,60 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
                 fft_in_dbl[m] = 0.;
             break;
         }
+    }
+
+    for (int ch = start; ch < end; ch++) {
+        DeNoiseChannel *dnch = &s->dnch[ch];
+
+        s->tx_fn(s->fft[jobnr], dnch->fft_out, dnch->fft_in, s->sample_size);
+    }
+
+    if (s->sample_noise) {
+        for (int ch = start; ch < end; ch++)
+            sample_noise_block(s, &s->dnch[ch]);
+    }
+
+    return 0;
+}
+
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AudioFFTDeNoiseContext *s = ctx->priv;
+    AVFrame *in = arg;
+    const int start = (in->ch_layout.nb_channels * jobnr) / nb_jobs;
+    const int end = (in->ch_layout.nb_channels * (jobnr+1)) / nb_jobs;
+    const int window_length = s->window_length;
+    const double *window = s->window;
 
-        dnch->tx_fn(dnch->fft, dnch->fft_out, dnch->fft_in, s->sample_size);
+    for (int ch = start; ch < end; ch++) {
+        DeNoiseChannel *dnch = &s->dnch[ch];
 
         process_frame(ctx, s, dnch,
                       dnch->prior,
                       dnch->prior_band_excit,
                       s->track_noise);
+    }
 
-        dnch->itx_fn(dnch->ifft, dnch->fft_in, dnch->fft_out, s->complex_sample_size);
+    for (int ch = start; ch < end; ch++) {
+        DeNoiseChannel *dnch = &s->dnch[ch];
+
+        s->itx_fn(s->ifft[jobnr], dnch->fft_in, dnch->fft_out, s->complex_sample_size);
+    }
+
+    for (int ch = start; ch < end; ch++) {
+        DeNoiseChannel *dnch = &s->dnch[ch];
+        const double *fft_in_dbl = dnch->fft_in;
+        const float *fft_in_flt = dnch->fft_in;
+        double *dst = dnch->out_samples;
 
         switch (s->format) {
         case AV_SAMPLE_FMT_FLTP:
             for (int m = 0; m < window_length; m++)
-                dst[m] += s->window[m] * fft_in_flt[m] / (1LL << 23);
+                dst[m] += window[m] * fft_in_flt[m] / (1LL << 23);
             break;
         case AV_SAMPLE_FMT_DBLP:
             for (int m = 0; m < window_length; m++)
-                dst[m] += s->window[m] * fft_in_dbl[m] / (1LL << 23);
+                dst[m] += window[m] * fft_in_dbl[m] / (1LL << 23);
             break;
         }
     }
@@ -1159,14 +1190,10 @@ static int output_frame(AVFilterLink *inlink, AVFrame *in)
         s->sample_noise_blocks = 0;
     }
 
-    if (s->sample_noise) {
-        for (int ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
-            DeNoiseChannel *dnch = &s->dnch[ch];
+    ff_filter_execute(ctx, forward_channels, s->winframe, NULL, s->nb_tx);
 
-            sample_noise_block(s, dnch, s->winframe, ch);
-        }
+    if (s->sample_noise)
         s->sample_noise_blocks++;
-    }
 
     if (s->sample_noise_mode == SAMPLE_STOP) {
         for (int ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
@@ -1184,8 +1211,7 @@ static int output_frame(AVFilterLink *inlink, AVFrame *in)
         s->sample_noise_mode = SAMPLE_NONE;
     }
 
-    ff_filter_execute(ctx, filter_channel, s->winframe, NULL,
-                      FFMIN(outlink->ch_layout.nb_channels, ff_filter_get_nb_threads(ctx)));
+    ff_filter_execute(ctx, filter_channels, s->winframe, NULL, s->nb_tx);
 
     if (av_frame_is_writable(in)) {
         out = in;
@@ -1316,11 +1342,18 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_freep(&dnch->min_abs_var);
             av_freep(&dnch->fft_in);
             av_freep(&dnch->fft_out);
-            av_tx_uninit(&dnch->fft);
-            av_tx_uninit(&dnch->ifft);
         }
         av_freep(&s->dnch);
     }
+
+    for (int i = 0; i < s->nb_tx; i++) {
+        if (s->fft)
+            av_tx_uninit(&s->fft[i]);
+        if (s->ifft)
+            av_tx_uninit(&s->ifft[i]);
+    }
+    av_freep(&s->fft);
+    av_freep(&s->ifft);
 }
 
 static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
@@ -177,8 +177,23 @@ typedef struct MixContext {
     float *scale_norm;          /**< normalization factor for every input */
     int64_t next_pts;           /**< calculated pts for next output frame */
     FrameList *frame_list;      /**< list of frame info for the first input */
+
+    int nb_threads;
+    uint8_t *mix_buf;           /**< one block of input samples for each thread */
+    uint8_t **mix_ptrs;         /**< planes of each thread block in mix_buf */
+    int *mix_inputs;            /**< indexes of the inputs to mix */
+    float *mix_scales;          /**< scale factor of each input to mix */
 } MixContext;
 
+/* number of samples mixed from all inputs at a time, kept small enough for
+ * the output and input blocks to stay in the L1 cache */
+#define MIX_BLOCK_SIZE 512
+
+typedef struct ThreadData {
+    AVFrame *out;
+    int nb_active;              /**< number of inputs to mix */
+} ThreadData;
+
 #define OFFSET(x) offsetof(MixContext, x)
 #define A AV_OPT_FLAG_AUDIO_PARAM
 #define F AV_OPT_FLAG_FILTERING_PARAM
@@ -245,7 +260,7 @@ static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext *s      = ctx->priv;
-    int i;
+    int i, planes, block_size;
     char buf[64];
 
     s->planar          = av_sample_fmt_is_planar(outlink->format);
@@ -276,12 +291,25 @@ static int config_output(AVFilterLink *outlink)
 
     s->input_scale = av_calloc(s->nb_inputs, sizeof(*s->input_scale));
     s->scale_norm  = av_calloc(s->nb_inputs, sizeof(*s->scale_norm));
-    if (!s->input_scale || !s->scale_norm)
+    s->mix_inputs  = av_calloc(s->nb_inputs, sizeof(*s->mix_inputs));
+    s->mix_scales  = av_calloc(s->nb_inputs, sizeof(*s->mix_scales));
+    if (!s->input_scale || !s->scale_norm || !s->mix_inputs || !s->mix_scales)
         return AVERROR(ENOMEM);
     for (i = 0; i < s->nb_inputs; i++)
         s->scale_norm[i] = s->weight_sum / FFABS(s->weights[i]);
     calculate_scales(s, 0);
 
+    planes = s->planar ? s->nb_channels : 1;
+    block_size = MIX_BLOCK_SIZE * (s->planar ? 1 : s->nb_channels) *
+                 av_get_bytes_per_sample(outlink->format);
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->mix_buf  = av_calloc(s->nb_threads * planes, block_size);
+    s->mix_ptrs = av_calloc(s->nb_threads * planes, sizeof(*s->mix_ptrs));
+    if (!s->mix_buf || !s->mix_ptrs)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_threads * planes; i++)
+        s->mix_ptrs[i] = s->mix_buf + (size_t)i * block_size;
+
     av_channel_layout_describe(&outlink->ch_layout, buf, sizeof(buf));
 
     av_log(ctx, AV_LOG_VERBOSE,
@@ -291,6 +319,53 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+/**
+ * Mix a range of blocks of all the inputs into the output frame. The input
+ * FIFOs are only peeked at, so the jobs can run concurrently.
+ */
+static int mix_samples(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MixContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *out = td->out;
+    const int planes    = s->planar ? s->nb_channels : 1;
+    const int stride    = s->planar ? 1 : s->nb_channels;
+    const int bps       = av_get_bytes_per_sample(out->format);
+    const int nb_blocks = (out->nb_samples + MIX_BLOCK_SIZE - 1) / MIX_BLOCK_SIZE;
+    const int start = (nb_blocks *  jobnr     ) / nb_jobs;
+    const int end   = (nb_blocks * (jobnr + 1)) / nb_jobs;
+    uint8_t **in = s->mix_ptrs + jobnr * planes;
+
+    for (int b = start; b < end; b++) {
+        const int offset = b * MIX_BLOCK_SIZE;
+        const int len    = FFMIN(MIX_BLOCK_SIZE, out->nb_samples - offset);
+        const int size   = len * stride;
+        const int aligned_size = FFALIGN(size, 16);
+
+        for (int p = 0; p < planes; p++)
+            memset(in[p] + size * bps, 0, (aligned_size - size) * bps);
+
+        for (int i = 0; i < td->nb_active; i++) {
+            av_audio_fifo_peek_at(s->fifos[s->mix_inputs[i]], (void **)in, len, offset);
+
+            for (int p = 0; p < planes; p++) {
+                if (out->format == AV_SAMPLE_FMT_FLT ||
+                    out->format == AV_SAMPLE_FMT_FLTP) {
+                    s->fdsp->vector_fmac_scalar((float *)out->extended_data[p] + offset * stride,
+                                                (const float *)in[p],
+                                                s->mix_scales[i], aligned_size);
+                } else {
+                    s->fdsp->vector_dmac_scalar((double *)out->extended_data[p] + offset * stride,
+                                                (const double *)in[p],
+                                                s->mix_scales[i], aligned_size);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Read samples from the input FIFOs, mix, and write to the output link.
  */
@@ -298,8 +373,9 @@ static int output_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFrame *out_buf, *in_buf;
-    int nb_samples, ns, i;
+    AVFrame *out_buf;
+    ThreadData td;
+    int nb_samples, ns, i, nb_active = 0;
 
     if (s->input_state[0] & INPUT_ON) {
         /* first input live: use the corresponding frame size */
@@ -344,40 +420,23 @@ static int output_frame(AVFilterLink *outlink)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
-    if (!in_buf) {
-        av_frame_free(&out_buf);
-        return AVERROR(ENOMEM);
-    }
-
+    /* mix all the inputs block by block, so the output is only walked once
+     * instead of once per input */
     for (i = 0; i < s->nb_inputs; i++) {
         if (s->input_state[i] & INPUT_ON) {
-            int planes, plane_size, p;
-
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
-                               nb_samples);
-
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
-
-            if (out_buf->format == AV_SAMPLE_FMT_FLT ||
-                out_buf->format == AV_SAMPLE_FMT_FLTP) {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                                (float *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
-            } else {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_dmac_scalar((double *)out_buf->extended_data[p],
-                                                (double *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
-            }
+            s->mix_inputs[nb_active] = i;
+            s->mix_scales[nb_active++] = s->input_scale[i];
         }
     }
-    av_frame_free(&in_buf);
+
+    td.out       = out_buf;
+    td.nb_active = nb_active;
+    ff_filter_execute(ctx, mix_samples, &td, NULL,
+                      FFMIN((nb_samples + MIX_BLOCK_SIZE - 1) / MIX_BLOCK_SIZE,
+                            s->nb_threads));
+
+    for (i = 0; i < nb_active; i++)
+        av_audio_fifo_drain(s->fifos[s->mix_inputs[i]], nb_samples);
 
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
@@ -433,10 +492,11 @@ static int activate(AVFilterContext *ctx)
     AVFilterLink *outlink = ctx->outputs[0];
     MixContext *s = ctx->priv;
     AVFrame *buf = NULL;
-    int i, ret;
+    int i, ret, consumed = 0;
 
     FF_FILTER_FORWARD_STATUS_BACK_ALL(outlink, ctx);
 
+    /* queue one frame from every input, then mix once */
     for (i = 0; i < s->nb_inputs; i++) {
         AVFilterLink *inlink = ctx->inputs[i];
 
@@ -459,13 +519,19 @@ static int activate(AVFilterContext *ctx)
             }
 
             av_frame_free(&buf);
+            consumed = 1;
 
-            ret = output_frame(outlink);
-            if (ret < 0)
-                return ret;
+            if (ff_inlink_queued_frames(inlink))
+                ff_filter_set_ready(ctx, 10);
         }
     }
 
+    if (consumed) {
+        ret = output_frame(outlink);
+        if (ret < 0)
+            return ret;
+    }
+
     for (i = 0; i < s->nb_inputs; i++) {
         int64_t pts;
         int status;
@@ -586,6 +652,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->input_scale);
     av_freep(&s->scale_norm);
     av_freep(&s->weights);
+    av_freep(&s->mix_buf);
+    av_freep(&s->mix_ptrs);
+    av_freep(&s->mix_inputs);
+    av_freep(&s->mix_scales);
     av_freep(&s->fdsp);
 }
 
@@ -628,5 +698,6 @@ const AVFilter ff_af_amix = {
     FILTER_SAMPLEFMTS(AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP,
                       AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_DBLP),
     .process_command = process_command,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS |
+                      AVFILTER_FLAG_SLICE_THREADS,
 };
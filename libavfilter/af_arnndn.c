@@ -143,6 +143,7 @@ typedef struct AudioRNNContext {
 
     DECLARE_ALIGNED(32, float, window)[WINDOW_SIZE];
     DECLARE_ALIGNED(32, float, dct_table)[FFALIGN(NB_BANDS, 4)][FFALIGN(NB_BANDS, 4)];
+    float band_frac[FREQ_SIZE]; ///< position of each bin inside its band
 
     RNNModel *model[2];
 
@@ -255,6 +256,24 @@ static int rnnoise_model_from_file(FILE *f, RNNModel **rnn)
     } \
     } while (0)
 
+#define INPUT_ARRAY2(name, len0, len1) do { \
+    float *values = av_calloc((len0) * FFALIGN((len1), 16), sizeof(float)); \
+    if (!values) { \
+        rnnoise_model_free(ret); \
+        return AVERROR(ENOMEM); \
+    } \
+    name = values; \
+    for (int j = 0; j < (len0); j++) { \
+        for (int i = 0; i < (len1); i++) { \
+            if (fscanf(f, "%d", &in) != 1) { \
+                rnnoise_model_free(ret); \
+                return AVERROR(EINVAL); \
+            } \
+            values[j * FFALIGN((len1), 16) + i] = in; \
+        } \
+    } \
+    } while (0)
+
 #define INPUT_ARRAY3(name, len0, len1, len2) do { \
     float *values = av_calloc(FFALIGN((len0), 4) * FFALIGN((len1), 4) * (len2), sizeof(float)); \
     if (!values) { \
@@ -289,7 +308,7 @@ static int rnnoise_model_from_file(FILE *f, RNNModel **rnn)
     ret->name ## _size = name->nb_neurons; \
     INPUT_ACTIVATION(name->activation); \
     NEW_LINE(); \
-    INPUT_ARRAY(name->input_weights, name->nb_inputs * name->nb_neurons); \
+    INPUT_ARRAY2(name->input_weights, name->nb_inputs, name->nb_neurons); \
     NEW_LINE(); \
     INPUT_ARRAY(name->bias, name->nb_neurons); \
     NEW_LINE(); \
@@ -416,7 +435,7 @@ static void forward_transform(DenoiseState *st, AVComplexFloat *out, const float
         x[i].im = 0;
     }
 
-    st->tx_fn(st->tx, y, x, sizeof(float));
+    st->tx_fn(st->tx, y, x, sizeof(*x));
 
     RNN_COPY(out, y, FREQ_SIZE);
 }
@@ -433,7 +452,7 @@ static void inverse_transform(DenoiseState *st, float *out, const AVComplexFloat
         x[i].im = -x[WINDOW_SIZE - i].im;
     }
 
-    st->txi_fn(st->txi, y, x, sizeof(float));
+    st->txi_fn(st->txi, y, x, sizeof(*x));
 
     for (int i = 0; i < WINDOW_SIZE; i++)
         out[i] = y[i].re / WINDOW_SIZE;
@@ -444,19 +463,21 @@ static const uint8_t eband5ms[] = {
   0,  1,  2,  3,  4,   5, 6,  7,  8,  10, 12, 14, 16, 20, 24, 28, 34, 40, 48, 60, 78, 100
 };
 
-static void compute_band_energy(float *bandE, const AVComplexFloat *X)
+static void compute_band_energy(AudioRNNContext *s, float *bandE, const AVComplexFloat *X)
 {
     float sum[NB_BANDS] = {0};
 
     for (int i = 0; i < NB_BANDS - 1; i++) {
-        int band_size;
+        const int start = eband5ms[i] << FRAME_SIZE_SHIFT;
+        const int end = eband5ms[i + 1] << FRAME_SIZE_SHIFT;
 
-        band_size = (eband5ms[i + 1] - eband5ms[i]) << FRAME_SIZE_SHIFT;
-        for (int j = 0; j < band_size; j++) {
-            float tmp, frac = (float)j / band_size;
+        for (int j = start; j < end; j++) {
+            const float frac = s->band_frac[j];
+            float tmp;
+
+            tmp  = SQUARE(X[j].re);
+            tmp += SQUARE(X[j].im);
 
-            tmp         = SQUARE(X[(eband5ms[i] << FRAME_SIZE_SHIFT) + j].re);
-            tmp        += SQUARE(X[(eband5ms[i] << FRAME_SIZE_SHIFT) + j].im);
             sum[i]     += (1.f - frac) * tmp;
             sum[i + 1] +=        frac  * tmp;
         }
@@ -469,19 +490,20 @@ static void compute_band_energy(float *bandE, const AVComplexFloat *X)
         bandE[i] = sum[i];
 }
 
-static void compute_band_corr(float *bandE, const AVComplexFloat *X, const AVComplexFloat *P)
+static void compute_band_corr(AudioRNNContext *s, float *bandE, const AVComplexFloat *X, const AVComplexFloat *P)
 {
     float sum[NB_BANDS] = { 0 };
 
     for (int i = 0; i < NB_BANDS - 1; i++) {
-        int band_size;
+        const int start = eband5ms[i] << FRAME_SIZE_SHIFT;
+        const int end = eband5ms[i + 1] << FRAME_SIZE_SHIFT;
 
-        band_size = (eband5ms[i + 1] - eband5ms[i]) << FRAME_SIZE_SHIFT;
-        for (int j = 0; j < band_size; j++) {
-            float tmp, frac = (float)j / band_size;
+        for (int j = start; j < end; j++) {
+            const float frac = s->band_frac[j];
+            float tmp;
 
-            tmp  = X[(eband5ms[i]<<FRAME_SIZE_SHIFT) + j].re * P[(eband5ms[i]<<FRAME_SIZE_SHIFT) + j].re;
-            tmp += X[(eband5ms[i]<<FRAME_SIZE_SHIFT) + j].im * P[(eband5ms[i]<<FRAME_SIZE_SHIFT) + j].im;
+            tmp  = X[j].re * P[j].re;
+            tmp += X[j].im * P[j].im;
             sum[i]     += (1 - frac) * tmp;
             sum[i + 1] +=      frac  * tmp;
         }
@@ -503,7 +525,7 @@ static void frame_analysis(AudioRNNContext *s, DenoiseState *st, AVComplexFloat
     RNN_COPY(st->analysis_mem, in, FRAME_SIZE);
     s->fdsp->vector_fmul(x, x, s->window, WINDOW_SIZE);
     forward_transform(st, X, x);
-    compute_band_energy(Ex, X);
+    compute_band_energy(s, Ex, X);
 }
 
 static void frame_synthesis(AudioRNNContext *s, DenoiseState *st, float *out, const AVComplexFloat *y)
@@ -1009,10 +1031,16 @@ static void pitch_search(const float *x_lp, float *y,
 
 static void dct(AudioRNNContext *s, float *out, const float *in)
 {
+    LOCAL_ALIGNED_32(float, x, [FFALIGN(NB_BANDS, 4)]);
+
+    /* the padding is read by scalarproduct_float() and must be finite */
+    memcpy(x, in, NB_BANDS * sizeof(*x));
+    memset(x + NB_BANDS, 0, (FFALIGN(NB_BANDS, 4) - NB_BANDS) * sizeof(*x));
+
     for (int i = 0; i < NB_BANDS; i++) {
         float sum;
 
-        sum = s->fdsp->scalarproduct_float(in, s->dct_table[i], FFALIGN(NB_BANDS, 4));
+        sum = s->fdsp->scalarproduct_float(x, s->dct_table[i], FFALIGN(NB_BANDS, 4));
         out[i] = sum * sqrtf(2.f / 22);
     }
 }
@@ -1051,8 +1079,8 @@ static int compute_frame_features(AudioRNNContext *s, DenoiseState *st, AVComple
 
     s->fdsp->vector_fmul(p, p, s->window, WINDOW_SIZE);
     forward_transform(st, P, p);
-    compute_band_energy(Ep, P);
-    compute_band_corr(Exp, X, P);
+    compute_band_energy(s, Ep, P);
+    compute_band_corr(s, Exp, X, P);
 
     for (int i = 0; i < NB_BANDS; i++)
         Exp[i] = Exp[i] / sqrtf(.001f+Ex[i]*Ep[i]);
@@ -1140,8 +1168,8 @@ static void interp_band_gain(float *g, const float *bandE)
     }
 }
 
-static void pitch_filter(AVComplexFloat *X, const AVComplexFloat *P, const float *Ex, const float *Ep,
-                         const float *Exp, const float *g)
+static void pitch_filter(AudioRNNContext *s, AVComplexFloat *X, const AVComplexFloat *P,
+                         const float *Ex, const float *Ep, const float *Exp, const float *g)
 {
     float newE[NB_BANDS];
     float r[NB_BANDS];
@@ -1160,7 +1188,7 @@ static void pitch_filter(AVComplexFloat *X, const AVComplexFloat *P, const float
         X[i].re += rf[i]*P[i].re;
         X[i].im += rf[i]*P[i].im;
     }
-    compute_band_energy(newE, X);
+    compute_band_energy(s, newE, X);
     for (int i = 0; i < NB_BANDS; i++) {
         norm[i] = sqrtf(Ex[i] / (1e-8+newE[i]));
     }
@@ -1248,29 +1276,26 @@ static inline float sigmoid_approx(float x)
     return .5f + .5f*tansig_approx(.5f*x);
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+static void compute_dense(AudioRNNContext *s, const DenseLayer *layer, float *output, const float *input)
 {
-    const int N = layer->nb_neurons, M = layer->nb_inputs, stride = N;
-
-    for (int i = 0; i < N; i++) {
-        /* Compute update gate. */
-        float sum = layer->bias[i];
+    LOCAL_ALIGNED_32(float, sum, [MAX_NEURONS]);
+    const int N = layer->nb_neurons, M = layer->nb_inputs, stride = FFALIGN(N, 16);
 
-        for (int j = 0; j < M; j++)
-            sum += layer->input_weights[j * stride + i] * input[j];
-
-        output[i] = WEIGHTS_SCALE * sum;
-    }
+    /* Accumulate one weight row per input, the rows are padded to 16. */
+    memcpy(sum, layer->bias, N * sizeof(*sum));
+    memset(sum + N, 0, (stride - N) * sizeof(*sum));
+    for (int j = 0; j < M; j++)
+        s->fdsp->vector_fmac_scalar(sum, layer->input_weights + j * stride, input[j], stride);
 
     if (layer->activation == ACTIVATION_SIGMOID) {
         for (int i = 0; i < N; i++)
-            output[i] = sigmoid_approx(output[i]);
+            output[i] = sigmoid_approx(WEIGHTS_SCALE * sum[i]);
     } else if (layer->activation == ACTIVATION_TANH) {
         for (int i = 0; i < N; i++)
-            output[i] = tansig_approx(output[i]);
+            output[i] = tansig_approx(WEIGHTS_SCALE * sum[i]);
     } else if (layer->activation == ACTIVATION_RELU) {
         for (int i = 0; i < N; i++)
-            output[i] = FFMAX(0, output[i]);
+            output[i] = FFMAX(0, WEIGHTS_SCALE * sum[i]);
     } else {
         av_assert0(0);
     }
@@ -1281,12 +1306,19 @@ static void compute_gru(AudioRNNContext *s, const GRULayer *gru, float *state, c
     LOCAL_ALIGNED_32(float, z, [MAX_NEURONS]);
     LOCAL_ALIGNED_32(float, r, [MAX_NEURONS]);
     LOCAL_ALIGNED_32(float, h, [MAX_NEURONS]);
+    LOCAL_ALIGNED_32(float, rs, [MAX_NEURONS]);
+    LOCAL_ALIGNED_32(float, x, [MAX_NEURONS]);
     const int M = gru->nb_inputs;
     const int N = gru->nb_neurons;
     const int AN = FFALIGN(N, 4);
     const int AM = FFALIGN(M, 4);
     const int stride = 3 * AN, istride = 3 * AM;
 
+    /* the padding is read by scalarproduct_float() and must be finite */
+    memcpy(x, input, M * sizeof(*x));
+    memset(x + M, 0, (AM - M) * sizeof(*x));
+    input = x;
+
     for (int i = 0; i < N; i++) {
         /* Compute update gate. */
         float sum = gru->bias[i];
@@ -1305,13 +1337,16 @@ static void compute_gru(AudioRNNContext *s, const GRULayer *gru, float *state, c
         r[i] = sigmoid_approx(WEIGHTS_SCALE * sum);
     }
 
+    for (int j = 0; j < N; j++)
+        rs[j] = state[j] * r[j];
+    memset(rs + N, 0, (AN - N) * sizeof(*rs));
+
     for (int i = 0; i < N; i++) {
         /* Compute output. */
         float sum = gru->bias[2 * N + i];
 
         sum += s->fdsp->scalarproduct_float(gru->input_weights + 2 * AM + i * istride, input, AM);
-        for (int j = 0; j < N; j++)
-            sum += gru->recurrent_weights[2 * AN + i * stride + j] * state[j] * r[j];
+        sum += s->fdsp->scalarproduct_float(gru->recurrent_weights + 2 * AN + i * stride, rs, AN);
 
         if (gru->activation == ACTIVATION_SIGMOID)
             sum = sigmoid_approx(WEIGHTS_SCALE * sum);
@@ -1335,9 +1370,9 @@ static void compute_rnn(AudioRNNContext *s, RNNState *rnn, float *gains, float *
     LOCAL_ALIGNED_32(float, noise_input,   [MAX_NEURONS * 3]);
     LOCAL_ALIGNED_32(float, denoise_input, [MAX_NEURONS * 3]);
 
-    compute_dense(rnn->model->input_dense, dense_out, input);
+    compute_dense(s, rnn->model->input_dense, dense_out, input);
     compute_gru(s, rnn->model->vad_gru, rnn->vad_gru_state, dense_out);
-    compute_dense(rnn->model->vad_output, vad, rnn->vad_gru_state);
+    compute_dense(s, rnn->model->vad_output, vad, rnn->vad_gru_state);
 
     memcpy(noise_input, dense_out, rnn->model->input_dense_size * sizeof(float));
     memcpy(noise_input + rnn->model->input_dense_size,
@@ -1354,7 +1389,7 @@ static void compute_rnn(AudioRNNContext *s, RNNState *rnn, float *gains, float *
            input, INPUT_SIZE * sizeof(float));
 
     compute_gru(s, rnn->model->denoise_gru, rnn->denoise_gru_state, denoise_input);
-    compute_dense(rnn->model->denoise_output, gains, rnn->denoise_gru_state);
+    compute_dense(s, rnn->model->denoise_output, gains, rnn->denoise_gru_state);
 }
 
 static float rnnoise_channel(AudioRNNContext *s, DenoiseState *st, float *out, const float *in,
@@ -1379,7 +1414,7 @@ static float rnnoise_channel(AudioRNNContext *s, DenoiseState *st, float *out, c
 
     if (!silence && !disabled) {
         compute_rnn(s, &st->rnn[0], g, &vad_prob, features);
-        pitch_filter(X, P, Ex, Ep, Exp, g);
+        pitch_filter(s, X, P, Ex, Ep, Exp, g);
         for (int i = 0; i < NB_BANDS; i++) {
             float alpha = .6f;
 
@@ -1516,6 +1551,14 @@ static av_cold int init(AVFilterContext *ctx)
         }
     }
 
+    for (int i = 0; i < NB_BANDS - 1; i++) {
+        const int start = eband5ms[i] << FRAME_SIZE_SHIFT;
+        const int band_size = (eband5ms[i + 1] - eband5ms[i]) << FRAME_SIZE_SHIFT;
+
+        for (int j = 0; j < band_size; j++)
+            s->band_frac[start + j] = (float)j / band_size;
+    }
+
     return 0;
 }
 
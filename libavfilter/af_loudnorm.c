@@ -32,6 +32,7 @@ enum FrameType {
     INNER_FRAME,
     FINAL_FRAME,
     LINEAR_MODE,
+    LIVE_MODE,
     FRAME_NB
 };
 
@@ -63,6 +64,8 @@ typedef struct LoudNormContext {
     int linear;
     int dual_mono;
     enum PrintFormat print_format;
+    int live;
+    double lookahead;
 
     double *buf;
     int buf_size;
@@ -92,6 +95,28 @@ typedef struct LoudNormContext {
     int prev_nb_samples;
     int channels;
 
+    /* live mode */
+    double gain;
+    double gain_target;
+    double gain_coef;
+    int block_size;
+    int block_cnt;
+    int nb_blocks;
+    double *delay_buf;
+    int delay_size;
+    int delay_index;
+    double *hold_val;
+    int64_t *hold_pos;
+    int hold_head;
+    int hold_cnt;
+    double hold_env;
+    double release_coef;
+    double *avg_buf;
+    double avg_sum;
+    int64_t smp_cnt;
+    int skip;
+    int64_t next_pts;
+
     FFEBUR128State *r128_in;
     FFEBUR128State *r128_out;
 } LoudNormContext;
@@ -120,6 +145,8 @@ static const AVOption loudnorm_options[] = {
     {     "none",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  NONE},     0,         0,  FLAGS, "print_format" },
     {     "json",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  JSON},     0,         0,  FLAGS, "print_format" },
     {     "summary",      0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  SUMMARY},  0,         0,  FLAGS, "print_format" },
+    { "live",             "normalize without look-ahead",      OFFSET(live),             AV_OPT_TYPE_BOOL,    {.i64 =  0},        0,         1,  FLAGS },
+    { "lookahead",        "set live limiter look-ahead in ms", OFFSET(lookahead),        AV_OPT_TYPE_DOUBLE,  {.dbl =  10.},    1.,       100.,  FLAGS },
     { NULL }
 };
 
@@ -407,6 +434,173 @@ static void true_peak_limiter(LoudNormContext *s, double *out, int nb_samples, i
     }
 }
 
+static void live_update_gain(LoudNormContext *s)
+{
+    double global, shortterm, relative_threshold;
+
+    ff_ebur128_loudness_global(s->r128_in, &global);
+    ff_ebur128_loudness_shortterm(s->r128_in, &shortterm);
+    ff_ebur128_relative_threshold(s->r128_in, &relative_threshold);
+
+    /* the short-term window is not filled yet, only account for the
+     * blocks seen so far */
+    if (s->nb_blocks < 30) {
+        s->nb_blocks++;
+        shortterm += 10. * log10(30. / s->nb_blocks);
+    }
+
+    /* hold the gain through silence and quiet passages */
+    if (shortterm >= relative_threshold && shortterm > -70.) {
+        double env_global, env_shortterm;
+
+        env_global = fabs(shortterm - global) < (s->target_lra / 2.) ? shortterm - global : (s->target_lra / 2.) * ((shortterm - global) < 0 ? -1 : 1);
+        env_shortterm = s->target_i - shortterm;
+        s->gain_target = pow(10., (env_global + env_shortterm) / 20.);
+        if (!s->above_threshold)
+            s->gain = s->gain_target;
+        s->above_threshold = 1;
+    }
+}
+
+/**
+ * Look-ahead limiter at the native sample rate. The gain needed by each
+ * sample is held for delay_size samples and then averaged over as many, so
+ * the gain applied when a peak leaves the delay line never exceeds the gain
+ * it requires.
+ */
+static void live_limiter(LoudNormContext *s, double *dst, const double *src,
+                         int nb_samples, int channels)
+{
+    const double ceiling = s->target_tp;
+    const int size = s->delay_size;
+    int n, c;
+
+    for (n = 0; n < nb_samples; n++) {
+        double *delay = s->delay_buf + s->delay_index * channels;
+        double peak = 0., gain, env;
+        int back;
+
+        s->gain += (s->gain_target - s->gain) * s->gain_coef;
+        for (c = 0; c < channels; c++) {
+            delay[c] = src[c] * s->gain * s->offset;
+            peak = FFMAX(peak, fabs(delay[c]));
+        }
+        gain = peak > ceiling ? ceiling / peak : 1.;
+
+        /* running minimum of the last size required gains */
+        if (s->hold_cnt > 0 && s->hold_pos[s->hold_head] <= s->smp_cnt - size) {
+            s->hold_head = s->hold_head + 1 < size ? s->hold_head + 1 : 0;
+            s->hold_cnt--;
+        }
+        while (s->hold_cnt > 0) {
+            back = s->hold_head + s->hold_cnt - 1;
+            back -= back >= size ? size : 0;
+            if (s->hold_val[back] < gain)
+                break;
+            s->hold_cnt--;
+        }
+        back = s->hold_head + s->hold_cnt;
+        back -= back >= size ? size : 0;
+        s->hold_val[back] = gain;
+        s->hold_pos[back] = s->smp_cnt;
+        s->hold_cnt++;
+
+        env = s->hold_val[s->hold_head];
+        if (env > s->hold_env)
+            env = s->hold_env + (env - s->hold_env) * s->release_coef;
+        s->hold_env = env;
+
+        s->avg_sum += env - s->avg_buf[s->delay_index];
+        s->avg_buf[s->delay_index] = env;
+
+        s->delay_index = s->delay_index + 1 < size ? s->delay_index + 1 : 0;
+        if (!s->delay_index) {
+            /* keep the running sum from drifting */
+            s->avg_sum = 0.;
+            for (int i = 0; i < size; i++)
+                s->avg_sum += s->avg_buf[i];
+        }
+        s->smp_cnt++;
+
+        if (s->skip > 0) {
+            s->skip--;
+        } else {
+            delay = s->delay_buf + s->delay_index * channels;
+            env = s->avg_sum / size;
+            for (c = 0; c < channels; c++) {
+                dst[c] = delay[c] * env;
+                if (fabs(dst[c]) > ceiling)
+                    dst[c] = ceiling * (dst[c] < 0 ? -1 : 1);
+            }
+            dst += channels;
+        }
+        src += channels;
+    }
+}
+
+static int live_filter_frame(AVFilterLink *inlink, AVFrame *in, int flush)
+{
+    AVFilterContext *ctx = inlink->dst;
+    LoudNormContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    const int channels = inlink->ch_layout.nb_channels;
+    const double *src = (const double *)in->data[0];
+    AVFrame *out;
+    double *dst;
+    int n, nb_out;
+
+    nb_out = in->nb_samples - FFMIN(s->skip, in->nb_samples);
+    if (av_frame_is_writable(in)) {
+        out = in;
+    } else {
+        out = ff_get_audio_buffer(outlink, in->nb_samples);
+        if (!out) {
+            av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+        av_frame_copy_props(out, in);
+    }
+    dst = (double *)out->data[0];
+
+    if (s->next_pts == AV_NOPTS_VALUE)
+        s->next_pts = in->pts;
+
+    for (n = 0; n < in->nb_samples;) {
+        const int len = FFMIN(in->nb_samples - n, s->block_size - s->block_cnt);
+        const int skip = FFMIN(s->skip, len);
+
+        if (!flush)
+            ff_ebur128_add_frames_double(s->r128_in, src, len);
+        live_limiter(s, dst, src, len, channels);
+        if (len > skip)
+            ff_ebur128_add_frames_double(s->r128_out, dst, len - skip);
+
+        s->block_cnt += len;
+        if (s->block_cnt == s->block_size) {
+            s->block_cnt = 0;
+            if (!flush)
+                live_update_gain(s);
+        }
+        src += len * channels;
+        dst += (len - skip) * channels;
+        n   += len;
+    }
+
+    if (in != out)
+        av_frame_free(&in);
+    if (!nb_out) {
+        av_frame_free(&out);
+        return 0;
+    }
+
+    out->nb_samples = nb_out;
+    out->pts = s->next_pts;
+    if (s->next_pts != AV_NOPTS_VALUE)
+        s->next_pts += av_rescale_q(nb_out, (AVRational){ 1, outlink->sample_rate },
+                                    outlink->time_base);
+    return ff_filter_frame(outlink, out);
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -637,7 +831,20 @@ static int flush_frame(AVFilterLink *outlink)
     LoudNormContext *s = ctx->priv;
     int ret = 0;
 
-    if (s->frame_type == INNER_FRAME) {
+    if (s->frame_type == LIVE_MODE) {
+        /* push the samples left in the limiter delay line */
+        AVFrame *frame;
+
+        if (s->delay_size <= 1)
+            return 0;
+        frame = ff_get_audio_buffer(outlink, s->delay_size - 1);
+        if (!frame)
+            return AVERROR(ENOMEM);
+        av_samples_set_silence(frame->extended_data, 0, frame->nb_samples,
+                               frame->ch_layout.nb_channels, frame->format);
+        frame->pts = AV_NOPTS_VALUE;
+        ret = live_filter_frame(inlink, frame, 1);
+    } else if (s->frame_type == INNER_FRAME) {
         double *src;
         double *buf;
         int nb_samples, n, c, offset;
@@ -685,7 +892,7 @@ static int activate(AVFilterContext *ctx)
 
     FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
 
-    if (s->frame_type != LINEAR_MODE) {
+    if (s->frame_type != LINEAR_MODE && s->frame_type != LIVE_MODE) {
         int nb_samples;
 
         if (s->frame_type == FIRST_FRAME) {
@@ -709,10 +916,13 @@ static int activate(AVFilterContext *ctx)
                 s->pts[i] = in->pts + i * nb_samples;
         } else if (s->frame_type == LINEAR_MODE) {
             s->pts[0] = in->pts;
-        } else {
+        } else if (s->frame_type != LIVE_MODE) {
             s->pts[FF_ARRAY_ELEMS(s->pts) - 1] = in->pts;
         }
-        ret = filter_frame(inlink, in);
+        if (s->frame_type == LIVE_MODE)
+            ret = live_filter_frame(inlink, in, 0);
+        else
+            ret = filter_frame(inlink, in);
     }
     if (ret < 0)
         return ret;
@@ -743,7 +953,7 @@ static int query_formats(AVFilterContext *ctx)
     if (ret)
         return ret;
 
-    if (s->frame_type != LINEAR_MODE) {
+    if (s->frame_type == FIRST_FRAME) {
         formats = ff_make_format_list(input_srate);
     } else {
         formats = ff_all_samplerates();
@@ -770,19 +980,40 @@ static int config_input(AVFilterLink *inlink)
         ff_ebur128_set_channel(s->r128_out, 0, FF_EBUR128_DUAL_MONO);
     }
 
-    s->buf_size = frame_size(inlink->sample_rate, 3000) * inlink->ch_layout.nb_channels;
-    s->buf = av_malloc_array(s->buf_size, sizeof(*s->buf));
-    if (!s->buf)
-        return AVERROR(ENOMEM);
+    if (s->frame_type != LIVE_MODE) {
+        s->buf_size = frame_size(inlink->sample_rate, 3000) * inlink->ch_layout.nb_channels;
+        s->buf = av_malloc_array(s->buf_size, sizeof(*s->buf));
+        if (!s->buf)
+            return AVERROR(ENOMEM);
 
-    s->limiter_buf_size = frame_size(inlink->sample_rate, 210) * inlink->ch_layout.nb_channels;
-    s->limiter_buf = av_malloc_array(s->buf_size, sizeof(*s->limiter_buf));
-    if (!s->limiter_buf)
-        return AVERROR(ENOMEM);
+        s->limiter_buf_size = frame_size(inlink->sample_rate, 210) * inlink->ch_layout.nb_channels;
+        s->limiter_buf = av_malloc_array(s->buf_size, sizeof(*s->limiter_buf));
+        if (!s->limiter_buf)
+            return AVERROR(ENOMEM);
 
-    s->prev_smp = av_malloc_array(inlink->ch_layout.nb_channels, sizeof(*s->prev_smp));
-    if (!s->prev_smp)
-        return AVERROR(ENOMEM);
+        s->prev_smp = av_malloc_array(inlink->ch_layout.nb_channels, sizeof(*s->prev_smp));
+        if (!s->prev_smp)
+            return AVERROR(ENOMEM);
+    } else {
+        s->delay_size = FFMAX(1, lrint(inlink->sample_rate * s->lookahead / 1000.));
+        s->delay_buf = av_calloc(s->delay_size, inlink->ch_layout.nb_channels * sizeof(*s->delay_buf));
+        s->hold_val = av_calloc(s->delay_size, sizeof(*s->hold_val));
+        s->hold_pos = av_calloc(s->delay_size, sizeof(*s->hold_pos));
+        s->avg_buf = av_calloc(s->delay_size, sizeof(*s->avg_buf));
+        if (!s->delay_buf || !s->hold_val || !s->hold_pos || !s->avg_buf)
+            return AVERROR(ENOMEM);
+
+        for (int i = 0; i < s->delay_size; i++)
+            s->avg_buf[i] = 1.;
+        s->avg_sum = s->delay_size;
+        s->hold_env = 1.;
+        s->skip = s->delay_size - 1;
+        s->next_pts = AV_NOPTS_VALUE;
+        s->block_size = frame_size(inlink->sample_rate, 100);
+        s->release_coef = 1. - exp(-1. / frame_size(inlink->sample_rate, 100));
+        s->gain_coef = 1. - exp(-1. / inlink->sample_rate);
+        s->gain = s->gain_target = s->measured_i != 0. ? pow(10., (s->target_i - s->measured_i) / 20.) : 1.;
+    }
 
     init_gaussian_filter(s);
 
@@ -803,7 +1034,7 @@ static int config_input(AVFilterLink *inlink)
 static av_cold int init(AVFilterContext *ctx)
 {
     LoudNormContext *s = ctx->priv;
-    s->frame_type = FIRST_FRAME;
+    s->frame_type = s->live ? LIVE_MODE : FIRST_FRAME;
 
     if (s->linear) {
         double offset, offset_tp;
@@ -876,7 +1107,7 @@ static av_cold void uninit(AVFilterContext *ctx)
             20. * log10(tp_out),
             lra_out,
             thresh_out,
-            s->frame_type == LINEAR_MODE ? "linear" : "dynamic",
+            s->frame_type == LINEAR_MODE ? "linear" : s->frame_type == LIVE_MODE ? "live" : "dynamic",
             s->target_i - i_out
         );
         break;
@@ -904,7 +1135,7 @@ static av_cold void uninit(AVFilterContext *ctx)
             20. * log10(tp_out),
             lra_out,
             thresh_out,
-            s->frame_type == LINEAR_MODE ? "Linear" : "Dynamic",
+            s->frame_type == LINEAR_MODE ? "Linear" : s->frame_type == LIVE_MODE ? "Live" : "Dynamic",
             s->target_i - i_out
         );
         break;
@@ -918,6 +1149,10 @@ end:
     av_freep(&s->limiter_buf);
     av_freep(&s->prev_smp);
     av_freep(&s->buf);
+    av_freep(&s->delay_buf);
+    av_freep(&s->hold_val);
+    av_freep(&s->hold_pos);
+    av_freep(&s->avg_buf);
 }
 
 static const AVFilterPad avfilter_af_loudnorm_inputs[] = {
@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <time.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
@@ -28,11 +30,14 @@
 #include "libavutil/eval.h"
 #include "libavutil/frame.h"
 #include "libavutil/hwcontext.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
+#include "libavutil/trace.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -43,6 +48,7 @@
 #include "formats.h"
 #include "framepool.h"
 #include "internal.h"
+#include "thread.h"
 
 static void tlog_ref(void *ctx, AVFrame *ref, int end)
 {
@@ -555,6 +561,11 @@ int avfilter_process_command(AVFilterContext *filter, const char *cmd, const cha
     }else if(!strcmp(cmd, "enable")) {
         return set_enable_expr(filter, arg);
     }else if(filter->filter->process_command) {
+        if (filter->internal->frame_thread) {
+            int ret = ff_filter_frame_thread_output(filter, 1);
+            if (ret < 0)
+                return ret;
+        }
         return filter->filter->process_command(filter, cmd, arg, res, res_len, flags);
     }
     return AVERROR(ENOSYS);
@@ -616,8 +627,9 @@ static const AVClass *filter_child_class_iterate(void **iter)
 #define TFLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_RUNTIME_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = TFLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -754,6 +766,9 @@ void avfilter_free(AVFilterContext *filter)
     if (filter->graph)
         ff_filter_graph_remove_filter(filter->graph, filter);
 
+    /* the frames still in the frame threads are dropped */
+    ff_filter_frame_thread_free(filter);
+
     if (filter->filter->uninit)
         filter->filter->uninit(filter);
 
@@ -898,6 +913,15 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         ctx->graph->internal->thread_execute) {
         ctx->thread_type       = AVFILTER_THREAD_SLICE;
         ctx->internal->execute = ctx->graph->internal->thread_execute;
+    } else if (ctx->filter->flags & AVFILTER_FLAG_FRAME_THREADS &&
+               ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_FRAME) {
+        ret = ff_filter_frame_thread_init(ctx, ff_filter_get_nb_threads(ctx));
+        if (ret < 0 && ret != AVERROR(ENOSYS)) {
+            av_log(ctx, AV_LOG_ERROR, "Error initializing frame threads.\n");
+            return ret;
+        }
+        ctx->thread_type = ret < 0 ? 0 : AVFILTER_THREAD_FRAME;
+        ret = 0;
     } else {
         ctx->thread_type = 0;
     }
@@ -991,13 +1015,33 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
             goto fail;
     }
 
+    if (dstctx->internal->frame_thread && dstctx->command_queue) {
+        /* the commands must not change the options of running threads */
+        ret = ff_filter_frame_thread_output(dstctx, 1);
+        if (ret < 0)
+            goto fail;
+    }
+
     ff_inlink_process_commands(link, frame);
     dstctx->is_disabled = !ff_inlink_evaluate_timeline_at_frame(link, frame);
 
     if (dstctx->is_disabled &&
         (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
         filter_frame = default_filter_frame;
-    ret = filter_frame(link, frame);
+
+    if (dstctx->internal->frame_thread) {
+        if (filter_frame == default_filter_frame) {
+            /* passed through frames must stay in order with the others */
+            ret = ff_filter_frame_thread_output(dstctx, 1);
+            if (ret < 0)
+                goto fail;
+            ret = filter_frame(link, frame);
+        } else {
+            ret = ff_filter_frame_thread_submit(link, frame, filter_frame);
+        }
+    } else {
+        ret = filter_frame(link, frame);
+    }
     link->frame_count_out++;
     return ret;
 
@@ -1011,6 +1055,12 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
     int ret;
     FF_TPRINTF_START(NULL, filter_frame); ff_tlog_link(NULL, link, 1); ff_tlog(NULL, " "); tlog_ref(NULL, frame, 1);
 
+    if (link->src->internal->frame_thread) {
+        ret = ff_filter_frame_thread_capture(link, frame);
+        if (ret)
+            return FFMIN(ret, 0);
+    }
+
     /* Consistency checks */
     if (link->type == AVMEDIA_TYPE_VIDEO) {
         if (strcmp(link->dst->filter->name, "buffersink") &&
@@ -1046,6 +1096,7 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_frame_free(&frame);
         return ret;
     }
+    link->max_queued = FFMAX(link->max_queued, ff_framequeue_queued_frames(&link->fifo));
     ff_filter_set_ready(link->dst, 300);
     return 0;
 
@@ -1188,6 +1239,12 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 {
     unsigned i;
 
+    if (filter->internal->frame_thread) {
+        int ret = ff_filter_frame_thread_output(filter, 0);
+        if (ret < 0)
+            return ret;
+    }
+
     for (i = 0; i < filter->nb_inputs; i++) {
         if (samples_ready(filter->inputs[i], filter->inputs[i]->min_samples)) {
             return ff_filter_frame_to_filter(filter->inputs[i]);
@@ -1196,6 +1253,11 @@ static int ff_filter_activate_default(AVFilterContext *filter)
     for (i = 0; i < filter->nb_inputs; i++) {
         if (filter->inputs[i]->status_in && !filter->inputs[i]->status_out) {
             av_assert1(!ff_framequeue_queued_frames(&filter->inputs[i]->fifo));
+            if (filter->internal->frame_thread) {
+                int ret = ff_filter_frame_thread_output(filter, 1);
+                if (ret < 0)
+                    return ret;
+            }
             return forward_status_change(filter, filter->inputs[i]);
         }
     }
@@ -1340,16 +1402,46 @@ static int ff_filter_activate_default(AVFilterContext *filter)
      [buffersrc1][testsrc1][buffersrc2][testsrc2]concat=v=2).
  */
 
+static int64_t thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
+const AVFilterProfile *avfilter_get_profile(const AVFilterContext *ctx)
+{
+    return &ctx->internal->profile;
+}
+
 int ff_filter_activate(AVFilterContext *filter)
 {
+    AVFilterProfile *profile = &filter->internal->profile;
+    int64_t wall_start = 0, cpu_start = 0;
+    AVTraceSpan span;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     filter->ready = 0;
+    if (filter->graph->profile) {
+        wall_start = av_gettime_relative();
+        cpu_start  = thread_cpu_time();
+    }
+    av_trace_begin(&span, "filter", filter->name);
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
+    av_trace_end(&span);
+    if (filter->graph->profile) {
+        profile->nb_activations++;
+        profile->wall_time += av_gettime_relative() - wall_start;
+        profile->cpu_time  += thread_cpu_time() - cpu_start;
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
@@ -1445,6 +1537,22 @@ AVFrame *ff_inlink_peek_frame(AVFilterLink *link, size_t idx)
     return ff_framequeue_peek(&link->fifo, idx);
 }
 
+void ff_filter_account_frame_copy(AVFilterContext *ctx, const AVFrame *frame)
+{
+    AVFilterProfile *profile = &ctx->internal->profile;
+    int size;
+
+    if (frame->nb_samples)
+        size = av_samples_get_buffer_size(NULL, frame->ch_layout.nb_channels,
+                                          frame->nb_samples, frame->format, 1);
+    else
+        size = av_image_get_buffer_size(frame->format, frame->width,
+                                        frame->height, 1);
+
+    profile->nb_frame_copies++;
+    profile->frame_copy_bytes += FFMAX(size, 0);
+}
+
 int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
 {
     AVFrame *frame = *rframe;
@@ -1479,6 +1587,7 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
         av_frame_free(&out);
         return ret;
     }
+    ff_filter_account_frame_copy(link->dst, frame);
 
     av_frame_free(&frame);
     *rframe = out;
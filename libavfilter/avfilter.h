@@ -141,6 +141,15 @@ enum AVMediaType avfilter_pad_get_type(const AVFilterPad *pads, int pad_idx);
  *   received by the filter on one of its inputs.
  */
 #define AVFILTER_FLAG_METADATA_ONLY         (1 << 3)
+/**
+ * The filter supports filtering several frames concurrently. It must have a
+ * single input, use the filter_frame() callback of its input pad and no
+ * activate() callback, and filter_frame() must be reentrant: it may not
+ * update the private context of the filter, nor depend on the previous
+ * frames or on the frame counters of the links. The output frames are still
+ * sent in the order of the input frames.
+ */
+#define AVFILTER_FLAG_FRAME_THREADS         (1 << 4)
 /**
  * Some filters support a generic "enable" expression option that can be used
  * to enable or disable a filter in the timeline. Filters supporting this
@@ -408,6 +417,15 @@ unsigned avfilter_filter_pad_count(const AVFilter *filter, int is_output);
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Process several frames concurrently.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
+/**
+ * Activate the filters which do not share a link concurrently. Only
+ * meaningful for AVFilterGraph.thread_type.
+ */
+#define AVFILTER_THREAD_PIPELINE (1 << 2)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -724,6 +742,11 @@ struct AVFilterLink {
      */
     int status_out;
 
+    /**
+     * Largest number of frames queued in fifo so far.
+     */
+    size_t max_queued;
+
 #endif /* FF_INTERNAL_FIELDS */
 
 };
@@ -887,7 +910,9 @@ typedef struct AVFilterGraph {
      * of AVFILTER_THREAD_* flags.
      *
      * May be set by the caller at any point, the setting will apply to all
-     * filters initialized after that. The default is allowing everything.
+     * filters initialized after that. The default is allowing everything but
+     * AVFILTER_THREAD_PIPELINE, which applies to the whole graph and is
+     * checked each time it runs.
      *
      * When a filter in this graph is initialized, this field is combined using
      * bit AND with AVFilterContext.thread_type to get the final mask used for
@@ -931,6 +956,42 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Shared thread pool, see libavutil/threadpool.h. May be set by the caller
+     * immediately after allocating the graph and before adding any filters to
+     * it. If set, the internal slice threading implementation and the scaling
+     * contexts created by the filters run on the threads of this pool instead
+     * of creating their own.
+     *
+     * The pool must outlive the graph.
+     */
+    struct AVThreadPool *thread_pool;
+
+    /**
+     * Shared buffer cache, see av_buffer_pool_init_cache(). May be set by the
+     * caller before configuring the graph. If set, the video frames allocated
+     * by the filters are taken from this cache, so that their buffers can be
+     * reused by other graphs and decoders using the same cache.
+     */
+    struct AVBufferCache *buffer_cache;
+
+    /**
+     * If set, the time spent activating each filter is measured, see
+     * avfilter_get_profile(). May be set by the caller at any point.
+     */
+    int profile;
+
+    /**
+     * If set to a positive value, the audio frames pushed to the buffer
+     * sources of the graph are merged into frames of this number of samples
+     * (except for the last one) before being passed to the filters, unless
+     * the filter connected to the source requires a different frame size.
+     * This reduces the per-frame overhead of long audio filter chains fed with
+     * small decoded frames, at the cost of latency. Must be set before
+     * configuring the graph.
+     */
+    int audio_frame_size;
+
     /**
      * Private fields
      *
@@ -1176,6 +1237,47 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
  */
 char *avfilter_graph_dump(AVFilterGraph *graph, const char *options);
 
+/**
+ * Statistics of a filter, collected while AVFilterGraph.profile is set.
+ */
+typedef struct AVFilterProfile {
+    int64_t nb_activations;
+    /**
+     * Time spent activating the filter, in microseconds.
+     */
+    int64_t wall_time;
+    /**
+     * CPU time used by the thread activating the filter, in microseconds, or
+     * 0 if not supported. The slice and frame threads of the filter are not
+     * accounted for.
+     */
+    int64_t cpu_time;
+    /**
+     * Number of frames the filter had to copy because they were not writable,
+     * e.g. shared with another filter, or not reference-counted, and the size
+     * of their data in bytes. Collected even if AVFilterGraph.profile is not
+     * set.
+     */
+    int64_t nb_frame_copies;
+    int64_t frame_copy_bytes;
+} AVFilterProfile;
+
+/**
+ * @return the statistics collected for the filter so far
+ */
+const AVFilterProfile *avfilter_get_profile(const AVFilterContext *ctx);
+
+/**
+ * Dump the statistics collected for the filters of a graph and the frames
+ * on its links into a human-readable string.
+ *
+ * @param graph    the graph to dump
+ * @param options  formatting options; currently ignored
+ * @return  a string, or NULL in case of memory allocation failure;
+ *          the string must be freed using av_free
+ */
+char *avfilter_graph_dump_profile(AVFilterGraph *graph, const char *options);
+
 /**
  * Request a frame on the oldest sink link.
  *
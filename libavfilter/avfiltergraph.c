@@ -46,8 +46,10 @@
 #define A AV_OPT_FLAG_AUDIO_PARAM
 static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = F|V|A, .unit = "thread_type" },
+        { "pipeline", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_PIPELINE }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, F|V|A, "threads"},
         {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "threads"},
@@ -55,6 +57,10 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "profile", "Measure the time spent in each filter", OFFSET(profile), AV_OPT_TYPE_BOOL,
+        { .i64 = 0 }, 0, 1, F|V|A },
+    { "audio_frame_size", "Merge the input audio frames into frames of this number of samples",
+        OFFSET(audio_frame_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, F|A },
     { NULL },
 };
 
@@ -77,6 +83,37 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_pipeline_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                              int *rets, int nb_filters)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_filter_frame_thread_init(AVFilterContext *ctx, int nb_threads)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+}
+
+int ff_filter_frame_thread_submit(AVFilterLink *link, AVFrame *frame,
+                           int (*filter_frame)(AVFilterLink *link, AVFrame *frame))
+{
+    return filter_frame(link, frame);
+}
+
+int ff_filter_frame_thread_capture(AVFilterLink *link, AVFrame *frame)
+{
+    return 0;
+}
+
+int ff_filter_frame_thread_output(AVFilterContext *ctx, int flush)
+{
+    return 0;
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -94,6 +131,11 @@ AVFilterGraph *avfilter_graph_alloc(void)
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
+    if (ff_mutex_init(&ret->internal->heap_lock, NULL)) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
 
     return ret;
 }
@@ -131,6 +173,9 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_opt_free(*graph);
 
     av_freep(&(*graph)->filters);
+    av_freep(&(*graph)->internal->pipeline_filters);
+    av_freep(&(*graph)->internal->pipeline_rets);
+    ff_mutex_destroy(&(*graph)->internal->heap_lock);
     av_freep(&(*graph)->internal);
     av_freep(graph);
 }
@@ -1288,8 +1333,10 @@ static void heap_bubble_down(AVFilterGraph *graph,
 
 void ff_avfilter_graph_update_heap(AVFilterGraph *graph, AVFilterLink *link)
 {
+    ff_mutex_lock(&graph->internal->heap_lock);
     heap_bubble_up  (graph, link, link->age_index);
     heap_bubble_down(graph, link, link->age_index);
+    ff_mutex_unlock(&graph->internal->heap_lock);
 }
 
 int avfilter_graph_request_oldest(AVFilterGraph *graph)
@@ -1337,12 +1384,105 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+static int pipeline_claimed(AVFilterContext *filter, unsigned round)
+{
+    if (filter->internal->pipeline_claim == round)
+        return 1;
+    for (unsigned i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i] && filter->inputs[i]->src->internal->pipeline_claim == round)
+            return 1;
+    for (unsigned i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i] && filter->outputs[i]->dst->internal->pipeline_claim == round)
+            return 1;
+    return 0;
+}
+
+static void pipeline_claim(AVFilterContext *filter, unsigned round)
+{
+    filter->internal->pipeline_claim = round;
+    for (unsigned i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i])
+            filter->inputs[i]->src->internal->pipeline_claim = round;
+    for (unsigned i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            filter->outputs[i]->dst->internal->pipeline_claim = round;
+}
+
+/**
+ * Activate the ready filters at once, in order of readiness, as long as they
+ * are far enough apart in the graph: two filters are only activated together
+ * if they do not share any link nor any neighbour, so that the frame queues,
+ * the statuses and the ready fields each filter touches are its own.
+ */
+static int pipeline_run_once(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    unsigned round, nb = 0;
+    int ret = 0;
+
+    if (gi->pipeline_size < graph->nb_filters) {
+        AVFilterContext **filters;
+        int *rets;
+
+        filters = av_realloc_array(gi->pipeline_filters, graph->nb_filters, sizeof(*filters));
+        if (!filters)
+            return AVERROR(ENOMEM);
+        gi->pipeline_filters = filters;
+        rets = av_realloc_array(gi->pipeline_rets, graph->nb_filters, sizeof(*rets));
+        if (!rets)
+            return AVERROR(ENOMEM);
+        gi->pipeline_rets = rets;
+        gi->pipeline_size = graph->nb_filters;
+    }
+
+    /* 0 is the round of the filters never activated by the scheduler */
+    round = ++gi->pipeline_round;
+    if (!round)
+        round = gi->pipeline_round = 1;
+
+    while (nb < graph->nb_filters) {
+        AVFilterContext *filter = NULL;
+
+        for (unsigned i = 0; i < graph->nb_filters; i++) {
+            AVFilterContext *f = graph->filters[i];
+            if (f->ready && (!filter || f->ready > filter->ready) &&
+                !pipeline_claimed(f, round))
+                filter = f;
+        }
+        if (!filter)
+            break;
+        pipeline_claim(filter, round);
+        gi->pipeline_filters[nb++] = filter;
+    }
+
+    if (!nb)
+        return AVERROR(EAGAIN);
+    if (nb == 1)
+        return ff_filter_activate(gi->pipeline_filters[0]);
+
+    ret = ff_graph_pipeline_execute(graph, gi->pipeline_filters,
+                                    gi->pipeline_rets, nb);
+    if (ret == AVERROR(ENOSYS)) {
+        for (unsigned i = 0; i < nb; i++)
+            gi->pipeline_rets[i] = ff_filter_activate(gi->pipeline_filters[i]);
+    } else if (ret < 0) {
+        return ret;
+    }
+
+    for (unsigned i = 0; i < nb; i++)
+        if (gi->pipeline_rets[i] < 0)
+            return gi->pipeline_rets[i];
+    return 0;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
     unsigned i;
 
     av_assert0(graph->nb_filters);
+    if (graph->thread_type & AVFILTER_THREAD_PIPELINE && graph->internal->thread)
+        return pipeline_run_once(graph);
     filter = graph->filters[0];
     for (i = 1; i < graph->nb_filters; i++)
         if (graph->filters[i]->ready > filter->ready)
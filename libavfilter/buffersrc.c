@@ -36,6 +36,7 @@
 #include "audio.h"
 #include "avfilter.h"
 #include "buffersrc.h"
+#include "filters.h"
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
@@ -230,19 +231,38 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     }
 
-    if (!(copy = av_frame_alloc()))
-        return AVERROR(ENOMEM);
-
-    if (refcounted && !(flags & AV_BUFFERSRC_FLAG_KEEP_REF)) {
-        av_frame_move_ref(copy, frame);
-    } else {
-        ret = av_frame_ref(copy, frame);
+    if (!refcounted && ctx->graph->buffer_cache &&
+        ctx->outputs[0]->type == AVMEDIA_TYPE_VIDEO &&
+        frame->format == ctx->outputs[0]->format) {
+        /* take the copy of the caller's data from the shared cache */
+        copy = ff_get_video_buffer(ctx->outputs[0], frame->width, frame->height);
+        if (!copy)
+            return AVERROR(ENOMEM);
+        ret = av_frame_copy(copy, frame);
+        if (ret >= 0)
+            ret = av_frame_copy_props(copy, frame);
         if (ret < 0) {
             av_frame_free(&copy);
             return ret;
         }
+    } else {
+        if (!(copy = av_frame_alloc()))
+            return AVERROR(ENOMEM);
+
+        if (refcounted && !(flags & AV_BUFFERSRC_FLAG_KEEP_REF)) {
+            av_frame_move_ref(copy, frame);
+        } else {
+            ret = av_frame_ref(copy, frame);
+            if (ret < 0) {
+                av_frame_free(&copy);
+                return ret;
+            }
+        }
     }
 
+    if (!refcounted)
+        ff_filter_account_frame_copy(ctx, copy);
+
 #if FF_API_PKT_DURATION
 FF_DISABLE_DEPRECATION_WARNINGS
     if (copy->pkt_duration && copy->pkt_duration != copy->duration)
@@ -462,6 +482,10 @@ static int config_props(AVFilterLink *link)
             if (ret < 0)
                 return ret;
         }
+        /* Let the framework merge the small frames; the destination filter
+         * may still override this with its own requirements. */
+        if (link->src->graph->audio_frame_size > 0)
+            link->min_samples = link->max_samples = link->src->graph->audio_frame_size;
         break;
     default:
         return AVERROR(EINVAL);
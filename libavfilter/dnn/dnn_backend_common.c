@@ -21,6 +21,7 @@
  * DNN common functions different backends.
  */
 
+#include "libavutil/time.h"
 #include "dnn_backend_common.h"
 
 #define DNN_ASYNC_SUCCESS (void *)0
@@ -69,10 +70,23 @@ int ff_dnn_fill_task(TaskItem *task, DNNExecBaseParams *exec_params, void *backe
     task->model = backend_model;
     task->nb_output = exec_params->nb_output;
     task->output_names = exec_params->output_names;
+    task->submit_time = av_gettime_relative();
 
     return 0;
 }
 
+int ff_dnn_batch_ready(Queue *lltask_queue, int batch_size, int64_t batch_timeout)
+{
+    LastLevelTaskItem *lltask = ff_queue_peek_front(lltask_queue);
+
+    if (!lltask)
+        return 0;
+    if (ff_queue_size(lltask_queue) >= batch_size)
+        return 1;
+    return batch_timeout > 0 &&
+           av_gettime_relative() - lltask->task->submit_time >= batch_timeout;
+}
+
 /**
  * Thread routine for async execution.
  * @param args pointer to DNNAsyncExecModule module
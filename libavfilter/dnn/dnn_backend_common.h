@@ -32,9 +32,15 @@
     { "nireq",           "number of request",             OFFSET(options.nireq),           AV_OPT_TYPE_INT,    { .i64 = 0 },     0, INT_MAX, FLAGS }, \
     { "async",           "use DNN async inference",       OFFSET(options.async),           AV_OPT_TYPE_BOOL,   { .i64 = 1 },     0,       1, FLAGS },
 
+#define DNN_BACKEND_BATCH_OPTIONS \
+    { "batch_size",      "batch size per request",        OFFSET(options.batch_size),      AV_OPT_TYPE_INT,      { .i64 = 1 },   1,      1000, FLAGS }, \
+    { "batch_timeout",   "max time a frame waits for its batch to be filled, 0 for no limit", \
+                                                          OFFSET(options.batch_timeout),   AV_OPT_TYPE_DURATION, { .i64 = 0 },   0, INT64_MAX, FLAGS },
+
 // one task for one function call from dnn interface
 typedef struct TaskItem {
     void *model; // model for the backend
+    const DNNModel *dnn_model; // model of the filter instance submitting the task
     AVFrame *in_frame;
     AVFrame *out_frame;
     const char *input_name;
@@ -44,6 +50,7 @@ typedef struct TaskItem {
     uint32_t nb_output;
     uint32_t inference_todo;
     uint32_t inference_done;
+    int64_t submit_time; // av_gettime_relative() when the task was filled
 } TaskItem;
 
 // one task might have multiple inferences
@@ -96,6 +103,19 @@ int ff_check_exec_params(void *ctx, DNNBackendType backend, DNNFunctionType func
  */
 int ff_dnn_fill_task(TaskItem *task, DNNExecBaseParams *exec_params, void *backend_model, int async, int do_ioproc);
 
+/**
+ * Check whether the last level tasks queued so far should be submitted for
+ * inference. They are held back until a whole batch is available, unless
+ * the oldest of them has already waited for batch_timeout.
+ *
+ * @param lltask_queue pointer to the last level task queue of the backend
+ * @param batch_size number of inferences to run at once
+ * @param batch_timeout max waiting time in microseconds, 0 for no limit
+ *
+ * @returns 1 if the queued tasks should be run, 0 otherwise.
+ */
+int ff_dnn_batch_ready(Queue *lltask_queue, int batch_size, int64_t batch_timeout);
+
 /**
  * Join the Async Execution thread and set module pointers to NULL.
  *
@@ -35,6 +35,7 @@
 static const AVOption dnn_native_options[] = {
     { "conv2d_threads", "threads num for conv2d layer", OFFSET(options.conv2d_threads), AV_OPT_TYPE_INT,  { .i64 = 0 }, INT_MIN, INT_MAX, FLAGS },
     { "async",          "use DNN async inference",      OFFSET(options.async),          AV_OPT_TYPE_BOOL, { .i64 = 0 },       0,       1, FLAGS },
+    DNN_BACKEND_BATCH_OPTIONS
     { NULL },
 };
 
@@ -115,6 +116,7 @@ static int get_output_native(void *model, const char *input_name, int input_widt
     if (ret != 0) {
         goto err;
     }
+    task.dnn_model = native_model->model;
 
     ret = extract_lltask_from_task(&task, native_model->lltask_queue);
     if (ret != 0) {
@@ -185,6 +187,7 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename, DNNFunctionType f
     model->model = native_model;
 
     native_model->ctx.class = &dnn_native_class;
+    av_opt_set_defaults(&native_model->ctx);
     model->options = options;
     if (av_opt_set_from_string(&native_model->ctx, model->options, NULL, "=", "&") < 0)
         goto fail;
@@ -305,19 +308,37 @@ static int execute_model_native(Queue *lltask_queue)
     DNNData input, output;
     DnnOperand *oprd = NULL;
     LastLevelTaskItem *lltask = NULL;
+    LastLevelTaskItem **lltasks = NULL;
     TaskItem *task = NULL;
+    int nb_lltasks = 0, frame_size;
     int ret = 0;
 
-    lltask = ff_queue_pop_front(lltask_queue);
+    lltask = ff_queue_peek_front(lltask_queue);
     if (!lltask) {
         av_log(NULL, AV_LOG_ERROR, "Failed to get LastLevelTaskItem\n");
-        ret = AVERROR(EINVAL);
-        goto err;
+        return AVERROR(EINVAL);
     }
     task = lltask->task;
     native_model = task->model;
     ctx = &native_model->ctx;
 
+    lltasks = av_malloc_array(ctx->options.batch_size, sizeof(*lltasks));
+    if (!lltasks)
+        return AVERROR(ENOMEM);
+
+    // the tasks of a batch are stacked along the first dimension of the
+    // input, so they must all have the same size
+    while (nb_lltasks < ctx->options.batch_size &&
+           (lltask = ff_queue_peek_front(lltask_queue))) {
+        TaskItem *next = lltask->task;
+        if (next->in_frame->width  != task->in_frame->width  ||
+            next->in_frame->height != task->in_frame->height ||
+            next->do_ioproc != task->do_ioproc ||
+            strcmp(next->input_name, task->input_name))
+            break;
+        lltasks[nb_lltasks++] = ff_queue_pop_front(lltask_queue);
+    }
+
     if (native_model->layers_num <= 0 || native_model->operands_num <= 0) {
         av_log(ctx, AV_LOG_ERROR, "No operands or layers in model\n");
         ret = AVERROR(EINVAL);
@@ -342,6 +363,7 @@ static int execute_model_native(Queue *lltask_queue)
         goto err;
     }
 
+    oprd->dims[0] = nb_lltasks;
     oprd->dims[1] = task->in_frame->height;
     oprd->dims[2] = task->in_frame->width;
 
@@ -362,13 +384,17 @@ static int execute_model_native(Queue *lltask_queue)
     input.height = oprd->dims[1];
     input.width = oprd->dims[2];
     input.channels = oprd->dims[3];
-    input.data = oprd->data;
     input.dt = oprd->data_type;
-    if (task->do_ioproc) {
-        if (native_model->model->frame_pre_proc != NULL) {
-            native_model->model->frame_pre_proc(task->in_frame, &input, native_model->model->filter_ctx);
-        } else {
-            ff_proc_from_frame_to_dnn(task->in_frame, &input, ctx);
+    frame_size = input.height * input.width * input.channels;
+    for (int i = 0; i < nb_lltasks; i++) {
+        TaskItem *cur = lltasks[i]->task;
+        input.data = (float *)oprd->data + i * frame_size;
+        if (cur->do_ioproc) {
+            if (cur->dnn_model->frame_pre_proc != NULL) {
+                cur->dnn_model->frame_pre_proc(cur->in_frame, &input, cur->dnn_model->filter_ctx);
+            } else {
+                ff_proc_from_frame_to_dnn(cur->in_frame, &input, ctx);
+            }
         }
     }
 
@@ -409,26 +435,36 @@ static int execute_model_native(Queue *lltask_queue)
             goto err;
         }
 
-        output.data = oprd->data;
         output.height = oprd->dims[1];
         output.width = oprd->dims[2];
         output.channels = oprd->dims[3];
         output.dt = oprd->data_type;
-
-        if (task->do_ioproc) {
-            if (native_model->model->frame_post_proc != NULL) {
-                native_model->model->frame_post_proc(task->out_frame, &output, native_model->model->filter_ctx);
+        frame_size = output.height * output.width * output.channels;
+
+        for (int j = 0; j < nb_lltasks; j++) {
+            TaskItem *cur = lltasks[j]->task;
+            output.data = (float *)oprd->data + j * frame_size;
+            if (cur->do_ioproc) {
+                if (cur->dnn_model->frame_post_proc != NULL) {
+                    cur->dnn_model->frame_post_proc(cur->out_frame, &output, cur->dnn_model->filter_ctx);
+                } else {
+                    ff_proc_from_dnn_to_frame(cur->out_frame, &output, ctx);
+                }
             } else {
-                ff_proc_from_dnn_to_frame(task->out_frame, &output, ctx);
+                cur->out_frame->width = output.width;
+                cur->out_frame->height = output.height;
             }
-        } else {
-            task->out_frame->width = output.width;
-            task->out_frame->height = output.height;
         }
     }
-    task->inference_done++;
+    for (int i = 0; i < nb_lltasks; i++)
+        lltasks[i]->task->inference_done++;
 err:
-    av_freep(&lltask);
+    // the input shape of the model is also used to query it
+    if (oprd && oprd->type == DOT_INPUT)
+        oprd->dims[0] = 1;
+    for (int i = 0; i < nb_lltasks; i++)
+        av_freep(&lltasks[i]);
+    av_freep(&lltasks);
     return ret;
 }
 
@@ -455,6 +491,7 @@ int ff_dnn_execute_model_native(const DNNModel *model, DNNExecBaseParams *exec_p
         av_freep(&task);
         return ret;
     }
+    task->dnn_model = model;
 
     if (ff_queue_push_back(native_model->task_queue, task) < 0) {
         av_freep(&task);
@@ -468,21 +505,30 @@ int ff_dnn_execute_model_native(const DNNModel *model, DNNExecBaseParams *exec_p
         return ret;
     }
 
-    return execute_model_native(native_model->lltask_queue);
+    while (ff_dnn_batch_ready(native_model->lltask_queue,
+                              ctx->options.batch_size, ctx->options.batch_timeout)) {
+        ret = execute_model_native(native_model->lltask_queue);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
 }
 
 int ff_dnn_flush_native(const DNNModel *model)
 {
     NativeModel *native_model = model->model;
-
-    if (ff_queue_size(native_model->lltask_queue) == 0) {
-        // no pending task need to flush
-        return 0;
-    }
+    int ret;
 
     // for now, use sync node with flush operation
     // Switch to async when it is supported
-    return execute_model_native(native_model->lltask_queue);
+    while (ff_queue_size(native_model->lltask_queue) != 0) {
+        ret = execute_model_native(native_model->lltask_queue);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
 }
 
 DNNAsyncStatusType ff_dnn_get_result_native(const DNNModel *model, AVFrame **in, AVFrame **out)
@@ -113,6 +113,8 @@ typedef struct InputParams{
 typedef struct NativeOptions{
     uint8_t async;
     uint32_t conv2d_threads;
+    int batch_size;
+    int64_t batch_timeout;
 } NativeOptions;
 
 typedef struct NativeContext {
@@ -118,28 +118,30 @@ int ff_dnn_execute_layer_avg_pool(DnnOperand *operands, const int32_t *input_ope
     }
     output = output_operand->data;
 
-    for (int y = 0; y < height_end; y += kernel_strides) {
-        for (int x = 0; x < width_end; x += kernel_strides) {
-            for (int n_channel = 0; n_channel < channel; ++n_channel) {
-                output[n_channel] = 0.0;
-                kernel_area = 0;
-                for (int kernel_y = 0; kernel_y < avgpool_params->kernel_size; ++kernel_y) {
-                    for (int kernel_x = 0; kernel_x < avgpool_params->kernel_size; ++kernel_x) {
-                        float input_pel;
-                        int y_pos = y + (kernel_y - height_radius);
-                        int x_pos = x + (kernel_x - width_radius);
-                        if (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) {
-                            input_pel = 0.0;
-                        } else {
-                            kernel_area++;
-                            input_pel = input[y_pos * src_linesize + x_pos * channel + n_channel];
+    for (int n = 0; n < number; ++n, input += height * src_linesize) {
+        for (int y = 0; y < height_end; y += kernel_strides) {
+            for (int x = 0; x < width_end; x += kernel_strides) {
+                for (int n_channel = 0; n_channel < channel; ++n_channel) {
+                    output[n_channel] = 0.0;
+                    kernel_area = 0;
+                    for (int kernel_y = 0; kernel_y < avgpool_params->kernel_size; ++kernel_y) {
+                        for (int kernel_x = 0; kernel_x < avgpool_params->kernel_size; ++kernel_x) {
+                            float input_pel;
+                            int y_pos = y + (kernel_y - height_radius);
+                            int x_pos = x + (kernel_x - width_radius);
+                            if (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) {
+                                input_pel = 0.0;
+                            } else {
+                                kernel_area++;
+                                input_pel = input[y_pos * src_linesize + x_pos * channel + n_channel];
+                            }
+                            output[n_channel] += input_pel;
                         }
-                        output[n_channel] += input_pel;
                     }
+                    output[n_channel] /= kernel_area;
                 }
-                output[n_channel] /= kernel_area;
+                output += channel;
             }
-            output += channel;
         }
     }
 
@@ -21,6 +21,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/thread.h"
 #include "libavutil/cpu.h"
+#include "libavutil/mem.h"
 #include "dnn_backend_native_layer_conv2d.h"
 
 #define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
@@ -33,11 +34,16 @@ typedef struct ThreadCommonParam{
     const void *parameters;
     NativeContext *ctx;
     float *output_data;
+    DNNConv2DDSPContext dsp;
+    float *kernel;
+    float *biases;
+    int patch_size;
 } ThreadCommonParam;
 
 typedef struct ThreadParam{
     ThreadCommonParam *thread_common_param;
     int thread_start, thread_end;
+    float *patch;
 #if HAVE_PTHREAD_CANCEL
     pthread_t thread;
 #endif
@@ -108,6 +114,26 @@ int ff_dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int
     return dnn_size;
 }
 
+static void dot_products_c(float *dst, const float *patch, const float *kernel,
+                           const float *biases, int patch_size, int output_num)
+{
+    for (int n_filter = 0; n_filter < output_num; ++n_filter) {
+        float sum = biases[n_filter];
+        for (int i = 0; i < patch_size; ++i)
+            sum += patch[i] * kernel[i];
+        dst[n_filter] = sum;
+        kernel += patch_size;
+    }
+}
+
+av_cold void ff_dnn_conv2d_dsp_init(DNNConv2DDSPContext *c)
+{
+    c->dot_products = dot_products_c;
+#if ARCH_X86
+    ff_dnn_conv2d_dsp_init_x86(c);
+#endif
+}
+
 static void * dnn_execute_layer_conv2d_thread(void *threadarg)
 {
     //pass parameters
@@ -115,74 +141,101 @@ static void * dnn_execute_layer_conv2d_thread(void *threadarg)
     ThreadCommonParam *thread_common_param = thread_param->thread_common_param;
     DnnOperand *operands = thread_common_param->operands;
     int32_t input_operand_index = thread_common_param->input_operand_indexes[0];
+    int number = operands[input_operand_index].dims[0];
     int height = operands[input_operand_index].dims[1];
     int width = operands[input_operand_index].dims[2];
     int channel = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
     const ConvolutionalParams *conv_params = thread_common_param->parameters;
+    const DNNConv2DDSPContext *dsp = &thread_common_param->dsp;
+    float *patch = thread_param->patch;
 
     int radius = conv_params->kernel_size >> 1;
     int src_linesize = width * conv_params->input_num;
-    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
-    int filter_size = conv_params->kernel_size * filter_linesize;
+    int pel_size = conv_params->input_num * sizeof(*patch);
     int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
-
-    float *output = thread_common_param->output_data;
-    output += (conv_params->output_num) * (width - 2 * pad_size) * (thread_param->thread_start - pad_size);
+    int src_size = height * src_linesize;
+    int dst_size = (height - 2 * pad_size) * (width - 2 * pad_size) * conv_params->output_num;
 
     av_assert0(channel == conv_params->input_num);
 
-    for (int y = thread_param->thread_start; y < thread_param->thread_end; ++y) {
-        for (int x = pad_size; x < width - pad_size; ++x) {
-            for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
-                if (conv_params->has_bias)
-                    output[n_filter] = conv_params->biases[n_filter];
-                else
-                    output[n_filter] = 0.f;
-
-                for (int ch = 0; ch < conv_params->input_num; ++ch) {
-                    for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
-                        for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
-                            float input_pel;
-                            if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
-                                int y_pos = CLAMP_TO_EDGE(y + (kernel_y - radius) * conv_params->dilation, height);
-                                int x_pos = CLAMP_TO_EDGE(x + (kernel_x - radius) * conv_params->dilation, width);
-                                input_pel = input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            } else {
-                                int y_pos = y + (kernel_y - radius) * conv_params->dilation;
-                                int x_pos = x + (kernel_x - radius) * conv_params->dilation;
-                                input_pel = (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) ? 0.0 :
-                                                   input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            }
-
-
-                            output[n_filter] += input_pel * conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
-                                                                                kernel_x * conv_params->input_num + ch];
+    // every thread handles the same rows of all the images of the batch
+    for (int n = 0; n < number; ++n) {
+        const float *input = (const float *)operands[input_operand_index].data + n * src_size;
+        float *output = thread_common_param->output_data + n * dst_size;
+        output += (conv_params->output_num) * (width - 2 * pad_size) * (thread_param->thread_start - pad_size);
+
+        for (int y = thread_param->thread_start; y < thread_param->thread_end; ++y) {
+            for (int x = pad_size; x < width - pad_size; ++x) {
+                float *dst = patch;
+
+                // gather the input pixels in the order of the kernel weights
+                for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
+                    for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
+                        int y_pos = y + (kernel_y - radius) * conv_params->dilation;
+                        int x_pos = x + (kernel_x - radius) * conv_params->dilation;
+                        if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
+                            y_pos = CLAMP_TO_EDGE(y_pos, height);
+                            x_pos = CLAMP_TO_EDGE(x_pos, width);
+                        } else if (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) {
+                            memset(dst, 0, pel_size);
+                            dst += conv_params->input_num;
+                            continue;
                         }
+                        memcpy(dst, input + y_pos * src_linesize + x_pos * conv_params->input_num, pel_size);
+                        dst += conv_params->input_num;
                     }
                 }
-                switch (conv_params->activation){
-                case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
-                    break;
-                case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
-                    break;
-                case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
-                    break;
-                case NONE:
-                    break;
-                case LEAKY_RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
+
+                dsp->dot_products(output, patch, thread_common_param->kernel,
+                                  thread_common_param->biases,
+                                  thread_common_param->patch_size, conv_params->output_num);
+
+                for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
+                    switch (conv_params->activation){
+                    case RELU:
+                        output[n_filter] = FFMAX(output[n_filter], 0.0);
+                        break;
+                    case TANH:
+                        output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
+                        break;
+                    case SIGMOID:
+                        output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
+                        break;
+                    case NONE:
+                        break;
+                    case LEAKY_RELU:
+                        output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
+                    }
                 }
+                output += conv_params->output_num;
             }
-            output += conv_params->output_num;
         }
     }
     return NULL;
 }
 
+/**
+ * Copy the kernel rows to a buffer where each one is padded with zeros to
+ * the patch size, so that the dot products need no tail handling.
+ */
+static int pack_kernel(ThreadCommonParam *p, const ConvolutionalParams *conv_params)
+{
+    int filter_size = conv_params->kernel_size * conv_params->kernel_size * conv_params->input_num;
+
+    p->patch_size = FFALIGN(filter_size, DNN_CONV2D_PATCH_ALIGN);
+    p->kernel = av_calloc(conv_params->output_num, p->patch_size * sizeof(*p->kernel));
+    p->biases = av_calloc(conv_params->output_num, sizeof(*p->biases));
+    if (!p->kernel || !p->biases)
+        return AVERROR(ENOMEM);
+
+    for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
+        memcpy(p->kernel + n_filter * p->patch_size, conv_params->kernel + n_filter * filter_size,
+               filter_size * sizeof(*p->kernel));
+        if (conv_params->has_bias)
+            p->biases[n_filter] = conv_params->biases[n_filter];
+    }
+    return 0;
+}
 
 int ff_dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_indexes,
                                 int32_t output_operand_index, const void *parameters, NativeContext *ctx)
@@ -190,18 +243,19 @@ int ff_dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_opera
 #if HAVE_PTHREAD_CANCEL
     int thread_num = (ctx->options.conv2d_threads <= 0 || ctx->options.conv2d_threads > av_cpu_count())
         ? (av_cpu_count() + 1) : (ctx->options.conv2d_threads);
-    int ret = 0, thread_stride;
+    int thread_stride;
     ThreadParam *thread_param;
 #else
     ThreadParam thread_param = { 0 };
 #endif
-    ThreadCommonParam thread_common_param;
+    ThreadCommonParam thread_common_param = { 0 };
     const ConvolutionalParams *conv_params = parameters;
     int height = operands[input_operand_indexes[0]].dims[1];
     int width = operands[input_operand_indexes[0]].dims[2];
     int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
     DnnOperand *output_operand = &operands[output_operand_index];
     void *tmp;
+    int ret;
 
     output_operand->dims[0] = operands[input_operand_indexes[0]].dims[0];
     output_operand->dims[1] = height - pad_size * 2;
@@ -225,11 +279,17 @@ int ff_dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_opera
     thread_common_param.output_operand_index = output_operand_index;
     thread_common_param.parameters = parameters;
     thread_common_param.ctx = ctx;
+    ff_dnn_conv2d_dsp_init(&thread_common_param.dsp);
+    ret = pack_kernel(&thread_common_param, conv_params);
+    if (ret < 0)
+        goto end;
 
 #if HAVE_PTHREAD_CANCEL
-    thread_param = av_malloc_array(thread_num, sizeof(*thread_param));
-    if (!thread_param)
-        return AVERROR(ENOMEM);
+    thread_param = av_calloc(thread_num, sizeof(*thread_param));
+    if (!thread_param) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
     thread_stride = (height - pad_size * 2) / thread_num;
     //create threads
     for (int i = 0; i < thread_num; i++){
@@ -237,9 +297,16 @@ int ff_dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_opera
         thread_param[i].thread_common_param = &thread_common_param;
         thread_param[i].thread_start = thread_stride * i + pad_size;
         thread_param[i].thread_end = (i == thread_num - 1) ? (height - pad_size) : (thread_param[i].thread_start + thread_stride);
+        thread_param[i].patch = av_calloc(thread_common_param.patch_size, sizeof(*thread_param[i].patch));
+        if (!thread_param[i].patch) {
+            thread_num = i;
+            ret = AVERROR(ENOMEM);
+            break;
+        }
         thread_ret = pthread_create(&thread_param[i].thread, NULL,
                                     dnn_execute_layer_conv2d_thread, &thread_param[i]);
         if (thread_ret) {
+            av_freep(&thread_param[i].patch);
             thread_num = i;
             ret = AVERROR(thread_ret);
             break;
@@ -248,18 +315,26 @@ int ff_dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_opera
 
     for (int i = 0; i < thread_num; i++){
         pthread_join(thread_param[i].thread, NULL);
+        av_freep(&thread_param[i].patch);
     }
 
     //release memory
     av_freep(&thread_param);
-
-    return ret;
 #else
     thread_param.thread_common_param = &thread_common_param;
     thread_param.thread_start = pad_size;
     thread_param.thread_end = height - pad_size;
+    thread_param.patch = av_calloc(thread_common_param.patch_size, sizeof(*thread_param.patch));
+    if (!thread_param.patch) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
     dnn_execute_layer_conv2d_thread(&thread_param);
-
-    return 0;
+    av_freep(&thread_param.patch);
 #endif
+
+end:
+    av_freep(&thread_common_param.kernel);
+    av_freep(&thread_common_param.biases);
+    return ret;
 }
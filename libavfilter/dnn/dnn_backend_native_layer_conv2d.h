@@ -34,6 +34,31 @@ typedef struct ConvolutionalParams{
     float *biases;
 } ConvolutionalParams;
 
+/**
+ * Number of floats the convolution patches and kernel rows are padded to.
+ */
+#define DNN_CONV2D_PATCH_ALIGN 16
+
+typedef struct DNNConv2DDSPContext {
+    /**
+     * Compute the dot products of a patch of the input, unrolled over the
+     * kernel height, kernel width and input channels, with each row of the
+     * kernel, and add the biases.
+     *
+     * @param dst         output_num results
+     * @param patch       patch_size floats
+     * @param kernel      output_num rows of patch_size floats
+     * @param biases      output_num biases
+     * @param patch_size  multiple of DNN_CONV2D_PATCH_ALIGN
+     * @param output_num  number of output channels
+     */
+    void (*dot_products)(float *dst, const float *patch, const float *kernel,
+                         const float *biases, int patch_size, int output_num);
+} DNNConv2DDSPContext;
+
+void ff_dnn_conv2d_dsp_init(DNNConv2DDSPContext *c);
+void ff_dnn_conv2d_dsp_init_x86(DNNConv2DDSPContext *c);
+
 /**
  * @brief Load the 2D Convolution Layer.
  *
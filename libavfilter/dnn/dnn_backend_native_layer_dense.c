@@ -115,36 +115,38 @@ int ff_dnn_execute_layer_dense(DnnOperand *operands, const int32_t *input_operan
 
     av_assert0(channel == dense_params->input_num);
 
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            for (int n_filter = 0; n_filter < dense_params->output_num; ++n_filter) {
-                if (dense_params->has_bias)
-                    output[n_filter] = dense_params->biases[n_filter];
-                else
-                    output[n_filter] = 0.f;
-
-                for (int ch = 0; ch < dense_params->input_num; ++ch) {
-                    float input_pel;
-                    input_pel = input[y * src_linesize + x * dense_params->input_num + ch];
-                    output[n_filter] += input_pel * dense_params->kernel[n_filter*dense_params->input_num + ch];
-                }
-                switch (dense_params->activation){
-                case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
-                    break;
-                case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
-                    break;
-                case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
-                    break;
-                case NONE:
-                    break;
-                case LEAKY_RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
+    for (int n = 0; n < number; ++n, input += height * src_linesize) {
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                for (int n_filter = 0; n_filter < dense_params->output_num; ++n_filter) {
+                    if (dense_params->has_bias)
+                        output[n_filter] = dense_params->biases[n_filter];
+                    else
+                        output[n_filter] = 0.f;
+
+                    for (int ch = 0; ch < dense_params->input_num; ++ch) {
+                        float input_pel;
+                        input_pel = input[y * src_linesize + x * dense_params->input_num + ch];
+                        output[n_filter] += input_pel * dense_params->kernel[n_filter*dense_params->input_num + ch];
+                    }
+                    switch (dense_params->activation){
+                    case RELU:
+                        output[n_filter] = FFMAX(output[n_filter], 0.0);
+                        break;
+                    case TANH:
+                        output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
+                        break;
+                    case SIGMOID:
+                        output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
+                        break;
+                    case NONE:
+                        break;
+                    case LEAKY_RELU:
+                        output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
+                    }
                 }
+                output += dense_params->output_num;
             }
-            output += dense_params->output_num;
         }
     }
     return 0;
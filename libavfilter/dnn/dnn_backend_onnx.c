@@ -0,0 +1,1017 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * DNN ONNX Runtime backend implementation.
+ */
+
+#include "dnn_backend_onnx.h"
+#include "libavformat/avio.h"
+#include "libavutil/avassert.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "../internal.h"
+#include "dnn_io_proc.h"
+#include "dnn_backend_common.h"
+#include "safe_queue.h"
+#include <onnxruntime_c_api.h>
+
+enum {
+    PROVIDER_CPU,
+    PROVIDER_CUDA,
+    PROVIDER_TENSORRT,
+};
+
+enum {
+    LAYOUT_AUTO = -1,
+    LAYOUT_NHWC,
+    LAYOUT_NCHW,
+};
+
+typedef struct OnnxOptions{
+    int provider;
+    int device_id;
+    int threads;
+    int fp16;
+    char *engine_cache;
+    int layout;
+    uint8_t async;
+    uint32_t nireq;
+    int batch_size;
+    int64_t batch_timeout;
+} OnnxOptions;
+
+typedef struct OnnxContext {
+    const AVClass *class;
+    OnnxOptions options;
+} OnnxContext;
+
+typedef struct OnnxModel{
+    OnnxContext ctx;
+    DNNModel *model;
+    const OrtApi *api;
+    OrtEnv *env;
+    OrtSession *session;
+    OrtAllocator *allocator;
+    SafeQueue *request_queue;
+    Queue *lltask_queue;
+    Queue *task_queue;
+} OnnxModel;
+
+typedef struct OnnxRequestItem {
+    OrtValue *input_tensor;
+    OrtValue *output_tensor;
+    int nchw;
+    // one frame in NHWC order, for the models using NCHW
+    uint8_t *input_buf;
+    unsigned int input_buf_size;
+    uint8_t *output_buf;
+    unsigned int output_buf_size;
+    LastLevelTaskItem **lltasks;
+    uint32_t lltask_count;
+    DNNAsyncExecModule exec_module;
+} OnnxRequestItem;
+
+#define OFFSET(x) offsetof(OnnxContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM
+static const AVOption dnn_onnx_options[] = {
+    { "provider",     "execution provider",            OFFSET(options.provider),     AV_OPT_TYPE_INT,    { .i64 = PROVIDER_CPU },  PROVIDER_CPU, PROVIDER_TENSORRT, FLAGS, "provider" },
+        { "cpu",      "default CPU execution",         0,                            AV_OPT_TYPE_CONST,  { .i64 = PROVIDER_CPU },      0, 0, FLAGS, "provider" },
+        { "cuda",     "CUDA execution provider",       0,                            AV_OPT_TYPE_CONST,  { .i64 = PROVIDER_CUDA },     0, 0, FLAGS, "provider" },
+        { "tensorrt", "TensorRT execution provider, falling back to CUDA",
+                                                       0,                            AV_OPT_TYPE_CONST,  { .i64 = PROVIDER_TENSORRT }, 0, 0, FLAGS, "provider" },
+    { "device_id",    "GPU used by the CUDA and TensorRT providers",
+                                                       OFFSET(options.device_id),    AV_OPT_TYPE_INT,    { .i64 = 0 },     0, INT_MAX, FLAGS },
+    { "threads",      "number of threads of the CPU operators, 0 for ONNX Runtime default",
+                                                       OFFSET(options.threads),      AV_OPT_TYPE_INT,    { .i64 = 0 },     0, INT_MAX, FLAGS },
+    { "fp16",         "let TensorRT run in half precision",
+                                                       OFFSET(options.fp16),         AV_OPT_TYPE_BOOL,   { .i64 = 0 },     0, 1, FLAGS },
+    { "engine_cache", "directory caching the TensorRT engines",
+                                                       OFFSET(options.engine_cache), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, FLAGS },
+    { "layout",       "layout of the input and output tensors",
+                                                       OFFSET(options.layout),       AV_OPT_TYPE_INT,    { .i64 = LAYOUT_AUTO }, LAYOUT_AUTO, LAYOUT_NCHW, FLAGS, "layout" },
+        { "auto",     "guess from the input shape",    0,                            AV_OPT_TYPE_CONST,  { .i64 = LAYOUT_AUTO }, 0, 0, FLAGS, "layout" },
+        { "nhwc",     "channels last",                 0,                            AV_OPT_TYPE_CONST,  { .i64 = LAYOUT_NHWC }, 0, 0, FLAGS, "layout" },
+        { "nchw",     "channels first",                0,                            AV_OPT_TYPE_CONST,  { .i64 = LAYOUT_NCHW }, 0, 0, FLAGS, "layout" },
+    DNN_BACKEND_COMMON_OPTIONS
+    DNN_BACKEND_BATCH_OPTIONS
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(dnn_onnx);
+
+static int execute_model_onnx(OnnxRequestItem *request, Queue *lltask_queue);
+static void infer_completion_callback(void *args);
+
+/**
+ * Log and release the status returned by an ONNX Runtime call.
+ *
+ * @return 0 if status is NULL, i.e. the call succeeded, DNN_GENERIC_ERROR
+ *         otherwise
+ */
+static int check_status(OnnxModel *onnx_model, OrtStatus *status, const char *what)
+{
+    if (!status)
+        return 0;
+    av_log(&onnx_model->ctx, AV_LOG_ERROR, "%s: %s\n", what,
+           onnx_model->api->GetErrorMessage(status));
+    onnx_model->api->ReleaseStatus(status);
+    return DNN_GENERIC_ERROR;
+}
+
+static void onnx_free_request(OnnxModel *onnx_model, OnnxRequestItem *request)
+{
+    if (request->input_tensor) {
+        onnx_model->api->ReleaseValue(request->input_tensor);
+        request->input_tensor = NULL;
+    }
+    if (request->output_tensor) {
+        onnx_model->api->ReleaseValue(request->output_tensor);
+        request->output_tensor = NULL;
+    }
+}
+
+static inline void destroy_request_item(OnnxModel *onnx_model, OnnxRequestItem **arg)
+{
+    OnnxRequestItem *request;
+    if (!arg || !*arg) {
+        return;
+    }
+    request = *arg;
+    onnx_free_request(onnx_model, request);
+    for (uint32_t i = 0; i < request->lltask_count; i++)
+        av_freep(&request->lltasks[i]);
+    av_freep(&request->lltasks);
+    av_freep(&request->input_buf);
+    av_freep(&request->output_buf);
+    ff_dnn_async_module_cleanup(&request->exec_module);
+    av_freep(arg);
+}
+
+/**
+ * Start synchronous inference for the ONNX Runtime model.
+ * The output tensor is allocated by ONNX Runtime.
+ */
+static int onnx_start_inference(void *args)
+{
+    OnnxRequestItem *request = args;
+    LastLevelTaskItem *lltask = request->lltasks[0];
+    TaskItem *task = lltask->task;
+    OnnxModel *onnx_model = task->model;
+    const OrtValue *input = request->input_tensor;
+    OrtStatus *status;
+
+    status = onnx_model->api->Run(onnx_model->session, NULL,
+                                  &task->input_name, &input, 1,
+                                  task->output_names, 1, &request->output_tensor);
+    if (status) {
+        int ret = check_status(onnx_model, status, "Inference failed");
+        onnx_free_request(onnx_model, request);
+        if (ff_safe_queue_push_back(onnx_model->request_queue, request) < 0) {
+            destroy_request_item(onnx_model, &request);
+        }
+        return ret;
+    }
+    return 0;
+}
+
+static int extract_lltask_from_task(TaskItem *task, Queue *lltask_queue)
+{
+    OnnxModel *onnx_model = task->model;
+    OnnxContext *ctx = &onnx_model->ctx;
+    LastLevelTaskItem *lltask = av_malloc(sizeof(*lltask));
+    if (!lltask) {
+        av_log(ctx, AV_LOG_ERROR, "Unable to allocate space for LastLevelTaskItem\n");
+        return AVERROR(ENOMEM);
+    }
+    task->inference_todo = 1;
+    task->inference_done = 0;
+    lltask->task = task;
+    if (ff_queue_push_back(lltask_queue, lltask) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to push back lltask_queue.\n");
+        av_freep(&lltask);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static int read_model(const char *model_filename, uint8_t **data, size_t *size)
+{
+    AVIOContext *model_file_context;
+    int64_t file_size;
+    int bytes_read, ret;
+
+    ret = avio_open(&model_file_context, model_filename, AVIO_FLAG_READ);
+    if (ret < 0)
+        return ret;
+
+    file_size = avio_size(model_file_context);
+    if (file_size <= 0 || file_size > INT_MAX) {
+        avio_closep(&model_file_context);
+        return AVERROR(EINVAL);
+    }
+
+    *data = av_malloc(file_size);
+    if (!*data) {
+        avio_closep(&model_file_context);
+        return AVERROR(ENOMEM);
+    }
+    bytes_read = avio_read(model_file_context, *data, file_size);
+    avio_closep(&model_file_context);
+    if (bytes_read != file_size) {
+        av_freep(data);
+        return AVERROR(EIO);
+    }
+    *size = file_size;
+
+    return 0;
+}
+
+static int get_data_type(ONNXTensorElementDataType type, DNNDataType *dt)
+{
+    switch (type) {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+        *dt = DNN_FLOAT;
+        return 0;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+        *dt = DNN_UINT8;
+        return 0;
+    default:
+        return AVERROR(ENOSYS);
+    }
+}
+
+static ONNXTensorElementDataType get_tensor_type(DNNDataType dt)
+{
+    return dt == DNN_FLOAT ? ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT
+                           : ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+}
+
+static int get_data_size(DNNDataType dt)
+{
+    return dt == DNN_FLOAT ? sizeof(float) : 1;
+}
+
+/**
+ * Fill input with the data type and dimensions of the named model input,
+ * and tell whether the model wants its channels first.
+ */
+static int get_input_info(OnnxModel *onnx_model, const char *input_name,
+                          DNNData *input, int *nchw)
+{
+    const OrtApi *api = onnx_model->api;
+    OnnxContext *ctx = &onnx_model->ctx;
+    OrtTypeInfo *type_info = NULL;
+    const OrtTensorTypeAndShapeInfo *tensor_info;
+    ONNXTensorElementDataType type;
+    size_t nb_inputs, nb_dims;
+    int64_t dims[4];
+    int index = -1, ret;
+
+    ret = check_status(onnx_model, api->SessionGetInputCount(onnx_model->session, &nb_inputs),
+                       "Failed to get the number of inputs");
+    if (ret < 0)
+        return ret;
+
+    for (size_t i = 0; i < nb_inputs && index < 0; i++) {
+        char *name;
+        ret = check_status(onnx_model, api->SessionGetInputName(onnx_model->session, i,
+                                                                onnx_model->allocator, &name),
+                           "Failed to get the input name");
+        if (ret < 0)
+            return ret;
+        if (!strcmp(name, input_name))
+            index = i;
+        api->AllocatorFree(onnx_model->allocator, name);
+    }
+    if (index < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Could not find \"%s\" in model\n", input_name);
+        return AVERROR(EINVAL);
+    }
+
+    ret = check_status(onnx_model, api->SessionGetInputTypeInfo(onnx_model->session, index, &type_info),
+                       "Failed to get the input type");
+    if (ret < 0)
+        return ret;
+    ret = check_status(onnx_model, api->CastTypeInfoToTensorInfo(type_info, &tensor_info),
+                       "Failed to get the input type");
+    if (ret < 0)
+        goto end;
+    if (!tensor_info) {
+        av_log(ctx, AV_LOG_ERROR, "Input \"%s\" is not a tensor\n", input_name);
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    ret = check_status(onnx_model, api->GetTensorElementType(tensor_info, &type),
+                       "Failed to get the input type");
+    if (ret < 0)
+        goto end;
+    ret = check_status(onnx_model, api->GetDimensionsCount(tensor_info, &nb_dims),
+                       "Failed to get the input shape");
+    if (ret < 0)
+        goto end;
+    if (nb_dims != 4) {
+        av_log(ctx, AV_LOG_ERROR, "Input \"%s\" has %d dimensions, 4 are needed\n",
+               input_name, (int)nb_dims);
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    ret = check_status(onnx_model, api->GetDimensions(tensor_info, dims, 4),
+                       "Failed to get the input shape");
+    if (ret < 0)
+        goto end;
+
+    ret = get_data_type(type, &input->dt);
+    if (ret < 0) {
+        avpriv_report_missing_feature(ctx, "input data type %d", type);
+        goto end;
+    }
+    input->order = DCO_RGB;
+
+    if (ctx->options.layout == LAYOUT_AUTO) {
+        // ONNX models are channels first unless the shape says otherwise
+        *nchw = !(dims[3] >= 1 && dims[3] <= 4 && !(dims[1] >= 1 && dims[1] <= 4));
+    } else {
+        *nchw = ctx->options.layout == LAYOUT_NCHW;
+    }
+
+    // dynamic dimensions are -1, as for the other backends
+    input->channels = *nchw ? dims[1] : dims[3];
+    input->height   = *nchw ? dims[2] : dims[1];
+    input->width    = *nchw ? dims[3] : dims[2];
+
+end:
+    api->ReleaseTypeInfo(type_info);
+    return ret;
+}
+
+static int get_input_onnx(void *model, DNNData *input, const char *input_name)
+{
+    int nchw;
+    return get_input_info(model, input_name, input, &nchw);
+}
+
+static int get_output_onnx(void *model, const char *input_name, int input_width, int input_height,
+                           const char *output_name, int *output_width, int *output_height)
+{
+    int ret;
+    OnnxModel *onnx_model = model;
+    OnnxContext *ctx = &onnx_model->ctx;
+    TaskItem task;
+    OnnxRequestItem *request;
+    DNNExecBaseParams exec_params = {
+        .input_name     = input_name,
+        .output_names   = &output_name,
+        .nb_output      = 1,
+        .in_frame       = NULL,
+        .out_frame      = NULL,
+    };
+
+    ret = ff_dnn_fill_gettingoutput_task(&task, &exec_params, onnx_model, input_height, input_width, ctx);
+    if (ret != 0) {
+        goto err;
+    }
+    task.dnn_model = onnx_model->model;
+
+    ret = extract_lltask_from_task(&task, onnx_model->lltask_queue);
+    if (ret != 0) {
+        av_log(ctx, AV_LOG_ERROR, "unable to extract inference from task.\n");
+        goto err;
+    }
+
+    request = ff_safe_queue_pop_front(onnx_model->request_queue);
+    if (!request) {
+        av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
+        ret = AVERROR(EINVAL);
+        goto err;
+    }
+
+    ret = execute_model_onnx(request, onnx_model->lltask_queue);
+    *output_width = task.out_frame->width;
+    *output_height = task.out_frame->height;
+
+err:
+    av_frame_free(&task.out_frame);
+    av_frame_free(&task.in_frame);
+    return ret;
+}
+
+/**
+ * Add the CUDA and TensorRT execution providers to the session, the CPU
+ * one is always used for the nodes they do not support.
+ */
+static int append_providers(OnnxModel *onnx_model, OrtSessionOptions *session_options)
+{
+    const OrtApi *api = onnx_model->api;
+    OnnxOptions *options = &onnx_model->ctx.options;
+    OrtStatus *status = NULL;
+    char device_id[16];
+    int ret;
+
+    snprintf(device_id, sizeof(device_id), "%d", options->device_id);
+
+    if (options->provider == PROVIDER_TENSORRT) {
+        OrtTensorRTProviderOptionsV2 *trt_options = NULL;
+        const char *keys[4]   = { "device_id", "trt_fp16_enable" };
+        const char *values[4] = { device_id, options->fp16 ? "1" : "0" };
+        int nb = 2;
+
+        if (options->engine_cache) {
+            keys[nb]     = "trt_engine_cache_enable";
+            values[nb++] = "1";
+            keys[nb]     = "trt_engine_cache_path";
+            values[nb++] = options->engine_cache;
+        }
+
+        status = api->CreateTensorRTProviderOptions(&trt_options);
+        if (!status)
+            status = api->UpdateTensorRTProviderOptions(trt_options, keys, values, nb);
+        if (!status)
+            status = api->SessionOptionsAppendExecutionProvider_TensorRT_V2(session_options, trt_options);
+        if (trt_options)
+            api->ReleaseTensorRTProviderOptions(trt_options);
+        ret = check_status(onnx_model, status, "Failed to add the TensorRT execution provider");
+        if (ret < 0)
+            return ret;
+    }
+
+    if (options->provider == PROVIDER_CUDA || options->provider == PROVIDER_TENSORRT) {
+        OrtCUDAProviderOptionsV2 *cuda_options = NULL;
+        const char *keys[]   = { "device_id" };
+        const char *values[] = { device_id };
+
+        status = api->CreateCUDAProviderOptions(&cuda_options);
+        if (!status)
+            status = api->UpdateCUDAProviderOptions(cuda_options, keys, values, 1);
+        if (!status)
+            status = api->SessionOptionsAppendExecutionProvider_CUDA_V2(session_options, cuda_options);
+        if (cuda_options)
+            api->ReleaseCUDAProviderOptions(cuda_options);
+        ret = check_status(onnx_model, status, "Failed to add the CUDA execution provider");
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int load_onnx_model(OnnxModel *onnx_model, const char *model_filename)
+{
+    const OrtApi *api = onnx_model->api;
+    OnnxContext *ctx = &onnx_model->ctx;
+    OrtSessionOptions *session_options = NULL;
+    uint8_t *model_data = NULL;
+    size_t model_size;
+    int ret;
+
+    ret = read_model(model_filename, &model_data, &model_size);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to read model \"%s\"\n", model_filename);
+        return ret;
+    }
+
+    ret = check_status(onnx_model, api->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "ffmpeg", &onnx_model->env),
+                       "Failed to create the environment");
+    if (ret < 0)
+        goto end;
+
+    ret = check_status(onnx_model, api->GetAllocatorWithDefaultOptions(&onnx_model->allocator),
+                       "Failed to get the allocator");
+    if (ret < 0)
+        goto end;
+
+    ret = check_status(onnx_model, api->CreateSessionOptions(&session_options),
+                       "Failed to create the session options");
+    if (ret < 0)
+        goto end;
+
+    ret = check_status(onnx_model, api->SetSessionGraphOptimizationLevel(session_options, ORT_ENABLE_ALL),
+                       "Failed to set the session options");
+    if (ret < 0)
+        goto end;
+    if (ctx->options.threads) {
+        ret = check_status(onnx_model, api->SetIntraOpNumThreads(session_options, ctx->options.threads),
+                           "Failed to set the session options");
+        if (ret < 0)
+            goto end;
+    }
+
+    ret = append_providers(onnx_model, session_options);
+    if (ret < 0)
+        goto end;
+
+    ret = check_status(onnx_model, api->CreateSessionFromArray(onnx_model->env, model_data, model_size,
+                                                               session_options, &onnx_model->session),
+                       "Failed to load the model");
+
+end:
+    if (session_options)
+        api->ReleaseSessionOptions(session_options);
+    av_freep(&model_data);
+    return ret;
+}
+
+DNNModel *ff_dnn_load_model_onnx(const char *model_filename, DNNFunctionType func_type, const char *options, AVFilterContext *filter_ctx)
+{
+    DNNModel *model = NULL;
+    OnnxModel *onnx_model = NULL;
+    OnnxContext *ctx = NULL;
+
+    model = av_mallocz(sizeof(DNNModel));
+    if (!model){
+        return NULL;
+    }
+
+    onnx_model = av_mallocz(sizeof(OnnxModel));
+    if (!onnx_model){
+        av_freep(&model);
+        return NULL;
+    }
+    onnx_model->model = model;
+    model->model = onnx_model;
+    ctx = &onnx_model->ctx;
+    ctx->class = &dnn_onnx_class;
+
+    //parse options
+    av_opt_set_defaults(ctx);
+    if (av_opt_set_from_string(ctx, options, NULL, "=", "&") < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to parse options \"%s\"\n", options);
+        goto err;
+    }
+
+    if (func_type != DFT_PROCESS_FRAME) {
+        avpriv_report_missing_feature(filter_ctx, "ONNX Runtime backend for this filter");
+        goto err;
+    }
+
+    onnx_model->api = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+    if (!onnx_model->api) {
+        av_log(ctx, AV_LOG_ERROR, "ONNX Runtime library older than the headers FFmpeg was built with\n");
+        goto err;
+    }
+
+    if (load_onnx_model(onnx_model, model_filename) != 0)
+        goto err;
+
+    // the operators already run on all the cores or on the GPU, one request
+    // in flight while the next one is filled is enough
+    if (ctx->options.nireq <= 0) {
+        ctx->options.nireq = 2;
+    }
+
+#if !HAVE_PTHREAD_CANCEL
+    if (ctx->options.async) {
+        ctx->options.async = 0;
+        av_log(filter_ctx, AV_LOG_WARNING, "pthread is not supported, roll back to sync.\n");
+    }
+#endif
+
+    onnx_model->request_queue = ff_safe_queue_create();
+    if (!onnx_model->request_queue) {
+        goto err;
+    }
+
+    for (int i = 0; i < ctx->options.nireq; i++) {
+        OnnxRequestItem *item = av_mallocz(sizeof(*item));
+        if (!item) {
+            goto err;
+        }
+        item->lltasks = av_malloc_array(ctx->options.batch_size, sizeof(*item->lltasks));
+        if (!item->lltasks) {
+            av_freep(&item);
+            goto err;
+        }
+        item->lltask_count = 0;
+        item->exec_module.start_inference = &onnx_start_inference;
+        item->exec_module.callback = &infer_completion_callback;
+        item->exec_module.args = item;
+
+        if (ff_safe_queue_push_back(onnx_model->request_queue, item) < 0) {
+            destroy_request_item(onnx_model, &item);
+            goto err;
+        }
+    }
+
+    onnx_model->lltask_queue = ff_queue_create();
+    if (!onnx_model->lltask_queue) {
+        goto err;
+    }
+
+    onnx_model->task_queue = ff_queue_create();
+    if (!onnx_model->task_queue) {
+        goto err;
+    }
+
+    model->get_input = &get_input_onnx;
+    model->get_output = &get_output_onnx;
+    model->options = options;
+    model->filter_ctx = filter_ctx;
+    model->func_type = func_type;
+
+    return model;
+err:
+    ff_dnn_free_model_onnx(&model);
+    return NULL;
+}
+
+/**
+ * Convert one frame between the NHWC order of the DNN I/O helpers and the
+ * NCHW order of the model; with to_nchw, dst is in NCHW order.
+ */
+static void transpose(uint8_t *dst, const uint8_t *src, const DNNData *data, int to_nchw)
+{
+    size_t n = (size_t)data->width * data->height;
+    int c = data->channels;
+
+    // element (k, i) is at k * n + i in NCHW and at i * c + k in NHWC
+    if (data->dt == DNN_FLOAT) {
+        float *fdst = (float *)dst;
+        const float *fsrc = (const float *)src;
+        for (int k = 0; k < c; k++) {
+            for (size_t i = 0; i < n; i++) {
+                if (to_nchw)
+                    fdst[k * n + i] = fsrc[i * c + k];
+                else
+                    fdst[i * c + k] = fsrc[k * n + i];
+            }
+        }
+    } else {
+        for (int k = 0; k < c; k++) {
+            for (size_t i = 0; i < n; i++) {
+                if (to_nchw)
+                    dst[k * n + i] = src[i * c + k];
+                else
+                    dst[i * c + k] = src[k * n + i];
+            }
+        }
+    }
+}
+
+static int fill_model_input_onnx(OnnxModel *onnx_model, OnnxRequestItem *request)
+{
+    const OrtApi *api = onnx_model->api;
+    OnnxContext *ctx = &onnx_model->ctx;
+    LastLevelTaskItem *lltask;
+    TaskItem *task;
+    DNNData input;
+    int64_t dims[4];
+    size_t frame_size;
+    uint8_t *data;
+    int nchw, ret;
+
+    lltask = ff_queue_pop_front(onnx_model->lltask_queue);
+    av_assert0(lltask);
+    task = lltask->task;
+    request->lltasks[0] = lltask;
+    request->lltask_count = 1;
+
+    // the frames of a batch are stacked along the first dimension of the
+    // input tensor, so they must all have the same size
+    while (request->lltask_count < ctx->options.batch_size &&
+           (lltask = ff_queue_peek_front(onnx_model->lltask_queue))) {
+        TaskItem *next = lltask->task;
+        if (next->in_frame->width  != task->in_frame->width  ||
+            next->in_frame->height != task->in_frame->height ||
+            next->do_ioproc != task->do_ioproc ||
+            strcmp(next->input_name, task->input_name))
+            break;
+        request->lltasks[request->lltask_count++] = ff_queue_pop_front(onnx_model->lltask_queue);
+    }
+
+    ret = get_input_info(onnx_model, task->input_name, &input, &nchw);
+    if (ret != 0) {
+        goto err;
+    }
+    request->nchw = nchw;
+    input.height = task->in_frame->height;
+    input.width = task->in_frame->width;
+
+    dims[0] = request->lltask_count;
+    dims[1] = nchw ? input.channels : input.height;
+    dims[2] = nchw ? input.height   : input.width;
+    dims[3] = nchw ? input.width    : input.channels;
+    ret = check_status(onnx_model, api->CreateTensorAsOrtValue(onnx_model->allocator, dims, 4,
+                                                               get_tensor_type(input.dt),
+                                                               &request->input_tensor),
+                       "Failed to allocate the input tensor");
+    if (ret < 0)
+        goto err;
+    ret = check_status(onnx_model, api->GetTensorMutableData(request->input_tensor, (void **)&data),
+                       "Failed to access the input tensor");
+    if (ret < 0)
+        goto err;
+
+    frame_size = (size_t)input.height * input.width * input.channels * get_data_size(input.dt);
+    if (nchw) {
+        av_fast_malloc(&request->input_buf, &request->input_buf_size, frame_size);
+        if (!request->input_buf) {
+            ret = AVERROR(ENOMEM);
+            goto err;
+        }
+    }
+
+    for (uint32_t i = 0; i < request->lltask_count; i++) {
+        TaskItem *cur = request->lltasks[i]->task;
+
+        input.data = nchw ? request->input_buf : data;
+        if (cur->do_ioproc) {
+            if (cur->dnn_model->frame_pre_proc != NULL) {
+                cur->dnn_model->frame_pre_proc(cur->in_frame, &input, cur->dnn_model->filter_ctx);
+            } else {
+                ff_proc_from_frame_to_dnn(cur->in_frame, &input, ctx);
+            }
+        }
+        if (nchw)
+            transpose(data, request->input_buf, &input, 1);
+        data += frame_size;
+    }
+
+    return 0;
+err:
+    onnx_free_request(onnx_model, request);
+    return ret;
+}
+
+static void infer_completion_callback(void *args) {
+    OnnxRequestItem *request = args;
+    LastLevelTaskItem *lltask = request->lltasks[0];
+    TaskItem *task = lltask->task;
+    OnnxModel *onnx_model = task->model;
+    OnnxContext *ctx = &onnx_model->ctx;
+    const OrtApi *api = onnx_model->api;
+    OrtTensorTypeAndShapeInfo *info = NULL;
+    ONNXTensorElementDataType type;
+    DNNData output;
+    int64_t dims[4];
+    size_t nb_dims, frame_size;
+    uint8_t *data;
+    int nchw, ret;
+
+    ret = check_status(onnx_model, api->GetTensorTypeAndShape(request->output_tensor, &info),
+                       "Failed to get the output shape");
+    if (ret < 0)
+        goto err;
+    ret = check_status(onnx_model, api->GetDimensionsCount(info, &nb_dims),
+                       "Failed to get the output shape");
+    if (ret < 0)
+        goto err;
+    if (nb_dims != 4) {
+        av_log(ctx, AV_LOG_ERROR, "Output has %d dimensions, 4 are needed\n", (int)nb_dims);
+        goto err;
+    }
+    ret = check_status(onnx_model, api->GetDimensions(info, dims, 4),
+                       "Failed to get the output shape");
+    if (ret < 0)
+        goto err;
+    ret = check_status(onnx_model, api->GetTensorElementType(info, &type),
+                       "Failed to get the output type");
+    if (ret < 0)
+        goto err;
+    if (get_data_type(type, &output.dt) < 0) {
+        avpriv_report_missing_feature(ctx, "output data type %d", type);
+        goto err;
+    }
+    ret = check_status(onnx_model, api->GetTensorMutableData(request->output_tensor, (void **)&data),
+                       "Failed to access the output tensor");
+    if (ret < 0)
+        goto err;
+
+    // the output uses the layout of the input
+    nchw = request->nchw;
+    output.channels = nchw ? dims[1] : dims[3];
+    output.height   = nchw ? dims[2] : dims[1];
+    output.width    = nchw ? dims[3] : dims[2];
+    output.order    = DCO_RGB;
+
+    frame_size = (size_t)output.height * output.width * output.channels * get_data_size(output.dt);
+    if (nchw) {
+        av_fast_malloc(&request->output_buf, &request->output_buf_size, frame_size);
+        if (!request->output_buf)
+            goto err;
+    }
+
+    for (uint32_t j = 0; j < request->lltask_count; j++) {
+        task = request->lltasks[j]->task;
+
+        if (nchw) {
+            transpose(request->output_buf, data, &output, 0);
+            output.data = request->output_buf;
+        } else {
+            output.data = data;
+        }
+
+        //it only support 1 output if it's frame in & frame out
+        if (task->do_ioproc) {
+            if (task->dnn_model->frame_post_proc != NULL) {
+                task->dnn_model->frame_post_proc(task->out_frame, &output, task->dnn_model->filter_ctx);
+            } else {
+                ff_proc_from_dnn_to_frame(task->out_frame, &output, ctx);
+            }
+        } else {
+            task->out_frame->width = output.width;
+            task->out_frame->height = output.height;
+        }
+        task->inference_done++;
+
+        // move on to the results of the next frame of the batch
+        data += frame_size;
+    }
+err:
+    if (info)
+        api->ReleaseTensorTypeAndShapeInfo(info);
+    onnx_free_request(onnx_model, request);
+    for (uint32_t i = 0; i < request->lltask_count; i++)
+        av_freep(&request->lltasks[i]);
+    request->lltask_count = 0;
+
+    if (ff_safe_queue_push_back(onnx_model->request_queue, request) < 0) {
+        destroy_request_item(onnx_model, &request);
+        av_log(ctx, AV_LOG_ERROR, "Failed to push back request_queue.\n");
+    }
+}
+
+static int execute_model_onnx(OnnxRequestItem *request, Queue *lltask_queue)
+{
+    OnnxModel *onnx_model;
+    OnnxContext *ctx;
+    LastLevelTaskItem *lltask;
+    TaskItem *task;
+    int ret = 0;
+
+    lltask = ff_queue_peek_front(lltask_queue);
+    av_assert0(lltask);
+    task = lltask->task;
+    onnx_model = task->model;
+    ctx = &onnx_model->ctx;
+
+    ret = fill_model_input_onnx(onnx_model, request);
+    if (ret != 0) {
+        goto err;
+    }
+
+    if (task->async) {
+        ret = ff_dnn_start_inference_async(ctx, &request->exec_module);
+        if (ret != 0) {
+            goto err;
+        }
+        return 0;
+    }
+    else {
+        // on failure, the request is already back in the queue
+        ret = onnx_start_inference(request);
+        if (ret != 0) {
+            return ret;
+        }
+        infer_completion_callback(request);
+        return (task->inference_done == task->inference_todo) ? 0 : DNN_GENERIC_ERROR;
+    }
+err:
+    onnx_free_request(onnx_model, request);
+    if (ff_safe_queue_push_back(onnx_model->request_queue, request) < 0) {
+        destroy_request_item(onnx_model, &request);
+    }
+    return ret;
+}
+
+int ff_dnn_execute_model_onnx(const DNNModel *model, DNNExecBaseParams *exec_params)
+{
+    OnnxModel *onnx_model = model->model;
+    OnnxContext *ctx = &onnx_model->ctx;
+    TaskItem *task;
+    OnnxRequestItem *request;
+    int ret = 0;
+
+    ret = ff_check_exec_params(ctx, DNN_ONNX, model->func_type, exec_params);
+    if (ret != 0) {
+        return ret;
+    }
+
+    task = av_malloc(sizeof(*task));
+    if (!task) {
+        av_log(ctx, AV_LOG_ERROR, "unable to alloc memory for task item.\n");
+        return AVERROR(ENOMEM);
+    }
+
+    ret = ff_dnn_fill_task(task, exec_params, onnx_model, ctx->options.async, 1);
+    if (ret != 0) {
+        av_freep(&task);
+        return ret;
+    }
+    task->dnn_model = model;
+
+    if (ff_queue_push_back(onnx_model->task_queue, task) < 0) {
+        av_freep(&task);
+        av_log(ctx, AV_LOG_ERROR, "unable to push back task_queue.\n");
+        return AVERROR(ENOMEM);
+    }
+
+    ret = extract_lltask_from_task(task, onnx_model->lltask_queue);
+    if (ret != 0) {
+        av_log(ctx, AV_LOG_ERROR, "unable to extract last level task from task.\n");
+        return ret;
+    }
+
+    while (ff_dnn_batch_ready(onnx_model->lltask_queue,
+                              ctx->options.batch_size, ctx->options.batch_timeout)) {
+        request = ff_safe_queue_pop_front(onnx_model->request_queue);
+        if (!request) {
+            av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
+            return AVERROR(EINVAL);
+        }
+        ret = execute_model_onnx(request, onnx_model->lltask_queue);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+DNNAsyncStatusType ff_dnn_get_result_onnx(const DNNModel *model, AVFrame **in, AVFrame **out)
+{
+    OnnxModel *onnx_model = model->model;
+    return ff_dnn_get_result_common(onnx_model->task_queue, in, out);
+}
+
+int ff_dnn_flush_onnx(const DNNModel *model)
+{
+    OnnxModel *onnx_model = model->model;
+    OnnxContext *ctx = &onnx_model->ctx;
+    OnnxRequestItem *request;
+    int ret;
+
+    // the pending tasks might not fit in a single batch if their sizes differ
+    while (ff_queue_size(onnx_model->lltask_queue) != 0) {
+        request = ff_safe_queue_pop_front(onnx_model->request_queue);
+        if (!request) {
+            av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
+            return AVERROR(EINVAL);
+        }
+
+        ret = fill_model_input_onnx(onnx_model, request);
+        if (ret != 0) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to fill model input.\n");
+            if (ff_safe_queue_push_back(onnx_model->request_queue, request) < 0) {
+                destroy_request_item(onnx_model, &request);
+            }
+            return ret;
+        }
+
+        ret = ff_dnn_start_inference_async(ctx, &request->exec_module);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+void ff_dnn_free_model_onnx(DNNModel **model)
+{
+    OnnxModel *onnx_model;
+
+    if (*model){
+        onnx_model = (*model)->model;
+        while (ff_safe_queue_size(onnx_model->request_queue) != 0) {
+            OnnxRequestItem *item = ff_safe_queue_pop_front(onnx_model->request_queue);
+            destroy_request_item(onnx_model, &item);
+        }
+        ff_safe_queue_destroy(onnx_model->request_queue);
+
+        while (ff_queue_size(onnx_model->lltask_queue) != 0) {
+            LastLevelTaskItem *item = ff_queue_pop_front(onnx_model->lltask_queue);
+            av_freep(&item);
+        }
+        ff_queue_destroy(onnx_model->lltask_queue);
+
+        while (ff_queue_size(onnx_model->task_queue) != 0) {
+            TaskItem *item = ff_queue_pop_front(onnx_model->task_queue);
+            av_frame_free(&item->in_frame);
+            av_frame_free(&item->out_frame);
+            av_freep(&item);
+        }
+        ff_queue_destroy(onnx_model->task_queue);
+
+        if (onnx_model->session)
+            onnx_model->api->ReleaseSession(onnx_model->session);
+        if (onnx_model->env)
+            onnx_model->api->ReleaseEnv(onnx_model->env);
+        av_opt_free(&onnx_model->ctx);
+        av_freep(&onnx_model);
+        av_freep(model);
+    }
+}
@@ -41,6 +41,7 @@ typedef struct OVOptions{
     int nireq;
     uint8_t async;
     int batch_size;
+    int64_t batch_timeout;
     int input_resizable;
 } OVOptions;
 
@@ -79,7 +80,7 @@ typedef struct OVRequestItem {
 static const AVOption dnn_openvino_options[] = {
     { "device", "device to run model", OFFSET(options.device_type), AV_OPT_TYPE_STRING, { .str = "CPU" }, 0, 0, FLAGS },
     DNN_BACKEND_COMMON_OPTIONS
-    { "batch_size",  "batch size per request", OFFSET(options.batch_size),  AV_OPT_TYPE_INT,    { .i64 = 1 },     1, 1000, FLAGS},
+    DNN_BACKEND_BATCH_OPTIONS
     { "input_resizable", "can input be resizable or not", OFFSET(options.input_resizable), AV_OPT_TYPE_BOOL,   { .i64 = 0 },     0, 1, FLAGS },
     { NULL }
 };
@@ -171,8 +172,8 @@ static int fill_model_input_ov(OVModel *ov_model, OVRequestItem *request)
         switch (ov_model->model->func_type) {
         case DFT_PROCESS_FRAME:
             if (task->do_ioproc) {
-                if (ov_model->model->frame_pre_proc != NULL) {
-                    ov_model->model->frame_pre_proc(task->in_frame, &input, ov_model->model->filter_ctx);
+                if (task->dnn_model->frame_pre_proc != NULL) {
+                    task->dnn_model->frame_pre_proc(task->in_frame, &input, task->dnn_model->filter_ctx);
                 } else {
                     ff_proc_from_frame_to_dnn(task->in_frame, &input, ctx);
                 }
@@ -248,8 +249,8 @@ static void infer_completion_callback(void *args)
         switch (ov_model->model->func_type) {
         case DFT_PROCESS_FRAME:
             if (task->do_ioproc) {
-                if (ov_model->model->frame_post_proc != NULL) {
-                    ov_model->model->frame_post_proc(task->out_frame, &output, ov_model->model->filter_ctx);
+                if (task->dnn_model->frame_post_proc != NULL) {
+                    task->dnn_model->frame_post_proc(task->out_frame, &output, task->dnn_model->filter_ctx);
                 } else {
                     ff_proc_from_dnn_to_frame(task->out_frame, &output, ctx);
                 }
@@ -259,18 +260,18 @@ static void infer_completion_callback(void *args)
             }
             break;
         case DFT_ANALYTICS_DETECT:
-            if (!ov_model->model->detect_post_proc) {
+            if (!task->dnn_model->detect_post_proc) {
                 av_log(ctx, AV_LOG_ERROR, "detect filter needs to provide post proc\n");
                 return;
             }
-            ov_model->model->detect_post_proc(task->in_frame, &output, 1, ov_model->model->filter_ctx);
+            task->dnn_model->detect_post_proc(task->in_frame, &output, 1, task->dnn_model->filter_ctx);
             break;
         case DFT_ANALYTICS_CLASSIFY:
-            if (!ov_model->model->classify_post_proc) {
+            if (!task->dnn_model->classify_post_proc) {
                 av_log(ctx, AV_LOG_ERROR, "classify filter needs to provide post proc\n");
                 return;
             }
-            ov_model->model->classify_post_proc(task->in_frame, &output, request->lltasks[i]->bbox_index, ov_model->model->filter_ctx);
+            task->dnn_model->classify_post_proc(task->in_frame, &output, request->lltasks[i]->bbox_index, task->dnn_model->filter_ctx);
             break;
         default:
             av_assert0(!"should not reach here");
@@ -698,6 +699,7 @@ static int get_output_ov(void *model, const char *input_name, int input_width, i
     if (ret != 0) {
         goto err;
     }
+    task.dnn_model = ov_model->model;
 
     ret = extract_lltask_from_task(ov_model->model->func_type, &task, ov_model->lltask_queue, NULL);
     if (ret != 0) {
@@ -842,6 +844,7 @@ int ff_dnn_execute_model_ov(const DNNModel *model, DNNExecBaseParams *exec_param
         av_freep(&task);
         return ret;
     }
+    task->dnn_model = model;
 
     if (ff_queue_push_back(ov_model->task_queue, task) < 0) {
         av_freep(&task);
@@ -856,7 +859,8 @@ int ff_dnn_execute_model_ov(const DNNModel *model, DNNExecBaseParams *exec_param
     }
 
     if (ctx->options.async) {
-        while (ff_queue_size(ov_model->lltask_queue) >= ctx->options.batch_size) {
+        while (ff_dnn_batch_ready(ov_model->lltask_queue,
+                                  ctx->options.batch_size, ctx->options.batch_timeout)) {
             request = ff_safe_queue_pop_front(ov_model->request_queue);
             if (!request) {
                 av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
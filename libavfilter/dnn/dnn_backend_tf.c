@@ -44,6 +44,8 @@ typedef struct TFOptions{
     char *sess_config;
     uint8_t async;
     uint32_t nireq;
+    int batch_size;
+    int64_t batch_timeout;
 } TFOptions;
 
 typedef struct TFContext {
@@ -75,7 +77,8 @@ typedef struct TFInferRequest {
 
 typedef struct TFRequestItem {
     TFInferRequest *infer_request;
-    LastLevelTaskItem *lltask;
+    LastLevelTaskItem **lltasks;
+    uint32_t lltask_count;
     TF_Status *status;
     DNNAsyncExecModule exec_module;
 } TFRequestItem;
@@ -85,6 +88,7 @@ typedef struct TFRequestItem {
 static const AVOption dnn_tensorflow_options[] = {
     { "sess_config", "config for SessionOptions", OFFSET(options.sess_config), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
     DNN_BACKEND_COMMON_OPTIONS
+    DNN_BACKEND_BATCH_OPTIONS
     { NULL }
 };
 
@@ -159,7 +163,7 @@ static int tf_start_inference(void *args)
 {
     TFRequestItem *request = args;
     TFInferRequest *infer_request = request->infer_request;
-    LastLevelTaskItem *lltask = request->lltask;
+    LastLevelTaskItem *lltask = request->lltasks[0];
     TaskItem *task = lltask->task;
     TFModel *tf_model = task->model;
 
@@ -197,7 +201,9 @@ static inline void destroy_request_item(TFRequestItem **arg) {
     request = *arg;
     tf_free_request(request->infer_request);
     av_freep(&request->infer_request);
-    av_freep(&request->lltask);
+    for (uint32_t i = 0; i < request->lltask_count; i++)
+        av_freep(&request->lltasks[i]);
+    av_freep(&request->lltasks);
     TF_DeleteStatus(request->status);
     ff_dnn_async_module_cleanup(&request->exec_module);
     av_freep(arg);
@@ -256,11 +262,11 @@ static TF_Buffer *read_graph(const char *model_filename)
     return graph_buf;
 }
 
-static TF_Tensor *allocate_input_tensor(const DNNData *input)
+static TF_Tensor *allocate_input_tensor(const DNNData *input, int batch_size)
 {
     TF_DataType dt;
     size_t size;
-    int64_t input_dims[] = {1, input->height, input->width, input->channels};
+    int64_t input_dims[] = {batch_size, input->height, input->width, input->channels};
     switch (input->dt) {
     case DNN_FLOAT:
         dt = TF_FLOAT;
@@ -275,7 +281,7 @@ static TF_Tensor *allocate_input_tensor(const DNNData *input)
     }
 
     return TF_AllocateTensor(dt, input_dims, 4,
-                             input_dims[1] * input_dims[2] * input_dims[3] * size);
+                             input_dims[0] * input_dims[1] * input_dims[2] * input_dims[3] * size);
 }
 
 static int get_input_tf(void *model, DNNData *input, const char *input_name)
@@ -334,6 +340,7 @@ static int get_output_tf(void *model, const char *input_name, int input_width, i
     if (ret != 0) {
         goto err;
     }
+    task.dnn_model = tf_model->model;
 
     ret = extract_lltask_from_task(&task, tf_model->lltask_queue);
     if (ret != 0) {
@@ -903,10 +910,16 @@ DNNModel *ff_dnn_load_model_tf(const char *model_filename, DNNFunctionType func_
         if (!item) {
             goto err;
         }
-        item->lltask = NULL;
+        item->lltasks = av_malloc_array(ctx->options.batch_size, sizeof(*item->lltasks));
+        if (!item->lltasks) {
+            av_freep(&item);
+            goto err;
+        }
+        item->lltask_count = 0;
         item->infer_request = tf_create_inference_request();
         if (!item->infer_request) {
             av_log(ctx, AV_LOG_ERROR, "Failed to allocate memory for TensorFlow inference request\n");
+            av_freep(&item->lltasks);
             av_freep(&item);
             goto err;
         }
@@ -955,7 +968,21 @@ static int fill_model_input_tf(TFModel *tf_model, TFRequestItem *request) {
     lltask = ff_queue_pop_front(tf_model->lltask_queue);
     av_assert0(lltask);
     task = lltask->task;
-    request->lltask = lltask;
+    request->lltasks[0] = lltask;
+    request->lltask_count = 1;
+
+    // the frames of a batch are stacked along the first dimension of the
+    // input tensor, so they must all have the same size
+    while (request->lltask_count < ctx->options.batch_size &&
+           (lltask = ff_queue_peek_front(tf_model->lltask_queue))) {
+        TaskItem *next = lltask->task;
+        if (next->in_frame->width  != task->in_frame->width  ||
+            next->in_frame->height != task->in_frame->height ||
+            next->do_ioproc != task->do_ioproc ||
+            strcmp(next->input_name, task->input_name))
+            break;
+        request->lltasks[request->lltask_count++] = ff_queue_pop_front(tf_model->lltask_queue);
+    }
 
     ret = get_input_tf(tf_model, &input, task->input_name);
     if (ret != 0) {
@@ -981,7 +1008,7 @@ static int fill_model_input_tf(TFModel *tf_model, TFRequestItem *request) {
     }
     infer_request->tf_input->index = 0;
 
-    infer_request->input_tensor = allocate_input_tensor(&input);
+    infer_request->input_tensor = allocate_input_tensor(&input, request->lltask_count);
     if (!infer_request->input_tensor){
         av_log(ctx, AV_LOG_ERROR, "Failed to allocate memory for input tensor\n");
         ret = AVERROR(ENOMEM);
@@ -989,22 +1016,28 @@ static int fill_model_input_tf(TFModel *tf_model, TFRequestItem *request) {
     }
     input.data = (float *)TF_TensorData(infer_request->input_tensor);
 
-    switch (tf_model->model->func_type) {
-    case DFT_PROCESS_FRAME:
-        if (task->do_ioproc) {
-            if (tf_model->model->frame_pre_proc != NULL) {
-                tf_model->model->frame_pre_proc(task->in_frame, &input, tf_model->model->filter_ctx);
-            } else {
-                ff_proc_from_frame_to_dnn(task->in_frame, &input, ctx);
+    for (uint32_t i = 0; i < request->lltask_count; i++) {
+        TaskItem *cur = request->lltasks[i]->task;
+
+        switch (tf_model->model->func_type) {
+        case DFT_PROCESS_FRAME:
+            if (cur->do_ioproc) {
+                if (cur->dnn_model->frame_pre_proc != NULL) {
+                    cur->dnn_model->frame_pre_proc(cur->in_frame, &input, cur->dnn_model->filter_ctx);
+                } else {
+                    ff_proc_from_frame_to_dnn(cur->in_frame, &input, ctx);
+                }
             }
+            break;
+        case DFT_ANALYTICS_DETECT:
+            ff_frame_to_dnn_detect(cur->in_frame, &input, ctx);
+            break;
+        default:
+            avpriv_report_missing_feature(ctx, "model function type %d", tf_model->model->func_type);
+            break;
         }
-        break;
-    case DFT_ANALYTICS_DETECT:
-        ff_frame_to_dnn_detect(task->in_frame, &input, ctx);
-        break;
-    default:
-        avpriv_report_missing_feature(ctx, "model function type %d", tf_model->model->func_type);
-        break;
+        input.data = (uint8_t *)input.data
+                     + TF_TensorByteSize(infer_request->input_tensor) / request->lltask_count;
     }
 
     infer_request->tf_outputs = av_malloc_array(task->nb_output, sizeof(TF_Output));
@@ -1040,7 +1073,7 @@ err:
 
 static void infer_completion_callback(void *args) {
     TFRequestItem *request = args;
-    LastLevelTaskItem *lltask = request->lltask;
+    LastLevelTaskItem *lltask = request->lltasks[0];
     TaskItem *task = lltask->task;
     DNNData *outputs;
     TFInferRequest *infer_request = request->infer_request;
@@ -1060,35 +1093,47 @@ static void infer_completion_callback(void *args) {
         outputs[i].data = TF_TensorData(infer_request->output_tensors[i]);
         outputs[i].dt = TF_TensorType(infer_request->output_tensors[i]);
     }
-    switch (tf_model->model->func_type) {
-    case DFT_PROCESS_FRAME:
-        //it only support 1 output if it's frame in & frame out
-        if (task->do_ioproc) {
-            if (tf_model->model->frame_post_proc != NULL) {
-                tf_model->model->frame_post_proc(task->out_frame, outputs, tf_model->model->filter_ctx);
+    for (uint32_t j = 0; j < request->lltask_count; j++) {
+        task = request->lltasks[j]->task;
+
+        switch (tf_model->model->func_type) {
+        case DFT_PROCESS_FRAME:
+            //it only support 1 output if it's frame in & frame out
+            if (task->do_ioproc) {
+                if (task->dnn_model->frame_post_proc != NULL) {
+                    task->dnn_model->frame_post_proc(task->out_frame, outputs, task->dnn_model->filter_ctx);
+                } else {
+                    ff_proc_from_dnn_to_frame(task->out_frame, outputs, ctx);
+                }
             } else {
-                ff_proc_from_dnn_to_frame(task->out_frame, outputs, ctx);
+                task->out_frame->width = outputs[0].width;
+                task->out_frame->height = outputs[0].height;
             }
-        } else {
-            task->out_frame->width = outputs[0].width;
-            task->out_frame->height = outputs[0].height;
-        }
-        break;
-    case DFT_ANALYTICS_DETECT:
-        if (!tf_model->model->detect_post_proc) {
-            av_log(ctx, AV_LOG_ERROR, "Detect filter needs provide post proc\n");
-            return;
+            break;
+        case DFT_ANALYTICS_DETECT:
+            if (!task->dnn_model->detect_post_proc) {
+                av_log(ctx, AV_LOG_ERROR, "Detect filter needs provide post proc\n");
+                return;
+            }
+            task->dnn_model->detect_post_proc(task->in_frame, outputs, task->nb_output, task->dnn_model->filter_ctx);
+            break;
+        default:
+            av_log(ctx, AV_LOG_ERROR, "Tensorflow backend does not support this kind of dnn filter now\n");
+            goto err;
         }
-        tf_model->model->detect_post_proc(task->in_frame, outputs, task->nb_output, tf_model->model->filter_ctx);
-        break;
-    default:
-        av_log(ctx, AV_LOG_ERROR, "Tensorflow backend does not support this kind of dnn filter now\n");
-        goto err;
+        task->inference_done++;
+
+        // move on to the results of the next frame of the batch
+        for (uint32_t i = 0; i < task->nb_output; ++i)
+            outputs[i].data = (uint8_t *)outputs[i].data +
+                              TF_TensorByteSize(infer_request->output_tensors[i]) / request->lltask_count;
     }
-    task->inference_done++;
 err:
     tf_free_request(infer_request);
     av_freep(&outputs);
+    for (uint32_t i = 0; i < request->lltask_count; i++)
+        av_freep(&request->lltasks[i]);
+    request->lltask_count = 0;
 
     if (ff_safe_queue_push_back(tf_model->request_queue, request) < 0) {
         destroy_request_item(&request);
@@ -1165,6 +1210,7 @@ int ff_dnn_execute_model_tf(const DNNModel *model, DNNExecBaseParams *exec_param
         av_freep(&task);
         return ret;
     }
+    task->dnn_model = model;
 
     if (ff_queue_push_back(tf_model->task_queue, task) < 0) {
         av_freep(&task);
@@ -1178,12 +1224,19 @@ int ff_dnn_execute_model_tf(const DNNModel *model, DNNExecBaseParams *exec_param
         return ret;
     }
 
-    request = ff_safe_queue_pop_front(tf_model->request_queue);
-    if (!request) {
-        av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
-        return AVERROR(EINVAL);
+    while (ff_dnn_batch_ready(tf_model->lltask_queue,
+                              ctx->options.batch_size, ctx->options.batch_timeout)) {
+        request = ff_safe_queue_pop_front(tf_model->request_queue);
+        if (!request) {
+            av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
+            return AVERROR(EINVAL);
+        }
+        ret = execute_model_tf(request, tf_model->lltask_queue);
+        if (ret != 0)
+            return ret;
     }
-    return execute_model_tf(request, tf_model->lltask_queue);
+
+    return 0;
 }
 
 DNNAsyncStatusType ff_dnn_get_result_tf(const DNNModel *model, AVFrame **in, AVFrame **out)
@@ -1199,27 +1252,29 @@ int ff_dnn_flush_tf(const DNNModel *model)
     TFRequestItem *request;
     int ret;
 
-    if (ff_queue_size(tf_model->lltask_queue) == 0) {
-        // no pending task need to flush
-        return 0;
-    }
-
-    request = ff_safe_queue_pop_front(tf_model->request_queue);
-    if (!request) {
-        av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
-        return AVERROR(EINVAL);
-    }
+    // the pending tasks might not fit in a single batch if their sizes differ
+    while (ff_queue_size(tf_model->lltask_queue) != 0) {
+        request = ff_safe_queue_pop_front(tf_model->request_queue);
+        if (!request) {
+            av_log(ctx, AV_LOG_ERROR, "unable to get infer request.\n");
+            return AVERROR(EINVAL);
+        }
 
-    ret = fill_model_input_tf(tf_model, request);
-    if (ret != 0) {
-        av_log(ctx, AV_LOG_ERROR, "Failed to fill model input.\n");
-        if (ff_safe_queue_push_back(tf_model->request_queue, request) < 0) {
-            destroy_request_item(&request);
+        ret = fill_model_input_tf(tf_model, request);
+        if (ret != 0) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to fill model input.\n");
+            if (ff_safe_queue_push_back(tf_model->request_queue, request) < 0) {
+                destroy_request_item(&request);
+            }
+            return ret;
         }
-        return ret;
+
+        ret = ff_dnn_start_inference_async(ctx, &request->exec_module);
+        if (ret != 0)
+            return ret;
     }
 
-    return ff_dnn_start_inference_async(ctx, &request->exec_module);
+    return 0;
 }
 
 void ff_dnn_free_model_tf(DNNModel **model)
@@ -27,6 +27,7 @@
 #include "dnn_backend_native.h"
 #include "dnn_backend_tf.h"
 #include "dnn_backend_openvino.h"
+#include "dnn_backend_onnx.h"
 #include "libavutil/mem.h"
 
 DNNModule *ff_get_dnn_module(DNNBackendType backend_type)
@@ -70,6 +71,18 @@ DNNModule *ff_get_dnn_module(DNNBackendType backend_type)
         return NULL;
     #endif
         break;
+    case DNN_ONNX:
+    #if (CONFIG_LIBONNXRUNTIME == 1)
+        dnn_module->load_model = &ff_dnn_load_model_onnx;
+        dnn_module->execute_model = &ff_dnn_execute_model_onnx;
+        dnn_module->get_result = &ff_dnn_get_result_onnx;
+        dnn_module->flush = &ff_dnn_flush_onnx;
+        dnn_module->free_model = &ff_dnn_free_model_onnx;
+    #else
+        av_freep(&dnn_module);
+        return NULL;
+    #endif
+        break;
     default:
         av_log(NULL, AV_LOG_ERROR, "Module backend_type is not native or tensorflow\n");
         av_freep(&dnn_module);
@@ -23,6 +23,52 @@
 #include "libswscale/swscale.h"
 #include "libavutil/avassert.h"
 #include "libavutil/detection_bbox.h"
+#include "libavutil/hwcontext.h"
+
+/**
+ * Get a software view of the frame for the pre-processing. Hardware frames
+ * are mapped to memory when the device supports it, and downloaded
+ * otherwise, the frame itself is left on the device.
+ */
+static int get_sw_frame(AVFrame **sw_frame, AVFrame *frame, void *log_ctx)
+{
+    AVHWFramesContext *frames_ctx;
+    AVFrame *sw;
+    int ret;
+
+    if (!frame->hw_frames_ctx) {
+        *sw_frame = frame;
+        return 0;
+    }
+
+    frames_ctx = (AVHWFramesContext *)frame->hw_frames_ctx->data;
+    sw = av_frame_alloc();
+    if (!sw)
+        return AVERROR(ENOMEM);
+
+    sw->format = frames_ctx->sw_format;
+    ret = av_hwframe_map(sw, frame, AV_HWFRAME_MAP_READ);
+    if (ret < 0) {
+        av_frame_unref(sw);
+        sw->format = frames_ctx->sw_format;
+        ret = av_hwframe_transfer_data(sw, frame, 0);
+    }
+    if (ret < 0) {
+        av_log(log_ctx, AV_LOG_ERROR, "Failed to map or download the %s frame\n",
+               av_get_pix_fmt_name(frame->format));
+        av_frame_free(&sw);
+        return ret;
+    }
+
+    *sw_frame = sw;
+    return 0;
+}
+
+static void release_sw_frame(AVFrame **sw_frame, AVFrame *frame)
+{
+    if (*sw_frame != frame)
+        av_frame_free(sw_frame);
+}
 
 int ff_proc_from_dnn_to_frame(AVFrame *frame, DNNData *output, void *log_ctx)
 {
@@ -190,7 +236,7 @@ static enum AVPixelFormat get_pixel_format(DNNData *data)
     return AV_PIX_FMT_BGR24;
 }
 
-int ff_frame_to_dnn_classify(AVFrame *frame, DNNData *input, uint32_t bbox_index, void *log_ctx)
+static int frame_to_dnn_classify(AVFrame *frame, DNNData *input, uint32_t bbox_index, void *log_ctx)
 {
     const AVPixFmtDescriptor *desc;
     int offsetx[4], offsety[4];
@@ -251,7 +297,7 @@ int ff_frame_to_dnn_classify(AVFrame *frame, DNNData *input, uint32_t bbox_index
     return ret;
 }
 
-int ff_frame_to_dnn_detect(AVFrame *frame, DNNData *input, void *log_ctx)
+static int frame_to_dnn_detect(AVFrame *frame, DNNData *input, void *log_ctx)
 {
     struct SwsContext *sws_ctx;
     int linesizes[4];
@@ -281,3 +327,31 @@ int ff_frame_to_dnn_detect(AVFrame *frame, DNNData *input, void *log_ctx)
     sws_freeContext(sws_ctx);
     return ret;
 }
+
+int ff_frame_to_dnn_classify(AVFrame *frame, DNNData *input, uint32_t bbox_index, void *log_ctx)
+{
+    AVFrame *sw_frame;
+    int ret = get_sw_frame(&sw_frame, frame, log_ctx);
+    if (ret < 0)
+        return ret;
+
+    /* the bounding boxes are in the side data of the original frame */
+    if (sw_frame != frame)
+        ret = av_frame_copy_props(sw_frame, frame);
+    if (ret >= 0)
+        ret = frame_to_dnn_classify(sw_frame, input, bbox_index, log_ctx);
+    release_sw_frame(&sw_frame, frame);
+    return ret;
+}
+
+int ff_frame_to_dnn_detect(AVFrame *frame, DNNData *input, void *log_ctx)
+{
+    AVFrame *sw_frame;
+    int ret = get_sw_frame(&sw_frame, frame, log_ctx);
+    if (ret < 0)
+        return ret;
+
+    ret = frame_to_dnn_detect(sw_frame, input, log_ctx);
+    release_sw_frame(&sw_frame, frame);
+    return ret;
+}
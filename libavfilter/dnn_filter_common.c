@@ -17,10 +17,41 @@
  */
 
 #include "dnn_filter_common.h"
+#include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #define MAX_SUPPORTED_OUTPUTS_NB 4
 
+typedef struct DnnResult {
+    AVFrame *in_frame;
+    AVFrame *out_frame;
+} DnnResult;
+
+/**
+ * A model loaded once for all the filter instances, in any filter graph,
+ * using the same backend, function type, model file and backend configs.
+ * The instances submit their frames to the same backend queues, so their
+ * inferences can be batched together, and each of them executes the model
+ * through its own copy of the DNNModel, which holds its processing
+ * callbacks. The results are dispatched back to the submitting instance.
+ */
+typedef struct DnnSharedModel {
+    char *key;
+    DNNModule *dnn_module;
+    DNNModel *model;
+    AVMutex lock;
+    DnnContext **users;
+    int nb_users;
+    struct DnnSharedModel *next;
+} DnnSharedModel;
+
+static AVMutex shared_models_lock = AV_MUTEX_INITIALIZER;
+static DnnSharedModel *shared_models;
+
 static char **separate_output_names(const char *expr, const char *val_sep, int *separated_nb)
 {
     char *val, **parsed_vals = NULL;
@@ -51,6 +82,197 @@ static char **separate_output_names(const char *expr, const char *val_sep, int *
     return parsed_vals;
 }
 
+static void free_shared_model(DnnSharedModel **psm)
+{
+    DnnSharedModel *sm = *psm;
+
+    if (!sm)
+        return;
+    if (sm->dnn_module) {
+        if (sm->model)
+            (sm->dnn_module->free_model)(&sm->model);
+        av_freep(&sm->dnn_module);
+    }
+    av_freep(&sm->users);
+    av_freep(&sm->key);
+    av_freep(psm);
+}
+
+static int shared_model_acquire(DnnContext *ctx, DNNFunctionType func_type, AVFilterContext *filter_ctx)
+{
+    DnnSharedModel *sm;
+    char *key;
+    int ret = 0;
+
+    key = av_asprintf("%d:%d:%s:%s", ctx->backend_type, func_type, ctx->model_filename,
+                      ctx->backend_options ? ctx->backend_options : "");
+    ctx->pending = ff_queue_create();
+    ctx->done    = ff_queue_create();
+    if (!key || !ctx->pending || !ctx->done) {
+        av_free(key);
+        return AVERROR(ENOMEM);
+    }
+
+    ff_mutex_lock(&shared_models_lock);
+    for (sm = shared_models; sm; sm = sm->next)
+        if (!strcmp(sm->key, key))
+            break;
+
+    if (!sm) {
+        sm = av_mallocz(sizeof(*sm));
+        if (!sm) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        sm->key = key;
+        key = NULL;
+        sm->dnn_module = ff_get_dnn_module(ctx->backend_type);
+        if (!sm->dnn_module) {
+            av_log(filter_ctx, AV_LOG_ERROR, "could not create DNN module for requested backend\n");
+            free_shared_model(&sm);
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        sm->model = (sm->dnn_module->load_model)(ctx->model_filename, func_type, ctx->backend_options, filter_ctx);
+        if (!sm->model) {
+            av_log(filter_ctx, AV_LOG_ERROR, "could not load DNN model\n");
+            free_shared_model(&sm);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+        // the filter loading the model might not be the last one using it
+        sm->model->filter_ctx = NULL;
+        ff_mutex_init(&sm->lock, NULL);
+        sm->next = shared_models;
+        shared_models = sm;
+    } else {
+        av_log(filter_ctx, AV_LOG_VERBOSE, "sharing the model %s with %d other filter(s)\n",
+               ctx->model_filename, sm->nb_users);
+    }
+
+    ctx->model = av_memdup(sm->model, sizeof(*sm->model));
+    if (!ctx->model) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ctx->model->filter_ctx         = filter_ctx;
+    ctx->model->frame_pre_proc     = NULL;
+    ctx->model->frame_post_proc    = NULL;
+    ctx->model->detect_post_proc   = NULL;
+    ctx->model->classify_post_proc = NULL;
+
+    ff_mutex_lock(&sm->lock);
+    ret = av_dynarray_add_nofree(&sm->users, &sm->nb_users, ctx);
+    ff_mutex_unlock(&sm->lock);
+    if (ret < 0) {
+        av_freep(&ctx->model);
+        goto end;
+    }
+    ctx->shared_model = sm;
+    ctx->dnn_module   = sm->dnn_module;
+
+end:
+    // a model nobody uses, because the first user failed to register
+    if (sm && !sm->nb_users) {
+        DnnSharedModel **p = &shared_models;
+        while (*p && *p != sm)
+            p = &(*p)->next;
+        if (*p) {
+            *p = sm->next;
+            ff_mutex_destroy(&sm->lock);
+        }
+        free_shared_model(&sm);
+    }
+    ff_mutex_unlock(&shared_models_lock);
+    av_free(key);
+    return ret;
+}
+
+/**
+ * Move the finished inferences of the shared model to the instances which
+ * submitted them. Must be called with the lock of the shared model held.
+ */
+static void shared_model_dispatch(DnnSharedModel *sm)
+{
+    AVFrame *in_frame, *out_frame;
+
+    while ((sm->dnn_module->get_result)(sm->model, &in_frame, &out_frame) == DAST_SUCCESS) {
+        DnnContext *owner = NULL;
+        DnnResult *result;
+
+        // the tasks of every instance complete in submission order
+        for (int i = 0; i < sm->nb_users; i++) {
+            if (ff_queue_peek_front(sm->users[i]->pending) == in_frame) {
+                owner = sm->users[i];
+                break;
+            }
+        }
+        av_assert0(owner);
+        ff_queue_pop_front(owner->pending);
+
+        result = av_malloc(sizeof(*result));
+        if (!result || ff_queue_push_back(owner->done, result) < 0) {
+            av_log(owner->model->filter_ctx, AV_LOG_ERROR, "Failed to queue the inference result\n");
+            av_free(result);
+            av_frame_free(&in_frame);
+            av_frame_free(&out_frame);
+            continue;
+        }
+        result->in_frame  = in_frame;
+        result->out_frame = out_frame;
+    }
+}
+
+static void shared_model_release(DnnContext *ctx)
+{
+    DnnSharedModel *sm = ctx->shared_model;
+    DnnResult *result;
+
+    // wait for the inferences still referencing the frames and the
+    // callbacks of this instance
+    ff_mutex_lock(&sm->lock);
+    if (ff_queue_size(ctx->pending))
+        (sm->dnn_module->flush)(sm->model);
+    while (1) {
+        shared_model_dispatch(sm);
+        if (!ff_queue_size(ctx->pending))
+            break;
+        ff_mutex_unlock(&sm->lock);
+        av_usleep(5000);
+        ff_mutex_lock(&sm->lock);
+    }
+    ff_mutex_unlock(&sm->lock);
+
+    while ((result = ff_queue_pop_front(ctx->done))) {
+        av_frame_free(&result->in_frame);
+        av_frame_free(&result->out_frame);
+        av_free(result);
+    }
+
+    ff_mutex_lock(&shared_models_lock);
+    ff_mutex_lock(&sm->lock);
+    for (int i = 0; i < sm->nb_users; i++) {
+        if (sm->users[i] == ctx) {
+            sm->users[i] = sm->users[--sm->nb_users];
+            break;
+        }
+    }
+    ff_mutex_unlock(&sm->lock);
+    if (!sm->nb_users) {
+        DnnSharedModel **p = &shared_models;
+        while (*p != sm)
+            p = &(*p)->next;
+        *p = sm->next;
+        ff_mutex_destroy(&sm->lock);
+        free_shared_model(&sm);
+    }
+    ff_mutex_unlock(&shared_models_lock);
+
+    ctx->shared_model = NULL;
+    ctx->dnn_module   = NULL;
+    av_freep(&ctx->model);
+}
+
 int ff_dnn_init(DnnContext *ctx, DNNFunctionType func_type, AVFilterContext *filter_ctx)
 {
     if (!ctx->model_filename) {
@@ -68,6 +290,9 @@ int ff_dnn_init(DnnContext *ctx, DNNFunctionType func_type, AVFilterContext *fil
         return AVERROR(EINVAL);
     }
 
+    if (ctx->shared)
+        return shared_model_acquire(ctx, func_type, filter_ctx);
+
     ctx->dnn_module = ff_get_dnn_module(ctx->backend_type);
     if (!ctx->dnn_module) {
         av_log(filter_ctx, AV_LOG_ERROR, "could not create DNN module for requested backend\n");
@@ -111,10 +336,67 @@ int ff_dnn_get_input(DnnContext *ctx, DNNData *input)
     return ctx->model->get_input(ctx->model->model, input, ctx->model_inputname);
 }
 
+/**
+ * Hardware frames are read through a mapping or a download of their data,
+ * check that it is in a format the pre-processing supports.
+ */
+int ff_dnn_check_hw_frames(AVFilterLink *inlink, const enum AVPixelFormat *sw_formats)
+{
+    AVHWFramesContext *frames_ctx;
+
+    if (!inlink->hw_frames_ctx)
+        return 0;
+
+    frames_ctx = (AVHWFramesContext *)inlink->hw_frames_ctx->data;
+    for (int i = 0; sw_formats[i] != AV_PIX_FMT_NONE; i++) {
+        if (sw_formats[i] == frames_ctx->sw_format)
+            return 0;
+    }
+
+    av_log(inlink->dst, AV_LOG_ERROR, "Unsupported %s frames of format %s\n",
+           av_get_pix_fmt_name(frames_ctx->format),
+           av_get_pix_fmt_name(frames_ctx->sw_format));
+    return AVERROR(ENOSYS);
+}
+
 int ff_dnn_get_output(DnnContext *ctx, int input_width, int input_height, int *output_width, int *output_height)
 {
-    return ctx->model->get_output(ctx->model->model, ctx->model_inputname, input_width, input_height,
-                                    (const char *)ctx->model_outputnames[0], output_width, output_height);
+    DnnSharedModel *sm = ctx->shared_model;
+    int ret;
+
+    if (!sm)
+        return ctx->model->get_output(ctx->model->model, ctx->model_inputname, input_width, input_height,
+                                        (const char *)ctx->model_outputnames[0], output_width, output_height);
+
+    // the backends run a test inference, which must not be batched with
+    // the pending inferences of the other instances
+    ff_mutex_lock(&sm->lock);
+    ret = (sm->dnn_module->flush)(sm->model);
+    if (ret == 0)
+        ret = ctx->model->get_output(ctx->model->model, ctx->model_inputname, input_width, input_height,
+                                       (const char *)ctx->model_outputnames[0], output_width, output_height);
+    ff_mutex_unlock(&sm->lock);
+    return ret;
+}
+
+static int execute_model(DnnContext *ctx, DNNExecBaseParams *exec_params)
+{
+    DnnSharedModel *sm = ctx->shared_model;
+    int ret;
+
+    if (!sm)
+        return (ctx->dnn_module->execute_model)(ctx->model, exec_params);
+
+    ff_mutex_lock(&sm->lock);
+    if (ff_queue_push_back(ctx->pending, exec_params->in_frame) < 0) {
+        ret = AVERROR(ENOMEM);
+    } else {
+        ret = (ctx->dnn_module->execute_model)(ctx->model, exec_params);
+        if (ret != 0)
+            ff_queue_pop_back(ctx->pending);
+    }
+    ff_mutex_unlock(&sm->lock);
+    return ret;
 }
 
 int ff_dnn_execute_model(DnnContext *ctx, AVFrame *in_frame, AVFrame *out_frame)
@@ -126,7 +408,7 @@ int ff_dnn_execute_model(DnnContext *ctx, AVFrame *in_frame, AVFrame *out_frame)
         .in_frame       = in_frame,
         .out_frame      = out_frame,
     };
-    return (ctx->dnn_module->execute_model)(ctx->model, &exec_params);
+    return execute_model(ctx, &exec_params);
 }
 
 int ff_dnn_execute_model_classification(DnnContext *ctx, AVFrame *in_frame, AVFrame *out_frame, const char *target)
@@ -141,21 +423,55 @@ int ff_dnn_execute_model_classification(DnnContext *ctx, AVFrame *in_frame, AVFr
         },
         .target = target,
     };
-    return (ctx->dnn_module->execute_model)(ctx->model, &class_params.base);
+    return execute_model(ctx, &class_params.base);
 }
 
 DNNAsyncStatusType ff_dnn_get_result(DnnContext *ctx, AVFrame **in_frame, AVFrame **out_frame)
 {
-    return (ctx->dnn_module->get_result)(ctx->model, in_frame, out_frame);
+    DnnSharedModel *sm = ctx->shared_model;
+    DNNAsyncStatusType ret = DAST_SUCCESS;
+    DnnResult *result;
+
+    if (!sm)
+        return (ctx->dnn_module->get_result)(ctx->model, in_frame, out_frame);
+
+    ff_mutex_lock(&sm->lock);
+    shared_model_dispatch(sm);
+    result = ff_queue_pop_front(ctx->done);
+    if (!result)
+        ret = ff_queue_size(ctx->pending) ? DAST_NOT_READY : DAST_EMPTY_QUEUE;
+    ff_mutex_unlock(&sm->lock);
+
+    if (result) {
+        *in_frame  = result->in_frame;
+        *out_frame = result->out_frame;
+        av_free(result);
+    }
+    return ret;
 }
 
 int ff_dnn_flush(DnnContext *ctx)
 {
-    return (ctx->dnn_module->flush)(ctx->model);
+    DnnSharedModel *sm = ctx->shared_model;
+    int ret;
+
+    if (!sm)
+        return (ctx->dnn_module->flush)(ctx->model);
+
+    ff_mutex_lock(&sm->lock);
+    ret = (sm->dnn_module->flush)(sm->model);
+    ff_mutex_unlock(&sm->lock);
+    return ret;
 }
 
 void ff_dnn_uninit(DnnContext *ctx)
 {
+    if (ctx->shared_model)
+        shared_model_release(ctx);
+    ff_queue_destroy(ctx->pending);
+    ff_queue_destroy(ctx->done);
+    ctx->pending = ctx->done = NULL;
+
     if (ctx->dnn_module) {
         (ctx->dnn_module->free_model)(&ctx->model);
         av_freep(&ctx->dnn_module);
@@ -25,6 +25,9 @@
 #define AVFILTER_DNN_FILTER_COMMON_H
 
 #include "dnn_interface.h"
+#include "dnn/queue.h"
+
+struct DnnSharedModel;
 
 typedef struct DnnContext {
     char *model_filename;
@@ -33,11 +36,17 @@ typedef struct DnnContext {
     char *model_outputnames_string;
     char *backend_options;
     int async;
+    int shared;
 
     char **model_outputnames;
     uint32_t nb_outputs;
     DNNModule *dnn_module;
     DNNModel *model;
+
+    // only used when the model is shared with other filter instances
+    struct DnnSharedModel *shared_model;
+    Queue *pending;   // input frames submitted to the shared model, in order
+    Queue *done;      // finished inferences of this instance
 } DnnContext;
 
 #define DNN_COMMON_OPTIONS \
@@ -46,7 +55,8 @@ typedef struct DnnContext {
     { "output",             "output name of the model",   OFFSET(model_outputnames_string), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },\
     { "backend_configs",    "backend configs",            OFFSET(backend_options),  AV_OPT_TYPE_STRING,    { .str = NULL }, 0, 0, FLAGS },\
     { "options", "backend configs (deprecated, use backend_configs)", OFFSET(backend_options),  AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS | AV_OPT_FLAG_DEPRECATED},\
-    { "async",              "use DNN async inference (ignored, use backend_configs='async=1')",    OFFSET(async),            AV_OPT_TYPE_BOOL,      { .i64 = 1},     0, 1, FLAGS},
+    { "async",              "use DNN async inference (ignored, use backend_configs='async=1')",    OFFSET(async),            AV_OPT_TYPE_BOOL,      { .i64 = 1},     0, 1, FLAGS},\
+    { "shared",             "share the model with the other filter instances loading it", OFFSET(shared), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS},
 
 
 int ff_dnn_init(DnnContext *ctx, DNNFunctionType func_type, AVFilterContext *filter_ctx);
@@ -54,6 +64,7 @@ int ff_dnn_set_frame_proc(DnnContext *ctx, FramePrePostProc pre_proc, FramePrePo
 int ff_dnn_set_detect_post_proc(DnnContext *ctx, DetectPostProc post_proc);
 int ff_dnn_set_classify_post_proc(DnnContext *ctx, ClassifyPostProc post_proc);
 int ff_dnn_get_input(DnnContext *ctx, DNNData *input);
+int ff_dnn_check_hw_frames(AVFilterLink *inlink, const enum AVPixelFormat *sw_formats);
 int ff_dnn_get_output(DnnContext *ctx, int input_width, int input_height, int *output_width, int *output_height);
 int ff_dnn_execute_model(DnnContext *ctx, AVFrame *in_frame, AVFrame *out_frame);
 int ff_dnn_execute_model_classification(DnnContext *ctx, AVFrame *in_frame, AVFrame *out_frame, const char *target);
@@ -443,18 +443,26 @@ static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
     unsigned xmmod = 7 >> l2depth;
     unsigned mbits = (1 << (1 << l2depth)) - 1;
     unsigned mmult = 255 / mbits;
-    uint16_t value = AV_RL16(dst);
+    uint16_t value;
 
     for (y = 0; y < h; y++) {
         xm = xm0;
-        for (x = 0; x < w; x++) {
-            t += ((mask[xm >> xmshf] >> ((~xm & xmmod) << l2depth)) & mbits)
-                 * mmult;
-            xm++;
+        if (l2depth == 3) {
+            for (x = 0; x < w; x++)
+                t += mask[xm + x];
+        } else {
+            for (x = 0; x < w; x++) {
+                t += ((mask[xm >> xmshf] >> ((~xm & xmmod) << l2depth)) & mbits)
+                     * mmult;
+                xm++;
+            }
         }
         mask += mask_linesize;
     }
     alpha = (t >> shift) * alpha;
+    if (!alpha)
+        return;
+    value = AV_RL16(dst);
     AV_WL16(dst, ((0x10001 - alpha) * value + alpha * src) >> 16);
 }
 
@@ -470,14 +478,22 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
 
     for (y = 0; y < h; y++) {
         xm = xm0;
-        for (x = 0; x < w; x++) {
-            t += ((mask[xm >> xmshf] >> ((~xm & xmmod) << l2depth)) & mbits)
-                 * mmult;
-            xm++;
+        if (l2depth == 3) {
+            for (x = 0; x < w; x++)
+                t += mask[xm + x];
+        } else {
+            for (x = 0; x < w; x++) {
+                t += ((mask[xm >> xmshf] >> ((~xm & xmmod) << l2depth)) & mbits)
+                     * mmult;
+                xm++;
+            }
         }
         mask += mask_linesize;
     }
     alpha = (t >> shift) * alpha;
+    /* a transparent mask leaves the pixel unchanged */
+    if (!alpha)
+        return;
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
@@ -489,6 +505,17 @@ static void blend_line_hv16(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (l2depth == 3 && !hsub && !vsub) {
+        for (x = 0; x < w; x++) {
+            unsigned a = mask[xm + x] * alpha;
+
+            if (a)
+                AV_WL16(dst, ((0x10001 - a) * AV_RL16(dst) + a * src) >> 16);
+            dst += dst_delta;
+        }
+        return;
+    }
+
     if (left) {
         blend_pixel16(dst, src, alpha, mask, mask_linesize, l2depth,
                       left, hband, hsub + vsub, xm);
@@ -514,6 +541,18 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (l2depth == 3 && !hsub && !vsub) {
+        /* one mask byte per pixel: blend directly and skip the empty ones */
+        for (x = 0; x < w; x++) {
+            unsigned a = mask[xm + x] * alpha;
+
+            if (a)
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            dst += dst_delta;
+        }
+        return;
+    }
+
     if (left) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
                     left, hband, hsub + vsub, xm);
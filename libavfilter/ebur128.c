@@ -47,6 +47,9 @@
 #include <limits.h>
 #include <math.h>               /* You may have to define _USE_MATH_DEFINES if you use MSVC */
 
+#include "config.h"
+
+#include "libavutil/attributes.h"
 #include "libavutil/error.h"
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
@@ -80,12 +83,10 @@ struct FFEBUR128StateInternal {
     int *channel_map;
     /** How many samples fit in 100ms (rounded). */
     unsigned long samples_in_100ms;
-    /** BS.1770 filter coefficients (nominator). */
-    double b[5];
-    /** BS.1770 filter coefficients (denominator). */
-    double a[5];
+    /** BS.1770 K-weighting filter. */
+    FFEBUR128DSPContext dsp;
     /** BS.1770 filter state. */
-    double v[5][5];
+    double *filter_state;
     /** Histograms, used to calculate LRA. */
     unsigned long *block_energy_histogram;
     unsigned long *short_term_block_energy_histogram;
@@ -103,54 +104,136 @@ static AVOnce histogram_init = AV_ONCE_INIT;
 static DECLARE_ALIGNED(32, double, histogram_energies)[1000];
 static DECLARE_ALIGNED(32, double, histogram_energy_boundaries)[1001];
 
-static void ebur128_init_filter(FFEBUR128State * st)
+static void filter_channels_c(double *dst, const double *src, ptrdiff_t stride,
+                              int nb_samples, double *state, const double *coeffs,
+                              int nb_lanes)
+{
+    for (int c = 0; c < nb_lanes; c++) {
+        const double pb0 = coeffs[0 * 4], pb1 = coeffs[1 * 4], pb2 = coeffs[2 * 4];
+        const double pa1 = coeffs[3 * 4], pa2 = coeffs[4 * 4];
+        const double rb0 = coeffs[5 * 4], rb1 = coeffs[6 * 4], rb2 = coeffs[7 * 4];
+        const double ra1 = coeffs[8 * 4], ra2 = coeffs[9 * 4];
+        double x1 = state[c + 0 * 4], x2 = state[c + 1 * 4];
+        double y1 = state[c + 2 * 4], y2 = state[c + 3 * 4];
+        double z1 = state[c + 4 * 4], z2 = state[c + 5 * 4];
+
+        for (int i = 0; i < nb_samples; i++) {
+            const double x0 = src[i * stride + c];
+            const double y0 = x0 * pb0 + x1 * pb1 + x2 * pb2 - y1 * pa1 - y2 * pa2;
+            const double z0 = y0 * rb0 + y1 * rb1 + y2 * rb2 - z1 * ra1 - z2 * ra2;
+
+            dst[i * stride + c] = z0;
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y0;
+            z2 = z1;
+            z1 = z0;
+        }
+
+        state[c + 0 * 4] = x1;
+        state[c + 1 * 4] = x2;
+        state[c + 2 * 4] = y1;
+        state[c + 3 * 4] = y2;
+        state[c + 4 * 4] = z1;
+        state[c + 5 * 4] = z2;
+    }
+}
+
+static void filter_channels4_c(double *dst, const double *src, ptrdiff_t stride,
+                               int nb_samples, double *state, const double *coeffs)
+{
+    filter_channels_c(dst, src, stride, nb_samples, state, coeffs, 4);
+}
+
+static void find_peaks_c(double *peaks, const double *src, ptrdiff_t stride,
+                         int nb_samples, int nb_lanes)
 {
-    int i, j;
+    for (int c = 0; c < nb_lanes; c++) {
+        double peak = peaks[c];
 
+        for (int i = 0; i < nb_samples; i++)
+            peak = FFMAX(peak, fabs(src[i * stride + c]));
+        peaks[c] = peak;
+    }
+}
+
+static void find_peaks4_c(double *peaks, const double *src, ptrdiff_t stride,
+                          int nb_samples)
+{
+    find_peaks_c(peaks, src, stride, nb_samples, 4);
+}
+
+av_cold void ff_ebur128_dsp_init(FFEBUR128DSPContext *dsp, unsigned long samplerate)
+{
+    /* Unofficial reversed parametrization of PRE
+     * and RLB from 48kHz */
     double f0 = 1681.974450955533;
     double G = 3.999843853973347;
     double Q = 0.7071752369554196;
 
-    double K = tan(M_PI * f0 / (double) st->samplerate);
+    double K = tan(M_PI * f0 / (double) samplerate);
     double Vh = pow(10.0, G / 20.0);
     double Vb = pow(Vh, 0.4996667741545416);
 
-    double pb[3] = { 0.0, 0.0, 0.0 };
-    double pa[3] = { 1.0, 0.0, 0.0 };
-    double rb[3] = { 1.0, -2.0, 1.0 };
-    double ra[3] = { 1.0, 0.0, 0.0 };
-
     double a0 = 1.0 + K / Q + K * K;
-    pb[0] = (Vh + Vb * K / Q + K * K) / a0;
-    pb[1] = 2.0 * (K * K - Vh) / a0;
-    pb[2] = (Vh - Vb * K / Q + K * K) / a0;
-    pa[1] = 2.0 * (K * K - 1.0) / a0;
-    pa[2] = (1.0 - K / Q + K * K) / a0;
+    double coeffs[10];
+
+    coeffs[0] = (Vh + Vb * K / Q + K * K) / a0;
+    coeffs[1] = 2.0 * (K * K - Vh) / a0;
+    coeffs[2] = (Vh - Vb * K / Q + K * K) / a0;
+    coeffs[3] = 2.0 * (K * K - 1.0) / a0;
+    coeffs[4] = (1.0 - K / Q + K * K) / a0;
 
     f0 = 38.13547087602444;
     Q = 0.5003270373238773;
-    K = tan(M_PI * f0 / (double) st->samplerate);
-
-    ra[1] = 2.0 * (K * K - 1.0) / (1.0 + K / Q + K * K);
-    ra[2] = (1.0 - K / Q + K * K) / (1.0 + K / Q + K * K);
-
-    st->d->b[0] = pb[0] * rb[0];
-    st->d->b[1] = pb[0] * rb[1] + pb[1] * rb[0];
-    st->d->b[2] = pb[0] * rb[2] + pb[1] * rb[1] + pb[2] * rb[0];
-    st->d->b[3] = pb[1] * rb[2] + pb[2] * rb[1];
-    st->d->b[4] = pb[2] * rb[2];
-
-    st->d->a[0] = pa[0] * ra[0];
-    st->d->a[1] = pa[0] * ra[1] + pa[1] * ra[0];
-    st->d->a[2] = pa[0] * ra[2] + pa[1] * ra[1] + pa[2] * ra[0];
-    st->d->a[3] = pa[1] * ra[2] + pa[2] * ra[1];
-    st->d->a[4] = pa[2] * ra[2];
-
-    for (i = 0; i < 5; ++i) {
-        for (j = 0; j < 5; ++j) {
-            st->d->v[i][j] = 0.0;
-        }
-    }
+    K = tan(M_PI * f0 / (double) samplerate);
+
+    coeffs[5] = 1.0;
+    coeffs[6] = -2.0;
+    coeffs[7] = 1.0;
+    coeffs[8] = 2.0 * (K * K - 1.0) / (1.0 + K / Q + K * K);
+    coeffs[9] = (1.0 - K / Q + K * K) / (1.0 + K / Q + K * K);
+
+    for (int i = 0; i < 10; i++)
+        for (int j = 0; j < 4; j++)
+            dsp->coeffs[i][j] = coeffs[i];
+
+    dsp->filter_channels4 = filter_channels4_c;
+    dsp->find_peaks4      = find_peaks4_c;
+
+#if ARCH_X86
+    ff_ebur128_dsp_init_x86(dsp);
+#endif
+}
+
+void ff_ebur128_filter_channels(const FFEBUR128DSPContext *dsp, double *dst,
+                                const double *src, int channels,
+                                int nb_samples, double *state)
+{
+    int c;
+
+    if (nb_samples <= 0)
+        return;
+    for (c = 0; c + 4 <= channels; c += 4)
+        dsp->filter_channels4(dst + c, src + c, channels, nb_samples,
+                              state + c * 6, dsp->coeffs[0]);
+    if (c < channels)
+        filter_channels_c(dst + c, src + c, channels, nb_samples,
+                          state + c * 6, dsp->coeffs[0], channels - c);
+}
+
+void ff_ebur128_find_peaks(const FFEBUR128DSPContext *dsp, double *peaks,
+                           const double *src, int channels, int nb_samples)
+{
+    int c;
+
+    if (nb_samples <= 0)
+        return;
+    for (c = 0; c + 4 <= channels; c += 4)
+        dsp->find_peaks4(peaks + c, src + c, channels, nb_samples);
+    if (c < channels)
+        find_peaks_c(peaks + c, src + c, channels, nb_samples, channels - c);
 }
 
 static int ebur128_init_channel_map(FFEBUR128State * st)
@@ -258,11 +341,15 @@ FFEBUR128State *ff_ebur128_init(unsigned int channels,
                              st->channels * sizeof(*st->d->audio_data));
     CHECK_ERROR(!st->d->audio_data, 0, free_sample_peak)
 
-    ebur128_init_filter(st);
+    st->d->filter_state =
+        av_calloc(FF_EBUR128_STATE_SIZE(st->channels), sizeof(*st->d->filter_state));
+    CHECK_ERROR(!st->d->filter_state, 0, free_audio_data)
+
+    ff_ebur128_dsp_init(&st->d->dsp, st->samplerate);
 
     st->d->block_energy_histogram =
         av_mallocz(1000 * sizeof(*st->d->block_energy_histogram));
-    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_audio_data)
+    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_filter_state)
     st->d->short_term_block_energy_histogram =
         av_mallocz(1000 * sizeof(*st->d->short_term_block_energy_histogram));
     CHECK_ERROR(!st->d->short_term_block_energy_histogram, 0,
@@ -287,6 +374,8 @@ free_short_term_block_energy_histogram:
     av_free(st->d->short_term_block_energy_histogram);
 free_block_energy_histogram:
     av_free(st->d->block_energy_histogram);
+free_filter_state:
+    av_free(st->d->filter_state);
 free_audio_data:
     av_free(st->d->audio_data);
 free_sample_peak:
@@ -306,6 +395,7 @@ void ff_ebur128_destroy(FFEBUR128State ** st)
     av_free((*st)->d->block_energy_histogram);
     av_free((*st)->d->short_term_block_energy_histogram);
     av_free((*st)->d->audio_data);
+    av_free((*st)->d->filter_state);
     av_free((*st)->d->channel_map);
     av_free((*st)->d->sample_peak);
     av_free((*st)->d->data_ptrs);
@@ -314,56 +404,24 @@ void ff_ebur128_destroy(FFEBUR128State ** st)
     *st = NULL;
 }
 
-#define EBUR128_FILTER(type, scaling_factor)                                       \
-static void ebur128_filter_##type(FFEBUR128State* st, const type** srcs,           \
-                                  size_t src_index, size_t frames,                 \
-                                  int stride) {                                    \
-    double* audio_data = st->d->audio_data + st->d->audio_data_index;              \
-    size_t i, c;                                                                   \
-                                                                                   \
-    if ((st->mode & FF_EBUR128_MODE_SAMPLE_PEAK) == FF_EBUR128_MODE_SAMPLE_PEAK) { \
-        for (c = 0; c < st->channels; ++c) {                                       \
-            double max = 0.0;                                                      \
-            for (i = 0; i < frames; ++i) {                                         \
-                type v = srcs[c][src_index + i * stride];                          \
-                if (v > max) {                                                     \
-                    max =        v;                                                \
-                } else if (-v > max) {                                             \
-                    max = -1.0 * v;                                                \
-                }                                                                  \
-            }                                                                      \
-            max /= scaling_factor;                                                 \
-            if (max > st->d->sample_peak[c]) st->d->sample_peak[c] = max;          \
-        }                                                                          \
-    }                                                                              \
-    for (c = 0; c < st->channels; ++c) {                                           \
-        int ci = st->d->channel_map[c] - 1;                                        \
-        if (ci < 0) continue;                                                      \
-        else if (ci == FF_EBUR128_DUAL_MONO - 1) ci = 0; /*dual mono */            \
-        for (i = 0; i < frames; ++i) {                                             \
-            st->d->v[ci][0] = (double) (srcs[c][src_index + i * stride] / scaling_factor) \
-                         - st->d->a[1] * st->d->v[ci][1]                           \
-                         - st->d->a[2] * st->d->v[ci][2]                           \
-                         - st->d->a[3] * st->d->v[ci][3]                           \
-                         - st->d->a[4] * st->d->v[ci][4];                          \
-            audio_data[i * st->channels + c] =                                     \
-                           st->d->b[0] * st->d->v[ci][0]                           \
-                         + st->d->b[1] * st->d->v[ci][1]                           \
-                         + st->d->b[2] * st->d->v[ci][2]                           \
-                         + st->d->b[3] * st->d->v[ci][3]                           \
-                         + st->d->b[4] * st->d->v[ci][4];                          \
-            st->d->v[ci][4] = st->d->v[ci][3];                                     \
-            st->d->v[ci][3] = st->d->v[ci][2];                                     \
-            st->d->v[ci][2] = st->d->v[ci][1];                                     \
-            st->d->v[ci][1] = st->d->v[ci][0];                                     \
-        }                                                                          \
-        st->d->v[ci][4] = fabs(st->d->v[ci][4]) < DBL_MIN ? 0.0 : st->d->v[ci][4]; \
-        st->d->v[ci][3] = fabs(st->d->v[ci][3]) < DBL_MIN ? 0.0 : st->d->v[ci][3]; \
-        st->d->v[ci][2] = fabs(st->d->v[ci][2]) < DBL_MIN ? 0.0 : st->d->v[ci][2]; \
-        st->d->v[ci][1] = fabs(st->d->v[ci][1]) < DBL_MIN ? 0.0 : st->d->v[ci][1]; \
-    }                                                                              \
+static void ebur128_filter_double(FFEBUR128State* st, const double** srcs,
+                                  size_t src_index, size_t frames,
+                                  int stride) {
+    /* the samples are interleaved, srcs[c] points to srcs[0] + c */
+    const double *src = srcs[0] + src_index;
+    double* audio_data = st->d->audio_data + st->d->audio_data_index;
+    double *state = st->d->filter_state;
+    int i;
+
+    if ((st->mode & FF_EBUR128_MODE_SAMPLE_PEAK) == FF_EBUR128_MODE_SAMPLE_PEAK)
+        ff_ebur128_find_peaks(&st->d->dsp, st->d->sample_peak, src,
+                              st->channels, frames);
+
+    ff_ebur128_filter_channels(&st->d->dsp, audio_data, src,
+                               st->channels, frames, state);
+    for (i = 0; i < FF_EBUR128_STATE_SIZE(st->channels); i++)
+        state[i] = fabs(state[i]) < DBL_MIN ? 0.0 : state[i];
 }
-EBUR128_FILTER(double, 1.0)
 
 static double ebur128_energy_to_loudness(double energy)
 {
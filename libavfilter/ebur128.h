@@ -32,6 +32,9 @@
 
 #include <stddef.h>             /* for size_t */
 
+#include "libavutil/macros.h"
+#include "libavutil/mem_internal.h"
+
 /** \enum channel
  *  Use these values when setting the channel map with ebur128_set_channel().
  *  See definitions in ITU R-REC-BS 1770-4
@@ -226,4 +229,59 @@ int ff_ebur128_sample_peak(FFEBUR128State * st,
  */
 int ff_ebur128_relative_threshold(FFEBUR128State * st, double *out);
 
+/**
+ * Number of doubles of K-weighting filter state for the given number of
+ * channels: x[n-1], x[n-2], y[n-1], y[n-2], z[n-1], z[n-2] of each channel,
+ * stored for groups of 4 channels.
+ */
+#define FF_EBUR128_STATE_SIZE(channels) (FFALIGN(channels, 4) * 6)
+
+/**
+ * Measurement core shared by the ebur128 and loudnorm filters.
+ *
+ * The K-weighting of BS.1770 is run as the pre-filter biquad followed by the
+ * RLB-filter biquad, on groups of 4 interleaved channels at a time.
+ */
+typedef struct FFEBUR128DSPContext {
+    /**
+     * b0, b1, b2, a1, a2 of the pre-filter, then of the RLB-filter, each
+     * repeated for the 4 channels of a group.
+     */
+    DECLARE_ALIGNED(32, double, coeffs)[10][4];
+
+    /**
+     * K-weight 4 adjacent channels of interleaved samples.
+     *
+     * @param dst    filtered samples, with the same layout as src
+     * @param stride distance between two samples of a channel, in doubles
+     * @param state  the 24 doubles of filter state of the group
+     */
+    void (*filter_channels4)(double *dst, const double *src, ptrdiff_t stride,
+                             int nb_samples, double *state, const double *coeffs);
+
+    /**
+     * Update the absolute peaks of 4 adjacent channels of interleaved samples.
+     */
+    void (*find_peaks4)(double *peaks, const double *src, ptrdiff_t stride,
+                        int nb_samples);
+} FFEBUR128DSPContext;
+
+void ff_ebur128_dsp_init(FFEBUR128DSPContext *dsp, unsigned long samplerate);
+void ff_ebur128_dsp_init_x86(FFEBUR128DSPContext *dsp);
+
+/**
+ * K-weight interleaved samples.
+ *
+ * @param state filter state, FF_EBUR128_STATE_SIZE(channels) doubles
+ */
+void ff_ebur128_filter_channels(const FFEBUR128DSPContext *dsp, double *dst,
+                                const double *src, int channels,
+                                int nb_samples, double *state);
+
+/**
+ * Update the per channel absolute peaks of interleaved samples.
+ */
+void ff_ebur128_find_peaks(const FFEBUR128DSPContext *dsp, double *peaks,
+                           const double *src, int channels, int nb_samples);
+
 #endif                          /* AVFILTER_EBUR128_H */
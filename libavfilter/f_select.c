@@ -275,6 +275,15 @@ static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
     double ret = 0;
     SelectContext *select = ctx->priv;
     AVFrame *prev_picref = select->prev_picref;
+    AVDictionaryEntry *e = av_dict_get(frame->metadata, "lavfi.scd.score", NULL, 0);
+
+    /* Reuse the score of an upstream scdet filter instead of computing the
+     * difference again. scdet measures the MAFD in percent of the full range,
+     * select in 1/256 of it, then divides the score by 100. */
+    if (e) {
+        av_frame_free(&select->prev_picref);
+        return av_clipf(av_strtod(e->value, NULL) * 2.56 / 100., 0, 1);
+    }
 
     if (prev_picref &&
         frame->height == prev_picref->height &&
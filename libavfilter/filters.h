@@ -129,6 +129,12 @@ AVFrame *ff_inlink_peek_frame(AVFilterLink *link, size_t idx);
  */
 int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe);
 
+/**
+ * Account a copy of the data of frame made by the filter in its profile,
+ * see AVFilterProfile.nb_frame_copies.
+ */
+void ff_filter_account_frame_copy(AVFilterContext *ctx, const AVFrame *frame);
+
 /**
  * Test and acknowledge the change of status on the link.
  *
@@ -49,6 +49,7 @@ struct FFFramePool {
 };
 
 FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
+                                      AVBufferCache *cache,
                                       int width,
                                       int height,
                                       enum AVPixelFormat format,
@@ -99,7 +100,8 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
     for (i = 0; i < 4 && sizes[i]; i++) {
         if (sizes[i] > SIZE_MAX - align)
             goto fail;
-        pool->pools[i] = av_buffer_pool_init(sizes[i] + align, alloc);
+        pool->pools[i] = cache ? av_buffer_pool_init_cache(sizes[i] + align, cache) :
+                                 av_buffer_pool_init(sizes[i] + align, alloc);
         if (!pool->pools[i])
             goto fail;
     }
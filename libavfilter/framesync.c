@@ -288,6 +288,8 @@ int ff_framesync_get_frame(FFFrameSync *fs, unsigned in, AVFrame **rframe,
         if (need_copy) {
             if (!(frame = av_frame_clone(frame)))
                 return AVERROR(ENOMEM);
+            if (!av_frame_is_writable(frame))
+                ff_filter_account_frame_copy(fs->parent, frame);
             if ((ret = av_frame_make_writable(frame)) < 0) {
                 av_frame_free(&frame);
                 return ret;
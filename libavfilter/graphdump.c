@@ -24,6 +24,10 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/bprint.h"
 #include "libavutil/pixdesc.h"
+
+#define FF_INTERNAL_FIELDS 1
+#include "framequeue.h"
+
 #include "avfilter.h"
 #include "internal.h"
 
@@ -168,3 +172,54 @@ char *avfilter_graph_dump(AVFilterGraph *graph, const char *options)
     avfilter_graph_dump_to_buf(&buf, graph);
     return dump;
 }
+
+static void profile_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
+{
+    int64_t total = 0;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++)
+        total += avfilter_get_profile(graph->filters[i])->wall_time;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+        const AVFilterProfile *p = avfilter_get_profile(filter);
+
+        av_bprintf(buf, "%s (%s): %"PRId64" activations, wall %.3f ms (%.1f%%), cpu %.3f ms\n",
+                   filter->name, filter->filter->name, p->nb_activations,
+                   p->wall_time / 1000.0, total ? 100.0 * p->wall_time / total : 0.0,
+                   p->cpu_time / 1000.0);
+        if (p->nb_frame_copies)
+            av_bprintf(buf, "    %"PRId64" frames copied, %"PRId64" bytes\n",
+                       p->nb_frame_copies, p->frame_copy_bytes);
+        for (unsigned j = 0; j < filter->nb_inputs; j++) {
+            AVFilterLink *l = filter->inputs[j];
+            if (!l)
+                continue;
+            av_bprintf(buf, "    in  %s <- %s:%s: %"PRId64" frames, %"SIZE_SPECIFIER" queued (peak %"SIZE_SPECIFIER")\n",
+                       l->dstpad->name, l->src->name, l->srcpad->name, l->frame_count_out,
+                       ff_framequeue_queued_frames(&l->fifo), l->max_queued);
+        }
+        for (unsigned j = 0; j < filter->nb_outputs; j++) {
+            AVFilterLink *l = filter->outputs[j];
+            if (!l)
+                continue;
+            av_bprintf(buf, "    out %s -> %s:%s: %"PRId64" frames\n",
+                       l->srcpad->name, l->dst->name, l->dstpad->name, l->frame_count_in);
+        }
+    }
+}
+
+char *avfilter_graph_dump_profile(AVFilterGraph *graph, const char *options)
+{
+    AVBPrint buf;
+    char *dump = NULL;
+
+    av_bprint_init(&buf, 0, AV_BPRINT_SIZE_COUNT_ONLY);
+    profile_dump_to_buf(&buf, graph);
+    dump = av_malloc(buf.len + 1);
+    if (!dump)
+        return NULL;
+    av_bprint_init_for_buffer(&buf, dump, buf.len + 1);
+    profile_dump_to_buf(&buf, graph);
+    return dump;
+}
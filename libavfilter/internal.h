@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framequeue.h"
@@ -133,10 +134,20 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /* filters activated concurrently by the pipeline scheduler */
+    AVFilterContext **pipeline_filters;
+    int *pipeline_rets;
+    unsigned pipeline_size;
+    unsigned pipeline_round;
+    AVMutex heap_lock;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+    struct FrameThreadContext *frame_thread;
+    unsigned pipeline_claim;   ///< last pipeline round using this filter
+    AVFilterProfile profile;
 };
 
 static av_always_inline int ff_filter_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -82,6 +82,7 @@ typedef struct ThreadData {
     AVFrame *in, *out;
 } ThreadData;
 
+void ff_lut3d_init(LUT3DContext *s, const AVPixFmtDescriptor *desc);
 void ff_lut3d_init_x86(LUT3DContext *s, const AVPixFmtDescriptor *desc);
 
 #endif /* AVFILTER_LUT3D_H */
@@ -17,11 +17,15 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "libavutil/avstring.h"
 #include "libavutil/file_open.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/random_seed.h"
+#include "libavutil/sha.h"
 
 #include "formats.h"
 #include "opencl.h"
@@ -154,18 +158,184 @@ void ff_opencl_filter_uninit(AVFilterContext *avctx)
     av_buffer_unref(&ctx->device_ref);
 }
 
+static void opencl_cache_hash_info(struct AVSHA *sha, cl_device_id device,
+                                   cl_device_info param)
+{
+    char buf[1024];
+    size_t size;
+
+    if (clGetDeviceInfo(device, param, sizeof(buf), buf, &size) != CL_SUCCESS)
+        size = 0;
+    av_sha_update(sha, (const uint8_t *)&size, sizeof(size));
+    av_sha_update(sha, (const uint8_t *)buf, FFMIN(size, sizeof(buf)));
+}
+
+/**
+ * Build the path of the program cache entry for the given sources on the
+ * current device, or return NULL if the program cache is disabled.
+ *
+ * The cache directory is taken from the AV_OPENCL_PROGRAM_CACHE environment
+ * variable; entries are keyed by a hash of the device, driver and sources.
+ */
+static char *opencl_program_cache_path(AVFilterContext *avctx,
+                                       const char **program_source_array,
+                                       int nb_strings)
+{
+    OpenCLFilterContext *ctx = avctx->priv;
+    const char *dir = getenv("AV_OPENCL_PROGRAM_CACHE");
+    struct AVSHA *sha;
+    uint8_t digest[32];
+    char hex[2 * sizeof(digest) + 1];
+    int i;
+
+    if (!dir || !*dir)
+        return NULL;
+
+    sha = av_sha_alloc();
+    if (!sha)
+        return NULL;
+    av_sha_init(sha, 256);
+
+    opencl_cache_hash_info(sha, ctx->hwctx->device_id, CL_DEVICE_NAME);
+    opencl_cache_hash_info(sha, ctx->hwctx->device_id, CL_DEVICE_VERSION);
+    opencl_cache_hash_info(sha, ctx->hwctx->device_id, CL_DRIVER_VERSION);
+    for (i = 0; i < nb_strings; i++) {
+        size_t len = strlen(program_source_array[i]);
+        av_sha_update(sha, (const uint8_t *)&len, sizeof(len));
+        av_sha_update(sha, (const uint8_t *)program_source_array[i], len);
+    }
+    av_sha_final(sha, digest);
+    av_free(sha);
+
+    for (i = 0; i < sizeof(digest); i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+
+    return av_asprintf("%s/%s.clbin", dir, hex);
+}
+
+static int opencl_program_cache_load(AVFilterContext *avctx, const char *path)
+{
+    OpenCLFilterContext *ctx = avctx->priv;
+    const unsigned char *binary;
+    unsigned char *data = NULL;
+    cl_int cle, status;
+    size_t size;
+    long len;
+    FILE *file;
+    int err = AVERROR(EIO);
+
+    file = avpriv_fopen_utf8(path, "rb");
+    if (!file)
+        return AVERROR(ENOENT);
+
+    if (fseek(file, 0, SEEK_END) < 0 || (len = ftell(file)) <= 0 ||
+        fseek(file, 0, SEEK_SET) < 0)
+        goto fail;
+    size = len;
+    data = av_malloc(size);
+    if (!data) {
+        err = AVERROR(ENOMEM);
+        goto fail;
+    }
+    if (fread(data, 1, size, file) != size)
+        goto fail;
+
+    binary = data;
+    ctx->program = clCreateProgramWithBinary(ctx->hwctx->context, 1,
+                                             &ctx->hwctx->device_id,
+                                             &size, &binary, &status, &cle);
+    if (!ctx->program || status != CL_SUCCESS)
+        goto fail;
+
+    cle = clBuildProgram(ctx->program, 1, &ctx->hwctx->device_id,
+                         NULL, NULL, NULL);
+    if (cle != CL_SUCCESS)
+        goto fail;
+
+    av_log(avctx, AV_LOG_VERBOSE, "Loaded program from cache %s.\n", path);
+    err = 0;
+fail:
+    if (err < 0 && ctx->program) {
+        clReleaseProgram(ctx->program);
+        ctx->program = NULL;
+    }
+    if (err == AVERROR(EIO))
+        av_log(avctx, AV_LOG_WARNING, "Ignoring unusable program cache "
+               "entry %s.\n", path);
+    av_free(data);
+    fclose(file);
+    return err;
+}
+
+static void opencl_program_cache_store(AVFilterContext *avctx, const char *path)
+{
+    OpenCLFilterContext *ctx = avctx->priv;
+    unsigned char *data = NULL;
+    char *tmp_path;
+    size_t size;
+    FILE *file;
+    cl_int cle;
+
+    cle = clGetProgramInfo(ctx->program, CL_PROGRAM_BINARY_SIZES,
+                           sizeof(size), &size, NULL);
+    if (cle != CL_SUCCESS || !size)
+        return;
+
+    tmp_path = av_asprintf("%s.%08"PRIx32, path, av_get_random_seed());
+    data     = av_malloc(size);
+    if (!tmp_path || !data)
+        goto end;
+
+    cle = clGetProgramInfo(ctx->program, CL_PROGRAM_BINARIES,
+                           sizeof(data), &data, NULL);
+    if (cle != CL_SUCCESS)
+        goto end;
+
+    /* Write to a temporary file and rename it, so that concurrent
+     * processes never see a partially written entry. */
+    file = avpriv_fopen_utf8(tmp_path, "wb");
+    if (!file) {
+        av_log(avctx, AV_LOG_WARNING, "Unable to create program cache "
+               "entry %s.\n", tmp_path);
+        goto end;
+    }
+    if (fwrite(data, 1, size, file) != size) {
+        fclose(file);
+        remove(tmp_path);
+        goto end;
+    }
+    fclose(file);
+    if (rename(tmp_path, path) < 0)
+        remove(tmp_path);
+    else
+        av_log(avctx, AV_LOG_VERBOSE, "Stored program in cache %s.\n", path);
+
+end:
+    av_free(tmp_path);
+    av_free(data);
+}
+
 int ff_opencl_filter_load_program(AVFilterContext *avctx,
                                   const char **program_source_array,
                                   int nb_strings)
 {
     OpenCLFilterContext *ctx = avctx->priv;
+    char *cache_path;
     cl_int cle;
 
+    cache_path = opencl_program_cache_path(avctx, program_source_array,
+                                           nb_strings);
+    if (cache_path && opencl_program_cache_load(avctx, cache_path) >= 0) {
+        av_free(cache_path);
+        return 0;
+    }
+
     ctx->program = clCreateProgramWithSource(ctx->hwctx->context, nb_strings,
                                              program_source_array,
                                              NULL, &cle);
     if (!ctx->program) {
         av_log(avctx, AV_LOG_ERROR, "Failed to create program: %d.\n", cle);
+        av_free(cache_path);
         return AVERROR(EIO);
     }
 
@@ -196,9 +366,14 @@ int ff_opencl_filter_load_program(AVFilterContext *avctx,
 
         clReleaseProgram(ctx->program);
         ctx->program = NULL;
+        av_free(cache_path);
         return AVERROR(EIO);
     }
 
+    if (cache_path)
+        opencl_program_cache_store(avctx, cache_path);
+    av_free(cache_path);
+
     return 0;
 }
 
@@ -27,6 +27,7 @@
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -41,6 +42,13 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* the filters of a pipeline round may execute slices concurrently */
+    pthread_mutex_t execute_lock;
+
+    AVSliceThread *pipeline;
+    AVFilterContext **pipeline_filters;
+    int *pipeline_rets;
 } ThreadContext;
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
@@ -51,9 +59,17 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
+static void pipeline_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ThreadContext *c = priv;
+    c->pipeline_rets[jobnr] = ff_filter_activate(c->pipeline_filters[jobnr]);
+}
+
 static void slice_thread_uninit(ThreadContext *c)
 {
+    avpriv_slicethread_free(&c->pipeline);
     avpriv_slicethread_free(&c->thread);
+    pthread_mutex_destroy(&c->execute_lock);
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -63,18 +79,21 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    pthread_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    pthread_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
-    nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
+    nb_threads = avpriv_slicethread_create_pool(&c->thread, c->graph->thread_pool,
+                                                c, worker_func, NULL, nb_threads);
     if (nb_threads <= 1)
         avpriv_slicethread_free(&c->thread);
     return FFMAX(nb_threads, 1);
@@ -82,6 +101,7 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
 
 int ff_graph_thread_init(AVFilterGraph *graph)
 {
+    ThreadContext *c;
     int ret;
 
     if (graph->nb_threads == 1) {
@@ -89,12 +109,19 @@ int ff_graph_thread_init(AVFilterGraph *graph)
         return 0;
     }
 
-    graph->internal->thread = av_mallocz(sizeof(ThreadContext));
-    if (!graph->internal->thread)
+    graph->internal->thread = c = av_mallocz(sizeof(ThreadContext));
+    if (!c)
         return AVERROR(ENOMEM);
+    c->graph = graph;
+
+    if ((ret = pthread_mutex_init(&c->execute_lock, NULL))) {
+        av_freep(&graph->internal->thread);
+        return AVERROR(ret);
+    }
 
-    ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+    ret = thread_init_internal(c, graph->nb_threads);
     if (ret <= 1) {
+        pthread_mutex_destroy(&c->execute_lock);
         av_freep(&graph->internal->thread);
         graph->thread_type = 0;
         graph->nb_threads  = 1;
@@ -107,6 +134,30 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     return 0;
 }
 
+int ff_graph_pipeline_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                              int *rets, int nb_filters)
+{
+    ThreadContext *c = graph->internal->thread;
+
+    if (!c)
+        return AVERROR(ENOSYS);
+
+    if (!c->pipeline) {
+        int ret = avpriv_slicethread_create(&c->pipeline, c, pipeline_worker_func,
+                                            NULL, graph->nb_threads);
+        if (ret <= 1) {
+            avpriv_slicethread_free(&c->pipeline);
+            return ret < 0 ? ret : AVERROR(ENOSYS);
+        }
+    }
+
+    c->pipeline_filters = filters;
+    c->pipeline_rets    = rets;
+    avpriv_slicethread_execute(c->pipeline, nb_filters, 0);
+
+    return 0;
+}
+
 void ff_graph_thread_free(AVFilterGraph *graph)
 {
     if (graph->internal->thread)
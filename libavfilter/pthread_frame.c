@@ -0,0 +1,340 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Libavfilter frame multithreading support
+ *
+ * Every worker thread owns one job slot. The input frames are given to the
+ * slots in a round-robin order, and the worker of a slot runs the
+ * filter_frame() callback of the input pad on it. The frames sent by the
+ * callback with ff_filter_frame() are kept in the slot, and passed to the
+ * output links by the filter graph thread in the order of the input frames.
+ */
+
+#include "libavutil/avassert.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "avfilter.h"
+#include "internal.h"
+#include "thread.h"
+#include "video.h"
+
+#define MAX_FRAME_THREADS 16
+
+enum JobState {
+    JOB_IDLE,    ///< no frame, or its output was forwarded
+    JOB_QUEUED,  ///< waiting for the worker
+    JOB_DONE,    ///< filtered, its output waiting to be forwarded
+};
+
+typedef struct FrameThreadOutput {
+    AVFilterLink *link;
+    AVFrame *frame;
+} FrameThreadOutput;
+
+typedef struct FrameThreadWorker {
+    struct FrameThreadContext *c;
+    pthread_t thread;
+    enum JobState state;
+
+    AVFilterLink *link;
+    AVFrame *frame;
+    int (*filter_frame)(AVFilterLink *link, AVFrame *frame);
+    int ret;
+
+    FrameThreadOutput *outputs;
+    unsigned nb_outputs;
+    unsigned outputs_size;
+} FrameThreadWorker;
+
+typedef struct FrameThreadContext {
+    AVFilterContext *ctx;
+    FrameThreadWorker *workers;
+    int nb_workers;
+    int nb_started;
+
+    /* only accessed by the filter graph thread */
+    unsigned next_submit;
+    unsigned next_output;
+    int pools_ready;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  job_cond;
+    pthread_cond_t  done_cond;
+    int exit;
+} FrameThreadContext;
+
+static void *worker_thread(void *arg)
+{
+    FrameThreadWorker *w = arg;
+    FrameThreadContext *c = w->c;
+
+    pthread_mutex_lock(&c->lock);
+    while (1) {
+        int ret;
+
+        while (!c->exit && w->state != JOB_QUEUED)
+            pthread_cond_wait(&c->job_cond, &c->lock);
+        if (c->exit)
+            break;
+        pthread_mutex_unlock(&c->lock);
+
+        ret = w->filter_frame(w->link, w->frame);
+        w->frame = NULL;
+
+        pthread_mutex_lock(&c->lock);
+        w->ret   = ret;
+        w->state = JOB_DONE;
+        pthread_cond_broadcast(&c->done_cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
+static void free_outputs(FrameThreadWorker *w)
+{
+    for (unsigned i = 0; i < w->nb_outputs; i++)
+        av_frame_free(&w->outputs[i].frame);
+    w->nb_outputs = 0;
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+    FrameThreadContext *c = ctx->internal->frame_thread;
+
+    if (!c)
+        return;
+
+    pthread_mutex_lock(&c->lock);
+    c->exit = 1;
+    pthread_cond_broadcast(&c->job_cond);
+    pthread_mutex_unlock(&c->lock);
+
+    for (int i = 0; i < c->nb_started; i++)
+        pthread_join(c->workers[i].thread, NULL);
+
+    for (int i = 0; i < c->nb_workers; i++) {
+        FrameThreadWorker *w = &c->workers[i];
+        av_frame_free(&w->frame);
+        free_outputs(w);
+        av_freep(&w->outputs);
+    }
+    av_freep(&c->workers);
+
+    pthread_cond_destroy(&c->done_cond);
+    pthread_cond_destroy(&c->job_cond);
+    pthread_mutex_destroy(&c->lock);
+    av_freep(&ctx->internal->frame_thread);
+}
+
+int ff_filter_frame_thread_init(AVFilterContext *ctx, int nb_threads)
+{
+    FrameThreadContext *c;
+    int ret;
+
+    nb_threads = FFMIN(nb_threads, MAX_FRAME_THREADS);
+    if (nb_threads <= 1)
+        return AVERROR(ENOSYS);
+
+    ctx->internal->frame_thread = c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->ctx = ctx;
+
+    if ((ret = pthread_mutex_init(&c->lock, NULL))) {
+        av_freep(&ctx->internal->frame_thread);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->job_cond, NULL))) {
+        pthread_mutex_destroy(&c->lock);
+        av_freep(&ctx->internal->frame_thread);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->done_cond, NULL))) {
+        pthread_cond_destroy(&c->job_cond);
+        pthread_mutex_destroy(&c->lock);
+        av_freep(&ctx->internal->frame_thread);
+        return AVERROR(ret);
+    }
+
+    c->workers = av_calloc(nb_threads, sizeof(*c->workers));
+    if (!c->workers) {
+        ff_filter_frame_thread_free(ctx);
+        return AVERROR(ENOMEM);
+    }
+    c->nb_workers = nb_threads;
+
+    for (int i = 0; i < nb_threads; i++) {
+        FrameThreadWorker *w = &c->workers[i];
+        w->c = c;
+        if ((ret = pthread_create(&w->thread, NULL, worker_thread, w))) {
+            ff_filter_frame_thread_free(ctx);
+            return AVERROR(ret);
+        }
+        c->nb_started++;
+    }
+
+    return 0;
+}
+
+int ff_filter_frame_thread_capture(AVFilterLink *link, AVFrame *frame)
+{
+    FrameThreadContext *c = link->src->internal->frame_thread;
+    pthread_t self = pthread_self();
+
+    for (int i = 0; i < c->nb_workers; i++) {
+        FrameThreadWorker *w = &c->workers[i];
+        FrameThreadOutput *outputs;
+
+        if (!pthread_equal(w->thread, self))
+            continue;
+
+        /* the slot belongs to this thread until the job is done */
+        if (w->nb_outputs == w->outputs_size) {
+            outputs = av_realloc_array(w->outputs, 2 * w->outputs_size + 1,
+                                       sizeof(*outputs));
+            if (!outputs) {
+                av_frame_free(&frame);
+                return AVERROR(ENOMEM);
+            }
+            w->outputs      = outputs;
+            w->outputs_size = 2 * w->outputs_size + 1;
+        }
+        w->outputs[w->nb_outputs++] = (FrameThreadOutput){ link, frame };
+        return 1;
+    }
+
+    return 0;
+}
+
+static int output_job(FrameThreadContext *c, FrameThreadWorker *w)
+{
+    int ret = w->ret;
+
+    for (unsigned i = 0; i < w->nb_outputs; i++) {
+        FrameThreadOutput *out = &w->outputs[i];
+        int err;
+
+        if (ret < 0) {
+            av_frame_free(&out->frame);
+            continue;
+        }
+        err = ff_filter_frame(out->link, out->frame);
+        out->frame = NULL;
+        if (err < 0)
+            ret = err;
+    }
+    w->nb_outputs = 0;
+    w->state      = JOB_IDLE;
+    c->next_output++;
+
+    return ret;
+}
+
+int ff_filter_frame_thread_output(AVFilterContext *ctx, int flush)
+{
+    FrameThreadContext *c = ctx->internal->frame_thread;
+
+    while (c->next_output != c->next_submit) {
+        FrameThreadWorker *w = &c->workers[c->next_output % c->nb_workers];
+        int ret;
+
+        pthread_mutex_lock(&c->lock);
+        if (!flush && w->state != JOB_DONE) {
+            pthread_mutex_unlock(&c->lock);
+            break;
+        }
+        while (w->state != JOB_DONE)
+            pthread_cond_wait(&c->done_cond, &c->lock);
+        pthread_mutex_unlock(&c->lock);
+
+        ret = output_job(c, w);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/**
+ * Allocate the buffer pools of the outputs from the filter graph thread,
+ * the workers then only take buffers from them, which is thread-safe.
+ */
+static int init_pools(AVFilterContext *ctx)
+{
+    for (unsigned i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        AVFrame *frame;
+
+        if (outlink->type != AVMEDIA_TYPE_VIDEO)
+            continue;
+        frame = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!frame)
+            return AVERROR(ENOMEM);
+        av_frame_free(&frame);
+    }
+    return 0;
+}
+
+int ff_filter_frame_thread_submit(AVFilterLink *link, AVFrame *frame,
+                           int (*filter_frame)(AVFilterLink *link, AVFrame *frame))
+{
+    FrameThreadContext *c = link->dst->internal->frame_thread;
+    FrameThreadWorker *w;
+    int ret;
+
+    if (!c->pools_ready) {
+        ret = init_pools(link->dst);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+        c->pools_ready = 1;
+    }
+
+    /* all the slots are busy: wait for the oldest frame */
+    if (c->next_submit - c->next_output == c->nb_workers) {
+        w = &c->workers[c->next_output % c->nb_workers];
+        pthread_mutex_lock(&c->lock);
+        while (w->state != JOB_DONE)
+            pthread_cond_wait(&c->done_cond, &c->lock);
+        pthread_mutex_unlock(&c->lock);
+
+        ret = output_job(c, w);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+    }
+
+    w = &c->workers[c->next_submit++ % c->nb_workers];
+    av_assert0(w->state == JOB_IDLE);
+
+    pthread_mutex_lock(&c->lock);
+    w->link         = link;
+    w->frame        = frame;
+    w->filter_frame = filter_frame;
+    w->state        = JOB_QUEUED;
+    pthread_cond_broadcast(&c->job_cond);
+    pthread_mutex_unlock(&c->lock);
+
+    return ff_filter_frame_thread_output(link->dst, 0);
+}
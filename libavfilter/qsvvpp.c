@@ -846,7 +846,8 @@ int ff_qsvvpp_filter_frame(QSVVPPContext *s, AVFilterLink *inlink, AVFrame *picr
     int               ret, ret1, filter_ret;
 
     while (s->eof && av_fifo_read(s->async_fifo, &aframe, 1) >= 0) {
-        if (MFXVideoCORE_SyncOperation(s->session, aframe.sync, 1000) < 0)
+        if (outlink->format != AV_PIX_FMT_QSV &&
+            MFXVideoCORE_SyncOperation(s->session, aframe.sync, 1000) < 0)
             av_log(ctx, AV_LOG_WARNING, "Sync failed.\n");
 
         filter_ret = s->filter_frame(outlink, aframe.frame->frame);
@@ -899,13 +900,18 @@ int ff_qsvvpp_filter_frame(QSVVPPContext *s, AVFilterLink *inlink, AVFrame *picr
         if (av_fifo_can_read(s->async_fifo) > s->async_depth) {
             av_fifo_read(s->async_fifo, &aframe, 1);
 
-            do {
-                ret1 = MFXVideoCORE_SyncOperation(s->session, aframe.sync, 1000);
-            } while (ret1 == MFX_WRN_IN_EXECUTION);
-
-            if (ret1 < 0) {
-                ret = ret1;
-                break;
+            /* Like the decoder, leave video memory frames unsynchronized,
+             * the next QSV component waits for the surface itself, and
+             * mapping or downloading it synchronizes as well. */
+            if (outlink->format != AV_PIX_FMT_QSV) {
+                do {
+                    ret1 = MFXVideoCORE_SyncOperation(s->session, aframe.sync, 1000);
+                } while (ret1 == MFX_WRN_IN_EXECUTION);
+
+                if (ret1 < 0) {
+                    ret = ret1;
+                    break;
+                }
             }
 
             filter_ret = s->filter_frame(outlink, aframe.frame->frame);
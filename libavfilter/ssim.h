@@ -31,6 +31,26 @@ typedef struct SSIMDSPContext {
     double (*ssim_end_line)(const int (*sum0)[4], const int (*sum1)[4], int w);
 } SSIMDSPContext;
 
+/* number of 4x4 block sums per line, including the padding */
+#define SSIM_SUM_LEN(w) (((w) >> 2) + 3)
+
+void ff_ssim_init(SSIMDSPContext *dsp);
 void ff_ssim_init_x86(SSIMDSPContext *dsp);
 
+/**
+ * Sum the SSIM of the 8x8 blocks of a plane, ending in the rows of 4x4
+ * blocks from slice_start to slice_end.
+ *
+ * @param temp buffer of 2 * SSIM_SUM_LEN(width) block sums, int[4] for
+ *             ff_ssim_plane() and int64_t[4] for ff_ssim_plane_16bit()
+ */
+double ff_ssim_plane(const SSIMDSPContext *dsp,
+                     const uint8_t *main_data, ptrdiff_t main_stride,
+                     const uint8_t *ref_data, ptrdiff_t ref_stride,
+                     int width, int slice_start, int slice_end, void *temp);
+double ff_ssim_plane_16bit(const uint8_t *main_data, ptrdiff_t main_stride,
+                           const uint8_t *ref_data, ptrdiff_t ref_stride,
+                           int width, int slice_start, int slice_end,
+                           void *temp, int max);
+
 #endif /* AVFILTER_SSIM_H */
@@ -133,7 +133,7 @@ static int test_with_same_dilate(void)
     return 0;
 }
 
-static int test_with_valid(void)
+static int test_with_valid(int number)
 {
     // the input data and expected data are generated with below python code.
     /*
@@ -190,7 +190,7 @@ static int test_with_valid(void)
         -0.06136704, 0.14186388, -0.11655602, -0.23489095, -0.3845829, -0.19017771, 0.1595885, -0.18308741, -0.3071209, -0.5848686, -0.22509028,
         -0.6023201, -0.14448485
     };
-    float *output;
+    float *output, *batch_input;
     float kernel[2*3*3*3] = {
         -0.25291282, 0.22402048, 0.028642118, -0.14615723, -0.27362752, -0.34801802, -0.2759148, 0.19594926, -0.25029412, 0.34606284, 0.10376671,
         -0.1015394, 0.23616093, 0.2134214, 0.35285157, 0.05893758, 0.0024731457, -0.17143056, 0.35758412, 0.2186206, -0.28384736, -0.21206513,
@@ -214,8 +214,15 @@ static int test_with_valid(void)
     params.output_num = 2;
     params.padding_method = VALID;
 
-    operands[0].data = input;
-    operands[0].dims[0] = 1;
+    // the images of a batch are computed independently
+    batch_input = av_malloc_array(number, sizeof(input));
+    if (!batch_input)
+        return 1;
+    for (int n = 0; n < number; n++)
+        memcpy(batch_input + n * FF_ARRAY_ELEMS(input), input, sizeof(input));
+
+    operands[0].data = batch_input;
+    operands[0].dims[0] = number;
     operands[0].dims[1] = 5;
     operands[0].dims[2] = 6;
     operands[0].dims[3] = 3;
@@ -224,22 +231,28 @@ static int test_with_valid(void)
     input_indexes[0] = 0;
     ff_dnn_execute_layer_conv2d(operands, input_indexes, 1, &params, &ctx);
 
+    av_freep(&batch_input);
+
     output = operands[1].data;
-    for (int i = 0; i < sizeof(expected_output) / sizeof(float); i++) {
-        if (fabs(output[i] - expected_output[i]) > EPSON) {
-            printf("at index %d, output: %f, expected_output: %f\n", i, output[i], expected_output[i]);
-            av_freep(&output);
-            return 1;
+    for (int n = 0; n < number; n++, output += FF_ARRAY_ELEMS(expected_output)) {
+        for (int i = 0; i < sizeof(expected_output) / sizeof(float); i++) {
+            if (fabs(output[i] - expected_output[i]) > EPSON) {
+                printf("at image %d index %d, output: %f, expected_output: %f\n", n, i, output[i], expected_output[i]);
+                av_freep(&operands[1].data);
+                return 1;
+            }
         }
     }
 
-    av_freep(&output);
+    av_freep(&operands[1].data);
     return 0;
 }
 
 int main(int argc, char **argv)
 {
-    if (test_with_valid())
+    if (test_with_valid(1))
+        return 1;
+    if (test_with_valid(3))
         return 1;
     if (test_with_same_dilate())
         return 1;
@@ -25,4 +25,52 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Activate filters concurrently with the threads of the graph, the result
+ * of ff_filter_activate() for filters[i] being stored in rets[i].
+ *
+ * The filters must not share any link nor any neighbour.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if the graph has no threads, another
+ *         negative error code on failure; the filters were not activated then
+ */
+int ff_graph_pipeline_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                              int *rets, int nb_filters);
+
+/**
+ * Start the frame threads of a filter with AVFILTER_FLAG_FRAME_THREADS.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if frame threading is not available
+ *         or not worth it with nb_threads, another negative error code on
+ *         failure
+ */
+int ff_filter_frame_thread_init(AVFilterContext *ctx, int nb_threads);
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx);
+
+/**
+ * Run filter_frame() on the frame in one of the frame threads of the
+ * destination filter, and forward the frames filtered so far.
+ */
+int ff_filter_frame_thread_submit(AVFilterLink *link, AVFrame *frame,
+                           int (*filter_frame)(AVFilterLink *link, AVFrame *frame));
+
+/**
+ * Keep a frame sent to an output of a frame threaded filter from one of its
+ * frame threads, to be forwarded in order later.
+ *
+ * @return 1 if the frame was kept, 0 if not called from a frame thread of
+ *         the source filter, a negative error code on failure
+ */
+int ff_filter_frame_thread_capture(AVFilterLink *link, AVFrame *frame);
+
+/**
+ * Forward the frames filtered by the frame threads, in the order of the
+ * input frames.
+ *
+ * @param flush if set, wait for all the submitted frames, otherwise stop at
+ *              the first one which is not filtered yet
+ */
+int ff_filter_frame_thread_output(AVFilterContext *ctx, int flush);
+
 #endif /* AVFILTER_THREAD_H */
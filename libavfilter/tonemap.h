@@ -0,0 +1,46 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_TONEMAP_H
+#define AVFILTER_TONEMAP_H
+
+/* number of intervals of the tone curve table, covering [0, peak] */
+#define TONEMAP_LUT_SIZE 4096
+
+typedef struct TonemapLUTParams {
+    float coeffs[3];    ///< luma coefficients of r, g and b
+    float desat;        ///< desaturation strength, disabled if not positive
+    float lut_scale;    ///< TONEMAP_LUT_SIZE / peak
+} TonemapLUTParams;
+
+typedef struct TonemapDSPContext {
+    /**
+     * Tone map a row of linear light float rgb, looking the tone curve up in
+     * a table of TONEMAP_LUT_SIZE + 1 values. The signal is clipped to the
+     * peak. The rows must be readable and writable up to width rounded up
+     * to a multiple of 8.
+     */
+    void (*tonemap_lut)(float *dst_r, float *dst_g, float *dst_b,
+                        const float *src_r, const float *src_g, const float *src_b,
+                        const float *lut, const TonemapLUTParams *p, int width);
+} TonemapDSPContext;
+
+void ff_tonemap_dsp_init(TonemapDSPContext *dsp);
+void ff_tonemap_dsp_init_x86(TonemapDSPContext *dsp);
+
+#endif /* AVFILTER_TONEMAP_H */
@@ -47,6 +47,7 @@ typedef struct BlackDetectContext {
     unsigned int nb_black_pixels;   ///< number of black pixels counted so far
     AVRational   time_base;
     int          depth;
+    int          step;              ///< analyze only every step-th line
     int          nb_threads;
     unsigned int *counter;
 } BlackDetectContext;
@@ -61,6 +62,7 @@ static const AVOption blackdetect_options[] = {
     { "pic_th",                 "set the picture black ratio threshold", OFFSET(picture_black_ratio_th), AV_OPT_TYPE_DOUBLE, {.dbl=.98}, 0, 1, FLAGS },
     { "pixel_black_th", "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
     { "pix_th",         "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
+    { "step",           "set the line analysis step",    OFFSET(step),           AV_OPT_TYPE_INT,    {.i64=1},   1, 64, FLAGS },
     { NULL }
 };
 
@@ -138,9 +140,9 @@ static int black_counter(AVFilterContext *ctx, void *arg,
     const unsigned int threshold = s->pixel_black_th_i;
     unsigned int *counterp = &s->counter[jobnr];
     AVFrame *in = arg;
-    const int linesize = in->linesize[0];
+    const int linesize = in->linesize[0] * s->step;
     const int w = in->width;
-    const int h = in->height;
+    const int h = (in->height + s->step - 1) / s->step;
     const int start = (h * jobnr) / nb_jobs;
     const int end = (h * (jobnr+1)) / nb_jobs;
     const int size = end - start;
@@ -178,18 +180,19 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     const int factor = (1 << (s->depth - 8));
     const int full = picref->color_range == AVCOL_RANGE_JPEG ||
                      ff_fmt_is_in(picref->format, yuvj_formats);
+    const int lines = (picref->height + s->step - 1) / s->step;
 
     s->pixel_black_th_i = full ? s->pixel_black_th * max :
         // luminance_minimum_value + pixel_black_th * luminance_range_size
         16 * factor + s->pixel_black_th * (235 - 16) * factor;
 
     ff_filter_execute(ctx, black_counter, picref, NULL,
-                      FFMIN(inlink->h, s->nb_threads));
+                      FFMIN(lines, s->nb_threads));
 
     for (int i = 0; i < s->nb_threads; i++)
         s->nb_black_pixels += s->counter[i];
 
-    picture_black_ratio = (double)s->nb_black_pixels / (inlink->w * inlink->h);
+    picture_black_ratio = (double)s->nb_black_pixels / (picref->width * lines);
 
     av_log(ctx, AV_LOG_DEBUG,
            "frame:%"PRId64" picture_black_ratio:%f pts:%s t:%s type:%c\n",
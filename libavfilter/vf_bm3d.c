@@ -56,7 +56,10 @@ typedef struct ThreadData {
     int src_linesize;
     const uint8_t *ref;
     int ref_linesize;
+    uint8_t *dst;
+    int dst_linesize;
     int plane;
+    int nb_jobs;
 } ThreadData;
 
 typedef struct PosCode {
@@ -83,6 +86,7 @@ typedef struct SliceContext {
     float *rbufferz;
     float *rbuffer;
     float *num, *den;
+    int row_start, row_end;     ///< rows of num/den written by this slice
     PosPairCode match_blocks[256];
     int nb_match_blocks;
     PosCode *search_positions;
@@ -120,9 +124,9 @@ typedef struct BM3DContext {
                           int y, int x, int block_size, float *dst);
     double (*do_block_ssd)(struct BM3DContext *s, PosCode *pos,
                            const uint8_t *src, int src_stride,
-                           int r_y, int r_x);
+                           int r_y, int r_x, double max_dist);
     void (*do_output)(struct BM3DContext *s, uint8_t *dst, int dst_linesize,
-                      int plane, int nb_jobs);
+                      int plane, int nb_jobs, int row_start, int row_end);
     void (*block_filtering)(struct BM3DContext *s,
                             const uint8_t *src, int src_linesize,
                             const uint8_t *ref, int ref_linesize,
@@ -220,27 +224,26 @@ static int search_boundary(int plane_boundary, int search_range, int search_step
     return do_search_boundary(vertical ? y : x, plane_boundary, search_range, search_step);
 }
 
-static int cmp_scores(const void *a, const void *b)
-{
-    const struct PosPairCode *pair1 = a;
-    const struct PosPairCode *pair2 = b;
-    return FFDIFFSIGN(pair1->score, pair2->score);
-}
-
-static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x)
+static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride,
+                           int r_y, int r_x, double max_dist)
 {
     const uint8_t *srcp = src + pos->y * src_stride + pos->x;
     const uint8_t *refp = src + r_y * src_stride + r_x;
     const int block_size = s->block_size;
-    double dist = 0.;
+    uint32_t dist = 0;
     int x, y;
 
+    /* integer sums are exact, so the partial sum of the rows already
+     * done is a lower bound of the total and allows to stop early */
     for (y = 0; y < block_size; y++) {
         for (x = 0; x < block_size; x++) {
-            double temp = refp[x] - srcp[x];
+            int temp = refp[x] - srcp[x];
             dist += temp * temp;
         }
 
+        if (dist > max_dist)
+            break;
+
         srcp += src_stride;
         refp += src_stride;
     }
@@ -248,20 +251,24 @@ static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int
     return dist;
 }
 
-static double do_block_ssd16(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x)
+static double do_block_ssd16(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride,
+                             int r_y, int r_x, double max_dist)
 {
     const uint16_t *srcp = (uint16_t *)src + pos->y * src_stride / 2 + pos->x;
     const uint16_t *refp = (uint16_t *)src + r_y * src_stride / 2 + r_x;
     const int block_size = s->block_size;
-    double dist = 0.;
+    uint64_t dist = 0;
     int x, y;
 
     for (y = 0; y < block_size; y++) {
         for (x = 0; x < block_size; x++) {
-            double temp = refp[x] - srcp[x];
+            unsigned temp = FFABS(refp[x] - srcp[x]);
             dist += temp * temp;
         }
 
+        if (dist > max_dist)
+            break;
+
         srcp += src_stride / 2;
         refp += src_stride / 2;
     }
@@ -269,6 +276,25 @@ static double do_block_ssd16(BM3DContext *s, PosCode *pos, const uint8_t *src, i
     return dist;
 }
 
+/* SSD above which a block can not make it into the group */
+static double max_block_ssd(const SliceContext *sc, int index, int group_size,
+                            double th_sse, double MSE2SSE, double distMul)
+{
+    double worst, bound;
+
+    if (index < group_size)
+        return th_sse;
+
+    /* blocks scoring no better than the worst one are rejected, make sure
+     * the bound maps to such a score despite the rounding of distMul */
+    worst = sc->match_blocks[index - 1].score;
+    bound = worst * MSE2SSE;
+    while (bound * distMul < worst)
+        bound += bound * DBL_EPSILON;
+
+    return FFMIN(th_sse, bound);
+}
+
 static void do_block_matching_multi(BM3DContext *s, const uint8_t *src, int src_stride, int src_range,
                                     const PosCode *search_pos, int search_size, float th_mse,
                                     int r_y, int r_x, int plane, int jobnr)
@@ -278,12 +304,14 @@ static void do_block_matching_multi(BM3DContext *s, const uint8_t *src, int src_
     double distMul = 1. / MSE2SSE;
     double th_sse = th_mse * MSE2SSE;
     int index = sc->nb_match_blocks;
+    double max_dist = th_sse;
 
     for (int i = 0; i < search_size; i++) {
         PosCode pos = search_pos[i];
         double dist;
+        int j;
 
-        dist = s->do_block_ssd(s, &pos, src, src_stride, r_y, r_x);
+        dist = s->do_block_ssd(s, &pos, src, src_stride, r_y, r_x, max_dist);
 
         // Only match similar blocks but not identical blocks
         if (dist <= th_sse && dist != 0) {
@@ -296,11 +324,14 @@ static void do_block_matching_multi(BM3DContext *s, const uint8_t *src, int src_
             if (index >= s->group_size)
                 index = s->group_size - 1;
 
-            sc->match_blocks[index].score = score;
-            sc->match_blocks[index].y = pos.y;
-            sc->match_blocks[index].x = pos.x;
+            /* the list is kept sorted, insert after the blocks with an equal score */
+            for (j = index; j > 0 && sc->match_blocks[j - 1].score > score; j--)
+                sc->match_blocks[j] = sc->match_blocks[j - 1];
+            sc->match_blocks[j].score = score;
+            sc->match_blocks[j].y = pos.y;
+            sc->match_blocks[j].x = pos.x;
             index++;
-            qsort(sc->match_blocks, index, sizeof(PosPairCode), cmp_scores);
+            max_dist = max_block_ssd(sc, index, s->group_size, th_sse, MSE2SSE, distMul);
         }
     }
 
@@ -629,12 +660,11 @@ static void final_block_filtering(BM3DContext *s, const uint8_t *src, int src_li
 }
 
 static void do_output(BM3DContext *s, uint8_t *dst, int dst_linesize,
-                      int plane, int nb_jobs)
+                      int plane, int nb_jobs, int row_start, int row_end)
 {
-    const int height = s->planeheight[plane];
     const int width = s->planewidth[plane];
 
-    for (int i = 0; i < height; i++) {
+    for (int i = row_start; i < row_end; i++) {
         for (int j = 0; j < width; j++) {
             uint8_t *dstp = dst + i * dst_linesize;
             float sum_den = 0.f;
@@ -642,8 +672,12 @@ static void do_output(BM3DContext *s, uint8_t *dst, int dst_linesize,
 
             for (int k = 0; k < nb_jobs; k++) {
                 SliceContext *sc = &s->slices[k];
-                float num = sc->num[i * width + j];
-                float den = sc->den[i * width + j];
+                float num, den;
+
+                if (i < sc->row_start || i >= sc->row_end)
+                    continue;
+                num = sc->num[i * width + j];
+                den = sc->den[i * width + j];
 
                 sum_num += num;
                 sum_den += den;
@@ -655,13 +689,12 @@ static void do_output(BM3DContext *s, uint8_t *dst, int dst_linesize,
 }
 
 static void do_output16(BM3DContext *s, uint8_t *dst, int dst_linesize,
-                        int plane, int nb_jobs)
+                        int plane, int nb_jobs, int row_start, int row_end)
 {
-    const int height = s->planeheight[plane];
     const int width = s->planewidth[plane];
     const int depth = s->depth;
 
-    for (int i = 0; i < height; i++) {
+    for (int i = row_start; i < row_end; i++) {
         for (int j = 0; j < width; j++) {
             uint16_t *dstp = (uint16_t *)dst + i * dst_linesize / 2;
             float sum_den = 0.f;
@@ -669,8 +702,12 @@ static void do_output16(BM3DContext *s, uint8_t *dst, int dst_linesize,
 
             for (int k = 0; k < nb_jobs; k++) {
                 SliceContext *sc = &s->slices[k];
-                float num = sc->num[i * width + j];
-                float den = sc->den[i * width + j];
+                float num, den;
+
+                if (i < sc->row_start || i >= sc->row_end)
+                    continue;
+                num = sc->num[i * width + j];
+                den = sc->den[i * width + j];
 
                 sum_num += num;
                 sum_den += den;
@@ -700,8 +737,13 @@ static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
     const int slice_end = (jobnr == nb_jobs - 1) ? block_pos_bottom + block_step :
                           (((height + block_step - 1) / block_step) * (jobnr + 1) / nb_jobs) * block_step;
 
-    memset(sc->num, 0, width * height * sizeof(float));
-    memset(sc->den, 0, width * height * sizeof(float));
+    /* blocks are aggregated at their reference position, which stays within
+     * the slice rows plus one block, only that part needs to be cleared */
+    sc->row_start = slice_start;
+    sc->row_end = slice_start < slice_end ?
+                  FFMIN(slice_end - 1, block_pos_bottom) + s->block_size : slice_start;
+    memset(sc->num + sc->row_start * width, 0, (sc->row_end - sc->row_start) * width * sizeof(float));
+    memset(sc->den + sc->row_start * width, 0, (sc->row_end - sc->row_start) * width * sizeof(float));
 
     for (int j = slice_start; j < slice_end; j += block_step) {
         if (j > block_pos_bottom) {
@@ -723,6 +765,20 @@ static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
     return 0;
 }
 
+static int output_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BM3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int height = s->planeheight[td->plane];
+    const int row_start = (height *  jobnr     ) / nb_jobs;
+    const int row_end   = (height * (jobnr + 1)) / nb_jobs;
+
+    s->do_output(s, td->dst, td->dst_linesize, td->plane, td->nb_jobs,
+                 row_start, row_end);
+
+    return 0;
+}
+
 static int filter_frame(AVFilterContext *ctx, AVFrame **out, AVFrame *in, AVFrame *ref)
 {
     BM3DContext *s = ctx->priv;
@@ -749,10 +805,14 @@ static int filter_frame(AVFilterContext *ctx, AVFrame **out, AVFrame *in, AVFram
         td.src_linesize = in->linesize[p];
         td.ref = ref->data[p];
         td.ref_linesize = ref->linesize[p];
+        td.dst = (*out)->data[p];
+        td.dst_linesize = (*out)->linesize[p];
         td.plane = p;
+        td.nb_jobs = nb_jobs;
         ff_filter_execute(ctx, filter_slice, &td, NULL, nb_jobs);
 
-        s->do_output(s, (*out)->data[p], (*out)->linesize[p], p, nb_jobs);
+        ff_filter_execute(ctx, output_slice, &td, NULL,
+                          FFMIN(s->planeheight[p], s->nb_threads));
     }
 
     return 0;
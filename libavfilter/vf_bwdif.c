@@ -50,8 +50,6 @@ static const uint16_t coef_sp[2] = { 5077, 981 };
 
 typedef struct ThreadData {
     AVFrame *frame;
-    int plane;
-    int w, h;
     int parity;
     int tff;
 } ThreadData;
@@ -212,76 +210,82 @@ static void filter_edge_16bit(void *dst1, void *prev1, void *cur1, void *next1,
     FILTER2()
 }
 
-static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static void filter_plane_slice(BWDIFContext *s, const ThreadData *td,
+                               int plane, int w, int h, int jobnr, int nb_jobs)
 {
-    BWDIFContext *s = ctx->priv;
     YADIFContext *yadif = &s->yadif;
-    ThreadData *td  = arg;
-    int linesize = yadif->cur->linesize[td->plane];
-    int clip_max = (1 << (yadif->csp->comp[td->plane].depth)) - 1;
-    int df = (yadif->csp->comp[td->plane].depth + 7) / 8;
+    int linesize = yadif->cur->linesize[plane];
+    int clip_max = (1 << (yadif->csp->comp[plane].depth)) - 1;
+    int df = (yadif->csp->comp[plane].depth + 7) / 8;
     int refs = linesize / df;
-    int slice_start = (td->h *  jobnr   ) / nb_jobs;
-    int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
+    int slice_start = (h *  jobnr   ) / nb_jobs;
+    int slice_end   = (h * (jobnr+1)) / nb_jobs;
     int y;
 
     for (y = slice_start; y < slice_end; y++) {
         if ((y ^ td->parity) & 1) {
-            uint8_t *prev = &yadif->prev->data[td->plane][y * linesize];
-            uint8_t *cur  = &yadif->cur ->data[td->plane][y * linesize];
-            uint8_t *next = &yadif->next->data[td->plane][y * linesize];
-            uint8_t *dst  = &td->frame->data[td->plane][y * td->frame->linesize[td->plane]];
+            uint8_t *prev = &yadif->prev->data[plane][y * linesize];
+            uint8_t *cur  = &yadif->cur ->data[plane][y * linesize];
+            uint8_t *next = &yadif->next->data[plane][y * linesize];
+            uint8_t *dst  = &td->frame->data[plane][y * td->frame->linesize[plane]];
             if (yadif->current_field == YADIF_FIELD_END) {
-                s->filter_intra(dst, cur, td->w, (y + df) < td->h ? refs : -refs,
+                s->filter_intra(dst, cur, w, (y + df) < h ? refs : -refs,
                                 y > (df - 1) ? -refs : refs,
-                                (y + 3*df) < td->h ? 3 * refs : -refs,
+                                (y + 3*df) < h ? 3 * refs : -refs,
                                 y > (3*df - 1) ? -3 * refs : refs,
                                 td->parity ^ td->tff, clip_max);
-            } else if ((y < 4) || ((y + 5) > td->h)) {
-                s->filter_edge(dst, prev, cur, next, td->w,
-                               (y + df) < td->h ? refs : -refs,
+            } else if ((y < 4) || ((y + 5) > h)) {
+                s->filter_edge(dst, prev, cur, next, w,
+                               (y + df) < h ? refs : -refs,
                                y > (df - 1) ? -refs : refs,
                                refs << 1, -(refs << 1),
                                td->parity ^ td->tff, clip_max,
-                               (y < 2) || ((y + 3) > td->h) ? 0 : 1);
+                               (y < 2) || ((y + 3) > h) ? 0 : 1);
             } else {
-                s->filter_line(dst, prev, cur, next, td->w,
+                s->filter_line(dst, prev, cur, next, w,
                                refs, -refs, refs << 1, -(refs << 1),
                                3 * refs, -3 * refs, refs << 2, -(refs << 2),
                                td->parity ^ td->tff, clip_max);
             }
         } else {
-            memcpy(&td->frame->data[td->plane][y * td->frame->linesize[td->plane]],
-                   &yadif->cur->data[td->plane][y * linesize], td->w * df);
+            memcpy(&td->frame->data[plane][y * td->frame->linesize[plane]],
+                   &yadif->cur->data[plane][y * linesize], w * df);
         }
     }
-    return 0;
 }
 
-static void filter(AVFilterContext *ctx, AVFrame *dstpic,
-                   int parity, int tff)
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    BWDIFContext *bwdif = ctx->priv;
-    YADIFContext *yadif = &bwdif->yadif;
-    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
+    BWDIFContext *s = ctx->priv;
+    YADIFContext *yadif = &s->yadif;
+    ThreadData *td  = arg;
     int i;
 
     for (i = 0; i < yadif->csp->nb_components; i++) {
-        int w = dstpic->width;
-        int h = dstpic->height;
+        int w = td->frame->width;
+        int h = td->frame->height;
 
         if (i == 1 || i == 2) {
             w = AV_CEIL_RSHIFT(w, yadif->csp->log2_chroma_w);
             h = AV_CEIL_RSHIFT(h, yadif->csp->log2_chroma_h);
         }
 
-        td.w     = w;
-        td.h     = h;
-        td.plane = i;
-
-        ff_filter_execute(ctx, filter_slice, &td, NULL,
-                          FFMIN(h, ff_filter_get_nb_threads(ctx)));
+        filter_plane_slice(s, td, i, w, h, jobnr, nb_jobs);
     }
+    return 0;
+}
+
+static void filter(AVFilterContext *ctx, AVFrame *dstpic,
+                   int parity, int tff)
+{
+    BWDIFContext *bwdif = ctx->priv;
+    YADIFContext *yadif = &bwdif->yadif;
+    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
+
+    /* Process all planes in a single execute call, so that there is one
+     * synchronization point per frame instead of one per plane. */
+    ff_filter_execute(ctx, filter_slice, &td, NULL,
+                      FFMIN(dstpic->height, ff_filter_get_nb_threads(ctx)));
     if (yadif->current_field == YADIF_FIELD_END) {
         yadif->current_field = YADIF_FIELD_NORMAL;
     }
@@ -401,6 +401,10 @@ static int create_filtergraph(AVFilterContext *ctx,
     const AVPixFmtDescriptor *in_desc  = av_pix_fmt_desc_get(in->format);
     const AVPixFmtDescriptor *out_desc = av_pix_fmt_desc_get(out->format);
     int emms = 0, m, n, o, res, fmt_identical, redo_yuv2rgb = 0, redo_rgb2yuv = 0;
+    enum AVColorPrimaries in_prm = in->color_primaries;
+    enum AVColorTransferCharacteristic in_trc = in->color_trc;
+    enum AVColorSpace in_csp = in->colorspace;
+    enum AVColorRange in_rng = in->color_range;
 
 #define supported_depth(d) ((d) == 8 || (d) == 10 || (d) == 12)
 #define supported_subsampling(lcw, lch) \
@@ -426,21 +430,33 @@ static int create_filtergraph(AVFilterContext *ctx,
         return AVERROR(EINVAL);
     }
 
-    if (in->color_primaries  != s->in_prm)  s->in_primaries  = NULL;
+    // apply the user overrides before comparing, otherwise input frames
+    // tagged differently would trigger a full reinit on every frame
+    if (s->user_iall != CS_UNSPECIFIED) {
+        in_prm = default_prm[FFMIN(s->user_iall, CS_NB)];
+        in_trc = default_trc[FFMIN(s->user_iall, CS_NB)];
+        in_csp = default_csp[FFMIN(s->user_iall, CS_NB)];
+    }
+    if (s->user_iprm != AVCOL_PRI_UNSPECIFIED)
+        in_prm = s->user_iprm;
+    if (s->user_itrc != AVCOL_TRC_UNSPECIFIED)
+        in_trc = s->user_itrc;
+    if (s->user_icsp != AVCOL_SPC_UNSPECIFIED)
+        in_csp = s->user_icsp;
+    if (s->user_irng != AVCOL_RANGE_UNSPECIFIED)
+        in_rng = s->user_irng;
+
+    if (in_prm               != s->in_prm)  s->in_primaries  = NULL;
     if (out->color_primaries != s->out_prm) s->out_primaries = NULL;
-    if (in->color_trc        != s->in_trc)  s->in_txchr      = NULL;
+    if (in_trc               != s->in_trc)  s->in_txchr      = NULL;
     if (out->color_trc       != s->out_trc) s->out_txchr     = NULL;
-    if (in->colorspace       != s->in_csp ||
-        in->color_range      != s->in_rng)  s->in_lumacoef   = NULL;
+    if (in_csp               != s->in_csp ||
+        in_rng               != s->in_rng)  s->in_lumacoef   = NULL;
     if (out->colorspace      != s->out_csp ||
         out->color_range     != s->out_rng) s->out_lumacoef  = NULL;
 
     if (!s->out_primaries || !s->in_primaries) {
-        s->in_prm = in->color_primaries;
-        if (s->user_iall != CS_UNSPECIFIED)
-            s->in_prm = default_prm[FFMIN(s->user_iall, CS_NB)];
-        if (s->user_iprm != AVCOL_PRI_UNSPECIFIED)
-            s->in_prm = s->user_iprm;
+        s->in_prm = in_prm;
         s->in_primaries = av_csp_primaries_desc_from_id(s->in_prm);
         if (!s->in_primaries) {
             av_log(ctx, AV_LOG_ERROR,
@@ -500,11 +516,7 @@ static int create_filtergraph(AVFilterContext *ctx,
 
     if (!s->in_txchr) {
         av_freep(&s->lin_lut);
-        s->in_trc = in->color_trc;
-        if (s->user_iall != CS_UNSPECIFIED)
-            s->in_trc = default_trc[FFMIN(s->user_iall, CS_NB)];
-        if (s->user_itrc != AVCOL_TRC_UNSPECIFIED)
-            s->in_trc = s->user_itrc;
+        s->in_trc = in_trc;
         s->in_txchr = get_transfer_characteristics(s->in_trc);
         if (!s->in_txchr) {
             av_log(ctx, AV_LOG_ERROR,
@@ -546,14 +558,8 @@ static int create_filtergraph(AVFilterContext *ctx,
     }
 
     if (!s->in_lumacoef) {
-        s->in_csp = in->colorspace;
-        if (s->user_iall != CS_UNSPECIFIED)
-            s->in_csp = default_csp[FFMIN(s->user_iall, CS_NB)];
-        if (s->user_icsp != AVCOL_SPC_UNSPECIFIED)
-            s->in_csp = s->user_icsp;
-        s->in_rng = in->color_range;
-        if (s->user_irng != AVCOL_RANGE_UNSPECIFIED)
-            s->in_rng = s->user_irng;
+        s->in_csp = in_csp;
+        s->in_rng = in_rng;
         s->in_lumacoef = av_csp_luma_coeffs_from_avcsp(s->in_csp);
         if (!s->in_lumacoef) {
             av_log(ctx, AV_LOG_ERROR,
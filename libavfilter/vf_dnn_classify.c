@@ -199,9 +199,15 @@ static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P,
     AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV410P, AV_PIX_FMT_YUV411P,
     AV_PIX_FMT_NV12,
+    AV_PIX_FMT_VAAPI, AV_PIX_FMT_QSV, AV_PIX_FMT_CUDA,
     AV_PIX_FMT_NONE
 };
 
+static int dnn_classify_config_input(AVFilterLink *inlink)
+{
+    return ff_dnn_check_hw_frames(inlink, pix_fmts);
+}
+
 static int dnn_classify_flush_frame(AVFilterLink *outlink, int64_t pts, int64_t *out_pts)
 {
     DnnClassifyContext *ctx = outlink->src->priv;
@@ -297,6 +303,7 @@ static const AVFilterPad dnn_classify_inputs[] = {
     {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = dnn_classify_config_input,
     },
 };
 
@@ -148,6 +148,16 @@ enum expansion_mode {
     EXP_STRFTIME,
 };
 
+/**
+ * Alpha mask of the whole text, composed from the bitmaps of its glyphs.
+ */
+typedef struct TextMask {
+    uint8_t *data;
+    int x, y;                       ///< position relative to the text origin
+    int w, h;
+    int valid;                      ///< set if built for the current layout
+} TextMask;
+
 typedef struct DrawTextContext {
     const AVClass *class;
     int exp_mode;                   ///< expansion mode to use for the text
@@ -213,6 +223,14 @@ typedef struct DrawTextContext {
     int text_shaping;               ///< 1 to shape the text before drawing it
 #endif
     AVDictionary *metadata;
+
+    /* layout of the last drawn text, reused while it does not change */
+    char *layout_text;              ///< expanded text the positions were computed for
+    unsigned int layout_fontsize;   ///< font size the positions were computed for
+    int layout_w, layout_h;         ///< size of the text
+    int layout_y_min, layout_y_max; ///< descent and ascent of the text
+    TextMask text_mask;             ///< mask of the glyphs, for the text and shadow
+    TextMask border_mask;           ///< mask of the glyph borders
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -855,6 +873,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->positions);
     s->nb_positions = 0;
 
+    av_freep(&s->layout_text);
+    av_freep(&s->text_mask.data);
+    av_freep(&s->border_mask.data);
+
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
@@ -1318,48 +1340,107 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+// divide by 255 and round to nearest
+#define FAST_DIV255(x) ((((x) + 128) * 257) >> 16)
+
+/**
+ * Compose the bitmaps of the glyphs of the text, or of their borders, into
+ * one mask, as blending them one after the other would do.
+ */
+static int build_text_mask(DrawTextContext *s, TextMask *mask, int borderw)
 {
     char *text = s->expanded_text.str;
     uint32_t code = 0;
-    int i, x1, y1;
+    int i, pass, x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
     uint8_t *p;
-    Glyph *glyph = NULL;
 
-    for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
-        Glyph dummy = { 0 };
-        GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
+    av_freep(&mask->data);
+    mask->w = mask->h = 0;
+
+    /* first compute the extent of the bitmaps, then draw them */
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0, p = text; *p; i++) {
+            FT_Bitmap bitmap;
+            Glyph dummy = { 0 }, *glyph;
+            int x1, y1;
+            GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
 continue_on_invalid:
 
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
-            continue;
+            /* new line chars have no position */
+            if (is_newline(code) || code == '\t')
+                continue;
 
-        dummy.code = code;
-        dummy.fontsize = s->fontsize;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+            dummy.code = code;
+            dummy.fontsize = s->fontsize;
+            glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
 
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
+            bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
+            if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+                glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+                return AVERROR(EINVAL);
+
+            x1 = s->positions[i].x - borderw;
+            y1 = s->positions[i].y - borderw;
+
+            if (!pass) {
+                if (!bitmap.width || !bitmap.rows)
+                    continue;
+                x_min = FFMIN(x_min, x1);
+                y_min = FFMIN(y_min, y1);
+                x_max = FFMAX(x_max, x1 + (int)bitmap.width);
+                y_max = FFMAX(y_max, y1 + (int)bitmap.rows);
+                continue;
+            }
 
-        x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+            for (int y = 0; y < bitmap.rows; y++) {
+                const uint8_t *src = bitmap.buffer + y * bitmap.pitch;
+                uint8_t *dst = mask->data + (y1 - mask->y + y) * mask->w + x1 - mask->x;
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+                for (int x = 0; x < bitmap.width; x++) {
+                    unsigned v = bitmap.pixel_mode == FT_PIXEL_MODE_MONO ?
+                                 (src[x >> 3] >> (7 - (x & 7)) & 1) * 255 : src[x];
+                    /* mask = mask + (1 - mask) * v */
+                    dst[x] += FAST_DIV255((255 - dst[x]) * v);
+                }
+            }
+        }
+
+        if (!pass) {
+            if (x_min >= x_max)
+                break;
+            mask->x = x_min;
+            mask->y = y_min;
+            mask->w = x_max - x_min;
+            mask->h = y_max - y_min;
+            mask->data = av_calloc(mask->h, mask->w);
+            if (!mask->data)
+                return AVERROR(ENOMEM);
+        }
     }
 
+    mask->valid = 1;
+    return 0;
+}
+
+static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
+                       int width, int height,
+                       FFDrawColor *color,
+                       int x, int y, int borderw)
+{
+    TextMask *mask = borderw ? &s->border_mask : &s->text_mask;
+    int ret;
+
+    if (!mask->valid && (ret = build_text_mask(s, mask, borderw)) < 0)
+        return ret;
+    if (!mask->data)
+        return 0;
+
+    ff_blend_mask(&s->dc, color,
+                  frame->data, frame->linesize, width, height,
+                  mask->data, mask->w, mask->w, mask->h, 3, 0,
+                  s->x + x + mask->x, s->y + y + mask->y);
+
     return 0;
 }
 
@@ -1469,6 +1550,16 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     if ((ret = update_fontsize(ctx)) < 0)
         return ret;
 
+    /* the glyph positions and masks only depend on the text and font size */
+    if (s->layout_text && s->layout_fontsize == s->fontsize &&
+        !strcmp(s->layout_text, text)) {
+        max_text_line_w = s->layout_w;
+        y               = s->layout_h - s->max_glyph_h;
+        y_min           = s->layout_y_min;
+        y_max           = s->layout_y_max;
+        goto layout_done;
+    }
+
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
@@ -1533,6 +1624,18 @@ continue_on_invalid2:
 
     max_text_line_w = FFMAX(x, max_text_line_w);
 
+    av_freep(&s->layout_text);
+    if (!(s->layout_text = av_strdup(text)))
+        return AVERROR(ENOMEM);
+    s->layout_fontsize   = s->fontsize;
+    s->layout_w          = max_text_line_w;
+    s->layout_h          = y + s->max_glyph_h;
+    s->layout_y_min      = y_min;
+    s->layout_y_max      = y_max;
+    s->text_mask.valid   = 0;
+    s->border_mask.valid = 0;
+
+layout_done:
     s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = max_text_line_w;
     s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = y + s->max_glyph_h;
 
@@ -29,6 +29,8 @@
 #define DEBUG
 
 #include "libavutil/avassert.h"
+#include "libavutil/dict.h"
+#include "libavutil/eval.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
@@ -65,10 +67,18 @@ AVFILTER_DEFINE_CLASS(framerate);
 static double get_scene_score(AVFilterContext *ctx, AVFrame *crnt, AVFrame *next)
 {
     FrameRateContext *s = ctx->priv;
+    AVDictionaryEntry *e = av_dict_get(next->metadata, "lavfi.scd.score", NULL, 0);
     double ret = 0;
 
     ff_dlog(ctx, "get_scene_score()\n");
 
+    /* an upstream scdet filter already scored next against crnt */
+    if (e) {
+        ret = av_clipf(av_strtod(e->value, NULL), 0, 100.0);
+        ff_dlog(ctx, "get_scene_score() reused:%f\n", ret);
+        return ret;
+    }
+
     if (crnt->height == next->height &&
         crnt->width  == next->width) {
         uint64_t sad;
@@ -44,6 +44,7 @@ typedef struct FreezeDetectContext {
 
     double noise;
     int64_t duration;            ///< minimum duration of frozen frame until notification
+    int step;                    ///< analyze only every step-th line
 } FreezeDetectContext;
 
 #define OFFSET(x) offsetof(FreezeDetectContext, x)
@@ -55,6 +56,7 @@ static const AVOption freezedetect_options[] = {
     { "noise",               "set noise tolerance",                       OFFSET(noise),  AV_OPT_TYPE_DOUBLE,   {.dbl=0.001},     0,       1.0, V|F },
     { "d",                   "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
     { "duration",            "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
+    { "step",                "set the line analysis step",                 OFFSET(step),  AV_OPT_TYPE_INT,      {.i64=1},         1,        64, V|F },
 
     {NULL}
 };
@@ -122,12 +124,13 @@ static int is_frozen(FreezeDetectContext *s, AVFrame *reference, AVFrame *frame)
     double mafd;
     for (int plane = 0; plane < 4; plane++) {
         if (s->width[plane]) {
+            const ptrdiff_t lines = (s->height[plane] + s->step - 1) / s->step;
             uint64_t plane_sad;
-            s->sad(frame->data[plane], frame->linesize[plane],
-                   reference->data[plane], reference->linesize[plane],
-                   s->width[plane], s->height[plane], &plane_sad);
+            s->sad(frame->data[plane], frame->linesize[plane] * s->step,
+                   reference->data[plane], reference->linesize[plane] * s->step,
+                   s->width[plane], lines, &plane_sad);
             sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
+            count += s->width[plane] * lines;
         }
     }
     emms_c();
@@ -33,6 +33,10 @@ typedef struct HWDownloadContext {
 
     AVBufferRef       *hwframes_ref;
     AVHWFramesContext *hwframes;
+
+    /* Download still running, output once the next one has been started */
+    AVHWFrameTransfer *transfer;
+    AVFrame           *pending;
 } HWDownloadContext;
 
 static int hwdownload_query_formats(AVFilterContext *avctx)
@@ -108,12 +112,33 @@ static int hwdownload_config_output(AVFilterLink *outlink)
     return 0;
 }
 
+static int hwdownload_output_pending(AVFilterContext *avctx)
+{
+    HWDownloadContext *ctx = avctx->priv;
+    AVFrame *output = ctx->pending;
+    int err;
+
+    if (!output)
+        return 0;
+    ctx->pending = NULL;
+
+    err = av_hwframe_transfer_wait(&ctx->transfer, 0);
+    if (err < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to download frame: %d.\n", err);
+        av_frame_free(&output);
+        return err;
+    }
+
+    return ff_filter_frame(avctx->outputs[0], output);
+}
+
 static int hwdownload_filter_frame(AVFilterLink *link, AVFrame *input)
 {
     AVFilterContext *avctx = link->dst;
     AVFilterLink  *outlink = avctx->outputs[0];
     HWDownloadContext *ctx = avctx->priv;
     AVFrame *output = NULL;
+    AVHWFrameTransfer *transfer = NULL;
     int err;
 
     if (!ctx->hwframes_ref || !input->hw_frames_ctx) {
@@ -135,7 +160,12 @@ static int hwdownload_filter_frame(AVFilterLink *link, AVFrame *input)
         goto fail;
     }
 
-    err = av_hwframe_transfer_data(output, input, 0);
+    err = av_frame_copy_props(output, input);
+    if (err < 0)
+        goto fail;
+
+    /* Let this download run while the previous frame is passed on */
+    err = av_hwframe_transfer_data_async(output, input, 0, &transfer);
     if (err < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to download frame: %d.\n", err);
         goto fail;
@@ -144,13 +174,19 @@ static int hwdownload_filter_frame(AVFilterLink *link, AVFrame *input)
     output->width  = outlink->w;
     output->height = outlink->h;
 
-    err = av_frame_copy_props(output, input);
-    if (err < 0)
-        goto fail;
-
     av_frame_free(&input);
 
-    return ff_filter_frame(avctx->outputs[0], output);
+    err = hwdownload_output_pending(avctx);
+    if (err < 0 || !transfer) {
+        av_hwframe_transfer_wait(&transfer, 0);
+        if (err < 0)
+            goto fail;
+        return ff_filter_frame(outlink, output);
+    }
+
+    ctx->transfer = transfer;
+    ctx->pending  = output;
+    return 0;
 
 fail:
     av_frame_free(&input);
@@ -158,10 +194,28 @@ fail:
     return err;
 }
 
+static int hwdownload_request_frame(AVFilterLink *outlink)
+{
+    AVFilterContext *avctx = outlink->src;
+    HWDownloadContext *ctx = avctx->priv;
+    int err;
+
+    err = ff_request_frame(avctx->inputs[0]);
+    if (err == AVERROR_EOF && ctx->pending) {
+        err = hwdownload_output_pending(avctx);
+        return err < 0 ? err : 0;
+    }
+
+    return err;
+}
+
 static av_cold void hwdownload_uninit(AVFilterContext *avctx)
 {
     HWDownloadContext *ctx = avctx->priv;
 
+    av_hwframe_transfer_wait(&ctx->transfer, 0);
+    av_frame_free(&ctx->pending);
+
     av_buffer_unref(&ctx->hwframes_ref);
 }
 
@@ -186,6 +240,7 @@ static const AVFilterPad hwdownload_outputs[] = {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .config_props = hwdownload_config_output,
+        .request_frame = hwdownload_request_frame,
     },
 };
 
@@ -29,6 +29,8 @@
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "avfilter.h"
 #include "drawutils.h"
 #include "formats.h"
@@ -58,8 +60,18 @@ typedef struct LIBVMAFContext {
     unsigned model_cnt;
     unsigned frame_cnt;
     unsigned bpc;
+    int queue_size;
+    AVThreadMessageQueue *queue;
+    pthread_t worker;
+    int worker_started;
 } LIBVMAFContext;
 
+typedef struct VMAFFramePair {
+    AVFrame *ref;
+    AVFrame *dist;
+    unsigned index;
+} VMAFFramePair;
+
 #define OFFSET(x) offsetof(LIBVMAFContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 
@@ -78,6 +90,7 @@ static const AVOption libvmaf_options[] = {
     {"enable_conf_interval",  "model='enable_conf_interval=true'.",                     OFFSET(enable_conf_interval), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS|AV_OPT_FLAG_DEPRECATED},
     {"model",  "Set the model to be used for computing vmaf.",                          OFFSET(model_cfg), AV_OPT_TYPE_STRING, {.str="version=vmaf_v0.6.1"}, 0, 1, FLAGS},
     {"feature",  "Set the feature to be used for computing vmaf.",                      OFFSET(feature_cfg), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 1, FLAGS},
+    {"queue_size", "Set the number of frame pairs queued for a separate scoring thread.", OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64=0}, 0, 256, FLAGS},
     { NULL }
 };
 
@@ -127,19 +140,11 @@ static int copy_picture_data(AVFrame *src, VmafPicture *dst, unsigned bpc)
     return 0;
 }
 
-static int do_vmaf(FFFrameSync *fs)
+static int read_pictures(LIBVMAFContext *s, AVFrame *ref, AVFrame *dist,
+                         unsigned index)
 {
-    AVFilterContext *ctx = fs->parent;
-    LIBVMAFContext *s = ctx->priv;
     VmafPicture pic_ref, pic_dist;
-    AVFrame *ref, *dist;
-    int err = 0;
-
-    int ret = ff_framesync_dualinput_get(fs, &dist, &ref);
-    if (ret < 0)
-        return ret;
-    if (ctx->is_disabled || !ref)
-        return ff_filter_frame(ctx->outputs[0], dist);
+    int err;
 
     err = copy_picture_data(ref, &pic_ref, s->bpc);
     if (err) {
@@ -154,12 +159,77 @@ static int do_vmaf(FFFrameSync *fs)
         return AVERROR(ENOMEM);
     }
 
-    err = vmaf_read_pictures(s->vmaf, &pic_ref, &pic_dist, s->frame_cnt++);
+    err = vmaf_read_pictures(s->vmaf, &pic_ref, &pic_dist, index);
     if (err) {
         av_log(s, AV_LOG_ERROR, "problem during vmaf_read_pictures.\n");
         return AVERROR(EINVAL);
     }
 
+    return 0;
+}
+
+static void free_frame_pair(void *msg)
+{
+    VMAFFramePair *pair = msg;
+    av_frame_free(&pair->ref);
+    av_frame_free(&pair->dist);
+}
+
+static void *score_thread(void *arg)
+{
+    LIBVMAFContext *s = arg;
+    VMAFFramePair pair;
+    int ret;
+
+    while ((ret = av_thread_message_queue_recv(s->queue, &pair, 0)) >= 0) {
+        ret = read_pictures(s, pair.ref, pair.dist, pair.index);
+        free_frame_pair(&pair);
+        if (ret < 0)
+            break;
+    }
+
+    /* make the filter thread fail on its next frame pair */
+    av_thread_message_queue_set_err_send(s->queue, ret);
+    return NULL;
+}
+
+static int do_vmaf(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    LIBVMAFContext *s = ctx->priv;
+    AVFrame *ref, *dist;
+    int err = 0;
+
+    int ret = ff_framesync_dualinput_get(fs, &dist, &ref);
+    if (ret < 0)
+        return ret;
+    if (ctx->is_disabled || !ref)
+        return ff_filter_frame(ctx->outputs[0], dist);
+
+    if (s->queue) {
+        /* the scoring thread keeps its own references, so the distorted
+         * frame can be passed on without waiting for libvmaf */
+        VMAFFramePair pair = {
+            .ref   = av_frame_clone(ref),
+            .dist  = av_frame_clone(dist),
+            .index = s->frame_cnt,
+        };
+        if (!pair.ref || !pair.dist) {
+            free_frame_pair(&pair);
+            err = AVERROR(ENOMEM);
+        } else if ((err = av_thread_message_queue_send(s->queue, &pair, 0)) < 0) {
+            free_frame_pair(&pair);
+        } else {
+            s->frame_cnt++;
+        }
+    } else {
+        err = read_pictures(s, ref, dist, s->frame_cnt++);
+    }
+    if (err < 0) {
+        av_frame_free(&dist);
+        return err;
+    }
+
     return ff_filter_frame(ctx->outputs[0], dist);
 }
 
@@ -593,6 +663,26 @@ static int config_output(AVFilterLink *outlink)
     if ((ret = ff_framesync_configure(&s->fs)) < 0)
         return ret;
 
+    if (s->queue_size && !s->queue) {
+        ret = av_thread_message_queue_alloc(&s->queue, s->queue_size,
+                                            sizeof(VMAFFramePair));
+        if (ret == AVERROR(ENOSYS)) {
+            av_log(ctx, AV_LOG_WARNING,
+                   "threads are not available, scoring in the filter thread.\n");
+            return 0;
+        }
+        if (ret < 0)
+            return ret;
+        av_thread_message_queue_set_free_func(s->queue, free_frame_pair);
+
+        ret = pthread_create(&s->worker, NULL, score_thread, s);
+        if (ret) {
+            av_thread_message_queue_free(&s->queue);
+            return AVERROR(ret);
+        }
+        s->worker_started = 1;
+    }
+
     return 0;
 }
 
@@ -639,6 +729,17 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     ff_framesync_uninit(&s->fs);
 
+    if (s->worker_started) {
+        /* let the scoring thread drain the queued pairs before flushing */
+        av_thread_message_queue_set_err_recv(s->queue, AVERROR_EOF);
+        pthread_join(s->worker, NULL);
+        s->worker_started = 0;
+    }
+    if (s->queue) {
+        av_thread_message_flush(s->queue);
+        av_thread_message_queue_free(&s->queue);
+    }
+
     if (!s->frame_cnt)
         goto clean_up;
 
@@ -1110,18 +1110,14 @@ static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_NONE
 };
 
-static int config_input(AVFilterLink *inlink)
+av_cold void ff_lut3d_init(LUT3DContext *lut3d, const AVPixFmtDescriptor *desc)
 {
     int depth, is16bit, isfloat, planar;
-    LUT3DContext *lut3d = inlink->dst->priv;
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
 
     depth = desc->comp[0].depth;
     is16bit = desc->comp[0].depth > 8;
     planar = desc->flags & AV_PIX_FMT_FLAG_PLANAR;
     isfloat = desc->flags & AV_PIX_FMT_FLAG_FLOAT;
-    ff_fill_rgba_map(lut3d->rgba_map, inlink->format);
-    lut3d->step = av_get_padded_bits_per_pixel(desc) >> (3 + is16bit);
 
 #define SET_FUNC(name) do {                                     \
     if (planar && !isfloat) {                                   \
@@ -1151,6 +1147,18 @@ static int config_input(AVFilterLink *inlink)
 #if ARCH_X86
     ff_lut3d_init_x86(lut3d, desc);
 #endif
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    LUT3DContext *lut3d = inlink->dst->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int is16bit = desc->comp[0].depth > 8;
+
+    ff_fill_rgba_map(lut3d->rgba_map, inlink->format);
+    lut3d->step = av_get_padded_bits_per_pixel(desc) >> (3 + is16bit);
+
+    ff_lut3d_init(lut3d, desc);
 
     return 0;
 }
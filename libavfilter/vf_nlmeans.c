@@ -39,6 +39,9 @@
 #include "vf_nlmeans_init.h"
 #include "video.h"
 
+/* maximum number of integral images computed concurrently */
+#define MAX_NB_II 8
+
 typedef struct NLMeansContext {
     const AVClass *class;
     int nb_planes;
@@ -49,10 +52,12 @@ typedef struct NLMeansContext {
     int patch_size_uv, patch_hsize_uv;          // patch size and half size for chroma planes
     int research_size,    research_hsize;       // research size and half size
     int research_size_uv, research_hsize_uv;    // research size and half size for chroma planes
-    uint32_t *ii_orig;                          // integral image
-    uint32_t *ii;                               // integral image starting after the 0-line and 0-column
+    uint32_t *ii_orig;                          // integral images
+    uint32_t *ii;                               // first integral image starting after the 0-line and 0-column
     int ii_w, ii_h;                             // width and height of the integral image
     ptrdiff_t ii_lz_32;                         // linesize in 32-bit units of the integral image
+    ptrdiff_t ii_size_32;                       // size in 32-bit units of one integral image
+    int nb_ii;                                  // number of integral images
     float *total_weight;                        // total weight for every pixel
     float *sum;                                 // weighted sum for every pixel
     int linesize;                               // sum and total_weight linesize
@@ -259,7 +264,11 @@ static int config_input(AVFilterLink *inlink)
     s->ii_lz_32 = FFALIGN(s->ii_w + 1, 4);
 
     // "+1" is for the space of the top 0-line
-    s->ii_orig = av_calloc(s->ii_h + 1, s->ii_lz_32 * sizeof(*s->ii_orig));
+    s->ii_size_32 = (s->ii_h + 1) * s->ii_lz_32;
+
+    // one integral image per research offset computed in parallel
+    s->nb_ii = FFMIN(ff_filter_get_nb_threads(ctx), MAX_NB_II);
+    s->ii_orig = av_calloc(s->nb_ii, s->ii_size_32 * sizeof(*s->ii_orig));
     if (!s->ii_orig)
         return AVERROR(ENOMEM);
 
@@ -279,44 +288,63 @@ static int config_input(AVFilterLink *inlink)
 struct thread_data {
     const uint8_t *src;
     ptrdiff_t src_linesize;
-    int startx, starty;
-    int endx, endy;
-    const uint32_t *ii_start;
-    int p;
+    int w, h;
+    int p, e;
+    int nb_offsets;
+    int offx[MAX_NB_II], offy[MAX_NB_II];
 };
 
+static int integral_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    NLMeansContext *s = ctx->priv;
+    const struct thread_data *td = arg;
+
+    compute_ssd_integral_image(&s->dsp, s->ii + jobnr * s->ii_size_32, s->ii_lz_32,
+                               td->src, td->src_linesize,
+                               td->offx[jobnr], td->offy[jobnr], td->e, td->w, td->h);
+    return 0;
+}
+
 static int nlmeans_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     NLMeansContext *s = ctx->priv;
     const uint32_t max_meaningful_diff = s->max_meaningful_diff;
     const struct thread_data *td = arg;
     const ptrdiff_t src_linesize = td->src_linesize;
-    const int process_h = td->endy - td->starty;
-    const int slice_start = (process_h *  jobnr   ) / nb_jobs;
-    const int slice_end   = (process_h * (jobnr+1)) / nb_jobs;
-    const int starty = td->starty + slice_start;
-    const int endy   = td->starty + slice_end;
+    const int w = td->w, h = td->h;
+    const int slice_start = (h *  jobnr   ) / nb_jobs;
+    const int slice_end   = (h * (jobnr+1)) / nb_jobs;
     const int p = td->p;
-    const uint32_t *ii = td->ii_start + (starty - p - 1) * s->ii_lz_32 - p - 1;
     const int dist_b = 2*p + 1;
     const int dist_d = dist_b * s->ii_lz_32;
     const int dist_e = dist_d + dist_b;
     const float *const weight_lut = s->weight_lut;
     NLMeansDSPContext *dsp = &s->dsp;
 
-    for (int y = starty; y < endy; y++) {
-        const uint8_t *const src = td->src + y*src_linesize;
+    // every pixel accumulates the offsets in the same order, whatever the slicing
+    for (int y = slice_start; y < slice_end; y++) {
         float *total_weight = s->total_weight + y*s->linesize;
         float *sum = s->sum + y*s->linesize;
-        const uint32_t *const iia = ii;
-        const uint32_t *const iib = ii + dist_b;
-        const uint32_t *const iid = ii + dist_d;
-        const uint32_t *const iie = ii + dist_e;
-
-        dsp->compute_weights_line(iia, iib, iid, iie, src, total_weight, sum,
-                                  weight_lut, max_meaningful_diff,
-                                  td->startx, td->endx);
-        ii += s->ii_lz_32;
+
+        for (int k = 0; k < td->nb_offsets; k++) {
+            const int offx = td->offx[k];
+            const int offy = td->offy[k];
+            const uint8_t *src;
+            const uint32_t *ii;
+
+            if (y < FFMAX(0, -offy) || y >= FFMIN(h, h - offy))
+                continue;
+
+            src = td->src + (y + offy)*src_linesize + offx;
+            // integral of the centered image (s1), shifted by the patch half size
+            ii  = s->ii + k * s->ii_size_32
+                + (td->e + offy + y - p - 1) * s->ii_lz_32
+                +  td->e + offx     - p - 1;
+            dsp->compute_weights_line(ii, ii + dist_b, ii + dist_d, ii + dist_e,
+                                      src, total_weight, sum,
+                                      weight_lut, max_meaningful_diff,
+                                      FFMAX(0, -offx), FFMIN(w, w - offx));
+        }
     }
     return 0;
 }
@@ -345,34 +373,35 @@ static int nlmeans_plane(AVFilterContext *ctx, int w, int h, int p, int r,
                          const uint8_t *src, ptrdiff_t src_linesize)
 {
     NLMeansContext *s = ctx->priv;
-    /* patches center points cover the whole research window so the patches
-     * themselves overflow the research window */
-    const int e = r + p;
-    /* focus an integral pointer on the centered image (s1) */
-    const uint32_t *centered_ii = s->ii + e*s->ii_lz_32 + e;
+    struct thread_data td = {
+        .src          = src,
+        .src_linesize = src_linesize,
+        .w            = w,
+        .h            = h,
+        .p            = p,
+        /* patches center points cover the whole research window so the
+         * patches themselves overflow the research window */
+        .e            = r + p,
+    };
 
     memset(s->total_weight, 0, s->linesize * h * sizeof(*s->total_weight));
     memset(s->sum, 0, s->linesize * h * sizeof(*s->sum));
 
+    /* The integral images of a batch of offsets are computed in parallel,
+     * then their weights are accumulated by row slices. */
     for (int offy = -r; offy <= r; offy++) {
         for (int offx = -r; offx <= r; offx++) {
             if (offx || offy) {
-                struct thread_data td = {
-                    .src          = src + offy*src_linesize + offx,
-                    .src_linesize = src_linesize,
-                    .startx       = FFMAX(0, -offx),
-                    .starty       = FFMAX(0, -offy),
-                    .endx         = FFMIN(w, w - offx),
-                    .endy         = FFMIN(h, h - offy),
-                    .ii_start     = centered_ii + offy*s->ii_lz_32 + offx,
-                    .p            = p,
-                };
-
-                compute_ssd_integral_image(&s->dsp, s->ii, s->ii_lz_32,
-                                           src, src_linesize,
-                                           offx, offy, e, w, h);
+                td.offx[td.nb_offsets] = offx;
+                td.offy[td.nb_offsets] = offy;
+                td.nb_offsets++;
+            }
+
+            if (td.nb_offsets == s->nb_ii || (offx == r && offy == r && td.nb_offsets)) {
+                ff_filter_execute(ctx, integral_slice, &td, NULL, td.nb_offsets);
                 ff_filter_execute(ctx, nlmeans_slice, &td, NULL,
-                                  FFMIN(td.endy - td.starty, ff_filter_get_nb_threads(ctx)));
+                                  FFMIN(h, ff_filter_get_nb_threads(ctx)));
+                td.nb_offsets = 0;
             }
         }
     }
@@ -32,6 +32,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
@@ -43,6 +44,7 @@
 
 typedef struct ThreadData {
     AVFrame *dst, *src;
+    int x, y;
 } ThreadData;
 
 static const char *const var_names[] = {
@@ -83,6 +85,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     OverlayContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
+    av_frame_free(&s->crop);
     av_expr_free(s->x_pexpr); s->x_pexpr = NULL;
     av_expr_free(s->y_pexpr); s->y_pexpr = NULL;
 }
@@ -277,6 +280,7 @@ static int config_input_overlay(AVFilterLink *inlink)
     const AVPixFmtDescriptor *pix_desc = av_pix_fmt_desc_get(inlink->format);
 
     av_image_fill_max_pixsteps(s->overlay_pix_step, NULL, pix_desc);
+    s->overlay_desc = pix_desc;
 
     /* Finish the configuration by evaluating the expressions
        now when both inputs are configured. */
@@ -462,6 +466,8 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
     const uint##depth##_t max = (1 << nbits) - 1;                                                          \
     const uint##depth##_t mid = (1 << (nbits -1)) ;                                                        \
     int bytes = depth / 8;                                                                                 \
+    const ptrdiff_t alinesize  = src->linesize[3] / bytes;                                                 \
+    const ptrdiff_t dalinesize = dst->linesize[3] / bytes;                                                 \
                                                                                                            \
     dst_step /= bytes;                                                                                     \
     j = FFMAX(-yp, 0);                                                                                     \
@@ -485,7 +491,7 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
         da = dap + ((xp+k) << hsub);                                                                       \
         kmax = FFMIN(-xp + dst_wp, src_wp);                                                                \
                                                                                                            \
-        if (nbits == 8 && ((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {                       \
+        if (((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {                       \
             int c = octx->blend_row[i]((uint8_t*)d, (uint8_t*)da, (uint8_t*)s,                             \
                     (uint8_t*)a, kmax - k, src->linesize[3]);                                              \
                                                                                                            \
@@ -500,13 +506,13 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
                                                                                                            \
             /* average alpha for color components, improve quality */                                      \
             if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {                                            \
-                alpha = (a[0] + a[src->linesize[3]] +                                                      \
-                         a[1] + a[src->linesize[3]+1]) >> 2;                                               \
+                alpha = (a[0] + a[alinesize] +                                                             \
+                         a[1] + a[alinesize + 1]) >> 2;                                                    \
             } else if (hsub || vsub) {                                                                     \
                 alpha_h = hsub && k+1 < src_wp ?                                                           \
                     (a[0] + a[1]) >> 1 : a[0];                                                             \
                 alpha_v = vsub && j+1 < src_hp ?                                                           \
-                    (a[0] + a[src->linesize[3]]) >> 1 : a[0];                                              \
+                    (a[0] + a[alinesize]) >> 1 : a[0];                                                     \
                 alpha = (alpha_v + alpha_h) >> 1;                                                          \
             } else                                                                                         \
                 alpha = a[0];                                                                              \
@@ -516,13 +522,13 @@ static av_always_inline void blend_plane_##depth##_##nbits##bits(AVFilterContext
                 /* average alpha for color components, improve quality */                                  \
                 uint8_t alpha_d;                                                                           \
                 if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {                                        \
-                    alpha_d = (da[0] + da[dst->linesize[3]] +                                              \
-                               da[1] + da[dst->linesize[3]+1]) >> 2;                                       \
+                    alpha_d = (da[0] + da[dalinesize] +                                                    \
+                               da[1] + da[dalinesize + 1]) >> 2;                                           \
                 } else if (hsub || vsub) {                                                                 \
                     alpha_h = hsub && k+1 < src_wp ?                                                       \
                         (da[0] + da[1]) >> 1 : da[0];                                                      \
                     alpha_v = vsub && j+1 < src_hp ?                                                       \
-                        (da[0] + da[dst->linesize[3]]) >> 1 : da[0];                                       \
+                        (da[0] + da[dalinesize]) >> 1 : da[0];                                             \
                     alpha_d = (alpha_v + alpha_h) >> 1;                                                    \
                 } else                                                                                     \
                     alpha_d = da[0];                                                                       \
@@ -677,193 +683,169 @@ static av_always_inline void blend_slice_planar_rgb(AVFilterContext *ctx,
 
 static int blend_slice_yuv420(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva420(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv420p10(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 1, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 1, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva420p10(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 1, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 1, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv422p10(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 0, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 0, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva422p10(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 0, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_16_10bits(ctx, td->dst, td->src, 1, 0, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv422(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva422(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv444(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva444(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrp(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrap(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv420_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva420_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 1, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv422_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva422_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 1, 0, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv444_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva444_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv_8_8bits(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrp_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrap_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgb(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgba(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgb_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgba_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
@@ -992,13 +974,92 @@ end:
     return 0;
 }
 
+static av_always_inline int alpha_at(const uint8_t *row, int x, int step, int depth)
+{
+    return depth > 8 ? AV_RN16(row + x * step) : row[x * step];
+}
+
+static void update_alpha_bbox(OverlayContext *s, const AVFrame *frame)
+{
+    const AVComponentDescriptor *comp = &s->overlay_desc->comp[3];
+    const int w = frame->width, h = frame->height;
+    int x0 = w, y0 = h, x1 = 0, y1 = 0;
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t *row = frame->data[comp->plane] + y * frame->linesize[comp->plane] +
+                             comp->offset;
+        int first, last;
+
+        for (first = 0; first < w && !alpha_at(row, first, comp->step, comp->depth); first++);
+        if (first == w)
+            continue;
+        for (last = w - 1; !alpha_at(row, last, comp->step, comp->depth); last--);
+
+        x0 = FFMIN(x0, first);
+        x1 = FFMAX(x1, last + 1);
+        y0 = FFMIN(y0, y);
+        y1 = y + 1;
+    }
+
+    s->bbox[0] = x0;
+    s->bbox[1] = y0;
+    s->bbox[2] = x1;
+    s->bbox[3] = y1;
+    s->bbox_frame = frame;
+    s->bbox_data  = frame->data[0];
+    s->bbox_pts   = frame->pts;
+}
+
+/**
+ * Restrict the overlay frame to the bounding box of its non-transparent
+ * pixels, where blending with straight alpha leaves the main frame untouched.
+ *
+ * @return 0 if the whole frame is transparent, 1 otherwise
+ */
+static int crop_transparent(OverlayContext *s, const AVFrame *src, AVFrame *crop,
+                            int *x, int *y)
+{
+    const int hsub = s->overlay_desc->log2_chroma_w;
+    const int vsub = s->overlay_desc->log2_chroma_h;
+    int x0, y0, x1, y1;
+
+    if (src != s->bbox_frame || src->data[0] != s->bbox_data || src->pts != s->bbox_pts)
+        update_alpha_bbox(s, src);
+    if (s->bbox[0] >= s->bbox[2])
+        return 0;
+
+    /* the alpha of the last chroma column and row of a frame is not averaged,
+     * keep one more of them when there is one so that the others are computed
+     * as with the whole frame */
+    x0 = s->bbox[0] & ~((1 << hsub) - 1);
+    y0 = s->bbox[1] & ~((1 << vsub) - 1);
+    x1 = FFMIN(FFALIGN(s->bbox[2], 1 << hsub) + (hsub ? 1 << hsub : 0), src->width);
+    y1 = FFMIN(FFALIGN(s->bbox[3], 1 << vsub) + (vsub ? 1 << vsub : 0), src->height);
+
+    crop->format = src->format;
+    crop->width  = x1 - x0;
+    crop->height = y1 - y0;
+    for (int i = 0; i < 4 && src->data[i]; i++) {
+        const int sh = i == 1 || i == 2 ? hsub : 0;
+        const int sv = i == 1 || i == 2 ? vsub : 0;
+
+        crop->data[i]     = src->data[i] + (y0 >> sv) * src->linesize[i] +
+                            (x0 >> sh) * s->overlay_pix_step[i];
+        crop->linesize[i] = src->linesize[i];
+    }
+    *x += x0;
+    *y += y0;
+
+    return 1;
+}
+
 static int do_blend(FFFrameSync *fs)
 {
     AVFilterContext *ctx = fs->parent;
     AVFrame *mainpic, *second;
     OverlayContext *s = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
-    int ret;
+    int x, y, ret;
 
     ret = ff_framesync_dualinput_get_writable(fs, &mainpic, &second);
     if (ret < 0)
@@ -1026,13 +1087,23 @@ static int do_blend(FFFrameSync *fs)
                s->var_values[VAR_Y], s->y);
     }
 
-    if (s->x < mainpic->width  && s->x + second->width  >= 0 &&
-        s->y < mainpic->height && s->y + second->height >= 0) {
+    x = s->x;
+    y = s->y;
+    if (s->overlay_has_alpha && (!s->alpha_format || s->main_is_packed_rgb)) {
+        if (!crop_transparent(s, second, s->crop, &x, &y))
+            return ff_filter_frame(ctx->outputs[0], mainpic);
+        second = s->crop;
+    }
+
+    if (x < mainpic->width  && x + second->width  >= 0 &&
+        y < mainpic->height && y + second->height >= 0) {
         ThreadData td;
 
         td.dst = mainpic;
         td.src = second;
-        ff_filter_execute(ctx, s->blend_slice, &td, NULL, FFMIN(FFMAX(1, FFMIN3(s->y + second->height, FFMIN(second->height, mainpic->height), mainpic->height - s->y)),
+        td.x   = x;
+        td.y   = y;
+        ff_filter_execute(ctx, s->blend_slice, &td, NULL, FFMIN(FFMAX(1, FFMIN3(y + second->height, FFMIN(second->height, mainpic->height), mainpic->height - y)),
                                                                 ff_filter_get_nb_threads(ctx)));
     }
     return ff_filter_frame(ctx->outputs[0], mainpic);
@@ -1042,6 +1113,10 @@ static av_cold int init(AVFilterContext *ctx)
 {
     OverlayContext *s = ctx->priv;
 
+    s->crop = av_frame_alloc();
+    if (!s->crop)
+        return AVERROR(ENOMEM);
+
     s->fs.on_event = do_blend;
     return 0;
 }
@@ -71,6 +71,14 @@ typedef struct OverlayContext {
     int overlay_pix_step[4];    ///< steps per pixel for each plane of the overlay
     int hsub, vsub;             ///< chroma subsampling values
     const AVPixFmtDescriptor *main_desc; ///< format descriptor for main input
+    const AVPixFmtDescriptor *overlay_desc; ///< format descriptor for overlay input
+
+    /* bounding box of the non-transparent pixels of the last overlay frame */
+    const AVFrame *bbox_frame;
+    const uint8_t *bbox_data;
+    int64_t bbox_pts;
+    int bbox[4];                ///< x0, y0, x1, y1, empty if x0 >= x1
+    AVFrame *crop;              ///< the cropped overlay frame to blend
 
     double var_values[VAR_VARS_NB];
     char *x_expr, *y_expr;
@@ -0,0 +1,513 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * CUDA video padding filter
+ */
+
+#include <string.h>
+
+#include "libavutil/colorspace.h"
+#include "libavutil/common.h"
+#include "libavutil/eval.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_cuda_internal.h"
+#include "libavutil/cuda_check.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+#include "cuda/load_helper.h"
+
+static const enum AVPixelFormat supported_formats[] = {
+    AV_PIX_FMT_YUV420P,
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_YUV444P,
+    AV_PIX_FMT_P010,
+    AV_PIX_FMT_P016,
+    AV_PIX_FMT_YUV444P16,
+};
+
+#define DIV_UP(a, b) ( ((a) + (b) - 1) / (b) )
+#define BLOCKX 32
+#define BLOCKY 16
+
+#define CHECK_CU(x) FF_CUDA_CHECK_DL(ctx, s->hwctx->internal->cuda_dl, x)
+
+static const char *const var_names[] = {
+    "in_w",   "iw",
+    "in_h",   "ih",
+    "out_w",  "ow",
+    "out_h",  "oh",
+    "x",
+    "y",
+    "a",
+    "sar",
+    "dar",
+    "hsub",
+    "vsub",
+    NULL
+};
+
+enum var_name {
+    VAR_IN_W,   VAR_IW,
+    VAR_IN_H,   VAR_IH,
+    VAR_OUT_W,  VAR_OW,
+    VAR_OUT_H,  VAR_OH,
+    VAR_X,
+    VAR_Y,
+    VAR_A,
+    VAR_SAR,
+    VAR_DAR,
+    VAR_HSUB,
+    VAR_VSUB,
+    VARS_NB
+};
+
+typedef struct PadCUDAContext {
+    const AVClass *class;
+
+    AVCUDADeviceContext *hwctx;
+
+    enum AVPixelFormat format;
+    const AVPixFmtDescriptor *desc;
+    int planes;
+    int plane_channels[4];
+    int plane_bytes[4];
+    int plane_color[4][2];
+
+    int w, h;       ///< output dimensions, a value of 0 will result in the input size
+    int x, y;       ///< offsets of the input area with respect to the padded area
+
+    char *w_expr;   ///< width  expression string
+    char *h_expr;   ///< height expression string
+    char *x_expr;   ///< x offset expression string
+    char *y_expr;   ///< y offset expression string
+    uint8_t rgba_color[4]; ///< color for the padding area
+
+    AVBufferRef *frames_ctx;
+
+    CUmodule cu_module;
+    CUfunction cu_func_uchar;
+    CUfunction cu_func_uchar2;
+    CUfunction cu_func_ushort;
+    CUfunction cu_func_ushort2;
+    CUstream cu_stream;
+} PadCUDAContext;
+
+static av_cold void cudapad_uninit(AVFilterContext *ctx)
+{
+    PadCUDAContext *s = ctx->priv;
+
+    if (s->hwctx && s->cu_module) {
+        CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+        CUcontext dummy;
+
+        CHECK_CU(cu->cuCtxPushCurrent(s->hwctx->cuda_ctx));
+        CHECK_CU(cu->cuModuleUnload(s->cu_module));
+        s->cu_module = NULL;
+        CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    }
+
+    av_buffer_unref(&s->frames_ctx);
+}
+
+static int format_is_supported(enum AVPixelFormat fmt)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(supported_formats); i++)
+        if (supported_formats[i] == fmt)
+            return 1;
+    return 0;
+}
+
+static av_cold void set_format_info(AVFilterContext *ctx, enum AVPixelFormat format)
+{
+    PadCUDAContext *s = ctx->priv;
+    const uint8_t *c = s->rgba_color;
+    int yuv[3], i;
+
+    s->format = format;
+    s->desc   = av_pix_fmt_desc_get(format);
+    s->planes = av_pix_fmt_count_planes(format);
+
+    yuv[0] = RGB_TO_Y_CCIR(c[0], c[1], c[2]);
+    yuv[1] = RGB_TO_U_CCIR(c[0], c[1], c[2], 0);
+    yuv[2] = RGB_TO_V_CCIR(c[0], c[1], c[2], 0);
+
+    // All supported formats are YUV with 8 bit or MSB-aligned 16 bit
+    // components, and at most two components per plane.
+    for (i = 0; i < s->desc->nb_components; i++) {
+        const AVComponentDescriptor *comp = &s->desc->comp[i];
+        int bytes = (comp->depth + 7) / 8;
+        int ch    = comp->offset / bytes;
+
+        s->plane_bytes[comp->plane]    = bytes;
+        s->plane_channels[comp->plane] = FFMAX(s->plane_channels[comp->plane],
+                                               comp->step / bytes);
+        s->plane_color[comp->plane][ch] = yuv[i] << (bytes > 1 ? 8 : 0);
+    }
+}
+
+static int eval_dimensions(AVFilterContext *ctx, AVFilterLink *inlink)
+{
+    PadCUDAContext *s = ctx->priv;
+    double var_values[VARS_NB], res;
+    char *expr;
+    int ret;
+
+    var_values[VAR_IN_W]  = var_values[VAR_IW] = inlink->w;
+    var_values[VAR_IN_H]  = var_values[VAR_IH] = inlink->h;
+    var_values[VAR_OUT_W] = var_values[VAR_OW] = NAN;
+    var_values[VAR_OUT_H] = var_values[VAR_OH] = NAN;
+    var_values[VAR_A]     = (double) inlink->w / inlink->h;
+    var_values[VAR_SAR]   = inlink->sample_aspect_ratio.num ?
+        (double) inlink->sample_aspect_ratio.num / inlink->sample_aspect_ratio.den : 1;
+    var_values[VAR_DAR]   = var_values[VAR_A] * var_values[VAR_SAR];
+    var_values[VAR_HSUB]  = 1 << s->desc->log2_chroma_w;
+    var_values[VAR_VSUB]  = 1 << s->desc->log2_chroma_h;
+
+    /* evaluate width and height */
+    av_expr_parse_and_eval(&res, (expr = s->w_expr),
+                           var_names, var_values,
+                           NULL, NULL, NULL, NULL, NULL, 0, ctx);
+    s->w = var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->h_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->h = var_values[VAR_OUT_H] = var_values[VAR_OH] = res;
+    if (!s->h)
+        var_values[VAR_OUT_H] = var_values[VAR_OH] = s->h = inlink->h;
+
+    /* evaluate the width again, as it may depend on the evaluated output height */
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->w_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->w = var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+    if (!s->w)
+        var_values[VAR_OUT_W] = var_values[VAR_OW] = s->w = inlink->w;
+
+    /* evaluate x and y */
+    av_expr_parse_and_eval(&res, (expr = s->x_expr),
+                           var_names, var_values,
+                           NULL, NULL, NULL, NULL, NULL, 0, ctx);
+    s->x = var_values[VAR_X] = res;
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->y_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->y = var_values[VAR_Y] = res;
+    /* evaluate x again, as it may depend on the evaluated y value */
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->x_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->x = var_values[VAR_X] = res;
+
+    if (s->x < 0 || s->x + inlink->w > s->w)
+        s->x = (s->w - inlink->w) / 2;
+    if (s->y < 0 || s->y + inlink->h > s->h)
+        s->y = (s->h - inlink->h) / 2;
+
+    /* keep the chroma planes aligned with the luma plane */
+    s->w &= ~((1 << s->desc->log2_chroma_w) - 1);
+    s->h &= ~((1 << s->desc->log2_chroma_h) - 1);
+    s->x &= ~((1 << s->desc->log2_chroma_w) - 1);
+    s->y &= ~((1 << s->desc->log2_chroma_h) - 1);
+
+    if (s->w < inlink->w || s->h < inlink->h) {
+        av_log(ctx, AV_LOG_ERROR, "Padded dimensions cannot be smaller than input dimensions.\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(ctx, AV_LOG_VERBOSE, "w:%d h:%d -> w:%d h:%d x:%d y:%d color:0x%02X%02X%02X%02X\n",
+           inlink->w, inlink->h, s->w, s->h, s->x, s->y,
+           s->rgba_color[0], s->rgba_color[1], s->rgba_color[2], s->rgba_color[3]);
+
+    return 0;
+
+eval_fail:
+    av_log(ctx, AV_LOG_ERROR,
+           "Error when evaluating the expression '%s'\n", expr);
+    return ret;
+}
+
+static av_cold int init_hwframe_ctx(PadCUDAContext *s, AVBufferRef *device_ctx,
+                                    int width, int height)
+{
+    AVBufferRef *out_ref = NULL;
+    AVHWFramesContext *out_ctx;
+    int ret;
+
+    out_ref = av_hwframe_ctx_alloc(device_ctx);
+    if (!out_ref)
+        return AVERROR(ENOMEM);
+    out_ctx = (AVHWFramesContext *)out_ref->data;
+
+    out_ctx->format    = AV_PIX_FMT_CUDA;
+    out_ctx->sw_format = s->format;
+    out_ctx->width     = width;
+    out_ctx->height    = height;
+
+    ret = av_hwframe_ctx_init(out_ref);
+    if (ret < 0)
+        goto fail;
+
+    av_buffer_unref(&s->frames_ctx);
+    s->frames_ctx = out_ref;
+
+    return 0;
+fail:
+    av_buffer_unref(&out_ref);
+    return ret;
+}
+
+static av_cold int cudapad_load_functions(AVFilterContext *ctx)
+{
+    PadCUDAContext *s = ctx->priv;
+    CUcontext dummy, cuda_ctx = s->hwctx->cuda_ctx;
+    CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+    int ret;
+
+    extern const unsigned char ff_vf_pad_cuda_ptx_data[];
+    extern const unsigned int ff_vf_pad_cuda_ptx_len;
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(cuda_ctx));
+    if (ret < 0)
+        return ret;
+
+    ret = ff_cuda_load_module(ctx, s->hwctx, &s->cu_module,
+                              ff_vf_pad_cuda_ptx_data, ff_vf_pad_cuda_ptx_len);
+    if (ret < 0)
+        goto fail;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_uchar, s->cu_module, "Pad_uchar"));
+    if (ret < 0)
+        goto fail;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_uchar2, s->cu_module, "Pad_uchar2"));
+    if (ret < 0)
+        goto fail;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_ushort, s->cu_module, "Pad_ushort"));
+    if (ret < 0)
+        goto fail;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_ushort2, s->cu_module, "Pad_ushort2"));
+    if (ret < 0)
+        goto fail;
+
+fail:
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+
+    return ret;
+}
+
+static av_cold int cudapad_config_props(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    PadCUDAContext *s    = ctx->priv;
+    AVHWFramesContext *in_frames_ctx;
+    int ret;
+
+    if (!inlink->hw_frames_ctx) {
+        av_log(ctx, AV_LOG_ERROR, "No hw context provided on input\n");
+        return AVERROR(EINVAL);
+    }
+    in_frames_ctx = (AVHWFramesContext *)inlink->hw_frames_ctx->data;
+
+    if (!format_is_supported(in_frames_ctx->sw_format)) {
+        av_log(ctx, AV_LOG_ERROR, "Unsupported format: %s\n",
+               av_get_pix_fmt_name(in_frames_ctx->sw_format));
+        return AVERROR(ENOSYS);
+    }
+
+    s->hwctx     = in_frames_ctx->device_ctx->hwctx;
+    s->cu_stream = s->hwctx->stream;
+
+    set_format_info(ctx, in_frames_ctx->sw_format);
+
+    ret = eval_dimensions(ctx, inlink);
+    if (ret < 0)
+        return ret;
+
+    ret = init_hwframe_ctx(s, in_frames_ctx->device_ref, s->w, s->h);
+    if (ret < 0)
+        return ret;
+
+    outlink->w = s->w;
+    outlink->h = s->h;
+    outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    outlink->hw_frames_ctx = av_buffer_ref(s->frames_ctx);
+    if (!outlink->hw_frames_ctx)
+        return AVERROR(ENOMEM);
+
+    return cudapad_load_functions(ctx);
+}
+
+static int cudapad_process(AVFilterContext *ctx, AVFrame *out, const AVFrame *in)
+{
+    PadCUDAContext *s = ctx->priv;
+    CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+    int i, ret;
+
+    for (i = 0; i < s->planes; i++) {
+        int sub_w = (i == 1 || i == 2) ? s->desc->log2_chroma_w : 0;
+        int sub_h = (i == 1 || i == 2) ? s->desc->log2_chroma_h : 0;
+        int pixel = s->plane_bytes[i] * s->plane_channels[i];
+        CUdeviceptr src = (CUdeviceptr)in->data[i];
+        CUdeviceptr dst = (CUdeviceptr)out->data[i];
+        int src_width   = AV_CEIL_RSHIFT(in->width,  sub_w);
+        int src_height  = AV_CEIL_RSHIFT(in->height, sub_h);
+        int src_pitch   = in->linesize[i] / pixel;
+        int dst_width   = AV_CEIL_RSHIFT(out->width,  sub_w);
+        int dst_height  = AV_CEIL_RSHIFT(out->height, sub_h);
+        int dst_pitch   = out->linesize[i] / pixel;
+        int x           = s->x >> sub_w;
+        int y           = s->y >> sub_h;
+        CUfunction func;
+
+        void *args[] = {
+            &src, &src_width, &src_height, &src_pitch,
+            &dst, &dst_width, &dst_height, &dst_pitch,
+            &x, &y, &s->plane_color[i][0], &s->plane_color[i][1],
+        };
+
+        if (s->plane_bytes[i] > 1)
+            func = s->plane_channels[i] > 1 ? s->cu_func_ushort2 : s->cu_func_ushort;
+        else
+            func = s->plane_channels[i] > 1 ? s->cu_func_uchar2  : s->cu_func_uchar;
+
+        ret = CHECK_CU(cu->cuLaunchKernel(func,
+                                          DIV_UP(dst_width, BLOCKX), DIV_UP(dst_height, BLOCKY), 1,
+                                          BLOCKX, BLOCKY, 1, 0, s->cu_stream, args, NULL));
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int cudapad_filter_frame(AVFilterLink *link, AVFrame *in)
+{
+    AVFilterContext *ctx  = link->dst;
+    PadCUDAContext *s     = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    CudaFunctions *cu     = s->hwctx->internal->cuda_dl;
+    AVFrame *out = NULL;
+    CUcontext dummy;
+    int ret;
+
+    out = av_frame_alloc();
+    if (!out) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    ret = av_hwframe_get_buffer(s->frames_ctx, out, 0);
+    if (ret < 0)
+        goto fail;
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(s->hwctx->cuda_ctx));
+    if (ret < 0)
+        goto fail;
+
+    ret = cudapad_process(ctx, out, in);
+
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    if (ret < 0)
+        goto fail;
+
+    ret = av_frame_copy_props(out, in);
+    if (ret < 0)
+        goto fail;
+
+    out->width  = outlink->w;
+    out->height = outlink->h;
+
+    av_frame_free(&in);
+    return ff_filter_frame(outlink, out);
+fail:
+    av_frame_free(&in);
+    av_frame_free(&out);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(PadCUDAContext, x)
+#define FLAGS (AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_VIDEO_PARAM)
+
+static const AVOption pad_cuda_options[] = {
+    { "width",  "set the pad area width expression",       OFFSET(w_expr), AV_OPT_TYPE_STRING, {.str = "iw"}, 0, 0, FLAGS },
+    { "w",      "set the pad area width expression",       OFFSET(w_expr), AV_OPT_TYPE_STRING, {.str = "iw"}, 0, 0, FLAGS },
+    { "height", "set the pad area height expression",      OFFSET(h_expr), AV_OPT_TYPE_STRING, {.str = "ih"}, 0, 0, FLAGS },
+    { "h",      "set the pad area height expression",      OFFSET(h_expr), AV_OPT_TYPE_STRING, {.str = "ih"}, 0, 0, FLAGS },
+    { "x",      "set the x offset expression for the input image position", OFFSET(x_expr), AV_OPT_TYPE_STRING, {.str = "0"}, 0, 0, FLAGS },
+    { "y",      "set the y offset expression for the input image position", OFFSET(y_expr), AV_OPT_TYPE_STRING, {.str = "0"}, 0, 0, FLAGS },
+    { "color",  "set the color of the padded area border", OFFSET(rgba_color), AV_OPT_TYPE_COLOR, {.str = "black"}, 0, 0, FLAGS },
+    { NULL }
+};
+
+static const AVClass cudapad_class = {
+    .class_name = "pad_cuda",
+    .item_name  = av_default_item_name,
+    .option     = pad_cuda_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+static const AVFilterPad cudapad_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = cudapad_filter_frame,
+    },
+};
+
+static const AVFilterPad cudapad_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = cudapad_config_props,
+    },
+};
+
+const AVFilter ff_vf_pad_cuda = {
+    .name        = "pad_cuda",
+    .description = NULL_IF_CONFIG_SMALL("GPU accelerated video padding"),
+
+    .uninit      = cudapad_uninit,
+
+    .priv_size   = sizeof(PadCUDAContext),
+    .priv_class  = &cudapad_class,
+
+    FILTER_INPUTS(cudapad_inputs),
+    FILTER_OUTPUTS(cudapad_outputs),
+
+    FILTER_SINGLE_PIXFMT(AV_PIX_FMT_CUDA),
+
+    .flags_internal = FF_FILTER_FLAG_HWFRAME_AWARE,
+};
@@ -0,0 +1,60 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "cuda/vector_helpers.cuh"
+
+/*
+ * Copies the source plane into the destination plane at (x, y), and fills
+ * the rest of the destination with color. Pitches are in pixels.
+ */
+template<typename T>
+__device__ static inline void pad(const T *src, int src_width, int src_height, int src_pitch,
+                                  T *dst, int dst_width, int dst_height, int dst_pitch,
+                                  int x, int y, T color)
+{
+    int xo = blockIdx.x * blockDim.x + threadIdx.x;
+    int yo = blockIdx.y * blockDim.y + threadIdx.y;
+    int xi = xo - x;
+    int yi = yo - y;
+
+    if (xo >= dst_width || yo >= dst_height)
+        return;
+
+    if (xi >= 0 && yi >= 0 && xi < src_width && yi < src_height)
+        dst[yo * dst_pitch + xo] = src[yi * src_pitch + xi];
+    else
+        dst[yo * dst_pitch + xo] = color;
+}
+
+extern "C" {
+
+#define PAD_KERNEL(T, C)                                                        \
+__global__ void Pad_ ## T(const T *src, int src_width, int src_height, int src_pitch, \
+                          T *dst, int dst_width, int dst_height, int dst_pitch, \
+                          int x, int y, int c0, int c1)                         \
+{                                                                               \
+    pad(src, src_width, src_height, src_pitch,                                  \
+        dst, dst_width, dst_height, dst_pitch, x, y, C);                        \
+}
+
+PAD_KERNEL(uchar,   (uchar)c0)
+PAD_KERNEL(uchar2,  make_uchar2(c0, c1))
+PAD_KERNEL(ushort,  (ushort)c0)
+PAD_KERNEL(ushort2, make_ushort2(c0, c1))
+
+}
@@ -37,7 +37,7 @@ typedef struct PPFilterContext {
     char *subfilters;
     int mode_id;
     pp_mode *modes[PP_QUALITY_MAX + 1];
-    void *pp_ctx;
+    void *pp_ctx[2];            ///< luma and chroma, so they can run in parallel
 } PPFilterContext;
 
 #define OFFSET(x) offsetof(PPFilterContext, x)
@@ -106,9 +106,41 @@ static int pp_config_props(AVFilterLink *inlink)
     default: av_assert0(0);
     }
 
-    pp->pp_ctx = pp_get_context(inlink->w, inlink->h, flags);
-    if (!pp->pp_ctx)
-        return AVERROR(ENOMEM);
+    for (int i = 0; i < FF_ARRAY_ELEMS(pp->pp_ctx); i++) {
+        pp->pp_ctx[i] = pp_get_context(inlink->w, inlink->h, flags);
+        if (!pp->pp_ctx[i])
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int8_t *qp_table;
+    int qstride;
+    int aligned_w;
+} ThreadData;
+
+static int pp_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PPFilterContext *pp = ctx->priv;
+    const ThreadData *td = arg;
+    const uint8_t *src[3] = { NULL };
+    uint8_t       *dst[3] = { NULL };
+
+    /* job 0 does luma, job 1 both chroma planes */
+    for (int i = 0; i < 3; i++) {
+        if (!i != !jobnr)
+            continue;
+        src[i] = td->in->data[i];
+        dst[i] = td->out->data[i];
+    }
+
+    pp_postprocess(src, td->in->linesize, dst, td->out->linesize,
+                   td->aligned_w, ctx->outputs[0]->h,
+                   td->qp_table, td->qstride,
+                   pp->modes[pp->mode_id], pp->pp_ctx[jobnr],
+                   td->out->pict_type | (td->qp_table ? PP_PICT_TYPE_QP2 : 0));
     return 0;
 }
 
@@ -120,6 +152,7 @@ static int pp_filter_frame(AVFilterLink *inlink, AVFrame *inbuf)
     const int aligned_w = FFALIGN(outlink->w, 8);
     const int aligned_h = FFALIGN(outlink->h, 8);
     AVFrame *outbuf;
+    ThreadData td;
     int qstride = 0;
     int8_t *qp_table = NULL;
     int ret;
@@ -140,14 +173,12 @@ static int pp_filter_frame(AVFilterLink *inlink, AVFrame *inbuf)
         return ret;
     }
 
-    pp_postprocess((const uint8_t **)inbuf->data, inbuf->linesize,
-                   outbuf->data,                 outbuf->linesize,
-                   aligned_w, outlink->h,
-                   qp_table,
-                   qstride,
-                   pp->modes[pp->mode_id],
-                   pp->pp_ctx,
-                   outbuf->pict_type | (qp_table ? PP_PICT_TYPE_QP2 : 0));
+    td.in        = inbuf;
+    td.out       = outbuf;
+    td.qp_table  = qp_table;
+    td.qstride   = qstride;
+    td.aligned_w = aligned_w;
+    ff_filter_execute(ctx, pp_slice, &td, NULL, FF_ARRAY_ELEMS(pp->pp_ctx));
 
     av_frame_free(&inbuf);
     av_freep(&qp_table);
@@ -161,8 +192,9 @@ static av_cold void pp_uninit(AVFilterContext *ctx)
 
     for (i = 0; i <= PP_QUALITY_MAX; i++)
         pp_free_mode(pp->modes[i]);
-    if (pp->pp_ctx)
-        pp_free_context(pp->pp_ctx);
+    for (i = 0; i < FF_ARRAY_ELEMS(pp->pp_ctx); i++)
+        if (pp->pp_ctx[i])
+            pp_free_context(pp->pp_ctx[i]);
 }
 
 static const AVFilterPad pp_inputs[] = {
@@ -192,5 +224,6 @@ const AVFilter ff_vf_pp = {
     FILTER_PIXFMTS_ARRAY(pix_fmts),
     .process_command = pp_process_command,
     .priv_class      = &pp_class,
-    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC |
+                       AVFILTER_FLAG_SLICE_THREADS,
 };
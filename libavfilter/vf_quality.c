@@ -0,0 +1,481 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Calculate the PSNR and the SSIM between two input videos in one pass.
+ *
+ * The per-frame values and the metadata keys are the same as the ones of the
+ * psnr and ssim filters.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/file_open.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "drawutils.h"
+#include "framesync.h"
+#include "internal.h"
+#include "psnr.h"
+#include "ssim.h"
+
+enum QualityMetric {
+    METRIC_PSNR = 1 << 0,
+    METRIC_SSIM = 1 << 1,
+};
+
+typedef struct QualityContext {
+    const AVClass *class;
+    FFFrameSync fs;
+    int metrics;
+    FILE *stats_file;
+    char *stats_file_str;
+    uint64_t nb_frames;
+    int nb_components;
+    int nb_threads;
+    int is_rgb;
+    uint8_t rgba_map[4];
+    char comps[4];
+    int depth;
+    int max[4], average_max;
+    int planewidth[4];
+    int planeheight[4];
+    double planeweight[4];
+
+    double mse, min_mse, max_mse, mse_comp[4];
+    double ssim[4], ssim_total;
+
+    uint64_t **sse;
+    double **ssim_score;
+    void **temp;
+
+    PSNRDSPContext psnr_dsp;
+    SSIMDSPContext ssim_dsp;
+} QualityContext;
+
+#define OFFSET(x) offsetof(QualityContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption quality_options[] = {
+    { "metrics", "set the metrics to compute", OFFSET(metrics), AV_OPT_TYPE_FLAGS, {.i64=METRIC_PSNR|METRIC_SSIM}, 1, METRIC_PSNR|METRIC_SSIM, FLAGS, "metrics" },
+        { "psnr", NULL, 0, AV_OPT_TYPE_CONST, {.i64=METRIC_PSNR}, 0, 0, FLAGS, "metrics" },
+        { "ssim", NULL, 0, AV_OPT_TYPE_CONST, {.i64=METRIC_SSIM}, 0, 0, FLAGS, "metrics" },
+    { "stats_file", "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "f",          "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { NULL }
+};
+
+FRAMESYNC_DEFINE_CLASS(quality, QualityContext, fs);
+
+static inline unsigned pow_2(unsigned base)
+{
+    return base*base;
+}
+
+static inline double get_psnr(double mse, uint64_t nb_frames, int max)
+{
+    return 10.0 * log10(pow_2(max) / (mse / nb_frames));
+}
+
+static double ssim_db(double ssim, double weight)
+{
+    return (fabs(weight - ssim) > 1e-9) ? 10.0 * log10(weight / (weight - ssim)) : INFINITY;
+}
+
+static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
+{
+    char value[128];
+    snprintf(value, sizeof(value), "%f", d);
+    if (comp) {
+        char key2[128];
+        snprintf(key2, sizeof(key2), "%s%c", key, comp);
+        av_dict_set(metadata, key2, value, 0);
+    } else {
+        av_dict_set(metadata, key, value, 0);
+    }
+}
+
+typedef struct ThreadData {
+    const AVFrame *main;
+    const AVFrame *ref;
+} ThreadData;
+
+static int compute_metrics(AVFilterContext *ctx, void *arg,
+                           int jobnr, int nb_jobs)
+{
+    QualityContext *s = ctx->priv;
+    ThreadData *td = arg;
+
+    for (int c = 0; c < s->nb_components; c++) {
+        const int width = s->planewidth[c];
+        const int height = s->planeheight[c];
+        const int main_linesize = td->main->linesize[c];
+        const int ref_linesize = td->ref->linesize[c];
+        const uint8_t *main_data = td->main->data[c];
+        const uint8_t *ref_data = td->ref->data[c];
+        /* the jobs work on rows of 4x4 blocks, and the last one takes
+         * the lines below the last full block row as well */
+        const int slice_start = ((height >> 2) * jobnr) / nb_jobs;
+        const int slice_end = ((height >> 2) * (jobnr+1)) / nb_jobs;
+        const int line_end = jobnr == nb_jobs - 1 ? height : 4 * slice_end;
+
+        if (s->metrics & METRIC_PSNR) {
+            const uint8_t *main_line = main_data + main_linesize * 4 * slice_start;
+            const uint8_t *ref_line = ref_data + ref_linesize * 4 * slice_start;
+            uint64_t m = 0;
+
+            for (int i = 4 * slice_start; i < line_end; i++) {
+                m += s->psnr_dsp.sse_line(main_line, ref_line, width);
+                main_line += main_linesize;
+                ref_line += ref_linesize;
+            }
+            s->sse[jobnr][c] = m;
+        }
+
+        if (s->metrics & METRIC_SSIM) {
+            s->ssim_score[jobnr][c] = s->depth > 8 ?
+                ff_ssim_plane_16bit(main_data, main_linesize, ref_data, ref_linesize,
+                                    width, slice_start, slice_end,
+                                    s->temp[jobnr], s->max[0]) :
+                ff_ssim_plane(&s->ssim_dsp, main_data, main_linesize,
+                              ref_data, ref_linesize, width,
+                              slice_start, slice_end, s->temp[jobnr]);
+        }
+    }
+
+    return 0;
+}
+
+static int do_quality(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    QualityContext *s = ctx->priv;
+    AVFrame *master, *ref;
+    AVDictionary **metadata;
+    double comp_mse[4], mse = 0.;
+    double comp_ssim[4] = { 0 }, ssimv = 0.;
+    uint64_t comp_sum[4] = { 0 };
+    ThreadData td;
+    int nb_jobs, ret;
+
+    ret = ff_framesync_dualinput_get(fs, &master, &ref);
+    if (ret < 0)
+        return ret;
+    if (ctx->is_disabled || !ref)
+        return ff_filter_frame(ctx->outputs[0], master);
+    metadata = &master->metadata;
+
+    td.main = master;
+    td.ref = ref;
+    nb_jobs = FFMIN((s->planeheight[1] + 3) >> 2, s->nb_threads);
+    ff_filter_execute(ctx, compute_metrics, &td, NULL, nb_jobs);
+
+    s->nb_frames++;
+
+    if (s->stats_file)
+        fprintf(s->stats_file, "n:%"PRId64" ", s->nb_frames);
+
+    if (s->metrics & METRIC_PSNR) {
+        for (int j = 0; j < nb_jobs; j++)
+            for (int c = 0; c < s->nb_components; c++)
+                comp_sum[c] += s->sse[j][c];
+
+        for (int c = 0; c < s->nb_components; c++) {
+            comp_mse[c] = comp_sum[c] / ((double)s->planewidth[c] * s->planeheight[c]);
+            mse += comp_mse[c] * s->planeweight[c];
+            s->mse_comp[c] += comp_mse[c];
+        }
+        s->min_mse = FFMIN(s->min_mse, mse);
+        s->max_mse = FFMAX(s->max_mse, mse);
+        s->mse += mse;
+
+        for (int j = 0; j < s->nb_components; j++) {
+            int c = s->is_rgb ? s->rgba_map[j] : j;
+            set_meta(metadata, "lavfi.psnr.mse.", s->comps[j], comp_mse[c]);
+            set_meta(metadata, "lavfi.psnr.psnr.", s->comps[j], get_psnr(comp_mse[c], 1, s->max[c]));
+        }
+        set_meta(metadata, "lavfi.psnr.mse_avg", 0, mse);
+        set_meta(metadata, "lavfi.psnr.psnr_avg", 0, get_psnr(mse, 1, s->average_max));
+
+        if (s->stats_file) {
+            fprintf(s->stats_file, "mse_avg:%0.2f ", mse);
+            for (int j = 0; j < s->nb_components; j++) {
+                int c = s->is_rgb ? s->rgba_map[j] : j;
+                fprintf(s->stats_file, "mse_%c:%0.2f ", s->comps[j], comp_mse[c]);
+            }
+            fprintf(s->stats_file, "psnr_avg:%0.2f ", get_psnr(mse, 1, s->average_max));
+            for (int j = 0; j < s->nb_components; j++) {
+                int c = s->is_rgb ? s->rgba_map[j] : j;
+                fprintf(s->stats_file, "psnr_%c:%0.2f ", s->comps[j],
+                        get_psnr(comp_mse[c], 1, s->max[c]));
+            }
+        }
+    }
+
+    if (s->metrics & METRIC_SSIM) {
+        for (int c = 0; c < s->nb_components; c++) {
+            for (int j = 0; j < nb_jobs; j++)
+                comp_ssim[c] += s->ssim_score[j][c];
+            comp_ssim[c] = comp_ssim[c] / (((s->planewidth[c] >> 2) - 1) * ((s->planeheight[c] >> 2) - 1));
+            ssimv += s->planeweight[c] * comp_ssim[c];
+            s->ssim[c] += comp_ssim[c];
+        }
+        s->ssim_total += ssimv;
+
+        for (int j = 0; j < s->nb_components; j++) {
+            int c = s->is_rgb ? s->rgba_map[j] : j;
+            set_meta(metadata, "lavfi.ssim.", av_toupper(s->comps[j]), comp_ssim[c]);
+        }
+        set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
+        set_meta(metadata, "lavfi.ssim.dB", 0, ssim_db(ssimv, 1.0));
+
+        if (s->stats_file) {
+            for (int j = 0; j < s->nb_components; j++) {
+                int c = s->is_rgb ? s->rgba_map[j] : j;
+                fprintf(s->stats_file, "ssim_%c:%f ", s->comps[j], comp_ssim[c]);
+            }
+            fprintf(s->stats_file, "ssim_all:%f ssim_db:%f ", ssimv, ssim_db(ssimv, 1.0));
+        }
+    }
+
+    if (s->stats_file)
+        fprintf(s->stats_file, "\n");
+
+    return ff_filter_frame(ctx->outputs[0], master);
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    QualityContext *s = ctx->priv;
+
+    s->min_mse = +INFINITY;
+    s->max_mse = -INFINITY;
+
+    if (s->stats_file_str) {
+        if (!strcmp(s->stats_file_str, "-")) {
+            s->stats_file = stdout;
+        } else {
+            s->stats_file = avpriv_fopen_utf8(s->stats_file_str, "w");
+            if (!s->stats_file) {
+                int err = AVERROR(errno);
+                char buf[128];
+                av_strerror(err, buf, sizeof(buf));
+                av_log(ctx, AV_LOG_ERROR, "Could not open stats file %s: %s\n",
+                       s->stats_file_str, buf);
+                return err;
+            }
+        }
+    }
+
+    s->fs.on_event = do_quality;
+    return 0;
+}
+
+static const enum AVPixelFormat pix_fmts[] = {
+    AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY9, AV_PIX_FMT_GRAY10,
+    AV_PIX_FMT_GRAY12, AV_PIX_FMT_GRAY14, AV_PIX_FMT_GRAY16,
+    AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+    AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+    AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
+    AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVJ444P,
+    AV_PIX_FMT_GBRP,
+#define PF(suf) AV_PIX_FMT_YUV420##suf,  AV_PIX_FMT_YUV422##suf,  AV_PIX_FMT_YUV444##suf, AV_PIX_FMT_GBR##suf
+    PF(P9), PF(P10), PF(P12), PF(P14), PF(P16),
+    AV_PIX_FMT_NONE
+};
+
+static int config_input_ref(AVFilterLink *inlink)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    AVFilterContext *ctx  = inlink->dst;
+    QualityContext *s = ctx->priv;
+    double average_max = 0;
+    unsigned sum = 0;
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->nb_components = desc->nb_components;
+    if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
+        ctx->inputs[0]->h != ctx->inputs[1]->h) {
+        av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->depth = desc->comp[0].depth;
+    for (int j = 0; j < 4; j++)
+        s->max[j] = (1 << desc->comp[j].depth) - 1;
+    s->is_rgb = ff_fill_rgba_map(s->rgba_map, inlink->format) >= 0;
+    s->comps[0] = s->is_rgb ? 'r' : 'y' ;
+    s->comps[1] = s->is_rgb ? 'g' : 'u' ;
+    s->comps[2] = s->is_rgb ? 'b' : 'v' ;
+    s->comps[3] = 'a';
+
+    s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
+    s->planeheight[0] = s->planeheight[3] = inlink->h;
+    s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
+    s->planewidth[0]  = s->planewidth[3]  = inlink->w;
+    for (int j = 0; j < s->nb_components; j++)
+        sum += s->planeheight[j] * s->planewidth[j];
+    for (int j = 0; j < s->nb_components; j++) {
+        s->planeweight[j] = (double) s->planeheight[j] * s->planewidth[j] / sum;
+        average_max += s->max[j] * s->planeweight[j];
+    }
+    s->average_max = lrint(average_max);
+
+    ff_psnr_init(&s->psnr_dsp, s->depth);
+    ff_ssim_init(&s->ssim_dsp);
+
+    s->sse = av_calloc(s->nb_threads, sizeof(*s->sse));
+    s->ssim_score = av_calloc(s->nb_threads, sizeof(*s->ssim_score));
+    s->temp = av_calloc(s->nb_threads, sizeof(*s->temp));
+    if (!s->sse || !s->ssim_score || !s->temp)
+        return AVERROR(ENOMEM);
+
+    for (int t = 0; t < s->nb_threads; t++) {
+        s->sse[t] = av_calloc(s->nb_components, sizeof(*s->sse[0]));
+        s->ssim_score[t] = av_calloc(s->nb_components, sizeof(*s->ssim_score[0]));
+        s->temp[t] = av_calloc(2 * SSIM_SUM_LEN(inlink->w),
+                               s->depth > 8 ? sizeof(int64_t[4]) : sizeof(int[4]));
+        if (!s->sse[t] || !s->ssim_score[t] || !s->temp[t])
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    QualityContext *s = ctx->priv;
+    AVFilterLink *mainlink = ctx->inputs[0];
+    int ret;
+
+    ret = ff_framesync_init_dualinput(&s->fs, ctx);
+    if (ret < 0)
+        return ret;
+    outlink->w = mainlink->w;
+    outlink->h = mainlink->h;
+    outlink->time_base = mainlink->time_base;
+    outlink->sample_aspect_ratio = mainlink->sample_aspect_ratio;
+    outlink->frame_rate = mainlink->frame_rate;
+    if ((ret = ff_framesync_configure(&s->fs)) < 0)
+        return ret;
+
+    outlink->time_base = s->fs.time_base;
+
+    if (av_cmp_q(mainlink->time_base, outlink->time_base) ||
+        av_cmp_q(ctx->inputs[1]->time_base, outlink->time_base))
+        av_log(ctx, AV_LOG_WARNING, "not matching timebases found between first input: %d/%d and second input %d/%d, results may be incorrect!\n",
+               mainlink->time_base.num, mainlink->time_base.den,
+               ctx->inputs[1]->time_base.num, ctx->inputs[1]->time_base.den);
+
+    return 0;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    QualityContext *s = ctx->priv;
+    return ff_framesync_activate(&s->fs);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    QualityContext *s = ctx->priv;
+
+    if (s->nb_frames > 0 && (s->metrics & METRIC_PSNR)) {
+        char buf[256];
+
+        buf[0] = 0;
+        for (int j = 0; j < s->nb_components; j++) {
+            int c = s->is_rgb ? s->rgba_map[j] : j;
+            av_strlcatf(buf, sizeof(buf), " %c:%f", s->comps[j],
+                        get_psnr(s->mse_comp[c], s->nb_frames, s->max[c]));
+        }
+        av_log(ctx, AV_LOG_INFO, "PSNR%s average:%f min:%f max:%f\n",
+               buf,
+               get_psnr(s->mse, s->nb_frames, s->average_max),
+               get_psnr(s->max_mse, 1, s->average_max),
+               get_psnr(s->min_mse, 1, s->average_max));
+    }
+
+    if (s->nb_frames > 0 && (s->metrics & METRIC_SSIM)) {
+        char buf[256];
+
+        buf[0] = 0;
+        for (int j = 0; j < s->nb_components; j++) {
+            int c = s->is_rgb ? s->rgba_map[j] : j;
+            av_strlcatf(buf, sizeof(buf), " %c:%f (%f)", av_toupper(s->comps[j]),
+                        s->ssim[c] / s->nb_frames, ssim_db(s->ssim[c], s->nb_frames));
+        }
+        av_log(ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
+               s->ssim_total / s->nb_frames, ssim_db(s->ssim_total, s->nb_frames));
+    }
+
+    ff_framesync_uninit(&s->fs);
+
+    for (int t = 0; t < s->nb_threads; t++) {
+        if (s->sse)
+            av_freep(&s->sse[t]);
+        if (s->ssim_score)
+            av_freep(&s->ssim_score[t]);
+        if (s->temp)
+            av_freep(&s->temp[t]);
+    }
+    av_freep(&s->sse);
+    av_freep(&s->ssim_score);
+    av_freep(&s->temp);
+
+    if (s->stats_file && s->stats_file != stdout)
+        fclose(s->stats_file);
+}
+
+static const AVFilterPad quality_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },{
+        .name         = "reference",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input_ref,
+    },
+};
+
+static const AVFilterPad quality_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+};
+
+const AVFilter ff_vf_quality = {
+    .name          = "quality",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the PSNR and SSIM between two video streams."),
+    .preinit       = quality_framesync_preinit,
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    .priv_size     = sizeof(QualityContext),
+    .priv_class    = &quality_class,
+    FILTER_INPUTS(quality_inputs),
+    FILTER_OUTPUTS(quality_outputs),
+    FILTER_PIXFMTS_ARRAY(pix_fmts),
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS             |
+                     AVFILTER_FLAG_METADATA_ONLY,
+};
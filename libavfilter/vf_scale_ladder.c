@@ -0,0 +1,305 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale video to several sizes at once, each output being scaled from the
+ * previous one
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct ScaleLadderContext {
+    const AVClass *class;
+
+    char *sizes_str;
+    char *flags_str;
+
+    int nb_sizes;
+    int (*sizes)[2];
+    struct SwsContext **sws;
+    AVFrame **frames;
+} ScaleLadderContext;
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    int ret;
+
+    /* every output is the input of the next scaler, so they must all have
+     * the same format */
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+        if (sws_isSupportedInput(pix_fmt) && sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+
+    return ff_set_common_formats(ctx, formats);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    ScaleLadderContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const int idx  = FF_OUTLINK_IDX(outlink);
+    const int srcw = idx ? s->sizes[idx - 1][0] : inlink->w;
+    const int srch = idx ? s->sizes[idx - 1][1] : inlink->h;
+    struct SwsContext *sws;
+    int flags = 0, ret;
+
+    outlink->w = s->sizes[idx][0];
+    outlink->h = s->sizes[idx][1];
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    if (s->flags_str && *s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        ret = av_opt_eval_flags(&class, o, s->flags_str, &flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    sws_freeContext(s->sws[idx]);
+    s->sws[idx] = sws = sws_alloc_context();
+    if (!sws)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(sws, "srcw",       srcw,           0);
+    av_opt_set_int(sws, "srch",       srch,           0);
+    av_opt_set_int(sws, "src_format", inlink->format, 0);
+    av_opt_set_int(sws, "dstw",       outlink->w,     0);
+    av_opt_set_int(sws, "dsth",       outlink->h,     0);
+    av_opt_set_int(sws, "dst_format", inlink->format, 0);
+    av_opt_set_int(sws, "sws_flags",  flags,          0);
+
+    ret = sws_init_context(sws, NULL, NULL);
+    if (ret < 0)
+        return ret;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: w:%d h:%d -> w:%d h:%d fmt:%s\n",
+           idx, srcw, srch, outlink->w, outlink->h,
+           av_get_pix_fmt_name(inlink->format));
+
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    ScaleLadderContext *s = ctx->priv;
+    const char *p = s->sizes_str;
+    int ret;
+
+    while (p && *p) {
+        char *size = av_get_token(&p, "|");
+        int w, h;
+
+        if (!size)
+            return AVERROR(ENOMEM);
+        ret = av_parse_video_size(&w, &h, size);
+        if (ret < 0)
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", size);
+        av_free(size);
+        if (ret < 0)
+            return ret;
+
+        ret = av_dynarray2_add((void **)&s->sizes, &s->nb_sizes,
+                               sizeof(*s->sizes), NULL) ? 0 : AVERROR(ENOMEM);
+        if (ret < 0)
+            return ret;
+        s->sizes[s->nb_sizes - 1][0] = w;
+        s->sizes[s->nb_sizes - 1][1] = h;
+
+        if (*p)
+            p++;
+    }
+    if (!s->nb_sizes) {
+        av_log(ctx, AV_LOG_ERROR, "No output size given\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->sws    = av_calloc(s->nb_sizes, sizeof(*s->sws));
+    s->frames = av_calloc(s->nb_sizes, sizeof(*s->frames));
+    if (!s->sws || !s->frames)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < s->nb_sizes; i++) {
+        AVFilterPad pad = {
+            .type         = AVMEDIA_TYPE_VIDEO,
+            .name         = av_asprintf("output%d", i),
+            .config_props = config_output,
+        };
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+
+        if ((ret = ff_append_outpad_free_name(ctx, &pad)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    ScaleLadderContext *s = ctx->priv;
+
+    for (int i = 0; s->sws && i < s->nb_sizes; i++)
+        sws_freeContext(s->sws[i]);
+    av_freep(&s->sws);
+    av_freep(&s->frames);
+    av_freep(&s->sizes);
+}
+
+static int filter_frame(AVFilterContext *ctx, AVFrame *in)
+{
+    ScaleLadderContext *s = ctx->priv;
+    int ret = 0;
+
+    for (int i = 0; i < s->nb_sizes; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        s->frames[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!s->frames[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ret = av_frame_copy_props(s->frames[i], in);
+        if (ret < 0)
+            goto fail;
+        s->frames[i]->width  = outlink->w;
+        s->frames[i]->height = outlink->h;
+        s->frames[i]->sample_aspect_ratio = outlink->sample_aspect_ratio;
+    }
+
+    ret = sws_scale_frame_ladder(s->sws, s->frames, s->nb_sizes, in);
+    if (ret < 0)
+        goto fail;
+    av_frame_free(&in);
+
+    for (int i = 0; i < s->nb_sizes; i++) {
+        AVFrame *out = s->frames[i];
+
+        /* closed outputs are still computed, the next ones depend on them */
+        s->frames[i] = NULL;
+        if (ff_outlink_get_status(ctx->outputs[i])) {
+            av_frame_free(&out);
+            continue;
+        }
+        ret = ff_filter_frame(ctx->outputs[i], out);
+        if (ret < 0)
+            goto fail;
+    }
+
+    return 0;
+
+fail:
+    for (int i = 0; i < s->nb_sizes; i++)
+        av_frame_free(&s->frames[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *in;
+    int status, ret;
+    int64_t pts;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        FF_FILTER_FORWARD_STATUS_BACK_ALL(ctx->outputs[i], ctx);
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0)
+        return filter_frame(ctx, in);
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        if (ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+
+        if (ff_outlink_frame_wanted(ctx->outputs[i])) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+#define OFFSET(x) offsetof(ScaleLadderContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption scale_ladder_options[] = {
+    { "sizes", "'|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL }, .flags = FLAGS },
+    { "flags", "Flags to pass to libswscale",         OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "" },   .flags = FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(scale_ladder);
+
+static const AVFilterPad scale_ladder_inputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+};
+
+const AVFilter ff_vf_scale_ladder = {
+    .name            = "scale_ladder",
+    .description     = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes, each from the previous one."),
+    .priv_size       = sizeof(ScaleLadderContext),
+    .priv_class      = &scale_ladder_class,
+    .init            = init,
+    .uninit          = uninit,
+    .activate        = activate,
+    FILTER_INPUTS(scale_ladder_inputs),
+    .outputs         = NULL,
+    FILTER_QUERY_FUNC(query_formats),
+    .flags           = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
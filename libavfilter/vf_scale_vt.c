@@ -0,0 +1,225 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Scaling and pixel format conversion of VideoToolbox frames, using
+ * VTPixelTransferSession so that the frames never leave the GPU.
+ */
+
+#include <VideoToolbox/VideoToolbox.h>
+
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_videotoolbox.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "internal.h"
+#include "scale_eval.h"
+#include "video.h"
+
+typedef struct ScaleVtContext {
+    const AVClass *class;
+
+    VTPixelTransferSessionRef transfer;
+
+    char *w_expr;
+    char *h_expr;
+    enum AVPixelFormat format;
+} ScaleVtContext;
+
+static av_cold int scale_vt_init(AVFilterContext *avctx)
+{
+    ScaleVtContext *s = avctx->priv;
+    OSStatus ret;
+
+    ret = VTPixelTransferSessionCreate(kCFAllocatorDefault, &s->transfer);
+    if (ret != noErr) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create transfer session: %d\n", (int)ret);
+        return AVERROR_EXTERNAL;
+    }
+
+    return 0;
+}
+
+static av_cold void scale_vt_uninit(AVFilterContext *avctx)
+{
+    ScaleVtContext *s = avctx->priv;
+
+    if (s->transfer) {
+        VTPixelTransferSessionInvalidate(s->transfer);
+        CFRelease(s->transfer);
+        s->transfer = NULL;
+    }
+}
+
+static int scale_vt_config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *avctx = outlink->src;
+    AVFilterLink *inlink   = avctx->inputs[0];
+    ScaleVtContext *s      = avctx->priv;
+    AVHWFramesContext *in_frames, *out_frames;
+    int w, h, err;
+
+    if (!inlink->hw_frames_ctx) {
+        av_log(avctx, AV_LOG_ERROR, "A hardware frames reference is "
+               "required to associate the processing device.\n");
+        return AVERROR(EINVAL);
+    }
+    in_frames = (AVHWFramesContext *)inlink->hw_frames_ctx->data;
+
+    err = ff_scale_eval_dimensions(avctx, s->w_expr, s->h_expr,
+                                   inlink, outlink, &w, &h);
+    if (err < 0)
+        return err;
+    ff_scale_adjust_dimensions(inlink, &w, &h, 0, 1);
+
+    outlink->w = w;
+    outlink->h = h;
+
+    if (inlink->sample_aspect_ratio.num) {
+        AVRational r = { outlink->h * inlink->w, outlink->w * inlink->h };
+        outlink->sample_aspect_ratio = av_mul_q(r, inlink->sample_aspect_ratio);
+    } else {
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+    }
+
+    av_buffer_unref(&outlink->hw_frames_ctx);
+    outlink->hw_frames_ctx = av_hwframe_ctx_alloc(in_frames->device_ref);
+    if (!outlink->hw_frames_ctx)
+        return AVERROR(ENOMEM);
+
+    out_frames = (AVHWFramesContext *)outlink->hw_frames_ctx->data;
+    out_frames->format    = AV_PIX_FMT_VIDEOTOOLBOX;
+    out_frames->sw_format = s->format == AV_PIX_FMT_NONE ? in_frames->sw_format
+                                                         : s->format;
+    out_frames->width     = outlink->w;
+    out_frames->height    = outlink->h;
+
+    err = ff_filter_init_hw_frames(avctx, outlink, 1);
+    if (err < 0)
+        return err;
+
+    err = av_hwframe_ctx_init(outlink->hw_frames_ctx);
+    if (err < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to initialise VideoToolbox frame "
+               "context for output: %d\n", err);
+        return err;
+    }
+
+    av_log(avctx, AV_LOG_VERBOSE, "w:%d h:%d fmt:%s -> w:%d h:%d fmt:%s\n",
+           inlink->w, inlink->h, av_get_pix_fmt_name(in_frames->sw_format),
+           outlink->w, outlink->h, av_get_pix_fmt_name(out_frames->sw_format));
+
+    return 0;
+}
+
+static int scale_vt_filter_frame(AVFilterLink *link, AVFrame *in)
+{
+    AVFilterContext *avctx = link->dst;
+    AVFilterLink *outlink  = avctx->outputs[0];
+    ScaleVtContext *s      = avctx->priv;
+    CVPixelBufferRef src, dst;
+    AVFrame *out;
+    OSStatus status;
+    int ret;
+
+    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!out) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    ret = av_frame_copy_props(out, in);
+    if (ret < 0)
+        goto fail;
+
+    av_reduce(&out->sample_aspect_ratio.num, &out->sample_aspect_ratio.den,
+              (int64_t)in->sample_aspect_ratio.num * outlink->h * link->w,
+              (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
+              INT_MAX);
+
+    src = (CVPixelBufferRef)in->data[3];
+    dst = (CVPixelBufferRef)out->data[3];
+
+    /* The transfer session converts between the color properties attached
+     * to the two buffers, so make sure the output ones are set. */
+    ret = av_vt_pixbuf_set_attachments(avctx, dst, out);
+    if (ret < 0)
+        goto fail;
+
+    status = VTPixelTransferSessionTransferImage(s->transfer, src, dst);
+    if (status != noErr) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to transfer image: %d\n", (int)status);
+        ret = AVERROR_EXTERNAL;
+        goto fail;
+    }
+
+    av_frame_free(&in);
+
+    return ff_filter_frame(outlink, out);
+
+fail:
+    av_frame_free(&in);
+    av_frame_free(&out);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(ScaleVtContext, x)
+#define FLAGS (AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_VIDEO_PARAM)
+static const AVOption scale_vt_options[] = {
+    { "w", "Output video width",
+      OFFSET(w_expr), AV_OPT_TYPE_STRING, { .str = "iw" }, .flags = FLAGS },
+    { "h", "Output video height",
+      OFFSET(h_expr), AV_OPT_TYPE_STRING, { .str = "ih" }, .flags = FLAGS },
+    { "format", "Output video format (software format of hardware frames)",
+      OFFSET(format), AV_OPT_TYPE_PIXEL_FMT, { .i64 = AV_PIX_FMT_NONE }, AV_PIX_FMT_NONE, INT_MAX, .flags = FLAGS },
+    { NULL },
+};
+
+AVFILTER_DEFINE_CLASS(scale_vt);
+
+static const AVFilterPad scale_vt_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = &scale_vt_filter_frame,
+    },
+};
+
+static const AVFilterPad scale_vt_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = &scale_vt_config_output,
+    },
+};
+
+const AVFilter ff_vf_scale_vt = {
+    .name           = "scale_vt",
+    .description    = NULL_IF_CONFIG_SMALL("Scale and convert VideoToolbox frames"),
+    .priv_size      = sizeof(ScaleVtContext),
+    .init           = scale_vt_init,
+    .uninit         = scale_vt_uninit,
+    FILTER_INPUTS(scale_vt_inputs),
+    FILTER_OUTPUTS(scale_vt_outputs),
+    FILTER_SINGLE_PIXFMT(AV_PIX_FMT_VIDEOTOOLBOX),
+    .priv_class     = &scale_vt_class,
+    .flags          = AVFILTER_FLAG_HWDEVICE,
+    .flags_internal = FF_FILTER_FLAG_HWFRAME_AWARE,
+};
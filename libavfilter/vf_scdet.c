@@ -43,6 +43,8 @@ typedef struct SCDetContext {
     AVFrame *prev_picref;
     double threshold;
     int sc_pass;
+    int keyframe;
+    int step;
 } SCDetContext;
 
 #define OFFSET(x) offsetof(SCDetContext, x)
@@ -54,6 +56,9 @@ static const AVOption scdet_options[] = {
     { "t",           "set scene change detect threshold",        OFFSET(threshold),  AV_OPT_TYPE_DOUBLE,   {.dbl = 10.},     0,  100., V|F },
     { "sc_pass",     "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
     { "s",           "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
+    { "keyframe",    "Mark scene change frames as key frames",   OFFSET(keyframe),   AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
+    { "k",           "Mark scene change frames as key frames",   OFFSET(keyframe),   AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
+    { "step",        "Set the line analysis step",               OFFSET(step),       AV_OPT_TYPE_INT,      {.i64 =  1  },    1,   64,  V|F },
     {NULL}
 };
 
@@ -117,12 +122,13 @@ static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
         uint64_t count = 0;
 
         for (int plane = 0; plane < s->nb_planes; plane++) {
+            const ptrdiff_t lines = (s->height[plane] + s->step - 1) / s->step;
             uint64_t plane_sad;
-            s->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    s->width[plane], s->height[plane], &plane_sad);
+            s->sad(prev_picref->data[plane], prev_picref->linesize[plane] * s->step,
+                    frame->data[plane], frame->linesize[plane] * s->step,
+                    s->width[plane], lines, &plane_sad);
             sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
+            count += s->width[plane] * lines;
         }
 
         emms_c();
@@ -168,6 +174,11 @@ static int activate(AVFilterContext *ctx)
                     s->scene_score, av_ts2timestr(frame->pts, &inlink->time_base));
             set_meta(s, frame, "lavfi.scd.time",
                     av_ts2timestr(frame->pts, &inlink->time_base));
+            /* lets encoders start a new GOP at the cut */
+            if (s->keyframe) {
+                frame->key_frame = 1;
+                frame->pict_type = AV_PICTURE_TYPE_I;
+            }
         }
         if (s->sc_pass) {
             if (s->scene_score > s->threshold)
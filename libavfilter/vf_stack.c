@@ -21,6 +21,7 @@
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
@@ -37,6 +38,10 @@ typedef struct StackItem {
     int x[4], y[4];
     int linesize[4];
     int height[4];
+    int w, h;
+    int direct;     ///< the input may render into the output frame
+    int given;      ///< the area of the pending frame was handed to the input
+    int in_place;   ///< the current input frame already is in the output frame
 } StackItem;
 
 typedef struct StackContext {
@@ -53,12 +58,14 @@ typedef struct StackContext {
     uint8_t fillcolor[4];
     char *fillcolor_str;
     int fillcolor_enable;
+    int direct;
 
     FFDrawContext draw;
     FFDrawColor color;
 
     StackItem *items;
     AVFrame **frames;
+    AVFrame *pending;   ///< output frame the inputs render into
     FFFrameSync fs;
 } StackContext;
 
@@ -76,6 +83,50 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_formats(ctx, ff_formats_pixdesc_filter(0, reject_flags));
 }
 
+static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h)
+{
+    AVFilterContext *ctx = inlink->dst;
+    AVFilterLink *outlink = ctx->outputs[0];
+    StackContext *s = ctx->priv;
+    StackItem *item = &s->items[FF_INLINK_IDX(inlink)];
+    AVFrame *frame;
+
+    if (!item->direct || item->given || w != item->w || h != item->h)
+        return NULL;
+
+    if (!s->pending) {
+        s->pending = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!s->pending)
+            return NULL;
+        if (s->fillcolor_enable)
+            ff_fill_rectangle(&s->draw, &s->color, s->pending->data, s->pending->linesize,
+                              0, 0, outlink->w, outlink->h);
+    }
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        const uint8_t *dst = s->pending->data[p] + s->pending->linesize[p] * item->y[p] + item->x[p];
+
+        if ((uintptr_t)dst % av_cpu_max_align())
+            return NULL;
+    }
+
+    frame = av_frame_alloc();
+    if (!frame || av_frame_ref(frame, s->pending) < 0) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+
+    frame->width  = w;
+    frame->height = h;
+    frame->sample_aspect_ratio = inlink->sample_aspect_ratio;
+    for (int p = 0; p < s->nb_planes; p++)
+        frame->data[p] += frame->linesize[p] * item->y[p] + item->x[p];
+
+    item->given = 1;
+
+    return frame;
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     StackContext *s = ctx->priv;
@@ -127,6 +178,8 @@ static av_cold int init(AVFilterContext *ctx)
         AVFilterPad pad = { 0 };
 
         pad.type = AVMEDIA_TYPE_VIDEO;
+        if (s->direct)
+            pad.get_buffer.video = get_video_buffer;
         pad.name = av_asprintf("input%d", i);
         if (!pad.name)
             return AVERROR(ENOMEM);
@@ -149,6 +202,9 @@ static int process_slice(AVFilterContext *ctx, void *arg, int job, int nb_jobs)
     for (int i = start; i < end; i++) {
         StackItem *item = &s->items[i];
 
+        if (item->in_place)
+            continue;
+
         for (int p = 0; p < s->nb_planes; p++) {
             av_image_copy_plane(out->data[p] + out->linesize[p] * item->y[p] + item->x[p],
                                 out->linesize[p],
@@ -170,21 +226,56 @@ static int process_frame(FFFrameSync *fs)
     AVFrame *out;
     int i, ret;
 
+    int use_pending = !!s->pending;
+
     for (i = 0; i < s->nb_inputs; i++) {
         if ((ret = ff_framesync_get_frame(&s->fs, i, &in[i], 0)) < 0)
             return ret;
     }
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-    if (!out)
-        return AVERROR(ENOMEM);
+    /* the pending frame can be output if every area handed out holds the
+     * current frame of its input, otherwise a queued frame lives there */
+    for (i = 0; i < s->nb_inputs; i++) {
+        StackItem *item = &s->items[i];
+
+        item->in_place = 0;
+        if (!s->pending || !item->given)
+            continue;
+
+        item->in_place = 1;
+        for (int p = 0; p < s->nb_planes; p++) {
+            if (in[i]->data[p] != s->pending->data[p] + s->pending->linesize[p] * item->y[p] + item->x[p] ||
+                in[i]->linesize[p] != s->pending->linesize[p])
+                item->in_place = 0;
+        }
+        if (!item->in_place)
+            use_pending = 0;
+    }
+
+    if (use_pending) {
+        out = s->pending;
+        s->pending = NULL;
+    } else {
+        for (i = 0; i < s->nb_inputs; i++)
+            s->items[i].in_place = 0;
+
+        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out)
+            return AVERROR(ENOMEM);
+
+        if (s->fillcolor_enable)
+            ff_fill_rectangle(&s->draw, &s->color, out->data, out->linesize,
+                              0, 0, outlink->w, outlink->h);
+    }
+
+    /* the areas handed out stay referenced by their frames */
+    av_frame_free(&s->pending);
+    for (i = 0; i < s->nb_inputs; i++)
+        s->items[i].given = 0;
+
     out->pts = av_rescale_q(s->fs.pts, s->fs.time_base, outlink->time_base);
     out->sample_aspect_ratio = outlink->sample_aspect_ratio;
 
-    if (s->fillcolor_enable)
-        ff_fill_rectangle(&s->draw, &s->color, out->data, out->linesize,
-                          0, 0, outlink->w, outlink->h);
-
     ff_filter_execute(ctx, process_slice, out, NULL,
                       FFMIN(s->nb_inputs, ff_filter_get_nb_threads(ctx)));
 
@@ -379,6 +470,27 @@ static int config_output(AVFilterLink *outlink)
 
     s->nb_planes = av_pix_fmt_count_planes(outlink->format);
 
+    for (i = 0; i < s->nb_inputs; i++) {
+        StackItem *item = &s->items[i];
+
+        item->w = ctx->inputs[i]->w;
+        item->h = ctx->inputs[i]->h;
+        item->direct = s->direct;
+    }
+
+    /* overlapping inputs are copied in order, they cannot render directly */
+    for (i = 0; i < s->nb_inputs && s->direct; i++) {
+        StackItem *a = &s->items[i];
+
+        for (int j = i + 1; j < s->nb_inputs; j++) {
+            StackItem *b = &s->items[j];
+
+            if (a->x[0] < b->x[0] + b->linesize[0] && b->x[0] < a->x[0] + a->linesize[0] &&
+                a->y[0] < b->y[0] + b->h && b->y[0] < a->y[0] + a->h)
+                a->direct = b->direct = 0;
+        }
+    }
+
     outlink->w          = width;
     outlink->h          = height;
     outlink->frame_rate = frame_rate;
@@ -422,6 +534,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     StackContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
+    av_frame_free(&s->pending);
     av_freep(&s->frames);
     av_freep(&s->items);
 }
@@ -437,6 +550,7 @@ static int activate(AVFilterContext *ctx)
 static const AVOption stack_options[] = {
     { "inputs", "set number of inputs", OFFSET(nb_inputs), AV_OPT_TYPE_INT, {.i64=2}, 2, INT_MAX, .flags = FLAGS },
     { "shortest", "force termination when the shortest input terminates", OFFSET(shortest), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
+    { "direct", "let the inputs render into the output frame", OFFSET(direct), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { NULL },
 };
 
@@ -492,6 +606,7 @@ static const AVOption xstack_options[] = {
     { "grid", "set fixed size grid layout", OFFSET(nb_grid_columns), AV_OPT_TYPE_IMAGE_SIZE, {.str=NULL}, 0, 0, .flags = FLAGS },
     { "shortest", "force termination when the shortest input terminates", OFFSET(shortest), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { "fill",  "set the color for unused pixels", OFFSET(fillcolor_str), AV_OPT_TYPE_STRING, {.str = "none"}, .flags = FLAGS },
+    { "direct", "let the inputs render into the output frame", OFFSET(direct), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { NULL },
 };
 
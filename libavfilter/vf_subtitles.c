@@ -61,6 +61,9 @@ typedef struct AssContext {
     int original_w, original_h;
     int shaping;
     FFDrawContext draw;
+    FFDrawColor *colors;        ///< colors of the images of the last render
+    unsigned int colors_size;
+    int nb_colors;
 } AssContext;
 
 #define OFFSET(x) offsetof(AssContext, x)
@@ -133,6 +136,7 @@ static av_cold void uninit(AVFilterContext *ctx)
         ass_renderer_done(ass->renderer);
     if (ass->library)
         ass_library_done(ass->library);
+    av_freep(&ass->colors);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -166,19 +170,38 @@ static int config_input(AVFilterLink *inlink)
 #define AB(c)  (((c)>>8) &0xFF)
 #define AA(c)  ((0xFF-(c)) &0xFF)
 
-static void overlay_ass_image(AssContext *ass, AVFrame *picref,
-                              const ASS_Image *image)
+typedef struct ThreadData {
+    AVFrame *frame;
+    const ASS_Image *image;
+} ThreadData;
+
+static int overlay_ass_image(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    for (; image; image = image->next) {
-        uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
-        FFDrawColor color;
-        ff_draw_color(&ass->draw, &color, rgba_color);
-        ff_blend_mask(&ass->draw, &color,
-                      picref->data, picref->linesize,
-                      picref->width, picref->height,
+    AssContext *ass = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *picref = td->frame;
+    /* bands start on a chroma line so the blending matches a single pass */
+    const int nb_lines = AV_CEIL_RSHIFT(picref->height, ass->draw.vsub_max);
+    const int y0 = FFMIN(((nb_lines *  jobnr     ) / nb_jobs) << ass->draw.vsub_max, picref->height);
+    const int y1 = FFMIN(((nb_lines * (jobnr + 1)) / nb_jobs) << ass->draw.vsub_max, picref->height);
+    const ASS_Image *image;
+    uint8_t *data[4] = { NULL };
+    int i = 0;
+
+    for (int p = 0; p < ass->draw.nb_planes; p++)
+        data[p] = picref->data[p] + (y0 >> ass->draw.vsub[p]) * picref->linesize[p];
+
+    for (image = td->image; image; image = image->next, i++) {
+        if (image->dst_y >= y1 || image->dst_y + image->h <= y0)
+            continue;
+        ff_blend_mask(&ass->draw, &ass->colors[i],
+                      data, picref->linesize,
+                      picref->width, y1 - y0,
                       image->bitmap, image->stride, image->w, image->h,
-                      3, 0, image->dst_x, image->dst_y);
+                      3, 0, image->dst_x, image->dst_y - y0);
     }
+
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
@@ -190,11 +213,38 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
     ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
                                         time_ms, &detect_change);
+    ThreadData td = { .frame = picref, .image = image };
+    int nb_images = 0;
+
+    if (!image)
+        return ff_filter_frame(outlink, picref);
 
     if (detect_change)
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
 
-    overlay_ass_image(ass, picref, image);
+    for (const ASS_Image *img = image; img; img = img->next)
+        nb_images++;
+
+    /* the images and their colors are the same until the render changes */
+    if (detect_change || nb_images != ass->nb_colors) {
+        int i = 0;
+
+        av_fast_malloc(&ass->colors, &ass->colors_size, nb_images * sizeof(*ass->colors));
+        if (!ass->colors) {
+            ass->nb_colors = 0;
+            av_frame_free(&picref);
+            return AVERROR(ENOMEM);
+        }
+        for (const ASS_Image *img = image; img; img = img->next, i++) {
+            uint8_t rgba_color[] = {AR(img->color), AG(img->color), AB(img->color), AA(img->color)};
+            ff_draw_color(&ass->draw, &ass->colors[i], rgba_color);
+        }
+        ass->nb_colors = nb_images;
+    }
+
+    ff_filter_execute(ctx, overlay_ass_image, &td, NULL,
+                      FFMIN(AV_CEIL_RSHIFT(picref->height, ass->draw.vsub_max),
+                            ff_filter_get_nb_threads(ctx)));
 
     return ff_filter_frame(outlink, picref);
 }
@@ -260,6 +310,7 @@ const AVFilter ff_vf_ass = {
     FILTER_OUTPUTS(ass_outputs),
     FILTER_QUERY_FUNC(query_formats),
     .priv_class    = &ass_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
 
@@ -500,5 +551,6 @@ const AVFilter ff_vf_subtitles = {
     FILTER_OUTPUTS(ass_outputs),
     FILTER_QUERY_FUNC(query_formats),
     .priv_class    = &subtitles_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
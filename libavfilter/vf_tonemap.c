@@ -31,6 +31,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 
@@ -38,6 +39,7 @@
 #include "colorspace.h"
 #include "formats.h"
 #include "internal.h"
+#include "tonemap.h"
 #include "video.h"
 
 enum TonemapAlgorithm {
@@ -58,8 +60,14 @@ typedef struct TonemapContext {
     double param;
     double desat;
     double peak;
+    int use_lut;
 
     const AVLumaCoefficients *coeffs;
+
+    float *lut;
+    double lut_peak;
+    TonemapLUTParams lut_params;
+    TonemapDSPContext dsp;
 } TonemapContext;
 
 static av_cold int init(AVFilterContext *ctx)
@@ -84,9 +92,18 @@ static av_cold int init(AVFilterContext *ctx)
     if (isnan(s->param))
         s->param = 1.0f;
 
+    ff_tonemap_dsp_init(&s->dsp);
+
     return 0;
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    TonemapContext *s = ctx->priv;
+
+    av_freep(&s->lut);
+}
+
 static float hable(float in)
 {
     float a = 0.15f, b = 0.50f, c = 0.10f, d = 0.20f, e = 0.02f, f = 0.30f;
@@ -106,7 +123,92 @@ static float mobius(float in, float j, double peak)
     return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
 }
 
+static float map_signal(const TonemapContext *s, float sig, double peak)
+{
+    switch(s->tonemap) {
+    default:
+    case TONEMAP_NONE:
+        // do nothing
+        break;
+    case TONEMAP_LINEAR:
+        sig = sig * s->param / peak;
+        break;
+    case TONEMAP_GAMMA:
+        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
+                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
+        break;
+    case TONEMAP_CLIP:
+        sig = av_clipf(sig * s->param, 0, 1.0f);
+        break;
+    case TONEMAP_HABLE:
+        sig = hable(sig) / hable(peak);
+        break;
+    case TONEMAP_REINHARD:
+        sig = sig / (sig + s->param) * (peak + s->param) / peak;
+        break;
+    case TONEMAP_MOBIUS:
+        sig = mobius(sig, s->param, peak);
+        break;
+    }
+
+    return sig;
+}
+
 #define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
+static void tonemap_lut_c(float *dst_r, float *dst_g, float *dst_b,
+                          const float *src_r, const float *src_g, const float *src_b,
+                          const float *lut, const TonemapLUTParams *p, int width)
+{
+    for (int x = 0; x < width; x++) {
+        float r = src_r[x], g = src_g[x], b = src_b[x];
+        float sig, pos, mapped;
+        int i;
+
+        if (p->desat > 0) {
+            float luma = p->coeffs[0] * r + p->coeffs[1] * g + p->coeffs[2] * b;
+            float overbright = FFMAX(luma - p->desat, 1e-6f) / FFMAX(luma, 1e-6f);
+            r = MIX(r, luma, overbright);
+            g = MIX(g, luma, overbright);
+            b = MIX(b, luma, overbright);
+        }
+
+        sig = FFMAX(FFMAX3(r, g, b), 1e-6f);
+        pos = FFMIN(sig * p->lut_scale, (float)TONEMAP_LUT_SIZE);
+        i   = FFMIN((int)pos, TONEMAP_LUT_SIZE - 1);
+        mapped = lut[i] + (lut[i + 1] - lut[i]) * (pos - i);
+
+        dst_r[x] = r * (mapped / sig);
+        dst_g[x] = g * (mapped / sig);
+        dst_b[x] = b * (mapped / sig);
+    }
+}
+
+void ff_tonemap_dsp_init(TonemapDSPContext *dsp)
+{
+    dsp->tonemap_lut = tonemap_lut_c;
+#if ARCH_X86
+    ff_tonemap_dsp_init_x86(dsp);
+#endif
+}
+
+static int update_lut(TonemapContext *s, double peak)
+{
+    if (!s->lut) {
+        s->lut = av_malloc_array(TONEMAP_LUT_SIZE + 1, sizeof(*s->lut));
+        if (!s->lut)
+            return AVERROR(ENOMEM);
+    } else if (s->lut_peak == peak) {
+        return 0;
+    }
+
+    for (int i = 0; i <= TONEMAP_LUT_SIZE; i++)
+        s->lut[i] = map_signal(s, i * peak / TONEMAP_LUT_SIZE, peak);
+    s->lut_peak = peak;
+    s->lut_params.lut_scale = TONEMAP_LUT_SIZE / peak;
+
+    return 0;
+}
+
 static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
                     const AVPixFmtDescriptor *desc, int x, int y, double peak)
 {
@@ -138,32 +240,7 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
      * out-of-bounds clipping */
     sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
     sig_orig = sig;
-
-    switch(s->tonemap) {
-    default:
-    case TONEMAP_NONE:
-        // do nothing
-        break;
-    case TONEMAP_LINEAR:
-        sig = sig * s->param / peak;
-        break;
-    case TONEMAP_GAMMA:
-        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
-                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
-        break;
-    case TONEMAP_CLIP:
-        sig = av_clipf(sig * s->param, 0, 1.0f);
-        break;
-    case TONEMAP_HABLE:
-        sig = hable(sig) / hable(peak);
-        break;
-    case TONEMAP_REINHARD:
-        sig = sig / (sig + s->param) * (peak + s->param) / peak;
-        break;
-    case TONEMAP_MOBIUS:
-        sig = mobius(sig, s->param, peak);
-        break;
-    }
+    sig = map_signal(s, sig, peak);
 
     /* apply the computed scale factor to the color,
      * linearly to prevent discoloration */
@@ -189,6 +266,20 @@ static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
     const int slice_end = (in->height * (jobnr+1)) / nb_jobs;
     double peak = td->peak;
 
+    if (s->use_lut) {
+        const int pr = desc->comp[0].plane, pg = desc->comp[1].plane, pb = desc->comp[2].plane;
+
+        for (int y = slice_start; y < slice_end; y++)
+            s->dsp.tonemap_lut((float *)(out->data[pr] + y * out->linesize[pr]),
+                               (float *)(out->data[pg] + y * out->linesize[pg]),
+                               (float *)(out->data[pb] + y * out->linesize[pb]),
+                               (const float *)(in->data[pr] + y * in->linesize[pr]),
+                               (const float *)(in->data[pg] + y * in->linesize[pg]),
+                               (const float *)(in->data[pb] + y * in->linesize[pb]),
+                               s->lut, &s->lut_params, out->width);
+        return 0;
+    }
+
     for (int y = slice_start; y < slice_end; y++)
         for (int x = 0; x < out->width; x++)
             tonemap(s, out, in, desc, x, y, peak);
@@ -251,6 +342,21 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         s->desat = 0;
     }
 
+    if (s->use_lut) {
+        ret = update_lut(s, peak);
+        if (ret < 0) {
+            av_frame_free(&in);
+            av_frame_free(&out);
+            return ret;
+        }
+        if (s->desat > 0) {
+            s->lut_params.coeffs[0] = av_q2d(s->coeffs->cr);
+            s->lut_params.coeffs[1] = av_q2d(s->coeffs->cg);
+            s->lut_params.coeffs[2] = av_q2d(s->coeffs->cb);
+        }
+        s->lut_params.desat = s->desat;
+    }
+
     /* do the tone map */
     td.out = out;
     td.in = in;
@@ -294,6 +400,7 @@ static const AVOption tonemap_options[] = {
     { "param",        "tonemap parameter", OFFSET(param), AV_OPT_TYPE_DOUBLE, {.dbl = NAN}, DBL_MIN, DBL_MAX, FLAGS },
     { "desat",        "desaturation strength", OFFSET(desat), AV_OPT_TYPE_DOUBLE, {.dbl = 2}, 0, DBL_MAX, FLAGS },
     { "peak",         "signal peak override", OFFSET(peak), AV_OPT_TYPE_DOUBLE, {.dbl = 0}, 0, DBL_MAX, FLAGS },
+    { "lut",          "look the tone curve up in a table", OFFSET(use_lut), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
     { NULL }
 };
 
@@ -318,6 +425,7 @@ const AVFilter ff_vf_tonemap = {
     .name            = "tonemap",
     .description     = NULL_IF_CONFIG_SMALL("Conversion to/from different dynamic ranges."),
     .init            = init,
+    .uninit          = uninit,
     .priv_size       = sizeof(TonemapContext),
     .priv_class      = &tonemap_class,
     FILTER_INPUTS(tonemap_inputs),
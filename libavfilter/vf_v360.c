@@ -534,6 +534,13 @@ static void bicubic_kernel(float du, float dv, const XYRemap *rmap,
  */
 static inline void calculate_lanczos_coeffs(float t, float *coeffs)
 {
+    /* The taps are one unit apart, so sin(x) and sin(x / 2) only change
+     * sign or swap between sine and cosine from one tap to the next. */
+    const float s  = sinf(M_PI * t);
+    const float sh = sinf(M_PI_2 * t);
+    const float ch = cosf(M_PI_2 * t);
+    const float sin_x[4]  = { -s,  s, -s,   s };
+    const float sin_x2[4] = { ch, sh, -ch, -sh };
     float sum = 0.f;
 
     for (int i = 0; i < 4; i++) {
@@ -541,7 +548,7 @@ static inline void calculate_lanczos_coeffs(float t, float *coeffs)
         if (x == 0.f) {
             coeffs[i] = 1.f;
         } else {
-            coeffs[i] = sinf(x) * sinf(x / 2.f) / (x * x / 2.f);
+            coeffs[i] = sin_x[i] * sin_x2[i] / (x * x / 2.f);
         }
         sum += coeffs[i];
     }
@@ -30,8 +30,6 @@
 
 typedef struct ThreadData {
     AVFrame *frame;
-    int plane;
-    int w, h;
     int parity;
     int tff;
 } ThreadData;
@@ -189,15 +187,14 @@ static void filter_edges_16bit(void *dst1, void *prev1, void *cur1, void *next1,
     FILTER(offset, w, 0)
 }
 
-static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+static void filter_plane_slice(YADIFContext *s, const ThreadData *td,
+                               int plane, int w, int h, int jobnr, int nb_jobs)
 {
-    YADIFContext *s = ctx->priv;
-    ThreadData *td  = arg;
-    int refs = s->cur->linesize[td->plane];
-    int df = (s->csp->comp[td->plane].depth + 7) / 8;
+    int refs = s->cur->linesize[plane];
+    int df = (s->csp->comp[plane].depth + 7) / 8;
     int pix_3 = 3 * df;
-    int slice_start = (td->h *  jobnr   ) / nb_jobs;
-    int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
+    int slice_start = (h *  jobnr   ) / nb_jobs;
+    int slice_end   = (h * (jobnr+1)) / nb_jobs;
     int y;
     int edge = 3 + MAX_ALIGN / df - 1;
 
@@ -206,52 +203,56 @@ static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
      */
     for (y = slice_start; y < slice_end; y++) {
         if ((y ^ td->parity) & 1) {
-            uint8_t *prev = &s->prev->data[td->plane][y * refs];
-            uint8_t *cur  = &s->cur ->data[td->plane][y * refs];
-            uint8_t *next = &s->next->data[td->plane][y * refs];
-            uint8_t *dst  = &td->frame->data[td->plane][y * td->frame->linesize[td->plane]];
-            int     mode  = y == 1 || y + 2 == td->h ? 2 : s->mode;
+            uint8_t *prev = &s->prev->data[plane][y * refs];
+            uint8_t *cur  = &s->cur ->data[plane][y * refs];
+            uint8_t *next = &s->next->data[plane][y * refs];
+            uint8_t *dst  = &td->frame->data[plane][y * td->frame->linesize[plane]];
+            int     mode  = y == 1 || y + 2 == h ? 2 : s->mode;
             s->filter_line(dst + pix_3, prev + pix_3, cur + pix_3,
-                           next + pix_3, td->w - edge,
-                           y + 1 < td->h ? refs : -refs,
+                           next + pix_3, w - edge,
+                           y + 1 < h ? refs : -refs,
                            y ? -refs : refs,
                            td->parity ^ td->tff, mode);
-            s->filter_edges(dst, prev, cur, next, td->w,
-                            y + 1 < td->h ? refs : -refs,
+            s->filter_edges(dst, prev, cur, next, w,
+                            y + 1 < h ? refs : -refs,
                             y ? -refs : refs,
                             td->parity ^ td->tff, mode);
         } else {
-            memcpy(&td->frame->data[td->plane][y * td->frame->linesize[td->plane]],
-                   &s->cur->data[td->plane][y * refs], td->w * df);
+            memcpy(&td->frame->data[plane][y * td->frame->linesize[plane]],
+                   &s->cur->data[plane][y * refs], w * df);
         }
     }
-    return 0;
 }
 
-static void filter(AVFilterContext *ctx, AVFrame *dstpic,
-                   int parity, int tff)
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    YADIFContext *yadif = ctx->priv;
-    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
+    YADIFContext *s = ctx->priv;
+    ThreadData *td  = arg;
     int i;
 
-    for (i = 0; i < yadif->csp->nb_components; i++) {
-        int w = dstpic->width;
-        int h = dstpic->height;
+    for (i = 0; i < s->csp->nb_components; i++) {
+        int w = td->frame->width;
+        int h = td->frame->height;
 
         if (i == 1 || i == 2) {
-            w = AV_CEIL_RSHIFT(w, yadif->csp->log2_chroma_w);
-            h = AV_CEIL_RSHIFT(h, yadif->csp->log2_chroma_h);
+            w = AV_CEIL_RSHIFT(w, s->csp->log2_chroma_w);
+            h = AV_CEIL_RSHIFT(h, s->csp->log2_chroma_h);
         }
 
+        filter_plane_slice(s, td, i, w, h, jobnr, nb_jobs);
+    }
+    return 0;
+}
 
-        td.w       = w;
-        td.h       = h;
-        td.plane   = i;
+static void filter(AVFilterContext *ctx, AVFrame *dstpic,
+                   int parity, int tff)
+{
+    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
 
-        ff_filter_execute(ctx, filter_slice, &td, NULL,
-                          FFMIN(h, ff_filter_get_nb_threads(ctx)));
-    }
+    /* Process all planes in a single execute call, so that there is one
+     * synchronization point per frame instead of one per plane. */
+    ff_filter_execute(ctx, filter_slice, &td, NULL,
+                      FFMIN(dstpic->height, ff_filter_get_nb_threads(ctx)));
 
     emms_c();
 }
@@ -62,8 +62,9 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
     }
 
     if (!link->frame_pool) {
-        link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                    link->format, align);
+        link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz,
+                                                    link->graph->buffer_cache,
+                                                    w, h, link->format, align);
         if (!link->frame_pool)
             return NULL;
     } else {
@@ -77,8 +78,9 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
             pool_format != link->format || pool_align != align) {
 
             ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
-            link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                        link->format, align);
+            link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz,
+                                                        link->graph->buffer_cache,
+                                                        w, h, link->format, align);
             if (!link->frame_pool)
                 return NULL;
         }
@@ -0,0 +1,84 @@
+;*****************************************************************************
+;* x86-optimized functions for the native DNN backend conv2d layer
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+;------------------------------------------------------------------------------
+; void ff_dnn_conv2d_dot_products(float *dst, const float *patch,
+;                                 const float *kernel, const float *biases,
+;                                 int patch_size, int output_num)
+;------------------------------------------------------------------------------
+
+%macro DOT_PRODUCTS 0
+cglobal dnn_conv2d_dot_products, 6, 7, 4, dst, patch, kernel, bias, size, num, i
+    movsxdifnidn sizeq, sized
+    shl     sizeq, 2
+    add   patchq, sizeq
+    neg     sizeq
+.outer:
+    sub  kernelq, sizeq
+    mov       iq, sizeq
+    xorps      m0, m0
+    xorps      m1, m1
+; the patch size is a multiple of 16 floats, i.e. of 2 ymm or 1 zmm registers
+.inner:
+    movu       m2, [patchq + iq]
+    vfmadd231ps m0, m2, [kernelq + iq]
+%if mmsize == 32
+    movu       m3, [patchq + iq + mmsize]
+    vfmadd231ps m1, m3, [kernelq + iq + mmsize]
+    add       iq, 2 * mmsize
+%else
+    add       iq, mmsize
+%endif
+    jl .inner
+
+    addps      m0, m1
+%if mmsize == 64
+    vextractf32x8 ym1, m0, 1
+    addps     ym0, ym1
+%endif
+    vextractf128 xm1, ym0, 1
+    addps     xm0, xm1
+    movhlps   xm1, xm0
+    addps     xm0, xm1
+    movshdup  xm1, xm0
+    addss     xm0, xm1
+    addss     xm0, [biasq]
+    movss  [dstq], xm0
+
+    add     biasq, 4
+    add      dstq, 4
+    dec      numd
+    jg .outer
+    RET
+%endmacro
+
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+DOT_PRODUCTS
+%endif
+
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+DOT_PRODUCTS
+%endif
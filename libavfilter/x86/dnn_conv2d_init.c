@@ -0,0 +1,40 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/dnn/dnn_backend_native_layer_conv2d.h"
+
+void ff_dnn_conv2d_dot_products_fma3(float *dst, const float *patch, const float *kernel,
+                                     const float *biases, int patch_size, int output_num);
+void ff_dnn_conv2d_dot_products_avx512(float *dst, const float *patch, const float *kernel,
+                                       const float *biases, int patch_size, int output_num);
+
+av_cold void ff_dnn_conv2d_dsp_init_x86(DNNConv2DDSPContext *c)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_FMA3_FAST(cpu_flags))
+        c->dot_products = ff_dnn_conv2d_dot_products_fma3;
+#if HAVE_AVX512_EXTERNAL
+    if (EXTERNAL_AVX512(cpu_flags))
+        c->dot_products = ff_dnn_conv2d_dot_products_avx512;
+#endif
+}
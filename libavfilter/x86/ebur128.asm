@@ -0,0 +1,106 @@
+;*****************************************************************************
+;* x86-optimized functions for the EBU R128 K-weighting filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pq_abs_mask: times 4 dq 0x7fffffffffffffff
+
+SECTION .text
+
+INIT_YMM avx
+;------------------------------------------------------------------------------
+; void ff_ebur128_filter_channels4(double *dst, const double *src,
+;                                  ptrdiff_t stride, int nb_samples,
+;                                  double *state, const double *coeffs)
+;
+; Runs the pre-filter and RLB biquads for 4 interleaved channels. There is no
+; FMA on purpose, the results are bitexact with the C version.
+;------------------------------------------------------------------------------
+cglobal ebur128_filter_channels4, 6, 6, 9, dst, src, stride, len, state, coeffs
+    movsxdifnidn lenq, lend
+    shl     strideq, 3
+    movupd  m0, [stateq + 0 * 32] ; x1
+    movupd  m1, [stateq + 1 * 32] ; x2
+    movupd  m2, [stateq + 2 * 32] ; y1
+    movupd  m3, [stateq + 3 * 32] ; y2
+    movupd  m4, [stateq + 4 * 32] ; z1
+    movupd  m5, [stateq + 5 * 32] ; z2
+.loop:
+    movupd  m6, [srcq]
+    ; y0 = x0 * b0 + x1 * b1 + x2 * b2 - y1 * a1 - y2 * a2
+    mulpd   m7, m6, [coeffsq + 0 * 32]
+    mulpd   m8, m0, [coeffsq + 1 * 32]
+    addpd   m7, m8
+    mulpd   m8, m1, [coeffsq + 2 * 32]
+    addpd   m7, m8
+    mulpd   m8, m2, [coeffsq + 3 * 32]
+    subpd   m7, m8
+    mulpd   m8, m3, [coeffsq + 4 * 32]
+    subpd   m7, m8
+    mova    m1, m0
+    mova    m0, m6
+    ; z0 = y0 * b0 + y1 * b1 + y2 * b2 - z1 * a1 - z2 * a2
+    mulpd   m6, m7, [coeffsq + 5 * 32]
+    mulpd   m8, m2, [coeffsq + 6 * 32]
+    addpd   m6, m8
+    mulpd   m8, m3, [coeffsq + 7 * 32]
+    addpd   m6, m8
+    mulpd   m8, m4, [coeffsq + 8 * 32]
+    subpd   m6, m8
+    mulpd   m8, m5, [coeffsq + 9 * 32]
+    subpd   m6, m8
+    mova    m3, m2
+    mova    m2, m7
+    mova    m5, m4
+    mova    m4, m6
+    movupd  [dstq], m6
+    add     srcq, strideq
+    add     dstq, strideq
+    dec     lenq
+    jg .loop
+
+    movupd  [stateq + 0 * 32], m0
+    movupd  [stateq + 1 * 32], m1
+    movupd  [stateq + 2 * 32], m2
+    movupd  [stateq + 3 * 32], m3
+    movupd  [stateq + 4 * 32], m4
+    movupd  [stateq + 5 * 32], m5
+    RET
+
+;------------------------------------------------------------------------------
+; void ff_ebur128_find_peaks4(double *peaks, const double *src,
+;                             ptrdiff_t stride, int nb_samples)
+;------------------------------------------------------------------------------
+cglobal ebur128_find_peaks4, 4, 4, 3, peaks, src, stride, len
+    movsxdifnidn lenq, lend
+    shl     strideq, 3
+    movupd  m0, [peaksq]
+    mova    m1, [pq_abs_mask]
+.loop:
+    andpd   m2, m1, [srcq]
+    maxpd   m0, m0, m2
+    add     srcq, strideq
+    dec     lenq
+    jg .loop
+
+    movupd  [peaksq], m0
+    RET
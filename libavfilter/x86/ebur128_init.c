@@ -0,0 +1,39 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/ebur128.h"
+
+void ff_ebur128_filter_channels4_avx(double *dst, const double *src, ptrdiff_t stride,
+                                     int nb_samples, double *state, const double *coeffs);
+void ff_ebur128_find_peaks4_avx(double *peaks, const double *src, ptrdiff_t stride,
+                                int nb_samples);
+
+av_cold void ff_ebur128_dsp_init_x86(FFEBUR128DSPContext *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if ARCH_X86_64
+    if (EXTERNAL_AVX_FAST(cpu_flags)) {
+        dsp->filter_channels4 = ff_ebur128_filter_channels4_avx;
+        dsp->find_peaks4      = ff_ebur128_find_peaks4_avx;
+    }
+#endif
+}
@@ -25,6 +25,12 @@
 SECTION_RODATA
 pd_1f:  times 8 dd 1.0
 pd_3f:  times 8 dd 3.0
+pd_1023f:      times 8 dd 1023.0
+pd_1023_invf:  times 8 dd 0x3a802008 ;1.0/1023.0
+pd_4095f:      times 8 dd 4095.0
+pd_4095_invf:  times 8 dd 0x39800801 ;1.0/4095.0
+pd_16383f:     times 8 dd 16383.0
+pd_16383_invf: times 8 dd 0x38800200 ;1.0/16383.0
 pd_65535f:     times 8 dd 65535.0
 pd_65535_invf: times 8 dd 0x37800080 ;1.0/65535.0
 
@@ -103,6 +109,19 @@ endstruc
 %define dstbm [rsp+mmsize*16 + 48]
 %define dstam [rsp+mmsize*16 + 56]
 
+; trilinear deltas and vertex indices
+%define d_rm  [rsp+mmsize*16 + 64]
+%define d_gm  [rsp+mmsize*17 + 64]
+%define d_bm  [rsp+mmsize*18 + 64]
+%define c000m [rsp+mmsize*19 + 64]
+%define c001m [rsp+mmsize*20 + 64]
+%define c010m [rsp+mmsize*21 + 64]
+%define c011m [rsp+mmsize*22 + 64]
+%define c100m [rsp+mmsize*23 + 64]
+%define c101m [rsp+mmsize*24 + 64]
+%define c110m [rsp+mmsize*25 + 64]
+%define c111m [rsp+mmsize*26 + 64]
+
 ; 1 - prev
 ; 2 - next
 ; 3 - offset
@@ -407,6 +426,112 @@ endstruc
 
 %endmacro
 
+; 1 - dst
+; 2 - prescaled rg index
+; 3 - prescaled b index
+%macro STORE_LUT3D_INDEX 3
+    addps m0, %2, %3
+    cvttps2dq m0, m0
+    mova %1, m0
+%endmacro
+
+; m%1-%3 += (m%4-%6 - m%1-%3) * %7
+%macro LERP3 7
+    subps m%4, m%4, m%1
+    subps m%5, m%5, m%2
+    subps m%6, m%6, m%3
+    MADD3 m%1, m%4, %7
+    MADD3 m%2, m%5, %7
+    MADD3 m%3, m%6, %7
+%endmacro
+
+; gather the vertices at the indices %4 and %8 into m%1-%3 and m%5-%7,
+; and interpolate them along b into m%1-%3
+%macro GATHER_LERP_B 8
+    movu m12, %4
+    GATHER_LUT3D_INDICES %1, %2, %3, 12
+    movu m12, %8
+    GATHER_LUT3D_INDICES %5, %6, %7, 12
+    LERP3 %1, %2, %3, %5, %6, %7, d_bm
+%endmacro
+
+%macro interp_trilinear 0
+    %define d_r m0
+    %define d_g m1
+    %define d_b m2
+
+    %define prev_r m3
+    %define prev_g m4
+    %define prev_b m5
+
+    %define next_r m6
+    %define next_g m7
+    %define next_b m8
+
+    ; setup prev index
+    FLOORPS prev_r, m0
+    FLOORPS prev_g, m1
+    FLOORPS prev_b, m2
+
+    ; setup deltas
+    subps d_r, m0, prev_r
+    subps d_g, m1, prev_g
+    subps d_b, m2, prev_b
+    mova d_rm, d_r
+    mova d_gm, d_g
+    mova d_bm, d_b
+
+    ; setup next index
+    addps next_r, prev_r, m14 ; +1
+    minps next_r, next_r, m13 ; clamp lutmax
+
+    addps next_g, prev_g, m14 ; +1
+    minps next_g, next_g, m13 ; clamp lutmax
+
+    addps next_b, prev_b, m14 ; +1
+    minps next_b, next_b, m13 ; clamp lutmax
+
+    ; prescale indices
+    mulps prev_r, prev_r, lut3dsize2m
+    mulps next_r, next_r, lut3dsize2m
+
+    mulps prev_g, prev_g, lut3dsizem
+    mulps next_g, next_g, lut3dsizem
+
+    mulps prev_b, prev_b, [pd_3f]
+    mulps next_b, next_b, [pd_3f]
+
+    ; the 8 vertices do not fit in the registers with their gather masks,
+    ; keep their indices on the stack
+    addps m9,  prev_r, prev_g
+    addps m10, prev_r, next_g
+    addps m11, next_r, prev_g
+    addps m12, next_r, next_g
+    STORE_LUT3D_INDEX c000m, m9,  prev_b
+    STORE_LUT3D_INDEX c001m, m9,  next_b
+    STORE_LUT3D_INDEX c010m, m10, prev_b
+    STORE_LUT3D_INDEX c011m, m10, next_b
+    STORE_LUT3D_INDEX c100m, m11, prev_b
+    STORE_LUT3D_INDEX c101m, m11, next_b
+    STORE_LUT3D_INDEX c110m, m12, prev_b
+    STORE_LUT3D_INDEX c111m, m12, next_b
+
+    mov tmpq, [ctxq + LUT3DContext.lut]
+
+    ; c0 = lerp(lerp(c000, c001, d_b), lerp(c010, c011, d_b), d_g)
+    GATHER_LERP_B 0, 1, 2, c000m,  4,  5,  6, c001m
+    GATHER_LERP_B 4, 5, 6, c010m,  7,  8,  9, c011m
+    LERP3 0, 1, 2, 4, 5, 6, d_gm
+
+    ; c1 = lerp(lerp(c100, c101, d_b), lerp(c110, c111, d_b), d_g)
+    GATHER_LERP_B 4, 5, 6, c100m,  7,  8,  9, c101m
+    GATHER_LERP_B 7, 8, 9, c110m, 10, 11, 13, c111m
+    LERP3 4, 5, 6, 7, 8, 9, d_gm
+
+    ; c = lerp(c0, c1, d_r)
+    LERP3 0, 1, 2, 4, 5, 6, d_rm
+%endmacro
+
 %macro INIT_DATA_PTR 3
     mov ptrq, [%2 + AVFrame.data     + %3 * 8]
     mov tmpd, [%2 + AVFrame.linesize + %3 * 4]
@@ -444,12 +569,12 @@ endstruc
         %endif
     %endif
     cvtdq2ps m%1, m%1
-    mulps m%1, m%1, m7 ; pd_65535_invf
+    mulps m%1, m%1, m7 ; pd_<max>_invf
 %endmacro
 
 %macro STORE16 2
-    mulps m%2, m%2, m5  ; [pd_65535f]
-    minps m%2, m%2, m5  ; [pd_65535f]
+    mulps m%2, m%2, m5  ; [pd_<max>f]
+    minps m%2, m%2, m5  ; [pd_<max>f]
     maxps m%2, m%2, m15 ; zero
     cvttps2dq m%2, m%2
     %if mmsize > 16
@@ -475,7 +600,20 @@ endstruc
 ; 3 - depth
 ; 4 - is float format
 %macro DEFINE_INTERP_FUNC 4
-cglobal interp_%1_%2, 7, 13, 16, mmsize*16+(8*8), ctx, prelut, src_image, dst_image, slice_start, slice_end, has_alpha, width, x, ptr, tmp, tmp2, tmp3
+%if %3 == 10
+    %define pd_maxf    pd_1023f
+    %define pd_max_inv pd_1023_invf
+%elif %3 == 12
+    %define pd_maxf    pd_4095f
+    %define pd_max_inv pd_4095_invf
+%elif %3 == 14
+    %define pd_maxf    pd_16383f
+    %define pd_max_inv pd_16383_invf
+%else
+    %define pd_maxf    pd_65535f
+    %define pd_max_inv pd_65535_invf
+%endif
+cglobal interp_%1_%2, 7, 13, 16, mmsize*27+(8*8), ctx, prelut, src_image, dst_image, slice_start, slice_end, has_alpha, width, x, ptr, tmp, tmp2, tmp3
     ; store lut max and lutsize
     mov tmpd, dword [ctxq + LUT3DContext.lutsize]
     cvtsi2ss xm0, tmpd
@@ -557,7 +695,7 @@ cglobal interp_%1_%2, 7, 13, 16, mmsize*16+(8*8), ctx, prelut, src_image, dst_im
                 movu m2, [ptrq + xq*4]
             %else
                 ; constants for LOAD16
-                movu m7, [pd_65535_invf]
+                movu m7, [pd_max_inv]
                 %if notcpuflag(avx2) && mmsize >= 32
                     movu xm6, [pb_shuffle16]
                 %endif
@@ -597,7 +735,7 @@ cglobal interp_%1_%2, 7, 13, 16, mmsize*16+(8*8), ctx, prelut, src_image, dst_im
                 %%skip_alphaf:
             %else
                 ; constants for STORE16
-                movu m5,  [pd_65535f]
+                movu m5,  [pd_maxf]
                 %if mmsize > 16
                     movu xm6, [pb_lo_pack_shuffle16]
                     movu xm7, [pb_hi_pack_shuffle16]
@@ -645,18 +783,26 @@ cglobal interp_%1_%2, 7, 13, 16, mmsize*16+(8*8), ctx, prelut, src_image, dst_im
 
     RET
 %endmacro
+%macro DEFINE_INTERP_FUNCS 1
+    DEFINE_INTERP_FUNC %1, pf32, 32, 1
+    DEFINE_INTERP_FUNC %1, p10,  10, 0
+    DEFINE_INTERP_FUNC %1, p12,  12, 0
+    DEFINE_INTERP_FUNC %1, p14,  14, 0
+    DEFINE_INTERP_FUNC %1, p16,  16, 0
+%endmacro
+
 %if ARCH_X86_64
     %if HAVE_AVX2_EXTERNAL
         INIT_YMM avx2
-        DEFINE_INTERP_FUNC tetrahedral, pf32, 32, 1
-        DEFINE_INTERP_FUNC tetrahedral, p16, 16, 0
+        DEFINE_INTERP_FUNCS tetrahedral
+        DEFINE_INTERP_FUNCS trilinear
     %endif
     %if HAVE_AVX_EXTERNAL
         INIT_YMM avx
-        DEFINE_INTERP_FUNC tetrahedral, pf32, 32, 1
-        DEFINE_INTERP_FUNC tetrahedral, p16, 16, 0
+        DEFINE_INTERP_FUNCS tetrahedral
+        DEFINE_INTERP_FUNCS trilinear
     %endif
     INIT_XMM sse2
-    DEFINE_INTERP_FUNC tetrahedral, pf32, 32, 1
-    DEFINE_INTERP_FUNC tetrahedral, p16, 16, 0
+    DEFINE_INTERP_FUNCS tetrahedral
+    DEFINE_INTERP_FUNCS trilinear
 %endif
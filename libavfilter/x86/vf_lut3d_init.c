@@ -39,53 +39,70 @@ static int interp_##name##_##format##_##opt(AVFilterContext *ctx, void *arg, int
     return 0;                                                                                                                                       \
 }
 
+#define DEFINE_INTERP_FUNCS(name, opt)      \
+    DEFINE_INTERP_FUNC(name, pf32, opt)     \
+    DEFINE_INTERP_FUNC(name, p10,  opt)     \
+    DEFINE_INTERP_FUNC(name, p12,  opt)     \
+    DEFINE_INTERP_FUNC(name, p14,  opt)     \
+    DEFINE_INTERP_FUNC(name, p16,  opt)
+
 #if ARCH_X86_64
 #if HAVE_AVX2_EXTERNAL
-    DEFINE_INTERP_FUNC(tetrahedral, pf32, avx2)
-    DEFINE_INTERP_FUNC(tetrahedral, p16,  avx2)
+    DEFINE_INTERP_FUNCS(tetrahedral, avx2)
+    DEFINE_INTERP_FUNCS(trilinear,   avx2)
 #endif
 #if HAVE_AVX_EXTERNAL
-    DEFINE_INTERP_FUNC(tetrahedral, pf32, avx)
-    DEFINE_INTERP_FUNC(tetrahedral, p16,  avx)
+    DEFINE_INTERP_FUNCS(tetrahedral, avx)
+    DEFINE_INTERP_FUNCS(trilinear,   avx)
 #endif
 #if HAVE_SSE2_EXTERNAL
-    DEFINE_INTERP_FUNC(tetrahedral, pf32, sse2)
-    DEFINE_INTERP_FUNC(tetrahedral, p16,  sse2)
+    DEFINE_INTERP_FUNCS(tetrahedral, sse2)
+    DEFINE_INTERP_FUNCS(trilinear,   sse2)
 #endif
 #endif
 
+#define SET_INTERP_FUNC(name, opt) do {                         \
+    if (isfloat) {                                              \
+        s->interp = interp_##name##_pf32_##opt;                 \
+    } else {                                                    \
+        switch (depth) {                                        \
+        case 10: s->interp = interp_##name##_p10_##opt; break;  \
+        case 12: s->interp = interp_##name##_p12_##opt; break;  \
+        case 14: s->interp = interp_##name##_p14_##opt; break;  \
+        case 16: s->interp = interp_##name##_p16_##opt; break;  \
+        }                                                       \
+    }                                                           \
+} while (0)
+
+#define SET_INTERP_FUNCS(opt) do {                              \
+    if (s->interpolation == INTERPOLATE_TETRAHEDRAL)            \
+        SET_INTERP_FUNC(tetrahedral, opt);                      \
+    else if (s->interpolation == INTERPOLATE_TRILINEAR)         \
+        SET_INTERP_FUNC(trilinear, opt);                        \
+} while (0)
 
 av_cold void ff_lut3d_init_x86(LUT3DContext *s, const AVPixFmtDescriptor *desc)
 {
+#if ARCH_X86_64 && HAVE_X86ASM
     int cpu_flags = av_get_cpu_flags();
     int planar = desc->flags & AV_PIX_FMT_FLAG_PLANAR;
     int isfloat = desc->flags & AV_PIX_FMT_FLAG_FLOAT;
     int depth = desc->comp[0].depth;
 
-#if ARCH_X86_64
-    if (EXTERNAL_AVX2_FAST(cpu_flags) && EXTERNAL_FMA3(cpu_flags) && s->interpolation == INTERPOLATE_TETRAHEDRAL && planar) {
+    if (!planar)
+        return;
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags) && EXTERNAL_FMA3(cpu_flags)) {
 #if HAVE_AVX2_EXTERNAL
-        if (isfloat && planar) {
-            s->interp = interp_tetrahedral_pf32_avx2;
-        } else if (depth == 16) {
-            s->interp = interp_tetrahedral_p16_avx2;
-        }
+        SET_INTERP_FUNCS(avx2);
 #endif
-    } else if (EXTERNAL_AVX_FAST(cpu_flags) && s->interpolation == INTERPOLATE_TETRAHEDRAL && planar) {
+    } else if (EXTERNAL_AVX_FAST(cpu_flags)) {
 #if HAVE_AVX_EXTERNAL
-        if (isfloat) {
-            s->interp = interp_tetrahedral_pf32_avx;
-        } else if (depth == 16) {
-            s->interp = interp_tetrahedral_p16_avx;
-        }
+        SET_INTERP_FUNCS(avx);
 #endif
-    } else if (EXTERNAL_SSE2(cpu_flags) && s->interpolation == INTERPOLATE_TETRAHEDRAL && planar) {
+    } else if (EXTERNAL_SSE2(cpu_flags)) {
 #if HAVE_SSE2_EXTERNAL
-        if (isfloat) {
-            s->interp = interp_tetrahedral_pf32_sse2;
-        } else if (depth == 16) {
-            s->interp = interp_tetrahedral_p16_sse2;
-        }
+        SET_INTERP_FUNCS(sse2);
 #endif
     }
 #endif
@@ -26,49 +26,67 @@
 SECTION_RODATA
 
 pb_1:     times 16 db 1
+pw_1:     times  8 dw 1
+pw_16:    times  8 dw 16
 pw_128:   times  8 dw 128
+pw_m128:  times  8 dw -128
 pw_255:   times  8 dw 255
 pw_257:   times  8 dw 257
+pd_1023:  times  4 dd 1023
+pd_65535: times  4 dd 65535
+ps_1023:  times  4 dd 1023.0
 
 SECTION .text
 
-INIT_XMM sse4
-cglobal overlay_row_44, 5, 7, 6, 0, d, da, s, a, w, r, x
-    xor          xq, xq
-    movsxdifnidn wq, wd
-    mov          rq, wq
-    and          rq, mmsize/2 - 1
-    cmp          wq, mmsize/2
-    jl .end
-    sub          wq, rq
-    mova         m3, [pw_255]
-    mova         m4, [pw_128]
-    mova         m5, [pw_257]
-    .loop:
-        pmovzxbw    m0, [sq+xq]
-        pmovzxbw    m2, [aq+xq]
-        pmovzxbw    m1, [dq+xq]
-        pmullw      m0, m2
-        pxor        m2, m3
-        pmullw      m1, m2
-        paddw       m0, m4
-        paddw       m0, m1
-        pmulhuw     m0, m5
-        packuswb    m0, m0
-        movq   [dq+xq], m0
-        add         xq, mmsize/2
-        cmp         xq, wq
-        jl .loop
+; load the alpha of 8 pixels into the words of m2, the subsampled versions
+; average it as the C code does
+%macro LOAD_ALPHA_44 0
+    pmovzxbw    m2, [aq+xq]
+%endmacro
 
-    .end:
-    mov    eax, xd
-    RET
+%macro LOAD_ALPHA_22 0
+    movu        m1, [aq+2*xq]
+    pandn       m2, m3, m1
+    psllw       m1, 8
+    pavgw       m2, m1
+    pavgw       m2, m1
+    psrlw       m2, 8
+%endmacro
 
-INIT_XMM sse4
-cglobal overlay_row_22, 5, 7, 6, 0, d, da, s, a, w, r, x
+%macro LOAD_ALPHA_20 0
+    movu        m2, [aq+2*xq]
+    movu        m1, [daq+2*xq]
+    pmaddubsw   m2, m6
+    pmaddubsw   m1, m6
+    paddw       m2, m1
+    psrlw       m2, 2
+%endmacro
+
+;------------------------------------------------------------------------------
+; int overlay_row_<name>(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+;                        int w, ptrdiff_t alinesize)
+;
+; %1 name, %2 alpha subsampling (44, 22, 20), %3 blending:
+;   straight: d = (d * (255 - a) + s * a) / 255
+;   nv:       the same, on every other byte of d
+;   pm:       d = clip(d * (255 - a) / 255 + s - 16)
+;   pm_uv:    d = clip((d - 128) * (255 - a) / 255 + s - 128, -128, 128) + 128
+;
+; Returns the number of pixels blended, the C code does the rest.
+;------------------------------------------------------------------------------
+%macro OVERLAY_ROW 3
+%if %2 == 20
+cglobal overlay_row_%1, 6, 7, 8, 0, d, da, s, a, w, r, x
+    mov         daq, aq
+    add         daq, rmp
+%else
+cglobal overlay_row_%1, 5, 7, 8, 0, d, da, s, a, w, r, x
+%endif
     xor          xq, xq
     movsxdifnidn wq, wd
+%if %2 != 44
     sub          wq, 1
+%endif
     mov          rq, wq
     and          rq, mmsize/2 - 1
     cmp          wq, mmsize/2
@@ -77,23 +95,59 @@ cglobal overlay_row_22, 5, 7, 6, 0, d, da, s, a, w, r, x
     mova         m3, [pw_255]
     mova         m4, [pw_128]
     mova         m5, [pw_257]
+%if %2 == 20
+    mova         m6, [pb_1]
+%endif
+%ifidn %3, pm
+    mova         m7, [pw_16]
+%elifidn %3, pm_uv
+    mova         m7, [pw_m128]
+%endif
     .loop:
         pmovzxbw    m0, [sq+xq]
-        movu        m1, [aq+2*xq]
-        pandn       m2, m3, m1
-        psllw       m1, 8
-        pavgw       m2, m1
-        pavgw       m2, m1
-        psrlw       m2, 8
+        LOAD_ALPHA_%2
+%ifidn %3, nv
+        movu        m7, [dq+2*xq]
+        pand        m1, m7, m3
+%else
         pmovzxbw    m1, [dq+xq]
+%endif
+%ifidn %3, pm
+        pxor        m2, m3
+        pmullw      m1, m2
+        paddw       m1, m4
+        pmulhuw     m1, m5
+        paddw       m0, m1
+        psubw       m0, m7
+%elifidn %3, pm_uv
+        psubw       m1, m4
+        pxor        m2, m3
+        pmullw      m1, m2
+        paddw       m1, m4
+        pmulhw      m1, m5
+        paddw       m0, m1
+        psubw       m0, m4
+        pmaxsw      m0, m7
+        pminsw      m0, m4
+        paddw       m0, m4
+        pand        m0, m3 ; the C code stores 256 as 0
+%else
         pmullw      m0, m2
         pxor        m2, m3
         pmullw      m1, m2
         paddw       m0, m4
         paddw       m0, m1
         pmulhuw     m0, m5
+%endif
+%ifidn %3, nv
+        psrlw       m7, 8
+        psllw       m7, 8
+        por         m0, m7
+        movu [dq+2*xq], m0
+%else
         packuswb    m0, m0
         movq   [dq+xq], m0
+%endif
         add         xq, mmsize/2
         cmp         xq, wq
         jl .loop
@@ -101,44 +155,90 @@ cglobal overlay_row_22, 5, 7, 6, 0, d, da, s, a, w, r, x
     .end:
     mov    eax, xd
     RET
+%endmacro
 
-INIT_XMM sse4
-cglobal overlay_row_20, 6, 7, 7, 0, d, da, s, a, w, r, x
+; load the alpha of 4 pixels into the dwords of m2
+%macro LOAD_ALPHA16_44 0
+    pmovzxwd    m2, [aq+2*xq]
+%endmacro
+
+%macro LOAD_ALPHA16_22 0
+    movu        m1, [aq+4*xq]
+    pand        m2, m1, m6
+    pmaddwd     m1, m5
+    psrld       m1, 1
+    paddd       m2, m1
+    psrld       m2, 1
+%endmacro
+
+%macro LOAD_ALPHA16_20 0
+    movu        m2, [aq+4*xq]
+    movu        m1, [daq+4*xq]
+    pmaddwd     m2, m5
+    pmaddwd     m1, m5
+    paddd       m2, m1
+    psrld       m2, 2
+%endmacro
+
+;------------------------------------------------------------------------------
+; The same for 10-bit samples with straight alpha:
+;   d = (d * (1023 - a) + s * a) / 1023
+; The products fit in 24 bits, so the truncated float division is exact.
+;------------------------------------------------------------------------------
+%macro OVERLAY_ROW_16 1
+%if %1 == 20
+cglobal overlay_row_%1_16, 6, 7, 8, 0, d, da, s, a, w, r, x
     mov         daq, aq
     add         daq, rmp
+%else
+cglobal overlay_row_%1_16, 5, 7, 8, 0, d, da, s, a, w, r, x
+%endif
     xor          xq, xq
     movsxdifnidn wq, wd
+%if %1 != 44
     sub          wq, 1
+%endif
     mov          rq, wq
-    and          rq, mmsize/2 - 1
-    cmp          wq, mmsize/2
+    and          rq, mmsize/4 - 1
+    cmp          wq, mmsize/4
     jl .end
     sub          wq, rq
-    mova         m3, [pw_255]
-    mova         m4, [pw_128]
-    mova         m5, [pw_257]
-    mova         m6, [pb_1]
+    mova         m3, [pd_1023]
+    mova         m4, [ps_1023]
+    mova         m5, [pw_1]
+    mova         m6, [pd_65535]
     .loop:
-        pmovzxbw    m0, [sq+xq]
-        movu        m2, [aq+2*xq]
-        movu        m1, [daq+2*xq]
-        pmaddubsw   m2, m6
-        pmaddubsw   m1, m6
-        paddw       m2, m1
-        psrlw       m2, 2
-        pmovzxbw    m1, [dq+xq]
-        pmullw      m0, m2
-        pxor        m2, m3
-        pmullw      m1, m2
-        paddw       m0, m4
-        paddw       m0, m1
-        pmulhuw     m0, m5
-        packuswb    m0, m0
-        movq   [dq+xq], m0
-        add         xq, mmsize/2
+        pmovzxwd    m0, [sq+2*xq]
+        LOAD_ALPHA16_%1
+        pmovzxwd    m1, [dq+2*xq]
+        mova        m7, m3
+        psubd       m7, m2
+        pmulld      m0, m2
+        pmulld      m1, m7
+        paddd       m0, m1
+        cvtdq2ps    m0, m0
+        divps       m0, m4
+        cvttps2dq   m0, m0
+        packusdw    m0, m0
+        movq [dq+2*xq], m0
+        add         xq, mmsize/4
         cmp         xq, wq
         jl .loop
 
     .end:
     mov    eax, xd
     RET
+%endmacro
+
+INIT_XMM sse4
+OVERLAY_ROW 44,       44, straight
+OVERLAY_ROW 22,       22, straight
+OVERLAY_ROW 20,       20, straight
+OVERLAY_ROW 20_nv,    20, nv
+OVERLAY_ROW 44_pm,    44, pm
+OVERLAY_ROW 44_pm_uv, 44, pm_uv
+OVERLAY_ROW 22_pm_uv, 22, pm_uv
+OVERLAY_ROW 20_pm_uv, 20, pm_uv
+OVERLAY_ROW_16 44
+OVERLAY_ROW_16 22
+OVERLAY_ROW_16 20
@@ -23,43 +23,90 @@
 #include "libavutil/x86/cpu.h"
 #include "libavfilter/vf_overlay.h"
 
-int ff_overlay_row_44_sse4(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
-                           int w, ptrdiff_t alinesize);
+#define OVERLAY_ROW_FUNC(name)                                              \
+int ff_overlay_row_ ## name ## _sse4(uint8_t *d, uint8_t *da, uint8_t *s,   \
+                                     uint8_t *a, int w, ptrdiff_t alinesize)
 
-int ff_overlay_row_20_sse4(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
-                           int w, ptrdiff_t alinesize);
-
-int ff_overlay_row_22_sse4(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
-                           int w, ptrdiff_t alinesize);
+OVERLAY_ROW_FUNC(44);
+OVERLAY_ROW_FUNC(22);
+OVERLAY_ROW_FUNC(20);
+OVERLAY_ROW_FUNC(20_nv);
+OVERLAY_ROW_FUNC(44_pm);
+OVERLAY_ROW_FUNC(44_pm_uv);
+OVERLAY_ROW_FUNC(22_pm_uv);
+OVERLAY_ROW_FUNC(20_pm_uv);
+OVERLAY_ROW_FUNC(44_16);
+OVERLAY_ROW_FUNC(22_16);
+OVERLAY_ROW_FUNC(20_16);
 
 av_cold void ff_overlay_init_x86(OverlayContext *s, int format, int pix_format,
                                  int alpha_format, int main_has_alpha)
 {
     int cpu_flags = av_get_cpu_flags();
 
-    if (EXTERNAL_SSE4(cpu_flags) &&
-        (format == OVERLAY_FORMAT_YUV444 ||
-         format == OVERLAY_FORMAT_GBRP) &&
-        alpha_format == 0 && main_has_alpha == 0) {
-        s->blend_row[0] = ff_overlay_row_44_sse4;
-        s->blend_row[1] = ff_overlay_row_44_sse4;
-        s->blend_row[2] = ff_overlay_row_44_sse4;
-    }
-
-    if (EXTERNAL_SSE4(cpu_flags) &&
-        (pix_format == AV_PIX_FMT_YUV420P) &&
-        (format == OVERLAY_FORMAT_YUV420) &&
-        alpha_format == 0 && main_has_alpha == 0) {
-        s->blend_row[0] = ff_overlay_row_44_sse4;
-        s->blend_row[1] = ff_overlay_row_20_sse4;
-        s->blend_row[2] = ff_overlay_row_20_sse4;
-    }
+    if (!EXTERNAL_SSE4(cpu_flags) || main_has_alpha)
+        return;
 
-    if (EXTERNAL_SSE4(cpu_flags) &&
-        (format == OVERLAY_FORMAT_YUV422) &&
-        alpha_format == 0 && main_has_alpha == 0) {
-        s->blend_row[0] = ff_overlay_row_44_sse4;
-        s->blend_row[1] = ff_overlay_row_22_sse4;
-        s->blend_row[2] = ff_overlay_row_22_sse4;
+    if (alpha_format == 0) {
+        switch (format) {
+        case OVERLAY_FORMAT_YUV444:
+        case OVERLAY_FORMAT_GBRP:
+            s->blend_row[0] = ff_overlay_row_44_sse4;
+            s->blend_row[1] = ff_overlay_row_44_sse4;
+            s->blend_row[2] = ff_overlay_row_44_sse4;
+            break;
+        case OVERLAY_FORMAT_YUV420:
+            if (pix_format == AV_PIX_FMT_YUV420P) {
+                s->blend_row[0] = ff_overlay_row_44_sse4;
+                s->blend_row[1] = ff_overlay_row_20_sse4;
+                s->blend_row[2] = ff_overlay_row_20_sse4;
+            } else if (pix_format == AV_PIX_FMT_NV12 ||
+                       pix_format == AV_PIX_FMT_NV21) {
+                s->blend_row[0] = ff_overlay_row_44_sse4;
+                s->blend_row[1] = ff_overlay_row_20_nv_sse4;
+                s->blend_row[2] = ff_overlay_row_20_nv_sse4;
+            }
+            break;
+        case OVERLAY_FORMAT_YUV422:
+            s->blend_row[0] = ff_overlay_row_44_sse4;
+            s->blend_row[1] = ff_overlay_row_22_sse4;
+            s->blend_row[2] = ff_overlay_row_22_sse4;
+            break;
+        case OVERLAY_FORMAT_YUV420P10:
+            s->blend_row[0] = ff_overlay_row_44_16_sse4;
+            s->blend_row[1] = ff_overlay_row_20_16_sse4;
+            s->blend_row[2] = ff_overlay_row_20_16_sse4;
+            break;
+        case OVERLAY_FORMAT_YUV422P10:
+            s->blend_row[0] = ff_overlay_row_44_16_sse4;
+            s->blend_row[1] = ff_overlay_row_22_16_sse4;
+            s->blend_row[2] = ff_overlay_row_22_16_sse4;
+            break;
+        }
+    } else {
+        switch (format) {
+        case OVERLAY_FORMAT_GBRP:
+            s->blend_row[0] = ff_overlay_row_44_pm_sse4;
+            s->blend_row[1] = ff_overlay_row_44_pm_sse4;
+            s->blend_row[2] = ff_overlay_row_44_pm_sse4;
+            break;
+        case OVERLAY_FORMAT_YUV444:
+            s->blend_row[0] = ff_overlay_row_44_pm_sse4;
+            s->blend_row[1] = ff_overlay_row_44_pm_uv_sse4;
+            s->blend_row[2] = ff_overlay_row_44_pm_uv_sse4;
+            break;
+        case OVERLAY_FORMAT_YUV420:
+            if (pix_format == AV_PIX_FMT_YUV420P) {
+                s->blend_row[0] = ff_overlay_row_44_pm_sse4;
+                s->blend_row[1] = ff_overlay_row_20_pm_uv_sse4;
+                s->blend_row[2] = ff_overlay_row_20_pm_uv_sse4;
+            }
+            break;
+        case OVERLAY_FORMAT_YUV422:
+            s->blend_row[0] = ff_overlay_row_44_pm_sse4;
+            s->blend_row[1] = ff_overlay_row_22_pm_uv_sse4;
+            s->blend_row[2] = ff_overlay_row_22_pm_uv_sse4;
+            break;
+        }
     }
 }
@@ -0,0 +1,128 @@
+;*****************************************************************************
+;* x86-optimized functions for the tonemap filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pd_1:        times 8 dd 1.0
+pd_1e6:      times 8 dd 1.0e-6
+pd_lut_size: times 8 dd 4096.0 ; TONEMAP_LUT_SIZE
+pd_lut_last: times 8 dd 4095   ; TONEMAP_LUT_SIZE - 1
+
+SECTION .text
+
+struc TonemapLUTParams
+    .coeffs:    resd 3
+    .desat:     resd 1
+    .lut_scale: resd 1
+endstruc
+
+; 1 - component
+; 2 - luma
+; 3 - overbright
+; 4 - 1 - overbright
+%macro DESAT 4
+    mulps       %1, %1, %4
+    vfmadd231ps %1, %2, %3
+%endmacro
+
+; 1 - desaturate
+%macro TONEMAP_LOOP 1
+.loop%1:
+    movu         m0, [src_rq + xq*4]
+    movu         m1, [src_gq + xq*4]
+    movu         m2, [src_bq + xq*4]
+
+%if %1
+    mulps        m3, m0, m10
+    vfmadd231ps  m3, m1, m11
+    vfmadd231ps  m3, m2, m12           ; luma
+    subps        m4, m3, m13
+    maxps        m4, m4, m15
+    maxps        m5, m3, m15
+    divps        m4, m4, m5            ; overbright
+    subps        m5, m9, m4            ; 1 - overbright
+    DESAT        m0, m3, m4, m5
+    DESAT        m1, m3, m4, m5
+    DESAT        m2, m3, m4, m5
+%endif
+
+    ; the brightest component, maxps returns the second operand on NaN
+    maxps        m3, m0, m1
+    maxps        m3, m3, m2
+    maxps        m3, m3, m15           ; sig
+
+    mulps        m4, m3, m14
+    minps        m4, m4, [pd_lut_size] ; pos
+    cvttps2dq    m5, m4
+    pminsd       m5, m5, [pd_lut_last] ; i
+    cvtdq2ps     m6, m5
+    subps        m4, m4, m6            ; pos - i
+
+    pcmpeqd      m7, m7
+    vgatherdps   m6, [lutq + m5*4], m7
+    pcmpeqd      m7, m7
+    vgatherdps   m8, [lutq + m5*4 + 4], m7
+    subps        m8, m8, m6
+    vfmadd231ps  m6, m8, m4            ; mapped
+    divps        m6, m6, m3
+
+    mulps        m0, m0, m6
+    mulps        m1, m1, m6
+    mulps        m2, m2, m6
+    movu         [dst_rq + xq*4], m0
+    movu         [dst_gq + xq*4], m1
+    movu         [dst_bq + xq*4], m2
+
+    add          xq, mmsize/4
+    cmp          xq, wq
+    jl .loop%1
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_tonemap_lut(float *dst_r, float *dst_g, float *dst_b,
+;                     const float *src_r, const float *src_g, const float *src_b,
+;                     const float *lut, const TonemapLUTParams *p, int width)
+;------------------------------------------------------------------------------
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+cglobal tonemap_lut, 9, 10, 16, dst_r, dst_g, dst_b, src_r, src_g, src_b, lut, p, w, x
+    movsxdifnidn    wq, wd
+    VBROADCASTSS   m10, [pq + TonemapLUTParams.coeffs + 0*4]
+    VBROADCASTSS   m11, [pq + TonemapLUTParams.coeffs + 1*4]
+    VBROADCASTSS   m12, [pq + TonemapLUTParams.coeffs + 2*4]
+    VBROADCASTSS   m13, [pq + TonemapLUTParams.desat]
+    VBROADCASTSS   m14, [pq + TonemapLUTParams.lut_scale]
+    mova            m9, [pd_1]
+    mova           m15, [pd_1e6]
+    xor             xq, xq
+
+    xorps          xm0, xm0
+    comiss        xm13, xm0
+    jbe .no_desat
+    TONEMAP_LOOP 1
+    RET
+
+.no_desat:
+    TONEMAP_LOOP 0
+    RET
+%endif
@@ -414,6 +414,8 @@ extern const AVOutputFormat ff_segment_muxer;
 extern const AVOutputFormat ff_stream_segment_muxer;
 extern const AVInputFormat  ff_ser_demuxer;
 extern const AVInputFormat  ff_sga_demuxer;
+extern const AVInputFormat  ff_shm_demuxer;
+extern const AVOutputFormat ff_shm_muxer;
 extern const AVInputFormat  ff_shorten_demuxer;
 extern const AVInputFormat  ff_siff_demuxer;
 extern const AVInputFormat  ff_simbiosis_imx_demuxer;
@@ -29,6 +29,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/dict.h"
 #include "libavutil/error.h"
 #include "libavutil/fifo.h"
 #include "libavutil/log.h"
@@ -44,6 +45,9 @@
 #define BUFFER_CAPACITY         (4 * 1024 * 1024)
 #define READ_BACK_CAPACITY      (4 * 1024 * 1024)
 #define SHORT_SEEK_THRESHOLD    (256 * 1024)
+#define MIN_READ_SIZE           4096
+#define MAX_READ_SIZE           (256 * 1024)
+#define MAX_CONNECTIONS         16
 
 typedef struct RingBuffer
 {
@@ -53,6 +57,30 @@ typedef struct RingBuffer
     int           read_pos;
 } RingBuffer;
 
+enum FetcherState {
+    FETCHER_IDLE,
+    FETCHER_BUSY,
+    FETCHER_DONE,
+};
+
+/**
+ * Reads one block at a time through its own connection, for the parallel
+ * mode enabled by the connections option.
+ */
+typedef struct Fetcher {
+    URLContext     *h;
+    URLContext     *inner;
+    pthread_t       thread;
+    int             thread_started;
+
+    uint8_t        *buf;
+    int64_t         pos;
+    int             size;
+    int             consumed;
+    int             ret;
+    enum FetcherState state;
+} Fetcher;
+
 typedef struct Context {
     AVClass        *class;
     URLContext     *inner;
@@ -70,6 +98,7 @@ typedef struct Context {
     int64_t         logical_pos;
     int64_t         logical_size;
     RingBuffer      ring;
+    int             read_size;
 
     pthread_cond_t  cond_wakeup_main;
     pthread_cond_t  cond_wakeup_background;
@@ -78,6 +107,18 @@ typedef struct Context {
 
     int             abort_request;
     AVIOInterruptCB interrupt_callback;
+
+    int             readahead_size;
+    int             readback_size;
+    int             connections;
+    int             block_size;
+
+    Fetcher        *fetchers;
+    int             nb_fetchers;
+    int64_t         fetch_pos;          ///< start of the next block to fetch
+    int64_t         fill_pos;           ///< position of the next byte written to the ring
+    unsigned        fetch_generation;   ///< incremented by seeks to drop blocks in flight
+    pthread_cond_t  cond_wakeup_fetch;
 } Context;
 
 static int ring_init(RingBuffer *ring, unsigned int capacity, int read_back_capacity)
@@ -129,11 +170,24 @@ static int ring_read(RingBuffer *ring, void *dest, int buf_size)
     return ret;
 }
 
+typedef struct WrappedRead {
+    URLContext *h;
+    int         done;
+} WrappedRead;
+
+/* Called by av_fifo_write_from_cb() until the request is filled, but only
+ * reads once, so that the caller sees what a single read returns. */
 static int wrapped_url_read(void *src, void *dst, size_t *size)
 {
-    URLContext *h   = src;
-    Context    *c   = h->priv_data;
-    int         ret;
+    WrappedRead *r  = src;
+    Context     *c  = r->h->priv_data;
+    int          ret;
+
+    if (r->done) {
+        *size = 0;
+        return 0;
+    }
+    r->done = 1;
 
     ret = ffurl_read(c->inner, dst, *size);
     *size             = ret > 0 ? ret : 0;
@@ -144,10 +198,11 @@ static int wrapped_url_read(void *src, void *dst, size_t *size)
 
 static int ring_write(RingBuffer *ring, URLContext *h, size_t size)
 {
+    WrappedRead r = { .h = h };
     int ret;
 
     av_assert2(size <= ring_space(ring));
-    ret = av_fifo_write_from_cb(ring->fifo, wrapped_url_read, h, &size);
+    ret = av_fifo_write_from_cb(ring->fifo, wrapped_url_read, &r, &size);
     if (ret < 0)
         return ret;
 
@@ -181,6 +236,113 @@ static int async_check_interrupt(void *arg)
     return c->abort_request;
 }
 
+static void *fetcher_task(void *arg)
+{
+    Fetcher    *f = arg;
+    URLContext *h = f->h;
+    Context    *c = h->priv_data;
+
+    ff_thread_setname("async-fetch");
+
+    pthread_mutex_lock(&c->mutex);
+    while (!async_check_interrupt(h)) {
+        unsigned generation;
+        int64_t  pos, ret;
+        int      size, got = 0;
+
+        if (f->state != FETCHER_IDLE || c->fetch_pos >= c->logical_size) {
+            pthread_cond_wait(&c->cond_wakeup_fetch, &c->mutex);
+            continue;
+        }
+
+        pos           = c->fetch_pos;
+        size          = FFMIN(c->block_size, c->logical_size - pos);
+        generation    = c->fetch_generation;
+        c->fetch_pos += size;
+        f->state      = FETCHER_BUSY;
+        pthread_mutex_unlock(&c->mutex);
+
+        ret = ffurl_seek(f->inner, pos, SEEK_SET);
+        while (ret >= 0 && got < size) {
+            ret = ffurl_read(f->inner, f->buf + got, size - got);
+            if (ret > 0)
+                got += ret;
+        }
+
+        pthread_mutex_lock(&c->mutex);
+        if (generation != c->fetch_generation) {
+            f->state = FETCHER_IDLE;
+            continue;
+        }
+        f->pos      = pos;
+        f->size     = got;
+        f->consumed = 0;
+        f->ret      = ret < 0 ? (int)ret : 0;
+        f->state    = FETCHER_DONE;
+        pthread_cond_signal(&c->cond_wakeup_background);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+/**
+ * Move the data of the fetched block starting at fill_pos to the ring.
+ * Called with the mutex locked, returns with it locked.
+ *
+ * @return 0 if data was moved, 1 if the block has not arrived yet
+ */
+static int fetched_block_to_ring(URLContext *h, int fifo_space)
+{
+    Context  *c = h->priv_data;
+    Fetcher  *f = NULL;
+    int i, size;
+
+    if (c->fill_pos >= c->logical_size) {
+        c->io_eof_reached = 1;
+        return 0;
+    }
+
+    for (i = 0; i < c->nb_fetchers; i++) {
+        if (c->fetchers[i].state == FETCHER_DONE &&
+            c->fetchers[i].pos + c->fetchers[i].consumed == c->fill_pos) {
+            f = &c->fetchers[i];
+            break;
+        }
+    }
+    if (!f)
+        return 1;
+
+    size = FFMIN(f->size - f->consumed, fifo_space);
+    pthread_mutex_unlock(&c->mutex);
+    av_fifo_write(c->ring.fifo, f->buf + f->consumed, size);
+    pthread_mutex_lock(&c->mutex);
+
+    f->consumed += size;
+    c->fill_pos += size;
+    if (f->consumed == f->size) {
+        if (f->ret < 0 || f->size < c->block_size && c->fill_pos < c->logical_size) {
+            c->io_eof_reached = 1;
+            c->io_error       = f->ret < 0 && f->ret != AVERROR_EOF ? f->ret : 0;
+        }
+        f->state = FETCHER_IDLE;
+        pthread_cond_broadcast(&c->cond_wakeup_fetch);
+    }
+    return 0;
+}
+
+static void async_buffer_task_reset_fetch(Context *c, int64_t pos)
+{
+    int i;
+
+    c->fetch_generation++;
+    c->fetch_pos = c->fill_pos = pos;
+    for (i = 0; i < c->nb_fetchers; i++)
+        if (c->fetchers[i].state == FETCHER_DONE)
+            c->fetchers[i].state = FETCHER_IDLE;
+    pthread_cond_broadcast(&c->cond_wakeup_fetch);
+}
+
 static void *async_buffer_task(void *arg)
 {
     URLContext   *h    = arg;
@@ -204,11 +366,19 @@ static void *async_buffer_task(void *arg)
         }
 
         if (c->seek_request) {
-            seek_ret = ffurl_seek(c->inner, c->seek_pos, c->seek_whence);
+            /* In parallel mode, async_seek() has already checked the
+             * position against the size and the fetchers seek themselves. */
+            if (c->nb_fetchers)
+                seek_ret = c->seek_pos;
+            else
+                seek_ret = ffurl_seek(c->inner, c->seek_pos, c->seek_whence);
             if (seek_ret >= 0) {
                 c->io_eof_reached = 0;
                 c->io_error       = 0;
                 ring_reset(ring);
+                c->read_size      = MIN_READ_SIZE;
+                if (c->nb_fetchers)
+                    async_buffer_task_reset_fetch(c, seek_ret);
             }
 
             c->seek_completed = 1;
@@ -228,10 +398,24 @@ static void *async_buffer_task(void *arg)
             pthread_mutex_unlock(&c->mutex);
             continue;
         }
+
+        if (c->nb_fetchers) {
+            if (fetched_block_to_ring(h, fifo_space) > 0)
+                pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
+            else
+                pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
         pthread_mutex_unlock(&c->mutex);
 
-        to_copy = FFMIN(4096, fifo_space);
+        to_copy = FFMIN(c->read_size, fifo_space);
         ret = ring_write(ring, h, to_copy);
+        /* Grow the reads while a single read of the inner protocol fills
+         * them, so fast sources are drained with fewer calls and lock round
+         * trips. */
+        if (ret == to_copy && c->read_size < MAX_READ_SIZE)
+            c->read_size *= 2;
 
         pthread_mutex_lock(&c->mutex);
         if (ret <= 0) {
@@ -247,20 +431,106 @@ static void *async_buffer_task(void *arg)
     return NULL;
 }
 
+static void stop_fetchers(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int i;
+
+    if (!c->fetchers)
+        return;
+
+    pthread_mutex_lock(&c->mutex);
+    c->abort_request = 1;
+    pthread_cond_broadcast(&c->cond_wakeup_fetch);
+    pthread_mutex_unlock(&c->mutex);
+
+    for (i = 0; i < c->connections; i++) {
+        Fetcher *f = &c->fetchers[i];
+        if (f->thread_started)
+            pthread_join(f->thread, NULL);
+        /* The first fetcher uses the main connection. */
+        if (i)
+            ffurl_closep(&f->inner);
+        av_freep(&f->buf);
+    }
+    av_freep(&c->fetchers);
+    c->nb_fetchers = 0;
+}
+
+/**
+ * Open the additional connections and start the fetcher threads. Fewer
+ * connections are used if some of them cannot be opened.
+ */
+static int start_fetchers(URLContext *h, const char *arg, int flags,
+                          const AVDictionary *options)
+{
+    Context         *c = h->priv_data;
+    AVIOInterruptCB  interrupt_callback = {.callback = async_check_interrupt, .opaque = h};
+    int i, ret;
+
+    c->fetchers = av_calloc(c->connections, sizeof(*c->fetchers));
+    if (!c->fetchers)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < c->connections; i++) {
+        Fetcher *f = &c->fetchers[i];
+
+        f->h = h;
+        if (i) {
+            AVDictionary *opts = NULL;
+
+            av_dict_copy(&opts, options, 0);
+            ret = ffurl_open_whitelist(&f->inner, arg, flags, &interrupt_callback, &opts,
+                                       h->protocol_whitelist, h->protocol_blacklist, h);
+            av_dict_free(&opts);
+            if (ret < 0) {
+                av_log(h, AV_LOG_WARNING, "Could only open %d connections: %s\n",
+                       i, av_err2str(ret));
+                break;
+            }
+        } else {
+            f->inner = c->inner;
+        }
+
+        f->buf = av_malloc(c->block_size);
+        if (!f->buf) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+
+        ret = pthread_create(&f->thread, NULL, fetcher_task, f);
+        if (ret) {
+            ret = AVERROR(ret);
+            av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(ret));
+            goto fail;
+        }
+        f->thread_started = 1;
+        c->nb_fetchers++;
+    }
+
+    return 0;
+fail:
+    stop_fetchers(h);
+    return ret;
+}
+
 static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     Context         *c = h->priv_data;
     int              ret;
     AVIOInterruptCB  interrupt_callback = {.callback = async_check_interrupt, .opaque = h};
+    AVDictionary    *inner_options = NULL;
 
     av_strstart(arg, "async:", &arg);
 
-    ret = ring_init(&c->ring, BUFFER_CAPACITY, READ_BACK_CAPACITY);
+    ret = ring_init(&c->ring, c->readahead_size, c->readback_size);
     if (ret < 0)
         goto fifo_fail;
 
     /* wrap interrupt callback */
     c->interrupt_callback = h->interrupt_callback;
+    if (c->connections > 1 && options)
+        av_dict_copy(&inner_options, *options, 0);
     ret = ffurl_open_whitelist(&c->inner, arg, flags, &interrupt_callback, options, h->protocol_whitelist, h->protocol_blacklist, h);
     if (ret != 0) {
         av_log(h, AV_LOG_ERROR, "ffurl_open failed : %s, %s\n", av_err2str(ret), arg);
@@ -268,6 +538,7 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
     }
 
     c->logical_size = ffurl_size(c->inner);
+    c->read_size    = MIN_READ_SIZE;
     h->is_streamed  = c->inner->is_streamed;
 
     ret = pthread_mutex_init(&c->mutex, NULL);
@@ -291,6 +562,26 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
         goto cond_wakeup_background_fail;
     }
 
+    ret = pthread_cond_init(&c->cond_wakeup_fetch, NULL);
+    if (ret != 0) {
+        ret = AVERROR(ret);
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(ret));
+        goto cond_wakeup_fetch_fail;
+    }
+
+    /* Parallel block fetching needs random access to a resource of known size. */
+    if (c->connections > 1) {
+        if (c->logical_size > 0 && !h->is_streamed) {
+            ret = start_fetchers(h, arg, flags, inner_options);
+            if (ret < 0)
+                goto fetchers_fail;
+        } else {
+            av_log(h, AV_LOG_WARNING, "Input is not seekable or has an unknown "
+                   "size, using a single connection\n");
+        }
+    }
+    av_dict_free(&inner_options);
+
     ret = pthread_create(&c->async_buffer_thread, NULL, async_buffer_task, h);
     if (ret) {
         ret = AVERROR(ret);
@@ -301,6 +592,10 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
     return 0;
 
 thread_fail:
+    stop_fetchers(h);
+fetchers_fail:
+    pthread_cond_destroy(&c->cond_wakeup_fetch);
+cond_wakeup_fetch_fail:
     pthread_cond_destroy(&c->cond_wakeup_background);
 cond_wakeup_background_fail:
     pthread_cond_destroy(&c->cond_wakeup_main);
@@ -309,6 +604,7 @@ cond_wakeup_main_fail:
 mutex_fail:
     ffurl_closep(&c->inner);
 url_fail:
+    av_dict_free(&inner_options);
     ring_destroy(&c->ring);
 fifo_fail:
     return ret;
@@ -328,6 +624,8 @@ static int async_close(URLContext *h)
     if (ret != 0)
         av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(ret));
 
+    stop_fetchers(h);
+    pthread_cond_destroy(&c->cond_wakeup_fetch);
     pthread_cond_destroy(&c->cond_wakeup_background);
     pthread_cond_destroy(&c->cond_wakeup_main);
     pthread_mutex_destroy(&c->mutex);
@@ -476,6 +774,10 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 #define D AV_OPT_FLAG_DECODING_PARAM
 
 static const AVOption options[] = {
+    { "readahead_size", "size of the buffer filled ahead of the read position", OFFSET(readahead_size), AV_OPT_TYPE_INT, { .i64 = BUFFER_CAPACITY }, MIN_READ_SIZE, INT_MAX / 4, D },
+    { "readback_size", "size of the already read data kept for backward seeks", OFFSET(readback_size), AV_OPT_TYPE_INT, { .i64 = READ_BACK_CAPACITY }, 0, INT_MAX / 4, D },
+    { "connections", "number of connections fetching blocks in parallel", OFFSET(connections), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, MAX_CONNECTIONS, D },
+    { "block_size", "size of the blocks fetched by each connection", OFFSET(block_size), AV_OPT_TYPE_INT, { .i64 = 1024 * 1024 }, MIN_READ_SIZE, INT_MAX / 4, D },
     {NULL},
 };
 
@@ -57,9 +57,11 @@ void ff_free_stream(AVStream **pst)
     av_bsf_free(&sti->bsfc);
     av_freep(&sti->priv_pts);
     av_freep(&sti->index_entries);
+    av_freep(&sti->index_dir);
     av_freep(&sti->probe_data.buf);
 
     av_bsf_free(&sti->extract_extradata.bsf);
+    avpriv_packet_list_free(&sti->interleave_queue);
 
     if (sti->info) {
         av_freep(&sti->info->duration_error);
@@ -88,6 +90,7 @@ void ff_flush_packet_queue(AVFormatContext *s)
     avpriv_packet_list_free(&si->parse_queue);
     avpriv_packet_list_free(&si->packet_buffer);
     avpriv_packet_list_free(&si->raw_packet_buffer);
+    ff_parse_thread_flush(s);
 
     si->raw_packet_buffer_size = 0;
 }
@@ -131,6 +134,8 @@ void avformat_free_context(AVFormatContext *s)
     av_dict_free(&si->id3v2_meta);
     av_packet_free(&si->pkt);
     av_packet_free(&si->parse_pkt);
+    ff_parse_thread_free(s);
+    av_freep(&si->interleave_heap);
     av_freep(&s->streams);
     ff_flush_packet_queue(s);
     av_freep(&s->url);
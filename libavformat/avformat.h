@@ -1823,6 +1823,43 @@ typedef struct AVFormatContext {
      * @return 0 on success, a negative AVERROR code on failure
      */
     int (*io_close2)(struct AVFormatContext *s, AVIOContext *pb);
+
+    /**
+     * Number of threads decoding the packets read by
+     * avformat_find_stream_info(), 0 for automatic.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int probe_threads;
+
+    /**
+     * Maximum wall clock time spent in avformat_find_stream_info() before
+     * it stops reading packets, in AV_TIME_BASE units. 0 means no limit.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int64_t max_probe_time;
+
+    /**
+     * Directory where avformat_find_stream_info() stores the stream
+     * parameters it found, keyed by URL. When the streams found by the
+     * demuxer on a later open of the same URL match an entry, the parameters
+     * are taken from it and probing stops as soon as every stream has a
+     * timestamp.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    char *stream_info_cache;
+
+    /**
+     * Number of threads running the parsers of the streams, 0 for
+     * automatic. With more than one thread, the packets of different
+     * streams are parsed concurrently and returned in the same order.
+     * Must be set before the first packet is read.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int parse_threads;
 } AVFormatContext;
 
 /**
@@ -654,6 +654,20 @@ int ffurl_get_short_seek(URLContext *h)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_map(URLContext *h, int64_t pos, int size, AVBufferRef **buf)
+{
+    if (!h || !h->prot || !h->prot->url_map)
+        return AVERROR(ENOSYS);
+    return h->prot->url_map(h, pos, size, buf);
+}
+
+int ffurl_flush(URLContext *h)
+{
+    if (!h || !h->prot || !h->prot->url_flush)
+        return 0;
+    return h->prot->url_flush(h);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
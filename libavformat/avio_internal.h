@@ -163,6 +163,17 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size);
 
 int ffio_limit(AVIOContext *s, int size);
 
+struct AVPacket;
+
+/**
+ * Make pkt reference the next size bytes of s without copying them, if the
+ * underlying protocol can map them into memory, and skip past them.
+ *
+ * @return size on success, AVERROR(ENOSYS) if the data has to be read
+ *         normally, another negative error code on failure
+ */
+int ffio_get_mapped_packet(AVIOContext *s, struct AVPacket *pkt, int size);
+
 void ffio_init_checksum(AVIOContext *s,
                         unsigned long (*update_checksum)(unsigned long c, const uint8_t *p, unsigned int len),
                         unsigned long checksum);
@@ -28,6 +28,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/avassert.h"
 #include "libavcodec/defs.h"
+#include "libavcodec/packet.h"
 #include "avio.h"
 #include "avio_internal.h"
 #include "internal.h"
@@ -231,6 +232,8 @@ void ffio_fill(AVIOContext *s, int b, int64_t count)
 
 void avio_write(AVIOContext *s, const unsigned char *buf, int size)
 {
+    URLContext *h;
+
     if (size <= 0)
         return;
     if (s->direct && !s->update_checksum) {
@@ -238,8 +241,30 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
         writeout(s, buf, size);
         return;
     }
+    /* Stream protocols have no write boundaries to keep, so data larger
+     * than the buffer is written out from the caller's memory in a single
+     * call, after whatever is buffered. */
+    if (size >= s->buf_end - s->buffer && s->buf_ptr >= s->buf_ptr_max &&
+        !s->update_checksum && s->write_flag &&
+        (h = ffio_geturlcontext(s)) && !h->max_packet_size) {
+        flush_buffer(s);
+        writeout(s, buf, size);
+        return;
+    }
     do {
         int len = FFMIN(s->buf_end - s->buf_ptr, size);
+        /* A whole buffer worth of data for an empty buffer is written out
+         * from the caller's memory. Only protocols are given such data, as
+         * they do not write to it, and the writes are identical to those
+         * done through the buffer. */
+        if (len == s->buf_end - s->buffer && s->buf_ptr_max == s->buffer &&
+            s->buf_ptr == s->buffer && !s->update_checksum &&
+            ffio_geturlcontext(s)) {
+            writeout(s, buf, len);
+            buf  += len;
+            size -= len;
+            continue;
+        }
         memcpy(s->buf_ptr, buf, len);
         s->buf_ptr += len;
 
@@ -255,6 +280,12 @@ void avio_flush(AVIOContext *s)
 {
     int seekback = s->write_flag ? FFMIN(0, s->buf_ptr - s->buf_ptr_max) : 0;
     flush_buffer(s);
+    if (s->write_flag) {
+        /* make the data visible to other readers of the resource */
+        int ret = ffurl_flush(ffio_geturlcontext(s));
+        if (ret < 0 && !s->error)
+            s->error = ret;
+    }
     if (seekback)
         avio_seek(s, seekback, SEEK_CUR);
 }
@@ -1025,7 +1056,7 @@ URLContext* ffio_geturlcontext(AVIOContext *s)
 int ffio_copy_url_options(AVIOContext* pb, AVDictionary** avio_opts)
 {
     const char *opts[] = {
-        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy", NULL };
+        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy", "http2", NULL };
     const char **opt = opts;
     uint8_t *buf = NULL;
     int ret = 0;
@@ -1118,6 +1149,40 @@ int ffio_limit(AVIOContext *s, int size)
     return size;
 }
 
+int ffio_get_mapped_packet(AVIOContext *s, AVPacket *pkt, int size)
+{
+    URLContext *h = ffio_geturlcontext(s);
+    int64_t pos = avio_tell(s);
+    int64_t res;
+    int ret;
+
+    if (!h || s->write_flag || s->update_checksum || size <= 0 || pos < 0)
+        return AVERROR(ENOSYS);
+
+    ret = ffurl_map(h, pos, size, &pkt->buf);
+    if (ret < 0)
+        return ret;
+    pkt->data = pkt->buf->data;
+    pkt->size = size;
+
+    if (size <= s->buf_end - s->buf_ptr) {
+        s->buf_ptr += size;
+        return size;
+    }
+
+    /* seek instead of reading what lies in between into the buffer */
+    res = s->seek(s->opaque, pos + size, SEEK_SET);
+    if (res < 0) {
+        av_packet_unref(pkt);
+        return res;
+    }
+    s->buf_end = s->buf_ptr = s->buf_ptr_max = s->buffer;
+    s->pos = pos + size;
+    s->eof_reached = 0;
+
+    return size;
+}
+
 static int set_buf_size(AVIOContext *s, int buf_size)
 {
     uint8_t *buffer;
@@ -23,16 +23,18 @@
 
 /**
  * @TODO
- *      support keeping files
  *      support filling with a background thread
  */
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/file_open.h"
+#include "libavutil/md5.h"
 #include "libavutil/opt.h"
+#include "libavutil/random_seed.h"
 #include "libavutil/tree.h"
 #include "avio.h"
+#include "internal.h"
 #include <fcntl.h>
 #if HAVE_IO_H
 #include <io.h>
@@ -41,6 +43,7 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
@@ -64,6 +67,9 @@ typedef struct Context {
     URLContext *inner;
     int64_t cache_hit, cache_miss;
     int read_ahead_limit;
+    char *cache_dir;
+    char *index_filename;
+    int64_t inner_size;
 } Context;
 
 static int cmp(const void *key, const void *node)
@@ -71,6 +77,189 @@ static int cmp(const void *key, const void *node)
     return FFDIFFSIGN(*(const int64_t *)key, ((const CacheEntry *) node)->logical_pos);
 }
 
+static int enu_free(void *opaque, void *elem)
+{
+    av_free(elem);
+    return 0;
+}
+
+static int add_range(Context *c, int64_t pos, int64_t size)
+{
+    while (size > 0) {
+        CacheEntry *entry, *entry_ret;
+        struct AVTreeNode *node;
+        int chunk = FFMIN(size, INT_MAX);
+
+        entry = av_malloc(sizeof(*entry));
+        node  = av_tree_node_alloc();
+        if (!entry || !node) {
+            av_free(entry);
+            av_free(node);
+            return AVERROR(ENOMEM);
+        }
+        entry->logical_pos  = pos;
+        entry->physical_pos = pos;
+        entry->size         = chunk;
+
+        entry_ret = av_tree_insert(&c->root, entry, cmp, &node);
+        if (entry_ret && entry_ret != entry) {
+            entry_ret->size = FFMAX(entry_ret->size, chunk);
+            av_free(entry);
+            av_free(node);
+        }
+        pos  += chunk;
+        size -= chunk;
+    }
+    return 0;
+}
+
+/**
+ * Add the ranges listed in the index file to the cached ranges.
+ * The index is ignored if it was written for a resource of another size,
+ * ranges are clipped to the data actually present in the data file.
+ */
+static int load_index(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int64_t size, pos;
+    struct stat st;
+    FILE *f;
+    int ret = 0;
+
+    if (fstat(c->fd, &st) < 0)
+        return AVERROR(errno);
+
+    f = avpriv_fopen_utf8(c->index_filename, "r");
+    if (!f)
+        return 0;
+
+    if (fscanf(f, "ffcache %"SCNd64"\n", &size) == 1 && size == c->inner_size) {
+        while (fscanf(f, "%"SCNd64" %"SCNd64"\n", &pos, &size) == 2) {
+            if (pos < 0 || size <= 0 || size > c->inner_size - pos)
+                break;
+            /* the data file may have been truncated or replaced */
+            if (pos >= st.st_size)
+                continue;
+            size = FFMIN(size, st.st_size - pos);
+            if ((ret = add_range(c, pos, size)) < 0)
+                break;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+typedef struct IndexWriter {
+    FILE *f;
+    int64_t start, end;
+} IndexWriter;
+
+static int write_index_entry(void *opaque, void *elem)
+{
+    IndexWriter *w = opaque;
+    const CacheEntry *entry = elem;
+
+    if (entry->logical_pos > w->end) {
+        if (w->end > w->start)
+            fprintf(w->f, "%"PRId64" %"PRId64"\n", w->start, w->end - w->start);
+        w->start = entry->logical_pos;
+    }
+    w->end = FFMAX(w->end, entry->logical_pos + entry->size);
+    return 0;
+}
+
+/**
+ * Write the cached ranges, merged with those that other instances sharing
+ * the cache directory have added in the meantime, and atomically replace
+ * the index file.
+ */
+static int save_index(URLContext *h)
+{
+    Context *c = h->priv_data;
+    IndexWriter w = { 0 };
+    char *tmp;
+    int ret;
+
+    if ((ret = load_index(h)) < 0)
+        return ret;
+
+    tmp = av_asprintf("%s.%08"PRIx32".tmp", c->index_filename, av_get_random_seed());
+    if (!tmp)
+        return AVERROR(ENOMEM);
+
+    w.f = avpriv_fopen_utf8(tmp, "w");
+    if (!w.f) {
+        ret = AVERROR(errno);
+        av_free(tmp);
+        return ret;
+    }
+    fprintf(w.f, "ffcache %"PRId64"\n", c->inner_size);
+    av_tree_enumerate(c->root, &w, NULL, write_index_entry);
+    if (w.end > w.start)
+        fprintf(w.f, "%"PRId64" %"PRId64"\n", w.start, w.end - w.start);
+
+    ret = ferror(w.f) ? AVERROR(EIO) : 0;
+    if (fclose(w.f) && !ret)
+        ret = AVERROR(errno);
+    if (!ret && rename(tmp, c->index_filename) < 0)
+        ret = AVERROR(errno);
+    if (ret < 0)
+        unlink(tmp);
+    av_free(tmp);
+    return ret;
+}
+
+/**
+ * Open the shared cache files for the resource in cache_dir. The data file
+ * holds each cached byte at its offset in the resource, the index file
+ * lists the valid ranges. Leaves index_filename unset if the resource
+ * cannot be cached persistently.
+ */
+static int open_persistent_cache(URLContext *h, const char *url)
+{
+    Context *c = h->priv_data;
+    uint8_t md5[16];
+    char key[33];
+    char *data_filename;
+    int ret;
+
+    c->inner_size = ffurl_size(c->inner);
+    if (c->inner_size <= 0) {
+        av_log(h, AV_LOG_WARNING, "Size of '%s' is unknown, "
+               "not caching it in %s\n", url, c->cache_dir);
+        return 0;
+    }
+
+    if (ff_mkdir_p(c->cache_dir) < 0 && errno != EEXIST) {
+        ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to create cache directory %s\n", c->cache_dir);
+        return ret;
+    }
+
+    av_md5_sum(md5, url, strlen(url));
+    ff_data_to_hex(key, md5, sizeof(md5), 1);
+
+    data_filename     = av_asprintf("%s/%s.data",  c->cache_dir, key);
+    c->index_filename = av_asprintf("%s/%s.index", c->cache_dir, key);
+    if (!data_filename || !c->index_filename) {
+        av_free(data_filename);
+        av_freep(&c->index_filename);
+        return AVERROR(ENOMEM);
+    }
+
+    c->fd = avpriv_open(data_filename, O_RDWR | O_CREAT, 0666);
+    if (c->fd < 0) {
+        ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to open %s\n", data_filename);
+        av_free(data_filename);
+        av_freep(&c->index_filename);
+        return ret;
+    }
+    av_free(data_filename);
+
+    return load_index(h);
+}
+
 static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     int ret;
@@ -79,10 +268,25 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "cache:", &arg);
 
+    c->fd = -1;
+    ret = ffurl_open_whitelist(&c->inner, arg, flags, &h->interrupt_callback,
+                               options, h->protocol_whitelist, h->protocol_blacklist, h);
+    if (ret < 0)
+        return ret;
+
+    if (c->cache_dir) {
+        ret = open_persistent_cache(h, arg);
+        if (ret < 0)
+            goto fail;
+        if (c->index_filename)
+            return 0;
+    }
+
     c->fd = avpriv_tempfile("ffcache", &buffername, 0, h);
     if (c->fd < 0){
         av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
-        return c->fd;
+        ret = c->fd;
+        goto fail;
     }
 
     ret = unlink(buffername);
@@ -92,8 +296,16 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
     else
         c->filename = buffername;
 
-    return ffurl_open_whitelist(&c->inner, arg, flags, &h->interrupt_callback,
-                                options, h->protocol_whitelist, h->protocol_blacklist, h);
+    return 0;
+fail:
+    if (c->fd >= 0)
+        close(c->fd);
+    av_freep(&c->index_filename);
+    av_tree_enumerate(c->root, NULL, NULL, enu_free);
+    av_tree_destroy(c->root);
+    c->root = NULL;
+    ffurl_closep(&c->inner);
+    return ret;
 }
 
 static int add_entry(URLContext *h, const unsigned char *buf, int size)
@@ -106,7 +318,11 @@ static int add_entry(URLContext *h, const unsigned char *buf, int size)
     struct AVTreeNode *node = NULL;
 
     //FIXME avoid lseek
-    pos = lseek(c->fd, 0, SEEK_END);
+    /* The persistent cache stores the data at its logical position. */
+    if (c->index_filename)
+        pos = lseek(c->fd, c->logical_pos, SEEK_SET);
+    else
+        pos = lseek(c->fd, 0, SEEK_END);
     if (pos < 0) {
         ret = AVERROR(errno);
         av_log(h, AV_LOG_ERROR, "seek in cache failed\n");
@@ -143,9 +359,12 @@ static int add_entry(URLContext *h, const unsigned char *buf, int size)
 
         entry_ret = av_tree_insert(&c->root, entry, cmp, &node);
         if (entry_ret && entry_ret != entry) {
-            ret = -1;
-            av_log(h, AV_LOG_ERROR, "av_tree_insert failed\n");
-            goto fail;
+            /* an entry at this position could not be read back,
+             * replace it with the data just written */
+            entry_ret->physical_pos = pos;
+            entry_ret->size         = ret;
+            av_free(entry);
+            av_free(node);
         }
     } else
         entry->size += ret;
@@ -164,6 +383,7 @@ static int cache_read(URLContext *h, unsigned char *buf, int size)
     Context *c= h->priv_data;
     CacheEntry *entry, *next[2] = {NULL, NULL};
     int64_t r;
+    int ret;
 
     entry = av_tree_find(c->root, &c->logical_pos, cmp, (void**)next);
 
@@ -217,7 +437,10 @@ static int cache_read(URLContext *h, unsigned char *buf, int size)
 
     c->cache_miss ++;
 
-    add_entry(h, buf, r);
+    /* the data is still returned if it could not be written to the cache */
+    ret = add_entry(h, buf, r);
+    if (ret == AVERROR(ENOMEM))
+        return ret;
     c->logical_pos += r;
     c->end = FFMAX(c->end, c->logical_pos);
 
@@ -289,12 +512,6 @@ resolve_eof:
     return ret;
 }
 
-static int enu_free(void *opaque, void *elem)
-{
-    av_free(elem);
-    return 0;
-}
-
 static int cache_close(URLContext *h)
 {
     Context *c= h->priv_data;
@@ -303,6 +520,14 @@ static int cache_close(URLContext *h)
     av_log(h, AV_LOG_INFO, "Statistics, cache hits:%"PRId64" cache misses:%"PRId64"\n",
            c->cache_hit, c->cache_miss);
 
+    if (c->index_filename) {
+        ret = save_index(h);
+        if (ret < 0)
+            av_log(h, AV_LOG_ERROR, "Could not update %s: %s\n",
+                   c->index_filename, av_err2str(ret));
+        av_freep(&c->index_filename);
+    }
+
     close(c->fd);
     if (c->filename) {
         ret = unlink(c->filename);
@@ -322,6 +547,7 @@ static int cache_close(URLContext *h)
 
 static const AVOption options[] = {
     { "read_ahead_limit", "Amount in bytes that may be read ahead when seeking isn't supported, -1 for unlimited", OFFSET(read_ahead_limit), AV_OPT_TYPE_INT, { .i64 = 65536 }, -1, INT_MAX, D },
+    { "cache_dir", "Directory in which the cached data is kept and shared between runs", OFFSET(cache_dir), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
     {NULL},
 };
 
@@ -24,6 +24,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "libavutil/timestamp.h"
 #include "libavcodec/codec_desc.h"
 #include "libavcodec/bsf.h"
@@ -59,6 +60,36 @@ typedef struct {
     int nb_streams;
 } ConcatFile;
 
+#if HAVE_THREADS
+enum PrefetchState {
+    PREFETCH_FREE,
+    PREFETCH_QUEUED,
+    PREFETCH_BUSY,
+    PREFETCH_DONE,
+};
+
+typedef struct PrefetchSlot {
+    enum PrefetchState state;
+    unsigned fileno;
+    AVFormatContext *avf;
+    int ret;
+} PrefetchSlot;
+
+/**
+ * Threads opening and probing the next files while the current one is
+ * read. File fileno is opened into slots[fileno % nb_slots].
+ */
+typedef struct ConcatPrefetch {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t *threads;
+    int nb_threads;
+    PrefetchSlot *slots;
+    unsigned nb_slots;
+    int exit;
+} ConcatPrefetch;
+#endif
+
 typedef struct {
     AVClass *class;
     ConcatFile *files;
@@ -71,6 +102,10 @@ typedef struct {
     ConcatMatchMode stream_match_mode;
     unsigned auto_convert;
     int segment_time_metadata;
+    int prefetch;
+#if HAVE_THREADS
+    ConcatPrefetch *pf;
+#endif
 } ConcatContext;
 
 static int concat_probe(const AVProbeData *probe)
@@ -332,35 +367,37 @@ static int64_t get_best_effort_duration(ConcatFile *file, AVFormatContext *avf)
     return AV_NOPTS_VALUE;
 }
 
-static int open_file(AVFormatContext *avf, unsigned fileno)
+/**
+ * Open and probe the file fileno, without touching the demuxer state
+ * so that it can be done from the prefetch threads.
+ */
+static int open_input(AVFormatContext *avf, unsigned fileno, AVFormatContext **pavf)
 {
     ConcatContext *cat = avf->priv_data;
     ConcatFile *file = &cat->files[fileno];
     AVDictionary *options = NULL;
+    AVFormatContext *new_avf;
     int ret;
 
-    if (cat->avf)
-        avformat_close_input(&cat->avf);
-
-    cat->avf = avformat_alloc_context();
-    if (!cat->avf)
+    new_avf = avformat_alloc_context();
+    if (!new_avf)
         return AVERROR(ENOMEM);
 
-    cat->avf->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
-    cat->avf->interrupt_callback = avf->interrupt_callback;
-
-    if ((ret = ff_copy_whiteblacklists(cat->avf, avf)) < 0)
-        return ret;
+    new_avf->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
+    new_avf->interrupt_callback = avf->interrupt_callback;
 
-    ret = av_dict_copy(&options, file->options, 0);
-    if (ret < 0)
+    if ((ret = ff_copy_whiteblacklists(new_avf, avf)) < 0 ||
+        (ret = av_dict_copy(&options, file->options, 0)) < 0) {
+        av_dict_free(&options);
+        avformat_free_context(new_avf);
         return ret;
+    }
 
-    if ((ret = avformat_open_input(&cat->avf, file->url, NULL, &options)) < 0 ||
-        (ret = avformat_find_stream_info(cat->avf, NULL)) < 0) {
+    if ((ret = avformat_open_input(&new_avf, file->url, NULL, &options)) < 0 ||
+        (ret = avformat_find_stream_info(new_avf, NULL)) < 0) {
         av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
         av_dict_free(&options);
-        avformat_close_input(&cat->avf);
+        avformat_close_input(&new_avf);
         return ret;
     }
     if (options) {
@@ -368,6 +405,176 @@ static int open_file(AVFormatContext *avf, unsigned fileno)
         /* TODO log unused options once we have a proper string API */
         av_dict_free(&options);
     }
+    *pavf = new_avf;
+    return 0;
+}
+
+#if HAVE_THREADS
+static void *prefetch_thread(void *arg)
+{
+    AVFormatContext *avf = arg;
+    ConcatContext *cat = avf->priv_data;
+    ConcatPrefetch *pf = cat->pf;
+
+    pthread_mutex_lock(&pf->lock);
+    while (!pf->exit) {
+        PrefetchSlot *slot = NULL;
+        AVFormatContext *new_avf = NULL;
+        unsigned fileno;
+        int ret;
+
+        /* open the files in playlist order */
+        for (unsigned i = 0; i < pf->nb_slots; i++) {
+            PrefetchSlot *cur = &pf->slots[i];
+            if (cur->state == PREFETCH_QUEUED &&
+                (!slot || cur->fileno < slot->fileno))
+                slot = cur;
+        }
+        if (!slot) {
+            pthread_cond_wait(&pf->cond, &pf->lock);
+            continue;
+        }
+
+        slot->state = PREFETCH_BUSY;
+        fileno      = slot->fileno;
+        pthread_mutex_unlock(&pf->lock);
+
+        ret = open_input(avf, fileno, &new_avf);
+
+        pthread_mutex_lock(&pf->lock);
+        slot->avf   = new_avf;
+        slot->ret   = ret;
+        slot->state = PREFETCH_DONE;
+        pthread_cond_broadcast(&pf->cond);
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+static void prefetch_uninit(ConcatContext *cat)
+{
+    ConcatPrefetch *pf = cat->pf;
+
+    if (!pf)
+        return;
+
+    pthread_mutex_lock(&pf->lock);
+    pf->exit = 1;
+    pthread_cond_broadcast(&pf->cond);
+    pthread_mutex_unlock(&pf->lock);
+    for (int i = 0; i < pf->nb_threads; i++)
+        pthread_join(pf->threads[i], NULL);
+
+    for (unsigned i = 0; i < pf->nb_slots; i++)
+        avformat_close_input(&pf->slots[i].avf);
+    av_freep(&pf->slots);
+    av_freep(&pf->threads);
+    pthread_cond_destroy(&pf->cond);
+    pthread_mutex_destroy(&pf->lock);
+    av_freep(&cat->pf);
+}
+
+static int prefetch_init(AVFormatContext *avf)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatPrefetch *pf;
+    int ret;
+
+    pf = cat->pf = av_mallocz(sizeof(*pf));
+    if (!pf)
+        return AVERROR(ENOMEM);
+
+    if ((ret = pthread_mutex_init(&pf->lock, NULL))) {
+        av_freep(&cat->pf);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pf->cond, NULL))) {
+        pthread_mutex_destroy(&pf->lock);
+        av_freep(&cat->pf);
+        return AVERROR(ret);
+    }
+
+    /* the file being opened and the next ones */
+    pf->slots   = av_calloc(cat->prefetch + 1, sizeof(*pf->slots));
+    pf->threads = av_calloc(cat->prefetch, sizeof(*pf->threads));
+    if (!pf->slots || !pf->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    pf->nb_slots = cat->prefetch + 1;
+
+    for (int i = 0; i < cat->prefetch; i++) {
+        ret = pthread_create(&pf->threads[i], NULL, prefetch_thread, avf);
+        if (ret) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        pf->nb_threads++;
+    }
+    return 0;
+fail:
+    prefetch_uninit(cat);
+    return ret;
+}
+
+/**
+ * Get the opened file fileno, queueing the opening of the next files.
+ */
+static int prefetch_get(AVFormatContext *avf, unsigned fileno, AVFormatContext **pavf)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatPrefetch *pf = cat->pf;
+    PrefetchSlot *slot = &pf->slots[fileno % pf->nb_slots];
+    int ret;
+
+    pthread_mutex_lock(&pf->lock);
+    while (1) {
+        for (unsigned n = fileno; n < fileno + pf->nb_slots && n < cat->nb_files; n++) {
+            PrefetchSlot *next = &pf->slots[n % pf->nb_slots];
+
+            /* files opened before a seek are discarded */
+            if (next->fileno == n && next->state != PREFETCH_FREE ||
+                next->state == PREFETCH_BUSY)
+                continue;
+            avformat_close_input(&next->avf);
+            next->fileno = n;
+            next->state  = PREFETCH_QUEUED;
+            pthread_cond_broadcast(&pf->cond);
+        }
+        if (slot->fileno == fileno && slot->state == PREFETCH_DONE)
+            break;
+        pthread_cond_wait(&pf->cond, &pf->lock);
+    }
+
+    *pavf = slot->avf;
+    ret   = slot->ret;
+    slot->avf   = NULL;
+    slot->state = PREFETCH_FREE;
+    pthread_mutex_unlock(&pf->lock);
+    return ret;
+}
+#endif
+
+static int open_file(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    int ret;
+
+    if (cat->avf)
+        avformat_close_input(&cat->avf);
+
+#if HAVE_THREADS
+    if (cat->prefetch) {
+        if (!cat->pf && (ret = prefetch_init(avf)) < 0)
+            return ret;
+        ret = prefetch_get(avf, fileno, &cat->avf);
+    } else
+#endif
+    ret = open_input(avf, fileno, &cat->avf);
+    if (ret < 0)
+        return ret;
+
     cat->cur_file = file;
     file->start_time = !fileno ? 0 :
                        cat->files[fileno - 1].start_time +
@@ -396,6 +603,9 @@ static int concat_read_close(AVFormatContext *avf)
     ConcatContext *cat = avf->priv_data;
     unsigned i, j;
 
+#if HAVE_THREADS
+    prefetch_uninit(cat);
+#endif
     for (i = 0; i < cat->nb_files; i++) {
         av_freep(&cat->files[i].url);
         for (j = 0; j < cat->files[i].nb_streams; j++) {
@@ -924,6 +1134,8 @@ static const AVOption options[] = {
       OFFSET(auto_convert), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, DEC },
     { "segment_time_metadata", "output file segment start time and duration as packet metadata",
       OFFSET(segment_time_metadata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "prefetch", "number of next files to open and probe in the background",
+      OFFSET(prefetch), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 16, DEC },
     { NULL }
 };
 
@@ -28,6 +28,7 @@
 #include "avio_internal.h"
 #include "dash.h"
 #include "demux.h"
+#include "prefetch.h"
 
 #define INITIAL_BUFFER_SIZE 32768
 
@@ -115,6 +116,10 @@ struct representation {
     uint32_t init_sec_buf_read_offset;
     int64_t cur_timestamp;
     int is_restart_needed;
+
+    FFPrefetcher *prefetch;
+    uint8_t *prefetched;        ///< data of the current fragment, if prefetched
+    size_t prefetched_size;
 };
 
 typedef struct DASHContext {
@@ -151,6 +156,8 @@ typedef struct DASHContext {
     AVDictionary *avio_opts;
     int max_url_size;
     char *cenc_decryption_key;
+    int prefetch_segments;
+    int64_t prefetch_max_size;
 
     /* Flags for init section*/
     int is_init_section_common_video;
@@ -354,6 +361,8 @@ static void free_representation(struct representation *pls)
     av_freep(&pls->init_sec_buf);
     av_freep(&pls->pb.pub.buffer);
     ff_format_io_close(pls->parent, &pls->input);
+    ff_prefetch_free(&pls->prefetch);
+    av_freep(&pls->prefetched);
     if (pls->ctx) {
         pls->ctx->pb = NULL;
         avformat_close_input(&pls->ctx);
@@ -1579,6 +1588,27 @@ finish:
     return ret;
 }
 
+static char *get_template_url(struct representation *pls, int64_t seq_no)
+{
+    DASHContext *c = pls->parent->priv_data;
+    char *tmpfilename, *url;
+
+    tmpfilename = av_mallocz(c->max_url_size);
+    if (!tmpfilename)
+        return NULL;
+    ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, seq_no, 0, get_segment_start_time_based_on_timeline(pls, seq_no));
+    url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+    if (!url) {
+        av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
+        url = av_strdup(pls->url_template);
+        if (!url)
+            av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
+    }
+    av_free(tmpfilename);
+
+    return url;
+}
+
 static struct fragment *get_current_fragment(struct representation *pls)
 {
     int64_t min_seq_no = 0;
@@ -1632,30 +1662,16 @@ static struct fragment *get_current_fragment(struct representation *pls)
         }
     }
     if (seg) {
-        char *tmpfilename;
         if (!pls->url_template) {
             av_log(pls->parent, AV_LOG_ERROR, "Cannot get fragment, missing template URL\n");
             av_free(seg);
             return NULL;
         }
-        tmpfilename = av_mallocz(c->max_url_size);
-        if (!tmpfilename) {
+        seg->url = get_template_url(pls, pls->cur_seq_no);
+        if (!seg->url) {
             av_free(seg);
             return NULL;
         }
-        ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, pls->cur_seq_no, 0, get_segment_start_time_based_on_timeline(pls, pls->cur_seq_no));
-        seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
-        if (!seg->url) {
-            av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
-            seg->url = av_strdup(pls->url_template);
-            if (!seg->url) {
-                av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
-                av_free(tmpfilename);
-                av_free(seg);
-                return NULL;
-            }
-        }
-        av_free(tmpfilename);
         seg->size = -1;
     }
 
@@ -1671,7 +1687,14 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, pls->cur_seg_size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetched) {
+        ret = FFMIN(buf_size, pls->prefetched_size - pls->cur_seg_offset);
+        if (ret <= 0)
+            return AVERROR_EOF;
+        memcpy(buf, pls->prefetched + pls->cur_seg_offset, ret);
+    } else {
+        ret = avio_read(pls->input, buf, buf_size);
+    }
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1710,6 +1733,78 @@ cleanup:
     return ret;
 }
 
+static void reset_prefetch(struct representation *pls)
+{
+    av_freep(&pls->prefetched);
+    if (pls->prefetch)
+        ff_prefetch_flush(pls->prefetch);
+}
+
+/* queue the download of the fragments following the current one */
+static void prefetch_fragments(DASHContext *c, struct representation *pls)
+{
+    char *url;
+    int ret;
+
+    if (!pls->prefetch) {
+        ret = ff_prefetch_alloc(&pls->prefetch, pls->parent, c->prefetch_segments,
+                                c->prefetch_segments, FFMIN(c->prefetch_max_size, SIZE_MAX));
+        if (ret < 0) {
+            av_log(pls->parent, AV_LOG_WARNING,
+                   "Cannot prefetch fragments: %s\n", av_err2str(ret));
+            c->prefetch_segments = 0;
+            return;
+        }
+    }
+
+    url = av_mallocz(c->max_url_size);
+    if (!url)
+        return;
+
+    for (int i = 1; i <= c->prefetch_segments; i++) {
+        const int64_t seq_no = pls->cur_seq_no + i;
+        const char *proto_name;
+        AVDictionary *opts = NULL;
+        int64_t offset = 0, size = -1;
+
+        /* only the fragments which are already available */
+        if (seq_no < pls->n_fragments) {
+            const struct fragment *seg = pls->fragments[seq_no];
+            ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
+            offset = seg->url_offset;
+            size   = seg->size;
+        } else if (!pls->n_fragments && pls->url_template &&
+                   seq_no <= (c->is_live ? calc_max_seg_no(pls, c) : pls->last_seq_no)) {
+            char *seg_url = get_template_url(pls, seq_no);
+            if (!seg_url)
+                break;
+            ff_make_absolute_url(url, c->max_url_size, c->base_url, seg_url);
+            av_free(seg_url);
+        } else {
+            break;
+        }
+
+        /* only plain http(s) fragments, as checked by open_url() */
+        proto_name = avio_find_protocol_name(url);
+        if (!proto_name || !av_strstart(proto_name, "http", NULL) ||
+            strncmp(url, proto_name, strlen(proto_name)) ||
+            url[strlen(proto_name)] != ':')
+            break;
+
+        av_dict_copy(&opts, c->avio_opts, 0);
+        av_dict_set(&opts, "multiple_requests", "1", 0);
+        if (size >= 0) {
+            av_dict_set_int(&opts, "offset", offset, 0);
+            av_dict_set_int(&opts, "end_offset", offset + size, 0);
+        }
+        ret = ff_prefetch_submit(pls->prefetch, seq_no, url, opts);
+        av_dict_free(&opts);
+        if (ret < 0)
+            break;
+    }
+    av_free(url);
+}
+
 static int update_init_section(struct representation *pls)
 {
     static const int max_init_section_size = 1024 * 1024;
@@ -1760,6 +1855,14 @@ static int64_t seek_data(void *opaque, int64_t offset, int whence)
 {
     struct representation *v = opaque;
     if (v->n_fragments && !v->init_sec_data_len) {
+        if (v->prefetched) {
+            if (whence == AVSEEK_SIZE)
+                return v->prefetched_size;
+            if (whence != SEEK_SET || offset < 0 || offset > v->prefetched_size)
+                return AVERROR(EINVAL);
+            v->cur_seg_offset = offset;
+            return offset;
+        }
         return avio_seek(v->input, offset, whence);
     }
 
@@ -1773,7 +1876,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     DASHContext *c = v->parent->priv_data;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->prefetched) {
         free_fragment(&v->cur_seg);
         v->cur_seg = get_current_fragment(v);
         if (!v->cur_seg) {
@@ -1786,7 +1889,22 @@ restart:
         if (ret)
             goto end;
 
-        ret = open_input(c, v, v->cur_seg);
+        if (v->prefetch &&
+            (ret = ff_prefetch_get(v->prefetch, v->cur_seq_no, &v->prefetched,
+                                   &v->prefetched_size)) != AVERROR(ENOENT)) {
+            if (ret < 0) {
+                if (ret == AVERROR_EXIT)
+                    goto end;
+                av_log(v->parent, AV_LOG_WARNING,
+                       "Prefetching fragment %"PRId64" failed, retrying\n", v->cur_seq_no);
+                ret = open_input(c, v, v->cur_seg);
+            } else {
+                v->cur_seg_offset = 0;
+                v->cur_seg_size   = v->cur_seg->size;
+            }
+        } else {
+            ret = open_input(c, v, v->cur_seg);
+        }
         if (ret < 0) {
             if (ff_check_interrupt(c->interrupt_callback)) {
                 ret = AVERROR_EXIT;
@@ -1796,6 +1914,9 @@ restart:
             v->cur_seq_no++;
             goto restart;
         }
+
+        if (c->prefetch_segments > 0)
+            prefetch_fragments(c, v);
     }
 
     if (v->init_sec_buf_read_offset < v->init_sec_data_len) {
@@ -2156,6 +2277,7 @@ static void recheck_discard_flags(AVFormatContext *s, struct representation **p,
         } else if (!needed && pls->ctx) {
             close_demux_for_component(pls);
             ff_format_io_close(pls->parent, &pls->input);
+            reset_prefetch(pls);
             av_log(s, AV_LOG_INFO, "No longer receiving stream_index %d\n", pls->stream_index);
         }
     }
@@ -2217,6 +2339,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
             cur->cur_seg_offset = 0;
             cur->init_sec_buf_read_offset = 0;
             ff_format_io_close(cur->parent, &cur->input);
+            av_freep(&cur->prefetched);
             ret = reopen_demux_for_component(s, cur);
             cur->is_restart_needed = 0;
         }
@@ -2256,6 +2379,7 @@ static int dash_seek(AVFormatContext *s, struct representation *pls, int64_t see
     }
 
     ff_format_io_close(pls->parent, &pls->input);
+    reset_prefetch(pls);
 
     // find the nearest fragment
     if (pls->n_timelines > 0 && pls->fragment_timescale > 0) {
@@ -2354,6 +2478,10 @@ static const AVOption dash_options[] = {
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm,ts"},
         INT_MIN, INT_MAX, FLAGS},
     { "cenc_decryption_key", "Media decryption key (hex)", OFFSET(cenc_decryption_key), AV_OPT_TYPE_STRING, {.str = NULL}, INT_MIN, INT_MAX, .flags = FLAGS },
+    {"prefetch_segments", "Number of upcoming fragments to download in the background",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 16, FLAGS},
+    {"prefetch_max_size", "Maximum memory used by the prefetched fragments of a representation",
+        OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
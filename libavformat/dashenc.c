@@ -52,6 +52,7 @@
 #include "isom.h"
 #include "mux.h"
 #include "os_support.h"
+#include "upload.h"
 #include "url.h"
 #include "vpcc.h"
 #include "dash.h"
@@ -176,6 +177,10 @@ typedef struct DASHContext {
     int hls_playlist;
     const char *hls_master_name;
     int http_persistent;
+    int upload_connections;
+    int64_t upload_max_size;
+    int upload_retries;
+    FFUploader *uploader;
     int master_playlist_created;
     AVIOContext *mpd_out;
     AVIOContext *m3u8_out;
@@ -225,12 +230,27 @@ static struct format_string {
     { 0, NULL }
 };
 
+/* The segments of a stream are uploaded in order, the manifests and playlists
+ * after all the files written before them. */
+static int upload_queue(AVFormatContext *s, AVIOContext **pb)
+{
+    DASHContext *c = s->priv_data;
+
+    for (int i = 0; i < s->nb_streams; i++)
+        if (pb == &c->streams[i].out)
+            return i;
+    return -1;
+}
+
 static int dashenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
                            AVDictionary **options) {
     DASHContext *c = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
-    if (!*pb || !http_base_proto || !c->http_persistent) {
+    if (c->uploader && http_base_proto) {
+        err = ff_uploader_open(c->uploader, pb, upload_queue(s, pb),
+                               filename, options ? *options : NULL);
+    } else if (!*pb || !http_base_proto || !c->http_persistent) {
         err = s->io_open(s, pb, filename, AVIO_FLAG_WRITE, options);
 #if CONFIG_HTTP_PROTOCOL
     } else {
@@ -251,6 +271,9 @@ static void dashenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filenam
     if (!*pb)
         return;
 
+    if (c->uploader && ff_uploader_close(c->uploader, pb) != AVERROR(ENOENT))
+        return;
+
     if (!http_base_proto || !c->http_persistent) {
         ff_format_io_close(s, pb);
 #if CONFIG_HTTP_PROTOCOL
@@ -617,6 +640,8 @@ static void dash_free(AVFormatContext *s)
         c->nb_as = 0;
     }
 
+    ff_uploader_free(&c->uploader);
+
     if (!c->streams)
         return;
     for (i = 0; i < s->nb_streams; i++) {
@@ -1463,6 +1488,21 @@ static int dash_init(AVFormatContext *s)
         c->min_playback_rate = c->max_playback_rate = (AVRational) {1, 1};
     }
 
+    if (c->upload_connections > 0 && ff_is_http_proto(s->url)) {
+        if (c->single_file || c->streaming) {
+            av_log(s, AV_LOG_WARNING, "Background uploads are not supported "
+                   "with single_file and streaming\n");
+        } else {
+            ret = ff_uploader_alloc(&c->uploader, s, c->upload_connections,
+                                    FFMIN(c->upload_max_size, SIZE_MAX),
+                                    c->upload_retries);
+            if (ret == AVERROR(ENOSYS))
+                av_log(s, AV_LOG_WARNING, "Background uploads need threads\n");
+            else if (ret < 0)
+                return ret;
+        }
+    }
+
     av_strlcpy(c->dirname, s->url, sizeof(c->dirname));
     ptr = strrchr(c->dirname, '/');
     if (ptr) {
@@ -1588,7 +1628,7 @@ static int dash_init(AVFormatContext *s)
         if (!c->single_file) {
             if ((ret = avio_open_dyn_buf(&ctx->pb)) < 0)
                 return ret;
-            ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, &opts);
+            ret = dashenc_io_open(s, &os->out, filename, &opts);
         } else {
             ctx->url = av_strdup(filename);
             ret = avio_open2(&ctx->pb, filename, AVIO_FLAG_WRITE, NULL, &opts);
@@ -1861,7 +1901,10 @@ static void dashenc_delete_file(AVFormatContext *s, char *filename) {
         set_http_options(&http_opts, c);
         av_dict_set(&http_opts, "method", "DELETE", 0);
 
-        if (dashenc_io_open(s, &out, filename, &http_opts) < 0) {
+        if (c->uploader) {
+            if (ff_uploader_submit(c->uploader, -1, filename, http_opts, NULL, 0) < 0)
+                av_log(s, AV_LOG_ERROR, "failed to delete %s\n", filename);
+        } else if (dashenc_io_open(s, &out, filename, &http_opts) < 0) {
             av_log(s, AV_LOG_ERROR, "failed to delete %s\n", filename);
         }
 
@@ -2335,6 +2378,12 @@ static int dash_write_trailer(AVFormatContext *s)
         }
     }
 
+    if (c->uploader) {
+        int ret = ff_uploader_wait(c->uploader);
+        if (ret < 0 && !c->ignore_io_errors)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -2383,6 +2432,9 @@ static const AVOption options[] = {
     { "method", "set the HTTP method", OFFSET(method), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, E },
     { "http_user_agent", "override User-Agent field in HTTP header", OFFSET(user_agent), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, E},
     { "http_persistent", "Use persistent HTTP connections", OFFSET(http_persistent), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
+    { "upload_connections", "Number of connections used to upload the files in the background, 0 to upload them from the muxer", OFFSET(upload_connections), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, 64, E },
+    { "upload_max_size", "Maximum size of the files waiting for their upload", OFFSET(upload_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20 }, 0, INT64_MAX, E },
+    { "upload_retries", "Number of times a failed background upload is retried", OFFSET(upload_retries), AV_OPT_TYPE_INT, {.i64 = 2 }, 0, INT_MAX, E },
     { "hls_playlist", "Generate HLS playlist files(master.m3u8, media_%d.m3u8)", OFFSET(hls_playlist), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     { "hls_master_name", "HLS master playlist name", OFFSET(hls_master_name), AV_OPT_TYPE_STRING, {.str = "master.m3u8"}, 0, 0, E },
     { "streaming", "Enable/Disable streaming mode of output. Each frame will be moof fragment", OFFSET(streaming), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
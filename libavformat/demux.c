@@ -31,8 +31,10 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
+#include "libavutil/trace.h"
 
 #include "libavcodec/avcodec.h"
 #include "libavcodec/bsf.h"
@@ -1110,18 +1112,151 @@ static void compute_pkt_fields(AVFormatContext *s, AVStream *st,
         pkt->flags |= AV_PKT_FLAG_KEY;
 }
 
+/* Maximum number of packets parsed in parallel, at most one per stream. */
+#define PARSE_BATCH_SIZE 16
+
+/**
+ * The codec context fields read by compute_pkt_fields(), which the parser
+ * may change from one output packet to the next.
+ */
+typedef struct ParseCodecState {
+    enum AVCodecID  codec_id;
+    int             sample_rate;
+    AVChannelLayout ch_layout;
+    int             frame_size;
+    int             block_align;
+    int64_t         bit_rate;
+    int             has_b_frames;
+    AVRational      framerate;
+    int             ticks_per_frame;
+} ParseCodecState;
+
+/**
+ * Whether a packet output by a parser is dropped because the stream discards
+ * non-key frames. Only video parsers that report the frame types tell key
+ * frames apart, with the other ones every packet would be dropped.
+ */
+static int parser_discard_nonkey(const AVStream *st, const AVPacket *pkt,
+                                 int key_frame, int pict_type)
+{
+    return st->discard >= AVDISCARD_NONKEY &&
+           st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+           (key_frame != -1 || pict_type != AV_PICTURE_TYPE_NONE) &&
+           !(pkt->flags & AV_PKT_FLAG_KEY);
+}
+
+typedef struct ParseOutput {
+    AVPacket *pkt;
+    /* 0-size sync packet, only passed to compute_pkt_fields() */
+    int       sync;
+    int64_t   next_pts, next_dts;
+    /* parser state read by compute_pkt_fields() */
+    int       pict_type;
+    int       key_frame;
+    int       repeat_pict;
+    int64_t   offset;
+    ParseCodecState codec;
+} ParseOutput;
+
+typedef struct ParseJob {
+    AVStream    *st;
+    AVPacket    *pkt;
+    AVPacket    *out_pkt;
+    ParseOutput *outputs;
+    unsigned     outputs_allocated;
+    int          nb_outputs;
+    int          ret;
+} ParseJob;
+
+/**
+ * Runs the parsers of several streams in parallel. Raw packets needing
+ * parsing are collected in a batch holding at most one packet per stream,
+ * so that every parser sees its codec context as it would when parsing in
+ * order. The batch is parsed when a packet cannot be added to it: the
+ * parsers run on worker threads, recording their output along with the
+ * state compute_pkt_fields() depends on, and the output is then finished
+ * and queued in the order the packets were read. A batch may be left
+ * pending between two calls to read_frame_internal(); it is dropped along
+ * with the other queued packets by ff_flush_packet_queue().
+ */
+typedef struct ParseThreadContext {
+    AVFormatContext *s;
+    AVSliceThread   *thread;
+    ParseJob         jobs[PARSE_BATCH_SIZE];
+    int              nb_jobs;
+} ParseThreadContext;
+
+static void parse_codec_state_swap(AVCodecContext *avctx, ParseCodecState *cs)
+{
+    FFSWAP(enum AVCodecID,  avctx->codec_id,        cs->codec_id);
+    FFSWAP(int,             avctx->sample_rate,     cs->sample_rate);
+    FFSWAP(AVChannelLayout, avctx->ch_layout,       cs->ch_layout);
+    FFSWAP(int,             avctx->frame_size,      cs->frame_size);
+    FFSWAP(int,             avctx->block_align,     cs->block_align);
+    FFSWAP(int64_t,         avctx->bit_rate,        cs->bit_rate);
+    FFSWAP(int,             avctx->has_b_frames,    cs->has_b_frames);
+    FFSWAP(AVRational,      avctx->framerate,       cs->framerate);
+    FFSWAP(int,             avctx->ticks_per_frame, cs->ticks_per_frame);
+}
+
+static int parse_job_add_output(ParseJob *job, const AVCodecContext *avctx,
+                                const AVCodecParserContext *pc, AVPacket *pkt,
+                                int sync, int64_t next_pts, int64_t next_dts)
+{
+    ParseOutput *out;
+    int ret;
+
+    out = av_fast_realloc(job->outputs, &job->outputs_allocated,
+                          (job->nb_outputs + 1) * sizeof(*job->outputs));
+    if (!out)
+        return AVERROR(ENOMEM);
+    job->outputs = out;
+    out += job->nb_outputs;
+
+    memset(out, 0, sizeof(*out));
+    out->pkt = av_packet_alloc();
+    if (!out->pkt)
+        return AVERROR(ENOMEM);
+    ret = av_channel_layout_copy(&out->codec.ch_layout, &avctx->ch_layout);
+    if (ret < 0) {
+        av_packet_free(&out->pkt);
+        return ret;
+    }
+    av_packet_move_ref(out->pkt, pkt);
+
+    out->sync                  = sync;
+    out->next_pts              = next_pts;
+    out->next_dts              = next_dts;
+    out->pict_type             = pc->pict_type;
+    out->key_frame             = pc->key_frame;
+    out->repeat_pict           = pc->repeat_pict;
+    out->offset                = pc->offset;
+    out->codec.codec_id        = avctx->codec_id;
+    out->codec.sample_rate     = avctx->sample_rate;
+    out->codec.frame_size      = avctx->frame_size;
+    out->codec.block_align     = avctx->block_align;
+    out->codec.bit_rate        = avctx->bit_rate;
+    out->codec.has_b_frames    = avctx->has_b_frames;
+    out->codec.framerate       = avctx->framerate;
+    out->codec.ticks_per_frame = avctx->ticks_per_frame;
+    job->nb_outputs++;
+
+    return 0;
+}
+
 /**
  * Parse a packet, add all split parts to parse_queue.
  *
  * @param pkt   Packet to parse; must not be NULL.
  * @param flush Indicates whether to flush. If set, pkt must be blank.
+ * @param job   If not NULL, record the split parts in job instead of
+ *              queuing them; only the state of st is accessed then.
  */
-static int parse_packet(AVFormatContext *s, AVPacket *pkt,
-                        int stream_index, int flush)
+static int parse_packet_internal(AVFormatContext *s, AVStream *st,
+                                 AVPacket *pkt, AVPacket *out_pkt,
+                                 int flush, ParseJob *job)
 {
     FFFormatContext *const si = ffformatcontext(s);
-    AVPacket *out_pkt = si->parse_pkt;
-    AVStream *st = s->streams[stream_index];
     FFStream *const sti = ffstream(st);
     const uint8_t *data = pkt->data;
     int size = pkt->size;
@@ -1129,7 +1264,17 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt,
 
     if (!size && !flush && sti->parser->flags & PARSER_FLAG_COMPLETE_FRAMES) {
         // preserve 0-size sync packets
-        compute_pkt_fields(s, st, sti->parser, pkt, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
+        if (job) {
+            AVPacket *const sync_pkt = out_pkt;
+            ret = av_packet_ref(sync_pkt, pkt);
+            if (ret < 0)
+                goto fail;
+            ret = parse_job_add_output(job, sti->avctx, sti->parser, sync_pkt,
+                                       1, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
+            if (ret < 0)
+                goto fail;
+        } else
+            compute_pkt_fields(s, st, sti->parser, pkt, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
     }
 
     while (size > 0 || (flush && got_output)) {
@@ -1205,8 +1350,23 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt,
         if (sti->parser->key_frame == -1 && sti->parser->pict_type ==AV_PICTURE_TYPE_NONE && (pkt->flags&AV_PKT_FLAG_KEY))
             out_pkt->flags |= AV_PKT_FLAG_KEY;
 
+        if (job) {
+            ret = parse_job_add_output(job, sti->avctx, sti->parser, out_pkt,
+                                       0, next_pts, next_dts);
+            if (ret < 0)
+                goto fail;
+            continue;
+        }
+
         compute_pkt_fields(s, st, sti->parser, out_pkt, next_dts, next_pts);
 
+        /* the parser knows the frame types, honor nokey for any demuxer */
+        if (parser_discard_nonkey(st, out_pkt, sti->parser->key_frame,
+                                  sti->parser->pict_type)) {
+            av_packet_unref(out_pkt);
+            continue;
+        }
+
         ret = avpriv_packet_list_put(&si->parse_queue,
                                      out_pkt, NULL, 0);
         if (ret < 0)
@@ -1226,6 +1386,209 @@ fail:
     return ret;
 }
 
+static int parse_packet(AVFormatContext *s, AVPacket *pkt,
+                        int stream_index, int flush)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    return parse_packet_internal(s, s->streams[stream_index], pkt,
+                                 si->parse_pkt, flush, NULL);
+}
+
+static int update_stream_params(AVStream *st)
+{
+    FFStream *const sti = ffstream(st);
+    int ret;
+
+    st->codecpar->sample_rate = sti->avctx->sample_rate;
+    st->codecpar->bit_rate = sti->avctx->bit_rate;
+#if FF_API_OLD_CHANNEL_LAYOUT
+FF_DISABLE_DEPRECATION_WARNINGS
+    st->codecpar->channels = sti->avctx->ch_layout.nb_channels;
+    st->codecpar->channel_layout = sti->avctx->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ?
+                                   sti->avctx->ch_layout.u.mask : 0;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    ret = av_channel_layout_copy(&st->codecpar->ch_layout, &sti->avctx->ch_layout);
+    if (ret < 0)
+        return ret;
+    st->codecpar->codec_id = sti->avctx->codec_id;
+
+    return 0;
+}
+
+static void parse_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ParseThreadContext *const pt = priv;
+    ParseJob *const job = &pt->jobs[jobnr];
+
+    job->ret = parse_packet_internal(pt->s, job->st, job->pkt, job->out_pkt, 0, job);
+}
+
+/**
+ * Finish the output of a parser run on a worker thread, as parse_packet()
+ * does right after av_parser_parse2() returns it.
+ */
+static int parse_output_finish(AVFormatContext *s, AVStream *st, ParseOutput *out)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    AVCodecContext *const avctx = ffstream(st)->avctx;
+    AVCodecParserContext pc = { 0 };
+    int has_b_frames, ret = 0;
+
+    pc.pict_type   = out->pict_type;
+    pc.repeat_pict = out->repeat_pict;
+    pc.offset      = out->offset;
+
+    parse_codec_state_swap(avctx, &out->codec);
+    has_b_frames = avctx->has_b_frames;
+    compute_pkt_fields(s, st, &pc, out->pkt, out->next_dts, out->next_pts);
+    /* keep what compute_pkt_fields() guessed */
+    if (avctx->has_b_frames != has_b_frames)
+        out->codec.has_b_frames = avctx->has_b_frames;
+    parse_codec_state_swap(avctx, &out->codec);
+
+    /* the parser knows the frame types, honor nokey for any demuxer */
+    if (!out->sync &&
+        !parser_discard_nonkey(st, out->pkt, out->key_frame, out->pict_type))
+        ret = avpriv_packet_list_put(&si->parse_queue, out->pkt, NULL, 0);
+    av_packet_unref(out->pkt);
+
+    return ret;
+}
+
+/**
+ * Run the parsers on the packets of the current batch and queue their
+ * output in order.
+ */
+static int parse_batch_finish(AVFormatContext *s)
+{
+    ParseThreadContext *const pt = ffformatcontext(s)->parse_thread;
+    int ret = 0;
+
+    if (!pt || !pt->nb_jobs)
+        return 0;
+
+    avpriv_slicethread_execute(pt->thread, pt->nb_jobs, 0);
+
+    for (int i = 0; i < pt->nb_jobs; i++) {
+        ParseJob *const job = &pt->jobs[i];
+
+        for (int j = 0; j < job->nb_outputs; j++) {
+            ParseOutput *const out = &job->outputs[j];
+            if (ret >= 0)
+                ret = parse_output_finish(s, job->st, out);
+            av_packet_free(&out->pkt);
+            av_channel_layout_uninit(&out->codec.ch_layout);
+        }
+        job->nb_outputs = 0;
+
+        if (ret >= 0)
+            ret = job->ret;
+        if (ret >= 0)
+            ret = update_stream_params(job->st);
+    }
+    pt->nb_jobs = 0;
+
+    return ret;
+}
+
+static int parse_batch_add(AVFormatContext *s, AVPacket *pkt)
+{
+    ParseThreadContext *const pt = ffformatcontext(s)->parse_thread;
+    ParseJob *const job = &pt->jobs[pt->nb_jobs++];
+
+    job->st = s->streams[pkt->stream_index];
+    av_packet_move_ref(job->pkt, pkt);
+
+    if (pt->nb_jobs == PARSE_BATCH_SIZE)
+        return parse_batch_finish(s);
+    return 0;
+}
+
+/**
+ * @return 1 if the packet can be parsed in the current batch, 0 if the
+ *         batch must be finished before pkt is handled
+ */
+static int parse_batch_accepts(AVFormatContext *s, const AVPacket *pkt)
+{
+    const ParseThreadContext *const pt = ffformatcontext(s)->parse_thread;
+    const AVStream *const st  = s->streams[pkt->stream_index];
+    const FFStream *const sti = cffstream(st);
+
+    if (!sti->need_parsing || !sti->parser || sti->need_context_update ||
+        st->discard >= AVDISCARD_ALL)
+        return 0;
+    for (int i = 0; i < pt->nb_jobs; i++)
+        if (pt->jobs[i].st == st)
+            return 0;
+    return 1;
+}
+
+void ff_parse_thread_flush(AVFormatContext *s)
+{
+    ParseThreadContext *const pt = ffformatcontext(s)->parse_thread;
+
+    if (!pt)
+        return;
+
+    for (int i = 0; i < pt->nb_jobs; i++)
+        av_packet_unref(pt->jobs[i].pkt);
+    pt->nb_jobs = 0;
+}
+
+void ff_parse_thread_free(AVFormatContext *s)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    ParseThreadContext *const pt = si->parse_thread;
+
+    if (!pt)
+        return;
+
+    avpriv_slicethread_free(&pt->thread);
+    for (int i = 0; i < PARSE_BATCH_SIZE; i++) {
+        av_freep(&pt->jobs[i].outputs);
+        av_packet_free(&pt->jobs[i].pkt);
+        av_packet_free(&pt->jobs[i].out_pkt);
+    }
+    av_freep(&si->parse_thread);
+}
+
+static int parse_thread_alloc(AVFormatContext *s)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    ParseThreadContext *pt;
+    int ret;
+
+    si->parse_thread_inited = 1;
+    if (s->parse_threads == 1)
+        return 0;
+
+    pt = si->parse_thread = av_mallocz(sizeof(*pt));
+    if (!pt)
+        return AVERROR(ENOMEM);
+    pt->s = s;
+
+    for (int i = 0; i < PARSE_BATCH_SIZE; i++) {
+        pt->jobs[i].pkt     = av_packet_alloc();
+        pt->jobs[i].out_pkt = av_packet_alloc();
+        if (!pt->jobs[i].pkt || !pt->jobs[i].out_pkt) {
+            ff_parse_thread_free(s);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    ret = avpriv_slicethread_create(&pt->thread, pt, parse_worker, NULL,
+                                    s->parse_threads);
+    if (ret <= 1) {
+        /* no threading support or a single CPU */
+        ff_parse_thread_free(s);
+        return ret == AVERROR(ENOMEM) ? ret : 0;
+    }
+    av_log(s, AV_LOG_DEBUG, "Parsing packets with %d threads\n", ret);
+
+    return 0;
+}
+
 static int64_t ts_to_samples(AVStream *st, int64_t ts)
 {
     return av_rescale(ts, st->time_base.num * st->codecpar->sample_rate, st->time_base.den);
@@ -1237,6 +1600,9 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
     int ret, got_packet = 0;
     AVDictionary *metadata = NULL;
 
+    if (!si->parse_thread_inited && (ret = parse_thread_alloc(s)) < 0)
+        return ret;
+
     while (!got_packet && !si->parse_queue.head) {
         AVStream *st;
         FFStream *sti;
@@ -1244,8 +1610,14 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         /* read next packet */
         ret = ff_read_packet(s, pkt);
         if (ret < 0) {
-            if (ret == AVERROR(EAGAIN))
+            int err = parse_batch_finish(s);
+            if (err < 0)
+                return err;
+            if (ret == AVERROR(EAGAIN)) {
+                if (si->parse_queue.head)
+                    break;
                 return ret;
+            }
             /* flush the parsers */
             for (unsigned i = 0; i < s->nb_streams; i++) {
                 AVStream *const st  = s->streams[i];
@@ -1261,6 +1633,12 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         st  = s->streams[pkt->stream_index];
         sti = ffstream(st);
 
+        if (si->parse_thread && !parse_batch_accepts(s, pkt) &&
+            (ret = parse_batch_finish(s)) < 0) {
+            av_packet_unref(pkt);
+            return ret;
+        }
+
         st->event_flags |= AVSTREAM_EVENT_FLAG_NEW_PACKETS;
 
         /* update context if required */
@@ -1331,21 +1709,15 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
             }
             got_packet = 1;
         } else if (st->discard < AVDISCARD_ALL) {
-            if ((ret = parse_packet(s, pkt, pkt->stream_index, 0)) < 0)
-                return ret;
-            st->codecpar->sample_rate = sti->avctx->sample_rate;
-            st->codecpar->bit_rate = sti->avctx->bit_rate;
-#if FF_API_OLD_CHANNEL_LAYOUT
-FF_DISABLE_DEPRECATION_WARNINGS
-            st->codecpar->channels = sti->avctx->ch_layout.nb_channels;
-            st->codecpar->channel_layout = sti->avctx->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ?
-                                           sti->avctx->ch_layout.u.mask : 0;
-FF_ENABLE_DEPRECATION_WARNINGS
-#endif
-            ret = av_channel_layout_copy(&st->codecpar->ch_layout, &sti->avctx->ch_layout);
-            if (ret < 0)
-                return ret;
-            st->codecpar->codec_id = sti->avctx->codec_id;
+            if (si->parse_thread) {
+                if ((ret = parse_batch_add(s, pkt)) < 0)
+                    return ret;
+            } else {
+                if ((ret = parse_packet(s, pkt, pkt->stream_index, 0)) < 0)
+                    return ret;
+                if ((ret = update_stream_params(st)) < 0)
+                    return ret;
+            }
         } else {
             /* free packet */
             av_packet_unref(pkt);
@@ -1356,6 +1728,14 @@ FF_ENABLE_DEPRECATION_WARNINGS
             av_packet_unref(pkt);
             got_packet = 0;
         }
+        if (got_packet && si->parse_queue.head) {
+            /* return the packets parsed before this one first */
+            if ((ret = avpriv_packet_list_put(&si->parse_queue, pkt, NULL, 0)) < 0) {
+                av_packet_unref(pkt);
+                return ret;
+            }
+            got_packet = 0;
+        }
     }
 
     if (!got_packet && si->parse_queue.head)
@@ -1436,7 +1816,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return ret;
 }
 
-int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+static int read_frame(AVFormatContext *s, AVPacket *pkt)
 {
     FFFormatContext *const si = ffformatcontext(s);
     const int genpts = s->flags & AVFMT_FLAG_GENPTS;
@@ -1531,6 +1911,18 @@ return_packet:
     return ret;
 }
 
+int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+{
+    AVTraceSpan span;
+    int ret;
+
+    av_trace_begin(&span, "demux", s->iformat->name);
+    ret = read_frame(s, pkt);
+    av_trace_end(&span);
+
+    return ret;
+}
+
 /**
  * Return TRUE if the stream has accurate duration in any stream.
  *
@@ -2413,6 +2805,151 @@ static int add_coded_side_data(AVStream *st, AVCodecContext *avctx)
     return 0;
 }
 
+/* Number of packets read between two rounds of parallel probe decoding. */
+#define PROBE_BATCH_SIZE 64
+
+typedef struct ProbeJob {
+    AVPacket *pkt;
+    /* value of codec_info_nb_frames when the packet was read */
+    int codec_info_nb_frames;
+} ProbeJob;
+
+/**
+ * Decodes the packets read by avformat_find_stream_info() on several
+ * threads. The packets are collected in batches while nothing is decoded,
+ * then the decoders of the streams present in the batch run in parallel,
+ * each on the packets of its own stream in order. The stream state is
+ * therefore never accessed concurrently by the demuxing and decoding code.
+ */
+typedef struct ProbeContext {
+    AVFormatContext *ic;
+    AVDictionary   **options;
+    int              orig_nb_streams;
+    AVSliceThread   *thread;
+    ProbeJob         jobs[PROBE_BATCH_SIZE];
+    int              nb_jobs;
+    unsigned         streams[PROBE_BATCH_SIZE];
+} ProbeContext;
+
+static void probe_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ProbeContext *const pc = priv;
+    const unsigned stream_index = pc->streams[jobnr];
+    AVStream *const st  = pc->ic->streams[stream_index];
+    FFStream *const sti = ffstream(st);
+    const int codec_info_nb_frames = sti->codec_info_nb_frames;
+    AVDictionary **options = pc->options && stream_index < pc->orig_nb_streams ?
+                             &pc->options[stream_index] : NULL;
+
+    for (int i = 0; i < pc->nb_jobs; i++) {
+        const ProbeJob *const job = &pc->jobs[i];
+        if (job->pkt->stream_index != stream_index)
+            continue;
+        /* let the decoding loop see what it would have seen when the
+         * packet was read */
+        sti->codec_info_nb_frames = job->codec_info_nb_frames;
+        try_decode_frame(pc->ic, st, job->pkt, options);
+    }
+    sti->codec_info_nb_frames = codec_info_nb_frames;
+}
+
+static void probe_decode_batch(ProbeContext *pc)
+{
+    int nb_streams = 0;
+
+    if (!pc->nb_jobs)
+        return;
+
+    for (int i = 0; i < pc->nb_jobs; i++) {
+        const unsigned stream_index = pc->jobs[i].pkt->stream_index;
+        int j;
+        for (j = 0; j < nb_streams; j++)
+            if (pc->streams[j] == stream_index)
+                break;
+        if (j == nb_streams)
+            pc->streams[nb_streams++] = stream_index;
+    }
+
+    avpriv_slicethread_execute(pc->thread, nb_streams, 0);
+
+    for (int i = 0; i < pc->nb_jobs; i++)
+        av_packet_unref(pc->jobs[i].pkt);
+    pc->nb_jobs = 0;
+}
+
+static int probe_queue_packet(ProbeContext *pc, const AVPacket *pkt)
+{
+    ProbeJob *job;
+    int ret;
+
+    if (pc->nb_jobs == PROBE_BATCH_SIZE)
+        probe_decode_batch(pc);
+
+    job = &pc->jobs[pc->nb_jobs];
+    ret = av_packet_ref(job->pkt, pkt);
+    if (ret < 0)
+        return ret;
+    job->codec_info_nb_frames = ffstream(pc->ic->streams[pkt->stream_index])->codec_info_nb_frames;
+    pc->nb_jobs++;
+
+    return 0;
+}
+
+static void probe_context_free(ProbeContext **ppc)
+{
+    ProbeContext *const pc = *ppc;
+
+    if (!pc)
+        return;
+
+    avpriv_slicethread_free(&pc->thread);
+    for (int i = 0; i < PROBE_BATCH_SIZE; i++)
+        av_packet_free(&pc->jobs[i].pkt);
+    av_freep(ppc);
+}
+
+/**
+ * @return 0 if the probed packets are to be decoded by the caller,
+ *         1 if pc was set up, a negative error code on failure
+ */
+static int probe_context_alloc(ProbeContext **ppc, AVFormatContext *ic,
+                               AVDictionary **options)
+{
+    ProbeContext *pc;
+    int ret;
+
+    *ppc = NULL;
+    if (ic->probe_threads == 1)
+        return 0;
+
+    pc = av_mallocz(sizeof(*pc));
+    if (!pc)
+        return AVERROR(ENOMEM);
+    pc->ic              = ic;
+    pc->options         = options;
+    pc->orig_nb_streams = ic->nb_streams;
+
+    for (int i = 0; i < PROBE_BATCH_SIZE; i++) {
+        pc->jobs[i].pkt = av_packet_alloc();
+        if (!pc->jobs[i].pkt) {
+            probe_context_free(&pc);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    ret = avpriv_slicethread_create(&pc->thread, pc, probe_worker, NULL,
+                                    ic->probe_threads);
+    if (ret <= 1) {
+        /* no threading support or a single CPU */
+        probe_context_free(&pc);
+        return ret == AVERROR(ENOMEM) ? ret : 0;
+    }
+    av_log(ic, AV_LOG_DEBUG, "Decoding probed packets with %d threads\n", ret);
+
+    *ppc = pc;
+    return 1;
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     FFFormatContext *const si = ffformatcontext(ic);
@@ -2429,6 +2966,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+    int64_t start_time = av_gettime_relative();
+    ProbeContext *pc = NULL;
+    FFStreamInfoCacheKey *cache_key = NULL;
+    int cached, complete = 1;
 
     flush_codecs = probesize > 0;
 
@@ -2452,6 +2993,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                avio_tell(ic->pb), ctx->bytes_read, ctx->seek_count, ic->nb_streams);
     }
 
+    /* with cached parameters, the packets of the streams created so far are
+     * only read for their timestamps */
+    cached = ff_stream_info_cache_load(ic, &cache_key);
+    if (cached < 0) {
+        ret = cached;
+        goto find_stream_info_err;
+    }
+
     for (unsigned i = 0; i < ic->nb_streams; i++) {
         const AVCodec *codec;
         AVDictionary *thread_opt = NULL;
@@ -2505,7 +3054,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
         // Try to just open decoders, in case this is enough to get parameters.
         // Also ensure that subtitle_header is properly set.
-        if (!has_codec_parameters(st, NULL) && sti->request_probe <= 0 ||
+        if (!has_codec_parameters(st, NULL) && sti->request_probe <= 0 && !cached ||
             st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
             if (codec && !avctx->codec)
                 if (avcodec_open2(avctx, codec, options ? &options[i] : &thread_opt) < 0)
@@ -2516,6 +3065,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             av_dict_free(&thread_opt);
     }
 
+    ret = probe_context_alloc(&pc, ic, options);
+    if (ret < 0)
+        goto find_stream_info_err;
+
     read_size = 0;
     for (;;) {
         const AVPacket *pkt;
@@ -2579,8 +3132,9 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             if (i == ic->nb_streams) {
                 analyzed_all_streams = 1;
                 /* NOTE: If the format has no header, then we need to read some
-                 * packets to get most of the streams, so we cannot stop here. */
-                if (!(ic->ctx_flags & AVFMTCTX_NOHEADER)) {
+                 * packets to get most of the streams, so we cannot stop here,
+                 * unless the streams are known from the cache. */
+                if (!(ic->ctx_flags & AVFMTCTX_NOHEADER) || cached) {
                     /* If we found the info for all the codecs, we can stop. */
                     ret = count;
                     av_log(ic, AV_LOG_DEBUG, "All info found\n");
@@ -2606,6 +3160,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             }
             break;
         }
+        if (ic->max_probe_time > 0 &&
+            av_gettime_relative() - start_time >= ic->max_probe_time) {
+            ret = count;
+            av_log(ic, AV_LOG_DEBUG,
+                   "Probe time limit of %"PRId64" microseconds reached\n",
+                   ic->max_probe_time);
+            break;
+        }
 
         /* NOTE: A new stream can be added there if no header in file
          * (AVFMTCTX_NOHEADER). */
@@ -2744,8 +3306,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+        if (pc && (!cached || pkt->stream_index >= orig_nb_streams)) {
+            ret = probe_queue_packet(pc, pkt);
+            if (ret < 0)
+                goto unref_then_goto_end;
+        } else if (!cached || pkt->stream_index >= orig_nb_streams) {
+            try_decode_frame(ic, st, pkt,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
+        }
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(pkt1);
@@ -2754,6 +3322,9 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         count++;
     }
 
+    if (pc)
+        probe_decode_batch(pc);
+
     if (eof_reached) {
         for (unsigned stream_index = 0; stream_index < ic->nb_streams; stream_index++) {
             AVStream *const st = ic->streams[stream_index];
@@ -2927,6 +3498,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                    "Could not find codec parameters for stream %d (%s): %s\n"
                    "Consider increasing the value for the 'analyzeduration' (%"PRId64") and 'probesize' (%"PRId64") options\n",
                    i, buf, errmsg, ic->max_analyze_duration, ic->probesize);
+            if (i < orig_nb_streams)
+                complete = 0;
         } else {
             ret = 0;
         }
@@ -2953,7 +3526,12 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         sti->avctx_inited = 0;
     }
 
+    if (complete)
+        ff_stream_info_cache_store(ic, &cache_key);
+
 find_stream_info_err:
+    probe_context_free(&pc);
+    ff_stream_info_cache_key_free(&cache_key);
     for (unsigned i = 0; i < ic->nb_streams; i++) {
         AVStream *const st  = ic->streams[i];
         FFStream *const sti = ffstream(st);
@@ -88,6 +88,17 @@ int ff_read_packet(AVFormatContext *s, AVPacket *pkt);
 
 void ff_read_frame_flush(AVFormatContext *s);
 
+/**
+ * Drop the packets waiting to be parsed in parallel, see
+ * AVFormatContext.parse_threads.
+ */
+void ff_parse_thread_flush(AVFormatContext *s);
+
+/**
+ * Free the context parsing packets in parallel.
+ */
+void ff_parse_thread_free(AVFormatContext *s);
+
 /**
  * Perform a binary search using av_index_search_timestamp() and
  * AVInputFormat.read_timestamp().
@@ -238,4 +249,27 @@ int ff_get_extradata(void *logctx, AVCodecParameters *par, AVIOContext *pb, int
  */
 int ff_find_stream_index(const AVFormatContext *s, int id);
 
+typedef struct FFStreamInfoCacheKey FFStreamInfoCacheKey;
+
+/**
+ * Set the parameters of the streams of s from the stream info cache entry
+ * of its URL, if AVFormatContext.stream_info_cache is set and the entry
+ * matches the streams.
+ *
+ * @param key set to the key identifying the current streams if the cache is
+ *            used but has no matching entry, to be passed to
+ *            ff_stream_info_cache_store() after probing, NULL otherwise
+ * @return 1 if the parameters were set, 0 if not, a negative error code on
+ *         failure
+ */
+int ff_stream_info_cache_load(AVFormatContext *s, FFStreamInfoCacheKey **key);
+
+/**
+ * Store the parameters of the streams identified by key in the stream info
+ * cache and free key. Failures are only logged.
+ */
+void ff_stream_info_cache_store(AVFormatContext *s, FFStreamInfoCacheKey **key);
+
+void ff_stream_info_cache_key_free(FFStreamInfoCacheKey **key);
+
 #endif /* AVFORMAT_DEMUX_H */
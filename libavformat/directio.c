@@ -0,0 +1,290 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "directio.h"
+
+struct FFDirectWriter {
+    int fd;
+    int direct_fd;
+
+    uint8_t *alloc;
+    uint8_t *buf[2];
+    int      buffer_size;
+    /* buffer being filled, bytes in it and bytes it takes before being
+     * written, less than buffer_size up to the next aligned offset */
+    int      cur;
+    int      fill;
+    int      limit;
+    /* file offset of the first byte of the buffer being filled */
+    int64_t  offset;
+
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    /* write handed to the thread, protected by mutex */
+    const uint8_t *job_data;
+    int            job_size;
+    int64_t        job_offset;
+    int            job_direct;
+    int            busy;
+    int            quit;
+    /* first error of a completed write */
+    int            error;
+};
+
+static int write_all(int fd, const uint8_t *data, int size, int64_t offset)
+{
+    while (size > 0) {
+        ssize_t ret = pwrite(fd, data, size, offset);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        if (!ret)
+            return AVERROR(EIO);
+        data   += ret;
+        size   -= ret;
+        offset += ret;
+    }
+    return 0;
+}
+
+static void *writer_thread(void *arg)
+{
+    FFDirectWriter *w = arg;
+
+    pthread_mutex_lock(&w->mutex);
+    while (1) {
+        int ret;
+
+        while (!w->busy && !w->quit)
+            pthread_cond_wait(&w->cond, &w->mutex);
+        if (!w->busy)
+            break;
+        pthread_mutex_unlock(&w->mutex);
+
+        ret = write_all(w->job_direct ? w->direct_fd : w->fd,
+                        w->job_data, w->job_size, w->job_offset);
+
+        pthread_mutex_lock(&w->mutex);
+        if (ret < 0 && !w->error)
+            w->error = ret;
+        w->busy = 0;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->mutex);
+
+    return NULL;
+}
+
+static int wait_idle(FFDirectWriter *w)
+{
+    int ret;
+
+    pthread_mutex_lock(&w->mutex);
+    while (w->busy)
+        pthread_cond_wait(&w->cond, &w->mutex);
+    ret = w->error;
+    pthread_mutex_unlock(&w->mutex);
+
+    return ret;
+}
+
+static int submit(FFDirectWriter *w, const uint8_t *data, int size, int direct)
+{
+    int ret;
+
+    pthread_mutex_lock(&w->mutex);
+    while (w->busy)
+        pthread_cond_wait(&w->cond, &w->mutex);
+    ret = w->error;
+    if (!ret) {
+        w->job_data   = data;
+        w->job_size   = size;
+        w->job_offset = w->offset;
+        w->job_direct = direct;
+        w->busy       = 1;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->mutex);
+
+    return ret;
+}
+
+static void start_buffer(FFDirectWriter *w)
+{
+    int misalign = w->offset % FF_DIRECTIO_ALIGN;
+
+    w->fill  = 0;
+    w->limit = misalign ? FF_DIRECTIO_ALIGN - misalign : w->buffer_size;
+}
+
+int ff_direct_writer_alloc(FFDirectWriter **pw, int fd, int direct_fd,
+                           int buffer_size, int64_t offset)
+{
+    FFDirectWriter *w;
+    int ret;
+
+    if (buffer_size <= 0 || buffer_size > INT_MAX / 2 - FF_DIRECTIO_ALIGN)
+        return AVERROR(EINVAL);
+    buffer_size = FFALIGN(buffer_size, FF_DIRECTIO_ALIGN);
+
+    w = av_mallocz(sizeof(*w));
+    if (!w)
+        return AVERROR(ENOMEM);
+
+    w->alloc = av_malloc(2 * buffer_size + FF_DIRECTIO_ALIGN);
+    if (!w->alloc) {
+        av_free(w);
+        return AVERROR(ENOMEM);
+    }
+    w->buf[0]      = (uint8_t *)FFALIGN((uintptr_t)w->alloc, FF_DIRECTIO_ALIGN);
+    w->buf[1]      = w->buf[0] + buffer_size;
+    w->buffer_size = buffer_size;
+    w->fd          = fd;
+    w->direct_fd   = direct_fd;
+    w->offset      = offset;
+    start_buffer(w);
+
+    if ((ret = pthread_mutex_init(&w->mutex, NULL))) {
+        av_free(w->alloc);
+        av_free(w);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&w->cond, NULL))) {
+        pthread_mutex_destroy(&w->mutex);
+        av_free(w->alloc);
+        av_free(w);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&w->thread, NULL, writer_thread, w))) {
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->mutex);
+        av_free(w->alloc);
+        av_free(w);
+        return AVERROR(ret);
+    }
+
+    *pw = w;
+    return 0;
+}
+
+int ff_direct_writer_free(FFDirectWriter **pw)
+{
+    FFDirectWriter *w = *pw;
+    int ret;
+
+    if (!w)
+        return 0;
+
+    ret = ff_direct_writer_flush(w);
+
+    pthread_mutex_lock(&w->mutex);
+    w->quit = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+    pthread_join(w->thread, NULL);
+
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->mutex);
+    av_free(w->alloc);
+    av_freep(pw);
+
+    return ret;
+}
+
+int ff_direct_writer_write(FFDirectWriter *w, const uint8_t *buf, int size)
+{
+    int written = 0;
+
+    while (written < size) {
+        int len = FFMIN(size - written, w->limit - w->fill);
+
+        memcpy(w->buf[w->cur] + w->fill, buf + written, len);
+        w->fill += len;
+        written += len;
+
+        if (w->fill == w->limit) {
+            /* a full buffer is aligned unless it only holds the head of the
+             * run up to the first aligned offset */
+            int ret = submit(w, w->buf[w->cur], w->fill,
+                             !(w->offset % FF_DIRECTIO_ALIGN));
+            if (ret < 0)
+                return ret;
+            w->offset += w->fill;
+            w->cur    ^= 1;
+            start_buffer(w);
+        }
+    }
+
+    return size;
+}
+
+int ff_direct_writer_flush(FFDirectWriter *w)
+{
+    if (w->fill) {
+        const uint8_t *data = w->buf[w->cur];
+        int aligned = w->offset % FF_DIRECTIO_ALIGN ? 0 :
+                      w->fill & ~(FF_DIRECTIO_ALIGN - 1);
+        int ret;
+
+        if (aligned) {
+            ret = submit(w, data, aligned, 1);
+            if (ret < 0)
+                return ret;
+            w->offset += aligned;
+        }
+        /* the tail cannot be written directly without padding it */
+        if (w->fill > aligned) {
+            ret = submit(w, data + aligned, w->fill - aligned, 0);
+            if (ret < 0)
+                return ret;
+            w->offset += w->fill - aligned;
+        }
+        start_buffer(w);
+    }
+
+    return wait_idle(w);
+}
+
+int64_t ff_direct_writer_seek(FFDirectWriter *w, int64_t offset)
+{
+    int ret = ff_direct_writer_flush(w);
+    if (ret < 0)
+        return ret;
+
+    w->offset = offset;
+    start_buffer(w);
+
+    return offset;
+}
+
+int64_t ff_direct_writer_tell(FFDirectWriter *w)
+{
+    return w->offset + w->fill;
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * aligned, double-buffered write-behind for files opened for direct I/O
+ */
+
+#ifndef AVFORMAT_DIRECTIO_H
+#define AVFORMAT_DIRECTIO_H
+
+#include <stdint.h>
+
+/**
+ * Alignment of the buffers, file offsets and sizes of the direct writes.
+ * Large enough for the logical block size of common devices.
+ */
+#define FF_DIRECTIO_ALIGN 4096
+
+typedef struct FFDirectWriter FFDirectWriter;
+
+/**
+ * Set up a writer for a file.
+ *
+ * The written data is copied into one of two buffers of buffer_size bytes,
+ * which is handed over to a separate thread once full, while the other one
+ * is filled. The blocks of FF_DIRECTIO_ALIGN bytes at aligned offsets are
+ * written with direct_fd, the unaligned head and tail of each run of
+ * contiguous writes with fd, so that direct_fd may be opened with O_DIRECT.
+ *
+ * @param fd          file descriptor for the unaligned writes
+ * @param direct_fd   file descriptor for the aligned writes, may be fd
+ * @param buffer_size size of each buffer, rounded up to FF_DIRECTIO_ALIGN
+ * @param offset      file offset of the first write
+ * @return 0 on success or a negative error code
+ */
+int ff_direct_writer_alloc(FFDirectWriter **pw, int fd, int direct_fd,
+                           int buffer_size, int64_t offset);
+
+/**
+ * Write the pending data, stop the thread and free the writer.
+ * The file descriptors are not closed.
+ *
+ * @return 0 on success or the first write error not reported yet
+ */
+int ff_direct_writer_free(FFDirectWriter **pw);
+
+/**
+ * Queue size bytes for writing. Errors of previous writes are reported by
+ * the following calls.
+ *
+ * @return size on success or a negative error code
+ */
+int ff_direct_writer_write(FFDirectWriter *w, const uint8_t *buf, int size);
+
+/**
+ * Wait until all the queued data has been written, including the end of a
+ * partially filled buffer.
+ *
+ * @return 0 on success or the first error of the pending writes
+ */
+int ff_direct_writer_flush(FFDirectWriter *w);
+
+/**
+ * Write the queued data and move the file position of the following writes.
+ *
+ * @return offset on success or a negative error code
+ */
+int64_t ff_direct_writer_seek(FFDirectWriter *w, int64_t offset);
+
+/**
+ * @return the file position of the next byte to be written
+ */
+int64_t ff_direct_writer_tell(FFDirectWriter *w);
+
+#endif /* AVFORMAT_DIRECTIO_H */
@@ -19,12 +19,23 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#if HAVE_O_DIRECT
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+#endif
+
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
+#include "libavutil/error.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavcodec/defs.h"
 #include "avio.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -36,10 +47,25 @@
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <sys/stat.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
+#if HAVE_LINUX_IO_URING_H
+#include "uring.h"
+
+#define URING_NB_BUFFERS   4
+#define URING_BUFFER_SIZE  262144
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+#include "directio.h"
+
+#define DIRECT_BUFFER_SIZE (4 << 20)
+#endif
 
 /* Some systems may not have S_ISFIFO */
 #ifndef S_ISFIFO
@@ -77,6 +103,17 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int use_mmap;
+    int64_t map_size;           ///< size of the file if packets can be mapped, 0 otherwise
+#if HAVE_LINUX_IO_URING_H
+    int use_io_uring;
+    FFURing *uring;
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    int use_direct;
+    int direct_fd;
+    FFDirectWriter *direct;
+#endif
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -87,6 +124,13 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "map large packets of regular files into memory instead of copying them", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+#if HAVE_LINUX_IO_URING_H
+    { "io_uring", "use io_uring for readahead and write-behind", offsetof(FileContext, use_io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    { "direct", "bypass the page cache when writing, from a separate thread", offsetof(FileContext, use_direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
+#endif
     { NULL }
 };
 
@@ -114,6 +158,10 @@ static int file_read(URLContext *h, unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_LINUX_IO_URING_H
+    if (c->uring)
+        return ff_uring_read(c->uring, buf, size, 0);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -127,6 +175,14 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_LINUX_IO_URING_H
+    if (c->uring)
+        return ff_uring_write(c->uring, buf, size, 0);
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    if (c->direct)
+        return ff_direct_writer_write(c->direct, buf, size);
+#endif
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -191,6 +247,69 @@ static int file_delete(URLContext *h)
 #endif /* HAVE_UNISTD_H */
 }
 
+#if HAVE_MMAP
+/* smaller packets are cheaper to copy than to map */
+#define MIN_MAPPED_SIZE (64 * 1024)
+
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    size_t offset = (uintptr_t)data % sysconf(_SC_PAGESIZE);
+
+    munmap(data - offset, (size_t)(uintptr_t)opaque);
+}
+
+static int file_map(URLContext *h, int64_t pos, int size, AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+    const int64_t page = sysconf(_SC_PAGESIZE);
+    const int64_t start = pos - pos % page;
+    const int64_t end   = pos + size + AV_INPUT_BUFFER_PADDING_SIZE;
+    uint8_t *ptr;
+    size_t len;
+
+    /* a mapping would read zeros past the end of the file instead of
+     * returning a short read, and pages entirely past the end of the file
+     * cannot be accessed, so the last packets are read instead */
+    if (!c->map_size || size < MIN_MAPPED_SIZE || pos + size > c->map_size ||
+        end > FFALIGN(c->map_size, page) || end - start > SIZE_MAX)
+        return AVERROR(ENOSYS);
+    len = end - start;
+
+    /* private, so that clearing the padding or modifying the packet in place
+     * touches neither the file nor the data of other packets */
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, start);
+    if (ptr == MAP_FAILED) {
+        av_log(h, AV_LOG_VERBOSE, "mmap() failed: %s\n", av_err2str(AVERROR(errno)));
+        return AVERROR(ENOSYS);
+    }
+    ptr += pos - start;
+    memset(ptr + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    *buf = av_buffer_create(ptr, size + AV_INPUT_BUFFER_PADDING_SIZE,
+                            file_unmap, (void *)(uintptr_t)len, 0);
+    if (!*buf) {
+        munmap(ptr - (pos - start), len);
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+#endif
+
+static int file_flush(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+#if HAVE_LINUX_IO_URING_H
+    if (c->uring)
+        return ff_uring_flush(c->uring, 0);
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    if (c->direct)
+        return ff_direct_writer_flush(c->direct);
+#endif
+    return 0;
+}
+
 static int file_move(URLContext *h_src, URLContext *h_dst)
 {
     const char *filename_src = h_src->filename;
@@ -234,6 +353,49 @@ static int file_open(URLContext *h, const char *filename, int flags)
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !c->follow && !h->is_streamed &&
+        !fstat(fd, &st) && S_ISREG(st.st_mode))
+        c->map_size = st.st_size;
+#endif
+
+#if HAVE_LINUX_IO_URING_H
+    /* reads and writes both go ahead of the caller, so not both at once */
+    if (c->use_io_uring && !(flags & AVIO_FLAG_WRITE && flags & AVIO_FLAG_READ) &&
+        !c->follow && !h->is_streamed) {
+        int ret = ff_uring_alloc(&c->uring, fd,
+                                 flags & AVIO_FLAG_WRITE ? FF_URING_WRITE : FF_URING_READ,
+                                 URING_NB_BUFFERS, URING_BUFFER_SIZE, lseek(fd, 0, SEEK_CUR));
+        if (ret < 0)
+            av_log(h, AV_LOG_WARNING, "io_uring unavailable, using plain I/O: %s\n",
+                   av_err2str(ret));
+    }
+#endif
+
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    /* a second descriptor for the aligned writes, the unaligned ones still
+     * go through the page cache */
+    c->direct_fd = -1;
+    if (c->use_direct && flags & AVIO_FLAG_WRITE && !(flags & AVIO_FLAG_READ) &&
+        !h->is_streamed && !c->uring) {
+        int ret;
+
+        c->direct_fd = avpriv_open(filename, O_WRONLY | O_DIRECT);
+        if (c->direct_fd == -1)
+            ret = AVERROR(errno);
+        else
+            ret = ff_direct_writer_alloc(&c->direct, fd, c->direct_fd,
+                                         DIRECT_BUFFER_SIZE, lseek(fd, 0, SEEK_CUR));
+        if (ret < 0) {
+            av_log(h, AV_LOG_WARNING, "Direct I/O unavailable, using buffered writes: %s\n",
+                   av_err2str(ret));
+            if (c->direct_fd != -1)
+                close(c->direct_fd);
+            c->direct_fd = -1;
+        }
+    }
+#endif
+
     /* Buffer writes more than the default 32k to improve throughput especially
      * with networked file systems */
     if (!h->is_streamed && flags & AVIO_FLAG_WRITE)
@@ -251,6 +413,28 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+#if HAVE_LINUX_IO_URING_H
+    if (c->uring) {
+        /* the size and the end of the file depend on the pending writes */
+        if (whence != SEEK_SET && (ret = ff_uring_flush(c->uring, 0)) < 0)
+            return ret;
+        if (whence == SEEK_CUR) {
+            pos   += ff_uring_tell(c->uring);
+            whence = SEEK_SET;
+        }
+    }
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    if (c->direct) {
+        if (whence != SEEK_SET && (ret = ff_direct_writer_flush(c->direct)) < 0)
+            return ret;
+        if (whence == SEEK_CUR) {
+            pos   += ff_direct_writer_tell(c->direct);
+            whence = SEEK_SET;
+        }
+    }
+#endif
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -258,15 +442,41 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     }
 
     ret = lseek(c->fd, pos, whence);
+    if (ret < 0)
+        return AVERROR(errno);
+
+#if HAVE_LINUX_IO_URING_H
+    if (c->uring)
+        ret = ff_uring_seek(c->uring, ret);
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    if (c->direct)
+        ret = ff_direct_writer_seek(c->direct, ret);
+#endif
 
-    return ret < 0 ? AVERROR(errno) : ret;
+    return ret;
 }
 
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
-    return (ret == -1) ? AVERROR(errno) : 0;
+    int ret, err = 0;
+
+#if HAVE_LINUX_IO_URING_H
+    if (c->uring) {
+        err = ff_uring_flush(c->uring, 0);
+        ff_uring_free(&c->uring);
+    }
+#endif
+#if HAVE_PTHREADS && HAVE_O_DIRECT
+    if (c->direct_fd != -1) {
+        err = ff_direct_writer_free(&c->direct);
+        close(c->direct_fd);
+    }
+#endif
+
+    ret = close(c->fd);
+    return (ret == -1) ? AVERROR(errno) : err;
 }
 
 static int file_open_dir(URLContext *h)
@@ -361,6 +571,10 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+#if HAVE_MMAP
+    .url_map             = file_map,
+#endif
+    .url_flush           = file_flush,
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
@@ -133,6 +133,7 @@ const AVInputFormat *av_probe_input_format3(const AVProbeData *pd,
     AVProbeData lpd = *pd;
     const AVInputFormat *fmt1 = NULL;
     const AVInputFormat *fmt = NULL;
+    const char *ext = NULL;
     int score, score_max = 0;
     void *i = 0;
     const static uint8_t zerobuffer[AVPROBE_PADDING_SIZE];
@@ -159,6 +160,11 @@ const AVInputFormat *av_probe_input_format3(const AVProbeData *pd,
             nodat = ID3_GREATER_PROBE;
     }
 
+    /* Look the extension up once instead of once per demuxer; without one
+     * no demuxer can match by extension. */
+    if (lpd.filename && (ext = strrchr(lpd.filename, '.')))
+        ext++;
+
     while ((fmt1 = av_demuxer_iterate(&i))) {
         if (fmt1->flags & AVFMT_EXPERIMENTAL)
             continue;
@@ -169,7 +175,7 @@ const AVInputFormat *av_probe_input_format3(const AVProbeData *pd,
             score = fmt1->read_probe(&lpd);
             if (score)
                 av_log(NULL, AV_LOG_TRACE, "Probing %s score:%d size:%d\n", fmt1->name, score, lpd.buf_size);
-            if (fmt1->extensions && av_match_ext(lpd.filename, fmt1->extensions)) {
+            if (ext && fmt1->extensions && av_match_name(ext, fmt1->extensions)) {
                 switch (nodat) {
                 case NO_ID3:
                     score = FFMAX(score, 1);
@@ -183,8 +189,8 @@ const AVInputFormat *av_probe_input_format3(const AVProbeData *pd,
                     break;
                 }
             }
-        } else if (fmt1->extensions) {
-            if (av_match_ext(lpd.filename, fmt1->extensions))
+        } else if (ext && fmt1->extensions) {
+            if (av_match_name(ext, fmt1->extensions))
                 score = AVPROBE_SCORE_EXTENSION;
         }
         if (av_match_name(lpd.mime_type, fmt1->mime_type)) {
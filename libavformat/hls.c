@@ -43,6 +43,7 @@
 #include "internal.h"
 #include "avio_internal.h"
 #include "id3v2.h"
+#include "prefetch.h"
 
 #include "hls_sample_encryption.h"
 
@@ -105,6 +106,9 @@ struct playlist {
     int input_read_done;
     AVIOContext *input_next;
     int input_next_requested;
+    FFPrefetcher *prefetch;
+    uint8_t *prefetched;        ///< data of the current segment, if prefetched
+    size_t prefetched_size;
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -225,6 +229,8 @@ typedef struct HLSContext {
     int http_persistent;
     int http_multiple;
     int http_seekable;
+    int prefetch_segments;
+    int64_t prefetch_max_size;
     AVIOContext *playlist_pb;
     HLSCryptoContext  crypto_ctx;
 } HLSContext;
@@ -277,6 +283,8 @@ static void free_playlist_list(HLSContext *c)
         pls->input_read_done = 0;
         ff_format_io_close(c->ctx, &pls->input_next);
         pls->input_next_requested = 0;
+        ff_prefetch_free(&pls->prefetch);
+        av_freep(&pls->prefetched);
         if (pls->ctx) {
             pls->ctx->pb = NULL;
             avformat_close_input(&pls->ctx);
@@ -1064,7 +1072,14 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetched) {
+        ret = FFMIN(buf_size, pls->prefetched_size - pls->cur_seg_offset);
+        if (ret <= 0)
+            return AVERROR_EOF;
+        memcpy(buf, pls->prefetched + pls->cur_seg_offset, ret);
+    } else {
+        ret = avio_read(pls->input, buf, buf_size);
+    }
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1465,6 +1480,64 @@ static int playlist_needed(struct playlist *pls)
     return 0;
 }
 
+static void reset_prefetch(struct playlist *pls)
+{
+    av_freep(&pls->prefetched);
+    if (pls->prefetch)
+        ff_prefetch_flush(pls->prefetch);
+}
+
+/* queue the download of the segments following the current one */
+static void prefetch_segments(HLSContext *c, struct playlist *v)
+{
+    int ret;
+
+    if (!v->prefetch) {
+        /* http_multiple disabled, or not supported by the server, limits
+         * the downloads to a single connection */
+        ret = ff_prefetch_alloc(&v->prefetch, v->parent, c->prefetch_segments,
+                                c->http_multiple ? c->prefetch_segments : 1,
+                                FFMIN(c->prefetch_max_size, SIZE_MAX));
+        if (ret < 0) {
+            av_log(v->parent, AV_LOG_WARNING,
+                   "Cannot prefetch segments: %s\n", av_err2str(ret));
+            c->prefetch_segments = 0;
+            return;
+        }
+    }
+
+    for (int i = 1; i <= c->prefetch_segments; i++) {
+        const int64_t seq_no = v->cur_seq_no + i;
+        const char *proto_name;
+        AVDictionary *opts = NULL;
+        struct segment *seg;
+
+        if (seq_no - v->start_seq_no >= v->n_segments)
+            break;
+        seg = v->segments[seq_no - v->start_seq_no];
+
+        /* only plain http(s) segments, as checked by open_url() */
+        proto_name = avio_find_protocol_name(seg->url);
+        if (seg->key_type != KEY_NONE || !proto_name ||
+            !av_strstart(proto_name, "http", NULL) ||
+            strncmp(seg->url, proto_name, strlen(proto_name)) ||
+            seg->url[strlen(proto_name)] != ':')
+            continue;
+
+        av_dict_copy(&opts, c->avio_opts, 0);
+        if (c->http_persistent)
+            av_dict_set(&opts, "multiple_requests", "1", 0);
+        if (seg->size >= 0) {
+            av_dict_set_int(&opts, "offset", seg->url_offset, 0);
+            av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+        }
+        ret = ff_prefetch_submit(v->prefetch, seq_no, seg->url, opts);
+        av_dict_free(&opts);
+        if (ret < 0)
+            break;
+    }
+}
+
 static int read_data(void *opaque, uint8_t *buf, int buf_size)
 {
     struct playlist *v = opaque;
@@ -1478,7 +1551,8 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if (!v->prefetched &&
+        (!v->input || (c->http_persistent && v->input_read_done))) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1549,7 +1623,22 @@ reload:
         if (ret)
             return ret;
 
-        if (c->http_multiple == 1 && v->input_next_requested) {
+        if (v->prefetch &&
+            (ret = ff_prefetch_get(v->prefetch, v->cur_seq_no, &v->prefetched,
+                                   &v->prefetched_size)) != AVERROR(ENOENT)) {
+            if (ret < 0) {
+                if (ret == AVERROR_EXIT)
+                    return ret;
+                av_log(v->parent, AV_LOG_WARNING,
+                       "Prefetching segment %"PRId64" of playlist %d failed, retrying\n",
+                       v->cur_seq_no, v->index);
+                ret = open_input(c, v, seg, &v->input);
+            } else {
+                /* a persistent connection stays idle until the next open */
+                v->input_read_done = !!v->input;
+                v->cur_seg_offset  = 0;
+            }
+        } else if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
@@ -1569,7 +1658,7 @@ reload:
         just_opened = 1;
     }
 
-    if (c->http_multiple == -1) {
+    if (c->http_multiple == -1 && v->input) {
         uint8_t *http_version_opt = NULL;
         int r = av_opt_get(v->input, "http_version", AV_OPT_SEARCH_CHILDREN, &http_version_opt);
         if (r >= 0) {
@@ -1578,8 +1667,11 @@ reload:
         }
     }
 
+    if (just_opened && c->prefetch_segments > 0)
+        prefetch_segments(c, v);
+
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !v->input_next_requested && c->prefetch_segments <= 0 &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1612,7 +1704,9 @@ reload:
 
         return ret;
     }
-    if (c->http_persistent &&
+    if (v->prefetched) {
+        av_freep(&v->prefetched);
+    } else if (c->http_persistent &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
@@ -2076,6 +2170,7 @@ static int hls_read_header(AVFormatContext *s)
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next = NULL;
             pls->input_next_requested = 0;
+            reset_prefetch(pls);
             pls->cur_seg_offset = 0;
             pls->cur_init_section = NULL;
             /* Reset EOF flag */
@@ -2228,6 +2323,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
+            reset_prefetch(pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -2484,6 +2580,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        reset_prefetch(pls);
         av_packet_unref(pls->pkt);
         pb->eof_reached = 0;
         /* Clear any buffered data */
@@ -2545,6 +2642,10 @@ static const AVOption hls_options[] = {
         OFFSET(http_persistent), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, FLAGS },
     {"http_multiple", "Use multiple HTTP connections for fetching segments",
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
+    {"prefetch_segments", "Number of upcoming segments to download in the background",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 16, FLAGS},
+    {"prefetch_max_size", "Maximum memory used by the prefetched segments of a playlist",
+        OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
         OFFSET(http_seekable), AV_OPT_TYPE_BOOL, { .i64 = -1}, -1, 1, FLAGS},
     {"seg_format_options", "Set options for segment demuxer",
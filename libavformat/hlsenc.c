@@ -55,6 +55,7 @@
 #include "internal.h"
 #include "mux.h"
 #include "os_support.h"
+#include "upload.h"
 
 typedef enum {
     HLS_START_SEQUENCE_AS_START_NUMBER = 0,
@@ -250,6 +251,11 @@ typedef struct HLSContext {
     char *master_pl_name;
     unsigned int master_publish_rate;
     int http_persistent;
+    int http2;
+    int upload_connections;
+    int64_t upload_max_size;
+    int upload_retries;
+    FFUploader *uploader;
     AVIOContext *m3u8_out;
     AVIOContext *sub_m3u8_out;
     int64_t timeout;
@@ -282,13 +288,28 @@ static int strftime_expand(const char *fmt, char **dest)
     return r;
 }
 
+/* The files of a variant stream are uploaded in order, the playlists shared
+ * by the variant streams after all the files written before them. */
+static int upload_queue(HLSContext *hls, AVIOContext **pb)
+{
+    for (int i = 0; i < hls->nb_varstreams; i++) {
+        VariantStream *vs = &hls->var_streams[i];
+        if (pb == &vs->out || (vs->vtt_avf && pb == &vs->vtt_avf->pb))
+            return i;
+    }
+    return -1;
+}
+
 static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, const char *filename,
                           AVDictionary **options)
 {
     HLSContext *hls = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
-    if (!*pb || !http_base_proto || !hls->http_persistent) {
+    if (hls->uploader && http_base_proto) {
+        err = ff_uploader_open(hls->uploader, pb, upload_queue(hls, pb),
+                               filename, options ? *options : NULL);
+    } else if (!*pb || !http_base_proto || !hls->http_persistent) {
         err = s->io_open(s, pb, filename, AVIO_FLAG_WRITE, options);
 #if CONFIG_HTTP_PROTOCOL
     } else {
@@ -310,6 +331,9 @@ static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
     int ret = 0;
     if (!*pb)
         return ret;
+    if (hls->uploader && (ret = ff_uploader_close(hls->uploader, pb)) != AVERROR(ENOENT))
+        return ret;
+    ret = 0;
     if (!http_base_proto || !hls->http_persistent || hls->key_info_file || hls->encrypt) {
         ff_format_io_close(s, pb);
 #if CONFIG_HTTP_PROTOCOL
@@ -336,6 +360,8 @@ static void set_http_options(AVFormatContext *s, AVDictionary **options, HLSCont
         av_dict_set(options, "user_agent", c->user_agent, 0);
     if (c->http_persistent)
         av_dict_set_int(options, "multiple_requests", 1, 0);
+    if (c->http2)
+        av_dict_set_int(options, "http2", 1, 0);
     if (c->timeout >= 0)
         av_dict_set_int(options, "timeout", c->timeout, 0);
     if (c->headers)
@@ -573,6 +599,11 @@ static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
         int ret;
         set_http_options(avf, &opt, hls);
         av_dict_set(&opt, "method", "DELETE", 0);
+        if (hls->uploader && ff_is_http_proto(path)) {
+            ret = ff_uploader_submit(hls->uploader, -1, path, opt, NULL, 0);
+            av_dict_free(&opt);
+            return ret < 0 && !hls->ignore_io_errors ? ret : 0;
+        }
         ret = avf->io_open(avf, &out, path, AVIO_FLAG_WRITE, &opt);
         av_dict_free(&opt);
         if (ret < 0)
@@ -2686,6 +2717,8 @@ static void hls_deinit(AVFormatContext *s)
     int i = 0;
     VariantStream *vs = NULL;
 
+    ff_uploader_free(&hls->uploader);
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
@@ -2765,8 +2798,8 @@ static int hls_write_trailer(struct AVFormatContext *s)
                 vs->start_pos = range_length;
                 byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
                 if (!byterange_mode) {
-                    ff_format_io_close(s, &vs->out);
                     hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
+                    ff_format_io_close(s, &vs->out);
                 }
             }
         }
@@ -2835,6 +2868,7 @@ failed:
             if (vtt_oc->pb)
                 av_write_trailer(vtt_oc);
             vs->size = avio_tell(vs->vtt_avf->pb) - vs->start_pos;
+            hlsenc_io_close(s, &vtt_oc->pb, vtt_oc->url);
             ff_format_io_close(s, &vtt_oc->pb);
         }
         ret = hls_window(s, 1, vs);
@@ -2848,6 +2882,12 @@ failed:
         av_free(old_filename);
     }
 
+    if (hls->uploader) {
+        ret = ff_uploader_wait(hls->uploader);
+        if (ret < 0 && !hls->ignore_io_errors)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -2887,6 +2927,21 @@ static int hls_init(AVFormatContext *s)
         av_log(hls, AV_LOG_WARNING, "No HTTP method set, hls muxer defaulting to method PUT.\n");
     }
 
+    if (hls->upload_connections > 0 && http_base_proto) {
+        if ((hls->flags & HLS_SINGLE_FILE) || hls->max_seg_size > 0) {
+            av_log(hls, AV_LOG_WARNING, "Background uploads are not supported "
+                   "with single_file and hls_segment_size\n");
+        } else {
+            ret = ff_uploader_alloc(&hls->uploader, s, hls->upload_connections,
+                                    FFMIN(hls->upload_max_size, SIZE_MAX),
+                                    hls->upload_retries);
+            if (ret == AVERROR(ENOSYS))
+                av_log(hls, AV_LOG_WARNING, "Background uploads need threads\n");
+            else if (ret < 0)
+                return ret;
+        }
+    }
+
     ret = validate_name(hls->nb_varstreams, s->url);
     if (ret < 0)
         return ret;
@@ -3164,8 +3219,12 @@ static const AVOption options[] = {
     {"master_pl_name", "Create HLS master playlist with this name", OFFSET(master_pl_name), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,    E},
     {"master_pl_publish_rate", "Publish master play list every after this many segment intervals", OFFSET(master_publish_rate), AV_OPT_TYPE_INT, {.i64 = 0}, 0, UINT_MAX, E},
     {"http_persistent", "Use persistent HTTP connections", OFFSET(http_persistent), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
+    {"http2", "Use HTTP/2 if the server supports it", OFFSET(http2), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
     {"timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     {"ignore_io_errors", "Ignore IO errors for stable long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    {"upload_connections", "number of connections used to upload the files in the background, 0 to upload them from the muxer", OFFSET(upload_connections), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, E},
+    {"upload_max_size", "maximum size of the files waiting for their upload", OFFSET(upload_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, E},
+    {"upload_retries", "number of times a failed background upload is retried", OFFSET(upload_retries), AV_OPT_TYPE_INT, {.i64 = 2}, 0, INT_MAX, E},
     {"headers", "set custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { NULL },
 };
@@ -0,0 +1,447 @@
+/*
+ * HPACK header compression for HTTP/2 (RFC 7541)
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/error.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "hpack.h"
+
+#define HUFFMAN_SYMBOLS 257
+#define HUFFMAN_EOS     256
+#define HUFFMAN_MAX_LEN 30
+
+/* every entry of the dynamic table is accounted with this overhead */
+#define ENTRY_OVERHEAD  32
+
+static const HPACKEntry static_table[] = {
+    { ":authority",                  ""              },
+    { ":method",                     "GET"           },
+    { ":method",                     "POST"          },
+    { ":path",                       "/"             },
+    { ":path",                       "/index.html"   },
+    { ":scheme",                     "http"          },
+    { ":scheme",                     "https"         },
+    { ":status",                     "200"           },
+    { ":status",                     "204"           },
+    { ":status",                     "206"           },
+    { ":status",                     "304"           },
+    { ":status",                     "400"           },
+    { ":status",                     "404"           },
+    { ":status",                     "500"           },
+    { "accept-charset",              ""              },
+    { "accept-encoding",             "gzip, deflate" },
+    { "accept-language",             ""              },
+    { "accept-ranges",               ""              },
+    { "accept",                      ""              },
+    { "access-control-allow-origin", ""              },
+    { "age",                         ""              },
+    { "allow",                       ""              },
+    { "authorization",               ""              },
+    { "cache-control",               ""              },
+    { "content-disposition",         ""              },
+    { "content-encoding",            ""              },
+    { "content-language",            ""              },
+    { "content-length",              ""              },
+    { "content-location",            ""              },
+    { "content-range",               ""              },
+    { "content-type",                ""              },
+    { "cookie",                      ""              },
+    { "date",                        ""              },
+    { "etag",                        ""              },
+    { "expect",                      ""              },
+    { "expires",                     ""              },
+    { "from",                        ""              },
+    { "host",                        ""              },
+    { "if-match",                    ""              },
+    { "if-modified-since",           ""              },
+    { "if-none-match",               ""              },
+    { "if-range",                    ""              },
+    { "if-unmodified-since",         ""              },
+    { "last-modified",               ""              },
+    { "link",                        ""              },
+    { "location",                    ""              },
+    { "max-forwards",                ""              },
+    { "proxy-authenticate",          ""              },
+    { "proxy-authorization",         ""              },
+    { "range",                       ""              },
+    { "referer",                     ""              },
+    { "refresh",                     ""              },
+    { "retry-after",                 ""              },
+    { "server",                      ""              },
+    { "set-cookie",                  ""              },
+    { "strict-transport-security",   ""              },
+    { "transfer-encoding",           ""              },
+    { "user-agent",                  ""              },
+    { "vary",                        ""              },
+    { "via",                         ""              },
+    { "www-authenticate",            ""              },
+};
+
+#define STATIC_TABLE_SIZE FF_ARRAY_ELEMS(static_table)
+
+/* code lengths of the Huffman code of RFC 7541 appendix B, which is
+ * canonical: the codes are assigned in increasing order of length, then
+ * of symbol */
+static const uint8_t huffman_lens[HUFFMAN_SYMBOLS] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+     6, 10, 10, 12, 13,  6,  8, 11, 10, 10,  8, 11,  8,  6,  6,  6,
+     5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8, 15,  6, 12, 10,
+    13,  6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+     7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8, 13, 19, 13, 14,  6,
+    15,  5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,
+     6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+static struct {
+    uint32_t first_code[HUFFMAN_MAX_LEN + 1];
+    uint16_t first_index[HUFFMAN_MAX_LEN + 1];
+    uint16_t count[HUFFMAN_MAX_LEN + 1];
+    uint16_t symbols[HUFFMAN_SYMBOLS];
+} huffman;
+
+static AVOnce huffman_init_once = AV_ONCE_INIT;
+
+static void huffman_init(void)
+{
+    uint32_t code = 0;
+    int index = 0;
+
+    for (int i = 0; i < HUFFMAN_SYMBOLS; i++)
+        huffman.count[huffman_lens[i]]++;
+
+    for (int len = 1; len <= HUFFMAN_MAX_LEN; len++) {
+        huffman.first_code[len]  = code;
+        huffman.first_index[len] = index;
+        for (int i = 0; i < HUFFMAN_SYMBOLS; i++)
+            if (huffman_lens[i] == len)
+                huffman.symbols[index++] = i;
+        code = (code + huffman.count[len]) << 1;
+    }
+}
+
+static int huffman_decode(AVBPrint *bp, const uint8_t *buf, size_t size)
+{
+    uint32_t code = 0;
+    int len = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            uint32_t idx;
+
+            code = code << 1 | (buf[i] >> bit & 1);
+            if (++len > HUFFMAN_MAX_LEN)
+                return AVERROR_INVALIDDATA;
+
+            idx = code - huffman.first_code[len];
+            if (code < huffman.first_code[len] || idx >= huffman.count[len])
+                continue;
+            idx = huffman.symbols[huffman.first_index[len] + idx];
+            /* a nul character cannot be passed in a C string anyway */
+            if (idx == HUFFMAN_EOS || !idx)
+                return AVERROR_INVALIDDATA;
+            av_bprint_chars(bp, idx, 1);
+            code = 0;
+            len  = 0;
+        }
+    }
+
+    /* the padding is made of the most significant bits of EOS, all ones */
+    if (len > 7 || code != (1U << len) - 1)
+        return AVERROR_INVALIDDATA;
+    return 0;
+}
+
+static int decode_int(const uint8_t **p, const uint8_t *end, int prefix_bits,
+                      uint32_t *val)
+{
+    const uint32_t mask = (1 << prefix_bits) - 1;
+    uint64_t v = **p & mask;
+    int shift = 0;
+
+    (*p)++;
+    if (v < mask) {
+        *val = v;
+        return 0;
+    }
+    do {
+        if (*p >= end || shift > 28)
+            return AVERROR_INVALIDDATA;
+        v += (uint64_t)(**p & 0x7f) << shift;
+        shift += 7;
+    } while (*(*p)++ & 0x80);
+
+    if (v > INT32_MAX)
+        return AVERROR_INVALIDDATA;
+    *val = v;
+    return 0;
+}
+
+static int decode_string(AVBPrint *bp, const uint8_t **p, const uint8_t *end)
+{
+    const int huffman_coded = **p & 0x80;
+    uint32_t len;
+    int ret;
+
+    av_bprint_clear(bp);
+    if ((ret = decode_int(p, end, 7, &len)) < 0)
+        return ret;
+    if (len > end - *p)
+        return AVERROR_INVALIDDATA;
+
+    if (huffman_coded) {
+        ret = huffman_decode(bp, *p, len);
+        if (ret < 0)
+            return ret;
+    } else {
+        if (memchr(*p, 0, len))
+            return AVERROR_INVALIDDATA;
+        av_bprint_append_data(bp, (const char *)*p, len);
+    }
+    *p += len;
+
+    return av_bprint_is_complete(bp) ? 0 : AVERROR(ENOMEM);
+}
+
+static HPACKEntry *dynamic_entry(HPACKDecoder *d, int i)
+{
+    return &d->entries[(d->first + d->nb_entries - 1 - i) % d->nb_allocated];
+}
+
+static const HPACKEntry *get_entry(HPACKDecoder *d, uint32_t index)
+{
+    if (!index)
+        return NULL;
+    if (index <= STATIC_TABLE_SIZE)
+        return &static_table[index - 1];
+    index -= STATIC_TABLE_SIZE + 1;
+    if (index >= d->nb_entries)
+        return NULL;
+    return dynamic_entry(d, index);
+}
+
+static size_t entry_size(const char *name, const char *value)
+{
+    return strlen(name) + strlen(value) + ENTRY_OVERHEAD;
+}
+
+static void evict(HPACKDecoder *d, size_t max_size)
+{
+    while (d->size > max_size) {
+        HPACKEntry *e = &d->entries[d->first];
+
+        d->size -= entry_size(e->name, e->value);
+        av_freep(&e->name);
+        av_freep(&e->value);
+        d->first = (d->first + 1) % d->nb_allocated;
+        d->nb_entries--;
+    }
+}
+
+static int add_entry(HPACKDecoder *d, const char *name, const char *value)
+{
+    const size_t size = entry_size(name, value);
+    HPACKEntry *e;
+
+    /* an entry larger than the table empties it and is not added */
+    if (size > d->max_size) {
+        evict(d, 0);
+        return 0;
+    }
+    evict(d, d->max_size - size);
+
+    if (d->nb_entries == d->nb_allocated) {
+        const int nb_allocated = 2 * d->nb_allocated + 8;
+        HPACKEntry *entries = av_malloc_array(nb_allocated, sizeof(*entries));
+
+        if (!entries)
+            return AVERROR(ENOMEM);
+        for (int i = 0; i < d->nb_entries; i++)
+            entries[i] = d->entries[(d->first + i) % d->nb_allocated];
+        av_free(d->entries);
+        d->entries      = entries;
+        d->nb_allocated = nb_allocated;
+        d->first        = 0;
+    }
+
+    e = &d->entries[(d->first + d->nb_entries) % d->nb_allocated];
+    e->name  = av_strdup(name);
+    e->value = av_strdup(value);
+    if (!e->name || !e->value) {
+        av_freep(&e->name);
+        av_freep(&e->value);
+        return AVERROR(ENOMEM);
+    }
+    d->nb_entries++;
+    d->size += size;
+
+    return 0;
+}
+
+void ff_hpack_decoder_init(HPACKDecoder *d, size_t max_size)
+{
+    memset(d, 0, sizeof(*d));
+    d->max_size       = max_size;
+    d->max_size_limit = max_size;
+    ff_thread_once(&huffman_init_once, huffman_init);
+}
+
+void ff_hpack_decoder_uninit(HPACKDecoder *d)
+{
+    evict(d, 0);
+    av_freep(&d->entries);
+    d->nb_allocated = 0;
+}
+
+int ff_hpack_decode(HPACKDecoder *d, const uint8_t *buf, size_t size,
+                    HPACKHeaderCallback cb, void *opaque)
+{
+    const uint8_t *p = buf, *end = buf + size;
+    AVBPrint name, value;
+    int ret = 0;
+
+    av_bprint_init(&name,  0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprint_init(&value, 0, AV_BPRINT_SIZE_UNLIMITED);
+
+    while (p < end) {
+        const HPACKEntry *e = NULL;
+        uint32_t index;
+        int indexing = 0;
+
+        if (*p & 0x80) {
+            /* indexed header field */
+            if ((ret = decode_int(&p, end, 7, &index)) < 0)
+                break;
+            if (!(e = get_entry(d, index))) {
+                ret = AVERROR_INVALIDDATA;
+                break;
+            }
+            if ((ret = cb(opaque, e->name, e->value)) < 0)
+                break;
+            continue;
+        } else if ((*p & 0xe0) == 0x20) {
+            /* dynamic table size update */
+            if ((ret = decode_int(&p, end, 5, &index)) < 0)
+                break;
+            if (index > d->max_size_limit) {
+                ret = AVERROR_INVALIDDATA;
+                break;
+            }
+            d->max_size = index;
+            evict(d, d->max_size);
+            continue;
+        } else if (*p & 0x40) {
+            /* literal header field with incremental indexing */
+            indexing = 1;
+            ret = decode_int(&p, end, 6, &index);
+        } else {
+            /* literal header field without indexing or never indexed */
+            ret = decode_int(&p, end, 4, &index);
+        }
+        if (ret < 0)
+            break;
+
+        if (index) {
+            if (!(e = get_entry(d, index))) {
+                ret = AVERROR_INVALIDDATA;
+                break;
+            }
+            av_bprint_clear(&name);
+            av_bprintf(&name, "%s", e->name);
+        } else if (p >= end || (ret = decode_string(&name, &p, end)) < 0) {
+            ret = ret < 0 ? ret : AVERROR_INVALIDDATA;
+            break;
+        }
+        if (p >= end || (ret = decode_string(&value, &p, end)) < 0) {
+            ret = ret < 0 ? ret : AVERROR_INVALIDDATA;
+            break;
+        }
+        if (!av_bprint_is_complete(&name)) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+
+        if ((ret = cb(opaque, name.str, value.str)) < 0)
+            break;
+        if (indexing && (ret = add_entry(d, name.str, value.str)) < 0)
+            break;
+    }
+
+    av_bprint_finalize(&name,  NULL);
+    av_bprint_finalize(&value, NULL);
+    return ret;
+}
+
+static void encode_int(AVBPrint *bp, uint8_t flags, int prefix_bits, size_t val)
+{
+    const size_t mask = (1 << prefix_bits) - 1;
+
+    if (val < mask) {
+        av_bprint_chars(bp, flags | val, 1);
+        return;
+    }
+    av_bprint_chars(bp, flags | mask, 1);
+    for (val -= mask; val >= 0x80; val >>= 7)
+        av_bprint_chars(bp, 0x80 | (val & 0x7f), 1);
+    av_bprint_chars(bp, val, 1);
+}
+
+static void encode_string(AVBPrint *bp, const char *str)
+{
+    const size_t len = strlen(str);
+
+    encode_int(bp, 0x00, 7, len);
+    av_bprint_append_data(bp, str, len);
+}
+
+void ff_hpack_encode(AVBPrint *bp, const char *name, const char *value)
+{
+    int name_index = 0;
+
+    for (int i = 0; i < STATIC_TABLE_SIZE; i++) {
+        if (strcmp(static_table[i].name, name))
+            continue;
+        if (!strcmp(static_table[i].value, value)) {
+            encode_int(bp, 0x80, 7, i + 1);
+            return;
+        }
+        if (!name_index)
+            name_index = i + 1;
+    }
+
+    /* literal header field without indexing */
+    encode_int(bp, 0x00, 4, name_index);
+    if (!name_index)
+        encode_string(bp, name);
+    encode_string(bp, value);
+}
@@ -0,0 +1,79 @@
+/*
+ * HPACK header compression for HTTP/2 (RFC 7541)
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_HPACK_H
+#define AVFORMAT_HPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libavutil/bprint.h"
+
+/** size of the dynamic table until the peer changes it */
+#define HPACK_DEFAULT_TABLE_SIZE 4096
+
+typedef struct HPACKEntry {
+    const char *name;
+    const char *value;
+} HPACKEntry;
+
+typedef struct HPACKDecoder {
+    HPACKEntry *entries;        ///< circular buffer of the dynamic table
+    int nb_entries;
+    int nb_allocated;
+    int first;                  ///< index of the oldest entry
+    size_t size;                ///< sum of the entry sizes, as defined by HPACK
+    size_t max_size;            ///< current limit set by the encoder
+    size_t max_size_limit;      ///< limit announced to the encoder
+} HPACKDecoder;
+
+/**
+ * Callback called for every decoded header field, in order.
+ *
+ * @return a negative error code to stop the decoding
+ */
+typedef int (*HPACKHeaderCallback)(void *opaque, const char *name,
+                                   const char *value);
+
+void ff_hpack_decoder_init(HPACKDecoder *d, size_t max_size);
+
+void ff_hpack_decoder_uninit(HPACKDecoder *d);
+
+/**
+ * Decode a complete header block, updating the dynamic table.
+ *
+ * The whole block must be decoded even when its header fields are not used,
+ * since the next blocks refer to the dynamic table.
+ *
+ * @return 0 on success, a negative error code on failure, in which case the
+ *         decoder state is undefined (HTTP/2 treats it as a connection error)
+ */
+int ff_hpack_decode(HPACKDecoder *d, const uint8_t *buf, size_t size,
+                    HPACKHeaderCallback cb, void *opaque);
+
+/**
+ * Append the encoding of a header field to a header block.
+ *
+ * The field is not added to the dynamic table: exact matches of the static
+ * table are indexed, everything else is sent as a literal.
+ */
+void ff_hpack_encode(AVBPrint *bp, const char *name, const char *value);
+
+#endif /* AVFORMAT_HPACK_H */
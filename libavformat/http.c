@@ -36,6 +36,7 @@
 
 #include "avformat.h"
 #include "http.h"
+#include "http2.h"
 #include "httpauth.h"
 #include "internal.h"
 #include "network.h"
@@ -118,6 +119,7 @@ typedef struct HTTPContext {
     AVDictionary *chained_options;
     /* -1 = try to send if applicable, 0 = always disabled, 1 = always enabled */
     int send_expect_100;
+    int wait_response;
     char *method;
     int reconnect;
     int reconnect_at_eof;
@@ -136,6 +138,12 @@ typedef struct HTTPContext {
     char *new_location;
     AVDictionary *redirect_cache;
     uint64_t filesize_from_content_range;
+    int http2;
+    /* Set if the connection uses HTTP/2, the requests being sent on streams. */
+    HTTP2Session *h2;
+    int h2_stream;
+    /* stream kept while a seek opens a new stream on the same connection */
+    int h2_old_stream;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -164,6 +172,7 @@ static const AVOption options[] = {
     { "none", "No auth method set, autodetect", 0, AV_OPT_TYPE_CONST, { .i64 = HTTP_AUTH_NONE }, 0, 0, D | E, "auth_type"},
     { "basic", "HTTP basic authentication", 0, AV_OPT_TYPE_CONST, { .i64 = HTTP_AUTH_BASIC }, 0, 0, D | E, "auth_type"},
     { "send_expect_100", "Force sending an Expect: 100-continue header for POST", OFFSET(send_expect_100), AV_OPT_TYPE_BOOL, { .i64 = -1 }, -1, 1, E },
+    { "wait_response", "wait for the response when the body of a POST is complete", OFFSET(wait_response), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     { "location", "The actual location of the data received", OFFSET(location), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D | E },
     { "offset", "initial byte offset", OFFSET(off), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D },
     { "end_offset", "try to limit the request to bytes preceding this offset", OFFSET(end_off), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D },
@@ -178,6 +187,7 @@ static const AVOption options[] = {
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
     { "short_seek_size", "Threshold to favor readahead over seek.", OFFSET(short_seek_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { "http2", "use HTTP/2 if the server supports it", OFFSET(http2), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D | E },
     { NULL }
 };
 
@@ -197,6 +207,25 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+static void http_close_cnx(HTTPContext *s)
+{
+    ff_http2_close(&s->h2);
+    s->h2_stream     = 0;
+    s->h2_old_stream = 0;
+    ffurl_closep(&s->hd);
+}
+
+/* Drop the current request, keeping an HTTP/2 connection for the next ones. */
+static void http_end_request(HTTPContext *s)
+{
+    if (s->h2 && ff_http2_can_open_stream(s->h2)) {
+        ff_http2_close_stream(s->h2, s->h2_stream);
+        s->h2_stream = 0;
+    } else {
+        http_close_cnx(s);
+    }
+}
+
 static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -233,6 +262,11 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
             if (err < 0)
                 goto end;
         }
+        if (s->http2 && !s->listen) {
+            err = av_dict_set(options, "alpn", "h2,http/1.1", 0);
+            if (err < 0)
+                goto end;
+        }
     }
     if (port < 0)
         port = 80;
@@ -262,10 +296,29 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
+    if (s->h2 && !ff_http2_can_open_stream(s->h2))
+        http_close_cnx(s);
+
     if (!s->hd) {
         err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
                                    &h->interrupt_callback, options,
                                    h->protocol_whitelist, h->protocol_blacklist, h);
+        if (err < 0 || !s->http2 || s->listen || use_proxy)
+            goto end;
+
+        /* over TLS the server selects the protocol, in clear the support of
+         * HTTP/2 is assumed when requested */
+        if (!strcmp(lower_proto, "tls")) {
+            uint8_t *alpn = NULL;
+            int h2 = av_opt_get(s->hd, "alpn_selected", AV_OPT_SEARCH_CHILDREN, &alpn) >= 0 &&
+                     alpn && !strcmp(alpn, "h2");
+            av_free(alpn);
+            if (!h2)
+                goto end;
+        }
+        err = ff_http2_open(&s->h2, s->hd, h);
+        if (err < 0)
+            ffurl_closep(&s->hd);
     }
 
 end:
@@ -392,7 +445,7 @@ redo:
         /* restore the offset (http_connect resets it) */
         s->off = off;
 
-        ffurl_closep(&s->hd);
+        http_close_cnx(s);
         goto redo;
     }
 
@@ -400,7 +453,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_end_request(s);
             goto redo;
         } else
             goto fail;
@@ -408,7 +461,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_end_request(s);
             goto redo;
         } else
             goto fail;
@@ -417,7 +470,7 @@ redo:
          s->http_code == 303 || s->http_code == 307 || s->http_code == 308) &&
         s->new_location) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        http_close_cnx(s);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
 
@@ -442,10 +495,11 @@ redo:
     return 0;
 
 fail:
-    if (s->hd)
-        ffurl_closep(&s->hd);
-    if (ret < 0)
+    if (ret < 0) {
+        http_close_cnx(s);
         return ret;
+    }
+    http_end_request(s);
     return ff_http_averror(s->http_code, AVERROR(EIO));
 }
 
@@ -755,11 +809,18 @@ fail:
     return ret;
 }
 
+static int http_lower_read(HTTPContext *s, uint8_t *buf, int size)
+{
+    if (s->h2)
+        return ff_http2_read(s->h2, s->h2_stream, buf, size);
+    return ffurl_read(s->hd, buf, size);
+}
+
 static int http_getc(HTTPContext *s)
 {
     int len;
     if (s->buf_ptr >= s->buf_end) {
-        len = ffurl_read(s->hd, s->buffer, BUFFER_SIZE);
+        len = http_lower_read(s, s->buffer, BUFFER_SIZE);
         if (len < 0) {
             return len;
         } else if (len == 0) {
@@ -1337,6 +1398,15 @@ static int http_read_header(URLContext *h)
     s->chunksize = UINT64_MAX;
     s->filesize_from_content_range = UINT64_MAX;
 
+    if (s->h2) {
+        /* the header is converted to HTTP/1.1 and parsed from the buffer */
+        err = ff_http2_read_response(s->h2, s->h2_stream, s->buffer, sizeof(s->buffer));
+        if (err < 0)
+            return err;
+        s->buf_ptr = s->buffer;
+        s->buf_end = s->buffer + err;
+    }
+
     for (;;) {
         if ((err = http_get_line(s, line, sizeof(line))) < 0)
             return err;
@@ -1430,7 +1500,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
     proxyauthstr = ff_http_auth_create_response(&s->proxy_auth_state, proxyauth,
                                                 local_path, method);
 
-     if (post && !s->post_data) {
+     if (post && !s->post_data && !s->h2) {
         if (s->send_expect_100 != -1) {
             send_expect_100 = s->send_expect_100;
         } else {
@@ -1512,12 +1582,27 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
         goto done;
     }
 
-    if ((err = ffurl_write(s->hd, request.str, request.len)) < 0)
-        goto done;
-
-    if (s->post_data)
-        if ((err = ffurl_write(s->hd, s->post_data, s->post_datalen)) < 0)
+    if (s->h2) {
+        if (s->h2_stream)
+            ff_http2_close_stream(s->h2, s->h2_stream);
+        err = ff_http2_send_request(s->h2, request.str,
+                                    av_strstart(s->location, "https:", NULL) ? "https" : "http",
+                                    !post);
+        s->h2_stream = FFMAX(err, 0);
+        if (err < 0)
             goto done;
+        if (s->post_data &&
+            ((err = ff_http2_write(s->h2, s->h2_stream, s->post_data, s->post_datalen)) < 0 ||
+             (err = ff_http2_end_stream(s->h2, s->h2_stream)) < 0))
+            goto done;
+    } else {
+        if ((err = ffurl_write(s->hd, request.str, request.len)) < 0)
+            goto done;
+
+        if (s->post_data)
+            if ((err = ffurl_write(s->hd, s->post_data, s->post_datalen)) < 0)
+                goto done;
+    }
 
     /* init input buffer */
     s->buf_ptr          = s->buffer;
@@ -1610,9 +1695,11 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
         uint64_t target_end = s->end_off ? s->end_off : s->filesize;
         if ((!s->willclose || s->chunksize == UINT64_MAX) && s->off >= target_end)
             return AVERROR_EOF;
-        len = ffurl_read(s->hd, buf, size);
+        len = http_lower_read(s, buf, size);
+        /* the end of an HTTP/2 stream is signalled, even without a size */
         if ((!len || len == AVERROR_EOF) &&
-            (!s->willclose || s->chunksize == UINT64_MAX) && s->off < target_end) {
+            (!s->willclose || s->chunksize == UINT64_MAX) && s->off < target_end &&
+            (!s->h2 || target_end != UINT64_MAX)) {
             av_log(h, AV_LOG_ERROR,
                    "Stream ends prematurely at %"PRIu64", should be %"PRIu64"\n",
                    s->off, target_end
@@ -1823,6 +1910,9 @@ static int http_write(URLContext *h, const uint8_t *buf, int size)
     char crlf[] = "\r\n";
     HTTPContext *s = h->priv_data;
 
+    if (s->h2)
+        return ff_http2_write(s->h2, s->h2_stream, buf, size);
+
     if (!s->chunked_post) {
         /* non-chunked data is sent without any special encoding */
         return ffurl_write(s->hd, buf, size);
@@ -1842,19 +1932,51 @@ static int http_write(URLContext *h, const uint8_t *buf, int size)
     return size;
 }
 
+/* Read the response of a request whose body was sent, discarding its body. */
+static int http_read_response(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint8_t buf[1024];
+    int ret;
+
+    if ((ret = http_read_header(h)) < 0)
+        return ret;
+    /* without a size, a response kept alive has no body */
+    if (s->http_code == 204 ||
+        (s->chunksize == UINT64_MAX && s->filesize == UINT64_MAX && !s->willclose))
+        return 0;
+    while ((ret = http_buf_read(h, buf, sizeof(buf))) > 0)
+        ;
+    return ret == AVERROR_EOF ? 0 : FFMIN(ret, 0);
+}
+
 static int http_shutdown(URLContext *h, int flags)
 {
     int ret = 0;
     char footer[] = "0\r\n\r\n";
     HTTPContext *s = h->priv_data;
 
+    if (s->h2) {
+        if ((flags & AVIO_FLAG_WRITE) && s->h2_stream) {
+            ret = ff_http2_end_stream(s->h2, s->h2_stream);
+            /* wait for the response, the stream is cancelled when closed */
+            if (ret >= 0 && !(flags & AVIO_FLAG_READ) && !s->end_header)
+                ret = http_read_header(h);
+            s->end_chunked_post = 1;
+        }
+        return ret;
+    }
+
     /* signal end of chunked encoding if used */
     if (((flags & AVIO_FLAG_WRITE) && s->chunked_post) ||
         ((flags & AVIO_FLAG_READ) && s->chunked_post && s->listen)) {
         ret = ffurl_write(s->hd, footer, sizeof(footer) - 1);
         ret = ret > 0 ? 0 : ret;
-        /* flush the receive buffer when it is write only mode */
-        if (!(flags & AVIO_FLAG_READ)) {
+        if (!(flags & AVIO_FLAG_READ) && s->wait_response) {
+            if (ret >= 0)
+                ret = http_read_response(h);
+        } else if (!(flags & AVIO_FLAG_READ)) {
+            /* flush the receive buffer when it is write only mode */
             char buf[1024];
             int read_ret;
             s->hd->flags |= AVIO_FLAG_NONBLOCK;
@@ -1885,8 +2007,7 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
-    if (s->hd)
-        ffurl_closep(&s->hd);
+    http_close_cnx(s);
     av_dict_free(&s->chained_options);
     av_dict_free(&s->cookie_dict);
     av_dict_free(&s->redirect_cache);
@@ -1946,20 +2067,45 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    if (s->h2) {
+        /* open a new stream on the same connection if possible */
+        if (ff_http2_can_open_stream(s->h2)) {
+            s->h2_old_stream = s->h2_stream;
+            s->h2_stream     = 0;
+        } else {
+            http_close_cnx(s);
+        }
+        old_hd = NULL;
+    } else {
+        s->hd = NULL;
+    }
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
         av_dict_free(&options);
+        /* the old stream is lost if its connection was closed */
+        if (!old_hd && !s->h2_old_stream)
+            return ret;
         memcpy(s->buffer, old_buf, old_buf_size);
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
-        s->hd      = old_hd;
+        if (old_hd) {
+            http_close_cnx(s);
+            s->hd = old_hd;
+        } else {
+            s->h2_stream     = s->h2_old_stream;
+            s->h2_old_stream = 0;
+        }
         s->off     = old_off;
         return ret;
     }
     av_dict_free(&options);
-    ffurl_close(old_hd);
+    if (old_hd)
+        ffurl_close(old_hd);
+    if (s->h2_old_stream) {
+        ff_http2_close_stream(s->h2, s->h2_old_stream);
+        s->h2_old_stream = 0;
+    }
     return off;
 }
 
@@ -0,0 +1,793 @@
+/*
+ * HTTP/2 client sessions (RFC 9113)
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/fifo.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+#include "hpack.h"
+#include "http2.h"
+
+#define PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+#define FRAME_HEADER_SIZE   9
+/* the default maximum, which is not raised for the received frames */
+#define MAX_FRAME_SIZE      16384
+#define MAX_HEADER_BLOCK    (256 * 1024)
+#define MAX_STREAMS         8
+#define DEFAULT_WINDOW      65535
+#define STREAM_WINDOW       (1 << 20)
+#define CONNECTION_WINDOW   (MAX_STREAMS * STREAM_WINDOW)
+#define MAX_WINDOW          INT32_MAX
+
+enum FrameType {
+    FRAME_DATA          = 0x0,
+    FRAME_HEADERS       = 0x1,
+    FRAME_PRIORITY      = 0x2,
+    FRAME_RST_STREAM    = 0x3,
+    FRAME_SETTINGS      = 0x4,
+    FRAME_PUSH_PROMISE  = 0x5,
+    FRAME_PING          = 0x6,
+    FRAME_GOAWAY        = 0x7,
+    FRAME_WINDOW_UPDATE = 0x8,
+    FRAME_CONTINUATION  = 0x9,
+};
+
+#define FLAG_END_STREAM     0x01
+#define FLAG_ACK            0x01
+#define FLAG_END_HEADERS    0x04
+#define FLAG_PADDED         0x08
+#define FLAG_PRIORITY       0x20
+
+enum Setting {
+    SETTING_HEADER_TABLE_SIZE      = 0x1,
+    SETTING_ENABLE_PUSH            = 0x2,
+    SETTING_MAX_CONCURRENT_STREAMS = 0x3,
+    SETTING_INITIAL_WINDOW_SIZE    = 0x4,
+    SETTING_MAX_FRAME_SIZE         = 0x5,
+};
+
+enum ErrorCode {
+    ERROR_NO_ERROR          = 0x0,
+    ERROR_PROTOCOL_ERROR    = 0x1,
+    ERROR_FLOW_CONTROL      = 0x3,
+    ERROR_FRAME_SIZE        = 0x6,
+    ERROR_CANCEL            = 0x8,
+    ERROR_COMPRESSION       = 0x9,
+};
+
+typedef struct HTTP2Stream {
+    uint32_t id;
+    int status;                 ///< status of the final response, 0 until received
+    AVBPrint header;            ///< response header, in the HTTP/1.1 syntax
+    AVFifo *data;
+    int64_t send_window;
+    int recv_unacked;           ///< bytes consumed since the last WINDOW_UPDATE
+    int end_stream;             ///< the server closed its side of the stream
+    int sent_end_stream;
+    int error;
+} HTTP2Stream;
+
+struct HTTP2Session {
+    void *logctx;
+    URLContext *hd;
+    HPACKDecoder hpack;
+    HTTP2Stream *streams[MAX_STREAMS];
+    uint32_t next_stream_id;
+
+    int64_t send_window;
+    int64_t recv_unacked;
+    int64_t peer_initial_window;
+    uint32_t peer_max_frame_size;
+    uint32_t peer_max_streams;
+
+    int goaway;
+    int error;                  ///< connection error, the session is unusable
+
+    /* header block being received, split in CONTINUATION frames */
+    uint32_t header_stream;
+    int header_end_stream;
+    AVBPrint header_block;
+
+    uint8_t frame[FRAME_HEADER_SIZE + MAX_FRAME_SIZE];
+    uint8_t out[FRAME_HEADER_SIZE + MAX_FRAME_SIZE];
+};
+
+typedef struct HeaderParser {
+    HTTP2Stream *st;
+    int status;
+    AVBPrint fields;
+} HeaderParser;
+
+static int write_frame(HTTP2Session *s, int type, int flags, uint32_t stream_id,
+                       const uint8_t *payload, int size)
+{
+    int ret;
+
+    av_assert0(size <= MAX_FRAME_SIZE);
+    AV_WB24(s->out,     size);
+    AV_WB8 (s->out + 3, type);
+    AV_WB8 (s->out + 4, flags);
+    AV_WB32(s->out + 5, stream_id);
+    if (size)
+        memcpy(s->out + FRAME_HEADER_SIZE, payload, size);
+
+    ret = ffurl_write(s->hd, s->out, FRAME_HEADER_SIZE + size);
+    if (ret < 0)
+        s->error = ret;
+    return ret < 0 ? ret : 0;
+}
+
+static int write_window_update(HTTP2Session *s, uint32_t stream_id, uint32_t inc)
+{
+    uint8_t payload[4];
+
+    AV_WB32(payload, inc);
+    return write_frame(s, FRAME_WINDOW_UPDATE, 0, stream_id, payload, 4);
+}
+
+static int write_rst_stream(HTTP2Session *s, uint32_t stream_id, uint32_t code)
+{
+    uint8_t payload[4];
+
+    AV_WB32(payload, code);
+    return write_frame(s, FRAME_RST_STREAM, 0, stream_id, payload, 4);
+}
+
+static int connection_error(HTTP2Session *s, uint32_t code, const char *msg)
+{
+    uint8_t payload[8];
+
+    av_log(s->logctx, AV_LOG_ERROR, "HTTP/2 connection error: %s\n", msg);
+    if (!s->error) {
+        /* no stream is initiated by the server */
+        AV_WB32(payload,     0);
+        AV_WB32(payload + 4, code);
+        write_frame(s, FRAME_GOAWAY, 0, 0, payload, 8);
+    }
+    s->error = AVERROR_INVALIDDATA;
+    return s->error;
+}
+
+static HTTP2Stream *find_stream(HTTP2Session *s, uint32_t id)
+{
+    for (int i = 0; i < MAX_STREAMS; i++)
+        if (s->streams[i] && s->streams[i]->id == id)
+            return s->streams[i];
+    return NULL;
+}
+
+static void free_stream(HTTP2Stream **pst)
+{
+    HTTP2Stream *st = *pst;
+
+    av_bprint_finalize(&st->header, NULL);
+    av_fifo_freep2(&st->data);
+    av_freep(pst);
+}
+
+static int strip_padding(HTTP2Session *s, int flags,
+                         const uint8_t **payload, int *size)
+{
+    int pad;
+
+    if (!(flags & FLAG_PADDED))
+        return 0;
+    if (*size < 1 || (pad = **payload) >= *size)
+        return connection_error(s, ERROR_PROTOCOL_ERROR, "invalid padding");
+    (*payload)++;
+    *size -= pad + 1;
+    return 0;
+}
+
+static int header_cb(void *opaque, const char *name, const char *value)
+{
+    HeaderParser *hp = opaque;
+
+    /* the header blocks of the closed streams and the trailers are only
+     * decoded to update the dynamic table */
+    if (!hp->st || hp->st->status)
+        return 0;
+
+    if (name[0] == ':') {
+        if (!strcmp(name, ":status"))
+            hp->status = strtol(value, NULL, 10);
+        return 0;
+    }
+    /* the fields handled by the framing layer in HTTP/1.1 */
+    if (!strcmp(name, "connection") || !strcmp(name, "transfer-encoding"))
+        return 0;
+
+    av_bprintf(&hp->fields, "%s: %s\r\n", name, value);
+    return 0;
+}
+
+static int end_header_block(HTTP2Session *s)
+{
+    HeaderParser hp = { find_stream(s, s->header_stream) };
+    HTTP2Stream *st = hp.st;
+    int ret;
+
+    av_bprint_init(&hp.fields, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ret = ff_hpack_decode(&s->hpack, s->header_block.str, s->header_block.len,
+                          header_cb, &hp);
+    s->header_stream = 0;
+    if (ret < 0) {
+        av_bprint_finalize(&hp.fields, NULL);
+        return connection_error(s, ERROR_COMPRESSION, "invalid header block");
+    }
+
+    if (st && !st->status && (hp.status < 100 || hp.status >= 200)) {
+        if (hp.status < 200 || hp.status > 999) {
+            av_log(s->logctx, AV_LOG_ERROR, "Invalid HTTP/2 response status\n");
+            st->error = AVERROR_INVALIDDATA;
+        } else {
+            st->status = hp.status;
+            av_bprintf(&st->header, "HTTP/2.0 %d\r\n%s\r\n", hp.status,
+                       hp.fields.len ? hp.fields.str : "");
+            if (!av_bprint_is_complete(&st->header))
+                st->error = AVERROR(ENOMEM);
+        }
+    }
+    if (st && s->header_end_stream)
+        st->end_stream = 1;
+
+    av_bprint_finalize(&hp.fields, NULL);
+    return 0;
+}
+
+static int handle_data(HTTP2Session *s, int flags, uint32_t id,
+                       const uint8_t *payload, int size)
+{
+    const int frame_size = size;
+    HTTP2Stream *st;
+    int ret;
+
+    if (!id)
+        return connection_error(s, ERROR_PROTOCOL_ERROR, "DATA on stream 0");
+    if ((ret = strip_padding(s, flags, &payload, &size)) < 0)
+        return ret;
+
+    /* the connection window is credited as soon as the data is received,
+     * the windows of the streams bound the amount of buffered data */
+    s->recv_unacked += frame_size;
+    if (s->recv_unacked >= CONNECTION_WINDOW / 2) {
+        if ((ret = write_window_update(s, 0, s->recv_unacked)) < 0)
+            return ret;
+        s->recv_unacked = 0;
+    }
+
+    st = find_stream(s, id);
+    if (!st || st->end_stream)
+        return 0;
+
+    if (av_fifo_write(st->data, payload, size) < 0)
+        return connection_error(s, ERROR_FLOW_CONTROL, "stream window exceeded");
+    /* the padding is never read */
+    st->recv_unacked += frame_size - size;
+    if (flags & FLAG_END_STREAM)
+        st->end_stream = 1;
+
+    return 0;
+}
+
+static int handle_headers(HTTP2Session *s, int type, int flags, uint32_t id,
+                          const uint8_t *payload, int size)
+{
+    int ret;
+
+    if (type == FRAME_HEADERS) {
+        if (!id)
+            return connection_error(s, ERROR_PROTOCOL_ERROR, "HEADERS on stream 0");
+        if ((ret = strip_padding(s, flags, &payload, &size)) < 0)
+            return ret;
+        if (flags & FLAG_PRIORITY) {
+            if (size < 5)
+                return connection_error(s, ERROR_FRAME_SIZE, "invalid HEADERS");
+            payload += 5;
+            size    -= 5;
+        }
+        s->header_stream     = id;
+        s->header_end_stream = flags & FLAG_END_STREAM;
+        av_bprint_clear(&s->header_block);
+    } else if (id != s->header_stream) {
+        return connection_error(s, ERROR_PROTOCOL_ERROR, "unexpected CONTINUATION");
+    }
+
+    av_bprint_append_data(&s->header_block, (const char *)payload, size);
+    if (s->header_block.len > MAX_HEADER_BLOCK)
+        return connection_error(s, ERROR_PROTOCOL_ERROR, "header block too large");
+    if (!av_bprint_is_complete(&s->header_block))
+        return s->error = AVERROR(ENOMEM);
+
+    return flags & FLAG_END_HEADERS ? end_header_block(s) : 0;
+}
+
+static int handle_settings(HTTP2Session *s, int flags, uint32_t id,
+                           const uint8_t *payload, int size)
+{
+    if (id)
+        return connection_error(s, ERROR_PROTOCOL_ERROR, "SETTINGS on a stream");
+    if (flags & FLAG_ACK)
+        return size ? connection_error(s, ERROR_FRAME_SIZE, "invalid SETTINGS") : 0;
+    if (size % 6)
+        return connection_error(s, ERROR_FRAME_SIZE, "invalid SETTINGS");
+
+    for (int i = 0; i < size; i += 6) {
+        const uint32_t value = AV_RB32(payload + i + 2);
+
+        switch (AV_RB16(payload + i)) {
+        case SETTING_MAX_CONCURRENT_STREAMS:
+            s->peer_max_streams = value;
+            break;
+        case SETTING_INITIAL_WINDOW_SIZE:
+            if (value > MAX_WINDOW)
+                return connection_error(s, ERROR_FLOW_CONTROL, "invalid window size");
+            for (int j = 0; j < MAX_STREAMS; j++)
+                if (s->streams[j])
+                    s->streams[j]->send_window += value - s->peer_initial_window;
+            s->peer_initial_window = value;
+            break;
+        case SETTING_MAX_FRAME_SIZE:
+            if (value < MAX_FRAME_SIZE || value > 0xffffff)
+                return connection_error(s, ERROR_PROTOCOL_ERROR, "invalid frame size");
+            s->peer_max_frame_size = value;
+            break;
+        }
+    }
+
+    return write_frame(s, FRAME_SETTINGS, FLAG_ACK, 0, NULL, 0);
+}
+
+static int handle_window_update(HTTP2Session *s, uint32_t id,
+                                const uint8_t *payload, int size)
+{
+    uint32_t inc;
+    int64_t *window;
+
+    if (size != 4)
+        return connection_error(s, ERROR_FRAME_SIZE, "invalid WINDOW_UPDATE");
+    inc = AV_RB32(payload) & 0x7fffffff;
+
+    if (!id) {
+        window = &s->send_window;
+    } else {
+        HTTP2Stream *st = find_stream(s, id);
+        if (!st)
+            return 0;
+        window = &st->send_window;
+    }
+    if (!inc || *window + inc > MAX_WINDOW)
+        return connection_error(s, ERROR_FLOW_CONTROL, "invalid WINDOW_UPDATE");
+    *window += inc;
+
+    return 0;
+}
+
+static int read_frame(HTTP2Session *s)
+{
+    const uint8_t *payload = s->frame + FRAME_HEADER_SIZE;
+    HTTP2Stream *st;
+    uint32_t id;
+    int ret, size, type, flags;
+
+    if (s->error)
+        return s->error;
+
+    ret = ffurl_read_complete(s->hd, s->frame, FRAME_HEADER_SIZE);
+    if (ret >= 0 && ret < FRAME_HEADER_SIZE)
+        ret = AVERROR_EOF;
+    if (ret < 0)
+        return s->error = ret;
+
+    size  = AV_RB24(s->frame);
+    type  = s->frame[3];
+    flags = s->frame[4];
+    id    = AV_RB32(s->frame + 5) & 0x7fffffff;
+    if (size > MAX_FRAME_SIZE)
+        return connection_error(s, ERROR_FRAME_SIZE, "frame too large");
+
+    ret = ffurl_read_complete(s->hd, s->frame + FRAME_HEADER_SIZE, size);
+    if (ret >= 0 && ret < size)
+        ret = AVERROR_EOF;
+    if (ret < 0)
+        return s->error = ret;
+
+    /* a header block must not be interleaved with other frames */
+    if (s->header_stream && type != FRAME_CONTINUATION)
+        return connection_error(s, ERROR_PROTOCOL_ERROR, "unterminated header block");
+
+    switch (type) {
+    case FRAME_DATA:
+        return handle_data(s, flags, id, payload, size);
+    case FRAME_HEADERS:
+    case FRAME_CONTINUATION:
+        return handle_headers(s, type, flags, id, payload, size);
+    case FRAME_RST_STREAM:
+        if (size != 4)
+            return connection_error(s, ERROR_FRAME_SIZE, "invalid RST_STREAM");
+        if ((st = find_stream(s, id)) && !st->end_stream) {
+            const uint32_t code = AV_RB32(payload);
+            /* a complete response may be followed by a reset of the
+             * request that is no longer needed */
+            if (code == ERROR_NO_ERROR && st->status) {
+                st->end_stream = 1;
+            } else {
+                av_log(s->logctx, AV_LOG_ERROR,
+                       "HTTP/2 stream reset with error code %"PRIu32"\n", code);
+                st->error = AVERROR(EIO);
+            }
+        }
+        return 0;
+    case FRAME_SETTINGS:
+        return handle_settings(s, flags, id, payload, size);
+    case FRAME_PUSH_PROMISE:
+        /* disabled by the settings */
+        return connection_error(s, ERROR_PROTOCOL_ERROR, "unexpected PUSH_PROMISE");
+    case FRAME_PING:
+        if (id || size != 8)
+            return connection_error(s, ERROR_FRAME_SIZE, "invalid PING");
+        if (flags & FLAG_ACK)
+            return 0;
+        return write_frame(s, FRAME_PING, FLAG_ACK, 0, payload, size);
+    case FRAME_GOAWAY:
+        if (id || size < 8)
+            return connection_error(s, ERROR_FRAME_SIZE, "invalid GOAWAY");
+        s->goaway = 1;
+        if (AV_RB32(payload + 4) != ERROR_NO_ERROR)
+            av_log(s->logctx, AV_LOG_WARNING,
+                   "HTTP/2 connection shut down with error code %"PRIu32"\n",
+                   AV_RB32(payload + 4));
+        for (int i = 0; i < MAX_STREAMS; i++) {
+            st = s->streams[i];
+            if (st && st->id > (AV_RB32(payload) & 0x7fffffff) && !st->end_stream)
+                st->error = AVERROR(EIO);
+        }
+        return 0;
+    case FRAME_WINDOW_UPDATE:
+        return handle_window_update(s, id, payload, size);
+    default:
+        /* PRIORITY and the unknown frame types are ignored */
+        return 0;
+    }
+}
+
+int ff_http2_open(HTTP2Session **ps, URLContext *hd, void *logctx)
+{
+    HTTP2Session *s;
+    uint8_t settings[12];
+    int ret;
+
+    s = av_mallocz(sizeof(*s));
+    if (!s)
+        return AVERROR(ENOMEM);
+    s->logctx              = logctx;
+    s->hd                  = hd;
+    s->next_stream_id      = 1;
+    s->send_window         = DEFAULT_WINDOW;
+    s->peer_initial_window = DEFAULT_WINDOW;
+    s->peer_max_frame_size = MAX_FRAME_SIZE;
+    s->peer_max_streams    = UINT32_MAX;
+    ff_hpack_decoder_init(&s->hpack, HPACK_DEFAULT_TABLE_SIZE);
+    av_bprint_init(&s->header_block, 0, AV_BPRINT_SIZE_UNLIMITED);
+
+    AV_WB16(settings,      SETTING_ENABLE_PUSH);
+    AV_WB32(settings + 2,  0);
+    AV_WB16(settings + 6,  SETTING_INITIAL_WINDOW_SIZE);
+    AV_WB32(settings + 8,  STREAM_WINDOW);
+
+    if ((ret = ffurl_write(hd, PREFACE, strlen(PREFACE))) < 0 ||
+        (ret = write_frame(s, FRAME_SETTINGS, 0, 0, settings, sizeof(settings))) < 0 ||
+        (ret = write_window_update(s, 0, CONNECTION_WINDOW - DEFAULT_WINDOW)) < 0) {
+        ff_http2_close(&s);
+        return ret;
+    }
+
+    *ps = s;
+    return 0;
+}
+
+void ff_http2_close(HTTP2Session **ps)
+{
+    HTTP2Session *s = *ps;
+
+    if (!s)
+        return;
+
+    if (!s->error) {
+        uint8_t payload[8] = { 0 };
+        write_frame(s, FRAME_GOAWAY, 0, 0, payload, sizeof(payload));
+    }
+    for (int i = 0; i < MAX_STREAMS; i++)
+        if (s->streams[i])
+            free_stream(&s->streams[i]);
+    ff_hpack_decoder_uninit(&s->hpack);
+    av_bprint_finalize(&s->header_block, NULL);
+    av_freep(ps);
+}
+
+int ff_http2_can_open_stream(HTTP2Session *s)
+{
+    return !s->error && !s->goaway && s->next_stream_id <= 0x7fffffff;
+}
+
+/* the connection-specific fields of HTTP/1.1, which are not allowed */
+static int is_connection_field(const char *name)
+{
+    static const char *const fields[] = {
+        "connection", "keep-alive", "proxy-connection", "transfer-encoding",
+        "upgrade", "host", "expect",
+    };
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(fields); i++)
+        if (!strcmp(name, fields[i]))
+            return 1;
+    return 0;
+}
+
+static int encode_request(AVBPrint *bp, const char *request, const char *scheme)
+{
+    const char *line = request, *eol, *host;
+    char *method, *path;
+    int ret = 0;
+
+    eol = strstr(line, "\r\n");
+    if (!eol)
+        return AVERROR(EINVAL);
+    method = av_strndup(line, strcspn(line, " "));
+    line  += strcspn(line, " ");
+    line  += strspn(line, " ");
+    path   = av_strndup(line, strcspn(line, " \r"));
+    if (!method || !path) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ff_hpack_encode(bp, ":method", method);
+    ff_hpack_encode(bp, ":scheme", scheme);
+    if ((host = av_stristr(eol, "\r\nHost: "))) {
+        char *authority;
+
+        host += strlen("\r\nHost: ");
+        if (!(authority = av_strndup(host, strcspn(host, "\r\n")))) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ff_hpack_encode(bp, ":authority", authority);
+        av_free(authority);
+    }
+    ff_hpack_encode(bp, ":path", path);
+
+    for (line = eol + 2; (eol = strstr(line, "\r\n")) && eol > line; line = eol + 2) {
+        const char *colon = memchr(line, ':', eol - line);
+        char *name, *value;
+
+        if (!colon)
+            continue;
+        name  = av_strndup(line, colon - line);
+        colon++;
+        colon += strspn(colon, " \t");
+        value = av_strndup(colon, eol - colon);
+        if (!name || !value) {
+            av_free(name);
+            av_free(value);
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+
+        /* the field names are lowercase in HTTP/2 */
+        for (char *p = name; *p; p++)
+            *p = av_tolower(*p);
+        if (!is_connection_field(name))
+            ff_hpack_encode(bp, name, value);
+        av_free(name);
+        av_free(value);
+    }
+
+    if (!av_bprint_is_complete(bp))
+        ret = AVERROR(ENOMEM);
+end:
+    av_free(method);
+    av_free(path);
+    return ret;
+}
+
+int ff_http2_send_request(HTTP2Session *s, const char *request,
+                          const char *scheme, int end_stream)
+{
+    HTTP2Stream *st;
+    AVBPrint block;
+    int slot = -1, nb_streams = 0, ret;
+
+    if (s->error)
+        return s->error;
+    if (!ff_http2_can_open_stream(s))
+        return AVERROR_EOF;
+
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (s->streams[i])
+            nb_streams++;
+        else if (slot < 0)
+            slot = i;
+    }
+    if (slot < 0 || nb_streams >= s->peer_max_streams)
+        return AVERROR(EAGAIN);
+
+    av_bprint_init(&block, 0, AV_BPRINT_SIZE_UNLIMITED);
+    if ((ret = encode_request(&block, request, scheme)) < 0)
+        goto end;
+
+    st = av_mallocz(sizeof(*st));
+    if (!st) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    av_bprint_init(&st->header, 0, AV_BPRINT_SIZE_UNLIMITED);
+    st->data = av_fifo_alloc2(MAX_FRAME_SIZE, 1, AV_FIFO_FLAG_AUTO_GROW);
+    if (!st->data) {
+        free_stream(&st);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    av_fifo_auto_grow_limit(st->data, STREAM_WINDOW);
+    st->id              = s->next_stream_id;
+    st->send_window     = s->peer_initial_window;
+    st->sent_end_stream = end_stream;
+    s->next_stream_id  += 2;
+    s->streams[slot]    = st;
+
+    /* the block is split in a HEADERS frame and CONTINUATION frames */
+    for (unsigned pos = 0; !pos || pos < block.len; ) {
+        const int size  = FFMIN(block.len - pos, MAX_FRAME_SIZE);
+        const int last  = pos + size == block.len;
+        const int flags = (last ? FLAG_END_HEADERS : 0) |
+                          (!pos && end_stream ? FLAG_END_STREAM : 0);
+
+        ret = write_frame(s, pos ? FRAME_CONTINUATION : FRAME_HEADERS, flags,
+                          st->id, block.str + pos, size);
+        if (ret < 0)
+            goto end;
+        pos += size;
+    }
+    ret = st->id;
+
+end:
+    av_bprint_finalize(&block, NULL);
+    return ret;
+}
+
+int ff_http2_read_response(HTTP2Session *s, int stream_id, char *buf, int size)
+{
+    HTTP2Stream *st = find_stream(s, stream_id);
+    int ret;
+
+    if (!st)
+        return AVERROR(EINVAL);
+
+    while (!st->status) {
+        if (st->error)
+            return st->error;
+        if (st->end_stream)
+            return AVERROR_INVALIDDATA;
+        if ((ret = read_frame(s)) < 0)
+            return ret;
+    }
+
+    if (st->header.len >= size) {
+        av_log(s->logctx, AV_LOG_ERROR, "HTTP/2 response header too large\n");
+        return AVERROR(EINVAL);
+    }
+    memcpy(buf, st->header.str, st->header.len + 1);
+
+    return st->header.len;
+}
+
+int ff_http2_read(HTTP2Session *s, int stream_id, uint8_t *buf, int size)
+{
+    HTTP2Stream *st = find_stream(s, stream_id);
+    int ret;
+
+    if (!st)
+        return AVERROR(EINVAL);
+
+    while (!av_fifo_can_read(st->data)) {
+        if (st->error)
+            return st->error;
+        if (st->end_stream)
+            return AVERROR_EOF;
+        if ((ret = read_frame(s)) < 0)
+            return ret;
+    }
+
+    size = FFMIN(size, av_fifo_can_read(st->data));
+    av_fifo_read(st->data, buf, size);
+
+    st->recv_unacked += size;
+    if (st->recv_unacked >= STREAM_WINDOW / 2 && !st->end_stream) {
+        if ((ret = write_window_update(s, st->id, st->recv_unacked)) < 0)
+            return ret;
+        st->recv_unacked = 0;
+    }
+
+    return size;
+}
+
+int ff_http2_write(HTTP2Session *s, int stream_id, const uint8_t *buf, int size)
+{
+    HTTP2Stream *st = find_stream(s, stream_id);
+    int pos = 0, ret;
+
+    if (!st || st->sent_end_stream)
+        return AVERROR(EINVAL);
+
+    while (pos < size) {
+        int len;
+
+        while (s->send_window <= 0 || st->send_window <= 0) {
+            if (st->error)
+                return st->error;
+            if ((ret = read_frame(s)) < 0)
+                return ret;
+        }
+        if (st->error)
+            return st->error;
+
+        len = FFMIN3(size - pos, s->send_window, st->send_window);
+        len = FFMIN3(len, s->peer_max_frame_size, MAX_FRAME_SIZE);
+        if ((ret = write_frame(s, FRAME_DATA, 0, st->id, buf + pos, len)) < 0)
+            return ret;
+        s->send_window  -= len;
+        st->send_window -= len;
+        pos += len;
+    }
+
+    return size;
+}
+
+int ff_http2_end_stream(HTTP2Session *s, int stream_id)
+{
+    HTTP2Stream *st = find_stream(s, stream_id);
+
+    if (!st)
+        return AVERROR(EINVAL);
+    if (st->sent_end_stream)
+        return 0;
+
+    st->sent_end_stream = 1;
+    return write_frame(s, FRAME_DATA, FLAG_END_STREAM, st->id, NULL, 0);
+}
+
+void ff_http2_close_stream(HTTP2Session *s, int stream_id)
+{
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        HTTP2Stream *st = s->streams[i];
+
+        if (!st || st->id != stream_id)
+            continue;
+        if (!s->error && !st->error && !(st->end_stream && st->sent_end_stream))
+            write_rst_stream(s, st->id, ERROR_CANCEL);
+        free_stream(&s->streams[i]);
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ * HTTP/2 client sessions (RFC 9113)
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_HTTP2_H
+#define AVFORMAT_HTTP2_H
+
+#include <stdint.h>
+
+#include "url.h"
+
+/**
+ * An HTTP/2 connection, multiplexing several request streams.
+ *
+ * The frames are read when a stream waits for data, the ones of the other
+ * streams being buffered, so all the streams of a session must be used from
+ * the same thread.
+ */
+typedef struct HTTP2Session HTTP2Session;
+
+/**
+ * Start a session on an open connection, by sending the connection preface.
+ */
+int ff_http2_open(HTTP2Session **s, URLContext *hd, void *logctx);
+
+/**
+ * Free the session and its streams, the connection is not closed.
+ */
+void ff_http2_close(HTTP2Session **s);
+
+/**
+ * @return 1 if new streams can be opened, 0 if the session is in error or
+ *         was shut down by the server
+ */
+int ff_http2_can_open_stream(HTTP2Session *s);
+
+/**
+ * Send a request on a new stream.
+ *
+ * @param request    request in the HTTP/1.1 syntax: request line, header
+ *                   fields and empty line, which are converted to HTTP/2
+ *                   header fields
+ * @param end_stream 1 if the request has no body
+ * @return the id of the stream, or a negative error code
+ */
+int ff_http2_send_request(HTTP2Session *s, const char *request,
+                          const char *scheme, int end_stream);
+
+/**
+ * Wait for the response header of a stream, skipping the informational
+ * responses, and write it in the HTTP/1.1 syntax: status line, header fields
+ * and empty line.
+ *
+ * @return the size of the header, or a negative error code
+ */
+int ff_http2_read_response(HTTP2Session *s, int stream_id, char *buf, int size);
+
+/**
+ * Read the body of a response.
+ *
+ * @return the number of bytes read, AVERROR_EOF at the end of the stream
+ */
+int ff_http2_read(HTTP2Session *s, int stream_id, uint8_t *buf, int size);
+
+/**
+ * Send the body of a request.
+ */
+int ff_http2_write(HTTP2Session *s, int stream_id, const uint8_t *buf, int size);
+
+/**
+ * Signal the end of the body of a request.
+ */
+int ff_http2_end_stream(HTTP2Session *s, int stream_id);
+
+/**
+ * Free a stream, cancelling it if it is not complete.
+ */
+void ff_http2_close_stream(HTTP2Session *s, int stream_id);
+
+#endif /* AVFORMAT_HTTP2_H */
@@ -357,15 +357,57 @@ static IMFAssetLocator *find_asset_map_locator(IMFAssetLocatorMap *asset_map, AV
     return NULL;
 }
 
+/**
+ * Position the input context of a resource at the current timestamp of
+ * its virtual track. Unless force is set, no seek is done when reading
+ * from the start of the Track File.
+ */
+static int seek_track_resource_context(AVFormatContext *s,
+                                       IMFVirtualTrackPlaybackCtx *track,
+                                       IMFVirtualTrackResourcePlaybackCtx *track_resource,
+                                       int force)
+{
+    int ret;
+    int64_t seek_offset = 0;
+    AVStream *st = track_resource->ctx->streams[0];
+
+    /* Determine the seek offset into the Track File, taking into account:
+     * - the current timestamp within the virtual track
+     * - the entry point of the resource
+     */
+    if (imf_time_to_ts(&seek_offset,
+                       av_sub_q(track->current_timestamp, track_resource->ts_offset),
+                       st->time_base))
+        av_log(s, AV_LOG_WARNING, "Incoherent stream timebase " AVRATIONAL_FORMAT
+               "and composition timeline position: " AVRATIONAL_FORMAT "\n",
+               AVRATIONAL_ARG(st->time_base), AVRATIONAL_ARG(track->current_timestamp));
+
+    if (seek_offset || force) {
+        av_log(s, AV_LOG_DEBUG, "Seek at resource %s entry point: %" PRIi64 "\n",
+               track_resource->locator->absolute_uri, seek_offset);
+        ret = avformat_seek_file(track_resource->ctx, 0, seek_offset, seek_offset, seek_offset, 0);
+        if (ret < 0) {
+            av_log(s,
+                   AV_LOG_ERROR,
+                   "Could not seek at %" PRId64 "on %s: %s\n",
+                   seek_offset,
+                   track_resource->locator->absolute_uri,
+                   av_err2str(ret));
+            avformat_close_input(&track_resource->ctx);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
 static int open_track_resource_context(AVFormatContext *s,
                                        IMFVirtualTrackPlaybackCtx *track,
                                        int32_t resource_index)
 {
     IMFContext *c = s->priv_data;
     int ret = 0;
-    int64_t seek_offset = 0;
     AVDictionary *opts = NULL;
-    AVStream *st;
     IMFVirtualTrackResourcePlaybackCtx *track_resource = track->resources + resource_index;
 
     if (track_resource->ctx) {
@@ -410,36 +452,7 @@ static int open_track_resource_context(AVFormatContext *s,
         goto cleanup;
     }
 
-    st = track_resource->ctx->streams[0];
-
-    /* Determine the seek offset into the Track File, taking into account:
-     * - the current timestamp within the virtual track
-     * - the entry point of the resource
-     */
-    if (imf_time_to_ts(&seek_offset,
-                       av_sub_q(track->current_timestamp, track_resource->ts_offset),
-                       st->time_base))
-        av_log(s, AV_LOG_WARNING, "Incoherent stream timebase " AVRATIONAL_FORMAT
-               "and composition timeline position: " AVRATIONAL_FORMAT "\n",
-               AVRATIONAL_ARG(st->time_base), AVRATIONAL_ARG(track->current_timestamp));
-
-    if (seek_offset) {
-        av_log(s, AV_LOG_DEBUG, "Seek at resource %s entry point: %" PRIi64 "\n",
-               track_resource->locator->absolute_uri, seek_offset);
-        ret = avformat_seek_file(track_resource->ctx, 0, seek_offset, seek_offset, seek_offset, 0);
-        if (ret < 0) {
-            av_log(s,
-                   AV_LOG_ERROR,
-                   "Could not seek at %" PRId64 "on %s: %s\n",
-                   seek_offset,
-                   track_resource->locator->absolute_uri,
-                   av_err2str(ret));
-            avformat_close_input(&track_resource->ctx);
-            return ret;
-        }
-    }
-
-    return 0;
+    return seek_track_resource_context(s, track, track_resource, 0);
 
 cleanup:
     av_dict_free(&opts);
@@ -745,16 +758,33 @@ static int get_resource_context_for_timestamp(AVFormatContext *s, IMFVirtualTrac
                    AVRATIONAL_ARG(track->resources[i].resource->base.edit_rate));
 
             if (track->current_resource_index != i) {
+                IMFVirtualTrackResourcePlaybackCtx *cur = NULL;
                 int ret;
 
-                av_log(s, AV_LOG_TRACE, "Switch resource on track %d: re-open context\n",
-                       track->index);
+                if (track->current_resource_index >= 0)
+                    cur = track->resources + track->current_resource_index;
 
-                ret = open_track_resource_context(s, track, i);
+                if (cur && cur->ctx && !track->resources[i].ctx &&
+                    cur->locator == track->resources[i].locator) {
+                    /* Consecutive resources referencing the same Track File,
+                     * e.g. from a RepeatCount: reuse the input context instead
+                     * of opening and probing the file again. */
+                    av_log(s, AV_LOG_TRACE, "Switch resource on track %d: reuse context\n",
+                           track->index);
+
+                    track->resources[i].ctx = cur->ctx;
+                    cur->ctx = NULL;
+                    ret = seek_track_resource_context(s, track, track->resources + i, 1);
+                } else {
+                    av_log(s, AV_LOG_TRACE, "Switch resource on track %d: re-open context\n",
+                           track->index);
+
+                    ret = open_track_resource_context(s, track, i);
+                }
                 if (ret != 0)
                     return ret;
-                if (track->current_resource_index > 0)
-                    avformat_close_input(&track->resources[track->current_resource_index].ctx);
+                if (cur)
+                    avformat_close_input(&cur->ctx);
                 track->current_resource_index = i;
             }
 
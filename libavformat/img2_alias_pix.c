@@ -68,6 +68,7 @@ const AVInputFormat ff_image2_alias_pix_demuxer = {
     .read_probe     = alias_pix_read_probe,
     .read_header    = ff_img_read_header,
     .read_packet    = ff_img_read_packet,
+    .read_close     = ff_img_read_close,
     .raw_codec_id   = AV_CODEC_ID_ALIAS_PIX,
     .priv_class     = &image2_alias_pix_class,
 };
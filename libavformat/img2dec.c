@@ -31,6 +31,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
 #include "libavcodec/gif.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -54,6 +55,38 @@
 
 #endif /* HAVE_GLOB */
 
+#if HAVE_THREADS
+enum PrefetchState {
+    PREFETCH_FREE,
+    PREFETCH_QUEUED,
+    PREFETCH_BUSY,
+    PREFETCH_DONE,
+};
+
+typedef struct PrefetchSlot {
+    enum PrefetchState state;
+    int img_number;
+    AVBufferRef *buf;
+    int size;
+    int err;
+} PrefetchSlot;
+
+/**
+ * Reader threads loading the next files of the sequence while the
+ * previous ones are demuxed and decoded.
+ * File img_number is loaded into slots[img_number % nb_slots].
+ */
+typedef struct ImgPrefetch {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t *threads;
+    int nb_threads;
+    PrefetchSlot *slots;
+    int nb_slots;
+    int exit;
+} ImgPrefetch;
+#endif
+
 static const int sizes[][2] = {
     { 640, 480 },
     { 720, 480 },
@@ -406,6 +439,221 @@ static int add_filename_as_pkt_side_data(char *filename, AVPacket *pkt) {
     return 0;
 }
 
+/**
+ * Get the name of the file img_number of the sequence.
+ * It is either written to buf or points to the glob results.
+ */
+static int get_img_filename(VideoDemuxData *s, int img_number,
+                            char *buf, int buf_size, char **filename)
+{
+    *filename = buf;
+    if (s->pattern_type == PT_NONE) {
+        av_strlcpy(buf, s->path, buf_size);
+    } else if (s->use_glob) {
+#if HAVE_GLOB
+        *filename = s->globstate.gl_pathv[img_number];
+#endif
+    } else {
+        if (av_get_frame_filename(buf, buf_size, s->path, img_number) < 0 &&
+            img_number > 1)
+            return AVERROR(EIO);
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+static int prefetch_read_file(AVFormatContext *s1, int img_number,
+                              AVBufferRef **pbuf, int *psize)
+{
+    VideoDemuxData *s = s1->priv_data;
+    char filename_bytes[1024];
+    char *filename;
+    AVIOContext *pb = NULL;
+    AVBufferRef *buf;
+    int64_t size;
+    int ret;
+
+    if (get_img_filename(s, img_number, filename_bytes, sizeof(filename_bytes),
+                         &filename) < 0)
+        return AVERROR(EIO);
+    if (s1->io_open(s1, &pb, filename, AVIO_FLAG_READ, NULL) < 0) {
+        av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n", filename);
+        return AVERROR(EIO);
+    }
+
+    size = avio_size(pb);
+    if (size < 0 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        ret = size < 0 ? size : AVERROR(ERANGE);
+        goto end;
+    }
+    buf = av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!buf) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avio_read(pb, buf->data, size);
+    if (ret <= 0) {
+        av_buffer_unref(&buf);
+        if (!ret)
+            ret = AVERROR_EOF;
+        goto end;
+    }
+    memset(buf->data + ret, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    *pbuf  = buf;
+    *psize = ret;
+    ret = 0;
+end:
+    ff_format_io_close(s1, &pb);
+    return ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    AVFormatContext *s1 = arg;
+    VideoDemuxData *s = s1->priv_data;
+    ImgPrefetch *pf = s->prefetch_ctx;
+
+    pthread_mutex_lock(&pf->lock);
+    while (!pf->exit) {
+        PrefetchSlot *slot = NULL;
+        AVBufferRef *buf = NULL;
+        int img_number, size = 0, err;
+
+        /* load the files in sequence order */
+        for (int i = 0; i < pf->nb_slots; i++) {
+            PrefetchSlot *cur = &pf->slots[i];
+            if (cur->state == PREFETCH_QUEUED &&
+                (!slot || cur->img_number < slot->img_number))
+                slot = cur;
+        }
+        if (!slot) {
+            pthread_cond_wait(&pf->cond, &pf->lock);
+            continue;
+        }
+
+        slot->state = PREFETCH_BUSY;
+        img_number  = slot->img_number;
+        pthread_mutex_unlock(&pf->lock);
+
+        err = prefetch_read_file(s1, img_number, &buf, &size);
+
+        pthread_mutex_lock(&pf->lock);
+        slot->buf   = buf;
+        slot->size  = size;
+        slot->err   = err;
+        slot->state = PREFETCH_DONE;
+        pthread_cond_broadcast(&pf->cond);
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+static void prefetch_uninit(VideoDemuxData *s)
+{
+    ImgPrefetch *pf = s->prefetch_ctx;
+
+    if (!pf)
+        return;
+
+    pthread_mutex_lock(&pf->lock);
+    pf->exit = 1;
+    pthread_cond_broadcast(&pf->cond);
+    pthread_mutex_unlock(&pf->lock);
+    for (int i = 0; i < pf->nb_threads; i++)
+        pthread_join(pf->threads[i], NULL);
+
+    for (int i = 0; i < pf->nb_slots; i++)
+        av_buffer_unref(&pf->slots[i].buf);
+    av_freep(&pf->slots);
+    av_freep(&pf->threads);
+    pthread_cond_destroy(&pf->cond);
+    pthread_mutex_destroy(&pf->lock);
+    av_freep(&s->prefetch_ctx);
+}
+
+static int prefetch_init(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgPrefetch *pf;
+    int ret;
+
+    pf = s->prefetch_ctx = av_mallocz(sizeof(*pf));
+    if (!pf)
+        return AVERROR(ENOMEM);
+
+    if ((ret = pthread_mutex_init(&pf->lock, NULL))) {
+        av_freep(&s->prefetch_ctx);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pf->cond, NULL))) {
+        pthread_mutex_destroy(&pf->lock);
+        av_freep(&s->prefetch_ctx);
+        return AVERROR(ret);
+    }
+
+    pf->slots   = av_calloc(s->prefetch, sizeof(*pf->slots));
+    pf->threads = av_calloc(s->prefetch, sizeof(*pf->threads));
+    if (!pf->slots || !pf->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    pf->nb_slots = s->prefetch;
+
+    for (int i = 0; i < s->prefetch; i++) {
+        ret = pthread_create(&pf->threads[i], NULL, prefetch_thread, s1);
+        if (ret) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        pf->nb_threads++;
+    }
+    return 0;
+fail:
+    prefetch_uninit(s);
+    return ret;
+}
+
+/**
+ * Get the content of the file img_number, queueing the reads of the
+ * following files.
+ */
+static int prefetch_get(AVFormatContext *s1, int img_number,
+                        AVBufferRef **buf, int *size)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgPrefetch *pf = s->prefetch_ctx;
+    PrefetchSlot *slot = &pf->slots[img_number % pf->nb_slots];
+    int ret;
+
+    pthread_mutex_lock(&pf->lock);
+    while (1) {
+        for (int n = img_number; n < img_number + pf->nb_slots && n <= s->img_last; n++) {
+            PrefetchSlot *next = &pf->slots[n % pf->nb_slots];
+
+            /* files from before a seek or loop are discarded */
+            if (next->img_number == n && next->state != PREFETCH_FREE ||
+                next->state == PREFETCH_BUSY)
+                continue;
+            av_buffer_unref(&next->buf);
+            next->img_number = n;
+            next->state      = PREFETCH_QUEUED;
+            pthread_cond_broadcast(&pf->cond);
+        }
+        if (slot->img_number == img_number && slot->state == PREFETCH_DONE)
+            break;
+        pthread_cond_wait(&pf->cond, &pf->lock);
+    }
+
+    *buf = slot->buf;
+    *size = slot->size;
+    ret = slot->err;
+    slot->buf   = NULL;
+    slot->state = PREFETCH_FREE;
+    pthread_mutex_unlock(&pf->lock);
+    return ret;
+}
+#endif
+
 int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
 {
     VideoDemuxData *s = s1->priv_data;
@@ -414,6 +662,7 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     int i, res;
     int size[3]           = { 0 }, ret[3] = { 0 };
     AVIOContext *f[3]     = { NULL };
+    AVBufferRef *prefetched = NULL;
     AVCodecParameters *par = s1->streams[0]->codecpar;
 
     if (!s->is_pipe) {
@@ -423,18 +672,18 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
         if (s->img_number > s->img_last)
             return AVERROR_EOF;
-        if (s->pattern_type == PT_NONE) {
-            av_strlcpy(filename_bytes, s->path, sizeof(filename_bytes));
-        } else if (s->use_glob) {
-#if HAVE_GLOB
-            filename = s->globstate.gl_pathv[s->img_number];
-#endif
-        } else {
-        if (av_get_frame_filename(filename_bytes, sizeof(filename_bytes),
-                                  s->path,
-                                  s->img_number) < 0 && s->img_number > 1)
+        if (get_img_filename(s, s->img_number, filename_bytes,
+                             sizeof(filename_bytes), &filename) < 0)
             return AVERROR(EIO);
-        }
+#if HAVE_THREADS
+        if (s->prefetch && !s1->pb && !s->split_planes && s->pattern_type != PT_NONE) {
+            if (!s->prefetch_ctx && (res = prefetch_init(s1)) < 0)
+                return res;
+            res = prefetch_get(s1, s->img_number, &prefetched, &size[0]);
+            if (res < 0)
+                return res;
+        } else
+#endif
         for (i = 0; i < 3; i++) {
             if (s1->pb &&
                 !strcmp(filename_bytes, s->path) &&
@@ -462,11 +711,16 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
             int ret;
             int score = 0;
 
-            ret = avio_read(f[0], header, PROBE_BUF_MIN);
-            if (ret < 0)
-                return ret;
+            if (prefetched) {
+                ret = FFMIN(size[0], PROBE_BUF_MIN);
+                memcpy(header, prefetched->data, ret);
+            } else {
+                ret = avio_read(f[0], header, PROBE_BUF_MIN);
+                if (ret < 0)
+                    return ret;
+                avio_skip(f[0], -ret);
+            }
             memset(header + ret, 0, sizeof(header) - ret);
-            avio_skip(f[0], -ret);
             pd.buf = header;
             pd.buf_size = ret;
             pd.filename = filename;
@@ -493,9 +747,15 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
     }
 
-    res = av_new_packet(pkt, size[0] + size[1] + size[2]);
-    if (res < 0) {
-        goto fail;
+    if (prefetched) {
+        pkt->buf  = prefetched;
+        pkt->data = prefetched->data;
+        pkt->size = size[0];
+    } else {
+        res = av_new_packet(pkt, size[0] + size[1] + size[2]);
+        if (res < 0) {
+            goto fail;
+        }
     }
     pkt->stream_index = 0;
     pkt->flags       |= AV_PKT_FLAG_KEY;
@@ -529,7 +789,10 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
             goto fail;
     }
 
-    pkt->size = 0;
+    if (prefetched)
+        ret[0] = pkt->size;
+    else
+        pkt->size = 0;
     for (i = 0; i < 3; i++) {
         if (f[i]) {
             ret[i] = avio_read(f[i], pkt->data + pkt->size, size[i]);
@@ -574,10 +837,13 @@ fail:
     return res;
 }
 
-static int img_read_close(struct AVFormatContext* s1)
+int ff_img_read_close(AVFormatContext *s1)
 {
-#if HAVE_GLOB
     VideoDemuxData *s = s1->priv_data;
+#if HAVE_THREADS
+    prefetch_uninit(s);
+#endif
+#if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
     }
@@ -628,6 +894,7 @@ const AVOption ff_img_options[] = {
     { "sec",  "second precision",       0, AV_OPT_TYPE_CONST,    {.i64 = 1   }, 0, 2,       DEC, "ts_type" },
     { "ns",   "nano second precision",  0, AV_OPT_TYPE_CONST,    {.i64 = 2   }, 0, 2,       DEC, "ts_type" },
     { "export_path_metadata", "enable metadata containing input path information", OFFSET(export_path_metadata), AV_OPT_TYPE_BOOL,   {.i64 = 0   }, 0, 1,       DEC }, \
+    { "prefetch",     "number of files to read ahead in parallel", OFFSET(prefetch), AV_OPT_TYPE_INT,  {.i64 = 0   }, 0, 64,      DEC },
     COMMON_OPTIONS
 };
 
@@ -644,7 +911,7 @@ const AVInputFormat ff_image2_demuxer = {
     .read_probe     = img_read_probe,
     .read_header    = ff_img_read_header,
     .read_packet    = ff_img_read_packet,
-    .read_close     = img_read_close,
+    .read_close     = ff_img_read_close,
     .read_seek      = img_read_seek,
     .flags          = AVFMT_NOFILE,
     .priv_class     = &img2_class,
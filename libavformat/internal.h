@@ -97,6 +97,29 @@ typedef struct FFFormatContext {
     int (*interleave_packet)(struct AVFormatContext *s, AVPacket *pkt,
                              int flush, int has_packet);
 
+    /**
+     * If set, ff_interleave_packet_per_dts() buffers packets in the
+     * per-stream FFStream.interleave_queue instead of packet_buffer and
+     * merges them through interleave_heap.
+     * Muxing only.
+     */
+    int interleave_per_stream;
+
+    /**
+     * Binary min-heap of the indices of the streams with packets in their
+     * interleave_queue, ordered by the first packet of each queue.
+     */
+    unsigned *interleave_heap;
+    unsigned nb_interleave_heap;
+
+    /**
+     * Number of streams that max_interleave_delta may skip while they have
+     * no queued packets (all but attachments, VP8 and VP9), and how many of
+     * them currently have packets in their interleave_queue.
+     */
+    unsigned nb_interleave_skippable;
+    unsigned nb_interleave_skippable_queued;
+
     /**
      * This buffer is only needed when packets were already buffered but
      * not decoded, for example to get the codec parameters in MPEG
@@ -133,6 +156,13 @@ typedef struct FFFormatContext {
      */
     AVPacket *parse_pkt;
 
+    /**
+     * Context running the parsers of several streams in parallel,
+     * see AVFormatContext.parse_threads.
+     */
+    struct ParseThreadContext *parse_thread;
+    int parse_thread_inited;
+
     /**
      * Used to hold temporary packets for the generic demuxing code.
      * When muxing, it may be used by muxers to hold packets (even
@@ -253,6 +283,21 @@ typedef struct FFStream {
     int nb_index_entries;
     unsigned int index_entries_allocated_size;
 
+    /**
+     * Directory of the index used by av_index_search_timestamp():
+     * index_dir[i] is the first entry with a timestamp of at least
+     * index_dir_start + i * index_dir_step. It covers the first
+     * index_dir_nb_entries entries, the last one having the timestamp
+     * index_dir_last_ts, and is unusable if nb_index_dir is 0.
+     */
+    int *index_dir;
+    unsigned int index_dir_allocated_size;
+    int nb_index_dir;
+    int index_dir_nb_entries;
+    int64_t index_dir_start;
+    int64_t index_dir_step;
+    int64_t index_dir_last_ts;
+
     int64_t interleaver_chunk_size;
     int64_t interleaver_chunk_duration;
 
@@ -374,6 +419,12 @@ typedef struct FFStream {
      */
     PacketListEntry *last_in_packet_buffer;
 
+    /**
+     * Packets of this stream waiting to be interleaved, in order, if
+     * FFFormatContext.interleave_per_stream is set.
+     */
+    PacketList interleave_queue;
+
     int64_t last_IP_pts;
     int last_IP_duration;
 
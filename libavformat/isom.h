@@ -163,6 +163,26 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * State of the sample table parsing, from which the index entries of the
+ * following samples can be computed.
+ */
+typedef struct MOVIndexCheckpoint {
+    int64_t offset;
+    int64_t dts;
+    unsigned int sample;
+    unsigned int chunk;
+    unsigned int chunk_sample;
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int stss_index;
+    unsigned int stps_index;
+    unsigned int rap_group_index;
+    unsigned int rap_group_sample;
+    unsigned int distance;
+} MOVIndexCheckpoint;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -201,6 +221,11 @@ typedef struct MOVStreamContext {
     int64_t current_index;
     MOVIndexRange* index_ranges;
     MOVIndexRange* current_index_range;
+    int lazy_index;       ///< the index entries only hold a window of the samples
+    MOVIndexCheckpoint *index_checkpoints; ///< one every MOV_INDEX_WINDOW samples
+    unsigned int nb_index_checkpoints;
+    unsigned int nb_lazy_samples;
+    unsigned int index_base; ///< sample of the first index entry
     unsigned int bytes_per_frame;
     unsigned int samples_per_frame;
     int dv_audio_container;
@@ -286,6 +311,8 @@ typedef struct MOVContext {
     int use_absolute_path;
     int ignore_editlist;
     int advanced_editlist;
+    int lazy_index;
+    int lazy_frag_index;
     int ignore_chapters;
     int seek_individually;
     int64_t next_root_atom; ///< offset of the next root atom
@@ -296,6 +323,7 @@ typedef struct MOVContext {
     int moov_retry;
     int use_mfra_for;
     int has_looked_for_mfra;
+    int has_scanned_fragments;
     int use_tfdt;
     MOVFragmentIndex frag_index;
     int atom_depth;
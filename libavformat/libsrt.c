@@ -21,10 +21,15 @@
  * Haivision Open SRT (Secure Reliable Transport) protocol
  */
 
+#include <float.h>
+
 #include <srt/srt.h>
 
+#include "libavutil/fifo.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 
 #include "avformat.h"
@@ -43,6 +48,13 @@
 #define SRT_LIVE_MAX_PAYLOAD_SIZE 1456
 #endif
 
+/* The receive thread reads all pending messages into a buffer of this size
+ * before taking the FIFO lock */
+#define SRT_RX_BATCH_SIZE 65536
+
+/* Interval between two refreshes of the exported statistics (in microseconds) */
+#define SRT_STATS_INTERVAL 1000000
+
 enum SRTMode {
     SRT_MODE_CALLER = 0,
     SRT_MODE_LISTENER = 1,
@@ -91,10 +103,35 @@ typedef struct SRTContext {
     SRT_TRANSTYPE transtype;
     int linger;
     int tsbpd;
+
+    int fifo_size;
+    int overrun_nonfatal;
+#if HAVE_THREADS
+    AVFifo *fifo;
+    uint8_t *rx_buf;
+    int rx_error;
+    int close_req;
+    int thread_started;
+    pthread_t rx_thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+
+    int64_t stats_time;
+    int64_t pkt_sent;
+    int64_t pkt_recv;
+    int64_t pkt_snd_loss;
+    int64_t pkt_rcv_loss;
+    int64_t pkt_retrans;
+    int64_t pkt_snd_drop;
+    int64_t pkt_rcv_drop;
+    double rtt;
+    double bandwidth;
 } SRTContext;
 
 #define D AV_OPT_FLAG_DECODING_PARAM
 #define E AV_OPT_FLAG_ENCODING_PARAM
+#define X AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY
 #define OFFSET(x) offsetof(SRTContext, x)
 static const AVOption libsrt_options[] = {
     { "timeout",        "Timeout of socket I/O operations (in microseconds)",                   OFFSET(rw_timeout),       AV_OPT_TYPE_INT64, { .i64 = -1 }, -1, INT64_MAX, .flags = D|E },
@@ -144,6 +181,17 @@ static const AVOption libsrt_options[] = {
     { "file",           NULL, 0, AV_OPT_TYPE_CONST,  { .i64 = SRTT_FILE }, INT_MIN, INT_MAX, .flags = D|E, "transtype" },
     { "linger",         "Number of seconds that the socket waits for unsent data when closing", OFFSET(linger),           AV_OPT_TYPE_INT,      { .i64 = -1 }, -1, INT_MAX,   .flags = D|E },
     { "tsbpd",          "Timestamp-based packet delivery",                                      OFFSET(tsbpd),            AV_OPT_TYPE_BOOL,     { .i64 = -1 }, -1, 1,         .flags = D|E },
+    { "fifo_size",      "Size of the receiving circular buffer filled by a separate thread (in bytes), 0 to read in the calling thread", OFFSET(fifo_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, .flags = D },
+    { "overrun_nonfatal", "Survive in case of receiving circular buffer overrun",               OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL,     { .i64 = 0 },  0, 1,         .flags = D },
+    { "pkt_sent",       "Total number of sent data packets",                                    OFFSET(pkt_sent),         AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_recv",       "Total number of received data packets",                                OFFSET(pkt_recv),         AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_snd_loss",   "Total number of data packets reported lost by the receiver",           OFFSET(pkt_snd_loss),     AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_rcv_loss",   "Total number of data packets detected lost by the receiver",           OFFSET(pkt_rcv_loss),     AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_retrans",    "Total number of retransmitted data packets",                           OFFSET(pkt_retrans),      AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_snd_drop",   "Total number of data packets dropped by the sender as too late",       OFFSET(pkt_snd_drop),     AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_rcv_drop",   "Total number of data packets dropped by the receiver as too late",     OFFSET(pkt_rcv_drop),     AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "rtt",            "Smoothed round-trip time (in milliseconds)",                           OFFSET(rtt),              AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = X },
+    { "bandwidth",      "Estimated link bandwidth (in Mbps)",                                   OFFSET(bandwidth),        AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = X },
     { NULL }
 };
 
@@ -378,6 +426,198 @@ static int libsrt_set_options_pre(URLContext *h, int fd)
     return 0;
 }
 
+static void libsrt_update_stats(URLContext *h, int force)
+{
+    SRTContext *s = h->priv_data;
+    int64_t now = av_gettime_relative();
+    SRT_TRACEBSTATS perf;
+
+    if (!force && now - s->stats_time < SRT_STATS_INTERVAL)
+        return;
+    s->stats_time = now;
+
+    if (srt_bstats(s->fd, &perf, 0) < 0)
+        return;
+    s->pkt_sent     = perf.pktSentTotal;
+    s->pkt_recv     = perf.pktRecvTotal;
+    s->pkt_snd_loss = perf.pktSndLossTotal;
+    s->pkt_rcv_loss = perf.pktRcvLossTotal;
+    s->pkt_retrans  = perf.pktRetransTotal;
+    s->pkt_snd_drop = perf.pktSndDropTotal;
+    s->pkt_rcv_drop = perf.pktRcvDropTotal;
+    s->rtt          = perf.msRTT;
+    s->bandwidth    = perf.mbpsBandwidth;
+}
+
+#if HAVE_THREADS
+/* queue one message, called with the mutex held */
+static int rx_fifo_write(URLContext *h, const uint8_t *buf, int len)
+{
+    SRTContext *s = h->priv_data;
+    uint8_t tmp[4];
+
+    if (av_fifo_can_write(s->fifo) < len + 4) {
+        if (s->overrun_nonfatal) {
+            av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                   "Surviving due to overrun_nonfatal option\n");
+            return 0;
+        }
+        av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+               "To avoid, increase fifo_size URL option. "
+               "To survive in such case, use overrun_nonfatal option\n");
+        s->rx_error = AVERROR(EIO);
+        return s->rx_error;
+    }
+    AV_WL32(tmp, len);
+    av_fifo_write(s->fifo, tmp, 4);
+    av_fifo_write(s->fifo, buf, len);
+    return 0;
+}
+
+static void *rx_thread(void *arg)
+{
+    URLContext *h = arg;
+    SRTContext *s = h->priv_data;
+    int lens[SRT_RX_BATCH_SIZE / SRT_LIVE_DEFAULT_PAYLOAD_SIZE];
+
+    ff_thread_setname("srt-rx");
+
+    pthread_mutex_lock(&s->mutex);
+    while (!s->close_req) {
+        int ret, nb_msgs = 0, off = 0;
+
+        pthread_mutex_unlock(&s->mutex);
+        ret = libsrt_network_wait_fd(h, s->eid, 0);
+        /* drain everything the socket holds without taking the lock */
+        while (!ret && nb_msgs < FF_ARRAY_ELEMS(lens) &&
+               SRT_RX_BATCH_SIZE - off >= SRT_LIVE_MAX_PAYLOAD_SIZE) {
+            int len = srt_recvmsg(s->fd, s->rx_buf + off, SRT_RX_BATCH_SIZE - off);
+            if (len < 0) {
+                ret = libsrt_neterrno(h);
+                break;
+            }
+            lens[nb_msgs++] = len;
+            off += len;
+        }
+        pthread_mutex_lock(&s->mutex);
+
+        off = 0;
+        for (int i = 0; i < nb_msgs; i++) {
+            if (rx_fifo_write(h, s->rx_buf + off, lens[i]) < 0)
+                goto end;
+            off += lens[i];
+        }
+        if (nb_msgs)
+            pthread_cond_signal(&s->cond);
+        if (ret < 0 && ret != AVERROR(EAGAIN)) {
+            s->rx_error = ret;
+            break;
+        }
+    }
+
+end:
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+static int rx_thread_start(URLContext *h)
+{
+    SRTContext *s = h->priv_data;
+    int ret;
+
+    s->fifo   = av_fifo_alloc2(s->fifo_size, 1, 0);
+    s->rx_buf = av_malloc(SRT_RX_BATCH_SIZE);
+    if (!s->fifo || !s->rx_buf)
+        return AVERROR(ENOMEM);
+
+    ret = pthread_mutex_init(&s->mutex, NULL);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
+        return AVERROR(ret);
+    }
+    ret = pthread_cond_init(&s->cond, NULL);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
+        pthread_mutex_destroy(&s->mutex);
+        return AVERROR(ret);
+    }
+    ret = pthread_create(&s->rx_thread, NULL, rx_thread, h);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->mutex);
+        return AVERROR(ret);
+    }
+    s->thread_started = 1;
+    return 0;
+}
+
+static void rx_thread_stop(URLContext *h)
+{
+    SRTContext *s = h->priv_data;
+
+    if (s->thread_started) {
+        int ret;
+
+        pthread_mutex_lock(&s->mutex);
+        s->close_req = 1;
+        pthread_mutex_unlock(&s->mutex);
+        /* the thread notices the request after at most one polling period */
+        ret = pthread_join(s->rx_thread, NULL);
+        if (ret)
+            av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", strerror(ret));
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->mutex);
+        s->thread_started = 0;
+    }
+    av_fifo_freep2(&s->fifo);
+    av_freep(&s->rx_buf);
+}
+
+static int rx_fifo_read(URLContext *h, uint8_t *buf, int size)
+{
+    SRTContext *s = h->priv_data;
+    int nonblock = h->flags & AVIO_FLAG_NONBLOCK;
+
+    pthread_mutex_lock(&s->mutex);
+    while (1) {
+        if (av_fifo_can_read(s->fifo)) {
+            uint8_t tmp[4];
+            int len, avail;
+
+            av_fifo_read(s->fifo, tmp, 4);
+            len = avail = AV_RL32(tmp);
+            if (avail > size) {
+                av_log(h, AV_LOG_WARNING, "Part of message lost due to insufficient buffer size\n");
+                avail = size;
+            }
+            av_fifo_read(s->fifo, buf, avail);
+            av_fifo_drain2(s->fifo, len - avail);
+            pthread_mutex_unlock(&s->mutex);
+            return avail;
+        } else if (s->rx_error) {
+            int err = s->rx_error;
+            pthread_mutex_unlock(&s->mutex);
+            return err;
+        } else if (nonblock) {
+            pthread_mutex_unlock(&s->mutex);
+            return AVERROR(EAGAIN);
+        } else {
+            int64_t t = av_gettime() + POLLING_TIME * 1000;
+            struct timespec tv = { .tv_sec  =  t / 1000000,
+                                   .tv_nsec = (t % 1000000) * 1000 };
+            int err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+            if (err) {
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(err == ETIMEDOUT ? EAGAIN : err);
+            }
+            nonblock = 1;
+        }
+    }
+}
+#endif
+
 
 static int libsrt_setup(URLContext *h, const char *uri, int flags)
 {
@@ -506,6 +746,21 @@ static int libsrt_setup(URLContext *h, const char *uri, int flags)
     s->fd = fd;
     s->eid = eid;
 
+    if (s->fifo_size && !(flags & AVIO_FLAG_WRITE)) {
+#if HAVE_THREADS
+        ret = rx_thread_start(h);
+        if (ret < 0) {
+            rx_thread_stop(h);
+            srt_epoll_release(eid);
+            goto fail1;
+        }
+#else
+        av_log(h, AV_LOG_WARNING,
+               "'fifo_size' option was set but it is not supported "
+               "on this build (thread support is required)\n");
+#endif
+    }
+
     freeaddrinfo(ai);
     return 0;
 
@@ -662,6 +917,12 @@ static int libsrt_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "linger", p)) {
             s->linger = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "fifo_size", p)) {
+            s->fifo_size = strtol(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "overrun_nonfatal", p)) {
+            s->overrun_nonfatal = strtol(buf, NULL, 10);
+        }
     }
     ret = libsrt_setup(h, uri, flags);
     if (ret < 0)
@@ -680,11 +941,25 @@ static int libsrt_read(URLContext *h, uint8_t *buf, int size)
     SRTContext *s = h->priv_data;
     int ret;
 
-    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
-        ret = libsrt_network_wait_fd_timeout(h, s->eid, 0, h->rw_timeout, &h->interrupt_callback);
-        if (ret)
-            return ret;
-    }
+    libsrt_update_stats(h, 0);
+
+#if HAVE_THREADS
+    if (s->fifo)
+        return rx_fifo_read(h, buf, size);
+#endif
+
+    /* only poll when no message is pending, saving an epoll round trip
+     * per message at high rates */
+    ret = srt_recvmsg(s->fd, buf, size);
+    if (ret >= 0)
+        return ret;
+    ret = libsrt_neterrno(h);
+    if (ret != AVERROR(EAGAIN) || (h->flags & AVIO_FLAG_NONBLOCK))
+        return ret;
+
+    ret = libsrt_network_wait_fd_timeout(h, s->eid, 0, h->rw_timeout, &h->interrupt_callback);
+    if (ret)
+        return ret;
 
     ret = srt_recvmsg(s->fd, buf, size);
     if (ret < 0) {
@@ -699,11 +974,19 @@ static int libsrt_write(URLContext *h, const uint8_t *buf, int size)
     SRTContext *s = h->priv_data;
     int ret;
 
-    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
-        ret = libsrt_network_wait_fd_timeout(h, s->eid, 1, h->rw_timeout, &h->interrupt_callback);
-        if (ret)
-            return ret;
-    }
+    libsrt_update_stats(h, 0);
+
+    /* the send buffer usually has room, only poll when it is full */
+    ret = srt_sendmsg(s->fd, buf, size, -1, 1);
+    if (ret >= 0)
+        return ret;
+    ret = libsrt_neterrno(h);
+    if (ret != AVERROR(EAGAIN) || (h->flags & AVIO_FLAG_NONBLOCK))
+        return ret;
+
+    ret = libsrt_network_wait_fd_timeout(h, s->eid, 1, h->rw_timeout, &h->interrupt_callback);
+    if (ret)
+        return ret;
 
     ret = srt_sendmsg(s->fd, buf, size, -1, 1);
     if (ret < 0) {
@@ -717,6 +1000,17 @@ static int libsrt_close(URLContext *h)
 {
     SRTContext *s = h->priv_data;
 
+#if HAVE_THREADS
+    rx_thread_stop(h);
+#endif
+
+    libsrt_update_stats(h, 1);
+    av_log(h, AV_LOG_VERBOSE, "packets sent %"PRId64" received %"PRId64
+           " lost %"PRId64"/%"PRId64" retransmitted %"PRId64
+           " dropped %"PRId64"/%"PRId64" rtt %.3f ms\n",
+           s->pkt_sent, s->pkt_recv, s->pkt_snd_loss, s->pkt_rcv_loss,
+           s->pkt_retrans, s->pkt_snd_drop, s->pkt_rcv_drop, s->rtt);
+
     srt_epoll_release(s->eid);
     srt_close(s->fd);
 
@@ -49,6 +49,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/time_internal.h"
 #include "libavutil/spherical.h"
+#include "libavutil/thread.h"
 
 #include "libavcodec/bytestream.h"
 #include "libavcodec/flac.h"
@@ -423,6 +424,10 @@ typedef struct MatroskaDemuxContext {
 
     /* Bandwidth value for WebM DASH Manifest */
     int bandwidth;
+
+    /* Clusters read and parsed ahead by worker threads using the Cues */
+    int cluster_threads;
+    struct MatroskaClusterReader *cluster_reader;
 } MatroskaDemuxContext;
 
 #define CHILD_OF(parent) { .def = { .n = parent } }
@@ -3766,6 +3771,9 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, AVBufferRef *buf
         }
     }
 
+    if (st->discard >= AVDISCARD_NONKEY && !is_keyframe)
+        return res;
+
     res = matroska_parse_laces(matroska, &data, size, (flags & 0x06) >> 1,
                                &pb.pub, lace_size, &laces);
     if (res < 0) {
@@ -3896,6 +3904,452 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
     return res;
 }
 
+#if HAVE_THREADS
+/* blocks of a range of clusters, read and parsed by a cluster thread */
+typedef struct MatroskaClusterJob {
+    int64_t start;              ///< position of the first cluster of the range
+    int64_t end;                ///< position right after the range
+    int done;
+    int ret;
+    MatroskaCluster *blocks;    ///< the blocks along with their cluster
+    unsigned int blocks_size;
+    int nb_blocks;
+    int next_block;             ///< only used by the demuxer thread
+    int64_t skip_cluster;       ///< cluster with a broken block, its remaining blocks are skipped
+} MatroskaClusterJob;
+
+typedef struct MatroskaClusterThread {
+    struct MatroskaClusterReader *r;
+    pthread_t thread;
+    AVIOContext *pb;            ///< own connection to the input
+    AVFormatContext *ctx;       ///< context the clusters are parsed from memory with
+    uint8_t *buf;
+    unsigned int buf_size;
+} MatroskaClusterThread;
+
+typedef struct MatroskaClusterReader {
+    MatroskaDemuxContext *matroska;
+    MatroskaClusterThread *threads;
+    int nb_threads;
+    int nb_running;
+
+    /* sorted positions of the clusters referenced by the Cues */
+    int64_t *cluster_pos;
+    int nb_cluster_pos;
+
+    /* the next range to be read, starting at next_start and ending
+     * at cluster_pos[next_range] */
+    int64_t next_start;
+    int next_range;
+    int active;
+
+    /* ring of ranges between job_head and job_tail, the ones from
+     * job_next on are not taken by a thread yet */
+    MatroskaClusterJob *jobs;
+    unsigned nb_jobs;
+    unsigned job_head, job_next, job_tail;
+    int exiting;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cond;
+    pthread_cond_t  done_cond;
+} MatroskaClusterReader;
+
+static int cluster_thread_parse(MatroskaClusterThread *t, MatroskaClusterJob *job)
+{
+    MatroskaDemuxContext *const matroska = t->r->matroska;
+    MatroskaDemuxContext w = { .ctx = t->ctx };
+    MatroskaCluster cluster = { 0 };
+    MatroskaBlock *block = &cluster.block;
+    int64_t size = job->end - job->start;
+    FFIOContext pb;
+    int ret;
+
+    if (size < 4 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR_INVALIDDATA;
+    av_fast_malloc(&t->buf, &t->buf_size, size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!t->buf)
+        return AVERROR(ENOMEM);
+
+    if ((ret = avio_seek(t->pb, job->start, SEEK_SET)) < 0)
+        return ret;
+    ret = avio_read(t->pb, t->buf, size);
+    if (ret != size)
+        return ret < 0 ? ret : AVERROR_INVALIDDATA;
+    if (AV_RB32(t->buf) != MATROSKA_ID_CLUSTER)
+        return AVERROR_INVALIDDATA;
+
+    /* Parse the range from memory exactly like the demuxer would parse it
+     * from the input, positions included. */
+    ffio_init_context(&pb, t->buf, size, 0, NULL, NULL, NULL, NULL);
+    pb.pub.pos = job->end;
+    t->ctx->pb = &pb.pub;
+    w.levels[0]  = (MatroskaLevel){ matroska->segment_start, EBML_UNKNOWN_LENGTH };
+    w.num_levels = 1;
+    w.resync_pos = job->start;
+
+    while (w.num_levels) {
+        if (w.num_levels == 1) {
+            ret = ebml_parse(&w, matroska_segment, NULL);
+            if (ret == 1) {
+                cluster.pos = avio_tell(&pb.pub) - 4;
+                ret = ebml_parse(&w, matroska_cluster_enter, &cluster);
+            }
+        } else {
+            ret = ebml_parse(&w, matroska_cluster_parsing, &cluster);
+            if (ret >= 0 && block->bin.size > 0) {
+                MatroskaCluster *dst = av_fast_realloc(job->blocks, &job->blocks_size,
+                                                       (job->nb_blocks + 1) * sizeof(*dst));
+                if (!dst) {
+                    ret = AVERROR(ENOMEM);
+                } else {
+                    job->blocks = dst;
+                    job->blocks[job->nb_blocks++] = cluster;
+                    memset(block, 0, sizeof(*block));
+                }
+            }
+            ebml_free(matroska_blockgroup, block);
+            memset(block, 0, sizeof(*block));
+        }
+        if (ret < 0)
+            break;
+    }
+    t->ctx->pb = NULL;
+
+    return FFMIN(ret, 0);
+}
+
+static void *cluster_thread(void *arg)
+{
+    MatroskaClusterThread *t = arg;
+    MatroskaClusterReader *r = t->r;
+
+    pthread_mutex_lock(&r->lock);
+    while (!r->exiting) {
+        MatroskaClusterJob *job;
+
+        if (r->job_next == r->job_tail) {
+            pthread_cond_wait(&r->work_cond, &r->lock);
+            continue;
+        }
+        job = &r->jobs[r->job_next++ & (r->nb_jobs - 1)];
+        pthread_mutex_unlock(&r->lock);
+
+        job->ret = cluster_thread_parse(t, job);
+
+        pthread_mutex_lock(&r->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&r->done_cond);
+    }
+    pthread_mutex_unlock(&r->lock);
+
+    return NULL;
+}
+
+static void cluster_job_reset(MatroskaClusterJob *job)
+{
+    for (int i = job->next_block; i < job->nb_blocks; i++)
+        ebml_free(matroska_blockgroup, &job->blocks[i].block);
+    job->nb_blocks    = 0;
+    job->next_block   = 0;
+    job->done         = 0;
+    job->ret          = 0;
+    job->skip_cluster = -1;
+}
+
+/* Wait for the ranges being read and drop all of them. */
+static void cluster_reader_flush(MatroskaClusterReader *r)
+{
+    unsigned tail;
+
+    pthread_mutex_lock(&r->lock);
+    tail = r->job_tail = r->job_next;
+    for (unsigned i = r->job_head; i != tail; i++)
+        while (!r->jobs[i & (r->nb_jobs - 1)].done)
+            pthread_cond_wait(&r->done_cond, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+
+    for (unsigned i = r->job_head; i != tail; i++)
+        cluster_job_reset(&r->jobs[i & (r->nb_jobs - 1)]);
+    r->job_head = tail;
+    r->active   = 0;
+}
+
+/* Restart reading ahead at the cluster at pos. */
+static void cluster_reader_start(MatroskaClusterReader *r, int64_t pos)
+{
+    int lo = 0, hi = r->nb_cluster_pos;
+
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (r->cluster_pos[mid] > pos)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    r->next_start = pos;
+    r->next_range = lo;
+    r->active     = lo < r->nb_cluster_pos;
+}
+
+static void matroska_cluster_reader_free(MatroskaDemuxContext *matroska)
+{
+    MatroskaClusterReader *r = matroska->cluster_reader;
+
+    if (!r)
+        return;
+
+    if (r->nb_running) {
+        pthread_mutex_lock(&r->lock);
+        r->exiting = 1;
+        pthread_cond_broadcast(&r->work_cond);
+        pthread_mutex_unlock(&r->lock);
+        for (int i = 0; i < r->nb_running; i++)
+            pthread_join(r->threads[i].thread, NULL);
+        pthread_cond_destroy(&r->done_cond);
+        pthread_cond_destroy(&r->work_cond);
+        pthread_mutex_destroy(&r->lock);
+    }
+    for (int i = 0; i < r->nb_threads; i++) {
+        MatroskaClusterThread *t = &r->threads[i];
+        ff_format_io_close(matroska->ctx, &t->pb);
+        avformat_free_context(t->ctx);
+        av_freep(&t->buf);
+    }
+    for (unsigned i = 0; i < r->nb_jobs; i++) {
+        cluster_job_reset(&r->jobs[i]);
+        av_freep(&r->jobs[i].blocks);
+    }
+    av_freep(&r->jobs);
+    av_freep(&r->threads);
+    av_freep(&r->cluster_pos);
+    av_freep(&matroska->cluster_reader);
+}
+
+static int cmp_cluster_pos(const void *a, const void *b)
+{
+    return FFDIFFSIGN(*(const int64_t *)a, *(const int64_t *)b);
+}
+
+static int cluster_reader_init(MatroskaDemuxContext *matroska, int64_t pos)
+{
+    AVFormatContext *s = matroska->ctx;
+    MatroskaClusterReader *r;
+    MatroskaIndex *index;
+    int nb = 0, ret;
+
+    if (matroska->cues_parsing_deferred > 0) {
+        matroska->cues_parsing_deferred = 0;
+        matroska_parse_cues(matroska);
+    }
+    if (matroska->cues_parsing_deferred < 0 || s->flags & AVFMT_FLAG_IGNIDX)
+        return AVERROR(ENOSYS);
+
+    index = matroska->index.elem;
+    r = matroska->cluster_reader = av_mallocz(sizeof(*r));
+    if (!r)
+        return AVERROR(ENOMEM);
+    r->matroska = matroska;
+
+    for (int i = 0; i < matroska->index.nb_elem; i++) {
+        MatroskaIndexPos *index_pos = index[i].pos.elem;
+        int64_t *tmp = av_realloc_array(r->cluster_pos, nb + index[i].pos.nb_elem,
+                                        sizeof(*r->cluster_pos));
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        r->cluster_pos = tmp;
+        for (int j = 0; j < index[i].pos.nb_elem; j++)
+            if (index_pos[j].pos <= INT64_MAX - matroska->segment_start)
+                r->cluster_pos[nb++] = index_pos[j].pos + matroska->segment_start;
+    }
+    if (nb < 2)
+        return AVERROR(ENOSYS);
+    qsort(r->cluster_pos, nb, sizeof(*r->cluster_pos), cmp_cluster_pos);
+    r->nb_cluster_pos = 1;
+    for (int i = 1; i < nb; i++)
+        if (r->cluster_pos[i] != r->cluster_pos[r->nb_cluster_pos - 1])
+            r->cluster_pos[r->nb_cluster_pos++] = r->cluster_pos[i];
+
+    r->nb_jobs = 1 << av_ceil_log2(2 * matroska->cluster_threads);
+    r->jobs    = av_calloc(r->nb_jobs, sizeof(*r->jobs));
+    if (!r->jobs)
+        return AVERROR(ENOMEM);
+    for (unsigned i = 0; i < r->nb_jobs; i++)
+        r->jobs[i].skip_cluster = -1;
+
+    r->threads = av_calloc(matroska->cluster_threads, sizeof(*r->threads));
+    if (!r->threads)
+        return AVERROR(ENOMEM);
+    for (; r->nb_threads < matroska->cluster_threads; r->nb_threads++) {
+        MatroskaClusterThread *t = &r->threads[r->nb_threads];
+        t->r = r;
+        if ((ret = s->io_open(s, &t->pb, s->url, AVIO_FLAG_READ, NULL)) < 0)
+            return ret;
+        if (!(t->ctx = avformat_alloc_context()))
+            return AVERROR(ENOMEM);
+        t->ctx->iformat = s->iformat;
+    }
+
+    if ((ret = pthread_mutex_init(&r->lock, NULL)))
+        return AVERROR(ret);
+    if ((ret = pthread_cond_init(&r->work_cond, NULL))) {
+        pthread_mutex_destroy(&r->lock);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&r->done_cond, NULL))) {
+        pthread_cond_destroy(&r->work_cond);
+        pthread_mutex_destroy(&r->lock);
+        return AVERROR(ret);
+    }
+    for (; r->nb_running < r->nb_threads; r->nb_running++) {
+        MatroskaClusterThread *t = &r->threads[r->nb_running];
+        if ((ret = pthread_create(&t->thread, NULL, cluster_thread, t)))
+            break;
+    }
+    if (!r->nb_running) {
+        pthread_cond_destroy(&r->done_cond);
+        pthread_cond_destroy(&r->work_cond);
+        pthread_mutex_destroy(&r->lock);
+        return AVERROR(ret);
+    }
+
+    cluster_reader_start(r, pos);
+    return 0;
+}
+
+/*
+ * Set up the threads reading the clusters ahead. This is only done at
+ * a cluster boundary, after the header or a seek.
+ */
+static void matroska_cluster_reader_init(MatroskaDemuxContext *matroska)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    int64_t pos = avio_tell(pb);
+    int ret;
+
+    if (matroska->num_levels != 1 || matroska->resync_pos == -1 ||
+        (matroska->current_id && matroska->current_id != MATROSKA_ID_CLUSTER) ||
+        !(pb->seekable & AVIO_SEEKABLE_NORMAL) || !matroska->ctx->url[0]) {
+        ret = AVERROR(ENOSYS);
+    } else {
+        if (matroska->current_id)
+            pos -= 4;
+        ret = cluster_reader_init(matroska, pos);
+    }
+    if (ret < 0) {
+        av_log(matroska->ctx, ret == AVERROR(ENOSYS) ? AV_LOG_VERBOSE : AV_LOG_WARNING,
+               "Not reading clusters in parallel: %s\n", av_err2str(ret));
+        matroska_cluster_reader_free(matroska);
+        matroska->cluster_threads = 0;
+    }
+}
+
+/*
+ * Drop the clusters read ahead and restart reading at the cluster at pos,
+ * or stop reading ahead if pos is negative.
+ */
+static void matroska_cluster_reader_seek(MatroskaDemuxContext *matroska, int64_t pos)
+{
+    MatroskaClusterReader *r = matroska->cluster_reader;
+
+    if (!r)
+        return;
+    cluster_reader_flush(r);
+    if (pos >= 0 && matroska->cluster_threads)
+        cluster_reader_start(r, pos);
+}
+
+/*
+ * Parse the next block read ahead by the cluster threads.
+ * Returns 1 if there is none and the clusters have to be parsed
+ * from the input.
+ */
+static int matroska_parse_cluster_ahead(MatroskaDemuxContext *matroska)
+{
+    MatroskaClusterReader *r = matroska->cluster_reader;
+    MatroskaClusterJob *job;
+    MatroskaCluster *cluster;
+
+    if (!r->active)
+        return 1;
+
+    pthread_mutex_lock(&r->lock);
+    while (r->job_tail - r->job_head < r->nb_jobs && r->next_range < r->nb_cluster_pos) {
+        job = &r->jobs[r->job_tail++ & (r->nb_jobs - 1)];
+        job->start = r->next_start;
+        job->end   = r->next_start = r->cluster_pos[r->next_range++];
+    }
+    pthread_cond_broadcast(&r->work_cond);
+
+    if (r->job_head == r->job_tail) {
+        /* The clusters after the last one in the Cues are parsed as usual. */
+        pthread_mutex_unlock(&r->lock);
+        r->active = 0;
+        matroska_reset_status(matroska, 0, r->next_start);
+        return 1;
+    }
+    job = &r->jobs[r->job_head & (r->nb_jobs - 1)];
+    while (!job->done)
+        pthread_cond_wait(&r->done_cond, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+
+    if (job->ret < 0) {
+        int64_t start = job->start;
+        av_log(matroska->ctx, AV_LOG_WARNING, "Reading clusters at 0x%"PRIx64" "
+               "in parallel failed: %s, parsing them sequentially.\n",
+               start, av_err2str(job->ret));
+        cluster_reader_flush(r);
+        matroska->cluster_threads = 0;
+        matroska_reset_status(matroska, 0, start);
+        return 1;
+    }
+
+    if (job->next_block == job->nb_blocks) {
+        cluster_job_reset(job);
+        r->job_head++;
+        return 0;
+    }
+
+    cluster = &job->blocks[job->next_block++];
+    if (cluster->pos != job->skip_cluster) {
+        MatroskaBlock *block = &cluster->block;
+        int is_keyframe = block->non_simple ? block->reference.count == 0 : -1;
+        uint8_t* additional = block->additional.size > 0 ?
+                                block->additional.data : NULL;
+        int res = matroska_parse_block(matroska, block->bin.buf, block->bin.data,
+                                       block->bin.size, block->bin.pos,
+                                       cluster->timecode, block->duration,
+                                       is_keyframe, additional, block->additional_id,
+                                       block->additional.size, cluster->pos,
+                                       block->discard_padding);
+        /* the demuxer resyncs at the next cluster on errors */
+        if (res < 0)
+            job->skip_cluster = cluster->pos;
+    }
+    ebml_free(matroska_blockgroup, &cluster->block);
+
+    return 0;
+}
+#else
+static void matroska_cluster_reader_init(MatroskaDemuxContext *matroska)
+{
+    matroska->cluster_threads = 0;
+}
+
+static void matroska_cluster_reader_free(MatroskaDemuxContext *matroska)
+{
+}
+
+static void matroska_cluster_reader_seek(MatroskaDemuxContext *matroska, int64_t pos)
+{
+}
+
+static int matroska_parse_cluster_ahead(MatroskaDemuxContext *matroska)
+{
+    return 1;
+}
+#endif
+
 static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MatroskaDemuxContext *matroska = s->priv_data;
@@ -3906,9 +4360,14 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
         matroska->resync_pos = avio_tell(s->pb);
     }
 
+    if (matroska->cluster_threads && !matroska->cluster_reader)
+        matroska_cluster_reader_init(matroska);
+
     while (matroska_deliver_packet(matroska, pkt)) {
         if (matroska->done)
             return (ret < 0) ? ret : AVERROR_EOF;
+        if (matroska->cluster_threads && !matroska_parse_cluster_ahead(matroska))
+            continue;
         if (matroska_parse_cluster(matroska) < 0 && !matroska->done)
             ret = matroska_resync(matroska, matroska->resync_pos);
     }
@@ -3925,6 +4384,8 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     FFStream *const sti = ffstream(st);
     int i, index;
 
+    matroska_cluster_reader_seek(matroska, -1);
+
     /* Parse the CUES now since we need the index data to seek. */
     if (matroska->cues_parsing_deferred > 0) {
         matroska->cues_parsing_deferred = 0;
@@ -3970,6 +4431,7 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     }
     matroska->skip_to_keyframe = 1;
     matroska->done             = 0;
+    matroska_cluster_reader_seek(matroska, sti->index_entries[index].pos);
     avpriv_update_cur_dts(s, st, sti->index_entries[index].timestamp);
     return 0;
 err:
@@ -3990,6 +4452,7 @@ static int matroska_read_close(AVFormatContext *s)
     MatroskaTrack *tracks = matroska->tracks.elem;
     int n;
 
+    matroska_cluster_reader_free(matroska);
     matroska_clear_queue(matroska);
 
     for (n = 0; n < matroska->tracks.nb_elem; n++)
@@ -4000,6 +4463,8 @@ static int matroska_read_close(AVFormatContext *s)
     return 0;
 }
 
+#define OFFSET(x) offsetof(MatroskaDemuxContext, x)
+
 #if CONFIG_WEBM_DASH_MANIFEST_DEMUXER
 typedef struct {
     int64_t start_time_ns;
@@ -4415,7 +4880,6 @@ static int webm_dash_manifest_read_packet(AVFormatContext *s, AVPacket *pkt)
     return AVERROR_EOF;
 }
 
-#define OFFSET(x) offsetof(MatroskaDemuxContext, x)
 static const AVOption options[] = {
     { "live", "flag indicating that the input is a live file that only has the headers.", OFFSET(is_live), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "bandwidth", "bandwidth of this stream to be specified in the DASH manifest.", OFFSET(bandwidth), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_DECODING_PARAM },
@@ -4441,10 +4905,23 @@ const AVInputFormat ff_webm_dash_manifest_demuxer = {
 };
 #endif
 
+static const AVOption matroska_options[] = {
+    { "cluster_threads", "number of threads reading and parsing clusters ahead using the Cues", OFFSET(cluster_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, AV_OPT_FLAG_DECODING_PARAM },
+    { NULL },
+};
+
+static const AVClass matroska_class = {
+    .class_name = "matroska,webm demuxer",
+    .item_name  = av_default_item_name,
+    .option     = matroska_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 const AVInputFormat ff_matroska_demuxer = {
     .name           = "matroska,webm",
     .long_name      = NULL_IF_CONFIG_SMALL("Matroska / WebM"),
     .extensions     = "mkv,mk3d,mka,mks,webm",
+    .priv_class     = &matroska_class,
     .priv_data_size = sizeof(MatroskaDemuxContext),
     .flags_internal = FF_FMT_INIT_CLEANUP,
     .read_probe     = matroska_probe,
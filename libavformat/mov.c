@@ -1407,6 +1407,175 @@ static void fix_frag_index_entries(MOVFragmentIndex *frag_index, int index,
     }
 }
 
+static MOVTrackExt *get_trex(MOVContext *c, unsigned track_id)
+{
+    for (unsigned i = 0; i < c->trex_count; i++)
+        if (c->trex_data[i].track_id == track_id)
+            return &c->trex_data[i];
+    return NULL;
+}
+
+/**
+ * Read the track IDs and the tfdt of the trafs of a moof into the fragment
+ * index, without indexing the samples. The trun sample durations and sizes
+ * are summed up for the stream duration and bitrate.
+ */
+static int scan_moof(MOVContext *c, AVIOContext *pb, int64_t moof_offset, int64_t end)
+{
+    int index = update_frag_index(c, moof_offset);
+
+    if (index < 0)
+        return index == -1 ? AVERROR(ENOMEM) : index;
+
+    while (avio_tell(pb) + 8 <= end && !avio_feof(pb)) {
+        int64_t traf_end = avio_tell(pb);
+        uint32_t size = avio_rb32(pb);
+        uint32_t type = avio_rl32(pb);
+        unsigned track_id = 0;
+        uint32_t default_duration = 0, default_size = 0;
+        int64_t tfdt = AV_NOPTS_VALUE, duration = 0, data_size = 0;
+        AVStream *st = NULL;
+
+        if (size < 8 || traf_end + size > end)
+            break;
+        traf_end += size;
+
+        while (type == MKTAG('t','r','a','f') && avio_tell(pb) + 8 <= traf_end) {
+            int64_t next = avio_tell(pb);
+            uint32_t child_size = avio_rb32(pb);
+            uint32_t child_type = avio_rl32(pb);
+            int version, flags;
+
+            if (child_size < 16 || next + child_size > traf_end)
+                break;
+            next += child_size;
+
+            version = avio_r8(pb);
+            flags   = avio_rb24(pb);
+
+            if (child_type == MKTAG('t','f','h','d')) {
+                MOVTrackExt *trex;
+
+                track_id = avio_rb32(pb);
+                if (!(trex = get_trex(c, track_id)))
+                    break;
+                if (flags & MOV_TFHD_BASE_DATA_OFFSET)
+                    avio_skip(pb, 8);
+                if (flags & MOV_TFHD_STSD_ID)
+                    avio_skip(pb, 4);
+                default_duration = flags & MOV_TFHD_DEFAULT_DURATION ?
+                                   avio_rb32(pb) : trex->duration;
+                default_size     = flags & MOV_TFHD_DEFAULT_SIZE ?
+                                   avio_rb32(pb) : trex->size;
+            } else if (child_type == MKTAG('t','f','d','t')) {
+                tfdt = version ? avio_rb64(pb) : avio_rb32(pb);
+            } else if (child_type == MKTAG('t','r','u','n')) {
+                uint32_t entries = avio_rb32(pb);
+                int skip = 4 * !!(flags & MOV_TRUN_SAMPLE_FLAGS) +
+                           4 * !!(flags & MOV_TRUN_SAMPLE_CTS);
+
+                if (flags & MOV_TRUN_DATA_OFFSET)
+                    avio_skip(pb, 4);
+                if (flags & MOV_TRUN_FIRST_SAMPLE_FLAGS)
+                    avio_skip(pb, 4);
+                if (!(flags & MOV_TRUN_SAMPLE_DURATION))
+                    duration  += (int64_t)entries * default_duration;
+                if (!(flags & MOV_TRUN_SAMPLE_SIZE))
+                    data_size += (int64_t)entries * default_size;
+                if (flags & (MOV_TRUN_SAMPLE_DURATION | MOV_TRUN_SAMPLE_SIZE)) {
+                    for (uint32_t i = 0; i < entries && avio_tell(pb) < next; i++) {
+                        if (flags & MOV_TRUN_SAMPLE_DURATION)
+                            duration  += avio_rb32(pb);
+                        if (flags & MOV_TRUN_SAMPLE_SIZE)
+                            data_size += avio_rb32(pb);
+                        avio_skip(pb, skip);
+                    }
+                }
+            }
+            avio_seek(pb, next, SEEK_SET);
+        }
+
+        for (int i = 0; track_id && i < c->fc->nb_streams; i++)
+            if (c->fc->streams[i]->id == track_id)
+                st = c->fc->streams[i];
+
+        if (st) {
+            MOVFragmentStreamInfo *frag_stream_info =
+                get_frag_stream_info(&c->frag_index, index, track_id);
+            MOVStreamContext *sc = st->priv_data;
+
+            /* The samples of the moof being read are accounted for
+             * by mov_read_trun(). */
+            if (moof_offset != c->fragment.moof_offset)
+                sc->data_size += data_size;
+            if (frag_stream_info && tfdt != AV_NOPTS_VALUE) {
+                frag_stream_info->tfdt_dts = tfdt;
+                if (st->duration < tfdt + duration)
+                    st->duration = tfdt + duration;
+            }
+        }
+        avio_seek(pb, traf_end, SEEK_SET);
+    }
+
+    return 0;
+}
+
+/**
+ * Build the fragment index by walking the root atoms from the given moof to
+ * the end of the file. Only the start of each fragment is read; its samples
+ * are parsed by mov_switch_root() when reading or seeking reaches it.
+ */
+static int mov_scan_fragments(MOVContext *c, AVIOContext *pb, int64_t offset)
+{
+    int64_t stream_size = avio_size(pb);
+    int64_t original_pos = avio_tell(pb);
+    int64_t seek_ret;
+    int ret = 0;
+
+    if (stream_size <= 0)
+        return 0;
+
+    while (offset <= stream_size - 8) {
+        int64_t size;
+        uint32_t type;
+
+        if ((seek_ret = avio_seek(pb, offset, SEEK_SET)) < 0) {
+            ret = seek_ret;
+            goto fail;
+        }
+        size = avio_rb32(pb);
+        type = avio_rl32(pb);
+        if (size == 1)
+            size = avio_rb64(pb);
+        else if (size == 0)
+            size = stream_size - offset;
+        if (avio_feof(pb) || size < 8 || size > stream_size - offset)
+            break;
+
+        if (type == MKTAG('m','o','o','f')) {
+            if ((ret = scan_moof(c, pb, offset, offset + size)) < 0)
+                goto fail;
+        }
+        offset += size;
+
+        if (ff_check_interrupt(&c->fc->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            goto fail;
+        }
+    }
+
+    av_log(c->fc, AV_LOG_VERBOSE, "scanned %d fragments\n", c->frag_index.nb_items);
+    c->frag_index.complete = 1;
+fail:
+    seek_ret = avio_seek(pb, original_pos, SEEK_SET);
+    if (seek_ret < 0) {
+        av_log(c->fc, AV_LOG_ERROR,
+               "failed to seek back after scanning fragments\n");
+        ret = seek_ret;
+    }
+    return ret;
+}
+
 static int mov_read_moof(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     // Set by mov_read_tfhd(). mov_read_trun() will reject files missing tfhd.
@@ -1429,6 +1598,17 @@ static int mov_read_moof(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     }
     c->fragment.moof_offset = c->fragment.implicit_offset = avio_tell(pb) - 8;
     av_log(c->fc, AV_LOG_TRACE, "moof offset %"PRIx64"\n", c->fragment.moof_offset);
+    if (!c->has_scanned_fragments && c->lazy_frag_index && c->found_moov &&
+        !c->frag_index.complete && (pb->seekable & AVIO_SEEKABLE_NORMAL)) {
+        int ret;
+        c->has_scanned_fragments = 1;
+        if ((ret = mov_scan_fragments(c, pb, c->fragment.moof_offset)) < 0) {
+            if (ret == AVERROR_EXIT)
+                return ret;
+            av_log(c->fc, AV_LOG_WARNING, "failed to scan the fragments, "
+                   "reading all of them\n");
+        }
+    }
     c->frag_index.current = update_frag_index(c, c->fragment.moof_offset);
     return mov_read_default(c, pb, atom);
 }
@@ -4025,27 +4205,359 @@ static int build_open_gop_key_points(AVStream *st)
     return 0;
 }
 
+#define MOV_INDEX_WINDOW 4096
+
+/* Expand the ctts entries such that we have a 1-1 mapping with samples. */
+static int mov_expand_ctts(MOVStreamContext *sc)
+{
+    MOVCtts *ctts_data_old = sc->ctts_data;
+    unsigned int ctts_count_old = sc->ctts_count;
+
+    if (!ctts_data_old)
+        return 0;
+    if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        return AVERROR(ENOMEM);
+    sc->ctts_count = 0;
+    sc->ctts_allocated_size = 0;
+    sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
+                            sc->sample_count * sizeof(*sc->ctts_data));
+    if (!sc->ctts_data) {
+        av_free(ctts_data_old);
+        return AVERROR(ENOMEM);
+    }
+
+    memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
+
+    for (unsigned int i = 0; i < ctts_count_old &&
+                             sc->ctts_count < sc->sample_count; i++)
+        for (unsigned int j = 0; j < ctts_data_old[i].count &&
+                                 sc->ctts_count < sc->sample_count; j++)
+            add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
+                           &sc->ctts_allocated_size, 1,
+                           ctts_data_old[i].duration);
+    av_free(ctts_data_old);
+    return 0;
+}
+
+/*
+ * Compute the index entry of the next sample described by the sample tables
+ * and advance p past it.
+ * Returns 1 if the sample belongs to the stream, 0 if it does not,
+ * AVERROR_EOF after the last chunk, a negative error code otherwise.
+ */
+static int mov_index_next_sample(MOVContext *mov, AVStream *st,
+                                 MOVIndexCheckpoint *p, AVIndexEntry *e)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+    int rap_group_present = sc->rap_group_count && sc->rap_group;
+    unsigned int sample_size;
+    int keyframe = 0, ret;
+
+    for (;;) {
+        if (p->chunk >= sc->chunk_count)
+            return AVERROR_EOF;
+        if (!p->chunk_sample) {
+            int64_t next_offset = p->chunk + 1 < sc->chunk_count ? sc->chunk_offsets[p->chunk + 1] : INT64_MAX;
+            p->offset = sc->chunk_offsets[p->chunk];
+            while (mov_stsc_index_valid(p->stsc_index, sc->stsc_count) &&
+                p->chunk + 1 == sc->stsc_data[p->stsc_index + 1].first)
+                p->stsc_index++;
+
+            if (next_offset > p->offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
+                sc->stsc_data[p->stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - p->offset) {
+                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
+                sc->stsz_sample_size = sc->sample_size;
+            }
+            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
+                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
+                sc->stsz_sample_size = sc->sample_size;
+            }
+        }
+        if (p->chunk_sample < sc->stsc_data[p->stsc_index].count)
+            break;
+        p->chunk++;
+        p->chunk_sample = 0;
+    }
+
+    if (p->sample >= sc->sample_count) {
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    if (!sc->keyframe_absent && (!sc->keyframe_count || p->sample+key_off == sc->keyframes[p->stss_index])) {
+        keyframe = 1;
+        if (p->stss_index + 1 < sc->keyframe_count)
+            p->stss_index++;
+    } else if (sc->stps_count && p->sample+key_off == sc->stps_data[p->stps_index]) {
+        keyframe = 1;
+        if (p->stps_index + 1 < sc->stps_count)
+            p->stps_index++;
+    }
+    if (rap_group_present && p->rap_group_index < sc->rap_group_count) {
+        if (sc->rap_group[p->rap_group_index].index > 0)
+            keyframe = 1;
+        if (++p->rap_group_sample == sc->rap_group[p->rap_group_index].count) {
+            p->rap_group_sample = 0;
+            p->rap_group_index++;
+        }
+    }
+    if (sc->keyframe_absent
+        && !sc->stps_count
+        && !rap_group_present
+        && (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || (!p->chunk && !p->chunk_sample)))
+         keyframe = 1;
+    if (keyframe)
+        p->distance = 0;
+    sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[p->sample];
+    ret = sc->pseudo_stream_id == -1 ||
+          sc->stsc_data[p->stsc_index].id - 1 == sc->pseudo_stream_id;
+    if (ret && sample_size > 0x3FFFFFFF) {
+        av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sample_size);
+        return AVERROR_INVALIDDATA;
+    }
+    e->pos = p->offset;
+    e->timestamp = p->dts;
+    e->size = sample_size;
+    e->min_distance = p->distance;
+    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+
+    p->offset += sample_size;
+    p->dts += sc->stts_data[p->stts_index].duration;
+
+    p->distance++;
+    p->stts_sample++;
+    p->sample++;
+    p->chunk_sample++;
+    if (p->stts_index + 1 < sc->stts_count && p->stts_sample == sc->stts_data[p->stts_index].count) {
+        p->stts_sample = 0;
+        p->stts_index++;
+    }
+
+    return ret;
+}
+
+/* Compute the index entries of a window of MOV_INDEX_WINDOW samples, and of
+ * the sample following it. */
+static int mov_load_index_window(MOVContext *mov, AVStream *st, unsigned int window)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    MOVIndexCheckpoint p;
+
+    sti->nb_index_entries = 0;
+    if (window >= sc->nb_index_checkpoints)
+        return AVERROR(EINVAL);
+    p = sc->index_checkpoints[window];
+    sc->index_base = p.sample;
+
+    while (sti->nb_index_entries <= MOV_INDEX_WINDOW && p.sample < sc->nb_lazy_samples) {
+        int ret = mov_index_next_sample(mov, st, &p, &sti->index_entries[sti->nb_index_entries]);
+        if (ret < 0)
+            return ret;
+        sti->nb_index_entries++;
+    }
+    return 0;
+}
+
+/*
+ * Record the parsing state every MOV_INDEX_WINDOW samples instead of building
+ * the index entries, which are then computed on demand from the sample tables.
+ */
+static int mov_build_lazy_index(MOVContext *mov, AVStream *st,
+                                MOVIndexCheckpoint *p, uint64_t *stream_size)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    AVIndexEntry e;
+    int ret;
+
+    sc->index_checkpoints = av_malloc_array(sc->sample_count / MOV_INDEX_WINDOW + 1,
+                                            sizeof(*sc->index_checkpoints));
+    if (!sc->index_checkpoints)
+        return AVERROR(ENOMEM);
+    if (av_reallocp_array(&sti->index_entries, MOV_INDEX_WINDOW + 1,
+                          sizeof(*sti->index_entries)) < 0)
+        return AVERROR(ENOMEM);
+    sti->index_entries_allocated_size = (MOV_INDEX_WINDOW + 1) * sizeof(*sti->index_entries);
+
+    for (;;) {
+        if (!(p->sample % MOV_INDEX_WINDOW))
+            sc->index_checkpoints[sc->nb_index_checkpoints] = *p;
+        if ((ret = mov_index_next_sample(mov, st, p, &e)) < 0)
+            break;
+        if (!((p->sample - 1) % MOV_INDEX_WINDOW))
+            sc->nb_index_checkpoints++;
+        *stream_size += e.size;
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && p->sample <= 100)
+            ff_rfps_add_frame(mov->fc, st, e.timestamp);
+    }
+    sc->nb_lazy_samples = p->sample;
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: lazy index of %u samples\n",
+           st->index, sc->nb_lazy_samples);
+
+    return mov_load_index_window(mov, st, 0);
+}
+
+/* Replace a lazy index by the index of all the samples. */
+static int mov_expand_lazy_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    MOVIndexCheckpoint p;
+    int ret;
+
+    if ((ret = mov_expand_ctts(sc)) < 0)
+        return ret;
+    if (sc->nb_lazy_samples >= UINT_MAX / sizeof(*sti->index_entries))
+        return AVERROR(ENOMEM);
+    if (av_reallocp_array(&sti->index_entries, FFMAX(sc->nb_lazy_samples, 1),
+                          sizeof(*sti->index_entries)) < 0) {
+        sti->nb_index_entries = 0;
+        return AVERROR(ENOMEM);
+    }
+    sti->index_entries_allocated_size = FFMAX(sc->nb_lazy_samples, 1) * sizeof(*sti->index_entries);
+
+    sti->nb_index_entries = 0;
+    if (sc->nb_index_checkpoints) {
+        p = sc->index_checkpoints[0];
+        while (sti->nb_index_entries < sc->nb_lazy_samples) {
+            ret = mov_index_next_sample(mov, st, &p, &sti->index_entries[sti->nb_index_entries]);
+            if (ret < 0)
+                return ret;
+            sti->nb_index_entries++;
+        }
+    }
+
+    sc->lazy_index = 0;
+    sc->index_base = 0;
+    sc->nb_index_checkpoints = 0;
+    av_freep(&sc->index_checkpoints);
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+    av_freep(&sc->stps_data);
+    av_freep(&sc->rap_group);
+
+    return 0;
+}
+
+/*
+ * Return the index entry of a sample, computing the window of entries
+ * holding it for a lazy index, or NULL if there is no such sample.
+ */
+static AVIndexEntry *mov_get_index_entry(MOVContext *mov, AVStream *st, int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+
+    if (!sc->lazy_index)
+        return sample >= 0 && sample < sti->nb_index_entries ? &sti->index_entries[sample] : NULL;
+
+    if (sample < 0 || sample >= sc->nb_lazy_samples)
+        return NULL;
+    if (sample < sc->index_base || sample - sc->index_base >= sti->nb_index_entries)
+        if (mov_load_index_window(mov, st, sample / MOV_INDEX_WINDOW) < 0)
+            return NULL;
+    return &sti->index_entries[sample - sc->index_base];
+}
+
+/*
+ * Search a lazy index like av_index_search_timestamp(): the window holding
+ * the timestamp is searched first, then the ones before or after it.
+ */
+static int mov_lazy_index_search_timestamp(MOVContext *mov, AVStream *st,
+                                           int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    int lo = 0, hi = (int)sc->nb_index_checkpoints - 1;
+
+    while (lo < hi) {
+        int mid = (lo + hi + 1) >> 1;
+        if (sc->index_checkpoints[mid].dts <= timestamp)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    for (int w = lo; w >= 0 && w < sc->nb_index_checkpoints;
+         w += flags & AVSEEK_FLAG_BACKWARD ? -1 : 1) {
+        int index;
+
+        if (mov_load_index_window(mov, st, w) < 0)
+            return -1;
+        index = ff_index_search_timestamp(sti->index_entries, sti->nb_index_entries,
+                                          timestamp, flags);
+        if (index >= 0)
+            return sc->index_base + index;
+    }
+    return -1;
+}
+
+/*
+ * Check whether an edit of the media, in the track timescale, leaves out some
+ * samples, which mov_fix_index() then discards or trims.
+ */
+static int mov_edit_trims_samples(const MOVStreamContext *sc,
+                                  int64_t media_time, int64_t duration)
+{
+    unsigned int stts_index = 0, stts_sample = 0;
+    unsigned int ctts_index = 0, ctts_sample = 0;
+    int64_t dts = 0;
+
+    for (unsigned int i = 0; i < sc->sample_count && stts_index < sc->stts_count; i++) {
+        int64_t pts = dts;
+        int64_t sample_duration = sc->stts_data[stts_index].duration;
+
+        if (ctts_index < sc->ctts_count) {
+            pts += sc->ctts_data[ctts_index].duration;
+            if (++ctts_sample == sc->ctts_data[ctts_index].count) {
+                ctts_sample = 0;
+                ctts_index++;
+            }
+        }
+        if (pts < media_time || pts + sample_duration > media_time + duration)
+            return 1;
+
+        dts += sample_duration;
+        if (++stts_sample == sc->stts_data[stts_index].count) {
+            stts_sample = 0;
+            stts_index++;
+        }
+    }
+    return 0;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
     FFStream *const sti = ffstream(st);
     int64_t current_offset;
     int64_t current_dts = 0;
-    unsigned int stts_index = 0;
     unsigned int stsc_index = 0;
-    unsigned int stss_index = 0;
-    unsigned int stps_index = 0;
-    unsigned int i, j;
+    unsigned int i;
     uint64_t stream_size = 0;
-    MOVCtts *ctts_data_old = sc->ctts_data;
-    unsigned int ctts_count_old = sc->ctts_count;
+    /* only use old uncompressed audio chunk demuxing when stts specifies it */
+    int audio_chunks = st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+                       sc->stts_count == 1 && sc->stts_data[0].duration == 1;
 
     int ret = build_open_gop_key_points(st);
     if (ret < 0)
         return;
 
+    sc->lazy_index = mov->lazy_index && !audio_chunks &&
+                     sc->sample_count > MOV_INDEX_WINDOW && !sti->nb_index_entries &&
+                     (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ||
+                      st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO);
+    /* the windows of a lazy index need all the samples to belong to the stream */
+    for (i = 0; sc->lazy_index && sc->pseudo_stream_id != -1 && i < sc->stsc_count; i++)
+        if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+            sc->lazy_index = 0;
+
     if (sc->elst_count) {
-        int i, edit_start_index = 0, multiple_edits = 0;
+        int i, edit_start_index = 0, multiple_edits = 0, advanced_editlist;
         int64_t empty_duration = 0; // empty duration of the first edit list entry
         int64_t start_time = 0; // start time of the media
 
@@ -4063,7 +4575,18 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             }
         }
 
-        if (multiple_edits && !mov->advanced_editlist)
+        /* a lazy index is not edited, the index of all the samples is needed
+         * unless the edit only shifts the timestamps */
+        if (sc->lazy_index && mov->advanced_editlist && !mov->ignore_editlist &&
+            (multiple_edits || (edit_start_index < sc->elst_count &&
+                                mov->time_scale > 0 &&
+                                mov_edit_trims_samples(sc, start_time,
+                                                       av_rescale(sc->elst_data[edit_start_index].duration,
+                                                                  sc->time_scale, mov->time_scale)))))
+            sc->lazy_index = 0;
+        advanced_editlist = mov->advanced_editlist && !sc->lazy_index;
+
+        if (multiple_edits && !advanced_editlist)
             av_log(mov->fc, AV_LOG_WARNING, "multiple edit list entries, "
                    "Use -advanced_editlist to correctly decode otherwise "
                    "a/v desync might occur\n");
@@ -4078,147 +4601,54 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
             sc->time_offset = start_time -  (uint64_t)empty_duration;
             sc->min_corrected_pts = start_time;
-            if (!mov->advanced_editlist)
+            if (!advanced_editlist)
                 current_dts = -sc->time_offset;
         }
 
-        if (!multiple_edits && !mov->advanced_editlist &&
+        if (!multiple_edits && !advanced_editlist &&
             st->codecpar->codec_id == AV_CODEC_ID_AAC && start_time > 0)
             sc->start_pad = start_time;
     }
 
-    /* only use old uncompressed audio chunk demuxing when stts specifies it */
-    if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
-          sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
-        unsigned int current_sample = 0;
-        unsigned int stts_sample = 0;
-        unsigned int sample_size;
-        unsigned int distance = 0;
-        unsigned int rap_group_index = 0;
-        unsigned int rap_group_sample = 0;
-        int rap_group_present = sc->rap_group_count && sc->rap_group;
-        int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+    if (!audio_chunks) {
+        MOVIndexCheckpoint p = { 0 };
+        AVIndexEntry e;
 
         current_dts -= sc->dts_shift;
+        p.dts = current_dts;
 
         if (!sc->sample_count || sti->nb_index_entries)
             return;
-        if (sc->sample_count >= UINT_MAX / sizeof(*sti->index_entries) - sti->nb_index_entries)
-            return;
-        if (av_reallocp_array(&sti->index_entries,
-                              sti->nb_index_entries + sc->sample_count,
-                              sizeof(*sti->index_entries)) < 0) {
-            sti->nb_index_entries = 0;
-            return;
-        }
-        sti->index_entries_allocated_size = (sti->nb_index_entries + sc->sample_count) * sizeof(*sti->index_entries);
 
-        if (ctts_data_old) {
-            // Expand ctts entries such that we have a 1-1 mapping with samples
-            if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        if (sc->lazy_index) {
+            if (mov_build_lazy_index(mov, st, &p, &stream_size) < 0)
                 return;
-            sc->ctts_count = 0;
-            sc->ctts_allocated_size = 0;
-            sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
-                                    sc->sample_count * sizeof(*sc->ctts_data));
-            if (!sc->ctts_data) {
-                av_free(ctts_data_old);
+        } else {
+            if (sc->sample_count >= UINT_MAX / sizeof(*sti->index_entries) - sti->nb_index_entries)
+                return;
+            if (av_reallocp_array(&sti->index_entries,
+                                  sti->nb_index_entries + sc->sample_count,
+                                  sizeof(*sti->index_entries)) < 0) {
+                sti->nb_index_entries = 0;
                 return;
             }
+            sti->index_entries_allocated_size = (sti->nb_index_entries + sc->sample_count) * sizeof(*sti->index_entries);
 
-            memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
-
-            for (i = 0; i < ctts_count_old &&
-                        sc->ctts_count < sc->sample_count; i++)
-                for (j = 0; j < ctts_data_old[i].count &&
-                            sc->ctts_count < sc->sample_count; j++)
-                    add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
-                                   &sc->ctts_allocated_size, 1,
-                                   ctts_data_old[i].duration);
-            av_free(ctts_data_old);
-        }
-
-        for (i = 0; i < sc->chunk_count; i++) {
-            int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
-            current_offset = sc->chunk_offsets[i];
-            while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
-                i + 1 == sc->stsc_data[stsc_index + 1].first)
-                stsc_index++;
-
-            if (next_offset > current_offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
-                sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - current_offset) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
+            if (mov_expand_ctts(sc) < 0)
+                return;
 
-            for (j = 0; j < sc->stsc_data[stsc_index].count; j++) {
-                int keyframe = 0;
-                if (current_sample >= sc->sample_count) {
-                    av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+            while ((ret = mov_index_next_sample(mov, st, &p, &e)) != AVERROR_EOF) {
+                if (ret < 0)
                     return;
-                }
-
-                if (!sc->keyframe_absent && (!sc->keyframe_count || current_sample+key_off == sc->keyframes[stss_index])) {
-                    keyframe = 1;
-                    if (stss_index + 1 < sc->keyframe_count)
-                        stss_index++;
-                } else if (sc->stps_count && current_sample+key_off == sc->stps_data[stps_index]) {
-                    keyframe = 1;
-                    if (stps_index + 1 < sc->stps_count)
-                        stps_index++;
-                }
-                if (rap_group_present && rap_group_index < sc->rap_group_count) {
-                    if (sc->rap_group[rap_group_index].index > 0)
-                        keyframe = 1;
-                    if (++rap_group_sample == sc->rap_group[rap_group_index].count) {
-                        rap_group_sample = 0;
-                        rap_group_index++;
-                    }
-                }
-                if (sc->keyframe_absent
-                    && !sc->stps_count
-                    && !rap_group_present
-                    && (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || (i==0 && j==0)))
-                     keyframe = 1;
-                if (keyframe)
-                    distance = 0;
-                sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[current_sample];
-                if (sc->pseudo_stream_id == -1 ||
-                   sc->stsc_data[stsc_index].id - 1 == sc->pseudo_stream_id) {
-                    AVIndexEntry *e;
-                    if (sample_size > 0x3FFFFFFF) {
-                        av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sample_size);
-                        return;
-                    }
-                    e = &sti->index_entries[sti->nb_index_entries++];
-                    e->pos = current_offset;
-                    e->timestamp = current_dts;
-                    e->size = sample_size;
-                    e->min_distance = distance;
-                    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
-                    av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
-                            "size %u, distance %u, keyframe %d\n", st->index, current_sample,
-                            current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && sti->nb_index_entries < 100)
-                        ff_rfps_add_frame(mov->fc, st, current_dts);
-                }
-
-                current_offset += sample_size;
-                stream_size += sample_size;
-
-                current_dts += sc->stts_data[stts_index].duration;
-
-                distance++;
-                stts_sample++;
-                current_sample++;
-                if (stts_index + 1 < sc->stts_count && stts_sample == sc->stts_data[stts_index].count) {
-                    stts_sample = 0;
-                    stts_index++;
-                }
+                stream_size += e.size;
+                if (!ret)
+                    continue;
+                sti->index_entries[sti->nb_index_entries++] = e;
+                av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
+                        "size %u, distance %u, keyframe %d\n", st->index, p.sample - 1,
+                        e.pos, e.timestamp, e.size, e.min_distance, !!(e.flags & AVINDEX_KEYFRAME));
+                if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && sti->nb_index_entries < 100)
+                    ff_rfps_add_frame(mov->fc, st, e.timestamp);
             }
         }
         if (st->duration > 0)
@@ -4325,7 +4755,7 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
     }
 
-    if (!mov->ignore_editlist && mov->advanced_editlist) {
+    if (!mov->ignore_editlist && mov->advanced_editlist && !sc->lazy_index) {
         // Fix index according to edit lists.
         mov_fix_index(mov, st);
     }
@@ -4569,6 +4999,9 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             ffstream(st)->need_parsing = AVSTREAM_PARSE_FULL;
     }
+    /* A lazy index is computed from the sample tables. */
+    if (sc->lazy_index)
+        return 0;
     /* Do not need those anymore. */
     av_freep(&sc->chunk_offsets);
     av_freep(&sc->sample_sizes);
@@ -5066,7 +5499,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -5093,6 +5526,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if (sc->lazy_index && (ret = mov_expand_lazy_index(c, st)) < 0)
+        return ret;
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -8220,6 +8655,7 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->open_key_samples);
         av_freep(&sc->display_matrix);
         av_freep(&sc->index_ranges);
+        av_freep(&sc->index_checkpoints);
 
         if (sc->extradata)
             for (j = 0; j < sc->stsd_count; j++)
@@ -8614,15 +9050,15 @@ static int mov_read_header(AVFormatContext *s)
 
 static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
 {
+    MOVContext *mov = s->priv_data;
     AVIndexEntry *sample = NULL;
     int64_t best_dts = INT64_MAX;
     int i;
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
-        FFStream *const avsti = ffstream(avst);
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avsti->nb_index_entries) {
-            AVIndexEntry *current_sample = &avsti->index_entries[msc->current_sample];
+        AVIndexEntry *current_sample;
+        if (msc->pb && (current_sample = mov_get_index_entry(mov, avst, msc->current_sample))) {
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) && current_sample->pos < sample->pos) ||
@@ -8730,7 +9166,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, lazy_sample;
     AVStream *st = NULL;
     int64_t current_index;
     int ret;
@@ -8745,6 +9181,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    /* the window of entries holding the sample can be replaced below */
+    if (sc->lazy_index) {
+        lazy_sample = *sample;
+        sample = &lazy_sample;
+    }
     /* must be done just before reading, to avoid infinite loop on sample */
     current_index = sc->current_index;
     mov_current_sample_inc(sc);
@@ -8755,7 +9196,15 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     }
 
     if (st->discard != AVDISCARD_ALL) {
-        int64_t ret64 = avio_seek(sc->pb, sample->pos, SEEK_SET);
+        int64_t ret64;
+
+        /* check before seeking so that skipped samples are never read */
+        if (st->discard == AVDISCARD_NONKEY && !(sample->flags & AVINDEX_KEYFRAME)) {
+            av_log(mov->fc, AV_LOG_DEBUG, "Nonkey frame from stream %d discarded due to AVDISCARD_NONKEY\n", sc->ffindex);
+            goto retry;
+        }
+
+        ret64 = avio_seek(sc->pb, sample->pos, SEEK_SET);
         if (ret64 != sample->pos) {
             av_log(mov->fc, AV_LOG_ERROR, "stream %d, offset 0x%"PRIx64": partial file\n",
                    sc->ffindex, sample->pos);
@@ -8767,11 +9216,6 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             return AVERROR_INVALIDDATA;
         }
 
-        if (st->discard == AVDISCARD_NONKEY && !(sample->flags & AVINDEX_KEYFRAME)) {
-            av_log(mov->fc, AV_LOG_DEBUG, "Nonkey frame from stream %d discarded due to AVDISCARD_NONKEY\n", sc->ffindex);
-            goto retry;
-        }
-
         if (st->codecpar->codec_id == AV_CODEC_ID_EIA_608 && sample->size > 8)
             ret = get_eia608_packet(sc->pb, pkt, sample->size);
         else
@@ -8825,8 +9269,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < ffstream(st)->nb_index_entries) ?
-            ffstream(st)->index_entries[sc->current_sample].timestamp : st->duration;
+        AVIndexEntry *next = mov_get_index_entry(mov, st, sc->current_sample);
+        int64_t next_dts = next ? next->timestamp : st->duration;
 
         if (next_dts >= pkt->dts)
             pkt->duration = next_dts - pkt->dts;
@@ -8883,6 +9327,13 @@ static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp
     index = search_frag_timestamp(s, &mov->frag_index, st, timestamp);
     if (index < 0)
         index = 0;
+    /* The fragment was selected from the time of any of its tracks, the
+     * requested sample of this stream may be in the previous one. */
+    if (index > 0 && !mov->frag_index.item[index - 1].headers_read) {
+        int ret = mov_switch_root(s, -1, index - 1);
+        if (ret < 0)
+            return ret;
+    }
     if (!mov->frag_index.item[index].headers_read)
         return mov_switch_root(s, -1, index);
     if (index + 1 < mov->frag_index.nb_items)
@@ -8908,10 +9359,9 @@ static int is_open_key_sample(const MOVStreamContext *sc, int sample)
  * Some key sample may be key frames but not IDR frames, so a random access to
  * them may not be allowed.
  */
-static int can_seek_to_key_sample(AVStream *st, int sample, int64_t requested_pts)
+static int can_seek_to_key_sample(MOVContext *mov, AVStream *st, int sample, int64_t requested_pts)
 {
     MOVStreamContext *sc = st->priv_data;
-    FFStream *const sti = ffstream(st);
     int64_t key_sample_dts, key_sample_pts;
 
     if (st->codecpar->codec_id != AV_CODEC_ID_HEVC)
@@ -8920,7 +9370,7 @@ static int can_seek_to_key_sample(AVStream *st, int sample, int64_t requested_pt
     if (sample >= sc->sample_offsets_count)
         return 1;
 
-    key_sample_dts = sti->index_entries[sample].timestamp;
+    key_sample_dts = mov_get_index_entry(mov, st, sample)->timestamp;
     key_sample_pts = key_sample_dts + sc->sample_offsets[sample] + sc->dts_shift;
 
     /*
@@ -8936,8 +9386,9 @@ static int can_seek_to_key_sample(AVStream *st, int sample, int64_t requested_pt
 
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
+    MOVContext *mov = s->priv_data;
     MOVStreamContext *sc = st->priv_data;
-    FFStream *const sti = ffstream(st);
+    AVIndexEntry *first;
     int sample, time_sample, ret;
     unsigned int i;
 
@@ -8950,14 +9401,17 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
         return ret;
 
     for (;;) {
-        sample = av_index_search_timestamp(st, timestamp, flags);
+        if (sc->lazy_index)
+            sample = mov_lazy_index_search_timestamp(mov, st, timestamp, flags);
+        else
+            sample = av_index_search_timestamp(st, timestamp, flags);
         av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-        if (sample < 0 && sti->nb_index_entries && timestamp < sti->index_entries[0].timestamp)
+        if (sample < 0 && (first = mov_get_index_entry(mov, st, 0)) && timestamp < first->timestamp)
             sample = 0;
         if (sample < 0) /* not sure what to do */
             return AVERROR_INVALIDDATA;
 
-        if (!sample || can_seek_to_key_sample(st, sample, timestamp))
+        if (!sample || can_seek_to_key_sample(mov, st, sample, timestamp))
             break;
         timestamp -= FFMAX(sc->min_sample_duration, 1);
     }
@@ -8996,12 +9450,11 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     return sample;
 }
 
-static int64_t mov_get_skip_samples(AVStream *st, int sample)
+static int64_t mov_get_skip_samples(MOVContext *mov, AVStream *st, int sample)
 {
     MOVStreamContext *sc = st->priv_data;
-    FFStream *const sti = ffstream(st);
-    int64_t first_ts = sti->index_entries[0].timestamp;
-    int64_t ts = sti->index_entries[sample].timestamp;
+    int64_t first_ts = mov_get_index_entry(mov, st, 0)->timestamp;
+    int64_t ts = mov_get_index_entry(mov, st, sample)->timestamp;
     int64_t off;
 
     if (st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
@@ -9032,8 +9485,8 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = sti->index_entries[sample].timestamp;
-        sti->skip_samples = mov_get_skip_samples(st, sample);
+        int64_t seek_timestamp = mov_get_index_entry(mc, st, sample)->timestamp;
+        sti->skip_samples = mov_get_skip_samples(mc, st, sample);
 
         for (i = 0; i < s->nb_streams; i++) {
             AVStream *const st  = s->streams[i];
@@ -9046,7 +9499,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
             timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
             sample = mov_seek_stream(s, st, timestamp, flags);
             if (sample >= 0)
-                sti->skip_samples = mov_get_skip_samples(st, sample);
+                sti->skip_samples = mov_get_skip_samples(mc, st, sample);
         }
     } else {
         for (i = 0; i < s->nb_streams; i++) {
@@ -9088,6 +9541,14 @@ static const AVOption mov_options[] = {
         0, 1, FLAGS},
     {"ignore_chapters", "", OFFSET(ignore_chapters), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
+    {"lazy_index",
+        "Compute the sample index of the tracks on demand instead of when opening the file, except for the tracks whose edit list leaves out samples.",
+        OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
+    {"lazy_frag_index",
+        "Build the fragment index from a scan of the moof atoms and parse the fragments on demand.",
+        OFFSET(lazy_frag_index), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
     {"use_mfra_for",
         "use mfra for fragment timestamps",
         OFFSET(use_mfra_for), AV_OPT_TYPE_INT, {.i64 = FF_MOV_FLAG_MFRA_AUTO},
@@ -72,6 +72,7 @@ static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "rtphint", "Add RTP hint tracks", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RTP_HINT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "moov_size", "maximum moov size so it can be placed at the begin", offsetof(MOVMuxContext, reserved_moov_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, 0 },
+    { "faststart_reserve", "reserve the estimated moov size for faststart instead of moving the data", offsetof(MOVMuxContext, faststart_reserve), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM, 0 },
     { "empty_moov", "Make the initial moov atom empty", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_EMPTY_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_keyframe", "Fragment at video keyframes", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_KEYFRAME}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_every_frame", "Fragment at every frame", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_EVERY_FRAME}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -4985,7 +4986,8 @@ static int mov_write_traf_tag(AVIOContext *pb, MOVMuxContext *mov,
 }
 
 static int mov_write_moof_tag_internal(AVIOContext *pb, MOVMuxContext *mov,
-                                       int tracks, int moof_size)
+                                       int tracks, int moof_size,
+                                       int64_t moof_offset)
 {
     int64_t pos = avio_tell(pb);
     int i;
@@ -5001,7 +5003,7 @@ static int mov_write_moof_tag_internal(AVIOContext *pb, MOVMuxContext *mov,
             continue;
         if (!track->entry)
             continue;
-        mov_write_traf_tag(pb, mov, track, pos, moof_size);
+        mov_write_traf_tag(pb, mov, track, moof_offset, moof_size);
     }
 
     return update_size(pb, pos);
@@ -5161,11 +5163,12 @@ static int mov_write_moof_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks,
                               int64_t mdat_size)
 {
     AVIOContext *avio_buf;
+    uint8_t *buf;
     int ret, moof_size;
 
     if ((ret = ffio_open_null_buf(&avio_buf)) < 0)
         return ret;
-    mov_write_moof_tag_internal(avio_buf, mov, tracks, 0);
+    mov_write_moof_tag_internal(avio_buf, mov, tracks, 0, 0);
     moof_size = ffio_close_null_buf(avio_buf);
 
     if (mov->flags & FF_MOV_FLAG_DASH &&
@@ -5186,7 +5189,26 @@ static int mov_write_moof_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks,
         }
     }
 
-    return mov_write_moof_tag_internal(pb, mov, tracks, moof_size);
+    /* The tfrf offsets recorded in ISM mode must be positions in pb. */
+    if (mov->mode == MODE_ISM)
+        return mov_write_moof_tag_internal(pb, mov, tracks, moof_size,
+                                           avio_tell(pb));
+
+    /* Serialize the moof in memory, so that the box sizes are patched
+     * there and the output gets it in one contiguous write without
+     * seeking back, even if pb is not seekable. */
+    if ((ret = avio_open_dyn_buf(&avio_buf)) < 0)
+        return ret;
+    mov_write_moof_tag_internal(avio_buf, mov, tracks, moof_size,
+                                avio_tell(pb));
+    ret = avio_close_dyn_buf(avio_buf, &buf);
+    if (ret != moof_size) {
+        av_free(buf);
+        return ret < 0 ? ret : AVERROR(ENOMEM);
+    }
+    avio_write(pb, buf, moof_size);
+    av_free(buf);
+    return moof_size;
 }
 
 static int mov_write_tfra_tag(AVIOContext *pb, MOVTrack *track)
@@ -5868,7 +5890,8 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         if (write_moof) {
             avio_write_marker(s->pb, AV_NOPTS_VALUE, AVIO_DATA_MARKER_FLUSH_POINT);
 
-            mov_write_moof_tag(s->pb, mov, moof_tracks, mdat_size);
+            if ((ret = mov_write_moof_tag(s->pb, mov, moof_tracks, mdat_size)) < 0)
+                return ret;
             mov->fragments++;
 
             avio_wb32(s->pb, mdat_size + 8);
@@ -6828,6 +6851,49 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/*
+ * Estimate the size of the moov atom from the frame count or duration hints
+ * of the streams, or return 0 if a stream has neither. The sample tables are
+ * assumed not to be compacted (a chunk per sample, 64-bit chunk offsets) so
+ * the estimate errs on the large side.
+ */
+static int64_t estimate_moov_size(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int64_t size = 4096 + 1024 * s->nb_chapters;
+
+    if (mov->flags & FF_MOV_FLAG_RTP_HINT)
+        return 0;
+
+    for (int i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        int64_t nb_samples = st->nb_frames;
+        int entry_size = 4 + 8 + 12; /* stsz, co64 and stsc entries */
+
+        if (nb_samples <= 0 && st->duration > 0) {
+            AVRational rate = { 1, 1 };
+
+            if (par->codec_type == AVMEDIA_TYPE_VIDEO)
+                rate = st->avg_frame_rate.num ? st->avg_frame_rate : st->r_frame_rate;
+            else if (par->codec_type == AVMEDIA_TYPE_AUDIO)
+                rate = (AVRational){ par->sample_rate,
+                                     par->frame_size > 0 ? par->frame_size : 1024 };
+            if (rate.num > 0 && rate.den > 0)
+                nb_samples = av_rescale_q_rnd(st->duration, st->time_base,
+                                              av_inv_q(rate), AV_ROUND_UP);
+        }
+        if (nb_samples <= 0)
+            return 0;
+
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO)
+            entry_size += 8 + 8 + 4; /* stts, ctts and stss entries */
+        size += 1024 + par->extradata_size + nb_samples * entry_size;
+    }
+
+    return size;
+}
+
 static int mov_init(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6887,7 +6953,21 @@ static int mov_init(AVFormatContext *s)
     }
 
     if (mov->flags & FF_MOV_FLAG_FASTSTART) {
-        mov->reserved_moov_size = -1;
+        if (mov->flags & FF_MOV_FLAG_FRAGMENT || mov->mode == MODE_AVIF) {
+            mov->reserved_moov_size = -1;
+        } else if (!mov->reserved_moov_size && mov->faststart_reserve) {
+            int64_t size = estimate_moov_size(s);
+            if (size > 0 && size <= INT_MAX) {
+                av_log(s, AV_LOG_VERBOSE, "Reserving %"PRId64" bytes for the moov atom\n", size);
+                mov->reserved_moov_size = size;
+            } else {
+                av_log(s, AV_LOG_WARNING, "Cannot estimate the moov size, "
+                       "set the stream durations or moov_size\n");
+                mov->reserved_moov_size = -1;
+            }
+        } else if (!mov->reserved_moov_size) {
+            mov->reserved_moov_size = -1;
+        }
     }
 
     if (mov->use_editlist < 0) {
@@ -7332,7 +7412,7 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else if (mov->mode != MODE_AVIF) {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->reserved_moov_size < 0)
             mov->reserved_header_pos = avio_tell(pb);
         mov_write_mdat_tag(pb, mov);
     }
@@ -7550,9 +7630,24 @@ static int mov_write_trailer(AVFormatContext *s)
             ffio_wfourcc(pb, "mdat");
             avio_wb64(pb, mov->mdat_size + 16);
         }
+
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size > 0) {
+            /* If the moov does not fit in the reserved space, turn it into
+             * a free atom and fall back to moving the data after it. */
+            if ((res = get_moov_size(s)) < 0)
+                return res;
+            if (res + 8 > mov->reserved_moov_size) {
+                av_log(s, AV_LOG_WARNING, "The moov atom needs %d bytes but only %d "
+                       "were reserved\n", res, mov->reserved_moov_size);
+                avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
+                avio_wb32(pb, mov->reserved_moov_size);
+                ffio_wfourcc(pb, "free");
+                mov->reserved_moov_size = -1;
+            }
+        }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_header_pos : moov_pos, SEEK_SET);
 
-        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->reserved_moov_size < 0) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
             if (res < 0)
@@ -89,6 +89,8 @@ static int mp3_read_probe(const AVProbeData *p)
             int available;
 
             header = AV_RB32(buf2);
+            if (ff_mpa_check_header(header) < 0)
+                break;
             ret = avpriv_mpegaudio_decode_header(&h, header);
             if (ret != 0)
                 break;
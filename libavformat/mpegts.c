@@ -127,6 +127,20 @@ struct Program {
     int pmt_found;
 };
 
+#define SPLIT_PACKETS      7 /* TS packets per output packet, as in a UDP datagram */
+#define MAX_SPLIT_PROGRAMS 64
+
+/** program whose TS packets are output as their own stream by the raw demuxer */
+struct SplitProgram {
+    int sid;
+    int pmt_pid;
+    AVStream *st;
+    AVBufferRef *buf;   ///< TS packets not output yet
+    int nb_packets;
+    int64_t pos;        ///< position of the first of them
+    int pat_cc;         ///< continuity counter of the PAT of this program
+};
+
 struct MpegTSContext {
     const AVClass *class;
     /* user data */
@@ -180,6 +194,15 @@ struct MpegTSContext {
 
     AVStream *epg_stream;
     AVBufferPool* pools[32];
+
+    /** raw demuxer: output the TS packets of each program as its own stream */
+    int split_programs;
+    struct SplitProgram *split;
+    int nb_split;
+    /** for each PID, mask of the split programs it belongs to */
+    uint64_t *split_pids;
+    int split_pat_version;
+    AVBufferPool *split_pool;
 };
 
 #define MPEGTS_OPTIONS \
@@ -222,6 +245,9 @@ static const AVOption raw_options[] = {
       offsetof(MpegTSContext, raw_packet_size), AV_OPT_TYPE_INT,
       { .i64 = 0 }, 0, 0,
       AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "split_programs", "output the TS packets of each program as a separate stream",
+      offsetof(MpegTSContext, split_programs), AV_OPT_TYPE_BOOL,
+      { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -2615,6 +2641,121 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
     }
 }
 
+static struct SplitProgram *get_split_program(MpegTSContext *ts, int sid)
+{
+    for (int i = 0; i < ts->nb_split; i++)
+        if (ts->split[i].sid == sid)
+            return &ts->split[i];
+    return NULL;
+}
+
+static void split_pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    struct SplitProgram *sp;
+    uint64_t bit;
+    int pcr_pid, len;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PMT_TID || !h->current_next)
+        return;
+    if (skip_identical(h, &filter->u.section_filter))
+        return;
+    sp = get_split_program(ts, h->id);
+    if (!sp || sp->pmt_pid != filter->pid)
+        return;
+
+    bit = 1ULL << (sp - ts->split);
+    for (int i = 0; i < NB_PID_MAX; i++)
+        ts->split_pids[i] &= ~bit;
+    ts->split_pids[sp->pmt_pid] |= bit;
+
+    pcr_pid = get16(&p, p_end);
+    if (pcr_pid < 0)
+        return;
+    pcr_pid &= 0x1fff;
+    if (pcr_pid != NULL_PID)
+        ts->split_pids[pcr_pid] |= bit;
+    len = get16(&p, p_end);
+    if (len < 0)
+        return;
+    p += len & 0xfff;
+
+    while (p_end - p >= 5) {
+        ts->split_pids[AV_RB16(p + 1) & 0x1fff] |= bit;
+        p += 5 + (AV_RB16(p + 3) & 0xfff);
+    }
+}
+
+static void split_pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    AVFormatContext *s = ts->stream;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    int sid, pmt_pid;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PAT_TID || !h->current_next)
+        return;
+    if (skip_identical(h, &filter->u.section_filter))
+        return;
+    s->ts_id = h->id;
+    ts->split_pat_version = h->version;
+
+    while ((sid = get16(&p, p_end)) >= 0 && (pmt_pid = get16(&p, p_end)) >= 0) {
+        struct SplitProgram *sp = get_split_program(ts, sid);
+        pmt_pid &= 0x1fff;
+
+        if (!sid)
+            continue;
+        if (!sp) {
+            AVProgram *program;
+            AVStream *st;
+
+            if (ts->nb_split >= MAX_SPLIT_PROGRAMS) {
+                av_log(s, AV_LOG_WARNING, "Not splitting program %d, "
+                       "only %d programs are supported\n", sid, MAX_SPLIT_PROGRAMS);
+                continue;
+            }
+            sp = av_realloc_array(ts->split, ts->nb_split + 1, sizeof(*ts->split));
+            if (!sp)
+                return;
+            ts->split = sp;
+            if (!(st = avformat_new_stream(s, NULL)))
+                return;
+            st->id                   = sid;
+            st->codecpar->codec_type = AVMEDIA_TYPE_DATA;
+            st->codecpar->codec_id   = AV_CODEC_ID_MPEG2TS;
+            avpriv_set_pts_info(st, 60, 1, 27000000);
+            if ((program = av_new_program(s, sid))) {
+                program->program_num = sid;
+                program->pmt_pid     = pmt_pid;
+                av_program_add_stream_index(s, sid, st->index);
+            }
+            sp  = &ts->split[ts->nb_split++];
+            *sp = (struct SplitProgram){ .sid = sid, .pmt_pid = -1, .st = st };
+        }
+        if (sp->pmt_pid != pmt_pid) {
+            uint64_t bit = 1ULL << (sp - ts->split);
+            if (sp->pmt_pid >= 0)
+                ts->split_pids[sp->pmt_pid] &= ~bit;
+            ts->split_pids[pmt_pid] |= bit;
+            sp->pmt_pid = pmt_pid;
+        }
+        if (!ts->pids[pmt_pid])
+            mpegts_open_section_filter(ts, pmt_pid, split_pmt_cb, ts, 1);
+    }
+}
+
 static void eit_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
 {
     MpegTSContext *ts = filter->u.section_filter.opaque;
@@ -2965,6 +3106,45 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Handle the TS packets that are already complete in the I/O buffer in one
+ * go, instead of reading them one by one: the sync bytes of the whole block
+ * are checked first and packets of PIDs without a filter are dropped before
+ * any further parsing.
+ * @return the number of packets consumed or a negative error code
+ */
+static int handle_buffered_packets(MpegTSContext *ts, int max_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const int stride = ts->raw_packet_size;
+    const uint8_t *buf = pb->buf_ptr;
+    int64_t pos = avio_tell(pb) + TS_PACKET_SIZE;
+    int nb_packets = FFMIN((pb->buf_end - pb->buf_ptr) / stride, max_packets);
+    int i, ret = 0;
+
+    /* packets without sync byte are left to the regular path for resyncing */
+    for (i = 0; i < nb_packets; i++)
+        if (buf[i * stride] != 0x47)
+            break;
+    nb_packets = i;
+
+    for (i = 0; i < nb_packets && !ts->stop_parse; i++) {
+        const uint8_t *packet = buf + i * stride;
+        int pid = AV_RB16(packet + 1) & 0x1fff;
+
+        if (!ts->pids[pid] && !(ts->auto_guess && packet[1] & 0x40))
+            continue;
+        ret = handle_packet(ts, packet, pos + i * stride);
+        if (ret != 0) {
+            i++;
+            break;
+        }
+    }
+    avio_skip(pb, i * stride);
+
+    return ret < 0 ? ret : i;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -3006,6 +3186,18 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        if (s->pb->buf_end - s->pb->buf_ptr >= ts->raw_packet_size) {
+            ret = handle_buffered_packets(ts, nb_packets ? FFMIN(nb_packets - packet_num, INT_MAX)
+                                                         : INT_MAX);
+            if (ret < 0)
+                break;
+            if (ret > 0) {
+                packet_num += ret - 1;
+                ret = 0;
+                continue;
+            }
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -3134,6 +3326,20 @@ static int mpegts_read_header(AVFormatContext *s)
 
         av_log(ts->stream, AV_LOG_TRACE, "tuning done\n");
 
+        s->ctx_flags |= AVFMTCTX_NOHEADER;
+    } else if (ts->split_programs) {
+        /* only read packets, routed per program */
+
+        ts->split_pids = av_calloc(NB_PID_MAX, sizeof(*ts->split_pids));
+        ts->split_pool = av_buffer_pool_init(SPLIT_PACKETS * TS_PACKET_SIZE +
+                                             AV_INPUT_BUFFER_PADDING_SIZE, NULL);
+        if (!ts->split_pids || !ts->split_pool)
+            return AVERROR(ENOMEM);
+
+        seek_back(s, pb, pos);
+        mpegts_open_section_filter(ts, PAT_PID, split_pat_cb, ts, 1);
+        handle_packets(ts, probesize / ts->raw_packet_size);
+
         s->ctx_flags |= AVFMTCTX_NOHEADER;
     } else {
         AVStream *st;
@@ -3199,6 +3405,130 @@ static int mpegts_read_header(AVFormatContext *s)
 
 #define MAX_PACKET_READAHEAD ((128 * 1024) / 188)
 
+/* Write a PAT listing only the program sp. */
+static void split_write_pat(MpegTSContext *ts, struct SplitProgram *sp, uint8_t *buf)
+{
+    uint8_t *section = buf + 5;
+
+    buf[0] = 0x47;
+    buf[1] = 0x40 | PAT_PID >> 8;
+    buf[2] = PAT_PID & 0xff;
+    buf[3] = 0x10 | sp->pat_cc;
+    buf[4] = 0; /* pointer field */
+    sp->pat_cc = (sp->pat_cc + 1) & 0xf;
+
+    section[0] = PAT_TID;
+    AV_WB16(section + 1, 0xb000 | 13);
+    AV_WB16(section + 3, ts->stream->ts_id);
+    section[5] = 0xc1 | ts->split_pat_version << 1;
+    section[6] = 0;
+    section[7] = 0;
+    AV_WB16(section + 8, sp->sid);
+    AV_WB16(section + 10, 0xe000 | sp->pmt_pid);
+    AV_WL32(section + 12, av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1, section, 12));
+    memset(section + 16, 0xff, TS_PACKET_SIZE - 5 - 16);
+}
+
+/* Append a TS packet to the pending ones of sp, or its PAT if packet is NULL. */
+static int split_add_packet(MpegTSContext *ts, struct SplitProgram *sp,
+                            const uint8_t *packet, int64_t pos)
+{
+    uint8_t *dst;
+
+    if (!sp->buf) {
+        if (!(sp->buf = av_buffer_pool_get(ts->split_pool)))
+            return AVERROR(ENOMEM);
+        sp->pos = pos;
+    }
+    dst = sp->buf->data + sp->nb_packets++ * TS_PACKET_SIZE;
+    if (packet)
+        memcpy(dst, packet, TS_PACKET_SIZE);
+    else
+        split_write_pat(ts, sp, dst);
+
+    return 0;
+}
+
+static void split_output_packets(struct SplitProgram *sp, AVPacket *pkt)
+{
+    pkt->buf  = sp->buf;
+    pkt->data = sp->buf->data;
+    pkt->size = sp->nb_packets * TS_PACKET_SIZE;
+    memset(pkt->data + pkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    pkt->stream_index = sp->st->index;
+    pkt->pos          = sp->pos;
+    sp->buf        = NULL;
+    sp->nb_packets = 0;
+}
+
+/*
+ * Route each TS packet to the programs using its PID, the PAT being
+ * replaced by one listing only the program and the SI tables going to
+ * all of them. The packets are copied once, into the output packet.
+ */
+static int mpegts_split_read_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    MpegTSContext *ts = s->priv_data;
+    uint8_t packet[TS_PACKET_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
+    const uint8_t *data;
+    int ret, i;
+
+    if (avio_tell(s->pb) != ts->last_pos) {
+        /* seek detected, drop the pending packets */
+        for (i = 0; i < ts->nb_split; i++) {
+            av_buffer_unref(&ts->split[i].buf);
+            ts->split[i].nb_packets = 0;
+        }
+    }
+
+    for (;;) {
+        uint64_t mask;
+        int64_t pos;
+        int pid;
+
+        for (i = 0; i < ts->nb_split; i++) {
+            if (ts->split[i].nb_packets == SPLIT_PACKETS) {
+                split_output_packets(&ts->split[i], pkt);
+                ts->last_pos = avio_tell(s->pb);
+                return 0;
+            }
+        }
+
+        ret = read_packet(s, packet, ts->raw_packet_size, &data);
+        if (ret < 0) {
+            for (i = 0; i < ts->nb_split; i++) {
+                if (ts->split[i].nb_packets) {
+                    split_output_packets(&ts->split[i], pkt);
+                    return 0;
+                }
+            }
+            return ret;
+        }
+        pos = avio_tell(s->pb);
+        /* update the PAT and PMT filters */
+        if ((ret = handle_packet(ts, data, pos)) < 0)
+            return ret;
+
+        pid = AV_RB16(data + 1) & 0x1fff;
+        if (pid == PAT_PID)
+            mask = data[1] & 0x40 ? UINT64_MAX : 0;
+        else if (pid >= NIT_PID && pid <= TDT_PID)
+            mask = UINT64_MAX;
+        else
+            mask = ts->split_pids[pid];
+        for (i = 0; i < ts->nb_split && mask; i++, mask >>= 1) {
+            if (mask & 1) {
+                ret = split_add_packet(ts, &ts->split[i], pid == PAT_PID ? NULL : data,
+                                       pos - TS_PACKET_SIZE);
+                if (ret < 0)
+                    return ret;
+            }
+        }
+        finished_reading_packet(s, ts->raw_packet_size);
+        ts->last_pos = avio_tell(s->pb);
+    }
+}
+
 static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MpegTSContext *ts = s->priv_data;
@@ -3208,6 +3538,9 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
     uint8_t pcr_buf[12];
     const uint8_t *data;
 
+    if (ts->split_programs)
+        return mpegts_split_read_packet(s, pkt);
+
     if ((ret = av_new_packet(pkt, TS_PACKET_SIZE)) < 0)
         return ret;
     ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
@@ -3288,6 +3621,12 @@ static void mpegts_free(MpegTSContext *ts)
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
             mpegts_close_filter(ts, ts->pids[i]);
+
+    for (i = 0; i < ts->nb_split; i++)
+        av_buffer_unref(&ts->split[i].buf);
+    av_freep(&ts->split);
+    av_freep(&ts->split_pids);
+    av_buffer_pool_uninit(&ts->split_pool);
 }
 
 static int mpegts_read_close(AVFormatContext *s)
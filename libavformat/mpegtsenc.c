@@ -126,6 +126,12 @@ typedef struct MpegTSWrite {
     uint8_t provider_name[256];
 
     int omit_video_pes_length;
+
+    /* TS packets not written to the AVIOContext yet, with their M2TS header */
+#define TS_BATCH_PACKETS 32
+    uint8_t batch[TS_BATCH_PACKETS * (TS_PACKET_SIZE + 4)];
+    int batch_size;
+    uint8_t null_packet[TS_PACKET_SIZE];
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -953,17 +959,30 @@ static int64_t get_pcr(const MpegTSWrite *ts)
            ts->first_pcr;
 }
 
+static void flush_packets(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    avio_write(s->pb, ts->batch, ts->batch_size);
+    ts->batch_size = 0;
+}
+
+/* Queue a TS packet, they are written to the AVIOContext in batches. */
 static void write_packet(AVFormatContext *s, const uint8_t *packet)
 {
     MpegTSWrite *ts = s->priv_data;
+    uint8_t *q;
+
+    if (ts->batch_size > sizeof(ts->batch) - (TS_PACKET_SIZE + 4))
+        flush_packets(s);
+    q = ts->batch + ts->batch_size;
     if (ts->m2ts_mode) {
         int64_t pcr = get_pcr(s->priv_data);
-        uint32_t tp_extra_header = pcr % 0x3fffffff;
-        tp_extra_header = AV_RB32(&tp_extra_header);
-        avio_write(s->pb, (unsigned char *) &tp_extra_header,
-                   sizeof(tp_extra_header));
+        AV_WB32(q, pcr % 0x3fffffff);
+        q += 4;
     }
-    avio_write(s->pb, packet, TS_PACKET_SIZE);
+    memcpy(q, packet, TS_PACKET_SIZE);
+    ts->batch_size = q + TS_PACKET_SIZE - ts->batch;
     ts->total_size += TS_PACKET_SIZE;
 }
 
@@ -1125,6 +1144,11 @@ static int mpegts_init(AVFormatContext *s)
         }
     }
 
+    memset(ts->null_packet, 0xff, TS_PACKET_SIZE);
+    ts->null_packet[0] = 0x47;
+    ts->null_packet[1] = 0x1f;
+    ts->null_packet[3] = 0x10;
+
     ts->pat.pid          = PAT_PID;
     /* Initialize at 15 so that it wraps and is equal to 0 for the
      * first packet we write. */
@@ -1326,6 +1350,13 @@ static void retransmit_si_info(AVFormatContext *s, int force_pat, int force_sdt,
     }
 }
 
+static int si_info_due(MpegTSWrite *ts, int64_t pcr)
+{
+    return ts->last_sdt_ts == AV_NOPTS_VALUE || pcr - ts->last_sdt_ts >= ts->sdt_period ||
+           ts->last_pat_ts == AV_NOPTS_VALUE || pcr - ts->last_pat_ts >= ts->pat_period ||
+           ts->last_nit_ts == AV_NOPTS_VALUE || pcr - ts->last_nit_ts >= ts->nit_period;
+}
+
 static int write_pcr_bits(uint8_t *buf, int64_t pcr)
 {
     int64_t pcr_low = pcr % 300, pcr_high = pcr / 300;
@@ -1343,16 +1374,8 @@ static int write_pcr_bits(uint8_t *buf, int64_t pcr)
 /* Write a single null transport stream packet */
 static void mpegts_insert_null_packet(AVFormatContext *s)
 {
-    uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
-
-    q    = buf;
-    *q++ = 0x47;
-    *q++ = 0x00 | 0x1f;
-    *q++ = 0xff;
-    *q++ = 0x10;
-    memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
-    write_packet(s, buf);
+    MpegTSWrite *ts = s->priv_data;
+    write_packet(s, ts->null_packet);
 }
 
 /* Write a single transport stream packet with a PCR and no payload */
@@ -1536,10 +1559,16 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             }
             if (dts != AV_NOPTS_VALUE && (dts - pcr / 300) > delay) {
                 /* pcr insert gets priority over null packet insert */
-                if (write_pcr)
+                if (write_pcr) {
                     mpegts_insert_pcr_only(s, st);
-                else
-                    mpegts_insert_null_packet(s);
+                } else {
+                    /* keep padding while no PCR or SI packet is due */
+                    do {
+                        mpegts_insert_null_packet(s);
+                        pcr = get_pcr(ts);
+                    } while (pcr < ts->next_pcr && (dts - pcr / 300) > delay &&
+                             !si_info_due(ts, pcr));
+                }
                 /* recalculate write_pcr and possibly retransmit si_info */
                 continue;
             }
@@ -2164,10 +2193,11 @@ static void mpegts_write_flush(AVFormatContext *s)
     }
 
     if (ts->m2ts_mode) {
-        int packets = (avio_tell(s->pb) / (TS_PACKET_SIZE + 4)) % 32;
+        int packets = ((avio_tell(s->pb) + ts->batch_size) / (TS_PACKET_SIZE + 4)) % 32;
         while (packets++ < 32)
             mpegts_insert_null_packet(s);
     }
+    flush_packets(s);
 }
 
 static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
@@ -2176,7 +2206,9 @@ static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
         mpegts_write_flush(s);
         return 1;
     } else {
-        return mpegts_write_packet_internal(s, pkt);
+        int ret = mpegts_write_packet_internal(s, pkt);
+        flush_packets(s);
+        return ret;
     }
 }
 
@@ -32,6 +32,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
+#include "libavutil/trace.h"
 
 /**
  * @file
@@ -177,6 +178,14 @@ static int validate_codec_tag(const AVFormatContext *s, const AVStream *st)
     return 1;
 }
 
+/* Whether max_interleave_delta may force output while this stream has no
+ * packets buffered for interleaving. */
+static int interleave_skippable(const AVCodecParameters *par)
+{
+    return par->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+           par->codec_id   != AV_CODEC_ID_VP8 &&
+           par->codec_id   != AV_CODEC_ID_VP9;
+}
 
 static int init_muxer(AVFormatContext *s, AVDictionary **options)
 {
@@ -313,6 +322,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
                                     ff_interleave_packet_per_dts :
                                     ff_interleave_packet_passthrough;
 
+    /* Chunked interleaving and muxers with their own interleavement
+     * function need the packets in a single ordered packet_buffer. */
+    if (si->interleave_packet == ff_interleave_packet_per_dts &&
+        !s->max_chunk_size && !s->max_chunk_duration) {
+        si->interleave_heap = av_calloc(s->nb_streams, sizeof(*si->interleave_heap));
+        if (!si->interleave_heap) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        si->interleave_per_stream = 1;
+        for (unsigned i = 0; i < s->nb_streams; i++)
+            si->nb_interleave_skippable += interleave_skippable(s->streams[i]->codecpar);
+    }
+
     if (!s->priv_data && of->priv_data_size > 0) {
         s->priv_data = av_mallocz(of->priv_data_size);
         if (!s->priv_data) {
@@ -637,18 +660,22 @@ static void handle_avoid_negative_ts(FFFormatContext *si, FFStream *sti,
 
         /* Peek into the muxing queue to improve our estimate
          * of the lowest timestamp if av_interleaved_write_frame() is used. */
-        for (const PacketListEntry *pktl = si->packet_buffer.head;
-             pktl; pktl = pktl->next) {
-            AVRational cmp_tb = s->streams[pktl->pkt.stream_index]->time_base;
-            int64_t cmp_ts = use_pts ? pktl->pkt.pts : pktl->pkt.dts;
-            if (cmp_ts == AV_NOPTS_VALUE)
-                continue;
-            cmp_ts -= ffstream(s->streams[pktl->pkt.stream_index])->lowest_ts_allowed;
-            if (s->output_ts_offset)
-                cmp_ts += av_rescale_q(s->output_ts_offset, AV_TIME_BASE_Q, cmp_tb);
-            if (av_compare_ts(cmp_ts, cmp_tb, ts, tb) < 0) {
-                ts = cmp_ts;
-                tb = cmp_tb;
+        for (unsigned i = 0; i < s->nb_streams; i++) {
+            const PacketListEntry *pktl = si->interleave_per_stream ?
+                                          ffstream(s->streams[i])->interleave_queue.head :
+                                          i ? NULL : si->packet_buffer.head;
+            for (; pktl; pktl = pktl->next) {
+                AVRational cmp_tb = s->streams[pktl->pkt.stream_index]->time_base;
+                int64_t cmp_ts = use_pts ? pktl->pkt.pts : pktl->pkt.dts;
+                if (cmp_ts == AV_NOPTS_VALUE)
+                    continue;
+                cmp_ts -= ffstream(s->streams[pktl->pkt.stream_index])->lowest_ts_allowed;
+                if (s->output_ts_offset)
+                    cmp_ts += av_rescale_q(s->output_ts_offset, AV_TIME_BASE_Q, cmp_tb);
+                if (av_compare_ts(cmp_ts, cmp_tb, ts, tb) < 0) {
+                    ts = cmp_ts;
+                    tb = cmp_tb;
+                }
             }
         }
 
@@ -707,6 +734,7 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
     FFFormatContext *const si = ffformatcontext(s);
     AVStream *const st = s->streams[pkt->stream_index];
     FFStream *const sti = ffstream(st);
+    AVTraceSpan span;
     int ret;
 
     // If the timestamp offsetting below is adjusted, adjust
@@ -721,6 +749,7 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
     }
     handle_avoid_negative_ts(si, sti, pkt);
 
+    av_trace_begin(&span, "mux", s->oformat->name);
     if ((pkt->flags & AV_PKT_FLAG_UNCODED_FRAME)) {
         AVFrame **frame = (AVFrame **)pkt->data;
         av_assert0(pkt->size == sizeof(*frame));
@@ -734,6 +763,7 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
         if (s->pb->error < 0)
             ret = s->pb->error;
     }
+    av_trace_end(&span);
 
     if (ret >= 0)
         st->nb_frames++;
@@ -919,51 +949,181 @@ static int interleave_compare_dts(AVFormatContext *s, const AVPacket *next,
     return comp > 0;
 }
 
+/* Whether the first queued packet of stream a precedes the one of stream b. */
+static int interleave_heap_before(AVFormatContext *s, unsigned a, unsigned b)
+{
+    const AVPacket *const pkt_a = &ffstream(s->streams[a])->interleave_queue.head->pkt;
+    const AVPacket *const pkt_b = &ffstream(s->streams[b])->interleave_queue.head->pkt;
+
+    return interleave_compare_dts(s, pkt_b, pkt_a);
+}
+
+static void interleave_heap_sift_up(AVFormatContext *s, unsigned i)
+{
+    unsigned *const heap = ffformatcontext(s)->interleave_heap;
+
+    while (i) {
+        unsigned parent = (i - 1) / 2;
+        if (!interleave_heap_before(s, heap[i], heap[parent]))
+            break;
+        FFSWAP(unsigned, heap[i], heap[parent]);
+        i = parent;
+    }
+}
+
+static void interleave_heap_sift_down(AVFormatContext *s, unsigned i)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    unsigned *const heap = si->interleave_heap;
+    const unsigned nb    = si->nb_interleave_heap;
+
+    while (1) {
+        unsigned first = i, child = 2 * i + 1;
+        if (child < nb && interleave_heap_before(s, heap[child], heap[first]))
+            first = child;
+        child++;
+        if (child < nb && interleave_heap_before(s, heap[child], heap[first]))
+            first = child;
+        if (first == i)
+            break;
+        FFSWAP(unsigned, heap[i], heap[first]);
+        i = first;
+    }
+}
+
+static int interleave_queue_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    AVStream *const st  = s->streams[pkt->stream_index];
+    FFStream *const sti = ffstream(st);
+    int was_empty = !sti->interleave_queue.head;
+    int ret;
+
+    ret = avpriv_packet_list_put(&sti->interleave_queue, pkt, NULL, 0);
+    if (ret < 0) {
+        av_packet_unref(pkt);
+        return ret;
+    }
+
+    if (was_empty) {
+        si->interleave_heap[si->nb_interleave_heap] = st->index;
+        interleave_heap_sift_up(s, si->nb_interleave_heap++);
+        if (interleave_skippable(st->codecpar))
+            si->nb_interleave_skippable_queued++;
+    }
+
+    return 0;
+}
+
+/* Return the packet to be output next, or NULL if none is buffered. */
+static const AVPacket *interleave_peek_first(AVFormatContext *s)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+
+    if (si->interleave_per_stream)
+        return si->nb_interleave_heap ?
+               &ffstream(s->streams[si->interleave_heap[0]])->interleave_queue.head->pkt :
+               NULL;
+    return si->packet_buffer.head ? &si->packet_buffer.head->pkt : NULL;
+}
+
+/* Remove the packet to be output next and return it in pkt,
+ * or discard it if pkt is NULL. */
+static void interleave_get_first(AVFormatContext *s, AVPacket *pkt)
+{
+    FFFormatContext *const si = ffformatcontext(s);
+    PacketList *list;
+    PacketListEntry *pktl;
+    FFStream *sti;
+
+    if (si->interleave_per_stream) {
+        sti  = ffstream(s->streams[si->interleave_heap[0]]);
+        list = &sti->interleave_queue;
+    } else {
+        list = &si->packet_buffer;
+        sti  = ffstream(s->streams[list->head->pkt.stream_index]);
+        if (sti->last_in_packet_buffer == list->head)
+            sti->last_in_packet_buffer = NULL;
+    }
+
+    pktl       = list->head;
+    list->head = pktl->next;
+    if (!list->head)
+        list->tail = NULL;
+
+    if (si->interleave_per_stream) {
+        if (!list->head) {
+            si->interleave_heap[0] = si->interleave_heap[--si->nb_interleave_heap];
+            if (interleave_skippable(sti->pub.codecpar))
+                si->nb_interleave_skippable_queued--;
+        }
+        interleave_heap_sift_down(s, 0);
+    }
+
+    if (pkt)
+        *pkt = pktl->pkt;
+    else
+        av_packet_unref(&pktl->pkt);
+    av_freep(&pktl);
+}
+
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
                                  int flush, int has_packet)
 {
     FFFormatContext *const si = ffformatcontext(s);
+    const AVPacket *top_pkt;
     int stream_count = 0;
     int noninterleaved_count = 0;
     int ret;
     int eof = flush;
 
     if (has_packet) {
-        if ((ret = ff_interleave_add_packet(s, pkt, interleave_compare_dts)) < 0)
+        if (si->interleave_per_stream)
+            ret = interleave_queue_packet(s, pkt);
+        else
+            ret = ff_interleave_add_packet(s, pkt, interleave_compare_dts);
+        if (ret < 0)
             return ret;
     }
 
-    for (unsigned i = 0; i < s->nb_streams; i++) {
-        const AVStream *const st  = s->streams[i];
-        const FFStream *const sti = cffstream(st);
-        const AVCodecParameters *const par = st->codecpar;
-        if (sti->last_in_packet_buffer) {
-            ++stream_count;
-        } else if (par->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
-                   par->codec_id != AV_CODEC_ID_VP8 &&
-                   par->codec_id != AV_CODEC_ID_VP9) {
-            ++noninterleaved_count;
+    if (si->interleave_per_stream) {
+        stream_count         = si->nb_interleave_heap;
+        noninterleaved_count = si->nb_interleave_skippable -
+                               si->nb_interleave_skippable_queued;
+    } else {
+        for (unsigned i = 0; i < s->nb_streams; i++) {
+            const AVStream *const st  = s->streams[i];
+            const FFStream *const sti = cffstream(st);
+            if (sti->last_in_packet_buffer)
+                ++stream_count;
+            else if (interleave_skippable(st->codecpar))
+                ++noninterleaved_count;
         }
     }
 
     if (si->nb_interleaved_streams == stream_count)
         flush = 1;
 
+    top_pkt = interleave_peek_first(s);
     if (s->max_interleave_delta > 0 &&
-        si->packet_buffer.head &&
+        top_pkt &&
         !flush &&
         si->nb_interleaved_streams == stream_count+noninterleaved_count
     ) {
-        AVPacket *const top_pkt = &si->packet_buffer.head->pkt;
+        const unsigned nb = si->interleave_per_stream ? si->nb_interleave_heap
+                                                      : s->nb_streams;
         int64_t delta_dts = INT64_MIN;
         int64_t top_dts = av_rescale_q(top_pkt->dts,
                                        s->streams[top_pkt->stream_index]->time_base,
                                        AV_TIME_BASE_Q);
 
-        for (unsigned i = 0; i < s->nb_streams; i++) {
-            const AVStream *const st  = s->streams[i];
+        for (unsigned i = 0; i < nb; i++) {
+            const AVStream *const st  = s->streams[si->interleave_per_stream ?
+                                                   si->interleave_heap[i] : i];
             const FFStream *const sti = cffstream(st);
-            const PacketListEntry *const last = sti->last_in_packet_buffer;
+            const PacketListEntry *const last = si->interleave_per_stream ?
+                                                sti->interleave_queue.tail :
+                                                sti->last_in_packet_buffer;
             int64_t last_dts;
 
             if (!last)
@@ -984,51 +1144,31 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
         }
     }
 
-    if (si->packet_buffer.head &&
+    if (top_pkt &&
         eof &&
         (s->flags & AVFMT_FLAG_SHORTEST) &&
         si->shortest_end == AV_NOPTS_VALUE) {
-        AVPacket *const top_pkt = &si->packet_buffer.head->pkt;
-
         si->shortest_end = av_rescale_q(top_pkt->dts,
                                        s->streams[top_pkt->stream_index]->time_base,
                                        AV_TIME_BASE_Q);
     }
 
     if (si->shortest_end != AV_NOPTS_VALUE) {
-        while (si->packet_buffer.head) {
-            PacketListEntry *pktl = si->packet_buffer.head;
-            AVPacket *const top_pkt = &pktl->pkt;
+        while ((top_pkt = interleave_peek_first(s))) {
             AVStream *const st = s->streams[top_pkt->stream_index];
-            FFStream *const sti = ffstream(st);
             int64_t top_dts = av_rescale_q(top_pkt->dts, st->time_base,
                                         AV_TIME_BASE_Q);
 
             if (si->shortest_end + 1 >= top_dts)
                 break;
 
-            si->packet_buffer.head = pktl->next;
-            if (!si->packet_buffer.head)
-                si->packet_buffer.tail = NULL;
-
-            if (sti->last_in_packet_buffer == pktl)
-                sti->last_in_packet_buffer = NULL;
-
-            av_packet_unref(&pktl->pkt);
-            av_freep(&pktl);
+            interleave_get_first(s, NULL);
             flush = 0;
         }
     }
 
     if (stream_count && flush) {
-        PacketListEntry *pktl = si->packet_buffer.head;
-        AVStream *const st = s->streams[pktl->pkt.stream_index];
-        FFStream *const sti = ffstream(st);
-
-        if (sti->last_in_packet_buffer == pktl)
-            sti->last_in_packet_buffer = NULL;
-        avpriv_packet_list_get(&si->packet_buffer, pkt);
-
+        interleave_get_first(s, pkt);
         return 1;
     } else {
         return 0;
@@ -1061,6 +1201,12 @@ const AVPacket *ff_interleaved_peek(AVFormatContext *s, int stream)
 {
     FFFormatContext *const si = ffformatcontext(s);
     PacketListEntry *pktl = si->packet_buffer.head;
+
+    if (si->interleave_per_stream) {
+        pktl = ffstream(s->streams[stream])->interleave_queue.head;
+        return pktl ? &pktl->pkt : NULL;
+    }
+
     while (pktl) {
         if (pktl->pkt.stream_index == stream) {
             return &pktl->pkt;
@@ -291,6 +291,8 @@ typedef struct MXFIndexTable {
     MXFIndexTableSegment **segments;    /* sorted by IndexStartPosition */
     AVIndexEntry *fake_index;   /* used for calling ff_index_search_timestamp() */
     int8_t *offsets;            /* temporal offsets for display order to stored order conversion */
+    int64_t *segment_offsets;   /* essence container offset at the start of each segment,
+                                 * only set if the segments can be binary searched */
 } MXFIndexTable;
 
 typedef struct MXFContext {
@@ -1868,12 +1870,30 @@ static int64_t mxf_essence_container_end(MXFContext *mxf, int body_sid)
 /* EditUnit -> absolute offset */
 static int mxf_edit_unit_absolute_offset(MXFContext *mxf, MXFIndexTable *index_table, int64_t edit_unit, AVRational edit_rate, int64_t *edit_unit_out, int64_t *offset_out, MXFPartition **partition_out, int nag)
 {
-    int i;
+    int i = 0;
     int64_t offset_temp = 0;
 
     edit_unit = av_rescale_q(edit_unit, index_table->segments[0]->index_edit_rate, edit_rate);
 
-    for (i = 0; i < index_table->nb_segments; i++) {
+    /* jump directly to the segment containing the edit unit */
+    if (index_table->segment_offsets && edit_unit >= 0) {
+        int a = -1, b = index_table->nb_segments;
+
+        while (b - a > 1) {
+            int m = (a + b) >> 1;
+            MXFIndexTableSegment *s = index_table->segments[m];
+
+            if (edit_unit < s->index_start_position + s->index_duration)
+                b = m;
+            else
+                a = m;
+        }
+        if (b < index_table->nb_segments)
+            offset_temp = index_table->segment_offsets[b];
+        i = b;
+    }
+
+    for (; i < index_table->nb_segments; i++) {
         MXFIndexTableSegment *s = index_table->segments[i];
 
         edit_unit = FFMAX(edit_unit, s->index_start_position);  /* clamp if trying to seek before start */
@@ -1912,6 +1932,41 @@ static int mxf_edit_unit_absolute_offset(MXFContext *mxf, MXFIndexTable *index_t
     return AVERROR_INVALIDDATA;
 }
 
+/**
+ * Precompute the essence container offset at the start of each segment, so
+ * that mxf_edit_unit_absolute_offset() can binary search the segments instead
+ * of walking all of them for every packet. This is only done if the segments
+ * are non-empty and do not overlap, otherwise the linear walk is kept.
+ */
+static int mxf_compute_segment_offsets(MXFIndexTable *index_table)
+{
+    int64_t offset = 0;
+
+    for (int i = 0; i < index_table->nb_segments; i++) {
+        MXFIndexTableSegment *s = index_table->segments[i];
+
+        if (!s->index_duration || s->index_start_position + s->index_duration < s->index_start_position)
+            return 0;
+        if (i && s->index_start_position < index_table->segments[i - 1]->index_start_position +
+                                           index_table->segments[i - 1]->index_duration)
+            return 0;
+    }
+
+    index_table->segment_offsets = av_malloc_array(index_table->nb_segments,
+                                                   sizeof(*index_table->segment_offsets));
+    if (!index_table->segment_offsets)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < index_table->nb_segments; i++) {
+        MXFIndexTableSegment *s = index_table->segments[i];
+
+        index_table->segment_offsets[i] = offset;
+        offset += s->edit_unit_byte_count * s->index_duration;
+    }
+
+    return 0;
+}
+
 static int mxf_compute_ptses_fake_index(MXFContext *mxf, MXFIndexTable *index_table)
 {
     int i, j, x;
@@ -2134,6 +2189,9 @@ static int mxf_compute_index_tables(MXFContext *mxf)
             t->segments[k]->index_duration = mxf_track->original_duration;
             break;
         }
+
+        if ((ret = mxf_compute_segment_offsets(t)) < 0)
+            goto finish_decoding_index;
     }
 
     ret = 0;
@@ -4117,6 +4175,7 @@ static int mxf_read_close(AVFormatContext *s)
             av_freep(&mxf->index_tables[i].ptses);
             av_freep(&mxf->index_tables[i].fake_index);
             av_freep(&mxf->index_tables[i].offsets);
+            av_freep(&mxf->index_tables[i].segment_offsets);
         }
     }
     av_freep(&mxf->index_tables);
@@ -398,6 +398,7 @@ typedef struct MXFContext {
     AVRational time_base;
     int header_written;
     MXFIndexEntry *index_entries;
+    unsigned index_entries_size; ///< number of allocated index entries
     unsigned edit_units_count;
     uint64_t timestamp;   ///< timestamp, as year(16),month(8),day(8),hour(8),minutes(8),msec/4(8)
     uint8_t slice_count;  ///< index slice count minus 1 (1 if no audio, 0 otherwise)
@@ -2809,16 +2810,19 @@ static void mxf_write_d10_audio_packet(AVFormatContext *s, AVStream *st, AVPacke
     int frame_size = pkt->size / st->codecpar->block_align;
     const uint8_t *samples = pkt->data;
     const uint8_t *const end = pkt->data + pkt->size;
-    int i;
+    const int channels = st->codecpar->ch_layout.nb_channels;
+    /* the 8 channel AES3 sample rows are assembled in batches */
+    uint8_t buf[64 * 8 * 4];
+    int i, n = 0;
 
     klv_encode_ber4_length(pb, 4 + frame_size*4*8);
 
     avio_w8(pb, (frame_size == 1920 ? 0 : (mxf->edit_units_count-1) % 5 + 1));
     avio_wl16(pb, frame_size);
-    avio_w8(pb, (1 << st->codecpar->ch_layout.nb_channels)-1);
+    avio_w8(pb, (1 << channels)-1);
 
     while (samples < end) {
-        for (i = 0; i < st->codecpar->ch_layout.nb_channels; i++) {
+        for (i = 0; i < channels; i++) {
             uint32_t sample;
             if (st->codecpar->codec_id == AV_CODEC_ID_PCM_S24LE) {
                 sample = AV_RL24(samples)<< 4;
@@ -2827,11 +2831,17 @@ static void mxf_write_d10_audio_packet(AVFormatContext *s, AVStream *st, AVPacke
                 sample = AV_RL16(samples)<<12;
                 samples += 2;
             }
-            avio_wl32(pb, sample | i);
+            AV_WL32(buf + n, sample | i);
+            n += 4;
+        }
+        for (; i < 8; i++, n += 4)
+            AV_WL32(buf + n, i);
+        if (n == sizeof(buf)) {
+            avio_write(pb, buf, n);
+            n = 0;
         }
-        for (; i < 8; i++)
-            avio_wl32(pb, i);
     }
+    avio_write(pb, buf, n);
 }
 
 static int mxf_write_opatom_body_partition(AVFormatContext *s)
@@ -2921,13 +2931,19 @@ static int mxf_write_packet(AVFormatContext *s, AVPacket *pkt)
         return AVERROR_INVALIDDATA;
     }
 
-    if (!mxf->cbr_index && !mxf->edit_unit_byte_count && !(mxf->edit_units_count % EDIT_UNITS_PER_BODY)) {
-        if ((err = av_reallocp_array(&mxf->index_entries, mxf->edit_units_count
-                                     + EDIT_UNITS_PER_BODY, sizeof(*mxf->index_entries))) < 0) {
-            mxf->edit_units_count = 0;
+    if (!mxf->cbr_index && !mxf->edit_unit_byte_count &&
+        mxf->edit_units_count >= mxf->index_entries_size) {
+        /* room for a whole body partition with a trailing GOP at first, then
+         * grow geometrically as OPAtom keeps all entries until the footer */
+        unsigned size = FFMAX(2 * EDIT_UNITS_PER_BODY, 2 * mxf->index_entries_size);
+        if ((err = av_reallocp_array(&mxf->index_entries, size,
+                                     sizeof(*mxf->index_entries))) < 0) {
+            mxf->edit_units_count   = 0;
+            mxf->index_entries_size = 0;
             av_log(s, AV_LOG_ERROR, "could not allocate index entries\n");
             return err;
         }
+        mxf->index_entries_size = size;
     }
 
     if (st->codecpar->codec_id == AV_CODEC_ID_MPEG2VIDEO) {
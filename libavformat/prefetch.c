@@ -0,0 +1,515 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "config_components.h"
+
+#include <stdatomic.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "avio_internal.h"
+#include "http.h"
+#include "internal.h"
+#include "prefetch.h"
+#include "url.h"
+
+#if HAVE_THREADS
+
+#define READ_SIZE (64 * 1024)
+
+enum SlotState {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_DONE,
+};
+
+typedef struct PrefetchSlot {
+    enum SlotState state;
+    int64_t id;
+    char *url;
+    AVDictionary *options;
+    atomic_int cancel;          ///< discarded while running
+
+    uint8_t *data;
+    size_t size;                ///< also updated while running, under the lock
+    int ret;
+} PrefetchSlot;
+
+typedef struct PrefetchWorker {
+    struct FFPrefetcher *p;
+    pthread_t thread;
+    AVIOInterruptCB int_cb;
+    PrefetchSlot *slot;         ///< being downloaded, only used by the worker
+
+    /* connection of the last download, kept open to reuse it */
+    AVIOContext *pb;
+    char *pb_url;
+} PrefetchWorker;
+
+struct FFPrefetcher {
+    AVFormatContext *s;
+    PrefetchSlot *slots;
+    PrefetchWorker *workers;
+    int nb_slots;
+    int nb_workers;
+    int nb_started;
+    size_t max_size;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cond;
+    pthread_cond_t  done_cond;
+    pthread_cond_t  space_cond;
+    atomic_int abort;
+};
+
+static int prefetch_interrupt(void *opaque)
+{
+    PrefetchWorker *w = opaque;
+
+    return atomic_load(&w->p->abort) ||
+           (w->slot && atomic_load(&w->slot->cancel)) ||
+           ff_check_interrupt(&w->p->s->interrupt_callback);
+}
+
+static int same_server(const char *url1, const char *url2)
+{
+    char proto1[10], proto2[10], host1[1024], host2[1024];
+    int port1, port2;
+
+    av_url_split(proto1, sizeof(proto1), NULL, 0, host1, sizeof(host1),
+                 &port1, NULL, 0, url1);
+    av_url_split(proto2, sizeof(proto2), NULL, 0, host2, sizeof(host2),
+                 &port2, NULL, 0, url2);
+
+    return port1 == port2 && !strcmp(proto1, proto2) && !strcmp(host1, host2);
+}
+
+static void close_connection(PrefetchWorker *w)
+{
+    avio_closep(&w->pb);
+    av_freep(&w->pb_url);
+}
+
+static int open_connection(PrefetchWorker *w, const char *url, AVDictionary **options)
+{
+    AVFormatContext *s = w->p->s;
+    const AVDictionaryEntry *e = av_dict_get(*options, "multiple_requests", NULL, 0);
+    const int persistent = e && strcmp(e->value, "0");
+    int ret;
+
+#if CONFIG_HTTP_PROTOCOL
+    if (w->pb && w->pb_url && same_server(w->pb_url, url)) {
+        w->pb->eof_reached = 0;
+        ret = ff_http_do_new_request2(ffio_geturlcontext(w->pb), url, options);
+        if (ret >= 0)
+            return 0;
+    }
+#endif
+    close_connection(w);
+
+    ret = ffio_open_whitelist(&w->pb, url, AVIO_FLAG_READ, &w->int_cb, options,
+                              s->protocol_whitelist, s->protocol_blacklist);
+    if (ret < 0)
+        return ret;
+
+    /* only the persistent connections are reused */
+    if (persistent) {
+        w->pb_url = av_strdup(url);
+        if (!w->pb_url) {
+            close_connection(w);
+            return AVERROR(ENOMEM);
+        }
+    }
+    return 0;
+}
+
+static size_t buffered_size(FFPrefetcher *p)
+{
+    size_t size = 0;
+
+    for (int i = 0; i < p->nb_slots; i++)
+        size += p->slots[i].size;
+    return size;
+}
+
+/* the oldest segment is never paused, since it is the next one to be read */
+static int is_oldest(FFPrefetcher *p, const PrefetchSlot *slot)
+{
+    for (int i = 0; i < p->nb_slots; i++) {
+        const PrefetchSlot *other = &p->slots[i];
+        if (other->state != SLOT_FREE && !atomic_load(&other->cancel) &&
+            other->id < slot->id)
+            return 0;
+    }
+    return 1;
+}
+
+/* account the downloaded data and wait while the memory limit is exceeded */
+static void update_size(PrefetchWorker *w, PrefetchSlot *slot, size_t size)
+{
+    FFPrefetcher *p = w->p;
+
+    pthread_mutex_lock(&p->lock);
+    slot->size = size;
+    while (p->max_size && buffered_size(p) > p->max_size &&
+           !is_oldest(p, slot) &&
+           !atomic_load(&p->abort) && !atomic_load(&slot->cancel))
+        pthread_cond_wait(&p->space_cond, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static int download(PrefetchWorker *w, PrefetchSlot *slot,
+                    uint8_t **data, size_t *size)
+{
+    AVDictionary *options = NULL;
+    unsigned int alloc_size = 0;
+    int ret;
+
+    *data = NULL;
+    *size = 0;
+
+    ret = av_dict_copy(&options, slot->options, 0);
+    if (ret >= 0)
+        ret = open_connection(w, slot->url, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+        return ret;
+
+    while (1) {
+        uint8_t *buf;
+
+        if (*size + READ_SIZE > INT_MAX) {
+            ret = AVERROR(ERANGE);
+            break;
+        }
+        buf = av_fast_realloc(*data, &alloc_size, *size + READ_SIZE);
+        if (!buf) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        *data = buf;
+
+        ret = avio_read(w->pb, *data + *size, READ_SIZE);
+        if (ret <= 0)
+            break;
+        *size += ret;
+        update_size(w, slot, *size);
+    }
+
+    if (!w->pb_url)
+        close_connection(w);
+    if (ret == AVERROR_EOF || !ret)
+        return 0;
+
+    close_connection(w);
+    av_freep(data);
+    *size = 0;
+    return ret;
+}
+
+static void free_slot(PrefetchSlot *slot)
+{
+    av_freep(&slot->url);
+    av_dict_free(&slot->options);
+    av_freep(&slot->data);
+    slot->size  = 0;
+    slot->state = SLOT_FREE;
+}
+
+/* called with the lock held */
+static void discard_slot(FFPrefetcher *p, PrefetchSlot *slot)
+{
+    if (slot->state == SLOT_RUNNING)
+        atomic_store(&slot->cancel, 1);
+    else
+        free_slot(slot);
+    pthread_cond_broadcast(&p->space_cond);
+}
+
+static PrefetchSlot *next_queued(FFPrefetcher *p)
+{
+    PrefetchSlot *next = NULL;
+
+    for (int i = 0; i < p->nb_slots; i++) {
+        PrefetchSlot *slot = &p->slots[i];
+        if (slot->state == SLOT_QUEUED && (!next || slot->id < next->id))
+            next = slot;
+    }
+    return next;
+}
+
+static PrefetchSlot *find_slot(FFPrefetcher *p, int64_t id)
+{
+    for (int i = 0; i < p->nb_slots; i++) {
+        PrefetchSlot *slot = &p->slots[i];
+        if (slot->state != SLOT_FREE && slot->id == id &&
+            !atomic_load(&slot->cancel))
+            return slot;
+    }
+    return NULL;
+}
+
+static void *worker_thread(void *arg)
+{
+    PrefetchWorker *w = arg;
+    FFPrefetcher *p = w->p;
+
+    pthread_mutex_lock(&p->lock);
+    while (1) {
+        PrefetchSlot *slot;
+        uint8_t *data;
+        size_t size;
+        int ret;
+
+        while (!atomic_load(&p->abort) && !(slot = next_queued(p)))
+            pthread_cond_wait(&p->work_cond, &p->lock);
+        if (atomic_load(&p->abort))
+            break;
+
+        /* the url and options of a running slot are not modified */
+        slot->state = SLOT_RUNNING;
+        w->slot = slot;
+        pthread_mutex_unlock(&p->lock);
+
+        ret = download(w, slot, &data, &size);
+
+        pthread_mutex_lock(&p->lock);
+        w->slot = NULL;
+        if (atomic_load(&slot->cancel)) {
+            av_free(data);
+            free_slot(slot);
+            pthread_cond_broadcast(&p->space_cond);
+        } else {
+            slot->data  = data;
+            slot->size  = size;
+            slot->ret   = ret;
+            slot->state = SLOT_DONE;
+        }
+        pthread_cond_broadcast(&p->done_cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+void ff_prefetch_free(FFPrefetcher **pp)
+{
+    FFPrefetcher *p = *pp;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    atomic_store(&p->abort, 1);
+    pthread_cond_broadcast(&p->work_cond);
+    pthread_cond_broadcast(&p->space_cond);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->nb_started; i++)
+        pthread_join(p->workers[i].thread, NULL);
+
+    for (int i = 0; i < p->nb_slots; i++)
+        free_slot(&p->slots[i]);
+    for (int i = 0; i < p->nb_workers; i++)
+        close_connection(&p->workers[i]);
+    av_freep(&p->slots);
+    av_freep(&p->workers);
+
+    pthread_cond_destroy(&p->space_cond);
+    pthread_cond_destroy(&p->done_cond);
+    pthread_cond_destroy(&p->work_cond);
+    pthread_mutex_destroy(&p->lock);
+    av_freep(pp);
+}
+
+int ff_prefetch_alloc(FFPrefetcher **pp, AVFormatContext *s, int nb_segments,
+                      int nb_connections, size_t max_size)
+{
+    FFPrefetcher *p;
+    int ret;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->s        = s;
+    p->max_size = max_size;
+    atomic_init(&p->abort, 0);
+
+    if ((ret = pthread_mutex_init(&p->lock, NULL))) {
+        av_free(p);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&p->work_cond, NULL))) {
+        pthread_mutex_destroy(&p->lock);
+        av_free(p);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&p->done_cond, NULL))) {
+        pthread_cond_destroy(&p->work_cond);
+        pthread_mutex_destroy(&p->lock);
+        av_free(p);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&p->space_cond, NULL))) {
+        pthread_cond_destroy(&p->done_cond);
+        pthread_cond_destroy(&p->work_cond);
+        pthread_mutex_destroy(&p->lock);
+        av_free(p);
+        return AVERROR(ret);
+    }
+    *pp = p;
+
+    nb_connections = av_clip(nb_connections, 1, nb_segments);
+    p->slots   = av_calloc(nb_segments,    sizeof(*p->slots));
+    p->workers = av_calloc(nb_connections, sizeof(*p->workers));
+    if (!p->slots || !p->workers) {
+        ff_prefetch_free(pp);
+        return AVERROR(ENOMEM);
+    }
+    p->nb_slots   = nb_segments;
+    p->nb_workers = nb_connections;
+
+    for (int i = 0; i < nb_segments; i++)
+        atomic_init(&p->slots[i].cancel, 0);
+
+    for (int i = 0; i < nb_connections; i++) {
+        PrefetchWorker *w = &p->workers[i];
+
+        w->p      = p;
+        w->int_cb = (AVIOInterruptCB){ prefetch_interrupt, w };
+        if ((ret = pthread_create(&w->thread, NULL, worker_thread, w))) {
+            ff_prefetch_free(pp);
+            return AVERROR(ret);
+        }
+        p->nb_started++;
+    }
+
+    return 0;
+}
+
+int ff_prefetch_submit(FFPrefetcher *p, int64_t id, const char *url,
+                       AVDictionary *options)
+{
+    PrefetchSlot *slot = NULL;
+    int ret = 0;
+
+    pthread_mutex_lock(&p->lock);
+    if (find_slot(p, id))
+        goto end;
+    if (p->max_size && buffered_size(p) >= p->max_size) {
+        ret = AVERROR(EAGAIN);
+        goto end;
+    }
+
+    for (int i = 0; i < p->nb_slots && !slot; i++)
+        if (p->slots[i].state == SLOT_FREE)
+            slot = &p->slots[i];
+    if (!slot) {
+        ret = AVERROR(EAGAIN);
+        goto end;
+    }
+
+    slot->url = av_strdup(url);
+    if (!slot->url || av_dict_copy(&slot->options, options, 0) < 0) {
+        free_slot(slot);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    slot->id    = id;
+    slot->ret   = 0;
+    slot->state = SLOT_QUEUED;
+    atomic_store(&slot->cancel, 0);
+    pthread_cond_signal(&p->work_cond);
+
+end:
+    pthread_mutex_unlock(&p->lock);
+    return ret;
+}
+
+int ff_prefetch_get(FFPrefetcher *p, int64_t id, uint8_t **data, size_t *size)
+{
+    PrefetchSlot *slot;
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    for (int i = 0; i < p->nb_slots; i++) {
+        slot = &p->slots[i];
+        if (slot->state != SLOT_FREE && slot->id < id)
+            discard_slot(p, slot);
+    }
+
+    slot = find_slot(p, id);
+    if (!slot) {
+        pthread_mutex_unlock(&p->lock);
+        return AVERROR(ENOENT);
+    }
+    while (slot->state != SLOT_DONE)
+        pthread_cond_wait(&p->done_cond, &p->lock);
+
+    *data = slot->data;
+    *size = slot->size;
+    ret   = slot->ret;
+    slot->data = NULL;
+    free_slot(slot);
+    pthread_cond_broadcast(&p->space_cond);
+    pthread_mutex_unlock(&p->lock);
+
+    return ret;
+}
+
+void ff_prefetch_flush(FFPrefetcher *p)
+{
+    pthread_mutex_lock(&p->lock);
+    for (int i = 0; i < p->nb_slots; i++)
+        if (p->slots[i].state != SLOT_FREE)
+            discard_slot(p, &p->slots[i]);
+    pthread_mutex_unlock(&p->lock);
+}
+
+#else
+
+int ff_prefetch_alloc(FFPrefetcher **p, AVFormatContext *s, int nb_segments,
+                      int nb_connections, size_t max_size)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_prefetch_free(FFPrefetcher **p)
+{
+}
+
+int ff_prefetch_submit(FFPrefetcher *p, int64_t id, const char *url,
+                       AVDictionary *options)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_prefetch_get(FFPrefetcher *p, int64_t id, uint8_t **data, size_t *size)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_prefetch_flush(FFPrefetcher *p)
+{
+}
+
+#endif /* HAVE_THREADS */
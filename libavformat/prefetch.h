@@ -0,0 +1,89 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Background download of the upcoming segments of a segmented stream.
+ *
+ * Every worker thread of a prefetcher downloads one segment at a time into
+ * memory. With persistent HTTP connections (the multiple_requests option),
+ * the connection is kept open to reuse it for the next segment from the same
+ * server.
+ */
+
+#ifndef AVFORMAT_PREFETCH_H
+#define AVFORMAT_PREFETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libavutil/dict.h"
+
+#include "avformat.h"
+
+typedef struct FFPrefetcher FFPrefetcher;
+
+/**
+ * Allocate a prefetcher holding up to nb_segments segments, downloaded on
+ * up to nb_connections connections at once.
+ *
+ * The segments are opened with the protocol white and black lists and the
+ * interrupt callback of s, which is called from the worker threads.
+ *
+ * @param max_size limit of the memory used by the queued segments, 0 for no
+ *                 limit; the downloads are paused when it is exceeded, except
+ *                 the one of the oldest segment, which can exceed it
+ * @return 0 on success, AVERROR(ENOSYS) if threads are not available, a
+ *         negative error code otherwise
+ */
+int ff_prefetch_alloc(FFPrefetcher **p, AVFormatContext *s, int nb_segments,
+                      int nb_connections, size_t max_size);
+
+/**
+ * Stop the downloads and free the prefetcher.
+ */
+void ff_prefetch_free(FFPrefetcher **p);
+
+/**
+ * Queue the download of a segment.
+ *
+ * @param id      identifier of the segment, e.g. its sequence number
+ * @param options options for opening the url, left untouched
+ * @return 0 if the segment was queued or is already queued,
+ *         AVERROR(EAGAIN) if all the slots are busy or the memory limit is
+ *         reached
+ */
+int ff_prefetch_submit(FFPrefetcher *p, int64_t id, const char *url,
+                       AVDictionary *options);
+
+/**
+ * Take a downloaded segment, waiting for its download to finish. The
+ * segments queued with a lower id are discarded.
+ *
+ * @param data set to the segment data, to be freed with av_free()
+ * @return 0 on success, AVERROR(ENOENT) if the segment was not queued, the
+ *         download error otherwise
+ */
+int ff_prefetch_get(FFPrefetcher *p, int64_t id, uint8_t **data, size_t *size);
+
+/**
+ * Discard all the queued and ongoing downloads.
+ */
+void ff_prefetch_flush(FFPrefetcher *p);
+
+#endif /* AVFORMAT_PREFETCH_H */
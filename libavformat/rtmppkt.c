@@ -306,10 +306,11 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
                          int chunk_size, RTMPPacket **prev_pkt_ptr,
                          int *nb_prev_pkt)
 {
-    uint8_t pkt_hdr[16], *p = pkt_hdr;
+    uint8_t pkt_hdr[16], *p = pkt_hdr, *buf;
     int mode = RTMP_PS_TWELVEBYTES;
     int off = 0;
     int written = 0;
+    int hdr_size, nb_chunks;
     int ret;
     RTMPPacket *prev_pkt;
     int use_delta; // flag if using timestamp delta, not RTMP_PS_TWELVEBYTES
@@ -374,34 +375,32 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
     prev_pkt[pkt->channel_id].ts_field   = pkt->ts_field;
     prev_pkt[pkt->channel_id].extra      = pkt->extra;
 
-    // FIXME:
-    // Writing packets is currently not optimized to minimize system calls.
-    // Since system calls flush on exit which we cannot change in a system-independant way.
-    // We should fix this behavior and by writing packets in a single or in as few as possible system calls.
-    // Protocols like TCP and RTMP should benefit from this when enabling TCP_NODELAY.
-
-    if ((ret = ffurl_write(h, pkt_hdr, p - pkt_hdr)) < 0)
-        return ret;
-    written = p - pkt_hdr + pkt->size;
+    /* Lay out the header and all chunks, including the continuation chunk
+     * headers, in one buffer so that the whole message goes out with a
+     * single write instead of two or three per chunk. */
+    hdr_size  = p - pkt_hdr;
+    nb_chunks = pkt->size ? (pkt->size + chunk_size - 1) / chunk_size : 0;
+    written   = hdr_size + pkt->size +
+                FFMAX(nb_chunks - 1, 0) * (pkt->ts_field == 0xFFFFFF ? 5 : 1);
+    buf = av_malloc(written);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    p = buf;
+    bytestream_put_buffer(&p, pkt_hdr, hdr_size);
     while (off < pkt->size) {
         int towrite = FFMIN(chunk_size, pkt->size - off);
-        if ((ret = ffurl_write(h, pkt->data + off, towrite)) < 0)
-            return ret;
+        bytestream_put_buffer(&p, pkt->data + off, towrite);
         off += towrite;
         if (off < pkt->size) {
-            uint8_t marker = 0xC0 | pkt->channel_id;
-            if ((ret = ffurl_write(h, &marker, 1)) < 0)
-                return ret;
-            written++;
-            if (pkt->ts_field == 0xFFFFFF) {
-                uint8_t ts_header[4];
-                AV_WB32(ts_header, timestamp);
-                if ((ret = ffurl_write(h, ts_header, 4)) < 0)
-                    return ret;
-                written += 4;
-            }
+            bytestream_put_byte(&p, 0xC0 | pkt->channel_id);
+            if (pkt->ts_field == 0xFFFFFF)
+                bytestream_put_be32(&p, timestamp);
         }
     }
+    ret = ffurl_write(h, buf, written);
+    av_free(buf);
+    if (ret < 0)
+        return ret;
     return written;
 }
 
@@ -55,6 +55,7 @@
 #define FLASHVER_MAX_LENGTH 64
 #define RTMP_PKTDATA_DEFAULT_SIZE 4096
 #define RTMP_HEADER 11
+#define RTMP_MAX_OUT_CHUNK_SIZE 65536
 
 /** RTMP protocol handler state */
 typedef enum {
@@ -127,6 +128,7 @@ typedef struct RTMPContext {
     int           nb_streamid;                ///< The next stream id to return on createStream calls
     double        duration;                   ///< Duration of the stream in seconds as returned by the server (only valid if non-zero)
     int           tcp_nodelay;                ///< Use TCP_NODELAY to disable Nagle's algorithm if set to 1
+    int           chunk_size;                 ///< requested outgoing chunk size, 0: protocol default, -1: grow with the messages
     char          username[50];
     char          password[50];
     char          auth_params[500];
@@ -255,6 +257,32 @@ fail:
     return ret;
 }
 
+/**
+ * Generate set chunk size message, send it to the peer and use the new
+ * size for all subsequent messages.
+ */
+static int gen_chunk_size(URLContext *s, RTMPContext *rt, int chunk_size)
+{
+    RTMPPacket pkt;
+    uint8_t *p;
+    int ret;
+
+    if ((ret = ff_rtmp_packet_create(&pkt, RTMP_NETWORK_CHANNEL, RTMP_PT_CHUNK_SIZE,
+                                     0, 4)) < 0)
+        return ret;
+
+    p = pkt.data;
+    bytestream_put_be32(&p, chunk_size);
+
+    if ((ret = rtmp_send_packet(rt, &pkt, 0)) < 0)
+        return ret;
+
+    rt->out_chunk_size = chunk_size;
+    av_log(s, AV_LOG_DEBUG, "New outgoing chunk size = %d\n", chunk_size);
+
+    return 0;
+}
+
 static int rtmp_write_amf_data(URLContext *s, char *param, uint8_t **p)
 {
     char *field, *value;
@@ -530,16 +558,8 @@ static int read_connect(URLContext *s, RTMPContext *rt)
         return ret;
 
     // Chunk size
-    if ((ret = ff_rtmp_packet_create(&pkt, RTMP_NETWORK_CHANNEL,
-                                     RTMP_PT_CHUNK_SIZE, 0, 4)) < 0)
-        return ret;
-
-    p = pkt.data;
-    bytestream_put_be32(&p, rt->out_chunk_size);
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
-    ff_rtmp_packet_destroy(&pkt);
-    if (ret < 0)
+    if ((ret = gen_chunk_size(s, rt, rt->chunk_size > 0 ? rt->chunk_size
+                                                         : rt->out_chunk_size)) < 0)
         return ret;
 
     // Send _result NetConnection.Connect.Success to connect
@@ -1503,7 +1523,7 @@ static int handle_chunk_size(URLContext *s, RTMPPacket *pkt)
         return AVERROR_INVALIDDATA;
     }
 
-    if (!rt->is_input) {
+    if (!rt->is_input && !rt->chunk_size) {
         /* Send the same chunk size change packet back to the server,
          * setting the outgoing chunk size to the same as the incoming one. */
         if ((ret = ff_rtmp_packet_write(rt->stream, pkt, rt->out_chunk_size,
@@ -2814,6 +2834,9 @@ reconnect:
     if (!rt->listen) {
         if ((ret = gen_connect(s, rt)) < 0)
             goto fail;
+        if (!rt->is_input && rt->chunk_size > 0 &&
+            (ret = gen_chunk_size(s, rt, rt->chunk_size)) < 0)
+            goto fail;
     } else {
         if ((ret = read_connect(s, s->priv_data)) < 0)
             goto fail;
@@ -3049,6 +3072,16 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
                 }
             }
 
+            /* grow the chunk size so that large video frames are not
+             * split into many 128 byte chunks */
+            if (rt->chunk_size < 0 && rt->out_pkt.size > rt->out_chunk_size &&
+                rt->out_chunk_size < RTMP_MAX_OUT_CHUNK_SIZE) {
+                int chunk_size = FFMIN(1 << av_ceil_log2(rt->out_pkt.size),
+                                       RTMP_MAX_OUT_CHUNK_SIZE);
+                if ((ret = gen_chunk_size(s, rt, chunk_size)) < 0)
+                    return ret;
+            }
+
             if ((ret = rtmp_send_packet(rt, &rt->out_pkt, 0)) < 0)
                 return ret;
             rt->flv_size = 0;
@@ -3118,6 +3151,8 @@ static const AVOption rtmp_options[] = {
     {"rtmp_tcurl", "URL of the target stream. Defaults to proto://host[:port]/app.", OFFSET(tcurl), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_listen", "Listen for incoming rtmp connections", OFFSET(listen), AV_OPT_TYPE_INT, {.i64 = 0}, INT_MIN, INT_MAX, DEC, "rtmp_listen" },
     {"listen",      "Listen for incoming rtmp connections", OFFSET(listen), AV_OPT_TYPE_INT, {.i64 = 0}, INT_MIN, INT_MAX, DEC, "rtmp_listen" },
+    {"rtmp_chunk_size", "Outgoing chunk size, 0 keeps the protocol default, -1 grows it with the message sizes", OFFSET(chunk_size), AV_OPT_TYPE_INT, {.i64 = 0}, -1, INT_MAX, DEC|ENC, "rtmp_chunk_size"},
+    {"auto", "grow with the message sizes", 0, AV_OPT_TYPE_CONST, {.i64 = -1}, 0, 0, DEC|ENC, "rtmp_chunk_size"},
     {"tcp_nodelay", "Use TCP_NODELAY to disable Nagle's algorithm", OFFSET(tcp_nodelay), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC|ENC},
     {"timeout", "Maximum timeout (in seconds) to wait for incoming connections. -1 is infinite. Implies -rtmp_listen 1",  OFFSET(listen_timeout), AV_OPT_TYPE_INT, {.i64 = -1}, INT_MIN, INT_MAX, DEC, "rtmp_listen" },
     { NULL },
@@ -438,26 +438,19 @@ void ff_rtp_send_punch_packets(URLContext *rtp_handle)
 static int find_missing_packets(RTPDemuxContext *s, uint16_t *first_missing,
                                 uint16_t *missing_mask)
 {
-    int i;
+    int i, left = s->queue_len;
     uint16_t next_seq = s->seq + 1;
-    RTPPacket *pkt = s->queue;
 
-    if (!pkt || pkt->seq == next_seq)
+    if (!left || s->queue_first == next_seq)
         return 0;
 
     *missing_mask = 0;
-    for (i = 1; i <= 16; i++) {
+    for (i = 1; i <= 16 && left; i++) {
         uint16_t missing_seq = next_seq + i;
-        while (pkt) {
-            int16_t diff = pkt->seq - missing_seq;
-            if (diff >= 0)
-                break;
-            pkt = pkt->next;
-        }
-        if (!pkt)
-            break;
-        if (pkt->seq == missing_seq)
+        if (s->queue[missing_seq & s->queue_mask].buf) {
+            left--;
             continue;
+        }
         *missing_mask |= 1 << (i - 1);
     }
 
@@ -779,11 +772,11 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
 
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 {
-    while (s->queue) {
-        RTPPacket *next = s->queue->next;
-        av_freep(&s->queue->buf);
-        av_freep(&s->queue);
-        s->queue = next;
+    for (int i = 0; s->queue_len && i <= s->queue_mask; i++) {
+        if (s->queue[i].buf) {
+            av_freep(&s->queue[i].buf);
+            s->queue_len--;
+        }
     }
     s->seq       = 0;
     s->queue_len = 0;
@@ -793,25 +786,40 @@ void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 static int enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
 {
     uint16_t seq   = AV_RB16(buf + 2);
-    RTPPacket **cur = &s->queue, *packet;
+    uint16_t diff  = seq - s->seq;
+    RTPPacket *packet;
+
+    if (!s->queue) {
+        /* Twice the queue size, so that packets up to that far ahead of
+         * the next expected one always have a slot of their own. */
+        int size = 1 << av_ceil_log2(2 * FFMIN(s->queue_size, 1 << 14));
+
+        s->queue = av_calloc(size, sizeof(*s->queue));
+        if (!s->queue)
+            return AVERROR(ENOMEM);
+        s->queue_mask = size - 1;
+    }
 
-    /* Find the correct place in the queue to insert the packet */
-    while (*cur) {
-        int16_t diff = seq - (*cur)->seq;
-        if (diff < 0)
-            break;
-        cur = &(*cur)->next;
+    if (diff > s->queue_mask + 1) {
+        av_log(s->ic, AV_LOG_WARNING,
+               "RTP: sequence number jumped by %d, dropping %d queued packets\n",
+               diff, s->queue_len);
+        ff_rtp_reset_packet_queue(s);
+        s->seq = seq - 1;
+    }
+
+    packet = &s->queue[seq & s->queue_mask];
+    if (packet->buf) {
+        av_log(s->ic, AV_LOG_WARNING, "RTP: dropping duplicate packet\n");
+        return AVERROR(EAGAIN);
     }
 
-    packet = av_mallocz(sizeof(*packet));
-    if (!packet)
-        return AVERROR(ENOMEM);
     packet->recvtime = av_gettime_relative();
     packet->seq      = seq;
     packet->len      = len;
     packet->buf      = buf;
-    packet->next     = *cur;
-    *cur = packet;
+    if (!s->queue_len || (int16_t)(seq - s->queue_first) < 0)
+        s->queue_first = seq;
     s->queue_len++;
 
     return 0;
@@ -819,24 +827,26 @@ static int enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
 
 static int has_next_packet(RTPDemuxContext *s)
 {
-    return s->queue && s->queue->seq == (uint16_t) (s->seq + 1);
+    return s->queue_len && s->queue_first == (uint16_t) (s->seq + 1);
 }
 
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
 {
-    return s->queue ? s->queue->recvtime : 0;
+    return s->queue_len ? s->queue[s->queue_first & s->queue_mask].recvtime : 0;
 }
 
 static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
 {
     int rv;
-    RTPPacket *next;
+    RTPPacket *first;
 
     if (s->queue_len <= 0)
         return -1;
 
+    first = &s->queue[s->queue_first & s->queue_mask];
+
     if (!has_next_packet(s)) {
-        int pkt_missed  = s->queue->seq - s->seq - 1;
+        int pkt_missed  = first->seq - s->seq - 1;
 
         if (pkt_missed < 0)
             pkt_missed += UINT16_MAX;
@@ -845,12 +855,13 @@ static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
     }
 
     /* Parse the first packet in the queue, and dequeue it */
-    rv   = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
-    next = s->queue->next;
-    av_freep(&s->queue->buf);
-    av_freep(&s->queue);
-    s->queue = next;
-    s->queue_len--;
+    rv   = rtp_parse_packet_internal(s, pkt, first->buf, first->len);
+    av_freep(&first->buf);
+    if (--s->queue_len > 0) {
+        do {
+            s->queue_first++;
+        } while (!s->queue[s->queue_first & s->queue_mask].buf);
+    }
     return rv;
 }
 
@@ -900,7 +911,7 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
         rtcp_update_jitter(&s->statistics, timestamp, arrival_ts);
     }
 
-    if ((s->seq == 0 && !s->queue) || s->queue_size <= 1) {
+    if ((s->seq == 0 && !s->queue_len) || s->queue_size <= 1) {
         /* First packet, or no reordering */
         return rtp_parse_packet_internal(s, pkt, buf, len);
     } else {
@@ -918,6 +929,8 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
         } else {
             /* Still missing some packet, enqueue this one. */
             rv = enqueue_packet(s, buf, len);
+            if (rv == AVERROR(EAGAIN))
+                return -1;
             if (rv < 0)
                 return rv;
             *bufptr = NULL;
@@ -957,6 +970,7 @@ int ff_rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
 void ff_rtp_parse_close(RTPDemuxContext *s)
 {
     ff_rtp_reset_packet_queue(s);
+    av_freep(&s->queue);
     ff_srtp_free(&s->srtp);
     av_free(s);
 }
@@ -139,10 +139,9 @@ struct RTPDynamicProtocolHandler {
 
 typedef struct RTPPacket {
     uint16_t seq;
-    uint8_t *buf;
+    uint8_t *buf;     ///< NULL if the slot is free
     int len;
     int64_t recvtime;
-    struct RTPPacket *next;
 } RTPPacket;
 
 struct RTPDemuxContext {
@@ -167,7 +166,9 @@ struct RTPDemuxContext {
 
     /** Fields for packet reordering @{ */
     int prev_ret;     ///< The return value of the actual parsing of the previous packet
-    RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
+    RTPPacket* queue; ///< Ring of buffered packets not yet returned, indexed by sequence number
+    int queue_mask;   ///< The number of slots in queue minus 1
+    uint16_t queue_first; ///< The sequence number of the first buffered packet
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
     /*@}*/
@@ -24,6 +24,7 @@
 #include "avio_internal.h"
 #include "rtpdec_formats.h"
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/parseutils.h"
 
@@ -36,7 +37,8 @@ struct PayloadContext {
     int interlaced;
     int field;
 
-    uint8_t *frame;
+    AVBufferPool *pool;
+    AVBufferRef *frame;
     unsigned int frame_size;
     unsigned int pgroup; /* size of the pixel group in bytes */
     unsigned int xinc;
@@ -204,20 +206,18 @@ static int rfc4175_parse_sdp_line(AVFormatContext *s, int st_index,
 static int rfc4175_finalize_packet(PayloadContext *data, AVPacket *pkt,
                                    int stream_index)
 {
-    int ret = 0;
-
     pkt->stream_index = stream_index;
     if (!data->interlaced || data->field) {
-        ret = av_packet_from_data(pkt, data->frame, data->frame_size);
-        if (ret < 0) {
-            av_freep(&data->frame);
-        }
+        /* the lines were assembled in a padded pool buffer, hand it over */
+        pkt->buf  = data->frame;
+        pkt->data = data->frame->data;
+        pkt->size = data->frame_size;
         data->frame = NULL;
     }
 
     data->field = 0;
 
-    return ret;
+    return 0;
 }
 
 static int rfc4175_handle_packet(AVFormatContext *ctx, PayloadContext *data,
@@ -247,8 +247,11 @@ static int rfc4175_handle_packet(AVFormatContext *ctx, PayloadContext *data,
             rfc4175_finalize_packet(data, pkt, st->index);
         }
 
-        if (!data->frame)
-            data->frame = av_malloc(data->frame_size);
+        if (!data->pool)
+            data->pool = av_buffer_pool_init(data->frame_size + AV_INPUT_BUFFER_PADDING_SIZE,
+                                             av_buffer_allocz);
+        if (!data->frame && data->pool)
+            data->frame = av_buffer_pool_get(data->pool);
 
         data->timestamp = *timestamp;
 
@@ -300,7 +303,7 @@ static int rfc4175_handle_packet(AVFormatContext *ctx, PayloadContext *data,
         if (copy_offset + length > data->frame_size || !data->frame)
             return AVERROR_INVALIDDATA;
 
-        dest = data->frame + copy_offset;
+        dest = data->frame->data + copy_offset;
         memcpy(dest, payload, length);
 
         payload += length;
@@ -316,6 +319,12 @@ static int rfc4175_handle_packet(AVFormatContext *ctx, PayloadContext *data,
     return AVERROR(EAGAIN);
 }
 
+static void rfc4175_close(PayloadContext *data)
+{
+    av_buffer_unref(&data->frame);
+    av_buffer_pool_uninit(&data->pool);
+}
+
 const RTPDynamicProtocolHandler ff_rfc4175_rtp_handler = {
     .enc_name           = "raw",
     .codec_type         = AVMEDIA_TYPE_VIDEO,
@@ -323,4 +332,5 @@ const RTPDynamicProtocolHandler ff_rfc4175_rtp_handler = {
     .priv_data_size     = sizeof(PayloadContext),
     .parse_sdp_a_line   = rfc4175_parse_sdp_line,
     .parse_packet       = rfc4175_handle_packet,
+    .close              = rfc4175_close,
 };
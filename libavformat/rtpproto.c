@@ -24,6 +24,8 @@
  * RTP protocol
  */
 
+#define _GNU_SOURCE     /* Needed for recvmmsg() with glibc */
+
 #include "libavutil/parseutils.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
@@ -62,6 +64,15 @@ typedef struct RTPContext {
     char *fec_options_str;
     int64_t rw_timeout;
     char *localaddr;
+    int batch_size;
+#if HAVE_RECVMMSG
+    /* RTP datagrams of the last recvmmsg() call not yet returned */
+    struct mmsghdr *rx_msgs;
+    struct iovec *rx_iov;
+    struct sockaddr_storage *rx_addrs;
+    uint8_t *rx_buf;
+    int rx_nb, rx_idx;
+#endif
 } RTPContext;
 
 #define OFFSET(x) offsetof(RTPContext, x)
@@ -82,6 +93,7 @@ static const AVOption options[] = {
     { "block",              "Block list",                                                       OFFSET(block),           AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "fec",                "FEC",                                                              OFFSET(fec_options_str), AV_OPT_TYPE_STRING, { .str = NULL },               .flags = E },
     { "localaddr",          "Local address",                                                    OFFSET(localaddr),       AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",         "Maximum number of RTP datagrams read per system call",             OFFSET(batch_size),      AV_OPT_TYPE_INT,    { .i64 = 1 },      1, 1024,    .flags = D },
     { NULL }
 };
 
@@ -202,6 +214,74 @@ static void build_udp_url(RTPContext *s,
         url_add_option(buf, buf_size, "localaddr=%s", localaddr);
 }
 
+#if HAVE_RECVMMSG
+#define RX_MSG_SIZE 65536
+
+static int alloc_rx_msgs(RTPContext *s)
+{
+    s->rx_msgs  = av_calloc(s->batch_size, sizeof(*s->rx_msgs));
+    s->rx_iov   = av_calloc(s->batch_size, sizeof(*s->rx_iov));
+    s->rx_addrs = av_calloc(s->batch_size, sizeof(*s->rx_addrs));
+    s->rx_buf   = av_malloc_array(s->batch_size, RX_MSG_SIZE);
+    if (!s->rx_msgs || !s->rx_iov || !s->rx_addrs || !s->rx_buf)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < s->batch_size; i++) {
+        struct msghdr *msg = &s->rx_msgs[i].msg_hdr;
+        s->rx_iov[i].iov_base = s->rx_buf + (size_t)i * RX_MSG_SIZE;
+        s->rx_iov[i].iov_len  = RX_MSG_SIZE;
+        msg->msg_name    = &s->rx_addrs[i];
+        msg->msg_iov     = &s->rx_iov[i];
+        msg->msg_iovlen  = 1;
+    }
+
+    return 0;
+}
+
+static void free_rx_msgs(RTPContext *s)
+{
+    av_freep(&s->rx_msgs);
+    av_freep(&s->rx_iov);
+    av_freep(&s->rx_addrs);
+    av_freep(&s->rx_buf);
+    s->rx_nb = s->rx_idx = 0;
+}
+
+/* read all the RTP datagrams available, up to batch_size, at once */
+static int read_rx_msgs(RTPContext *s)
+{
+    int nb_msgs;
+
+    for (int i = 0; i < s->batch_size; i++) {
+        s->rx_msgs[i].msg_hdr.msg_namelen = sizeof(*s->rx_addrs);
+        s->rx_msgs[i].msg_hdr.msg_flags   = 0;
+    }
+    nb_msgs = recvmmsg(s->rtp_fd, s->rx_msgs, s->batch_size, MSG_DONTWAIT, NULL);
+    if (nb_msgs < 0)
+        return ff_neterrno();
+    s->rx_nb  = nb_msgs;
+    s->rx_idx = 0;
+    return 0;
+}
+
+/* return the next datagram of the last batch, if any */
+static int get_rx_msg(RTPContext *s, uint8_t *buf, int size)
+{
+    while (s->rx_idx < s->rx_nb) {
+        int i   = s->rx_idx++;
+        int len = FFMIN(s->rx_msgs[i].msg_len, size);
+
+        if (ff_ip_check_source_lists(&s->rx_addrs[i], &s->filters))
+            continue;
+        s->last_rtp_source     = s->rx_addrs[i];
+        s->last_rtp_source_len = s->rx_msgs[i].msg_hdr.msg_namelen;
+        memcpy(buf, s->rx_iov[i].iov_base, len);
+        return len;
+    }
+    return AVERROR(EAGAIN);
+}
+#endif
+
 /**
  * url syntax: rtp://host:port[?option=val...]
  * option: 'ttl=n'            : set the ttl value (for multicast only)
@@ -275,6 +355,9 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "timeout", p)) {
             s->rw_timeout = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = av_clip(strtol(buf, NULL, 10), 1, 1024);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "sources", p)) {
             av_strlcpy(include_sources, buf, sizeof(include_sources));
             ff_ip_parse_sources(h, buf, &s->filters);
@@ -374,12 +457,25 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     h->max_packet_size = s->rtp_hd->max_packet_size;
     h->is_streamed = 1;
 
+    if (s->batch_size > 1 && (flags & AVIO_FLAG_READ)) {
+#if HAVE_RECVMMSG
+        if (alloc_rx_msgs(s) < 0)
+            goto fail;
+#else
+        av_log(h, AV_LOG_WARNING, "'batch_size' option was set but batching is "
+               "not supported in this configuration\n");
+#endif
+    }
+
     av_free(fec_protocol);
     av_dict_free(&fec_opts);
 
     return 0;
 
  fail:
+#if HAVE_RECVMMSG
+    free_rx_msgs(s);
+#endif
     ffurl_closep(&s->rtp_hd);
     ffurl_closep(&s->rtcp_hd);
     ffurl_closep(&s->fec_hd);
@@ -399,6 +495,10 @@ static int rtp_read(URLContext *h, uint8_t *buf, int size)
     int runs = h->rw_timeout / 1000 / POLLING_TIME;
 
     for(;;) {
+#if HAVE_RECVMMSG
+        if (s->rx_msgs && (len = get_rx_msg(s, buf, size)) >= 0)
+            return len;
+#endif
         if (ff_check_interrupt(&h->interrupt_callback))
             return AVERROR_EXIT;
         n = poll(p, 2, poll_delay);
@@ -407,6 +507,16 @@ static int rtp_read(URLContext *h, uint8_t *buf, int size)
             for (i = 1; i >= 0; i--) {
                 if (!(p[i].revents & POLLIN))
                     continue;
+#if HAVE_RECVMMSG
+                if (i == 0 && s->rx_msgs) {
+                    int ret = read_rx_msgs(s);
+                    if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                        return AVERROR(EIO);
+                    if ((len = get_rx_msg(s, buf, size)) >= 0)
+                        return len;
+                    continue;
+                }
+#endif
                 *addr_lens[i] = sizeof(*addrs[i]);
                 len = recvfrom(p[i].fd, buf, size, 0,
                                 (struct sockaddr *)addrs[i], addr_lens[i]);
@@ -523,6 +633,9 @@ static int rtp_close(URLContext *h)
     RTPContext *s = h->priv_data;
 
     ff_ip_reset_filters(&s->filters);
+#if HAVE_RECVMMSG
+    free_rx_msgs(s);
+#endif
 
     ffurl_closep(&s->rtp_hd);
     ffurl_closep(&s->rtcp_hd);
@@ -542,6 +655,16 @@ int ff_rtp_get_local_rtp_port(URLContext *h)
     return ff_udp_get_local_port(s->rtp_hd);
 }
 
+int ff_rtp_has_buffered_data(URLContext *h)
+{
+#if HAVE_RECVMMSG
+    RTPContext *s = h->priv_data;
+    return s->rx_idx < s->rx_nb;
+#else
+    return 0;
+#endif
+}
+
 /**
  * Return the local rtcp port used by the RTP connection
  * @param h media file context
@@ -27,4 +27,11 @@ int ff_rtp_set_remote_url(URLContext *h, const char *uri);
 
 int ff_rtp_get_local_rtp_port(URLContext *h);
 
+/**
+ * Check whether RTP datagrams received by an earlier batched read are
+ * waiting to be returned, in which case the sockets may not be readable
+ * even though more data is available.
+ */
+int ff_rtp_has_buffered_data(URLContext *h);
+
 #endif /* AVFORMAT_RTPPROTO_H */
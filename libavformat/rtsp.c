@@ -78,7 +78,8 @@
 #define COMMON_OPTS() \
     { "reorder_queue_size", "set number of packets to buffer for handling of reordered packets", OFFSET(reordering_queue_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC }, \
     { "buffer_size",        "Underlying protocol send/receive buffer size",                  OFFSET(buffer_size),           AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC|ENC }, \
-    { "pkt_size",           "Underlying protocol send packet size",                          OFFSET(pkt_size),              AV_OPT_TYPE_INT, { .i64 = 1472 }, -1, INT_MAX, ENC } \
+    { "pkt_size",           "Underlying protocol send packet size",                          OFFSET(pkt_size),              AV_OPT_TYPE_INT, { .i64 = 1472 }, -1, INT_MAX, ENC }, \
+    { "batch_size",         "Maximum number of RTP datagrams read per system call",          OFFSET(batch_size),            AV_OPT_TYPE_INT, { .i64 = 1 }, 1, 1024, DEC } \
 
 
 const AVOption ff_rtsp_options[] = {
@@ -131,6 +132,8 @@ static AVDictionary *map_to_opts(RTSPState *rt)
 
     av_dict_set_int(&opts, "buffer_size", rt->buffer_size, 0);
     av_dict_set_int(&opts, "pkt_size",    rt->pkt_size,    0);
+    if (rt->batch_size > 1)
+        av_dict_set_int(&opts, "batch_size", rt->batch_size, 0);
     if (rt->localaddr && rt->localaddr[0])
         av_dict_set(&opts, "localaddr", rt->localaddr, 0);
 
@@ -2085,6 +2088,17 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
             return AVERROR_EXIT;
         if (wait_end && wait_end - av_gettime_relative() < 0)
             return AVERROR(EAGAIN);
+        /* datagrams of an earlier batched read are not seen by poll() */
+        for (i = 0; rt->batch_size > 1 && i < rt->nb_rtsp_streams; i++) {
+            rtsp_st = rt->rtsp_streams[i];
+            if (rtsp_st->rtp_handle && ff_rtp_has_buffered_data(rtsp_st->rtp_handle)) {
+                ret = ffurl_read(rtsp_st->rtp_handle, buf, buf_size);
+                if (ret > 0) {
+                    *prtsp_st = rtsp_st;
+                    return ret;
+                }
+            }
+        }
         n = poll(p, rt->max_p, POLLING_TIME);
         if (n > 0) {
             int j = rt->rtsp_hd ? 1 : 0;
@@ -2524,6 +2538,8 @@ static int rtp_read_header(AVFormatContext *s)
         return AVERROR(EIO);
 
     opts = map_to_opts(rt);
+    /* only the first packet is read from this connection */
+    av_dict_set(&opts, "batch_size", NULL, 0);
     ret = ffurl_open_whitelist(&in, s->url, AVIO_FLAG_READ,
                      &s->interrupt_callback, &opts, s->protocol_whitelist, s->protocol_blacklist, NULL);
     av_dict_free(&opts);
@@ -127,19 +127,17 @@ int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                               timestamp, size, distance, flags);
 }
 
-int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
-                              int64_t wanted_timestamp, int flags)
+/**
+ * Search the entries between a and b, exclusive, with
+ * entries[a].timestamp <= wanted_timestamp <= entries[b].timestamp
+ * (a may be -1 and b nb_entries).
+ */
+static int index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
+                                  int a, int b, int64_t wanted_timestamp, int flags)
 {
-    int a, b, m;
+    int m;
     int64_t timestamp;
 
-    a = -1;
-    b = nb_entries;
-
-    // Optimize appending index entries at the end.
-    if (b && entries[b - 1].timestamp < wanted_timestamp)
-        a = b - 1;
-
     while (b - a > 1) {
         m         = (a + b) >> 1;
 
@@ -170,6 +168,97 @@ int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
     return m;
 }
 
+int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
+                              int64_t wanted_timestamp, int flags)
+{
+    int a = -1, b = nb_entries;
+
+    // Optimize appending index entries at the end.
+    if (b && entries[b - 1].timestamp < wanted_timestamp)
+        a = b - 1;
+
+    return index_search_timestamp(entries, nb_entries, a, b, wanted_timestamp, flags);
+}
+
+#define INDEX_DIR_MIN_ENTRIES    256
+#define INDEX_DIR_BUCKET_ENTRIES 8
+
+/**
+ * Extend the index directory to the entries appended since it was built, or
+ * rebuild it if the index was modified otherwise.
+ *
+ * The directory is only used for strictly increasing timestamps without
+ * discarded frames, for which the search result does not depend on the
+ * starting interval.
+ *
+ * @return 1 if the directory can be used, 0 otherwise
+ */
+static int update_index_dir(FFStream *sti)
+{
+    const AVIndexEntry *const e = sti->index_entries;
+    const int nb = sti->nb_index_entries;
+    int i = sti->index_dir_nb_entries;
+
+    if (nb < INDEX_DIR_MIN_ENTRIES)
+        return 0;
+
+    if (i > nb || (i && (e[0].timestamp     != sti->index_dir_start ||
+                         e[i - 1].timestamp != sti->index_dir_last_ts)))
+        i = 0;
+    if (i == nb)
+        return sti->nb_index_dir > 0;
+    /* rebuild it when the step no longer matches the density of the entries */
+    if (i && (!sti->nb_index_dir || nb > 4 * sti->nb_index_dir * INDEX_DIR_BUCKET_ENTRIES ||
+              e[nb - 1].timestamp < sti->index_dir_start ||
+              ((uint64_t)e[nb - 1].timestamp - sti->index_dir_start) / sti->index_dir_step >
+              4 * (nb / INDEX_DIR_BUCKET_ENTRIES)))
+        i = 0;
+
+    if (!i) {
+        uint64_t range = (uint64_t)e[nb - 1].timestamp - e[0].timestamp;
+
+        sti->nb_index_dir      = 0;
+        sti->index_dir_start   = e[0].timestamp;
+        sti->index_dir_step    = 0;
+        if (e[nb - 1].timestamp <= e[0].timestamp || range > INT64_MAX)
+            goto unusable;
+        sti->index_dir_step = FFMAX(range / (nb / INDEX_DIR_BUCKET_ENTRIES), 1);
+    }
+
+    for (; i < nb; i++) {
+        uint64_t bucket;
+
+        if ((e[i].flags & AVINDEX_DISCARD_FRAME) ||
+            (i && e[i].timestamp <= e[i - 1].timestamp) ||
+            e[i].timestamp < sti->index_dir_start)
+            goto unusable;
+
+        bucket = ((uint64_t)e[i].timestamp - sti->index_dir_start) / sti->index_dir_step;
+        if (bucket >= INT_MAX / sizeof(*sti->index_dir))
+            goto unusable;
+        if (bucket >= sti->nb_index_dir) {
+            int *dir = av_fast_realloc(sti->index_dir, &sti->index_dir_allocated_size,
+                                       (bucket + 1) * sizeof(*sti->index_dir));
+            if (!dir)
+                goto unusable;
+            sti->index_dir = dir;
+            while (sti->nb_index_dir <= bucket)
+                dir[sti->nb_index_dir++] = i;
+        }
+    }
+
+    sti->index_dir_nb_entries = nb;
+    sti->index_dir_last_ts    = e[nb - 1].timestamp;
+    return 1;
+
+unusable:
+    sti->nb_index_dir         = 0;
+    sti->index_dir_nb_entries = nb;
+    sti->index_dir_start      = e[0].timestamp;
+    sti->index_dir_last_ts    = e[nb - 1].timestamp;
+    return 0;
+}
+
 void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
 {
     int64_t pos_delta = 0;
@@ -239,7 +328,23 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
 
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
 {
-    const FFStream *const sti = ffstream(st);
+    FFStream *const sti = ffstream(st);
+
+    if (update_index_dir(sti) && wanted_timestamp >= sti->index_dir_start) {
+        uint64_t bucket = ((uint64_t)wanted_timestamp - sti->index_dir_start) /
+                          sti->index_dir_step;
+
+        /* The entries before the bucket are before the timestamp and the
+         * ones after it are after it. */
+        if (bucket < sti->nb_index_dir) {
+            int a = sti->index_dir[bucket] - 1;
+            int b = bucket + 1 < sti->nb_index_dir ? sti->index_dir[bucket + 1]
+                                                   : sti->nb_index_entries;
+            return index_search_timestamp(sti->index_entries, sti->nb_index_entries,
+                                          a, b, wanted_timestamp, flags);
+        }
+    }
+
     return ff_index_search_timestamp(sti->index_entries, sti->nb_index_entries,
                                      wanted_timestamp, flags);
 }
@@ -0,0 +1,129 @@
+/*
+ * Shared memory packet transport
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/error.h"
+#include "libavutil/time.h"
+#include "url.h"
+#include "shm.h"
+
+static void get_path(char *path, size_t size, const char *name)
+{
+    av_strstart(name, "shm:", &name);
+    snprintf(path, size, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+static void shm_unmap(void *opaque, uint8_t *data)
+{
+    munmap(data, (size_t)(uintptr_t)opaque);
+}
+
+int ff_shm_map(void *logctx, const char *name, int create, size_t size,
+               AVBufferRef **map)
+{
+    char path[256];
+    struct stat st;
+    void *ptr;
+    int fd, ret;
+
+    get_path(path, sizeof(path), name);
+
+    if (create) {
+        /* left over by an interrupted muxer */
+        shm_unlink(path);
+        fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    } else {
+        fd = shm_open(path, O_RDWR, 0);
+    }
+    if (fd < 0)
+        return AVERROR(errno);
+
+    if (create) {
+        if (ftruncate(fd, size) < 0) {
+            ret = AVERROR(errno);
+            av_log(logctx, AV_LOG_ERROR, "Cannot allocate %zu bytes of shared memory: %s\n",
+                   size, av_err2str(ret));
+            close(fd);
+            shm_unlink(path);
+            return ret;
+        }
+    } else {
+        if (fstat(fd, &st) < 0) {
+            ret = AVERROR(errno);
+            close(fd);
+            return ret;
+        }
+        /* not sized by the muxer yet */
+        if (!st.st_size) {
+            close(fd);
+            return AVERROR(EAGAIN);
+        }
+        size = st.st_size;
+    }
+
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ret = AVERROR(errno);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        av_log(logctx, AV_LOG_ERROR, "Cannot map shared memory: %s\n", av_err2str(ret));
+        if (create)
+            shm_unlink(path);
+        return ret;
+    }
+
+    *map = av_buffer_create(ptr, size, shm_unmap, (void *)(uintptr_t)size, 0);
+    if (!*map) {
+        munmap(ptr, size);
+        if (create)
+            shm_unlink(path);
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+void ff_shm_unlink(const char *name)
+{
+    char path[256];
+
+    get_path(path, sizeof(path), name);
+    shm_unlink(path);
+}
+
+int ff_shm_wait(AVFormatContext *s, ShmHeader *hdr)
+{
+    /* the condition uses the realtime clock */
+    int64_t t = av_gettime() + 100000;
+    struct timespec ts = { .tv_sec = t / 1000000, .tv_nsec = t % 1000000 * 1000 };
+
+    if (ff_check_interrupt(&s->interrupt_callback))
+        return AVERROR_EXIT;
+
+    pthread_cond_timedwait(&hdr->cond, &hdr->mutex, &ts);
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Shared memory packet transport
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_SHM_H
+#define AVFORMAT_SHM_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/macros.h"
+#include "libavutil/rational.h"
+#include "avformat.h"
+
+/*
+ * The shared memory object holds a ShmHeader, followed by nb_slots slots of
+ * slot_stride bytes starting at data_offset. The muxer copies each packet
+ * into a free slot, the demuxer returns packets referencing the slots
+ * directly, which are given back to the muxer when the packets are freed.
+ * The slots are handed over in the order of their sequence numbers, but may
+ * be released in any order. All the fields but magic are protected by the
+ * process-shared mutex.
+ */
+
+#define SHM_MAGIC            MKBETAG('F', 'F', 'S', 'M')
+#define SHM_VERSION          1
+#define SHM_MAX_EXTRADATA    4096
+#define SHM_MAX_SLOTS        1024
+#define SHM_ALIGN            64
+
+enum ShmSlotState {
+    SHM_SLOT_FREE,
+    /* being filled by the muxer */
+    SHM_SLOT_WRITING,
+    /* waiting for the demuxer */
+    SHM_SLOT_READY,
+    /* referenced by a packet of the demuxer */
+    SHM_SLOT_IN_USE,
+};
+
+typedef struct ShmSlot {
+    int      state;
+    uint32_t seq;
+    int      size;
+    int      flags;
+    int64_t  pts;
+    int64_t  dts;
+    int64_t  duration;
+} ShmSlot;
+
+typedef struct ShmHeader {
+    /* stored last by the muxer, once everything else is set */
+    atomic_uint magic;
+    uint32_t version;
+    uint32_t nb_slots;
+    uint32_t slot_size;
+    uint32_t slot_stride;
+    uint64_t data_offset;
+
+    /* parameters of the only stream */
+    int      codec_type;
+    int      codec_id;
+    uint32_t codec_tag;
+    int      format;
+    int      width;
+    int      height;
+    int      bits_per_coded_sample;
+    int      sample_rate;
+    int      ch_order;
+    int      nb_channels;
+    uint64_t ch_mask;
+    int      field_order;
+    int      color_range;
+    int      color_primaries;
+    int      color_trc;
+    int      color_space;
+    int      chroma_location;
+    AVRational time_base;
+    AVRational sample_aspect_ratio;
+    AVRational framerate;
+    int      extradata_size;
+    uint8_t  extradata[SHM_MAX_EXTRADATA];
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    /* sequence number of the next packet written */
+    uint32_t write_seq;
+    int      eof;
+    int      reader_closed;
+    ShmSlot  slots[];
+} ShmHeader;
+
+/**
+ * Map the shared memory object called name, creating it with the given size
+ * if create is set. The mapping is unmapped when the returned buffer is freed.
+ */
+int ff_shm_map(void *logctx, const char *name, int create, size_t size,
+               AVBufferRef **map);
+
+/**
+ * Remove the name of the shared memory object, existing mappings are kept.
+ */
+void ff_shm_unlink(const char *name);
+
+/**
+ * Wait for the other side to change the state of the slots, at most 100ms.
+ * Must be called with the mutex locked.
+ *
+ * @return 0, or AVERROR_EXIT if s was interrupted
+ */
+int ff_shm_wait(AVFormatContext *s, ShmHeader *hdr);
+
+#endif /* AVFORMAT_SHM_H */
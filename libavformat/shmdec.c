@@ -0,0 +1,280 @@
+/*
+ * Shared memory packet transport demuxer
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "internal.h"
+#include "shm.h"
+#include "url.h"
+
+typedef struct ShmDemuxContext {
+    const AVClass *class;
+    int64_t timeout;
+
+    AVBufferRef *map;
+    ShmHeader *hdr;
+    uint32_t read_seq;
+
+    /* layout of the mapping, validated once, as the muxer may change the
+     * shared copy at any time */
+    uint32_t nb_slots;
+    uint32_t slot_size;
+    uint32_t slot_stride;
+    uint64_t data_offset;
+} ShmDemuxContext;
+
+typedef struct ShmSlotRef {
+    AVBufferRef *map;
+    int idx;
+} ShmSlotRef;
+
+static int shm_read_header(AVFormatContext *s)
+{
+    ShmDemuxContext *c = s->priv_data;
+    int64_t deadline = c->timeout >= 0 ? av_gettime_relative() + c->timeout : INT64_MAX;
+    AVCodecParameters *par;
+    AVRational time_base;
+    ShmHeader *hdr;
+    AVStream *st;
+    int extradata_size, ret;
+
+    /* the demuxer may be started before the muxer */
+    while (1) {
+        ret = ff_shm_map(s, s->url, 0, 0, &c->map);
+        if (ret >= 0) {
+            hdr = (ShmHeader *)c->map->data;
+            if (c->map->size >= sizeof(*hdr) &&
+                atomic_load_explicit(&hdr->magic, memory_order_acquire) == SHM_MAGIC)
+                break;
+            av_buffer_unref(&c->map);
+        } else if (ret != AVERROR(ENOENT) && ret != AVERROR(EAGAIN)) {
+            return ret;
+        }
+        if (ff_check_interrupt(&s->interrupt_callback))
+            return AVERROR_EXIT;
+        if (av_gettime_relative() > deadline) {
+            av_log(s, AV_LOG_ERROR, "Shared memory object '%s' not found\n", s->url);
+            return AVERROR(ETIMEDOUT);
+        }
+        av_usleep(10000);
+    }
+    c->hdr = hdr;
+
+    c->nb_slots    = hdr->nb_slots;
+    c->slot_size   = hdr->slot_size;
+    c->slot_stride = hdr->slot_stride;
+    c->data_offset = hdr->data_offset;
+    extradata_size = hdr->extradata_size;
+    time_base      = hdr->time_base;
+
+    if (hdr->version != SHM_VERSION ||
+        !c->nb_slots || c->nb_slots > SHM_MAX_SLOTS ||
+        c->slot_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE ||
+        c->slot_stride < (uint64_t)c->slot_size + AV_INPUT_BUFFER_PADDING_SIZE ||
+        c->data_offset < sizeof(*hdr) + (uint64_t)c->nb_slots * sizeof(*hdr->slots) ||
+        c->data_offset > c->map->size ||
+        (uint64_t)c->nb_slots * c->slot_stride > c->map->size - c->data_offset ||
+        extradata_size < 0 || extradata_size > SHM_MAX_EXTRADATA) {
+        av_log(s, AV_LOG_ERROR, "Unsupported shared memory layout\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    st = avformat_new_stream(s, NULL);
+    if (!st)
+        return AVERROR(ENOMEM);
+    par = st->codecpar;
+
+    par->codec_type            = hdr->codec_type;
+    par->codec_id              = hdr->codec_id;
+    par->codec_tag             = hdr->codec_tag;
+    par->format                = hdr->format;
+    par->width                 = hdr->width;
+    par->height                = hdr->height;
+    par->bits_per_coded_sample = hdr->bits_per_coded_sample;
+    par->sample_rate           = hdr->sample_rate;
+    par->field_order           = hdr->field_order;
+    par->color_range           = hdr->color_range;
+    par->color_primaries       = hdr->color_primaries;
+    par->color_trc             = hdr->color_trc;
+    par->color_space           = hdr->color_space;
+    par->chroma_location       = hdr->chroma_location;
+    par->sample_aspect_ratio   = hdr->sample_aspect_ratio;
+    st->sample_aspect_ratio    = hdr->sample_aspect_ratio;
+    st->avg_frame_rate         = hdr->framerate;
+    st->r_frame_rate           = hdr->framerate;
+
+    if (hdr->nb_channels > 0) {
+        if (hdr->ch_order == AV_CHANNEL_ORDER_NATIVE && hdr->ch_mask) {
+            ret = av_channel_layout_from_mask(&par->ch_layout, hdr->ch_mask);
+            if (ret < 0)
+                return ret;
+        } else {
+            par->ch_layout.order       = AV_CHANNEL_ORDER_UNSPEC;
+            par->ch_layout.nb_channels = hdr->nb_channels;
+        }
+    }
+
+    if (extradata_size) {
+        if ((ret = ff_alloc_extradata(par, extradata_size)) < 0)
+            return ret;
+        memcpy(par->extradata, hdr->extradata, extradata_size);
+    }
+
+    if (time_base.num <= 0 || time_base.den <= 0)
+        return AVERROR_INVALIDDATA;
+    avpriv_set_pts_info(st, 64, time_base.num, time_base.den);
+
+    return 0;
+}
+
+static void free_slot(ShmHeader *hdr, int idx)
+{
+    pthread_mutex_lock(&hdr->mutex);
+    hdr->slots[idx].state = SHM_SLOT_FREE;
+    pthread_cond_broadcast(&hdr->cond);
+    pthread_mutex_unlock(&hdr->mutex);
+}
+
+static void release_slot(void *opaque, uint8_t *data)
+{
+    ShmSlotRef *ref = opaque;
+
+    free_slot((ShmHeader *)ref->map->data, ref->idx);
+    av_buffer_unref(&ref->map);
+    av_free(ref);
+}
+
+static int shm_read_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    ShmDemuxContext *c = s->priv_data;
+    ShmHeader *hdr = c->hdr;
+    int64_t deadline = c->timeout >= 0 ? av_gettime_relative() + c->timeout : INT64_MAX;
+    ShmSlotRef *ref;
+    ShmSlot slot;
+    uint8_t *data;
+    int idx = -1, ret = 0;
+
+    pthread_mutex_lock(&hdr->mutex);
+    while (idx < 0) {
+        for (int i = 0; i < c->nb_slots; i++) {
+            if (hdr->slots[i].state == SHM_SLOT_READY &&
+                hdr->slots[i].seq   == c->read_seq) {
+                idx = i;
+                break;
+            }
+        }
+        if (idx >= 0) {
+            hdr->slots[idx].state = SHM_SLOT_IN_USE;
+            slot = hdr->slots[idx];
+            c->read_seq++;
+        } else if (hdr->eof) {
+            ret = AVERROR_EOF;
+            break;
+        } else if (av_gettime_relative() > deadline) {
+            /* the muxer may have exited without setting eof */
+            av_log(s, AV_LOG_ERROR, "No packet written by the muxer\n");
+            ret = AVERROR(ETIMEDOUT);
+            break;
+        } else if ((ret = ff_shm_wait(s, hdr)) < 0) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&hdr->mutex);
+    if (ret < 0)
+        return ret;
+
+    if (slot.size < 0 || slot.size > c->slot_size) {
+        av_log(s, AV_LOG_ERROR, "Invalid packet size %d\n", slot.size);
+        free_slot(hdr, idx);
+        return AVERROR_INVALIDDATA;
+    }
+
+    data = c->map->data + c->data_offset + (size_t)idx * c->slot_stride;
+    ref  = av_mallocz(sizeof(*ref));
+    if (ref)
+        ref->map = av_buffer_ref(c->map);
+    if (ref && ref->map) {
+        ref->idx = idx;
+        pkt->buf = av_buffer_create(data, slot.size + AV_INPUT_BUFFER_PADDING_SIZE,
+                                    release_slot, ref, 0);
+    }
+    if (!pkt->buf) {
+        if (ref)
+            av_buffer_unref(&ref->map);
+        av_free(ref);
+        free_slot(hdr, idx);
+        return AVERROR(ENOMEM);
+    }
+
+    pkt->data     = data;
+    pkt->size     = slot.size;
+    pkt->flags    = slot.flags;
+    pkt->pts      = slot.pts;
+    pkt->dts      = slot.dts;
+    pkt->duration = slot.duration;
+
+    return 0;
+}
+
+static int shm_read_close(AVFormatContext *s)
+{
+    ShmDemuxContext *c = s->priv_data;
+
+    if (c->hdr) {
+        pthread_mutex_lock(&c->hdr->mutex);
+        c->hdr->reader_closed = 1;
+        pthread_cond_broadcast(&c->hdr->cond);
+        pthread_mutex_unlock(&c->hdr->mutex);
+    }
+    /* packets still referencing the slots keep the mapping alive */
+    av_buffer_unref(&c->map);
+
+    return 0;
+}
+
+#define OFFSET(x) offsetof(ShmDemuxContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+static const AVOption options[] = {
+    { "timeout", "how long to wait for the muxer to create the shared memory object or to write a packet, -1 for no limit",
+      OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT64_MAX, D },
+    { NULL },
+};
+
+static const AVClass shm_demuxer_class = {
+    .class_name = "shm demuxer",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+const AVInputFormat ff_shm_demuxer = {
+    .name           = "shm",
+    .long_name      = NULL_IF_CONFIG_SMALL("Shared memory packet transport"),
+    .priv_data_size = sizeof(ShmDemuxContext),
+    .flags_internal = FF_FMT_INIT_CLEANUP,
+    .read_header    = shm_read_header,
+    .read_packet    = shm_read_packet,
+    .read_close     = shm_read_close,
+    .flags          = AVFMT_NOFILE,
+    .priv_class     = &shm_demuxer_class,
+};
@@ -0,0 +1,267 @@
+/*
+ * Shared memory packet transport muxer
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "avformat.h"
+#include "internal.h"
+#include "shm.h"
+
+#define DEFAULT_SLOT_SIZE (1 << 20)
+
+typedef struct ShmMuxContext {
+    const AVClass *class;
+    int nb_slots;
+    int slot_size;
+
+    AVBufferRef *map;
+    ShmHeader *hdr;
+    uint8_t *data;
+    int init_done;
+} ShmMuxContext;
+
+static int shm_init(AVFormatContext *s)
+{
+    ShmMuxContext *c = s->priv_data;
+    AVCodecParameters *par;
+    ShmHeader *hdr;
+    pthread_mutexattr_t mattr;
+    pthread_condattr_t cattr;
+    size_t header_size, stride;
+    int ret;
+
+    if (s->nb_streams != 1) {
+        av_log(s, AV_LOG_ERROR, "Exactly one stream is supported\n");
+        return AVERROR(EINVAL);
+    }
+    par = s->streams[0]->codecpar;
+
+    if (par->extradata_size > SHM_MAX_EXTRADATA) {
+        av_log(s, AV_LOG_ERROR, "Extradata larger than %d bytes\n", SHM_MAX_EXTRADATA);
+        return AVERROR_PATCHWELCOME;
+    }
+
+    if (!c->slot_size) {
+        c->slot_size = DEFAULT_SLOT_SIZE;
+        /* one frame per packet */
+        if (par->codec_id == AV_CODEC_ID_RAWVIDEO && par->format >= 0) {
+            ret = av_image_get_buffer_size(par->format, par->width, par->height, 1);
+            if (ret > 0)
+                c->slot_size = ret;
+        }
+    }
+
+    stride      = FFALIGN((size_t)c->slot_size + AV_INPUT_BUFFER_PADDING_SIZE, SHM_ALIGN);
+    header_size = FFALIGN(sizeof(*hdr) + c->nb_slots * sizeof(*hdr->slots), 4096);
+    if (stride > UINT32_MAX || stride > (SIZE_MAX - header_size) / c->nb_slots)
+        return AVERROR(EINVAL);
+
+    ret = ff_shm_map(s, s->url, 1, header_size + c->nb_slots * stride, &c->map);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Cannot create shared memory object '%s': %s\n",
+               s->url, av_err2str(ret));
+        return ret;
+    }
+    hdr     = c->hdr = (ShmHeader *)c->map->data;
+    c->data = c->map->data + header_size;
+
+    hdr->version     = SHM_VERSION;
+    hdr->nb_slots    = c->nb_slots;
+    hdr->slot_size   = c->slot_size;
+    hdr->slot_stride = stride;
+    hdr->data_offset = header_size;
+
+    hdr->codec_type            = par->codec_type;
+    hdr->codec_id              = par->codec_id;
+    hdr->codec_tag             = par->codec_tag;
+    hdr->format                = par->format;
+    hdr->width                 = par->width;
+    hdr->height                = par->height;
+    hdr->bits_per_coded_sample = par->bits_per_coded_sample;
+    hdr->sample_rate           = par->sample_rate;
+    hdr->ch_order              = par->ch_layout.order;
+    hdr->nb_channels           = par->ch_layout.nb_channels;
+    hdr->ch_mask               = par->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ?
+                                 par->ch_layout.u.mask : 0;
+    hdr->field_order           = par->field_order;
+    hdr->color_range           = par->color_range;
+    hdr->color_primaries       = par->color_primaries;
+    hdr->color_trc             = par->color_trc;
+    hdr->color_space           = par->color_space;
+    hdr->chroma_location       = par->chroma_location;
+    hdr->time_base             = s->streams[0]->time_base;
+    hdr->sample_aspect_ratio   = par->sample_aspect_ratio;
+    hdr->framerate             = s->streams[0]->avg_frame_rate;
+    hdr->extradata_size        = par->extradata_size;
+    if (par->extradata_size)
+        memcpy(hdr->extradata, par->extradata, par->extradata_size);
+
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    ret = pthread_mutex_init(&hdr->mutex, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+    if (ret)
+        return AVERROR(ret);
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    ret = pthread_cond_init(&hdr->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+    if (ret) {
+        pthread_mutex_destroy(&hdr->mutex);
+        return AVERROR(ret);
+    }
+    c->init_done = 1;
+
+    atomic_store_explicit(&hdr->magic, SHM_MAGIC, memory_order_release);
+
+    return 0;
+}
+
+static int shm_write_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    ShmMuxContext *c = s->priv_data;
+    ShmHeader *hdr = c->hdr;
+    ShmSlot *slot = NULL;
+    uint8_t *data;
+    int ret = 0;
+
+    if (pkt->size > c->slot_size) {
+        av_log(s, AV_LOG_ERROR, "Packet of %d bytes larger than the slots, "
+               "increase slot_size\n", pkt->size);
+        return AVERROR(EINVAL);
+    }
+
+    pthread_mutex_lock(&hdr->mutex);
+    while (!slot) {
+        if (hdr->reader_closed) {
+            ret = AVERROR(EPIPE);
+            break;
+        }
+        for (int i = 0; i < hdr->nb_slots; i++) {
+            if (hdr->slots[i].state == SHM_SLOT_FREE) {
+                slot = &hdr->slots[i];
+                break;
+            }
+        }
+        if (slot)
+            slot->state = SHM_SLOT_WRITING;
+        else if ((ret = ff_shm_wait(s, hdr)) < 0)
+            break;
+    }
+    pthread_mutex_unlock(&hdr->mutex);
+    if (ret < 0)
+        return ret;
+
+    /* the only copy of the packet, done without holding the lock */
+    data = c->data + (size_t)(slot - hdr->slots) * hdr->slot_stride;
+    memcpy(data, pkt->data, pkt->size);
+    memset(data + pkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    pthread_mutex_lock(&hdr->mutex);
+    slot->size     = pkt->size;
+    slot->flags    = pkt->flags;
+    slot->pts      = pkt->pts;
+    slot->dts      = pkt->dts;
+    slot->duration = pkt->duration;
+    slot->seq      = hdr->write_seq++;
+    slot->state    = SHM_SLOT_READY;
+    pthread_cond_broadcast(&hdr->cond);
+    pthread_mutex_unlock(&hdr->mutex);
+
+    return 0;
+}
+
+static int shm_write_trailer(AVFormatContext *s)
+{
+    ShmMuxContext *c = s->priv_data;
+    ShmHeader *hdr = c->hdr;
+    int ret = 0;
+
+    pthread_mutex_lock(&hdr->mutex);
+    hdr->eof = 1;
+    pthread_cond_broadcast(&hdr->cond);
+
+    /* the name is removed when closing, so that a demuxer started late
+     * still finds the object as long as it holds unread packets */
+    while (!hdr->reader_closed) {
+        int pending = 0;
+        for (int i = 0; i < hdr->nb_slots; i++)
+            pending |= hdr->slots[i].state == SHM_SLOT_READY;
+        if (!pending)
+            break;
+        if ((ret = ff_shm_wait(s, hdr)) < 0)
+            break;
+    }
+    pthread_mutex_unlock(&hdr->mutex);
+
+    return ret;
+}
+
+static void shm_deinit(AVFormatContext *s)
+{
+    ShmMuxContext *c = s->priv_data;
+
+    if (!c->map)
+        return;
+
+    ff_shm_unlink(s->url);
+    if (c->init_done && !c->hdr->eof) {
+        /* interrupted: wake up the demuxer waiting for packets */
+        pthread_mutex_lock(&c->hdr->mutex);
+        c->hdr->eof = 1;
+        pthread_cond_broadcast(&c->hdr->cond);
+        pthread_mutex_unlock(&c->hdr->mutex);
+    }
+    /* the demuxer keeps its own mapping */
+    av_buffer_unref(&c->map);
+}
+
+#define OFFSET(x) offsetof(ShmMuxContext, x)
+#define E AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption options[] = {
+    { "nb_slots",  "number of packets held in shared memory", OFFSET(nb_slots),  AV_OPT_TYPE_INT, { .i64 = 8 }, 2, SHM_MAX_SLOTS, E },
+    { "slot_size", "maximum packet size, 0 for the size of a raw video frame or 1 MiB",
+                                                               OFFSET(slot_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE - SHM_ALIGN, E },
+    { NULL },
+};
+
+static const AVClass shm_muxer_class = {
+    .class_name = "shm muxer",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+const AVOutputFormat ff_shm_muxer = {
+    .name           = "shm",
+    .long_name      = NULL_IF_CONFIG_SMALL("Shared memory packet transport"),
+    .priv_data_size = sizeof(ShmMuxContext),
+    .audio_codec    = AV_CODEC_ID_PCM_S16LE,
+    .video_codec    = AV_CODEC_ID_RAWVIDEO,
+    .init           = shm_init,
+    .write_packet   = shm_write_packet,
+    .write_trailer  = shm_write_trailer,
+    .deinit         = shm_deinit,
+    .priv_class     = &shm_muxer_class,
+    .flags          = AVFMT_NOFILE | AVFMT_TS_NONSTRICT,
+};
@@ -0,0 +1,438 @@
+/*
+ * Cache of the stream parameters found by avformat_find_stream_info()
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Each entry is a file in the cache directory named after the MD5 of the
+ * input URL. It holds the name of the demuxer, the fingerprint (id, media
+ * type, codec id and time base) of each stream as created by the demuxer
+ * before probing, then the parameters of these streams after probing.
+ * An entry is only used if all the fingerprints match.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/md5.h"
+#include "libavutil/random_seed.h"
+
+#include "libavcodec/avcodec.h"
+
+#include "avformat.h"
+#include "avio_internal.h"
+#include "demux.h"
+#include "internal.h"
+#include "url.h"
+
+#define CACHE_TAG     MKBETAG('F', 'F', 'S', 'I')
+#define CACHE_VERSION 1
+
+typedef struct StreamFingerprint {
+    int        id;
+    int        codec_type;
+    int        codec_id;
+    AVRational time_base;
+} StreamFingerprint;
+
+struct FFStreamInfoCacheKey {
+    char              *path;
+    unsigned           nb_streams;
+    StreamFingerprint *streams;
+};
+
+typedef struct CachedStream {
+    AVCodecParameters *par;
+    AVRational         r_frame_rate;
+    AVRational         avg_frame_rate;
+    AVRational         sample_aspect_ratio;
+    AVPacketSideData  *side_data;
+    int                nb_side_data;
+} CachedStream;
+
+static AVRational read_rational(AVIOContext *pb)
+{
+    AVRational q;
+    q.num = avio_rb32(pb);
+    q.den = avio_rb32(pb);
+    return q;
+}
+
+static void write_rational(AVIOContext *pb, AVRational q)
+{
+    avio_wb32(pb, q.num);
+    avio_wb32(pb, q.den);
+}
+
+void ff_stream_info_cache_key_free(FFStreamInfoCacheKey **pkey)
+{
+    FFStreamInfoCacheKey *key = *pkey;
+
+    if (!key)
+        return;
+
+    av_freep(&key->path);
+    av_freep(&key->streams);
+    av_freep(pkey);
+}
+
+static int key_alloc(FFStreamInfoCacheKey **pkey, const AVFormatContext *s)
+{
+    FFStreamInfoCacheKey *key;
+    uint8_t md5[16];
+    char hex[33];
+
+    key = av_mallocz(sizeof(*key));
+    if (!key)
+        return AVERROR(ENOMEM);
+
+    av_md5_sum(md5, s->url, strlen(s->url));
+    ff_data_to_hex(hex, md5, sizeof(md5), 1);
+    hex[32] = 0;
+    key->path = av_asprintf("%s/%s", s->stream_info_cache, hex);
+
+    key->nb_streams = s->nb_streams;
+    key->streams    = av_calloc(s->nb_streams, sizeof(*key->streams));
+    if (!key->path || !key->streams) {
+        ff_stream_info_cache_key_free(&key);
+        return AVERROR(ENOMEM);
+    }
+
+    for (unsigned i = 0; i < s->nb_streams; i++) {
+        const AVStream *const st = s->streams[i];
+        key->streams[i] = (StreamFingerprint) {
+            .id         = st->id,
+            .codec_type = st->codecpar->codec_type,
+            .codec_id   = st->codecpar->codec_id,
+            .time_base  = st->time_base,
+        };
+    }
+
+    *pkey = key;
+    return 0;
+}
+
+static void cached_stream_uninit(CachedStream *cs)
+{
+    avcodec_parameters_free(&cs->par);
+    for (int i = 0; i < cs->nb_side_data; i++)
+        av_freep(&cs->side_data[i].data);
+    av_freep(&cs->side_data);
+}
+
+static int read_stream(AVFormatContext *s, CachedStream *cs, AVIOContext *pb)
+{
+    AVCodecParameters *par;
+    enum AVChannelOrder order;
+    int nb_channels, extradata_size, ret;
+    uint64_t mask;
+
+    par = cs->par = avcodec_parameters_alloc();
+    if (!par)
+        return AVERROR(ENOMEM);
+    par->codec_type            = avio_rb32(pb);
+    par->codec_id              = avio_rb32(pb);
+    par->codec_tag             = avio_rb32(pb);
+    par->format                = avio_rb32(pb);
+    par->bit_rate              = avio_rb64(pb);
+    par->bits_per_coded_sample = avio_rb32(pb);
+    par->bits_per_raw_sample   = avio_rb32(pb);
+    par->profile               = avio_rb32(pb);
+    par->level                 = avio_rb32(pb);
+    par->width                 = avio_rb32(pb);
+    par->height                = avio_rb32(pb);
+    par->sample_aspect_ratio   = read_rational(pb);
+    par->field_order           = avio_rb32(pb);
+    par->color_range           = avio_rb32(pb);
+    par->color_primaries       = avio_rb32(pb);
+    par->color_trc             = avio_rb32(pb);
+    par->color_space           = avio_rb32(pb);
+    par->chroma_location       = avio_rb32(pb);
+    par->video_delay           = avio_rb32(pb);
+    order                      = avio_rb32(pb);
+    nb_channels                = avio_rb32(pb);
+    mask                       = avio_rb64(pb);
+    par->sample_rate           = avio_rb32(pb);
+    par->block_align           = avio_rb32(pb);
+    par->frame_size            = avio_rb32(pb);
+    par->initial_padding       = avio_rb32(pb);
+    par->trailing_padding      = avio_rb32(pb);
+    par->seek_preroll          = avio_rb32(pb);
+    cs->r_frame_rate           = read_rational(pb);
+    cs->avg_frame_rate         = read_rational(pb);
+    cs->sample_aspect_ratio    = read_rational(pb);
+
+    if (order == AV_CHANNEL_ORDER_NATIVE) {
+        if (av_channel_layout_from_mask(&par->ch_layout, mask) < 0)
+            return AVERROR_INVALIDDATA;
+    } else if (nb_channels > 0) {
+        /* the map of a custom layout is not cached, only its channel count */
+        par->ch_layout.order       = order == AV_CHANNEL_ORDER_AMBISONIC ?
+                                     order : AV_CHANNEL_ORDER_UNSPEC;
+        par->ch_layout.nb_channels = nb_channels;
+        par->ch_layout.u.mask      = order == AV_CHANNEL_ORDER_AMBISONIC ? mask : 0;
+        if (!av_channel_layout_check(&par->ch_layout))
+            return AVERROR_INVALIDDATA;
+    }
+
+    extradata_size = avio_rb32(pb);
+    if (extradata_size < 0 || extradata_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR_INVALIDDATA;
+    if (extradata_size) {
+        ret = ff_get_extradata(s, par, pb, extradata_size);
+        if (ret < 0)
+            return ret;
+    }
+
+    cs->nb_side_data = avio_rb32(pb);
+    if (cs->nb_side_data < 0 || cs->nb_side_data > AV_PKT_DATA_NB) {
+        cs->nb_side_data = 0;
+        return AVERROR_INVALIDDATA;
+    }
+    cs->side_data = av_calloc(cs->nb_side_data, sizeof(*cs->side_data));
+    if (!cs->side_data && cs->nb_side_data) {
+        cs->nb_side_data = 0;
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < cs->nb_side_data; i++) {
+        AVPacketSideData *const sd = &cs->side_data[i];
+        int size;
+
+        sd->type = avio_rb32(pb);
+        size     = avio_rb32(pb);
+        if (sd->type >= AV_PKT_DATA_NB || size < 0 || avio_feof(pb))
+            return AVERROR_INVALIDDATA;
+        sd->data = av_malloc(size);
+        if (!sd->data)
+            return AVERROR(ENOMEM);
+        sd->size = size;
+        ret = ffio_read_size(pb, sd->data, size);
+        if (ret < 0)
+            return ret;
+    }
+
+    return pb->error ? pb->error : avio_feof(pb) ? AVERROR_INVALIDDATA : 0;
+}
+
+static int apply_stream(AVStream *st, CachedStream *cs)
+{
+    int ret = avcodec_parameters_copy(st->codecpar, cs->par);
+    if (ret < 0)
+        return ret;
+
+    st->r_frame_rate        = cs->r_frame_rate;
+    st->avg_frame_rate      = cs->avg_frame_rate;
+    st->sample_aspect_ratio = cs->sample_aspect_ratio;
+
+    for (int i = 0; i < cs->nb_side_data; i++) {
+        AVPacketSideData *const sd = &cs->side_data[i];
+        ret = av_stream_add_side_data(st, sd->type, sd->data, sd->size);
+        if (ret < 0)
+            return ret;
+        sd->data = NULL;
+    }
+
+    return 0;
+}
+
+int ff_stream_info_cache_load(AVFormatContext *s, FFStreamInfoCacheKey **pkey)
+{
+    FFStreamInfoCacheKey *key;
+    CachedStream *streams = NULL;
+    AVIOContext *pb = NULL;
+    char format_name[64];
+    int ret;
+
+    *pkey = NULL;
+    if (!s->stream_info_cache || !s->url || !*s->url || !s->nb_streams)
+        return 0;
+
+    for (unsigned i = 0; i < s->nb_streams; i++) {
+        const AVStream *const st = s->streams[i];
+        if (st->codecpar->codec_id == AV_CODEC_ID_NONE ||
+            cffstream(st)->request_probe > 0)
+            return 0;
+    }
+
+    ret = key_alloc(&key, s);
+    if (ret < 0)
+        return ret;
+
+    ret = avio_open2(&pb, key->path, AVIO_FLAG_READ, &s->interrupt_callback, NULL);
+    if (ret < 0) {
+        av_log(s, AV_LOG_VERBOSE, "No stream info cache entry %s\n", key->path);
+        *pkey = key;
+        return ret == AVERROR(ENOMEM) ? ret : 0;
+    }
+
+    ret = AVERROR_INVALIDDATA;
+    if (avio_rb32(pb) != CACHE_TAG || avio_rb32(pb) != CACHE_VERSION)
+        goto end;
+    avio_get_str(pb, INT_MAX, format_name, sizeof(format_name));
+    if (strcmp(format_name, s->iformat->name) || avio_rb32(pb) != key->nb_streams)
+        goto end;
+    for (unsigned i = 0; i < key->nb_streams; i++) {
+        const StreamFingerprint *const fp = &key->streams[i];
+        int id         = avio_rb32(pb);
+        int codec_type = avio_rb32(pb);
+        int codec_id   = avio_rb32(pb);
+        AVRational tb  = read_rational(pb);
+        if (id != fp->id || codec_type != fp->codec_type ||
+            codec_id != fp->codec_id || av_cmp_q(tb, fp->time_base))
+            goto end;
+    }
+
+    streams = av_calloc(key->nb_streams, sizeof(*streams));
+    if (!streams) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (unsigned i = 0; i < key->nb_streams; i++) {
+        ret = read_stream(s, &streams[i], pb);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (unsigned i = 0; i < key->nb_streams; i++) {
+        ret = apply_stream(s->streams[i], &streams[i]);
+        if (ret < 0)
+            goto end;
+    }
+    av_log(s, AV_LOG_VERBOSE, "Using stream info cache entry %s\n", key->path);
+    ret = 1;
+
+end:
+    if (ret == AVERROR_INVALIDDATA) {
+        av_log(s, AV_LOG_VERBOSE, "Stream info cache entry %s does not match\n",
+               key->path);
+        ret = 0;
+    }
+    if (streams) {
+        for (unsigned i = 0; i < key->nb_streams; i++)
+            cached_stream_uninit(&streams[i]);
+        av_free(streams);
+    }
+    avio_closep(&pb);
+    if (ret)
+        ff_stream_info_cache_key_free(&key);
+    *pkey = key;
+    return ret;
+}
+
+static void write_stream(AVIOContext *pb, const AVStream *st)
+{
+    const AVCodecParameters *par = st->codecpar;
+
+    avio_wb32(pb, par->codec_type);
+    avio_wb32(pb, par->codec_id);
+    avio_wb32(pb, par->codec_tag);
+    avio_wb32(pb, par->format);
+    avio_wb64(pb, par->bit_rate);
+    avio_wb32(pb, par->bits_per_coded_sample);
+    avio_wb32(pb, par->bits_per_raw_sample);
+    avio_wb32(pb, par->profile);
+    avio_wb32(pb, par->level);
+    avio_wb32(pb, par->width);
+    avio_wb32(pb, par->height);
+    write_rational(pb, par->sample_aspect_ratio);
+    avio_wb32(pb, par->field_order);
+    avio_wb32(pb, par->color_range);
+    avio_wb32(pb, par->color_primaries);
+    avio_wb32(pb, par->color_trc);
+    avio_wb32(pb, par->color_space);
+    avio_wb32(pb, par->chroma_location);
+    avio_wb32(pb, par->video_delay);
+    avio_wb32(pb, par->ch_layout.order);
+    avio_wb32(pb, par->ch_layout.nb_channels);
+    avio_wb64(pb, par->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ||
+                  par->ch_layout.order == AV_CHANNEL_ORDER_AMBISONIC ?
+                  par->ch_layout.u.mask : 0);
+    avio_wb32(pb, par->sample_rate);
+    avio_wb32(pb, par->block_align);
+    avio_wb32(pb, par->frame_size);
+    avio_wb32(pb, par->initial_padding);
+    avio_wb32(pb, par->trailing_padding);
+    avio_wb32(pb, par->seek_preroll);
+    write_rational(pb, st->r_frame_rate);
+    write_rational(pb, st->avg_frame_rate);
+    write_rational(pb, st->sample_aspect_ratio);
+
+    avio_wb32(pb, par->extradata_size);
+    avio_write(pb, par->extradata, par->extradata_size);
+
+    avio_wb32(pb, st->nb_side_data);
+    for (int i = 0; i < st->nb_side_data; i++) {
+        const AVPacketSideData *const sd = &st->side_data[i];
+        avio_wb32(pb, sd->type);
+        avio_wb32(pb, sd->size);
+        avio_write(pb, sd->data, sd->size);
+    }
+}
+
+void ff_stream_info_cache_store(AVFormatContext *s, FFStreamInfoCacheKey **pkey)
+{
+    FFStreamInfoCacheKey *const key = *pkey;
+    AVIOContext *pb = NULL;
+    char *tmp;
+    int ret;
+
+    if (!key)
+        return;
+
+    /* unique, so that concurrent writers of the same entry do not mix their data */
+    tmp = av_asprintf("%s.%08"PRIx32".tmp", key->path, av_get_random_seed());
+    if (!tmp)
+        goto end;
+
+    ret = avio_open2(&pb, tmp, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not open stream info cache entry %s: %s\n",
+               tmp, av_err2str(ret));
+        goto end;
+    }
+
+    avio_wb32(pb, CACHE_TAG);
+    avio_wb32(pb, CACHE_VERSION);
+    avio_put_str(pb, s->iformat->name);
+    avio_wb32(pb, key->nb_streams);
+    for (unsigned i = 0; i < key->nb_streams; i++) {
+        const StreamFingerprint *const fp = &key->streams[i];
+        avio_wb32(pb, fp->id);
+        avio_wb32(pb, fp->codec_type);
+        avio_wb32(pb, fp->codec_id);
+        write_rational(pb, fp->time_base);
+    }
+    for (unsigned i = 0; i < key->nb_streams; i++)
+        write_stream(pb, s->streams[i]);
+
+    ret = avio_closep(&pb);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not write stream info cache entry %s: %s\n",
+               tmp, av_err2str(ret));
+        ffurl_delete(tmp);
+        goto end;
+    }
+    /* readers see either the old or the new entry */
+    if (ff_rename(tmp, key->path, s) >= 0)
+        av_log(s, AV_LOG_VERBOSE, "Stored stream info cache entry %s\n", key->path);
+    else
+        ffurl_delete(tmp);
+
+end:
+    av_free(tmp);
+    ff_stream_info_cache_key_free(pkey);
+}
@@ -28,6 +28,12 @@
 #include "network.h"
 #include "os_support.h"
 #include "url.h"
+#if HAVE_LINUX_IO_URING_H
+#include "uring.h"
+
+#define URING_NB_BUFFERS   4
+#define URING_BUFFER_SIZE  65536
+#endif
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
@@ -45,6 +51,10 @@ typedef struct TCPContext {
 #if !HAVE_WINSOCK2_H
     int tcp_mss;
 #endif /* !HAVE_WINSOCK2_H */
+#if HAVE_LINUX_IO_URING_H
+    int use_io_uring;
+    FFURing *uring;
+#endif
 } TCPContext;
 
 #define OFFSET(x) offsetof(TCPContext, x)
@@ -60,6 +70,9 @@ static const AVOption options[] = {
 #if !HAVE_WINSOCK2_H
     { "tcp_mss",     "Maximum segment size for outgoing TCP packets",          OFFSET(tcp_mss),     AV_OPT_TYPE_INT, { .i64 = -1 },         -1, INT_MAX, .flags = D|E },
 #endif /* !HAVE_WINSOCK2_H */
+#if HAVE_LINUX_IO_URING_H
+    { "io_uring",    "use io_uring for readahead and write-behind",            OFFSET(use_io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 },            0, 1, .flags = D|E },
+#endif
     { NULL }
 };
 
@@ -100,6 +113,26 @@ static void customize_fd(void *ctx, int fd)
 }
 
 /* return non zero if error */
+#if HAVE_LINUX_IO_URING_H
+static void start_uring(URLContext *h)
+{
+    TCPContext *s = h->priv_data;
+    int flags = FF_URING_STREAM;
+    int ret;
+
+    if (h->flags & AVIO_FLAG_READ)
+        flags |= FF_URING_READ;
+    if (h->flags & AVIO_FLAG_WRITE)
+        flags |= FF_URING_WRITE;
+
+    ret = ff_uring_alloc(&s->uring, s->fd, flags,
+                         URING_NB_BUFFERS, URING_BUFFER_SIZE, 0);
+    if (ret < 0)
+        av_log(h, AV_LOG_WARNING, "io_uring unavailable, using plain I/O: %s\n",
+               av_err2str(ret));
+}
+#endif
+
 static int tcp_open(URLContext *h, const char *uri, int flags)
 {
     struct addrinfo hints = { 0 }, *ai, *cur_ai;
@@ -206,6 +239,12 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
     h->is_streamed = 1;
     s->fd = fd;
 
+#if HAVE_LINUX_IO_URING_H
+    /* the listening socket of a multi-client server is only for accepting */
+    if (s->use_io_uring && s->listen != 2)
+        start_uring(h);
+#endif
+
     freeaddrinfo(ai);
     return 0;
 
@@ -231,6 +270,10 @@ static int tcp_accept(URLContext *s, URLContext **c)
         return ret;
     }
     cc->fd = ret;
+#if HAVE_LINUX_IO_URING_H
+    if (sc->use_io_uring)
+        start_uring(*c);
+#endif
     return 0;
 }
 
@@ -239,6 +282,18 @@ static int tcp_read(URLContext *h, uint8_t *buf, int size)
     TCPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_LINUX_IO_URING_H
+    while (s->uring) {
+        ret = ff_uring_read(s->uring, buf, size, 1);
+        if (ret != AVERROR(EAGAIN) || h->flags & AVIO_FLAG_NONBLOCK)
+            return ret;
+        ret = ff_network_wait_fd_timeout(ff_uring_get_fd(s->uring), 0,
+                                         h->rw_timeout, &h->interrupt_callback);
+        if (ret)
+            return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd_timeout(s->fd, 0, h->rw_timeout, &h->interrupt_callback);
         if (ret)
@@ -255,6 +310,18 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
     TCPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_LINUX_IO_URING_H
+    while (s->uring) {
+        ret = ff_uring_write(s->uring, buf, size, 1);
+        if (ret != AVERROR(EAGAIN) || h->flags & AVIO_FLAG_NONBLOCK)
+            return ret;
+        ret = ff_network_wait_fd_timeout(ff_uring_get_fd(s->uring), 0,
+                                         h->rw_timeout, &h->interrupt_callback);
+        if (ret)
+            return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd_timeout(s->fd, 1, h->rw_timeout, &h->interrupt_callback);
         if (ret)
@@ -264,6 +331,34 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+#if HAVE_LINUX_IO_URING_H
+static int tcp_uring_flush(URLContext *h, int nonblock)
+{
+    TCPContext *s = h->priv_data;
+    int ret;
+
+    while ((ret = ff_uring_flush(s->uring, 1)) == AVERROR(EAGAIN)) {
+        if (nonblock)
+            return ret;
+        ret = ff_network_wait_fd_timeout(ff_uring_get_fd(s->uring), 0,
+                                         h->rw_timeout, &h->interrupt_callback);
+        if (ret)
+            return ret;
+    }
+    return ret;
+}
+#endif
+
+static int tcp_flush(URLContext *h)
+{
+#if HAVE_LINUX_IO_URING_H
+    TCPContext *s = h->priv_data;
+    if (s->uring && h->flags & AVIO_FLAG_WRITE)
+        return tcp_uring_flush(h, h->flags & AVIO_FLAG_NONBLOCK);
+#endif
+    return 0;
+}
+
 static int tcp_shutdown(URLContext *h, int flags)
 {
     TCPContext *s = h->priv_data;
@@ -277,12 +372,26 @@ static int tcp_shutdown(URLContext *h, int flags)
         how = SHUT_RD;
     }
 
+#if HAVE_LINUX_IO_URING_H
+    if (s->uring && flags & AVIO_FLAG_WRITE) {
+        int ret = tcp_uring_flush(h, 0);
+        if (ret < 0)
+            return ret;
+    }
+#endif
+
     return shutdown(s->fd, how);
 }
 
 static int tcp_close(URLContext *h)
 {
     TCPContext *s = h->priv_data;
+#if HAVE_LINUX_IO_URING_H
+    /* whatever could not be sent before an interrupt or timeout is dropped */
+    if (s->uring && h->flags & AVIO_FLAG_WRITE)
+        tcp_uring_flush(h, 0);
+    ff_uring_free(&s->uring);
+#endif
     closesocket(s->fd);
     return 0;
 }
@@ -320,6 +429,7 @@ const URLProtocol ff_tcp_protocol = {
     .url_read            = tcp_read,
     .url_write           = tcp_write,
     .url_close           = tcp_close,
+    .url_flush           = tcp_flush,
     .url_get_file_handle = tcp_get_file_handle,
     .url_get_short_seek  = tcp_get_window_size,
     .url_shutdown        = tcp_shutdown,
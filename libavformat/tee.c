@@ -23,6 +23,8 @@
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "libavcodec/bsf.h"
 #include "internal.h"
 #include "avformat.h"
@@ -36,9 +38,32 @@ typedef enum {
 
 #define DEFAULT_SLAVE_FAILURE_POLICY ON_SLAVE_FAILURE_ABORT
 
+typedef enum {
+    QUEUE_POLICY_BLOCK = 0,
+    QUEUE_POLICY_DROP  = 1
+} QueuePolicy;
+
+/**
+ * Bitstream filter chain applied to an input stream, shared by all the
+ * slaves using the same filters on that stream so that every packet is
+ * filtered only once.
+ */
+typedef struct TeeBSF {
+    AVBSFContext *bsf;
+    char *filters;      ///< filters description, NULL for pass-through
+    int stream_index;   ///< input stream index
+
+    /** output of the filters for the packet being written */
+    AVPacket **out;
+    unsigned nb_out;
+    unsigned nb_out_allocated;
+    int filtered;       ///< the packet being written was filtered
+    int err;            ///< error filtering the packet being written
+} TeeBSF;
+
 typedef struct {
     AVFormatContext *avf;
-    AVBSFContext **bsfs; ///< bitstream filters per stream
+    TeeBSF **bsfs; ///< bitstream filters per stream
 
     SlaveFailurePolicy on_fail;
     int use_fifo;
@@ -48,6 +73,19 @@ typedef struct {
      * disabled output streams are set to -1 */
     int *stream_map;
     int header_written;
+
+    int use_thread;
+    int queue_size;
+    QueuePolicy queue_policy;
+#if HAVE_THREADS
+    AVThreadMessageQueue *queue; ///< packets for the writer thread
+    pthread_t thread;
+    int thread_started;
+    int thread_ret;              ///< error the writer thread exited with
+    /** per output stream, set after a drop until the next keyframe */
+    uint8_t *wait_keyframe;
+    int64_t nb_dropped;
+#endif
 } TeeSlave;
 
 typedef struct TeeContext {
@@ -57,6 +95,11 @@ typedef struct TeeContext {
     TeeSlave *slaves;
     int use_fifo;
     AVDictionary *fifo_options;
+    int use_thread;
+    int queue_size;
+    int queue_policy;
+    TeeBSF **bsfs;      ///< bitstream filter chains of all the slaves
+    unsigned nb_bsfs;
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -69,6 +112,14 @@ static const AVOption options[] = {
          OFFSET(use_fifo), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
         {"fifo_options", "fifo pseudo-muxer options", OFFSET(fifo_options),
          AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM},
+        {"use_thread", "Write each slave output from its own thread",
+         OFFSET(use_thread), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+        {"thread_queue_size", "Number of packets queued for each slave writer thread",
+         OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64 = 64}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+        {"thread_queue_policy", "Behaviour when a slave writer thread queue is full",
+         OFFSET(queue_policy), AV_OPT_TYPE_INT, {.i64 = QUEUE_POLICY_BLOCK}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
+            {"block", "Wait for the slave to catch up", 0, AV_OPT_TYPE_CONST, {.i64 = QUEUE_POLICY_BLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
+            {"drop",  "Drop packets for the slave",     0, AV_OPT_TYPE_CONST, {.i64 = QUEUE_POLICY_DROP},  0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_policy"},
         {NULL}
 };
 
@@ -115,10 +166,154 @@ static int parse_slave_fifo_options(const char *fifo_options, TeeSlave *tee_slav
     return av_dict_parse_string(&tee_slave->fifo_options, fifo_options, "=", ":", 0);
 }
 
+static int parse_slave_thread_policy(const char *use_thread, TeeSlave *tee_slave)
+{
+    if (av_match_name(use_thread, "true,y,yes,enable,enabled,on,1")) {
+        tee_slave->use_thread = 1;
+    } else if (av_match_name(use_thread, "false,n,no,disable,disabled,off,0")) {
+        tee_slave->use_thread = 0;
+    } else {
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static int parse_slave_queue_size(const char *queue_size, TeeSlave *tee_slave)
+{
+    char *end;
+    long size = strtol(queue_size, &end, 10);
+
+    if (*end || size < 1 || size > INT_MAX)
+        return AVERROR(EINVAL);
+    tee_slave->queue_size = size;
+    return 0;
+}
+
+static int parse_slave_queue_policy(const char *queue_policy, TeeSlave *tee_slave)
+{
+    if (!av_strcasecmp("block", queue_policy)) {
+        tee_slave->queue_policy = QUEUE_POLICY_BLOCK;
+    } else if (!av_strcasecmp("drop", queue_policy)) {
+        tee_slave->queue_policy = QUEUE_POLICY_DROP;
+    } else {
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+static void free_queued_packet(void *msg)
+{
+    av_packet_free(msg);
+}
+
+static void *slave_writer_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    AVPacket *pkt;
+    int ret;
+
+    while (1) {
+        ret = av_thread_message_queue_recv(tee_slave->queue, &pkt, 0);
+        if (ret < 0)
+            break;
+        /* a NULL packet requests a flush of the slave */
+        ret = av_interleaved_write_frame(tee_slave->avf, pkt);
+        av_packet_free(&pkt);
+        if (ret < 0) {
+            /* make the next send fail, so the failure is handled by the
+             * caller thread as for unthreaded slaves */
+            tee_slave->thread_ret = ret;
+            av_thread_message_queue_set_err_send(tee_slave->queue, ret);
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int start_slave_thread(AVFormatContext *avf, TeeSlave *tee_slave)
+{
+    int ret;
+
+    tee_slave->wait_keyframe = av_calloc(tee_slave->avf->nb_streams,
+                                         sizeof(*tee_slave->wait_keyframe));
+    if (!tee_slave->wait_keyframe)
+        return AVERROR(ENOMEM);
+
+    ret = av_thread_message_queue_alloc(&tee_slave->queue, tee_slave->queue_size,
+                                        sizeof(AVPacket *));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(tee_slave->queue, free_queued_packet);
+
+    ret = pthread_create(&tee_slave->thread, NULL, slave_writer_thread, tee_slave);
+    if (ret) {
+        av_log(avf, AV_LOG_ERROR, "Failed to start the slave writer thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    tee_slave->thread_started = 1;
+    return 0;
+}
+
+/**
+ * Let the writer thread write the queued packets and wait for it to exit.
+ *
+ * @return the error the writer thread failed with, 0 otherwise
+ */
+static int stop_slave_thread(TeeSlave *tee_slave)
+{
+    if (tee_slave->thread_started) {
+        av_thread_message_queue_set_err_recv(tee_slave->queue, AVERROR_EOF);
+        pthread_join(tee_slave->thread, NULL);
+        tee_slave->thread_started = 0;
+    }
+    av_thread_message_queue_free(&tee_slave->queue);
+    av_freep(&tee_slave->wait_keyframe);
+    return tee_slave->thread_ret;
+}
+
+/**
+ * Queue a packet for the slave writer thread, pkt is consumed.
+ * With the drop policy, packets which do not fit into the queue are
+ * dropped, along with the following packets of the same stream up to
+ * the next keyframe.
+ */
+static int queue_slave_packet(void *log_ctx, TeeSlave *tee_slave, AVPacket *pkt)
+{
+    int drop = tee_slave->queue_policy == QUEUE_POLICY_DROP;
+    int ret;
+
+    if (drop && pkt) {
+        uint8_t *wait_keyframe = &tee_slave->wait_keyframe[pkt->stream_index];
+        if (*wait_keyframe && !(pkt->flags & AV_PKT_FLAG_KEY))
+            goto drop;
+        *wait_keyframe = 0;
+    }
+
+    /* flushes are never dropped */
+    ret = av_thread_message_queue_send(tee_slave->queue, &pkt,
+                                       drop && pkt ? AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret == AVERROR(EAGAIN)) {
+        tee_slave->wait_keyframe[pkt->stream_index] = 1;
+        goto drop;
+    }
+    if (ret < 0)
+        av_packet_free(&pkt);
+    return ret;
+
+drop:
+    if (!tee_slave->nb_dropped++)
+        av_log(log_ctx, AV_LOG_WARNING, "Slave '%s' is too slow, dropping packets.\n",
+               tee_slave->avf->url);
+    av_packet_free(&pkt);
+    return 0;
+}
+#endif
+
 static int close_slave(TeeSlave *tee_slave)
 {
     AVFormatContext *avf;
-    unsigned i;
     int ret = 0;
 
     av_dict_free(&tee_slave->fifo_options);
@@ -126,13 +321,19 @@ static int close_slave(TeeSlave *tee_slave)
     if (!avf)
         return 0;
 
-    if (tee_slave->header_written)
-        ret = av_write_trailer(avf);
-
-    if (tee_slave->bsfs) {
-        for (i = 0; i < avf->nb_streams; ++i)
-            av_bsf_free(&tee_slave->bsfs[i]);
+#if HAVE_THREADS
+    ret = stop_slave_thread(tee_slave);
+    if (tee_slave->nb_dropped)
+        av_log(avf, AV_LOG_WARNING, "%"PRId64" packets dropped.\n",
+               tee_slave->nb_dropped);
+#endif
+
+    if (tee_slave->header_written) {
+        int ret2 = av_write_trailer(avf);
+        if (!ret)
+            ret = ret2;
     }
+
     av_freep(&tee_slave->stream_map);
     av_freep(&tee_slave->bsfs);
 
@@ -142,6 +343,28 @@ static int close_slave(TeeSlave *tee_slave)
     return ret;
 }
 
+static void free_bsf(TeeBSF **ptb)
+{
+    TeeBSF *tb = *ptb;
+
+    if (!tb)
+        return;
+    for (unsigned i = 0; i < tb->nb_out_allocated; i++)
+        av_packet_free(&tb->out[i]);
+    av_freep(&tb->out);
+    av_bsf_free(&tb->bsf);
+    av_freep(&tb->filters);
+    av_freep(ptb);
+}
+
+static void free_bsfs(TeeContext *tee)
+{
+    for (unsigned i = 0; i < tee->nb_bsfs; i++)
+        free_bsf(&tee->bsfs[i]);
+    av_freep(&tee->bsfs);
+    tee->nb_bsfs = 0;
+}
+
 static void close_slaves(AVFormatContext *avf)
 {
     TeeContext *tee = avf->priv_data;
@@ -151,6 +374,80 @@ static void close_slaves(AVFormatContext *avf)
         close_slave(&tee->slaves[i]);
     }
     av_freep(&tee->slaves);
+    free_bsfs(tee);
+}
+
+/**
+ * Get the bitstream filter chain described by filters for the input
+ * stream stream_index, creating it if no slave uses it yet.
+ */
+static int get_shared_bsf(AVFormatContext *avf, int stream_index,
+                          const char *filters, TeeBSF **tbp)
+{
+    TeeContext *tee = avf->priv_data;
+    TeeBSF *tb;
+    int ret;
+
+    for (unsigned i = 0; i < tee->nb_bsfs; i++) {
+        tb = tee->bsfs[i];
+        if (tb->stream_index == stream_index &&
+            (filters ? tb->filters && !strcmp(tb->filters, filters) : !tb->filters)) {
+            *tbp = tb;
+            return 0;
+        }
+    }
+
+    tb = av_mallocz(sizeof(*tb));
+    if (!tb)
+        return AVERROR(ENOMEM);
+    tb->stream_index = stream_index;
+
+    if (filters) {
+        if (!(tb->filters = av_strdup(filters))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ret = av_bsf_list_parse_str(filters, &tb->bsf);
+        if (ret < 0) {
+            av_log(avf, AV_LOG_ERROR,
+                   "Error parsing bitstream filter sequence '%s' associated to "
+                   "input stream %d\n", filters, stream_index);
+            goto fail;
+        }
+    } else {
+        /* Add pass-through bitstream filter */
+        ret = av_bsf_get_null_filter(&tb->bsf);
+        if (ret < 0) {
+            av_log(avf, AV_LOG_ERROR,
+                   "Failed to create pass-through bitstream filter: %s\n",
+                   av_err2str(ret));
+            goto fail;
+        }
+    }
+
+    tb->bsf->time_base_in = avf->streams[stream_index]->time_base;
+    ret = avcodec_parameters_copy(tb->bsf->par_in,
+                                  avf->streams[stream_index]->codecpar);
+    if (ret < 0)
+        goto fail;
+
+    ret = av_bsf_init(tb->bsf);
+    if (ret < 0) {
+        av_log(avf, AV_LOG_ERROR,
+        "Failed to initialize bitstream filter(s): %s\n",
+        av_err2str(ret));
+        goto fail;
+    }
+
+    ret = av_dynarray_add_nofree(&tee->bsfs, &tee->nb_bsfs, tb);
+    if (ret < 0)
+        goto fail;
+
+    *tbp = tb;
+    return 0;
+fail:
+    free_bsf(&tb);
+    return ret;
 }
 
 static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
@@ -161,11 +458,13 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     char *filename;
     char *format = NULL, *select = NULL, *on_fail = NULL;
     char *use_fifo = NULL, *fifo_options_str = NULL;
+    char *use_thread = NULL, *queue_size = NULL, *queue_policy = NULL;
     AVFormatContext *avf2 = NULL;
     AVStream *st, *st2;
     int stream_count;
     int fullret;
     char *subselect = NULL, *next_subselect = NULL, *first_subselect = NULL, *tmp_select = NULL;
+    char **bsf_filters = NULL;
 
     if ((ret = ff_tee_parse_slave_options(avf, slave, &options, &filename)) < 0)
         return ret;
@@ -195,6 +494,16 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
                           av_err2str(ret)););
     PROCESS_OPTION("fifo_options", fifo_options_str,
                    parse_slave_fifo_options(fifo_options_str, tee_slave), ;);
+    PROCESS_OPTION("use_thread", use_thread,
+                   parse_slave_thread_policy(use_thread, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid use_thread option value\n"););
+    PROCESS_OPTION("thread_queue_size", queue_size,
+                   parse_slave_queue_size(queue_size, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid thread_queue_size option value\n"););
+    PROCESS_OPTION("thread_queue_policy", queue_policy,
+                   parse_slave_queue_policy(queue_policy, tee_slave),
+                   av_log(avf, AV_LOG_ERROR, "Invalid thread_queue_policy option value, "
+                          "valid options are 'block' and 'drop'\n"););
     entry = NULL;
     while ((entry = av_dict_get(options, "bsfs", entry, AV_DICT_IGNORE_SUFFIX))) {
         /* trim out strlen("bsfs") characters from key */
@@ -306,7 +615,8 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     tee_slave->header_written = 1;
 
     tee_slave->bsfs = av_calloc(avf2->nb_streams, sizeof(*tee_slave->bsfs));
-    if (!tee_slave->bsfs) {
+    bsf_filters     = av_calloc(avf2->nb_streams, sizeof(*bsf_filters));
+    if (!tee_slave->bsfs || !bsf_filters) {
         ret = AVERROR(ENOMEM);
         goto end;
     }
@@ -337,17 +647,14 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
             if (ret > 0) {
                 av_log(avf, AV_LOG_DEBUG, "spec:%s bsfs:%s matches stream %d of slave "
                        "output '%s'\n", spec, entry->value, i, filename);
-                if (tee_slave->bsfs[i]) {
+                if (bsf_filters[i]) {
                     av_log(avf, AV_LOG_WARNING,
                            "Duplicate bsfs specification associated to stream %d of slave "
                            "output '%s', filters will be ignored\n", i, filename);
                     continue;
                 }
-                ret = av_bsf_list_parse_str(entry->value, &tee_slave->bsfs[i]);
-                if (ret < 0) {
-                    av_log(avf, AV_LOG_ERROR,
-                           "Error parsing bitstream filter sequence '%s' associated to "
-                           "stream %d of slave output '%s'\n", entry->value, i, filename);
+                if (!(bsf_filters[i] = av_strdup(entry->value))) {
+                    ret = AVERROR(ENOMEM);
                     goto end;
                 }
             }
@@ -361,30 +668,10 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
         if (target_stream < 0)
             continue;
 
-        if (!tee_slave->bsfs[target_stream]) {
-            /* Add pass-through bitstream filter */
-            ret = av_bsf_get_null_filter(&tee_slave->bsfs[target_stream]);
-            if (ret < 0) {
-                av_log(avf, AV_LOG_ERROR,
-                       "Failed to create pass-through bitstream filter: %s\n",
-                       av_err2str(ret));
-                goto end;
-            }
-        }
-
-        tee_slave->bsfs[target_stream]->time_base_in = avf->streams[i]->time_base;
-        ret = avcodec_parameters_copy(tee_slave->bsfs[target_stream]->par_in,
-                                      avf->streams[i]->codecpar);
+        ret = get_shared_bsf(avf, i, bsf_filters[target_stream],
+                             &tee_slave->bsfs[target_stream]);
         if (ret < 0)
             goto end;
-
-        ret = av_bsf_init(tee_slave->bsfs[target_stream]);
-        if (ret < 0) {
-            av_log(avf, AV_LOG_ERROR,
-            "Failed to initialize bitstream filter(s): %s\n",
-            av_err2str(ret));
-            goto end;
-        }
     }
 
     if (options) {
@@ -395,12 +682,29 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
         goto end;
     }
 
+    if (tee_slave->use_thread) {
+#if HAVE_THREADS
+        ret = start_slave_thread(avf, tee_slave);
+        if (ret < 0)
+            goto end;
+#else
+        av_log(avf, AV_LOG_ERROR, "Slave writer threads require threading support\n");
+        ret = AVERROR(ENOSYS);
+        goto end;
+#endif
+    }
+
 end:
     av_free(format);
     av_free(select);
     av_dict_free(&options);
     av_dict_free(&bsf_options);
     av_freep(&tmp_select);
+    if (bsf_filters) {
+        for (i = 0; i < avf2->nb_streams; i++)
+            av_free(bsf_filters[i]);
+        av_free(bsf_filters);
+    }
     return ret;
 }
 
@@ -411,7 +715,7 @@ static void log_slave(TeeSlave *slave, void *log_ctx, int log_level)
            slave->avf->url, slave->avf->oformat->name);
     for (i = 0; i < slave->avf->nb_streams; i++) {
         AVStream *st = slave->avf->streams[i];
-        AVBSFContext *bsf = slave->bsfs[i];
+        AVBSFContext *bsf = slave->bsfs[i]->bsf;
         const char *bsf_name;
 
         av_log(log_ctx, log_level, "    stream:%d codec:%s type:%s",
@@ -478,6 +782,9 @@ static int tee_write_header(AVFormatContext *avf)
     for (i = 0; i < nb_slaves; i++) {
 
         tee->slaves[i].use_fifo = tee->use_fifo;
+        tee->slaves[i].use_thread   = tee->use_thread;
+        tee->slaves[i].queue_size   = tee->queue_size;
+        tee->slaves[i].queue_policy = tee->queue_policy;
         ret = av_dict_copy(&tee->slaves[i].fifo_options, tee->fifo_options, 0);
         if (ret < 0)
             goto fail;
@@ -526,25 +833,135 @@ static int tee_write_trailer(AVFormatContext *avf)
         }
     }
     av_freep(&tee->slaves);
+    free_bsfs(tee);
     return ret_all;
 }
 
+static AVPacket *get_bsf_output(TeeBSF *tb)
+{
+    if (tb->nb_out == tb->nb_out_allocated) {
+        AVPacket **out = av_realloc_array(tb->out, tb->nb_out + 1, sizeof(*out));
+        if (!out)
+            return NULL;
+        tb->out = out;
+        if (!(out[tb->nb_out] = av_packet_alloc()))
+            return NULL;
+        tb->nb_out_allocated++;
+    }
+    return tb->out[tb->nb_out];
+}
+
+/**
+ * Send the packet through the shared filter chain, unless done already
+ * for another slave, and keep the output packets until all the slaves
+ * have written them.
+ */
+static int filter_shared_packet(void *log_ctx, TeeBSF *tb, const AVPacket *pkt)
+{
+    AVPacket *out;
+    int ret;
+
+    if (tb->filtered)
+        return tb->err;
+    tb->filtered = 1;
+
+    if (!(out = get_bsf_output(tb)))
+        return tb->err = AVERROR(ENOMEM);
+    if ((ret = av_packet_ref(out, pkt)) < 0)
+        return tb->err = ret;
+    out->stream_index = 0;
+
+    ret = av_bsf_send_packet(tb->bsf, out);
+    if (ret < 0) {
+        av_packet_unref(out);
+        av_log(log_ctx, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
+               av_err2str(ret));
+        return tb->err = ret;
+    }
+
+    while (1) {
+        if (!(out = get_bsf_output(tb)))
+            return tb->err = AVERROR(ENOMEM);
+        ret = av_bsf_receive_packet(tb->bsf, out);
+        if (ret == AVERROR(EAGAIN))
+            return 0;
+        else if (ret < 0)
+            return tb->err = ret;
+        tb->nb_out++;
+    }
+}
+
+static void reset_shared_bsfs(TeeContext *tee)
+{
+    for (unsigned i = 0; i < tee->nb_bsfs; i++) {
+        TeeBSF *tb = tee->bsfs[i];
+
+        for (unsigned j = 0; j < tb->nb_out; j++)
+            av_packet_unref(tb->out[j]);
+        tb->nb_out   = 0;
+        tb->filtered = 0;
+        tb->err      = 0;
+    }
+}
+
+static int write_slave_packets(AVFormatContext *avf, TeeSlave *tee_slave,
+                               const AVPacket *pkt, int s2)
+{
+    AVFormatContext *avf2 = tee_slave->avf;
+    AVPacket *const pkt2 = ffformatcontext(avf)->pkt;
+    TeeBSF *tb = tee_slave->bsfs[s2];
+    int ret;
+
+    if ((ret = filter_shared_packet(avf, tb, pkt)) < 0)
+        return ret;
+
+    for (unsigned i = 0; i < tb->nb_out; i++) {
+#if HAVE_THREADS
+        if (tee_slave->queue) {
+            AVPacket *qpkt = av_packet_clone(tb->out[i]);
+            if (!qpkt)
+                return AVERROR(ENOMEM);
+            qpkt->stream_index = s2;
+            av_packet_rescale_ts(qpkt, tb->bsf->time_base_out,
+                                 avf2->streams[s2]->time_base);
+            if ((ret = queue_slave_packet(avf, tee_slave, qpkt)) < 0)
+                return ret;
+            continue;
+        }
+#endif
+        if ((ret = av_packet_ref(pkt2, tb->out[i])) < 0)
+            return ret;
+        pkt2->stream_index = s2;
+        av_packet_rescale_ts(pkt2, tb->bsf->time_base_out,
+                             avf2->streams[s2]->time_base);
+        ret = av_interleaved_write_frame(avf2, pkt2);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
 static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
     AVFormatContext *avf2;
-    AVBSFContext *bsfs;
-    AVPacket *const pkt2 = ffformatcontext(avf)->pkt;
     int ret_all = 0, ret;
     unsigned i, s;
     int s2;
 
     for (i = 0; i < tee->nb_slaves; i++) {
-        if (!(avf2 = tee->slaves[i].avf))
+        TeeSlave *tee_slave = &tee->slaves[i];
+
+        if (!(avf2 = tee_slave->avf))
             continue;
 
         /* Flush slave if pkt is NULL*/
         if (!pkt) {
+#if HAVE_THREADS
+            if (tee_slave->queue)
+                ret = queue_slave_packet(avf, tee_slave, NULL);
+            else
+#endif
             ret = av_interleaved_write_frame(avf2, NULL);
             if (ret < 0) {
                 ret = tee_process_slave_failure(avf, i, ret);
@@ -555,50 +972,18 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
         }
 
         s = pkt->stream_index;
-        s2 = tee->slaves[i].stream_map[s];
+        s2 = tee_slave->stream_map[s];
         if (s2 < 0)
             continue;
 
-        if ((ret = av_packet_ref(pkt2, pkt)) < 0) {
-            if (!ret_all)
-                ret_all = ret;
-            continue;
-        }
-        bsfs = tee->slaves[i].bsfs[s2];
-        pkt2->stream_index = s2;
-
-        ret = av_bsf_send_packet(bsfs, pkt2);
-        if (ret < 0) {
-            av_packet_unref(pkt2);
-            av_log(avf, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
-                   av_err2str(ret));
-            ret = tee_process_slave_failure(avf, i, ret);
-            if (!ret_all && ret < 0)
-                ret_all = ret;
-        }
-
-        while(1) {
-            ret = av_bsf_receive_packet(bsfs, pkt2);
-            if (ret == AVERROR(EAGAIN)) {
-                ret = 0;
-                break;
-            } else if (ret < 0) {
-                break;
-            }
-
-            av_packet_rescale_ts(pkt2, bsfs->time_base_out,
-                                 avf2->streams[s2]->time_base);
-            ret = av_interleaved_write_frame(avf2, pkt2);
-            if (ret < 0)
-                break;
-        };
-
+        ret = write_slave_packets(avf, tee_slave, pkt, s2);
         if (ret < 0) {
             ret = tee_process_slave_failure(avf, i, ret);
             if (!ret_all && ret < 0)
                 ret_all = ret;
         }
     }
+    reset_shared_bsfs(tee);
     return ret_all;
 }
 
@@ -115,3 +115,32 @@ int ff_tls_open_underlying(TLSShared *c, URLContext *parent, const char *uri, AV
                                 &parent->interrupt_callback, options,
                                 parent->protocol_whitelist, parent->protocol_blacklist, parent);
 }
+
+int ff_tls_alpn_protocols(const char *list, uint8_t **wire, int *wire_size)
+{
+    const size_t len = strlen(list);
+    uint8_t *q;
+
+    /* every name takes its byte of length in place of a separator */
+    *wire = q = av_malloc(len + 1);
+    if (!q)
+        return AVERROR(ENOMEM);
+
+    while (*list) {
+        size_t n = strcspn(list, ",");
+
+        if (!n || n > 255) {
+            av_freep(wire);
+            return AVERROR(EINVAL);
+        }
+        *q++ = n;
+        memcpy(q, list, n);
+        q    += n;
+        list += n;
+        if (*list)
+            list++;
+    }
+    *wire_size = q - *wire;
+
+    return 0;
+}
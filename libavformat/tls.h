@@ -36,6 +36,9 @@ typedef struct TLSShared {
     char *host;
     char *http_proxy;
 
+    char *alpn;
+    char *alpn_selected;
+
     char underlying_host[200];
     int numerichost;
 
@@ -51,10 +54,18 @@ typedef struct TLSShared {
     {"key_file",   "Private key file",                    offsetof(pstruct, options_field . key_file),  AV_OPT_TYPE_STRING, .flags = TLS_OPTFL }, \
     {"listen",     "Listen for incoming connections",     offsetof(pstruct, options_field . listen),    AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, .flags = TLS_OPTFL }, \
     {"verifyhost", "Verify against a specific hostname",  offsetof(pstruct, options_field . host),      AV_OPT_TYPE_STRING, .flags = TLS_OPTFL }, \
-    {"http_proxy", "Set proxy to tunnel through",         offsetof(pstruct, options_field . http_proxy), AV_OPT_TYPE_STRING, .flags = TLS_OPTFL }
+    {"http_proxy", "Set proxy to tunnel through",         offsetof(pstruct, options_field . http_proxy), AV_OPT_TYPE_STRING, .flags = TLS_OPTFL }, \
+    {"alpn",       "Comma-separated list of protocols to negotiate with ALPN", offsetof(pstruct, options_field . alpn), AV_OPT_TYPE_STRING, .flags = TLS_OPTFL }, \
+    {"alpn_selected", "export the protocol selected with ALPN", offsetof(pstruct, options_field . alpn_selected), AV_OPT_TYPE_STRING, .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY }
 
 int ff_tls_open_underlying(TLSShared *c, URLContext *parent, const char *uri, AVDictionary **options);
 
+/**
+ * Convert the comma-separated list of ALPN protocols to the wire format of
+ * the TLS extension, each name being prefixed by its length.
+ */
+int ff_tls_alpn_protocols(const char *list, uint8_t **wire, int *wire_size);
+
 void ff_gnutls_init(void);
 void ff_gnutls_deinit(void);
 
@@ -193,6 +193,25 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
     gnutls_transport_set_push_function(p->session, gnutls_url_push);
     gnutls_transport_set_ptr(p->session, p);
     gnutls_set_default_priority(p->session);
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+    if (!c->listen && c->alpn) {
+        gnutls_datum_t protos[16];
+        uint8_t *wire;
+        int wire_size, nb_protos = 0;
+
+        if ((ret = ff_tls_alpn_protocols(c->alpn, &wire, &wire_size)) < 0)
+            goto fail;
+        for (int i = 0; i < wire_size && nb_protos < FF_ARRAY_ELEMS(protos);
+             i += wire[i] + 1)
+            protos[nb_protos++] = (gnutls_datum_t){ wire + i + 1, wire[i] };
+        ret = gnutls_alpn_set_protocols(p->session, protos, nb_protos, 0);
+        av_free(wire);
+        if (ret < 0) {
+            ret = print_tls_error(h, ret);
+            goto fail;
+        }
+    }
+#endif
     do {
         if (ff_check_interrupt(&h->interrupt_callback)) {
             ret = AVERROR_EXIT;
@@ -206,6 +225,17 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
         }
     } while (ret);
     p->need_shutdown = 1;
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+    if (!c->listen && c->alpn) {
+        gnutls_datum_t alpn;
+
+        if (!gnutls_alpn_get_selected_protocol(p->session, &alpn) &&
+            !(c->alpn_selected = av_strndup((const char *)alpn.data, alpn.size))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+#endif
     if (c->verify) {
         unsigned int status, cert_list_size;
         gnutls_x509_crt_t cert;
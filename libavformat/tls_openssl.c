@@ -315,6 +315,22 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
     SSL_set_bio(p->ssl, bio, bio);
     if (!c->listen && !c->numerichost)
         SSL_set_tlsext_host_name(p->ssl, c->host);
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+    if (!c->listen && c->alpn) {
+        uint8_t *protos;
+        int protos_size;
+
+        if ((ret = ff_tls_alpn_protocols(c->alpn, &protos, &protos_size)) < 0)
+            goto fail;
+        ret = SSL_set_alpn_protos(p->ssl, protos, protos_size);
+        av_free(protos);
+        if (ret) {
+            av_log(h, AV_LOG_ERROR, "Unable to set the ALPN protocols\n");
+            ret = AVERROR(EIO);
+            goto fail;
+        }
+    }
+#endif
     ret = c->listen ? SSL_accept(p->ssl) : SSL_connect(p->ssl);
     if (ret == 0) {
         av_log(h, AV_LOG_ERROR, "Unable to negotiate TLS/SSL session\n");
@@ -324,6 +340,19 @@ static int tls_open(URLContext *h, const char *uri, int flags, AVDictionary **op
         ret = print_tls_error(h, ret);
         goto fail;
     }
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+    if (!c->listen && c->alpn) {
+        const unsigned char *alpn;
+        unsigned int alpn_size;
+
+        SSL_get0_alpn_selected(p->ssl, &alpn, &alpn_size);
+        if (alpn_size &&
+            !(c->alpn_selected = av_strndup((const char *)alpn, alpn_size))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+#endif
 
     return 0;
 fail:
@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -47,6 +48,10 @@
 #include "TargetConditionals.h"
 #endif
 
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+#include <netinet/udp.h>
+#endif
+
 #if HAVE_UDPLITE_H
 #include "udplite.h"
 #else
@@ -79,6 +84,9 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+/* largest payload sent at once with UDP_SEGMENT, leaving room for headers */
+#define UDP_MAX_GSO_SIZE 65000
+#define UDP_MAX_GSO_SEGMENTS 64
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -117,6 +125,29 @@ typedef struct UDPContext {
     char *sources;
     char *block;
     IPSourceFilters filters;
+
+    /* datagrams moved per system call */
+    int batch_size;
+#if HAVE_RECVMMSG
+    struct mmsghdr *rx_msgs;
+    struct iovec *rx_iov;
+    struct sockaddr_storage *rx_addrs;
+    uint8_t *rx_buf;
+    uint8_t *rx_cmsg;
+#endif
+#if HAVE_SENDMMSG
+    /* datagrams waiting to be sent, stored back to back */
+    uint8_t *tx_buf;
+    int tx_buf_size;
+    int tx_bytes;
+    int *tx_len;
+    int tx_nb;
+    struct mmsghdr *tx_msgs;
+    struct iovec *tx_iov;
+    uint8_t *tx_cmsg;
+    /* UDP_SEGMENT has not failed yet */
+    int gso;
+#endif
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -141,6 +172,7 @@ static const AVOption options[] = {
     { "timeout",        "set raise error timeout, in microseconds (only in read mode)",OFFSET(timeout),         AV_OPT_TYPE_INT,  {.i64 = 0}, 0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",     "Maximum number of datagrams moved per system call", OFFSET(batch_size),   AV_OPT_TYPE_INT,    { .i64 = 1 },      1, 1024,    .flags = D|E },
     { NULL }
 };
 
@@ -481,6 +513,111 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/* queue one datagram, called with the mutex held */
+static int circular_buffer_write(URLContext *h, const uint8_t *buf, int len)
+{
+    UDPContext *s = h->priv_data;
+    uint8_t tmp[4];
+
+    if (av_fifo_can_write(s->fifo) < len + 4) {
+        /* No Space left */
+        if (s->overrun_nonfatal) {
+            av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                    "Surviving due to overrun_nonfatal option\n");
+            return 0;
+        } else {
+            av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                    "To avoid, increase fifo_size URL option. "
+                    "To survive in such case, use overrun_nonfatal option\n");
+            s->circular_buffer_error = AVERROR(EIO);
+            return s->circular_buffer_error;
+        }
+    }
+    AV_WL32(tmp, len);
+    av_fifo_write(s->fifo, tmp, 4);
+    av_fifo_write(s->fifo, buf, len);
+    return 0;
+}
+
+#if HAVE_RECVMMSG
+static void reset_rx_msgs(UDPContext *s)
+{
+    for (int i = 0; i < s->batch_size; i++) {
+        struct msghdr *msg = &s->rx_msgs[i].msg_hdr;
+        msg->msg_namelen    = sizeof(*s->rx_addrs);
+#ifdef UDP_GRO
+        msg->msg_controllen = CMSG_SPACE(sizeof(int));
+#endif
+        msg->msg_flags      = 0;
+    }
+}
+
+static int alloc_rx_msgs(UDPContext *s)
+{
+    s->rx_msgs  = av_calloc(s->batch_size, sizeof(*s->rx_msgs));
+    s->rx_iov   = av_calloc(s->batch_size, sizeof(*s->rx_iov));
+    s->rx_addrs = av_calloc(s->batch_size, sizeof(*s->rx_addrs));
+    s->rx_buf   = av_malloc_array(s->batch_size, UDP_MAX_PKT_SIZE);
+#ifdef UDP_GRO
+    s->rx_cmsg  = av_calloc(s->batch_size, CMSG_SPACE(sizeof(int)));
+    if (!s->rx_cmsg)
+        return AVERROR(ENOMEM);
+#endif
+    if (!s->rx_msgs || !s->rx_iov || !s->rx_addrs || !s->rx_buf)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < s->batch_size; i++) {
+        struct msghdr *msg = &s->rx_msgs[i].msg_hdr;
+        s->rx_iov[i].iov_base = s->rx_buf + (size_t)i * UDP_MAX_PKT_SIZE;
+        s->rx_iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+        msg->msg_name    = &s->rx_addrs[i];
+        msg->msg_iov     = &s->rx_iov[i];
+        msg->msg_iovlen  = 1;
+#ifdef UDP_GRO
+        msg->msg_control = s->rx_cmsg + (size_t)i * CMSG_SPACE(sizeof(int));
+#endif
+    }
+    reset_rx_msgs(s);
+
+    return 0;
+}
+
+/* queue the datagrams of one recvmmsg() call, called with the mutex held */
+static int circular_buffer_write_msgs(URLContext *h, int nb_msgs)
+{
+    UDPContext *s = h->priv_data;
+
+    for (int i = 0; i < nb_msgs; i++) {
+        struct msghdr *msg = &s->rx_msgs[i].msg_hdr;
+        const uint8_t *buf = s->rx_iov[i].iov_base;
+        int len = s->rx_msgs[i].msg_len;
+        /* with GRO, one message may hold several datagrams of this size */
+        int seg = len;
+#ifdef UDP_GRO
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                memcpy(&seg, CMSG_DATA(cmsg), sizeof(seg));
+                break;
+            }
+        }
+#endif
+        if (ff_ip_check_source_lists(msg->msg_name, &s->filters))
+            continue;
+        if (seg <= 0)
+            seg = len;
+
+        for (int off = 0; off < len; off += seg) {
+            int ret = circular_buffer_write(h, buf + off, FFMIN(seg, len - off));
+            if (ret < 0)
+                return ret;
+        }
+    }
+    reset_rx_msgs(s);
+
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -496,6 +633,27 @@ static void *circular_buffer_task_rx( void *_URLContext)
         s->circular_buffer_error = AVERROR(EIO);
         goto end;
     }
+#if HAVE_RECVMMSG
+    while (s->rx_msgs) {
+        int nb_msgs;
+
+        pthread_mutex_unlock(&s->mutex);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+        nb_msgs = recvmmsg(s->udp_fd, s->rx_msgs, s->batch_size, MSG_WAITFORONE, NULL);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+        pthread_mutex_lock(&s->mutex);
+        if (nb_msgs < 0) {
+            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
+                s->circular_buffer_error = ff_neterrno();
+                goto end;
+            }
+            continue;
+        }
+        if (circular_buffer_write_msgs(h, nb_msgs) < 0)
+            goto end;
+        pthread_cond_signal(&s->cond);
+    }
+#endif
     while(1) {
         int len;
         struct sockaddr_storage addr;
@@ -506,7 +664,7 @@ static void *circular_buffer_task_rx( void *_URLContext)
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+        len = recvfrom(s->udp_fd, s->tmp, sizeof(s->tmp), 0, (struct sockaddr *)&addr, &addr_len);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
         if (len < 0) {
@@ -518,23 +676,8 @@ static void *circular_buffer_task_rx( void *_URLContext)
         }
         if (ff_ip_check_source_lists(&addr, &s->filters))
             continue;
-        AV_WL32(s->tmp, len);
-
-        if (av_fifo_can_write(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
-            }
-        }
-        av_fifo_write(s->fifo, s->tmp, len + 4);
+        if (circular_buffer_write(h, s->tmp, len) < 0)
+            goto end;
         pthread_cond_signal(&s->cond);
     }
 
@@ -644,6 +787,157 @@ end:
 
 #endif
 
+#if HAVE_SENDMMSG
+static int alloc_tx_msgs(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+
+    s->tx_buf_size = s->batch_size * h->max_packet_size;
+    s->tx_buf  = av_malloc(s->tx_buf_size);
+    s->tx_len  = av_calloc(s->batch_size, sizeof(*s->tx_len));
+    s->tx_msgs = av_calloc(s->batch_size, sizeof(*s->tx_msgs));
+    s->tx_iov  = av_calloc(s->batch_size, sizeof(*s->tx_iov));
+#ifdef UDP_SEGMENT
+    s->tx_cmsg = av_calloc(s->batch_size, CMSG_SPACE(sizeof(uint16_t)));
+    if (!s->tx_cmsg)
+        return AVERROR(ENOMEM);
+    s->gso = 1;
+#endif
+    if (!s->tx_buf || !s->tx_len || !s->tx_msgs || !s->tx_iov)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+/* group the queued datagrams into messages, merging runs of datagrams of
+ * the same size into one message segmented by the kernel when possible */
+static int build_tx_msgs(UDPContext *s, int first)
+{
+    uint8_t *data = s->tx_buf;
+    int nb_msgs = 0;
+
+    for (int i = 0; i < first; i++)
+        data += s->tx_len[i];
+
+    for (int i = first; i < s->tx_nb;) {
+        struct msghdr *msg = &s->tx_msgs[nb_msgs].msg_hdr;
+        int seg = s->tx_len[i], len = seg, j = i + 1;
+
+#ifdef UDP_SEGMENT
+        /* all segments but the last one must be full */
+        while (s->gso && j < s->tx_nb && j - i < UDP_MAX_GSO_SEGMENTS &&
+               s->tx_len[j - 1] == seg && s->tx_len[j] <= seg &&
+               len + s->tx_len[j] <= UDP_MAX_GSO_SIZE)
+            len += s->tx_len[j++];
+#endif
+
+        memset(msg, 0, sizeof(*msg));
+        s->tx_iov[nb_msgs].iov_base = data;
+        s->tx_iov[nb_msgs].iov_len  = len;
+        msg->msg_iov    = &s->tx_iov[nb_msgs];
+        msg->msg_iovlen = 1;
+        if (!s->is_connected) {
+            msg->msg_name    = &s->dest_addr;
+            msg->msg_namelen = s->dest_addr_len;
+        }
+#ifdef UDP_SEGMENT
+        if (j - i > 1) {
+            uint16_t gso_size = seg;
+            struct cmsghdr *cmsg;
+
+            msg->msg_control    = s->tx_cmsg + (size_t)nb_msgs * CMSG_SPACE(sizeof(gso_size));
+            msg->msg_controllen = CMSG_SPACE(sizeof(gso_size));
+            cmsg = CMSG_FIRSTHDR(msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(gso_size));
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+        }
+#endif
+
+        data += len;
+        i     = j;
+        nb_msgs++;
+    }
+
+    return nb_msgs;
+}
+
+/* send all the queued datagrams */
+static int udp_flush_tx(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int nb_msgs = build_tx_msgs(s, 0);
+    int sent = 0, ret = 0;
+
+    while (sent < nb_msgs) {
+        ret = ff_network_wait_fd(s->udp_fd, 1);
+        if (ret == AVERROR(EAGAIN)) {
+            if (ff_check_interrupt(&h->interrupt_callback)) {
+                ret = AVERROR_EXIT;
+                break;
+            }
+            continue;
+        }
+        if (ret < 0)
+            break;
+
+        ret = sendmmsg(s->udp_fd, s->tx_msgs + sent, nb_msgs - sent, 0);
+        if (ret >= 0) {
+            sent += ret;
+            continue;
+        }
+        ret = ff_neterrno();
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR(EINTR))
+            continue;
+#ifdef UDP_SEGMENT
+        if (s->gso) {
+            /* not supported by the kernel or the device, resend the
+             * remaining datagrams without it */
+            const uint8_t *next = s->tx_iov[sent].iov_base;
+            int first = 0;
+
+            av_log(h, AV_LOG_VERBOSE, "UDP segmentation offload unavailable: %s\n",
+                   av_err2str(ret));
+            for (const uint8_t *data = s->tx_buf; data < next; data += s->tx_len[first++]);
+            s->gso  = 0;
+            nb_msgs = build_tx_msgs(s, first);
+            sent    = 0;
+            continue;
+        }
+#endif
+        break;
+    }
+
+    s->tx_nb = s->tx_bytes = 0;
+    return ret < 0 ? ret : 0;
+}
+
+static int udp_flush(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    return s->tx_nb ? udp_flush_tx(h) : 0;
+}
+#endif
+
+static void free_msgs(UDPContext *s)
+{
+#if HAVE_RECVMMSG
+    av_freep(&s->rx_msgs);
+    av_freep(&s->rx_iov);
+    av_freep(&s->rx_addrs);
+    av_freep(&s->rx_buf);
+    av_freep(&s->rx_cmsg);
+#endif
+#if HAVE_SENDMMSG
+    av_freep(&s->tx_buf);
+    av_freep(&s->tx_len);
+    av_freep(&s->tx_msgs);
+    av_freep(&s->tx_iov);
+    av_freep(&s->tx_cmsg);
+#endif
+}
+
 /* put it in UDP context */
 /* return non zero if error */
 static int udp_open(URLContext *h, const char *uri, int flags)
@@ -720,6 +1014,14 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "dscp", p)) {
             dscp = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = strtol(buf, NULL, 10);
+            if (s->batch_size < 1 || s->batch_size > 1024) {
+                av_log(h, AV_LOG_ERROR, "batch_size(%d) should be in range [1,1024]\n", s->batch_size);
+                ret = AVERROR(EINVAL);
+                goto fail;
+            }
+        }
         if (av_find_info_tag(buf, sizeof(buf), "fifo_size", p)) {
             s->circular_buffer_size = strtol(buf, NULL, 10);
             if (!HAVE_PTHREAD_CANCEL)
@@ -919,6 +1221,31 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+    if (s->batch_size > 1) {
+        ret = AVERROR(ENOSYS);
+#if HAVE_SENDMMSG
+        /* the sending thread paces datagrams one by one */
+        if (is_output && !(s->bitrate && s->circular_buffer_size))
+            ret = alloc_tx_msgs(h);
+#endif
+#if HAVE_RECVMMSG && HAVE_PTHREAD_CANCEL
+        /* only the receiving thread reads ahead */
+        if (!is_output && s->circular_buffer_size) {
+#ifdef UDP_GRO
+            tmp = 1;
+            if (setsockopt(udp_fd, SOL_UDP, UDP_GRO, &tmp, sizeof(tmp)) < 0)
+                ff_log_net_error(h, AV_LOG_VERBOSE, "setsockopt(UDP_GRO)");
+#endif
+            ret = alloc_rx_msgs(s);
+        }
+#endif
+        if (ret == AVERROR(ENOSYS))
+            av_log(h, AV_LOG_WARNING, "'batch_size' option was set but batching is "
+                   "not supported in this configuration\n");
+        else if (ret < 0)
+            goto fail;
+    }
+
 #if HAVE_PTHREAD_CANCEL
     /*
       Create thread in case of:
@@ -972,6 +1299,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         closesocket(udp_fd);
     av_fifo_freep2(&s->fifo);
     ff_ip_reset_filters(&s->filters);
+    free_msgs(s);
     return ret;
 }
 
@@ -1082,6 +1410,20 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
         pthread_mutex_unlock(&s->mutex);
         return size;
     }
+#endif
+#if HAVE_SENDMMSG
+    if (s->tx_buf) {
+        if (s->tx_bytes + size > s->tx_buf_size && (ret = udp_flush(h)) < 0)
+            return ret;
+        if (size <= s->tx_buf_size) {
+            memcpy(s->tx_buf + s->tx_bytes, buf, size);
+            s->tx_bytes += size;
+            s->tx_len[s->tx_nb++] = size;
+            if (s->tx_nb == s->batch_size && (ret = udp_flush(h)) < 0)
+                return ret;
+            return size;
+        }
+    }
 #endif
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
@@ -1103,6 +1445,10 @@ static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
 
+#if HAVE_SENDMMSG
+    udp_flush(h);
+#endif
+
 #if HAVE_PTHREAD_CANCEL
     // Request close once writing is finished
     if (s->thread_started && !(h->flags & AVIO_FLAG_READ)) {
@@ -1141,6 +1487,7 @@ static int udp_close(URLContext *h)
     closesocket(s->udp_fd);
     av_fifo_freep2(&s->fifo);
     ff_ip_reset_filters(&s->filters);
+    free_msgs(s);
     return 0;
 }
 
@@ -1150,6 +1497,9 @@ const URLProtocol ff_udp_protocol = {
     .url_read            = udp_read,
     .url_write           = udp_write,
     .url_close           = udp_close,
+#if HAVE_SENDMMSG
+    .url_flush           = udp_flush,
+#endif
     .url_get_file_handle = udp_get_file_handle,
     .priv_data_size      = sizeof(UDPContext),
     .priv_data_class     = &udp_class,
@@ -1162,6 +1512,9 @@ const URLProtocol ff_udplite_protocol = {
     .url_read            = udp_read,
     .url_write           = udp_write,
     .url_close           = udp_close,
+#if HAVE_SENDMMSG
+    .url_flush           = udp_flush,
+#endif
     .url_get_file_handle = udp_get_file_handle,
     .priv_data_size      = sizeof(UDPContext),
     .priv_data_class     = &udplite_context_class,
@@ -0,0 +1,540 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "config_components.h"
+
+#include <stdatomic.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#include "avio_internal.h"
+#include "http.h"
+#include "internal.h"
+#include "upload.h"
+#include "url.h"
+
+#if HAVE_THREADS
+
+#define RETRY_DELAY     100000
+#define MAX_RETRY_DELAY 2000000
+
+typedef struct UploadEntry {
+    struct UploadEntry *next;
+    int queue;
+    char *url;
+    AVDictionary *options;
+    uint8_t *data;
+    size_t size;
+    int running;    ///< the url, options and data are then only used by the worker
+} UploadEntry;
+
+/* buffer written by the muxer, only used from its thread */
+typedef struct UploadBuffer {
+    AVIOContext **pb;
+    AVIOContext *ctx;
+    int queue;
+    char *url;
+    AVDictionary *options;
+} UploadBuffer;
+
+typedef struct UploadWorker {
+    struct FFUploader *u;
+    pthread_t thread;
+    AVIOInterruptCB int_cb;
+
+    /* connection of the last upload, kept open to reuse it */
+    AVIOContext *pb;
+    char *pb_url;
+} UploadWorker;
+
+struct FFUploader {
+    AVFormatContext *s;
+    UploadWorker *workers;
+    int nb_workers;
+    int nb_started;
+    size_t max_size;
+    int max_retries;
+
+    UploadBuffer *buffers;
+    int nb_buffers;
+
+    /* pending uploads, in the order of submission */
+    UploadEntry *entries;
+    UploadEntry **entries_end;
+    size_t size;
+    int error;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cond;
+    pthread_cond_t  done_cond;
+    atomic_int abort;
+};
+
+static int upload_interrupt(void *opaque)
+{
+    UploadWorker *w = opaque;
+
+    return atomic_load(&w->u->abort) ||
+           ff_check_interrupt(&w->u->s->interrupt_callback);
+}
+
+static int same_server(const char *url1, const char *url2)
+{
+    char proto1[10], proto2[10], host1[1024], host2[1024];
+    int port1, port2;
+
+    av_url_split(proto1, sizeof(proto1), NULL, 0, host1, sizeof(host1),
+                 &port1, NULL, 0, url1);
+    av_url_split(proto2, sizeof(proto2), NULL, 0, host2, sizeof(host2),
+                 &port2, NULL, 0, url2);
+
+    return port1 == port2 && !strcmp(proto1, proto2) && !strcmp(host1, host2);
+}
+
+static void close_connection(UploadWorker *w)
+{
+    avio_closep(&w->pb);
+    av_freep(&w->pb_url);
+}
+
+static int open_connection(UploadWorker *w, const char *url, AVDictionary **options)
+{
+    AVFormatContext *s = w->u->s;
+    const AVDictionaryEntry *e = av_dict_get(*options, "multiple_requests", NULL, 0);
+    const int persistent = e && strcmp(e->value, "0");
+    int ret;
+
+#if CONFIG_HTTP_PROTOCOL
+    if (w->pb && w->pb_url && same_server(w->pb_url, url)) {
+        ret = ff_http_do_new_request2(ffio_geturlcontext(w->pb), url, options);
+        if (ret >= 0)
+            return 0;
+    }
+#endif
+    close_connection(w);
+
+    ret = ffio_open_whitelist(&w->pb, url, AVIO_FLAG_WRITE, &w->int_cb, options,
+                              s->protocol_whitelist, s->protocol_blacklist);
+    if (ret < 0)
+        return ret;
+
+    /* only the persistent connections are reused */
+    if (persistent) {
+        w->pb_url = av_strdup(url);
+        if (!w->pb_url) {
+            close_connection(w);
+            return AVERROR(ENOMEM);
+        }
+    }
+    return 0;
+}
+
+static int upload(UploadWorker *w, const UploadEntry *e)
+{
+    AVDictionary *options = NULL;
+    int ret;
+
+    /* the HTTP errors are only known from the response */
+    ret = av_dict_copy(&options, e->options, 0);
+    if (ret >= 0)
+        ret = av_dict_set(&options, "wait_response", "1", 0);
+    if (ret >= 0)
+        ret = open_connection(w, e->url, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+        return ret;
+
+    for (size_t pos = 0; pos < e->size; ) {
+        int len = FFMIN(e->size - pos, INT_MAX);
+        avio_write(w->pb, e->data + pos, len);
+        pos += len;
+    }
+    avio_flush(w->pb);
+    ret = w->pb->error;
+
+    if (ret >= 0 && w->pb_url) {
+        URLContext *h = ffio_geturlcontext(w->pb);
+        ret = h ? ffurl_shutdown(h, AVIO_FLAG_WRITE) : 0;
+    }
+    if (ret < 0 || !w->pb_url) {
+        int close_ret;
+        av_freep(&w->pb_url);
+        close_ret = avio_closep(&w->pb);
+        if (ret >= 0)
+            ret = close_ret;
+    }
+    return ret;
+}
+
+static int upload_with_retries(UploadWorker *w, const UploadEntry *e)
+{
+    FFUploader *u = w->u;
+    int64_t delay = RETRY_DELAY;
+    int ret;
+
+    for (int retry = 0; ; retry++) {
+        ret = upload(w, e);
+        if (ret >= 0 || ret == AVERROR_EXIT || upload_interrupt(w))
+            break;
+        if (retry >= u->max_retries) {
+            av_log(u->s, AV_LOG_ERROR, "Failed to upload '%s': %s\n",
+                   e->url, av_err2str(ret));
+            break;
+        }
+        av_log(u->s, AV_LOG_WARNING, "Failed to upload '%s': %s, retrying\n",
+               e->url, av_err2str(ret));
+
+        for (int64_t t = 0; t < delay && !upload_interrupt(w); t += 10000)
+            av_usleep(10000);
+        delay = FFMIN(2 * delay, MAX_RETRY_DELAY);
+    }
+    return ret;
+}
+
+static void free_entry(UploadEntry **pe)
+{
+    UploadEntry *e = *pe;
+
+    if (!e)
+        return;
+    av_freep(&e->url);
+    av_dict_free(&e->options);
+    av_freep(&e->data);
+    av_freep(pe);
+}
+
+/* called with the lock held */
+static void remove_entry(FFUploader *u, UploadEntry *e)
+{
+    UploadEntry **pe = &u->entries;
+
+    while (*pe != e)
+        pe = &(*pe)->next;
+    *pe = e->next;
+    if (!e->next)
+        u->entries_end = pe;
+    u->size -= e->size;
+    free_entry(&e);
+    pthread_cond_broadcast(&u->done_cond);
+}
+
+/* oldest upload that is not ordered after a pending one */
+static UploadEntry *next_entry(FFUploader *u)
+{
+    for (UploadEntry *e = u->entries; e; e = e->next) {
+        int blocked = 0;
+
+        if (e->running)
+            continue;
+        for (UploadEntry *prev = u->entries; prev != e && !blocked; prev = prev->next)
+            blocked = prev->queue == e->queue || prev->queue < 0 || e->queue < 0;
+        if (!blocked)
+            return e;
+    }
+    return NULL;
+}
+
+static void *worker_thread(void *arg)
+{
+    UploadWorker *w = arg;
+    FFUploader *u = w->u;
+
+    pthread_mutex_lock(&u->lock);
+    while (1) {
+        UploadEntry *e;
+        int ret;
+
+        while (!atomic_load(&u->abort) && !(e = next_entry(u)))
+            pthread_cond_wait(&u->work_cond, &u->lock);
+        if (atomic_load(&u->abort))
+            break;
+
+        e->running = 1;
+        pthread_mutex_unlock(&u->lock);
+
+        ret = upload_with_retries(w, e);
+
+        pthread_mutex_lock(&u->lock);
+        if (ret < 0 && !u->error)
+            u->error = ret;
+        remove_entry(u, e);
+        /* the uploads ordered after this one can start */
+        pthread_cond_broadcast(&u->work_cond);
+    }
+    pthread_mutex_unlock(&u->lock);
+
+    return NULL;
+}
+
+static void free_buffer(UploadBuffer *b)
+{
+    if (*b->pb == b->ctx)
+        *b->pb = NULL;
+    ffio_free_dyn_buf(&b->ctx);
+    av_freep(&b->url);
+    av_dict_free(&b->options);
+}
+
+void ff_uploader_free(FFUploader **pu)
+{
+    FFUploader *u = *pu;
+
+    if (!u)
+        return;
+
+    pthread_mutex_lock(&u->lock);
+    atomic_store(&u->abort, 1);
+    pthread_cond_broadcast(&u->work_cond);
+    pthread_mutex_unlock(&u->lock);
+
+    for (int i = 0; i < u->nb_started; i++)
+        pthread_join(u->workers[i].thread, NULL);
+
+    while (u->entries) {
+        UploadEntry *e = u->entries;
+        u->entries = e->next;
+        free_entry(&e);
+    }
+    for (int i = 0; i < u->nb_buffers; i++)
+        free_buffer(&u->buffers[i]);
+    for (int i = 0; i < u->nb_workers; i++)
+        close_connection(&u->workers[i]);
+    av_freep(&u->buffers);
+    av_freep(&u->workers);
+
+    pthread_cond_destroy(&u->done_cond);
+    pthread_cond_destroy(&u->work_cond);
+    pthread_mutex_destroy(&u->lock);
+    av_freep(pu);
+}
+
+int ff_uploader_alloc(FFUploader **pu, AVFormatContext *s, int nb_connections,
+                      size_t max_size, int max_retries)
+{
+    FFUploader *u;
+    int ret;
+
+    u = av_mallocz(sizeof(*u));
+    if (!u)
+        return AVERROR(ENOMEM);
+    u->s           = s;
+    u->max_size    = max_size;
+    u->max_retries = max_retries;
+    u->entries_end = &u->entries;
+    atomic_init(&u->abort, 0);
+
+    if ((ret = pthread_mutex_init(&u->lock, NULL))) {
+        av_free(u);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&u->work_cond, NULL))) {
+        pthread_mutex_destroy(&u->lock);
+        av_free(u);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&u->done_cond, NULL))) {
+        pthread_cond_destroy(&u->work_cond);
+        pthread_mutex_destroy(&u->lock);
+        av_free(u);
+        return AVERROR(ret);
+    }
+    *pu = u;
+
+    nb_connections = FFMAX(nb_connections, 1);
+    u->workers = av_calloc(nb_connections, sizeof(*u->workers));
+    if (!u->workers) {
+        ff_uploader_free(pu);
+        return AVERROR(ENOMEM);
+    }
+    u->nb_workers = nb_connections;
+
+    for (int i = 0; i < nb_connections; i++) {
+        UploadWorker *w = &u->workers[i];
+
+        w->u      = u;
+        w->int_cb = (AVIOInterruptCB){ upload_interrupt, w };
+        if ((ret = pthread_create(&w->thread, NULL, worker_thread, w))) {
+            ff_uploader_free(pu);
+            return AVERROR(ret);
+        }
+        u->nb_started++;
+    }
+
+    return 0;
+}
+
+int ff_uploader_submit(FFUploader *u, int queue, const char *url,
+                       AVDictionary *options, uint8_t *data, size_t size)
+{
+    UploadEntry *e;
+    int ret = 0;
+
+    e = av_mallocz(sizeof(*e));
+    if (!e) {
+        av_free(data);
+        return AVERROR(ENOMEM);
+    }
+    e->queue = queue;
+    e->data  = data;
+    e->size  = size;
+    e->url   = av_strdup(url);
+    if (!e->url || av_dict_copy(&e->options, options, 0) < 0) {
+        free_entry(&e);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_lock(&u->lock);
+    while (u->max_size && u->entries && u->size + size > u->max_size) {
+        if (ff_check_interrupt(&u->s->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_cond_wait(&u->done_cond, &u->lock);
+    }
+
+    if (ret >= 0) {
+        *u->entries_end = e;
+        u->entries_end  = &e->next;
+        u->size += size;
+        e = NULL;
+        pthread_cond_signal(&u->work_cond);
+    }
+    pthread_mutex_unlock(&u->lock);
+
+    free_entry(&e);
+    return ret;
+}
+
+int ff_uploader_open(FFUploader *u, AVIOContext **pb, int queue,
+                     const char *url, AVDictionary *options)
+{
+    UploadBuffer *b;
+    int ret;
+
+    b = av_realloc_array(u->buffers, u->nb_buffers + 1, sizeof(*u->buffers));
+    if (!b)
+        return AVERROR(ENOMEM);
+    u->buffers = b;
+    b = &b[u->nb_buffers];
+    memset(b, 0, sizeof(*b));
+
+    b->pb    = pb;
+    b->queue = queue;
+    b->url   = av_strdup(url);
+    if (!b->url || av_dict_copy(&b->options, options, 0) < 0) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    if ((ret = avio_open_dyn_buf(pb)) < 0)
+        goto fail;
+    b->ctx = *pb;
+    u->nb_buffers++;
+
+    return 0;
+fail:
+    av_freep(&b->url);
+    av_dict_free(&b->options);
+    return ret;
+}
+
+int ff_uploader_close(FFUploader *u, AVIOContext **pb)
+{
+    UploadBuffer b;
+    uint8_t *data;
+    int i, ret;
+
+    for (i = 0; i < u->nb_buffers; i++)
+        if (u->buffers[i].ctx == *pb)
+            break;
+    if (i == u->nb_buffers)
+        return AVERROR(ENOENT);
+
+    b = u->buffers[i];
+    u->buffers[i] = u->buffers[--u->nb_buffers];
+
+    ret = avio_close_dyn_buf(*pb, &data);
+    *pb = NULL;
+    if (ret >= 0)
+        ret = ff_uploader_submit(u, b.queue, b.url, b.options, data, ret);
+    else
+        av_free(data);
+    av_free(b.url);
+    av_dict_free(&b.options);
+
+    return ret;
+}
+
+int ff_uploader_wait(FFUploader *u)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&u->lock);
+    while (u->entries) {
+        if (ff_check_interrupt(&u->s->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_cond_wait(&u->done_cond, &u->lock);
+    }
+    if (ret >= 0)
+        ret = u->error;
+    u->error = 0;
+    pthread_mutex_unlock(&u->lock);
+
+    return ret;
+}
+
+#else
+
+int ff_uploader_alloc(FFUploader **u, AVFormatContext *s, int nb_connections,
+                      size_t max_size, int max_retries)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_uploader_free(FFUploader **u)
+{
+}
+
+int ff_uploader_submit(FFUploader *u, int queue, const char *url,
+                       AVDictionary *options, uint8_t *data, size_t size)
+{
+    av_free(data);
+    return AVERROR(ENOSYS);
+}
+
+int ff_uploader_open(FFUploader *u, AVIOContext **pb, int queue,
+                     const char *url, AVDictionary *options)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_uploader_close(FFUploader *u, AVIOContext **pb)
+{
+    return AVERROR(ENOENT);
+}
+
+int ff_uploader_wait(FFUploader *u)
+{
+    return AVERROR(ENOSYS);
+}
+
+#endif /* HAVE_THREADS */
@@ -0,0 +1,107 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Background upload of the files written by the segmenting muxers.
+ *
+ * The files are written into memory by the muxer and uploaded by worker
+ * threads once closed. The uploads of a queue are done in order, one at a
+ * time, while different queues (e.g. the renditions of a stream) are
+ * uploaded at once. With persistent HTTP connections (the multiple_requests
+ * option), the connection of a worker is reused for the next upload to the
+ * same server.
+ */
+
+#ifndef AVFORMAT_UPLOAD_H
+#define AVFORMAT_UPLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libavutil/dict.h"
+
+#include "avformat.h"
+#include "avio.h"
+
+typedef struct FFUploader FFUploader;
+
+/**
+ * Allocate an uploader using up to nb_connections connections at once.
+ *
+ * The files are opened with the protocol white and black lists and the
+ * interrupt callback of s, which is called from the worker threads.
+ *
+ * @param max_size    limit of the memory used by the pending uploads, 0 for no
+ *                    limit
+ * @param max_retries number of times a failed upload is retried
+ * @return 0 on success, AVERROR(ENOSYS) if threads are not available, a
+ *         negative error code otherwise
+ */
+int ff_uploader_alloc(FFUploader **u, AVFormatContext *s, int nb_connections,
+                      size_t max_size, int max_retries);
+
+/**
+ * Abort the pending uploads and free the uploader, along with the buffers
+ * still open, whose pointers are reset.
+ */
+void ff_uploader_free(FFUploader **u);
+
+/**
+ * Queue the upload of a file.
+ *
+ * An upload starts once the ones queued before it in the same queue are
+ * done. A negative queue orders the upload after all the ones queued before
+ * it and before all the ones queued after it, e.g. for a playlist
+ * referencing the files of several queues.
+ *
+ * When the memory limit is reached, this waits for uploads to complete.
+ *
+ * @param options options for opening the url, left untouched
+ * @param data    data to upload, freed with av_free() when done, also on
+ *                failure; NULL with an empty size to only send the request,
+ *                e.g. with the DELETE method
+ * @return 0 on success, a negative error code otherwise
+ */
+int ff_uploader_submit(FFUploader *u, int queue, const char *url,
+                       AVDictionary *options, uint8_t *data, size_t size);
+
+/**
+ * Open a memory buffer, uploaded to url with ff_uploader_submit() when closed
+ * with ff_uploader_close().
+ */
+int ff_uploader_open(FFUploader *u, AVIOContext **pb, int queue,
+                     const char *url, AVDictionary *options);
+
+/**
+ * Close a buffer opened with ff_uploader_open() and queue its upload.
+ *
+ * @return 0 on success, AVERROR(ENOENT) if *pb was not opened with
+ *         ff_uploader_open(), a negative error code otherwise
+ */
+int ff_uploader_close(FFUploader *u, AVIOContext **pb);
+
+/**
+ * Wait for all the queued uploads to complete.
+ *
+ * @return 0 if all the uploads since the last call succeeded, the error of
+ *         the first failed one otherwise
+ */
+int ff_uploader_wait(FFUploader *u);
+
+#endif /* AVFORMAT_UPLOAD_H */
@@ -0,0 +1,579 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _DEFAULT_SOURCE /* Needed for syscall() and MAP_POPULATE */
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+
+#include "uring.h"
+
+enum SlotState {
+    SLOT_FREE,
+    /* write buffer still accepting data */
+    SLOT_FILLING,
+    /* write buffer ready to be submitted */
+    SLOT_QUEUED,
+    SLOT_INFLIGHT,
+    /* read buffer holding data */
+    SLOT_DONE,
+};
+
+typedef struct URingSlot {
+    uint8_t *data;
+    /* bytes read or to write */
+    int      size;
+    /* bytes consumed or already written */
+    int      pos;
+    int64_t  offset;
+    /* error returned by a read */
+    int      ret;
+    enum SlotState state;
+} URingSlot;
+
+/* buffers of one direction, used in a circular order */
+typedef struct URingQueue {
+    URingSlot *slots;
+    uint8_t   *buf;
+    int        nb_slots;
+    int        slot_size;
+    /* oldest slot in use and number of slots in use */
+    int        head;
+    int        nb_used;
+    int        nb_inflight;
+    /* file position of the next slot */
+    int64_t    offset;
+    /* reads only: end of file reached, no need to submit more */
+    int        eof;
+    /* writes only: first error of a completed write */
+    int        ret;
+} URingQueue;
+
+struct FFURing {
+    int ring_fd;
+    int fd;
+    int flags;
+    int closing;
+
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void  *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    /* sqes not yet handed to the kernel */
+    unsigned to_submit;
+
+    URingQueue rx, tx;
+};
+
+/* user_data layout: direction in bit 16, slot index below */
+#define USER_DATA_TX     (1 << 16)
+#define USER_DATA_CANCEL (1 << 17)
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(FFURing *r, unsigned min_complete)
+{
+    while (1) {
+        int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        int ret = syscall(__NR_io_uring_enter, r->ring_fd, r->to_submit,
+                          min_complete, flags, NULL, 0);
+        if (ret >= 0) {
+            r->to_submit -= FFMIN(ret, r->to_submit);
+            return 0;
+        }
+        if (errno != EINTR)
+            return AVERROR(errno);
+    }
+}
+
+static struct io_uring_sqe *get_sqe(FFURing *r, uint64_t user_data)
+{
+    unsigned tail = *r->sq_tail;
+    unsigned idx  = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data  = user_data;
+    r->sq_array[idx] = idx;
+    atomic_store_explicit((atomic_uint*)r->sq_tail, tail + 1, memory_order_release);
+    r->to_submit++;
+
+    return sqe;
+}
+
+static void submit_slot(FFURing *r, URingQueue *q, int idx)
+{
+    URingSlot *slot = &q->slots[idx];
+    int tx = q == &r->tx;
+    struct io_uring_sqe *sqe = get_sqe(r, idx | (tx ? USER_DATA_TX : 0));
+
+    sqe->fd   = r->fd;
+    sqe->addr = (uintptr_t)(slot->data + slot->pos);
+    sqe->len  = tx ? slot->size - slot->pos : q->slot_size;
+    if (r->flags & FF_URING_STREAM) {
+        sqe->opcode    = tx ? IORING_OP_SEND : IORING_OP_RECV;
+        sqe->msg_flags = tx ? MSG_NOSIGNAL : 0;
+    } else {
+        sqe->opcode = tx ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->off    = slot->offset + slot->pos;
+    }
+
+    slot->state = SLOT_INFLIGHT;
+    q->nb_inflight++;
+}
+
+/* queue reads for all the free buffers */
+static void submit_reads(FFURing *r)
+{
+    URingQueue *q = &r->rx;
+
+    while (q->nb_used < q->nb_slots && !q->eof && !r->closing &&
+           (!(r->flags & FF_URING_STREAM) || !q->nb_inflight)) {
+        int idx = (q->head + q->nb_used++) % q->nb_slots;
+        URingSlot *slot = &q->slots[idx];
+
+        slot->size   = slot->pos = slot->ret = 0;
+        slot->offset = q->offset;
+        q->offset   += q->slot_size;
+        submit_slot(r, q, idx);
+    }
+}
+
+/* queue the filled write buffers, in order for streams */
+static void submit_writes(FFURing *r)
+{
+    URingQueue *q = &r->tx;
+
+    if (r->closing)
+        return;
+
+    for (int i = 0; i < q->nb_used; i++) {
+        int idx = (q->head + i) % q->nb_slots;
+        URingSlot *slot = &q->slots[idx];
+
+        /* do not sit on data when the kernel is idle */
+        if (slot->state == SLOT_FILLING && !q->nb_inflight)
+            slot->state = SLOT_QUEUED;
+
+        if ((r->flags & FF_URING_STREAM) && q->nb_inflight)
+            break;
+        if (slot->state == SLOT_QUEUED)
+            submit_slot(r, q, idx);
+    }
+}
+
+static void free_slots(URingQueue *q)
+{
+    while (q->nb_used && q->slots[q->head].state == SLOT_FREE) {
+        q->head = (q->head + 1) % q->nb_slots;
+        q->nb_used--;
+    }
+}
+
+static void complete(FFURing *r, const struct io_uring_cqe *cqe)
+{
+    int tx          = !!(cqe->user_data & USER_DATA_TX);
+    URingQueue *q   = tx ? &r->tx : &r->rx;
+    URingSlot *slot;
+    int res = cqe->res;
+
+    if (cqe->user_data & USER_DATA_CANCEL)
+        return;
+
+    slot = &q->slots[cqe->user_data & (USER_DATA_TX - 1)];
+    q->nb_inflight--;
+
+    if ((res == -EINTR || res == -EAGAIN) && !r->closing) {
+        submit_slot(r, q, slot - q->slots);
+        return;
+    }
+
+    if (tx) {
+        if (res > 0)
+            slot->pos += res;
+        else if (!q->ret)
+            q->ret = res < 0 ? AVERROR(-res) : AVERROR(EIO);
+        if (slot->pos < slot->size && !q->ret && !r->closing) {
+            submit_slot(r, q, slot - q->slots);
+            return;
+        }
+        slot->state = SLOT_FREE;
+        free_slots(q);
+        return;
+    }
+
+    slot->state = SLOT_DONE;
+    if (res < 0) {
+        slot->ret = AVERROR(-res);
+    } else {
+        slot->size = res;
+        /* a short read of a file means everything after it is past the end */
+        if (!(r->flags & FF_URING_STREAM) ? res < q->slot_size : !res)
+            q->eof = 1;
+    }
+}
+
+static void reap(FFURing *r)
+{
+    unsigned head = *r->cq_head;
+    unsigned tail = atomic_load_explicit((atomic_uint*)r->cq_tail, memory_order_acquire);
+
+    for (; head != tail; head++)
+        complete(r, &r->cqes[head & *r->cq_mask]);
+    atomic_store_explicit((atomic_uint*)r->cq_head, head, memory_order_release);
+}
+
+/* submit what is queued, wait for one completion if asked to and process
+ * all the available ones */
+static int process(FFURing *r, int wait)
+{
+    int ret;
+
+    if (r->flags & FF_URING_READ)
+        submit_reads(r);
+    if (r->flags & FF_URING_WRITE)
+        submit_writes(r);
+
+    if (r->to_submit || wait) {
+        ret = uring_enter(r, wait);
+        if (ret < 0)
+            return ret;
+    }
+    reap(r);
+
+    return 0;
+}
+
+static int queue_init(URingQueue *q, int nb_slots, int slot_size, int64_t offset)
+{
+    q->slots = av_calloc(nb_slots, sizeof(*q->slots));
+    q->buf   = av_malloc_array(nb_slots, slot_size);
+    if (!q->slots || !q->buf)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < nb_slots; i++)
+        q->slots[i].data = q->buf + (size_t)i * slot_size;
+    q->nb_slots  = nb_slots;
+    q->slot_size = slot_size;
+    q->offset    = offset;
+
+    return 0;
+}
+
+static void queue_uninit(URingQueue *q)
+{
+    av_freep(&q->slots);
+    av_freep(&q->buf);
+}
+
+int ff_uring_alloc(FFURing **pr, int fd, int flags,
+                   int nb_buffers, int buffer_size, int64_t offset)
+{
+    struct io_uring_params p = { 0 };
+    FFURing *r;
+    int ret;
+
+    *pr = NULL;
+
+    if (nb_buffers <= 0 || nb_buffers >= USER_DATA_TX || buffer_size <= 0)
+        return AVERROR(EINVAL);
+
+    r = av_mallocz(sizeof(*r));
+    if (!r)
+        return AVERROR(ENOMEM);
+    r->fd      = fd;
+    r->flags   = flags;
+    r->ring_fd = -1;
+
+    if (flags & FF_URING_READ &&
+        (ret = queue_init(&r->rx, nb_buffers, buffer_size, offset)) < 0)
+        goto fail;
+    if (flags & FF_URING_WRITE &&
+        (ret = queue_init(&r->tx, nb_buffers, buffer_size, offset)) < 0)
+        goto fail;
+
+    /* one entry per buffer and one per cancel request issued on close */
+    r->ring_fd = uring_setup(2 * nb_buffers + 2, &p);
+    if (r->ring_fd < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    /* read, write, send and recv all appeared before fast poll (Linux 5.7) */
+    if (!(p.features & IORING_FEAT_FAST_POLL)) {
+        ret = AVERROR(ENOSYS);
+        goto fail;
+    }
+
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_size    = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING);
+    r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING);
+    r->sqes    = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQES);
+    if (r->sq_ring == MAP_FAILED || r->cq_ring == MAP_FAILED ||
+        r->sqes == MAP_FAILED) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+
+    r->sq_tail  = (unsigned*)((uint8_t*)r->sq_ring + p.sq_off.tail);
+    r->sq_mask  = (unsigned*)((uint8_t*)r->sq_ring + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)((uint8_t*)r->sq_ring + p.sq_off.array);
+    r->cq_head  = (unsigned*)((uint8_t*)r->cq_ring + p.cq_off.head);
+    r->cq_tail  = (unsigned*)((uint8_t*)r->cq_ring + p.cq_off.tail);
+    r->cq_mask  = (unsigned*)((uint8_t*)r->cq_ring + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe*)((uint8_t*)r->cq_ring + p.cq_off.cqes);
+
+    *pr = r;
+    return 0;
+
+fail:
+    ff_uring_free(&r);
+    return ret;
+}
+
+void ff_uring_free(FFURing **pr)
+{
+    FFURing *r = *pr;
+
+    if (!r)
+        return;
+
+    if (r->sqes && r->sqes != MAP_FAILED) {
+        /* a send or a receive may never complete on its own */
+        r->closing = 1;
+        if (r->flags & FF_URING_STREAM) {
+            for (int tx = 0; tx < 2; tx++) {
+                URingQueue *q = tx ? &r->tx : &r->rx;
+                for (int i = 0; i < q->nb_used; i++) {
+                    int idx = (q->head + i) % q->nb_slots;
+                    if (q->slots[idx].state == SLOT_INFLIGHT) {
+                        struct io_uring_sqe *sqe = get_sqe(r, USER_DATA_CANCEL);
+                        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                        sqe->addr   = idx | (tx ? USER_DATA_TX : 0);
+                    }
+                }
+            }
+        }
+        while (r->rx.nb_inflight || r->tx.nb_inflight)
+            if (process(r, 1) < 0)
+                break;
+    }
+
+    if (r->sqes && r->sqes != MAP_FAILED)
+        munmap(r->sqes, r->sqes_size);
+    if (r->cq_ring && r->cq_ring != MAP_FAILED)
+        munmap(r->cq_ring, r->cq_ring_size);
+    if (r->sq_ring && r->sq_ring != MAP_FAILED)
+        munmap(r->sq_ring, r->sq_ring_size);
+    if (r->ring_fd >= 0)
+        close(r->ring_fd);
+
+    queue_uninit(&r->rx);
+    queue_uninit(&r->tx);
+    av_freep(pr);
+}
+
+int ff_uring_read(FFURing *r, uint8_t *buf, int size, int nonblock)
+{
+    URingQueue *q = &r->rx;
+    int copied = 0;
+    int ret;
+
+    ret = process(r, 0);
+    if (ret < 0)
+        return ret;
+
+    while (1) {
+        URingSlot *slot = q->nb_used ? &q->slots[q->head] : NULL;
+
+        if (slot && slot->state == SLOT_DONE) {
+            int len = FFMIN(size - copied, slot->size - slot->pos);
+
+            /* errors and the end of file stay until a seek */
+            if (!len)
+                return copied ? copied : slot->ret ? slot->ret : AVERROR_EOF;
+
+            memcpy(buf + copied, slot->data + slot->pos, len);
+            slot->pos += len;
+            copied    += len;
+            if (slot->pos == slot->size) {
+                slot->state = SLOT_FREE;
+                free_slots(q);
+            }
+            if (copied == size)
+                break;
+            continue;
+        }
+
+        if (copied)
+            break;
+        if (!slot && q->eof)
+            return AVERROR_EOF;
+        if (nonblock && slot)
+            return AVERROR(EAGAIN);
+
+        ret = process(r, !!slot);
+        if (ret < 0)
+            return ret;
+    }
+
+    /* refill the buffers just emptied */
+    ret = process(r, 0);
+    return ret < 0 ? ret : copied;
+}
+
+int ff_uring_write(FFURing *r, const uint8_t *buf, int size, int nonblock)
+{
+    URingQueue *q = &r->tx;
+    int copied = 0;
+    int ret;
+
+    ret = process(r, 0);
+    if (ret < 0)
+        return ret;
+    if (q->ret < 0)
+        return q->ret;
+
+    while (copied < size) {
+        URingSlot *slot = q->nb_used ?
+            &q->slots[(q->head + q->nb_used - 1) % q->nb_slots] : NULL;
+        int len;
+
+        if (!slot || slot->state != SLOT_FILLING) {
+            if (q->nb_used == q->nb_slots) {
+                if (copied || nonblock)
+                    break;
+                ret = process(r, 1);
+                if (ret < 0)
+                    return ret;
+                continue;
+            }
+            slot = &q->slots[(q->head + q->nb_used++) % q->nb_slots];
+            slot->state  = SLOT_FILLING;
+            slot->size   = slot->pos = 0;
+            slot->offset = q->offset;
+        }
+
+        len = FFMIN(size - copied, q->slot_size - slot->size);
+        memcpy(slot->data + slot->size, buf + copied, len);
+        slot->size += len;
+        q->offset  += len;
+        copied     += len;
+        if (slot->size == q->slot_size)
+            slot->state = SLOT_QUEUED;
+    }
+
+    ret = process(r, 0);
+    if (ret < 0)
+        return ret;
+
+    return copied ? copied : AVERROR(EAGAIN);
+}
+
+int ff_uring_flush(FFURing *r, int nonblock)
+{
+    URingQueue *q = &r->tx;
+
+    while (q->nb_used) {
+        int ret;
+
+        for (int i = 0; i < q->nb_used; i++) {
+            URingSlot *slot = &q->slots[(q->head + i) % q->nb_slots];
+            if (slot->state == SLOT_FILLING)
+                slot->state = SLOT_QUEUED;
+        }
+        ret = process(r, !nonblock);
+        if (ret < 0)
+            return ret;
+        if (nonblock && q->nb_used)
+            return q->ret < 0 ? q->ret : AVERROR(EAGAIN);
+    }
+
+    return q->ret;
+}
+
+int64_t ff_uring_seek(FFURing *r, int64_t offset)
+{
+    int ret;
+
+    if (r->flags & FF_URING_STREAM)
+        return AVERROR(ESPIPE);
+
+    if (r->flags & FF_URING_WRITE && offset != r->tx.offset) {
+        /* the writes in flight are not ordered, so wait for them before
+         * writing data that may overlap them */
+        ret = ff_uring_flush(r, 0);
+        if (ret < 0)
+            return ret;
+        r->tx.offset = offset;
+    }
+
+    if (r->flags & FF_URING_READ) {
+        URingQueue *q = &r->rx;
+        /* stop reading ahead at the old position */
+        q->eof = 1;
+        while (q->nb_inflight) {
+            ret = process(r, 1);
+            if (ret < 0)
+                return ret;
+        }
+        for (int i = 0; i < q->nb_slots; i++)
+            q->slots[i].state = SLOT_FREE;
+        q->head = q->nb_used = 0;
+        q->offset = offset;
+        q->eof    = 0;
+    }
+
+    return offset;
+}
+
+int64_t ff_uring_tell(FFURing *r)
+{
+    const URingQueue *q = &r->rx;
+
+    if (!(r->flags & FF_URING_READ))
+        return r->tx.offset;
+    if (q->nb_used)
+        return q->slots[q->head].offset + q->slots[q->head].pos;
+    return q->offset;
+}
+
+int ff_uring_get_fd(FFURing *r)
+{
+    return r->ring_fd;
+}
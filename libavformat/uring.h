@@ -0,0 +1,115 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * io_uring based readahead and write-behind for file descriptors
+ */
+
+#ifndef AVFORMAT_URING_H
+#define AVFORMAT_URING_H
+
+#include <stdint.h>
+
+/** The ring is used for reading. */
+#define FF_URING_READ   1
+/** The ring is used for writing. */
+#define FF_URING_WRITE  2
+/**
+ * The file descriptor is a stream socket: there are no offsets, and
+ * operations in each direction are serialized to keep the data in order.
+ */
+#define FF_URING_STREAM 4
+
+typedef struct FFURing FFURing;
+
+/**
+ * Set up a ring for I/O on fd.
+ *
+ * Reads are served from up to nb_buffers buffers of buffer_size bytes filled
+ * ahead of time, writes are copied into such buffers and submitted in the
+ * background. Both are submitted in batches, one system call per call into
+ * the ring at most.
+ *
+ * @param flags  a combination of FF_URING_* flags
+ * @param offset file offset of the first read or write, ignored with
+ *               FF_URING_STREAM
+ * @return 0 on success, AVERROR(ENOSYS) if the kernel does not support
+ *         io_uring, another negative error code on failure
+ */
+int ff_uring_alloc(FFURing **pr, int fd, int flags,
+                   int nb_buffers, int buffer_size, int64_t offset);
+
+/**
+ * Cancel the pending I/O and free the ring. Data queued for writing is
+ * dropped unless ff_uring_flush() was called first. Writes to files that
+ * were already submitted are waited for, sends and receives on streams are
+ * cancelled. The file descriptor is not closed.
+ */
+void ff_uring_free(FFURing **pr);
+
+/**
+ * Read up to size bytes.
+ *
+ * @param nonblock return AVERROR(EAGAIN) instead of waiting when no data is
+ *                 available yet
+ * @return the number of bytes read, AVERROR_EOF or a negative error code
+ */
+int ff_uring_read(FFURing *r, uint8_t *buf, int size, int nonblock);
+
+/**
+ * Queue up to size bytes for writing. Errors of previous writes are
+ * reported by the following calls.
+ *
+ * @param nonblock return AVERROR(EAGAIN) instead of waiting when all the
+ *                 buffers are in use
+ * @return the number of bytes queued or a negative error code
+ */
+int ff_uring_write(FFURing *r, const uint8_t *buf, int size, int nonblock);
+
+/**
+ * Wait until all the queued data has been written.
+ *
+ * @param nonblock return AVERROR(EAGAIN) instead of waiting when data is
+ *                 still pending
+ * @return 0 on success or the first error of the pending writes
+ */
+int ff_uring_flush(FFURing *r, int nonblock);
+
+/**
+ * Move the file position used by following reads and writes, dropping the
+ * data read ahead. Not available with FF_URING_STREAM.
+ *
+ * @return offset on success or a negative error code
+ */
+int64_t ff_uring_seek(FFURing *r, int64_t offset);
+
+/**
+ * @return the file position of the next byte to be read, or written if the
+ *         ring is not used for reading
+ */
+int64_t ff_uring_tell(FFURing *r);
+
+/**
+ * Return a file descriptor that polls readable when the ring has completions
+ * to process, i.e. when ff_uring_read() or ff_uring_write() may return
+ * something other than AVERROR(EAGAIN).
+ */
+int ff_uring_get_fd(FFURing *r);
+
+#endif /* AVFORMAT_URING_H */
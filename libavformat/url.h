@@ -26,6 +26,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -85,6 +86,8 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    int (*url_map)(URLContext *h, int64_t pos, int size, AVBufferRef **buf);
+    int (*url_flush)(URLContext *h);
     int (*url_shutdown)(URLContext *h, int flags);
     const AVClass *priv_data_class;
     int priv_data_size;
@@ -253,6 +256,23 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(URLContext *h);
 
+/**
+ * Map size bytes of the resource starting at pos into a new buffer,
+ * followed by AV_INPUT_BUFFER_PADDING_SIZE zeroed bytes.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if the protocol cannot map this
+ *         range and it has to be read, another negative error code on failure
+ */
+int ffurl_map(URLContext *h, int64_t pos, int size, AVBufferRef **buf);
+
+/**
+ * Wait until the data passed to ffurl_write() has reached the resource,
+ * for protocols writing in the background.
+ *
+ * @return 0 on success or a negative error code
+ */
+int ffurl_flush(URLContext *h);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
@@ -101,6 +101,8 @@ static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
 
 int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
+    int ret;
+
 #if FF_API_INIT_PACKET
 FF_DISABLE_DEPRECATION_WARNINGS
     av_init_packet(pkt);
@@ -112,6 +114,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     pkt->pos  = avio_tell(s);
 
+    if ((ret = ffio_get_mapped_packet(s, pkt, size)) != AVERROR(ENOSYS))
+        return ret;
+
     return append_packet_chunked(s, pkt, size);
 }
 
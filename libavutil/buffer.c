@@ -74,18 +74,38 @@ void av_buffer_default_free(void *opaque, uint8_t *data)
     av_free(data);
 }
 
+/* Offset of the data from the start of a block holding both an AVBuffer and
+ * its data, keeping the data aligned the way av_malloc() does. */
+#define EMBEDDED_DATA_OFFSET FFALIGN(sizeof(AVBuffer), 64)
+
+static void buffer_embedded_free(void *opaque, uint8_t *data)
+{
+    av_free(data - EMBEDDED_DATA_OFFSET);
+}
+
 AVBufferRef *av_buffer_alloc(size_t size)
 {
     AVBufferRef *ret = NULL;
-    uint8_t    *data = NULL;
+    uint8_t   *block = NULL;
+    AVBuffer    *buf;
 
-    data = av_malloc(size);
-    if (!data)
+    /* Allocate the AVBuffer together with its data, which saves an
+     * allocation for every buffer, most of which are small side data. */
+    if (size > SIZE_MAX - EMBEDDED_DATA_OFFSET)
+        return NULL;
+    block = av_malloc(EMBEDDED_DATA_OFFSET + size);
+    if (!block)
         return NULL;
 
-    ret = av_buffer_create(data, size, av_buffer_default_free, NULL, 0);
-    if (!ret)
-        av_freep(&data);
+    buf = (AVBuffer *)block;
+    memset(buf, 0, sizeof(*buf));
+    ret = buffer_create(buf, block + EMBEDDED_DATA_OFFSET, size,
+                        buffer_embedded_free, NULL, 0);
+    if (!ret) {
+        av_free(block);
+        return NULL;
+    }
+    buf->flags_internal |= BUFFER_FLAG_NO_FREE;
 
     return ret;
 }
@@ -304,6 +324,15 @@ static void buffer_pool_flush(AVBufferPool *pool)
     }
 }
 
+void ff_buffer_pool_flush(AVBufferPool *pool)
+{
+    ff_mutex_lock(&pool->mutex);
+    buffer_pool_flush(pool);
+    ff_mutex_unlock(&pool->mutex);
+}
+
+static void buffer_cache_unref(AVBufferCache *cache);
+
 /*
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
@@ -315,6 +344,8 @@ static void buffer_pool_free(AVBufferPool *pool)
 
     if (pool->pool_free)
         pool->pool_free(pool->opaque);
+    if (pool->cache)
+        buffer_cache_unref(pool->cache);
 
     av_freep(&pool);
 }
@@ -386,6 +417,9 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
+    if (pool->cache)
+        return av_buffer_cache_get(pool->cache, pool->size);
+
     ff_mutex_lock(&pool->mutex);
     buf = pool->pool;
     if (buf) {
@@ -414,3 +448,201 @@ void *av_buffer_pool_buffer_get_opaque(const AVBufferRef *ref)
     av_assert0(buf);
     return buf->opaque;
 }
+
+static void buffer_cache_unref(AVBufferCache *cache)
+{
+    if (atomic_fetch_sub_explicit(&cache->refcount, 1, memory_order_acq_rel) == 1) {
+        av_assert1(!cache->lru_first);
+        ff_mutex_destroy(&cache->mutex);
+        av_freep(&cache->bins);
+        av_freep(&cache);
+    }
+}
+
+AVBufferCache *av_buffer_cache_alloc(size_t max_size)
+{
+    AVBufferCache *cache = av_mallocz(sizeof(*cache));
+    if (!cache)
+        return NULL;
+
+    if (ff_mutex_init(&cache->mutex, NULL)) {
+        av_free(cache);
+        return NULL;
+    }
+
+    cache->max_size = max_size;
+    atomic_init(&cache->refcount, 1);
+
+    return cache;
+}
+
+/* must be called with the cache locked */
+static void buffer_cache_remove(AVBufferCache *cache, BufferCacheEntry *buf)
+{
+    if (buf->bin_prev)
+        buf->bin_prev->bin_next = buf->bin_next;
+    else
+        cache->bins[buf->bin].first = buf->bin_next;
+    if (buf->bin_next)
+        buf->bin_next->bin_prev = buf->bin_prev;
+
+    if (buf->lru_prev)
+        buf->lru_prev->lru_next = buf->lru_next;
+    else
+        cache->lru_first = buf->lru_next;
+    if (buf->lru_next)
+        buf->lru_next->lru_prev = buf->lru_prev;
+    else
+        cache->lru_last = buf->lru_prev;
+
+    buf->bin_prev = buf->bin_next = buf->lru_prev = buf->lru_next = NULL;
+    cache->unused_size -= buf->size;
+}
+
+static void buffer_cache_entry_free(BufferCacheEntry *buf)
+{
+    av_free(buf->data);
+    av_free(buf);
+}
+
+/* must be called with the cache locked */
+static int buffer_cache_find_bin(AVBufferCache *cache, size_t size, int add)
+{
+    BufferCacheBin *bins;
+
+    for (int i = 0; i < cache->nb_bins; i++)
+        if (cache->bins[i].size == size)
+            return i;
+    if (!add)
+        return AVERROR(ENOENT);
+
+    bins = av_fast_realloc(cache->bins, &cache->bins_allocated,
+                           (cache->nb_bins + 1) * sizeof(*cache->bins));
+    if (!bins)
+        return AVERROR(ENOMEM);
+    cache->bins = bins;
+    cache->bins[cache->nb_bins].size  = size;
+    cache->bins[cache->nb_bins].first = NULL;
+    return cache->nb_bins++;
+}
+
+static void cache_release_buffer(void *opaque, uint8_t *data)
+{
+    BufferCacheEntry *buf = opaque;
+    AVBufferCache *cache = buf->cache;
+    int bin;
+
+    ff_mutex_lock(&cache->mutex);
+    bin = cache->uninit || (cache->max_size && buf->size > cache->max_size) ?
+          AVERROR(EINVAL) : buffer_cache_find_bin(cache, buf->size, 1);
+    if (bin < 0) {
+        buffer_cache_entry_free(buf);
+    } else {
+        buf->bin      = bin;
+        buf->bin_next = cache->bins[bin].first;
+        if (buf->bin_next)
+            buf->bin_next->bin_prev = buf;
+        cache->bins[bin].first = buf;
+
+        buf->lru_next = cache->lru_first;
+        if (buf->lru_next)
+            buf->lru_next->lru_prev = buf;
+        else
+            cache->lru_last = buf;
+        cache->lru_first = buf;
+        cache->unused_size += buf->size;
+
+        while (cache->max_size && cache->unused_size > cache->max_size) {
+            BufferCacheEntry *oldest = cache->lru_last;
+            buffer_cache_remove(cache, oldest);
+            buffer_cache_entry_free(oldest);
+        }
+    }
+    ff_mutex_unlock(&cache->mutex);
+
+    buffer_cache_unref(cache);
+}
+
+AVBufferRef *av_buffer_cache_get(AVBufferCache *cache, size_t size)
+{
+    BufferCacheEntry *buf = NULL;
+    AVBufferRef *ret;
+    int bin;
+
+    ff_mutex_lock(&cache->mutex);
+    bin = buffer_cache_find_bin(cache, size, 0);
+    if (bin >= 0 && cache->bins[bin].first) {
+        buf = cache->bins[bin].first;
+        buffer_cache_remove(cache, buf);
+    }
+    ff_mutex_unlock(&cache->mutex);
+
+    if (!buf) {
+        buf = av_mallocz(sizeof(*buf));
+        if (!buf)
+            return NULL;
+        buf->data = av_mallocz(size);
+        if (!buf->data) {
+            av_free(buf);
+            return NULL;
+        }
+        buf->size  = size;
+        buf->cache = cache;
+    }
+
+    memset(&buf->buffer, 0, sizeof(buf->buffer));
+    ret = buffer_create(&buf->buffer, buf->data, size, cache_release_buffer, buf, 0);
+    if (!ret) {
+        buffer_cache_entry_free(buf);
+        return NULL;
+    }
+    buf->buffer.flags_internal |= BUFFER_FLAG_NO_FREE;
+
+    atomic_fetch_add_explicit(&cache->refcount, 1, memory_order_relaxed);
+
+    return ret;
+}
+
+size_t av_buffer_cache_get_unused_size(AVBufferCache *cache)
+{
+    size_t size;
+
+    ff_mutex_lock(&cache->mutex);
+    size = cache->unused_size;
+    ff_mutex_unlock(&cache->mutex);
+
+    return size;
+}
+
+void av_buffer_cache_uninit(AVBufferCache **pcache)
+{
+    AVBufferCache *cache;
+
+    if (!pcache || !*pcache)
+        return;
+    cache   = *pcache;
+    *pcache = NULL;
+
+    ff_mutex_lock(&cache->mutex);
+    cache->uninit = 1;
+    while (cache->lru_first) {
+        BufferCacheEntry *buf = cache->lru_first;
+        buffer_cache_remove(cache, buf);
+        buffer_cache_entry_free(buf);
+    }
+    ff_mutex_unlock(&cache->mutex);
+
+    buffer_cache_unref(cache);
+}
+
+AVBufferPool *av_buffer_pool_init_cache(size_t size, AVBufferCache *cache)
+{
+    AVBufferPool *pool = av_buffer_pool_init(size, NULL);
+    if (!pool)
+        return NULL;
+
+    pool->cache = cache;
+    atomic_fetch_add_explicit(&cache->refcount, 1, memory_order_relaxed);
+
+    return pool;
+}
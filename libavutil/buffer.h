@@ -315,6 +315,83 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
  */
 void *av_buffer_pool_buffer_get_opaque(const AVBufferRef *ref);
 
+/**
+ * @}
+ */
+
+/**
+ * @defgroup lavu_buffercache AVBufferCache
+ * @ingroup lavu_data
+ *
+ * @{
+ * AVBufferCache is a thread-safe cache of AVBuffers of any size, which may
+ * be shared by any number of buffer pools.
+ *
+ * Each AVBufferPool keeps the buffers returned to it for itself, so many
+ * pools of buffers of the same size, e.g. the frame pools of many decoders
+ * and filters processing streams of the same format and dimensions, hold
+ * many sets of nearly identical buffers. Pools created with
+ * av_buffer_pool_init_cache() instead give their buffers back to a common
+ * cache, from which the buffers of the same size are taken by all of them.
+ *
+ * The cache keeps the released buffers up to a memory budget, beyond which
+ * the least recently released ones are freed.
+ */
+
+/**
+ * The buffer cache. This structure is opaque and not meant to be accessed
+ * directly. It is allocated with av_buffer_cache_alloc() and freed with
+ * av_buffer_cache_uninit().
+ */
+typedef struct AVBufferCache AVBufferCache;
+
+/**
+ * Allocate a buffer cache.
+ *
+ * @param max_size maximum total size in bytes of the unused buffers kept in
+ *                 the cache, 0 for no limit
+ * @return the cache or NULL on failure
+ */
+AVBufferCache *av_buffer_cache_alloc(size_t max_size);
+
+/**
+ * Get a buffer of the given size from the cache, allocating it if the cache
+ * holds no unused buffer of this size. New buffers are zeroed. The buffer is
+ * returned to the cache when its last reference is unreferenced.
+ *
+ * @return a reference to the buffer on success, NULL on error.
+ */
+AVBufferRef *av_buffer_cache_get(AVBufferCache *cache, size_t size);
+
+/**
+ * @return the total size in bytes of the unused buffers held by the cache.
+ */
+size_t av_buffer_cache_get_unused_size(AVBufferCache *cache);
+
+/**
+ * Mark the cache as freeable and free its unused buffers. The buffers still in
+ * use are freed when they are released, and the cache is freed once all of
+ * them are and all the pools using it are uninitialized.
+ *
+ * @param pcache pointer to the cache, set to NULL
+ */
+void av_buffer_cache_uninit(AVBufferCache **pcache);
+
+/**
+ * Allocate and initialize a buffer pool taking its buffers from a cache.
+ *
+ * The pool behaves like one created by av_buffer_pool_init() with the default
+ * allocator, except that the buffers are returned to the cache instead of the
+ * pool, and av_buffer_pool_buffer_get_opaque() cannot be used on them. The
+ * pool holds a reference to the cache, so av_buffer_cache_uninit() may be
+ * called before the pool is uninitialized.
+ *
+ * @param size  size of each buffer in this pool
+ * @param cache the cache to take the buffers from
+ * @return newly created buffer pool on success, NULL on error.
+ */
+AVBufferPool *av_buffer_pool_init_cache(size_t size, AVBufferCache *cache);
+
 /**
  * @}
  */
@@ -105,6 +105,54 @@ struct AVBufferPool {
     AVBufferRef* (*alloc)(size_t size);
     AVBufferRef* (*alloc2)(void *opaque, size_t size);
     void         (*pool_free)(void *opaque);
+
+    /* the buffers are taken from and returned to this cache, if set */
+    AVBufferCache *cache;
+};
+
+/**
+ * Free the unused buffers held by the pool.
+ */
+void ff_buffer_pool_flush(AVBufferPool *pool);
+
+typedef struct BufferCacheEntry {
+    uint8_t *data;
+    size_t   size;
+
+    AVBufferCache *cache;
+
+    /* index of the list of unused buffers of the same size in the cache */
+    int bin;
+    /* neighbours in the list of unused buffers of the same size */
+    struct BufferCacheEntry *bin_prev, *bin_next;
+    /* neighbours in the list of all unused buffers, most recently released first */
+    struct BufferCacheEntry *lru_prev, *lru_next;
+
+    AVBuffer buffer;
+} BufferCacheEntry;
+
+typedef struct BufferCacheBin {
+    size_t size;
+    BufferCacheEntry *first;
+} BufferCacheBin;
+
+struct AVBufferCache {
+    AVMutex mutex;
+
+    BufferCacheBin *bins;
+    int          nb_bins;
+    unsigned bins_allocated;
+
+    BufferCacheEntry *lru_first, *lru_last;
+    size_t unused_size;
+    size_t max_size;
+    int uninit;
+
+    /*
+     * The pointer held by the caller, each pool using the cache and each
+     * buffer in use hold one reference.
+     */
+    atomic_uint refcount;
 };
 
 #endif /* AVUTIL_BUFFER_INTERNAL_H */
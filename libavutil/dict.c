@@ -29,11 +29,102 @@
 #include "time_internal.h"
 #include "bprint.h"
 
+/* Dictionaries with at least this many entries get a hash index. */
+#define HASH_MIN_COUNT 32
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+    /**
+     * Open-addressing hash table of (index into elems + 1), 0 marking an
+     * empty slot. Keys are hashed case-insensitively so that the table
+     * serves both kinds of lookups. NULL if there is no index.
+     */
+    int *hash;
+    unsigned hash_mask;
 };
 
+static unsigned hash_key(const char *key)
+{
+    uint32_t h = 2166136261u;
+
+    while (*key)
+        h = (h ^ av_toupper(*key++)) * 16777619u;
+    return h;
+}
+
+static void hash_insert(AVDictionary *m, int idx)
+{
+    unsigned pos = hash_key(m->elems[idx].key) & m->hash_mask;
+
+    while (m->hash[pos])
+        pos = (pos + 1) & m->hash_mask;
+    m->hash[pos] = idx + 1;
+}
+
+/* Must be called while the entry still holds its key. */
+static void hash_remove(AVDictionary *m, int idx)
+{
+    unsigned i = hash_key(m->elems[idx].key) & m->hash_mask, j;
+
+    while (m->hash[i] != idx + 1)
+        i = (i + 1) & m->hash_mask;
+
+    /* shift back the following entries of the cluster which would
+     * otherwise become unreachable */
+    for (j = i;;) {
+        unsigned k;
+
+        j = (j + 1) & m->hash_mask;
+        if (!m->hash[j])
+            break;
+        k = hash_key(m->elems[m->hash[j] - 1].key) & m->hash_mask;
+        if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+            m->hash[i] = m->hash[j];
+            i = j;
+        }
+    }
+    m->hash[i] = 0;
+}
+
+/* (Re)builds the index so that it can hold at least count entries. Without
+ * memory the dictionary simply keeps working without an index. */
+static void hash_rebuild(AVDictionary *m, int count)
+{
+    unsigned size = 2 * HASH_MIN_COUNT;
+
+    while (size < 2U * count)
+        size <<= 1;
+
+    av_freep(&m->hash);
+    m->hash = av_calloc(size, sizeof(*m->hash));
+    if (!m->hash)
+        return;
+    m->hash_mask = size - 1;
+    for (int i = 0; i < m->count; i++)
+        hash_insert(m, i);
+}
+
+static AVDictionaryEntry *hash_get(const AVDictionary *m, const char *key,
+                                   const AVDictionaryEntry *prev, int flags)
+{
+    unsigned pos = hash_key(key) & m->hash_mask;
+    int start = prev ? prev - m->elems + 1 : 0;
+    int best = -1;
+
+    /* with duplicate keys, the first one after prev in iteration order wins */
+    for (; m->hash[pos]; pos = (pos + 1) & m->hash_mask) {
+        int idx = m->hash[pos] - 1;
+        if (idx < start || (best >= 0 && idx > best))
+            continue;
+        if (flags & AV_DICT_MATCH_CASE ? strcmp(m->elems[idx].key, key)
+                                       : av_strcasecmp(m->elems[idx].key, key))
+            continue;
+        best = idx;
+    }
+    return best >= 0 ? &m->elems[best] : NULL;
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -66,6 +157,9 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     if (!key)
         return NULL;
 
+    if (m && m->hash && !(flags & AV_DICT_IGNORE_SUFFIX))
+        return hash_get(m, key, prev, flags);
+
     while ((entry = av_dict_iterate(m, entry))) {
         const char *s = entry->key;
         if (flags & AV_DICT_MATCH_CASE)
@@ -129,8 +223,15 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             copy_value = newval;
         } else
             av_free(tag->value);
+        if (m->hash) {
+            hash_remove(m, tag - m->elems);
+            if (tag - m->elems != m->count - 1)
+                hash_remove(m, m->count - 1);
+        }
         av_free(tag->key);
         *tag = m->elems[--m->count];
+        if (m->hash && tag - m->elems != m->count)
+            hash_insert(m, tag - m->elems);
     } else if (copy_value) {
         AVDictionaryEntry *tmp = av_realloc_array(m->elems,
                                                   m->count + 1, sizeof(*m->elems));
@@ -142,8 +243,13 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         m->elems[m->count].key = copy_key;
         m->elems[m->count].value = copy_value;
         m->count++;
+        if (m->hash && 2U * m->count <= m->hash_mask + 1)
+            hash_insert(m, m->count - 1);
+        else if (m->count >= HASH_MIN_COUNT)
+            hash_rebuild(m, m->count);
     } else {
         if (!m->count) {
+            av_freep(&m->hash);
             av_freep(&m->elems);
             av_freep(pm);
         }
@@ -156,6 +262,7 @@ enomem:
     err = AVERROR(ENOMEM);
 err_out:
     if (m && !m->count) {
+        av_freep(&m->hash);
         av_freep(&m->elems);
         av_freep(pm);
     }
@@ -230,6 +337,7 @@ void av_dict_free(AVDictionary **pm)
             av_freep(&m->elems[m->count].value);
         }
         av_freep(&m->elems);
+        av_freep(&m->hash);
     }
     av_freep(pm);
 }
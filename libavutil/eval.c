@@ -164,6 +164,8 @@ struct AVExpr {
         e_sqrt, e_not, e_random, e_hypot, e_gcd,
         e_if, e_ifnot, e_print, e_bitand, e_bitor, e_between, e_clip, e_atan2, e_lerp,
         e_sgn,
+        /* only used in compiled code */
+        e_scale, e_jump, e_jump_zero, e_jump_nonzero,
     } type;
     double value; // is sign in other types
     int const_index;
@@ -174,8 +176,29 @@ struct AVExpr {
     } a;
     struct AVExpr *param[3];
     double *var;
+    struct ExprInsn *code; ///< compiled form of the expression, or NULL
+    int nb_code;
 };
 
+/**
+ * One instruction of a compiled expression. Expressions are compiled into a
+ * flat postfix program running on a small value stack, which avoids the
+ * recursion and branch mispredictions of walking the tree, as expressions
+ * evaluated per pixel or per sample are run millions of times.
+ */
+typedef struct ExprInsn {
+    int type;          ///< node type, or one of the e_scale/e_jump* types
+    int arg;           ///< constant index or jump target
+    double value;      ///< value or sign, as in AVExpr
+    union {
+        double (*func0)(double);
+        double (*func1)(void *, double);
+        double (*func2)(void *, double, double);
+    } a;
+} ExprInsn;
+
+#define MAX_STACK 64
+
 static double etime(double v)
 {
     return av_gettime() * 0.000001;
@@ -340,6 +363,7 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    av_freep(&e->code);
     av_freep(&e);
 }
 
@@ -682,6 +706,263 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+/* Whether evaluating e more than once or not at all has no side effect. */
+static int is_pure(const AVExpr *e)
+{
+    switch (e->type) {
+    case e_func0:
+        if (e->a.func0 == etime)
+            return 0;
+        break;
+    case e_func1:
+    case e_func2:
+    case e_st:
+    case e_random:
+    case e_print:
+    case e_while:
+    case e_taylor:
+    case e_root:
+        return 0;
+    }
+    for (int i = 0; i < 3; i++)
+        if (e->param[i] && !is_pure(e->param[i]))
+            return 0;
+    return 1;
+}
+
+/* Replaces subexpressions that only depend on literal values by their
+ * value. */
+static void fold_constants(AVExpr *e)
+{
+    Parser p = { 0 };
+    double v;
+
+    for (int i = 0; i < 3; i++)
+        if (e->param[i])
+            fold_constants(e->param[i]);
+    for (int i = 0; i < 3; i++)
+        if (e->param[i] && e->param[i]->type != e_value)
+            return;
+    if (e->type == e_value || e->type == e_const || e->type == e_ld || !is_pure(e))
+        return;
+
+    p.class = &eval_class;
+    v = eval_expr(&p, e);
+    for (int i = 0; i < 3; i++)
+        av_expr_free(e->param[i]);
+    memset(e->param, 0, sizeof(e->param));
+    e->type  = e_value;
+    e->value = v;
+}
+
+typedef struct ExprCompiler {
+    ExprInsn *code;
+    int nb_code;
+    int size;
+    int sp, max_sp;
+} ExprCompiler;
+
+static ExprInsn *emit(ExprCompiler *c, int type, double value, int pop, int push)
+{
+    ExprInsn *in;
+
+    if (c->nb_code >= c->size) {
+        int size = FFMAX(2 * c->size, 16);
+        ExprInsn *code = av_realloc_array(c->code, size, sizeof(*code));
+        if (!code)
+            return NULL;
+        c->code = code;
+        c->size = size;
+    }
+    in = &c->code[c->nb_code++];
+    memset(in, 0, sizeof(*in));
+    in->type  = type;
+    in->value = value;
+    c->sp    += push - pop;
+    c->max_sp = FFMAX(c->max_sp, c->sp);
+    return in;
+}
+
+static int compile_expr(ExprCompiler *c, const AVExpr *e)
+{
+    ExprInsn *in;
+    int ret, jmp, jmp_end, nb_params = 0;
+
+    switch (e->type) {
+    case e_value:
+        return emit(c, e_value, e->value, 0, 1) ? 0 : AVERROR(ENOMEM);
+    case e_const:
+        if (!(in = emit(c, e_const, e->value, 0, 1)))
+            return AVERROR(ENOMEM);
+        in->arg = e->const_index;
+        return 0;
+    case e_if:
+    case e_ifnot:
+        if ((ret = compile_expr(c, e->param[0])) < 0)
+            return ret;
+        jmp = c->nb_code;
+        if (!emit(c, e->type == e_if ? e_jump_zero : e_jump_nonzero, 0, 1, 0))
+            return AVERROR(ENOMEM);
+        if ((ret = compile_expr(c, e->param[1])) < 0)
+            return ret;
+        jmp_end = c->nb_code;
+        if (!emit(c, e_jump, 0, 0, 0))
+            return AVERROR(ENOMEM);
+        c->code[jmp].arg = c->nb_code;
+        /* only one of the branches pushes its value */
+        c->sp--;
+        if (e->param[2])
+            ret = compile_expr(c, e->param[2]);
+        else
+            ret = emit(c, e_value, 0, 0, 1) ? 0 : AVERROR(ENOMEM);
+        if (ret < 0)
+            return ret;
+        c->code[jmp_end].arg = c->nb_code;
+        if (e->value != 1)
+            return emit(c, e_scale, e->value, 1, 1) ? 0 : AVERROR(ENOMEM);
+        return 0;
+    case e_clip:
+        /* the tree evaluates the first parameter twice, the second time
+         * after the bounds, which may change what it reads */
+        if (!is_pure(e->param[0]) || !is_pure(e->param[1]) || !is_pure(e->param[2]))
+            return AVERROR(ENOSYS);
+        break;
+    case e_between:
+        /* the tree may skip evaluating the last parameters */
+        if (!is_pure(e->param[1]) || !is_pure(e->param[2]))
+            return AVERROR(ENOSYS);
+        break;
+    case e_print:
+    case e_while:
+    case e_taylor:
+    case e_root:
+        return AVERROR(ENOSYS);
+    }
+
+    for (; nb_params < 3 && e->param[nb_params]; nb_params++)
+        if ((ret = compile_expr(c, e->param[nb_params])) < 0)
+            return ret;
+
+    if (!(in = emit(c, e->type, e->value, nb_params, 1)))
+        return AVERROR(ENOMEM);
+    if (e->type == e_func0)
+        in->a.func0 = e->a.func0;
+    else if (e->type == e_func1)
+        in->a.func1 = e->a.func1;
+    else if (e->type == e_func2)
+        in->a.func2 = e->a.func2;
+    return 0;
+}
+
+/* Compiles e, leaving it to be interpreted as a tree if some construct is
+ * not supported. */
+static int compile(AVExpr *e)
+{
+    ExprCompiler c = { 0 };
+    int ret = compile_expr(&c, e);
+
+    if (ret < 0 || c.max_sp > MAX_STACK) {
+        av_free(c.code);
+        return ret == AVERROR(ENOMEM) ? ret : 0;
+    }
+    e->code    = c.code;
+    e->nb_code = c.nb_code;
+    return 0;
+}
+
+static double eval_code(const AVExpr *e, const double *const_values, void *opaque)
+{
+    double stack[MAX_STACK], *sp = stack;
+    double *var = e->var;
+
+    for (const ExprInsn *in = e->code, *end = in + e->nb_code; in < end; in++) {
+        double d, d2;
+
+        switch (in->type) {
+        case e_value:  *sp++ = in->value; continue;
+        case e_const:  *sp++ = in->value * const_values[in->arg]; continue;
+        case e_scale:  sp[-1] *= in->value; continue;
+        case e_jump:   in = e->code + in->arg - 1; continue;
+        case e_jump_zero:
+            if (!*--sp)
+                in = e->code + in->arg - 1;
+            continue;
+        case e_jump_nonzero:
+            if (*--sp)
+                in = e->code + in->arg - 1;
+            continue;
+        case e_func0:  sp[-1] = in->value * in->a.func0(sp[-1]); continue;
+        case e_func1:  sp[-1] = in->value * in->a.func1(opaque, sp[-1]); continue;
+        case e_squish: sp[-1] = 1/(1+exp(4*sp[-1])); continue;
+        case e_gauss:  d = sp[-1]; sp[-1] = exp(-d*d/2)/sqrt(2*M_PI); continue;
+        case e_ld:     sp[-1] = in->value * var[av_clip(sp[-1], 0, VARS-1)]; continue;
+        case e_isnan:  sp[-1] = in->value * !!isnan(sp[-1]); continue;
+        case e_isinf:  sp[-1] = in->value * !!isinf(sp[-1]); continue;
+        case e_floor:  sp[-1] = in->value * floor(sp[-1]); continue;
+        case e_ceil:   sp[-1] = in->value * ceil (sp[-1]); continue;
+        case e_trunc:  sp[-1] = in->value * trunc(sp[-1]); continue;
+        case e_round:  sp[-1] = in->value * round(sp[-1]); continue;
+        case e_sgn:    sp[-1] = in->value * FFDIFFSIGN(sp[-1], 0); continue;
+        case e_sqrt:   sp[-1] = in->value * sqrt (sp[-1]); continue;
+        case e_not:    sp[-1] = in->value * (sp[-1] == 0); continue;
+        case e_random: {
+            int idx = av_clip(sp[-1], 0, VARS-1);
+            uint64_t r = isnan(var[idx]) ? 0 : var[idx];
+            r = r*1664525+1013904223;
+            var[idx] = r;
+            sp[-1] = in->value * (r * (1.0/UINT64_MAX));
+            continue;
+        }
+        case e_clip: {
+            double x = sp[-3], min = sp[-2], max = sp[-1];
+            sp -= 2;
+            if (isnan(min) || isnan(max) || isnan(x) || min > max)
+                sp[-1] = NAN;
+            else
+                sp[-1] = in->value * av_clipd(x, min, max);
+            continue;
+        }
+        case e_between:
+            d = sp[-3];
+            sp -= 2;
+            sp[-1] = in->value * (d >= sp[0] && d <= sp[1]);
+            continue;
+        case e_lerp:
+            sp -= 2;
+            sp[-1] = sp[-1] + (sp[0] - sp[-1]) * sp[1];
+            continue;
+        }
+
+        d2 = *--sp;
+        d  = sp[-1];
+        switch (in->type) {
+        case e_func2: d = in->value * in->a.func2(opaque, d, d2); break;
+        case e_mod:   d = in->value * (d - floor(d2 ? d / d2 : d * INFINITY) * d2); break;
+        case e_gcd:   d = in->value * av_gcd(d,d2); break;
+        case e_max:   d = in->value * (d >  d2 ?   d : d2); break;
+        case e_min:   d = in->value * (d <  d2 ?   d : d2); break;
+        case e_eq:    d = in->value * (d == d2 ? 1.0 : 0.0); break;
+        case e_gt:    d = in->value * (d >  d2 ? 1.0 : 0.0); break;
+        case e_gte:   d = in->value * (d >= d2 ? 1.0 : 0.0); break;
+        case e_lt:    d = in->value * (d <  d2 ? 1.0 : 0.0); break;
+        case e_lte:   d = in->value * (d <= d2 ? 1.0 : 0.0); break;
+        case e_pow:   d = in->value * pow(d, d2); break;
+        case e_mul:   d = in->value * (d * d2); break;
+        case e_div:   d = in->value * (d2 ? (d / d2) : d * INFINITY); break;
+        case e_add:   d = in->value * (d + d2); break;
+        case e_last:  d = in->value * d2; break;
+        case e_st :   d = in->value * (var[av_clip(d, 0, VARS-1)]= d2); break;
+        case e_hypot: d = in->value * hypot(d, d2); break;
+        case e_atan2: d = in->value * atan2(d, d2); break;
+        case e_bitand: d = isnan(d) || isnan(d2) ? NAN : in->value * ((long int)d & (long int)d2); break;
+        case e_bitor:  d = isnan(d) || isnan(d2) ? NAN : in->value * ((long int)d | (long int)d2); break;
+        default:      d = NAN;
+        }
+        sp[-1] = d;
+    }
+    return stack[0];
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -724,6 +1005,9 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(EINVAL);
         goto end;
     }
+    fold_constants(e);
+    if ((ret = compile(e)) < 0)
+        goto end;
     e->var= av_mallocz(sizeof(double) *VARS);
     if (!e->var) {
         ret = AVERROR(ENOMEM);
@@ -766,6 +1050,10 @@ int av_expr_count_func(AVExpr *e, unsigned *counter, int size, int arg)
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
     Parser p = { 0 };
+
+    if (e->code)
+        return eval_code(e, const_values, opaque);
+
     p.var= e->var;
 
     p.const_values = const_values;
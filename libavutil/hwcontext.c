@@ -163,6 +163,8 @@ AVBufferRef *av_hwdevice_ctx_alloc(enum AVHWDeviceType type)
     ctx->internal = av_mallocz(sizeof(*ctx->internal));
     if (!ctx->internal)
         goto fail;
+    atomic_init(&ctx->internal->frames_size, 0);
+    atomic_init(&ctx->internal->nb_frames,   0);
 
     if (hw_type->device_priv_size) {
         ctx->internal->priv = av_mallocz(hw_type->device_priv_size);
@@ -383,6 +385,42 @@ fail:
     return ret;
 }
 
+int av_hwframe_ctx_trim(AVBufferRef *ref)
+{
+    AVHWFramesContext *ctx = (AVHWFramesContext*)ref->data;
+
+    if (ctx->internal->source_frames)
+        return av_hwframe_ctx_trim(ctx->internal->source_frames);
+
+    if (!ctx->internal->hw_type->frames_trim ||
+        !ctx->internal->pool_internal || ctx->pool != ctx->internal->pool_internal)
+        return AVERROR(ENOSYS);
+
+    return ctx->internal->hw_type->frames_trim(ctx);
+}
+
+void ff_hwdevice_account_frame(AVHWDeviceContext *ctx, size_t size, int alloc)
+{
+    if (alloc) {
+        atomic_fetch_add_explicit(&ctx->internal->frames_size, size, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ctx->internal->nb_frames,   1,    memory_order_relaxed);
+    } else {
+        atomic_fetch_sub_explicit(&ctx->internal->frames_size, size, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&ctx->internal->nb_frames,   1,    memory_order_relaxed);
+    }
+}
+
+int av_hwdevice_get_frames_memory(AVBufferRef *ref, size_t *size, int *nb_frames)
+{
+    AVHWDeviceContext *ctx = (AVHWDeviceContext*)ref->data;
+
+    if (size)
+        *size = atomic_load_explicit(&ctx->internal->frames_size, memory_order_relaxed);
+    if (nb_frames)
+        *nb_frames = atomic_load_explicit(&ctx->internal->nb_frames, memory_order_relaxed);
+    return 0;
+}
+
 int av_hwframe_transfer_get_formats(AVBufferRef *hwframe_ref,
                                     enum AVHWFrameTransferDirection dir,
                                     enum AVPixelFormat **formats, int flags)
@@ -504,6 +542,96 @@ int av_hwframe_transfer_data(AVFrame *dst, const AVFrame *src, int flags)
     return 0;
 }
 
+struct AVHWFrameTransfer {
+    AVBufferRef *frames_ref;
+    void        *fence;
+
+    /* References keeping both frames alive until the transfer completes */
+    AVFrame *src;
+    AVFrame *dst;
+};
+
+static void transfer_free(AVHWFrameTransfer **transfer)
+{
+    AVHWFrameTransfer *t = *transfer;
+
+    av_buffer_unref(&t->frames_ref);
+    av_frame_free(&t->src);
+    av_frame_free(&t->dst);
+    av_freep(transfer);
+}
+
+int av_hwframe_transfer_data_async(AVFrame *dst, const AVFrame *src, int flags,
+                                   AVHWFrameTransfer **transfer)
+{
+    AVBufferRef *frames_ref;
+    AVHWFramesContext *ctx;
+    AVHWFrameTransfer *t;
+    int ret;
+
+    *transfer = NULL;
+
+    if (!dst->buf[0])
+        return AVERROR(EINVAL);
+
+    /* Only hw <-> sw transfers of refcounted frames can run asynchronously */
+    if (!src->buf[0] || !src->hw_frames_ctx == !dst->hw_frames_ctx)
+        return av_hwframe_transfer_data(dst, src, flags);
+
+    frames_ref = src->hw_frames_ctx ? src->hw_frames_ctx : dst->hw_frames_ctx;
+    ctx = (AVHWFramesContext*)frames_ref->data;
+
+    if (src->hw_frames_ctx ? !ctx->internal->hw_type->transfer_data_from_async :
+                             !ctx->internal->hw_type->transfer_data_to_async)
+        return av_hwframe_transfer_data(dst, src, flags);
+
+    t = av_mallocz(sizeof(*t));
+    if (!t)
+        return AVERROR(ENOMEM);
+
+    t->frames_ref = av_buffer_ref(frames_ref);
+    t->src        = av_frame_clone(src);
+    t->dst        = av_frame_clone(dst);
+    if (!t->frames_ref || !t->src || !t->dst) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    if (src->hw_frames_ctx)
+        ret = ctx->internal->hw_type->transfer_data_from_async(ctx, dst, src,
+                                                               &t->fence);
+    else
+        ret = ctx->internal->hw_type->transfer_data_to_async(ctx, dst, src,
+                                                             &t->fence);
+    if (ret < 0 || !t->fence)
+        goto fail;
+
+    *transfer = t;
+    return 0;
+
+fail:
+    transfer_free(&t);
+    return ret;
+}
+
+int av_hwframe_transfer_wait(AVHWFrameTransfer **transfer, int flags)
+{
+    AVHWFramesContext *ctx;
+    int ret;
+
+    if (!*transfer)
+        return 0;
+
+    ctx = (AVHWFramesContext*)(*transfer)->frames_ref->data;
+
+    ret = ctx->internal->hw_type->transfer_wait(ctx, (*transfer)->fence, flags);
+    if (ret == AVERROR(EAGAIN))
+        return ret;
+
+    transfer_free(transfer);
+    return ret;
+}
+
 int av_hwframe_get_buffer(AVBufferRef *hwframe_ref, AVFrame *frame, int flags)
 {
     AVHWFramesContext *ctx = (AVHWFramesContext*)hwframe_ref->data;
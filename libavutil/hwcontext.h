@@ -227,6 +227,19 @@ typedef struct AVHWFramesContext {
      * Must be set by the user before calling av_hwframe_ctx_init().
      */
     int width, height;
+
+    /**
+     * Maximum size of the frame pool, 0 for no limit.
+     *
+     * If larger than initial_pool_size, a pool of a device type which does not
+     * support dynamic pools may still grow up to this many frames when all
+     * its frames are in use, if the device type allows it (currently VAAPI).
+     * Otherwise such a pool keeps its initial size. Dynamic pools are limited
+     * to this many frames.
+     *
+     * May be set by the caller before calling av_hwframe_ctx_init().
+     */
+    int max_pool_size;
 } AVHWFramesContext;
 
 /**
@@ -370,6 +383,35 @@ AVBufferRef *av_hwframe_ctx_alloc(AVBufferRef *device_ctx);
  */
 int av_hwframe_ctx_init(AVBufferRef *ref);
 
+/**
+ * Free the unused frames held by the internal pool of a frames context, so
+ * that their memory is returned to the device. The pool grows again as frames
+ * are requested.
+ *
+ * This is only possible for the pools which can be resized dynamically,
+ * currently those of the CUDA and VAAPI device types, the latter only if
+ * initial_pool_size is 0.
+ *
+ * @param ref a reference to the AVHWFramesContext
+ * @return 0 on success, AVERROR(ENOSYS) if the pool cannot be trimmed
+ */
+int av_hwframe_ctx_trim(AVBufferRef *ref);
+
+/**
+ * Get the memory used by the frames allocated on a device, i.e. by the
+ * internal pools of all its frames contexts, including the unused frames kept
+ * in the pools. This can be used to decide how many sessions fit on a device.
+ *
+ * Only the frames of the CUDA and VAAPI device types are accounted. The size
+ * of VAAPI surfaces is estimated from their dimensions and software format.
+ *
+ * @param ref       a reference to the AVHWDeviceContext
+ * @param size      total size of the frames in bytes, may be NULL
+ * @param nb_frames number of frames, may be NULL
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_hwdevice_get_frames_memory(AVBufferRef *ref, size_t *size, int *nb_frames);
+
 /**
  * Allocate a new frame attached to the given AVHWFramesContext.
  *
@@ -412,6 +454,61 @@ int av_hwframe_get_buffer(AVBufferRef *hwframe_ctx, AVFrame *frame, int flags);
  */
 int av_hwframe_transfer_data(AVFrame *dst, const AVFrame *src, int flags);
 
+/**
+ * A transfer started by av_hwframe_transfer_data_async(). The structure is
+ * opaque.
+ */
+typedef struct AVHWFrameTransfer AVHWFrameTransfer;
+
+/**
+ * Flags to apply to av_hwframe_transfer_wait().
+ */
+enum {
+    /**
+     * Return AVERROR(EAGAIN) instead of blocking if the transfer has not
+     * completed yet.
+     */
+    AV_HWFRAME_TRANSFER_NONBLOCK = 1 << 0,
+};
+
+/**
+ * Start copying data to or from a hw surface, without waiting for the copy
+ * to complete. This allows e.g. downloading a frame while the previous one
+ * is being processed.
+ *
+ * The same rules as for av_hwframe_transfer_data() apply, except that dst
+ * must have its buffers allocated already. Until the transfer has completed,
+ * dst must not be read from and src must not be written to; both are
+ * referenced by the transfer, so they may be unreferenced by the caller.
+ *
+ * Device types which cannot transfer asynchronously complete the transfer
+ * before returning, as do transfers from frames which are not refcounted.
+ *
+ * @param dst the destination frame
+ * @param src the source frame
+ * @param flags currently unused, should be set to zero
+ * @param transfer set to the transfer, which must be passed to
+ *                 av_hwframe_transfer_wait(). Set to NULL if the transfer
+ *                 has completed already or on failure.
+ * @return 0 on success, a negative AVERROR error code on failure.
+ */
+int av_hwframe_transfer_data_async(AVFrame *dst, const AVFrame *src, int flags,
+                                   AVHWFrameTransfer **transfer);
+
+/**
+ * Wait for a transfer started by av_hwframe_transfer_data_async() to
+ * complete, and free it.
+ *
+ * @param transfer the transfer, set to NULL once it has completed. NULL
+ *                 is treated as a completed transfer.
+ * @param flags a combination of AV_HWFRAME_TRANSFER_* flags
+ * @return 0 once the transfer has completed, AVERROR(EAGAIN) if it has not
+ *         yet and AV_HWFRAME_TRANSFER_NONBLOCK was given, or a negative
+ *         AVERROR error code if the transfer failed, in which case it is
+ *         freed as well.
+ */
+int av_hwframe_transfer_wait(AVHWFrameTransfer **transfer, int flags);
+
 enum AVHWFrameTransferDirection {
     /**
      * Transfer the data from the queried hw frame.
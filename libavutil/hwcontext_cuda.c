@@ -17,6 +17,7 @@
  */
 
 #include "buffer.h"
+#include "buffer_internal.h"
 #include "common.h"
 #include "hwcontext.h"
 #include "hwcontext_internal.h"
@@ -33,6 +34,8 @@
 typedef struct CUDAFramesContext {
     int shift_width, shift_height;
     int tex_alignment;
+    int frame_size;
+    atomic_int nb_allocated;
 } CUDAFramesContext;
 
 static const enum AVPixelFormat supported_formats[] = {
@@ -80,6 +83,7 @@ static int cuda_frames_get_constraints(AVHWDeviceContext *ctx,
 static void cuda_buffer_free(void *opaque, uint8_t *data)
 {
     AVHWFramesContext        *ctx = opaque;
+    CUDAFramesContext       *priv = ctx->internal->priv;
     AVHWDeviceContext *device_ctx = ctx->device_ctx;
     AVCUDADeviceContext    *hwctx = device_ctx->hwctx;
     CudaFunctions             *cu = hwctx->internal->cuda_dl;
@@ -91,11 +95,15 @@ static void cuda_buffer_free(void *opaque, uint8_t *data)
     CHECK_CU(cu->cuMemFree((CUdeviceptr)data));
 
     CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+
+    atomic_fetch_sub_explicit(&priv->nb_allocated, 1, memory_order_relaxed);
+    ff_hwdevice_account_frame(device_ctx, priv->frame_size, 0);
 }
 
 static AVBufferRef *cuda_pool_alloc(void *opaque, size_t size)
 {
     AVHWFramesContext        *ctx = opaque;
+    CUDAFramesContext       *priv = ctx->internal->priv;
     AVHWDeviceContext *device_ctx = ctx->device_ctx;
     AVCUDADeviceContext    *hwctx = device_ctx->hwctx;
     CudaFunctions             *cu = hwctx->internal->cuda_dl;
@@ -105,6 +113,10 @@ static AVBufferRef *cuda_pool_alloc(void *opaque, size_t size)
     CUdeviceptr data;
     int err;
 
+    if (ctx->max_pool_size > 0 &&
+        atomic_load_explicit(&priv->nb_allocated, memory_order_relaxed) >= ctx->max_pool_size)
+        return NULL;
+
     err = CHECK_CU(cu->cuCtxPushCurrent(hwctx->cuda_ctx));
     if (err < 0)
         return NULL;
@@ -119,6 +131,9 @@ static AVBufferRef *cuda_pool_alloc(void *opaque, size_t size)
         goto fail;
     }
 
+    atomic_fetch_add_explicit(&priv->nb_allocated, 1, memory_order_relaxed);
+    ff_hwdevice_account_frame(device_ctx, size, 1);
+
 fail:
     CHECK_CU(cu->cuCtxPopCurrent(&dummy));
     return ret;
@@ -163,6 +178,9 @@ static int cuda_frames_init(AVHWFramesContext *ctx)
         if (size < 0)
             return size;
 
+        priv->frame_size = size;
+        atomic_init(&priv->nb_allocated, 0);
+
         ctx->internal->pool_internal = av_buffer_pool_init2(size, ctx, cuda_pool_alloc, NULL);
         if (!ctx->internal->pool_internal)
             return AVERROR(ENOMEM);
@@ -171,6 +189,12 @@ static int cuda_frames_init(AVHWFramesContext *ctx)
     return 0;
 }
 
+static int cuda_frames_trim(AVHWFramesContext *ctx)
+{
+    ff_buffer_pool_flush(ctx->internal->pool_internal);
+    return 0;
+}
+
 static int cuda_get_buffer(AVHWFramesContext *ctx, AVFrame *frame)
 {
     CUDAFramesContext *priv = ctx->internal->priv;
@@ -218,8 +242,8 @@ static int cuda_transfer_get_formats(AVHWFramesContext *ctx,
     return 0;
 }
 
-static int cuda_transfer_data(AVHWFramesContext *ctx, AVFrame *dst,
-                                 const AVFrame *src)
+static int cuda_transfer_data_async(AVHWFramesContext *ctx, AVFrame *dst,
+                                    const AVFrame *src, void **fence)
 {
     CUDAFramesContext       *priv = ctx->internal->priv;
     AVHWDeviceContext *device_ctx = ctx->device_ctx;
@@ -266,10 +290,25 @@ static int cuda_transfer_data(AVHWFramesContext *ctx, AVFrame *dst,
             goto exit;
     }
 
+    /* Uploads are ordered with later work on the stream, downloads have to
+     * be waited for before the data can be read */
     if (!dst->hw_frames_ctx) {
-        ret = CHECK_CU(cu->cuStreamSynchronize(hwctx->stream));
-        if (ret < 0)
-            goto exit;
+        if (fence) {
+            CUevent event;
+            ret = CHECK_CU(cu->cuEventCreate(&event, CU_EVENT_DISABLE_TIMING));
+            if (ret < 0)
+                goto exit;
+            ret = CHECK_CU(cu->cuEventRecord(event, hwctx->stream));
+            if (ret < 0) {
+                CHECK_CU(cu->cuEventDestroy(event));
+                goto exit;
+            }
+            *fence = event;
+        } else {
+            ret = CHECK_CU(cu->cuStreamSynchronize(hwctx->stream));
+            if (ret < 0)
+                goto exit;
+        }
     }
 
 exit:
@@ -278,6 +317,40 @@ exit:
     return 0;
 }
 
+static int cuda_transfer_data(AVHWFramesContext *ctx, AVFrame *dst,
+                              const AVFrame *src)
+{
+    return cuda_transfer_data_async(ctx, dst, src, NULL);
+}
+
+static int cuda_transfer_wait(AVHWFramesContext *ctx, void *fence, int flags)
+{
+    AVHWDeviceContext *device_ctx = ctx->device_ctx;
+    AVCUDADeviceContext    *hwctx = device_ctx->hwctx;
+    CudaFunctions             *cu = hwctx->internal->cuda_dl;
+    CUevent event = fence;
+    CUcontext dummy;
+    int ret;
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(hwctx->cuda_ctx));
+    if (ret < 0)
+        return ret;
+
+    if ((flags & AV_HWFRAME_TRANSFER_NONBLOCK) &&
+        cu->cuEventQuery(event) == CUDA_ERROR_NOT_READY) {
+        ret = AVERROR(EAGAIN);
+        goto exit;
+    }
+
+    ret = CHECK_CU(cu->cuEventSynchronize(event));
+    CHECK_CU(cu->cuEventDestroy(event));
+
+exit:
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+
+    return ret;
+}
+
 static void cuda_device_uninit(AVHWDeviceContext *device_ctx)
 {
     AVCUDADeviceContext *hwctx = device_ctx->hwctx;
@@ -543,10 +616,14 @@ const HWContextType ff_hwcontext_type_cuda = {
     .device_uninit        = cuda_device_uninit,
     .frames_get_constraints = cuda_frames_get_constraints,
     .frames_init          = cuda_frames_init,
+    .frames_trim          = cuda_frames_trim,
     .frames_get_buffer    = cuda_get_buffer,
     .transfer_get_formats = cuda_transfer_get_formats,
     .transfer_data_to     = cuda_transfer_data,
     .transfer_data_from   = cuda_transfer_data,
+    .transfer_data_to_async   = cuda_transfer_data_async,
+    .transfer_data_from_async = cuda_transfer_data_async,
+    .transfer_wait        = cuda_transfer_wait,
 
     .pix_fmts             = (const enum AVPixelFormat[]){ AV_PIX_FMT_CUDA, AV_PIX_FMT_NONE },
 };
@@ -19,6 +19,7 @@
 #ifndef AVUTIL_HWCONTEXT_INTERNAL_H
 #define AVUTIL_HWCONTEXT_INTERNAL_H
 
+#include <stdatomic.h>
 #include <stddef.h>
 
 #include "buffer.h"
@@ -79,6 +80,7 @@ typedef struct HWContextType {
 
     int              (*frames_init)(AVHWFramesContext *ctx);
     void             (*frames_uninit)(AVHWFramesContext *ctx);
+    int              (*frames_trim)(AVHWFramesContext *ctx);
 
     int              (*frames_get_buffer)(AVHWFramesContext *ctx, AVFrame *frame);
     int              (*transfer_get_formats)(AVHWFramesContext *ctx,
@@ -89,6 +91,20 @@ typedef struct HWContextType {
     int              (*transfer_data_from)(AVHWFramesContext *ctx, AVFrame *dst,
                                            const AVFrame *src);
 
+    /**
+     * Asynchronous variants of the above. fence is set to an opaque handle
+     * passed to transfer_wait(), or to NULL if the transfer has completed.
+     */
+    int              (*transfer_data_to_async)(AVHWFramesContext *ctx, AVFrame *dst,
+                                               const AVFrame *src, void **fence);
+    int              (*transfer_data_from_async)(AVHWFramesContext *ctx, AVFrame *dst,
+                                                 const AVFrame *src, void **fence);
+    /**
+     * Wait for a fence to signal, with AV_HWFRAME_TRANSFER_* flags.
+     * Unless AVERROR(EAGAIN) is returned, the fence is freed.
+     */
+    int              (*transfer_wait)(AVHWFramesContext *ctx, void *fence, int flags);
+
     int              (*map_to)(AVHWFramesContext *ctx, AVFrame *dst,
                                const AVFrame *src, int flags);
     int              (*map_from)(AVHWFramesContext *ctx, AVFrame *dst,
@@ -109,6 +125,13 @@ struct AVHWDeviceInternal {
      * context it was derived from.
      */
     AVBufferRef *source_device;
+
+    /**
+     * Memory used by the frames allocated on the device, see
+     * ff_hwdevice_account_frame().
+     */
+    atomic_size_t frames_size;
+    atomic_int    nb_frames;
 };
 
 struct AVHWFramesInternal {
@@ -163,6 +186,12 @@ int ff_hwframe_map_create(AVBufferRef *hwframe_ref,
  */
 int ff_hwframe_map_replace(AVFrame *dst, const AVFrame *src);
 
+/**
+ * Account for a frame of size bytes allocated (if alloc is 1) or freed (if
+ * alloc is 0) on the device, see av_hwdevice_get_frames_memory().
+ */
+void ff_hwdevice_account_frame(AVHWDeviceContext *ctx, size_t size, int alloc);
+
 extern const HWContextType ff_hwcontext_type_cuda;
 extern const HWContextType ff_hwcontext_type_d3d11va;
 extern const HWContextType ff_hwcontext_type_drm;
@@ -42,11 +42,13 @@
 
 #include "avassert.h"
 #include "buffer.h"
+#include "buffer_internal.h"
 #include "common.h"
 #include "hwcontext.h"
 #include "hwcontext_drm.h"
 #include "hwcontext_internal.h"
 #include "hwcontext_vaapi.h"
+#include "imgutils.h"
 #include "mem.h"
 #include "pixdesc.h"
 #include "pixfmt.h"
@@ -82,6 +84,12 @@ typedef struct VAAPIFramesContext {
     // Caches whether VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2 is unsupported for
     // surface imports.
     int prime_2_import_unsupported;
+    // Maximum number of surfaces in the pool, 0 if unlimited.
+    int max_surfaces;
+    // Number of surfaces currently allocated by the pool.
+    atomic_int nb_allocated;
+    // Estimated size of a surface, for the memory accounting of the device.
+    size_t surface_size;
 } VAAPIFramesContext;
 
 typedef struct VAAPIMapping {
@@ -473,6 +481,7 @@ static void vaapi_device_uninit(AVHWDeviceContext *hwdev)
 static void vaapi_buffer_free(void *opaque, uint8_t *data)
 {
     AVHWFramesContext     *hwfc = opaque;
+    VAAPIFramesContext     *ctx = hwfc->internal->priv;
     AVVAAPIDeviceContext *hwctx = hwfc->device_ctx->hwctx;
     VASurfaceID surface_id;
     VAStatus vas;
@@ -484,6 +493,9 @@ static void vaapi_buffer_free(void *opaque, uint8_t *data)
         av_log(hwfc, AV_LOG_ERROR, "Failed to destroy surface %#x: "
                "%d (%s).\n", surface_id, vas, vaErrorStr(vas));
     }
+
+    atomic_fetch_sub_explicit(&ctx->nb_allocated, 1, memory_order_relaxed);
+    ff_hwdevice_account_frame(hwfc->device_ctx, ctx->surface_size, 0);
 }
 
 static AVBufferRef *vaapi_pool_alloc(void *opaque, size_t size)
@@ -496,8 +508,8 @@ static AVBufferRef *vaapi_pool_alloc(void *opaque, size_t size)
     VAStatus vas;
     AVBufferRef *ref;
 
-    if (hwfc->initial_pool_size > 0 &&
-        avfc->nb_surfaces >= hwfc->initial_pool_size)
+    if (ctx->max_surfaces > 0 &&
+        atomic_load_explicit(&ctx->nb_allocated, memory_order_relaxed) >= ctx->max_surfaces)
         return NULL;
 
     vas = vaCreateSurfaces(hwctx->display, ctx->rt_format,
@@ -521,12 +533,16 @@ static AVBufferRef *vaapi_pool_alloc(void *opaque, size_t size)
 
     if (hwfc->initial_pool_size > 0) {
         // This is a fixed-size pool, so we must still be in the initial
-        // allocation sequence.
-        av_assert0(avfc->nb_surfaces < hwfc->initial_pool_size);
+        // allocation sequence, or growing it up to its maximum size.
+        // Surfaces are never freed before the pool is.
+        av_assert0(avfc->nb_surfaces < ctx->max_surfaces);
         avfc->surface_ids[avfc->nb_surfaces] = surface_id;
         ++avfc->nb_surfaces;
     }
 
+    atomic_fetch_add_explicit(&ctx->nb_allocated, 1, memory_order_relaxed);
+    ff_hwdevice_account_frame(hwfc->device_ctx, ctx->surface_size, 1);
+
     return ref;
 }
 
@@ -596,12 +612,21 @@ static int vaapi_frames_init(AVHWFramesContext *hwfc)
 
         ctx->rt_format = desc->rt_format;
 
+        err = av_image_get_buffer_size(hwfc->sw_format, hwfc->width,
+                                       hwfc->height, 1);
+        ctx->surface_size = FFMAX(err, 0);
+        atomic_init(&ctx->nb_allocated, 0);
+
         if (hwfc->initial_pool_size > 0) {
             // This pool will be usable as a render target, so we need to store
             // all of the surface IDs somewhere that vaCreateContext() calls
-            // will be able to access them.
+            // will be able to access them. It may grow up to max_pool_size,
+            // the surfaces created after a vaCreateContext() call are then not
+            // part of its render targets.
+            ctx->max_surfaces = FFMAX(hwfc->initial_pool_size,
+                                      hwfc->max_pool_size);
             avfc->nb_surfaces = 0;
-            avfc->surface_ids = av_malloc(hwfc->initial_pool_size *
+            avfc->surface_ids = av_malloc(ctx->max_surfaces *
                                           sizeof(*avfc->surface_ids));
             if (!avfc->surface_ids) {
                 err = AVERROR(ENOMEM);
@@ -610,6 +635,7 @@ static int vaapi_frames_init(AVHWFramesContext *hwfc)
         } else {
             // This pool allows dynamic sizing, and will not be usable as a
             // render target.
+            ctx->max_surfaces = hwfc->max_pool_size;
             avfc->nb_surfaces = 0;
             avfc->surface_ids = NULL;
         }
@@ -691,6 +717,16 @@ static void vaapi_frames_uninit(AVHWFramesContext *hwfc)
     av_freep(&ctx->attributes);
 }
 
+static int vaapi_frames_trim(AVHWFramesContext *hwfc)
+{
+    // The surfaces of a fixed-size pool may be render targets.
+    if (hwfc->initial_pool_size > 0)
+        return AVERROR(ENOSYS);
+
+    ff_buffer_pool_flush(hwfc->internal->pool_internal);
+    return 0;
+}
+
 static int vaapi_get_buffer(AVHWFramesContext *hwfc, AVFrame *frame)
 {
     frame->buf[0] = av_buffer_pool_get(hwfc->pool);
@@ -1923,6 +1959,7 @@ const HWContextType ff_hwcontext_type_vaapi = {
     .frames_get_constraints = &vaapi_frames_get_constraints,
     .frames_init            = &vaapi_frames_init,
     .frames_uninit          = &vaapi_frames_uninit,
+    .frames_trim            = &vaapi_frames_trim,
     .frames_get_buffer      = &vaapi_get_buffer,
     .transfer_get_formats   = &vaapi_transfer_get_formats,
     .transfer_data_to       = &vaapi_transfer_data_to,
@@ -96,7 +96,9 @@ typedef struct AVVAAPIFramesContext {
      * The surfaces IDs of all surfaces in the pool after creation.
      * Only valid if AVHWFramesContext.initial_pool_size was positive.
      * These are intended to be used as the render_targets arguments to
-     * vaCreateContext().
+     * vaCreateContext(). If AVHWFramesContext.max_pool_size is larger than
+     * initial_pool_size, surfaces created when the pool grows are appended
+     * to the array, which is allocated for max_pool_size surfaces.
      */
     VASurfaceID     *surface_ids;
     int           nb_surfaces;
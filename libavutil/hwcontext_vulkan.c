@@ -42,6 +42,7 @@
 #include "vulkan_loader.h"
 
 #if CONFIG_LIBDRM
+#include <sys/stat.h>
 #include <xf86drm.h>
 #include <drm_fourcc.h>
 #include "hwcontext_drm.h"
@@ -113,6 +114,28 @@ typedef struct VulkanDevicePriv {
     int dev_is_intel;
 } VulkanDevicePriv;
 
+#if CONFIG_LIBDRM
+#define DRM_IMPORT_CACHE_SIZE  32
+#define DRM_IMPORT_MAX_PENDING 2
+
+typedef struct VulkanDRMImport {
+    AVVkFrame *f;
+
+    /* What the frame was imported from, the object fds are not kept */
+    AVDRMFrameDescriptor desc;
+    ino_t ino[AV_DRM_MAX_PLANES];
+    int width, height;
+
+    int in_use;
+    uint64_t last_use;
+
+    /* Source of the last mapping, released once the semaphores reach
+     * src_sem_value, i.e. once the GPU is done reading from it */
+    AVFrame *src;
+    uint64_t src_sem_value[AV_NUM_DATA_POINTERS];
+} VulkanDRMImport;
+#endif
+
 typedef struct VulkanFramesPriv {
     /* Image conversions */
     VulkanExecCtx conv_ctx;
@@ -123,6 +146,14 @@ typedef struct VulkanFramesPriv {
 
     /* Modifier info list to free at uninit */
     VkImageDrmFormatModifierListCreateInfoEXT *modifier_info;
+
+#if CONFIG_LIBDRM
+    /* Importing DMA-BUFs is expensive, and decoders cycle through a small
+     * pool of surfaces, so imports are kept around and reused */
+    VulkanDRMImport imports[DRM_IMPORT_CACHE_SIZE];
+    int nb_imports;
+    uint64_t nb_maps;
+#endif
 } VulkanFramesPriv;
 
 typedef struct AVVkFrameInternal {
@@ -2257,10 +2288,84 @@ fail:
     return NULL;
 }
 
+#if CONFIG_LIBDRM
+static VkResult drm_frame_wait(AVHWFramesContext *hwfc, AVVkFrame *f,
+                               const uint64_t *values, uint64_t timeout)
+{
+    AVVulkanDeviceContext *hwctx = hwfc->device_ctx->hwctx;
+    VulkanDevicePriv *p = hwfc->device_ctx->internal->priv;
+    FFVulkanFunctions *vk = &p->vkfn;
+
+    VkSemaphoreWaitInfo wait_info = {
+        .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .flags          = 0x0,
+        .pSemaphores    = f->sem,
+        .pValues        = values,
+        .semaphoreCount = av_pix_fmt_count_planes(hwfc->sw_format),
+    };
+
+    return vk->WaitSemaphores(hwctx->act_dev, &wait_info, timeout);
+}
+
+static void drm_frame_free(AVHWFramesContext *hwfc, AVVkFrame *f)
+{
+    AVVulkanDeviceContext *hwctx = hwfc->device_ctx->hwctx;
+    const int planes = av_pix_fmt_count_planes(hwfc->sw_format);
+    VulkanDevicePriv *p = hwfc->device_ctx->internal->priv;
+    FFVulkanFunctions *vk = &p->vkfn;
+
+    drm_frame_wait(hwfc, f, f->sem_value, UINT64_MAX);
+
+    vulkan_free_internal(f);
+
+    for (int i = 0; i < planes; i++) {
+        vk->DestroyImage(hwctx->act_dev, f->img[i], hwctx->alloc);
+        vk->FreeMemory(hwctx->act_dev, f->mem[i], hwctx->alloc);
+        vk->DestroySemaphore(hwctx->act_dev, f->sem[i], hwctx->alloc);
+    }
+
+    av_free(f);
+}
+
+/* Returns 1 if the source frame of the import was released */
+static int drm_import_release_src(AVHWFramesContext *hwfc,
+                                  VulkanDRMImport *imp, int wait)
+{
+    VkResult ret;
+
+    if (!imp->src)
+        return 0;
+
+    ret = drm_frame_wait(hwfc, imp->f, imp->src_sem_value,
+                         wait ? UINT64_MAX : 0);
+    if (ret == VK_TIMEOUT && !wait)
+        return 0;
+
+    av_frame_free(&imp->src);
+    return 1;
+}
+
+static void drm_import_cache_uninit(AVHWFramesContext *hwfc)
+{
+    VulkanFramesPriv *fp = hwfc->internal->priv;
+
+    /* Mapped frames reference the frames context, so none are in use */
+    for (int i = 0; i < fp->nb_imports; i++) {
+        drm_import_release_src(hwfc, &fp->imports[i], 1);
+        drm_frame_free(hwfc, fp->imports[i].f);
+    }
+    fp->nb_imports = 0;
+}
+#endif
+
 static void vulkan_frames_uninit(AVHWFramesContext *hwfc)
 {
     VulkanFramesPriv *fp = hwfc->internal->priv;
 
+#if CONFIG_LIBDRM
+    drm_import_cache_uninit(hwfc);
+#endif
+
     if (fp->modifier_info) {
         if (fp->modifier_info->pDrmFormatModifiers)
             av_freep(&fp->modifier_info->pDrmFormatModifiers);
@@ -2592,31 +2697,43 @@ fail:
 #if CONFIG_LIBDRM
 static void vulkan_unmap_from_drm(AVHWFramesContext *hwfc, HWMapDescriptor *hwmap)
 {
-    AVVkFrame *f = hwmap->priv;
-    AVVulkanDeviceContext *hwctx = hwfc->device_ctx->hwctx;
-    const int planes = av_pix_fmt_count_planes(hwfc->sw_format);
-    VulkanDevicePriv *p = hwfc->device_ctx->internal->priv;
-    FFVulkanFunctions *vk = &p->vkfn;
-
-    VkSemaphoreWaitInfo wait_info = {
-        .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
-        .flags          = 0x0,
-        .pSemaphores    = f->sem,
-        .pValues        = f->sem_value,
-        .semaphoreCount = planes,
-    };
-
-    vk->WaitSemaphores(hwctx->act_dev, &wait_info, UINT64_MAX);
-
-    vulkan_free_internal(f);
+    drm_frame_free(hwfc, hwmap->priv);
+}
 
-    for (int i = 0; i < planes; i++) {
-        vk->DestroyImage(hwctx->act_dev, f->img[i], hwctx->alloc);
-        vk->FreeMemory(hwctx->act_dev, f->mem[i], hwctx->alloc);
-        vk->DestroySemaphore(hwctx->act_dev, f->sem[i], hwctx->alloc);
+static void vulkan_unmap_from_drm_cached(AVHWFramesContext *hwfc,
+                                         HWMapDescriptor *hwmap)
+{
+    VulkanFramesPriv *fp = hwfc->internal->priv;
+    VulkanDRMImport *imp = hwmap->priv;
+    VulkanDRMImport *oldest = NULL;
+    const int planes = av_pix_fmt_count_planes(hwfc->sw_format);
+    int pending = 0;
+
+    /* Instead of waiting for the GPU to finish reading from the image,
+     * keep the source alive until it has. Any older source of this import
+     * is covered by the newer semaphore values. */
+    av_frame_free(&imp->src);
+    imp->src = av_frame_clone(hwmap->source);
+    if (imp->src)
+        memcpy(imp->src_sem_value, imp->f->sem_value,
+               planes*sizeof(*imp->src_sem_value));
+    else
+        drm_frame_wait(hwfc, imp->f, imp->f->sem_value, UINT64_MAX);
+
+    imp->in_use = 0;
+
+    /* Decoders usually have a fixed pool of surfaces, so do not hold on to
+     * too many of them */
+    for (int i = 0; i < fp->nb_imports; i++) {
+        VulkanDRMImport *e = &fp->imports[i];
+        if (e->src && !drm_import_release_src(hwfc, e, 0)) {
+            pending++;
+            if (!oldest || e->last_use < oldest->last_use)
+                oldest = e;
+        }
     }
-
-    av_free(f);
+    if (pending > DRM_IMPORT_MAX_PENDING)
+        drm_import_release_src(hwfc, oldest, 1);
 }
 
 static const struct {
@@ -2925,22 +3042,133 @@ fail:
     return err;
 }
 
+static int drm_import_match(const VulkanDRMImport *imp,
+                            const AVDRMFrameDescriptor *desc,
+                            const ino_t *ino, int width, int height)
+{
+    const AVDRMFrameDescriptor *ref = &imp->desc;
+
+    if (imp->width != width || imp->height != height ||
+        ref->nb_objects != desc->nb_objects ||
+        ref->nb_layers  != desc->nb_layers)
+        return 0;
+
+    for (int i = 0; i < desc->nb_objects; i++)
+        if (imp->ino[i] != ino[i] ||
+            ref->objects[i].size            != desc->objects[i].size ||
+            ref->objects[i].format_modifier != desc->objects[i].format_modifier)
+            return 0;
+
+    for (int i = 0; i < desc->nb_layers; i++) {
+        if (ref->layers[i].format    != desc->layers[i].format ||
+            ref->layers[i].nb_planes != desc->layers[i].nb_planes)
+            return 0;
+        for (int j = 0; j < desc->layers[i].nb_planes; j++)
+            if (ref->layers[i].planes[j].object_index != desc->layers[i].planes[j].object_index ||
+                ref->layers[i].planes[j].offset       != desc->layers[i].planes[j].offset ||
+                ref->layers[i].planes[j].pitch        != desc->layers[i].planes[j].pitch)
+                return 0;
+    }
+
+    return 1;
+}
+
+/* Finds the import of the buffers of src, or a free slot to import them
+ * into, in which case ->f is NULL. Returns NULL if nothing can be cached. */
+static VulkanDRMImport *drm_import_get(AVHWFramesContext *hwfc,
+                                       const AVFrame *src)
+{
+    VulkanFramesPriv *fp = hwfc->internal->priv;
+    const AVDRMFrameDescriptor *desc = (AVDRMFrameDescriptor *)src->data[0];
+    VulkanDRMImport *imp = NULL;
+    ino_t ino[AV_DRM_MAX_PLANES];
+
+    /* A DMA-BUF keeps its inode for as long as it exists, and the import
+     * keeps it from being destroyed */
+    for (int i = 0; i < desc->nb_objects; i++) {
+        struct stat st;
+        if (fstat(desc->objects[i].fd, &st) < 0)
+            return NULL;
+        ino[i] = st.st_ino;
+    }
+
+    for (int i = 0; i < fp->nb_imports; i++) {
+        VulkanDRMImport *e = &fp->imports[i];
+        if (!e->in_use && drm_import_match(e, desc, ino, src->width, src->height)) {
+            imp = e;
+            break;
+        }
+    }
+
+    if (!imp) {
+        if (fp->nb_imports < DRM_IMPORT_CACHE_SIZE) {
+            imp = &fp->imports[fp->nb_imports++];
+        } else {
+            /* Evict the least recently used import */
+            for (int i = 0; i < fp->nb_imports; i++) {
+                VulkanDRMImport *e = &fp->imports[i];
+                if (!e->in_use && (!imp || e->last_use < imp->last_use))
+                    imp = e;
+            }
+            if (!imp)
+                return NULL;
+
+            drm_import_release_src(hwfc, imp, 1);
+            drm_frame_free(hwfc, imp->f);
+        }
+
+        memset(imp, 0, sizeof(*imp));
+        imp->desc   = *desc;
+        imp->width  = src->width;
+        imp->height = src->height;
+        memcpy(imp->ino, ino, desc->nb_objects*sizeof(*ino));
+    }
+
+    imp->in_use   = 1;
+    imp->last_use = fp->nb_maps++;
+
+    return imp;
+}
+
 static int vulkan_map_from_drm(AVHWFramesContext *hwfc, AVFrame *dst,
                                const AVFrame *src, int flags)
 {
     int err = 0;
     AVVkFrame *f;
+    VulkanFramesPriv *fp = hwfc->internal->priv;
+    VulkanDRMImport *imp = drm_import_get(hwfc, src);
 
-    if ((err = vulkan_map_from_drm_frame_desc(hwfc, &f, src)))
-        return err;
+    if (imp && imp->f) {
+        /* Already imported, only the ownership has to be acquired again */
+        f = imp->f;
+        err = prepare_frame(hwfc, &fp->conv_ctx, f, PREP_MODE_EXTERNAL_IMPORT);
+        if (err) {
+            imp->in_use = 0;
+            return err;
+        }
+    } else {
+        err = vulkan_map_from_drm_frame_desc(hwfc, &f, src);
+        if (err) {
+            /* Give the slot back */
+            if (imp)
+                *imp = fp->imports[--fp->nb_imports];
+            return err;
+        }
+        if (imp)
+            imp->f = f;
+    }
 
-    /* The unmapping function will free this */
+    /* The unmapping function will free or release this */
     dst->data[0] = (uint8_t *)f;
     dst->width   = src->width;
     dst->height  = src->height;
 
-    err = ff_hwframe_map_create(dst->hw_frames_ctx, dst, src,
-                                &vulkan_unmap_from_drm, f);
+    if (imp)
+        err = ff_hwframe_map_create(dst->hw_frames_ctx, dst, src,
+                                    &vulkan_unmap_from_drm_cached, imp);
+    else
+        err = ff_hwframe_map_create(dst->hw_frames_ctx, dst, src,
+                                    &vulkan_unmap_from_drm, f);
     if (err < 0)
         goto fail;
 
@@ -2949,7 +3177,10 @@ static int vulkan_map_from_drm(AVHWFramesContext *hwfc, AVFrame *dst,
     return 0;
 
 fail:
-    vulkan_frame_free(hwfc->device_ctx->hwctx, (uint8_t *)f);
+    if (imp)
+        imp->in_use = 0;
+    else
+        drm_frame_free(hwfc, f);
     dst->data[0] = NULL;
     return err;
 }
@@ -3705,7 +3936,8 @@ static int unmap_buffers(AVHWDeviceContext *ctx, AVBufferRef **bufs,
 static int transfer_image_buf(AVHWFramesContext *hwfc, const AVFrame *f,
                               AVBufferRef **bufs, size_t *buf_offsets,
                               const int *buf_stride, int w,
-                              int h, enum AVPixelFormat pix_fmt, int to_buf)
+                              int h, enum AVPixelFormat pix_fmt, int to_buf,
+                              int wait)
 {
     int err;
     AVVkFrame *frame = (AVVkFrame *)f->data[0];
@@ -3814,8 +4046,8 @@ static int transfer_image_buf(AVHWFramesContext *hwfc, const AVFrame *f,
      * keeping the buffers as a submission dependency.
      * The hwcontext is guaranteed to not be freed until all frames are freed
      * in the frames_unint function.
-     * When downloading to buffer, do this synchronously and wait for the
-     * queue submission to finish executing */
+     * When downloading to buffer, wait for the queue submission to finish
+     * executing, unless the caller waits on the frame semaphores instead */
     if (!to_buf) {
         int ref;
         for (ref = 0; ref < AV_NUM_DATA_POINTERS; ref++) {
@@ -3827,13 +4059,61 @@ static int transfer_image_buf(AVHWFramesContext *hwfc, const AVFrame *f,
         if (ref && (err = add_buf_dep_exec_ctx(hwfc, ectx, bufs, planes)))
             return err;
         return submit_exec_ctx(hwfc, ectx, &s_info, frame, !ref);
+    } else if (!wait) {
+        if ((err = add_buf_dep_exec_ctx(hwfc, ectx, bufs, planes)))
+            return err;
+        return submit_exec_ctx(hwfc, ectx, &s_info, frame,    0);
     } else {
         return submit_exec_ctx(hwfc, ectx, &s_info, frame,    1);
     }
 }
 
+typedef struct VulkanTransferFence {
+    AVVkFrame *f;
+    uint64_t sem_value[AV_NUM_DATA_POINTERS];
+    int nb_sems;
+
+    /* Staging buffers to copy to the destination once signalled */
+    AVBufferRef *bufs[AV_NUM_DATA_POINTERS];
+    int buf_linesize[AV_NUM_DATA_POINTERS];
+    int host_mapped[AV_NUM_DATA_POINTERS];
+
+    uint8_t *data[AV_NUM_DATA_POINTERS];
+    int linesize[AV_NUM_DATA_POINTERS];
+    enum AVPixelFormat format;
+    int width, height;
+} VulkanTransferFence;
+
+static int copy_from_buffers(AVHWDeviceContext *dev_ctx, AVBufferRef **bufs,
+                             const int *buf_linesize, const int *host_mapped,
+                             uint8_t * const *data, const int *linesize,
+                             enum AVPixelFormat format, int w, int h)
+{
+    int err, p_w, p_h;
+    uint8_t *mem[AV_NUM_DATA_POINTERS];
+    const int planes = av_pix_fmt_count_planes(format);
+
+    /* Map, copy buffer (which came FROM the VkImage) to the frame, unmap */
+    if ((err = map_buffers(dev_ctx, bufs, mem, planes, 0)))
+        return err;
+
+    for (int i = 0; i < planes; i++) {
+        if (host_mapped[i])
+            continue;
+
+        get_plane_wh(&p_w, &p_h, format, w, h, i);
+
+        av_image_copy_plane_uc_from(data[i], linesize[i],
+                                    (const uint8_t *)mem[i], buf_linesize[i],
+                                    FFMIN(buf_linesize[i], FFABS(linesize[i])),
+                                    p_h);
+    }
+
+    return unmap_buffers(dev_ctx, bufs, planes, 1);
+}
+
 static int vulkan_transfer_data(AVHWFramesContext *hwfc, const AVFrame *vkf,
-                                const AVFrame *swf, int from)
+                                const AVFrame *swf, int from, void **fence)
 {
     int err = 0;
     VkResult ret;
@@ -3959,29 +4239,49 @@ static int vulkan_transfer_data(AVHWFramesContext *hwfc, const AVFrame *vkf,
 
     /* Copy buffers into/from image */
     err = transfer_image_buf(hwfc, vkf, bufs, buf_offsets, tmp.linesize,
-                             swf->width, swf->height, swf->format, from);
-
-    if (from) {
-        /* Map, copy buffer (which came FROM the VkImage) to the frame, unmap */
-        if ((err = map_buffers(dev_ctx, bufs, tmp.data, planes, 0)))
-            goto end;
-
-        for (int i = 0; i < planes; i++) {
-            if (host_mapped[i])
-                continue;
+                             swf->width, swf->height, swf->format, from,
+                             !fence);
+    if (err)
+        goto end;
 
-            get_plane_wh(&p_w, &p_h, swf->format, swf->width, swf->height, i);
+    if (from && fence) {
+        /* The copy to the frame is done once the download has completed */
+        VulkanTransferFence *vf = av_mallocz(sizeof(*vf));
+        if (!vf) {
+            VkSemaphoreWaitInfo wait_info = {
+                .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                .pSemaphores    = f->sem,
+                .pValues        = f->sem_value,
+                .semaphoreCount = planes,
+            };
+            /* Finish the transfer synchronously instead */
+            vk->WaitSemaphores(hwctx->act_dev, &wait_info, UINT64_MAX);
+        } else {
+            vf->f       = f;
+            vf->nb_sems = planes;
+            vf->format  = swf->format;
+            vf->width   = swf->width;
+            vf->height  = swf->height;
+            for (int i = 0; i < planes; i++) {
+                vf->sem_value[i]    = f->sem_value[i];
+                vf->bufs[i]         = bufs[i];
+                vf->buf_linesize[i] = tmp.linesize[i];
+                vf->host_mapped[i]  = host_mapped[i];
+                vf->data[i]         = swf->data[i];
+                vf->linesize[i]     = swf->linesize[i];
+                bufs[i] = NULL;
+            }
 
-            av_image_copy_plane_uc_from(swf->data[i], swf->linesize[i],
-                                        (const uint8_t *)tmp.data[i], tmp.linesize[i],
-                                        FFMIN(tmp.linesize[i], FFABS(swf->linesize[i])),
-                                        p_h);
+            *fence = vf;
+            return 0;
         }
-
-        if ((err = unmap_buffers(dev_ctx, bufs, planes, 1)))
-            goto end;
     }
 
+    if (from)
+        err = copy_from_buffers(dev_ctx, bufs, tmp.linesize, host_mapped,
+                                swf->data, swf->linesize, swf->format,
+                                swf->width, swf->height);
+
 end:
     for (int i = 0; i < planes; i++)
         av_buffer_unref(&bufs[i]);
@@ -4010,7 +4310,7 @@ static int vulkan_transfer_data_to(AVHWFramesContext *hwfc, AVFrame *dst,
         if (src->hw_frames_ctx)
             return AVERROR(ENOSYS);
         else
-            return vulkan_transfer_data(hwfc, dst, src, 0);
+            return vulkan_transfer_data(hwfc, dst, src, 0, NULL);
     }
 }
 
@@ -4128,10 +4428,58 @@ static int vulkan_transfer_data_from(AVHWFramesContext *hwfc, AVFrame *dst,
         if (dst->hw_frames_ctx)
             return AVERROR(ENOSYS);
         else
-            return vulkan_transfer_data(hwfc, src, dst, 1);
+            return vulkan_transfer_data(hwfc, src, dst, 1, NULL);
     }
 }
 
+static int vulkan_transfer_data_from_async(AVHWFramesContext *hwfc, AVFrame *dst,
+                                           const AVFrame *src, void **fence)
+{
+    /* Uploads already only wait for the previous use of the queue */
+    if (dst->hw_frames_ctx)
+        return vulkan_transfer_data_from(hwfc, dst, src);
+
+    return vulkan_transfer_data(hwfc, src, dst, 1, fence);
+}
+
+static int vulkan_transfer_wait(AVHWFramesContext *hwfc, void *fence, int flags)
+{
+    int err = 0;
+    VkResult ret;
+    VulkanTransferFence *vf = fence;
+    AVVulkanDeviceContext *hwctx = hwfc->device_ctx->hwctx;
+    VulkanDevicePriv *p = hwfc->device_ctx->internal->priv;
+    FFVulkanFunctions *vk = &p->vkfn;
+
+    VkSemaphoreWaitInfo wait_info = {
+        .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pSemaphores    = vf->f->sem,
+        .pValues        = vf->sem_value,
+        .semaphoreCount = vf->nb_sems,
+    };
+
+    ret = vk->WaitSemaphores(hwctx->act_dev, &wait_info,
+                             flags & AV_HWFRAME_TRANSFER_NONBLOCK ? 0 : UINT64_MAX);
+    if (ret == VK_TIMEOUT && (flags & AV_HWFRAME_TRANSFER_NONBLOCK))
+        return AVERROR(EAGAIN);
+
+    if (ret != VK_SUCCESS) {
+        av_log(hwfc, AV_LOG_ERROR, "Failed to wait for transfer: %s\n",
+               vk_ret2str(ret));
+        err = AVERROR_EXTERNAL;
+    } else {
+        err = copy_from_buffers(hwfc->device_ctx, vf->bufs, vf->buf_linesize,
+                                vf->host_mapped, vf->data, vf->linesize,
+                                vf->format, vf->width, vf->height);
+    }
+
+    for (int i = 0; i < vf->nb_sems; i++)
+        av_buffer_unref(&vf->bufs[i]);
+    av_free(vf);
+
+    return err;
+}
+
 static int vulkan_frames_derive_to(AVHWFramesContext *dst_fc,
                                    AVHWFramesContext *src_fc, int flags)
 {
@@ -4164,6 +4512,8 @@ const HWContextType ff_hwcontext_type_vulkan = {
     .transfer_get_formats   = vulkan_transfer_get_formats,
     .transfer_data_to       = vulkan_transfer_data_to,
     .transfer_data_from     = vulkan_transfer_data_from,
+    .transfer_data_from_async = vulkan_transfer_data_from_async,
+    .transfer_wait          = vulkan_transfer_wait,
 
     .map_to                 = vulkan_map_to,
     .map_from               = vulkan_map_from,
@@ -31,6 +31,7 @@
 #include "mathematics.h"
 #include "pixdesc.h"
 #include "rational.h"
+#include "slicethread.h"
 
 void av_image_fill_max_pixsteps(int max_pixsteps[4], int max_pixstep_comps[4],
                                 const AVPixFmtDescriptor *pixdesc)
@@ -356,6 +357,22 @@ static void image_copy_plane(uint8_t       *dst, ptrdiff_t dst_linesize,
     }
 }
 
+static void image_copy_plane_nt(uint8_t       *dst, ptrdiff_t dst_linesize,
+                                const uint8_t *src, ptrdiff_t src_linesize,
+                                ptrdiff_t bytewidth, int height)
+{
+    int ret = -1;
+
+#if ARCH_X86
+    if (dst && src)
+        ret = ff_image_copy_plane_nt_x86(dst, dst_linesize, src, src_linesize,
+                                         bytewidth, height);
+#endif
+
+    if (ret < 0)
+        image_copy_plane(dst, dst_linesize, src, src_linesize, bytewidth, height);
+}
+
 void av_image_copy_plane_uc_from(uint8_t *dst, ptrdiff_t dst_linesize,
                                  const uint8_t *src, ptrdiff_t src_linesize,
                                  ptrdiff_t bytewidth, int height)
@@ -443,6 +460,97 @@ void av_image_copy_uc_from(uint8_t *dst_data[4], const ptrdiff_t dst_linesizes[4
                width, height, av_image_copy_plane_uc_from);
 }
 
+typedef struct ImageCopyContext {
+    uint8_t *dst[4];
+    const uint8_t *src[4];
+    ptrdiff_t dst_linesize[4], src_linesize[4];
+    ptrdiff_t bytewidth[4];
+    int height[4];
+    int nb_planes;
+    void (*copy_plane)(uint8_t *, ptrdiff_t, const uint8_t *,
+                       ptrdiff_t, ptrdiff_t, int);
+} ImageCopyContext;
+
+static void image_copy_worker(void *priv, int jobnr, int threadnr,
+                              int nb_jobs, int nb_threads)
+{
+    const ImageCopyContext *c = priv;
+
+    for (int i = 0; i < c->nb_planes; i++) {
+        int start = c->height[i] *  jobnr      / nb_jobs;
+        int end   = c->height[i] * (jobnr + 1) / nb_jobs;
+
+        c->copy_plane(c->dst[i] + start * c->dst_linesize[i], c->dst_linesize[i],
+                      c->src[i] + start * c->src_linesize[i], c->src_linesize[i],
+                      c->bytewidth[i], end - start);
+    }
+}
+
+int av_image_copy_ext(uint8_t * const dst_data[4], const ptrdiff_t dst_linesizes[4],
+                      const uint8_t * const src_data[4], const ptrdiff_t src_linesizes[4],
+                      enum AVPixelFormat pix_fmt, int width, int height,
+                      AVThreadPool *pool, int flags)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pix_fmt);
+    ImageCopyContext c = { 0 };
+    AVSliceThread *thread = NULL;
+    int nb_jobs;
+
+    if (!desc)
+        return AVERROR(EINVAL);
+    if (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)
+        return 0;
+
+    c.copy_plane = flags & AV_IMAGE_COPY_FLAG_NONTEMPORAL ? image_copy_plane_nt
+                                                          : image_copy_plane;
+
+    if (desc->flags & AV_PIX_FMT_FLAG_PAL) {
+        c.nb_planes    = 1;
+        c.bytewidth[0] = width;
+        c.height[0]    = height;
+        memcpy(dst_data[1], src_data[1], 4*256);
+    } else {
+        for (int i = 0; i < desc->nb_components; i++)
+            c.nb_planes = FFMAX(c.nb_planes, desc->comp[i].plane + 1);
+
+        for (int i = 0; i < c.nb_planes; i++) {
+            c.bytewidth[i] = av_image_get_linesize(pix_fmt, width, i);
+            if (c.bytewidth[i] < 0)
+                return c.bytewidth[i];
+            c.height[i] = i == 1 || i == 2 ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h)
+                                           : height;
+        }
+    }
+
+    for (int i = 0; i < c.nb_planes; i++) {
+        if (!dst_data[i] || !src_data[i])
+            return AVERROR(EINVAL);
+        av_assert0(FFABS(src_linesizes[i]) >= c.bytewidth[i]);
+        av_assert0(FFABS(dst_linesizes[i]) >= c.bytewidth[i]);
+        c.dst[i]          = dst_data[i];
+        c.src[i]          = src_data[i];
+        c.dst_linesize[i] = dst_linesizes[i];
+        c.src_linesize[i] = src_linesizes[i];
+    }
+
+    nb_jobs = 1;
+    if (pool) {
+        nb_jobs = avpriv_slicethread_create_pool(&thread, pool, &c,
+                                                 image_copy_worker, NULL, 0);
+        if (nb_jobs < 0)
+            return nb_jobs;
+        nb_jobs = FFMIN(nb_jobs, height);
+    }
+
+    if (nb_jobs > 1)
+        avpriv_slicethread_execute(thread, nb_jobs, 0);
+    else
+        image_copy_worker(&c, 0, 0, 1, 1);
+    avpriv_slicethread_free(&thread);
+
+    return 0;
+}
+
 int av_image_fill_arrays(uint8_t *dst_data[4], int dst_linesize[4],
                          const uint8_t *src, enum AVPixelFormat pix_fmt,
                          int width, int height, int align)
@@ -32,6 +32,7 @@
 #include "pixdesc.h"
 #include "pixfmt.h"
 #include "rational.h"
+#include "threadpool.h"
 
 /**
  * Compute the max pixel step for each plane of an image with a
@@ -192,6 +193,38 @@ void av_image_copy_uc_from(uint8_t *dst_data[4],       const ptrdiff_t dst_lines
                            const uint8_t *src_data[4], const ptrdiff_t src_linesizes[4],
                            enum AVPixelFormat pix_fmt, int width, int height);
 
+/**
+ * Write the copy with non-temporal stores where available, so the
+ * destination does not evict the contents of the caches. This helps when
+ * the image does not fit in the last-level cache and is not read back soon
+ * after the copy. It is slower for small images.
+ */
+#define AV_IMAGE_COPY_FLAG_NONTEMPORAL (1 << 0)
+
+/**
+ * Copy image in src_data to dst_data, like av_image_copy(), with options
+ * meant for large images.
+ *
+ * @param dst_data      destination image data buffer to copy to
+ * @param dst_linesizes linesizes for the image in dst_data
+ * @param src_data      source image data buffer to copy from
+ * @param src_linesizes linesizes for the image in src_data
+ * @param pix_fmt       the AVPixelFormat of the image
+ * @param width         width of the image in pixels
+ * @param height        height of the image in pixels
+ * @param pool          if not NULL, the rows of the image are split among the
+ *                      threads of this pool and the calling thread
+ * @param flags         a combination of AV_IMAGE_COPY_FLAG_* flags
+ * @return 0 on success, a negative AVERROR code on failure
+ *
+ * @note On x86, AV_IMAGE_COPY_FLAG_NONTEMPORAL currently needs the data
+ *       pointers and the linesizes to be aligned to 16.
+ */
+int av_image_copy_ext(uint8_t * const dst_data[4], const ptrdiff_t dst_linesizes[4],
+                      const uint8_t * const src_data[4], const ptrdiff_t src_linesizes[4],
+                      enum AVPixelFormat pix_fmt, int width, int height,
+                      AVThreadPool *pool, int flags);
+
 /**
  * Setup the data pointers and linesizes based on the specified image
  * parameters and the provided array.
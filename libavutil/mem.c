@@ -75,6 +75,20 @@ void av_max_alloc(size_t max){
     atomic_store_explicit(&max_alloc_size, max, memory_order_relaxed);
 }
 
+static AVMemAllocator allocator;
+
+int av_mem_set_allocator(const AVMemAllocator *new_allocator)
+{
+    if (!new_allocator) {
+        memset(&allocator, 0, sizeof(allocator));
+        return 0;
+    }
+    if (!new_allocator->alloc || !new_allocator->realloc || !new_allocator->free)
+        return AVERROR(EINVAL);
+    allocator = *new_allocator;
+    return 0;
+}
+
 static int size_mult(size_t a, size_t b, size_t *r)
 {
     size_t t;
@@ -100,6 +114,15 @@ void *av_malloc(size_t size)
     if (size > atomic_load_explicit(&max_alloc_size, memory_order_relaxed))
         return NULL;
 
+    if (allocator.alloc) {
+        ptr = allocator.alloc(allocator.opaque, size + !size, ALIGN);
+#if CONFIG_MEMORY_POISONING
+        if (ptr)
+            memset(ptr, FF_MEMORY_POISON, size);
+#endif
+        return ptr;
+    }
+
 #if HAVE_POSIX_MEMALIGN
     if (size) //OS X on SDK 10.6 has a broken posix_memalign implementation
     if (posix_memalign(&ptr, ALIGN, size))
@@ -156,11 +179,15 @@ void *av_realloc(void *ptr, size_t size)
     if (size > atomic_load_explicit(&max_alloc_size, memory_order_relaxed))
         return NULL;
 
+    if (allocator.realloc) {
+        ret = allocator.realloc(allocator.opaque, ptr, size + !size, ALIGN);
+    } else {
 #if HAVE_ALIGNED_MALLOC
-    ret = _aligned_realloc(ptr, size + !size, ALIGN);
+        ret = _aligned_realloc(ptr, size + !size, ALIGN);
 #else
-    ret = realloc(ptr, size + !size);
+        ret = realloc(ptr, size + !size);
 #endif
+    }
 #if CONFIG_MEMORY_POISONING
     if (ret && !ptr)
         memset(ret, FF_MEMORY_POISON, size);
@@ -245,6 +272,10 @@ int av_reallocp_array(void *ptr, size_t nmemb, size_t size)
 
 void av_free(void *ptr)
 {
+    if (allocator.free) {
+        allocator.free(allocator.opaque, ptr);
+        return;
+    }
 #if HAVE_ALIGNED_MALLOC
     _aligned_free(ptr);
 #else
@@ -689,6 +689,55 @@ int av_size_mult(size_t a, size_t b, size_t *r);
  */
 void av_max_alloc(size_t max);
 
+/**
+ * Custom memory allocator used by the heap management functions instead of
+ * the system allocator, see av_mem_set_allocator().
+ *
+ * This allows plugging in another allocator, allocating from NUMA-local
+ * memory, or accounting and limiting the memory used by the libraries.
+ */
+typedef struct AVMemAllocator {
+    /**
+     * Opaque pointer passed to the callbacks.
+     */
+    void *opaque;
+
+    /**
+     * Allocate a block of size bytes, aligned to at least align bytes.
+     * size is never 0. Must return NULL on failure.
+     */
+    void *(*alloc)(void *opaque, size_t size, size_t align);
+
+    /**
+     * Resize a block returned by alloc() or realloc() to size bytes,
+     * preserving its contents, or allocate a new block if ptr is NULL.
+     * size is never 0. Must return NULL and leave ptr untouched on failure.
+     */
+    void *(*realloc)(void *opaque, void *ptr, size_t size, size_t align);
+
+    /**
+     * Free a block returned by alloc() or realloc(). ptr may be NULL.
+     */
+    void (*free)(void *opaque, void *ptr);
+} AVMemAllocator;
+
+/**
+ * Set the allocator used by all libavutil's @ref lavu_mem_funcs
+ * "heap management functions", and thus by all the other libraries.
+ *
+ * The allocator is copied. Passing NULL restores the system allocator.
+ *
+ * @warning This function is not thread-safe, and blocks allocated with one
+ *          allocator must not be freed after switching to another. It
+ *          should therefore be called before any other function of the
+ *          libraries, and not be changed while any of their memory is
+ *          still allocated.
+ *
+ * @param allocator the allocator to use, or NULL
+ * @return 0 on success, AVERROR(EINVAL) if a callback is missing
+ */
+int av_mem_set_allocator(const AVMemAllocator *allocator);
+
 /**
  * @}
  * @}
@@ -22,6 +22,7 @@
 #include "slicethread.h"
 #include "mem.h"
 #include "thread.h"
+#include "threadpool.h"
 #include "avassert.h"
 
 #define MAX_AUTO_THREADS 16
@@ -36,6 +37,18 @@ typedef struct WorkerContext {
     int             done;
 } WorkerContext;
 
+struct AVThreadPool {
+    pthread_t       *threads;
+    int             nb_threads;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    /* contexts with helper tasks waiting for a pool thread */
+    AVSliceThread   *queue_head;
+    AVSliceThread   *queue_tail;
+    int             finished;
+};
+
 struct AVSliceThread {
     WorkerContext   *workers;
     int             nb_threads;
@@ -52,6 +65,12 @@ struct AVSliceThread {
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    /* shared pool, the following fields are protected by pool->mutex */
+    AVThreadPool    *pool;
+    AVSliceThread   *queue_next;
+    int             nb_pending;     ///< helper tasks not yet picked up by a pool thread
+    int             nb_running;     ///< helper tasks currently running jobs
 };
 
 static int run_jobs(AVSliceThread *ctx)
@@ -95,6 +114,227 @@ static void *attribute_align_arg thread_worker(void *v)
     }
 }
 
+/*
+ * With a shared pool, the caller and the helper tasks picked up by pool
+ * threads all take jobs from the same counter, so that no job depends on a
+ * particular thread being available.
+ */
+static void run_jobs_pool(AVSliceThread *ctx)
+{
+    unsigned nb_jobs  = ctx->nb_jobs;
+    unsigned threadnr = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
+    unsigned jobnr;
+
+    av_assert1(threadnr < ctx->nb_active_threads);
+
+    while ((jobnr = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs)
+        ctx->worker_func(ctx->priv, jobnr, threadnr, nb_jobs, ctx->nb_active_threads);
+}
+
+static void *attribute_align_arg pool_worker(void *v)
+{
+    AVThreadPool *pool = v;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        AVSliceThread *ctx;
+
+        while (!pool->queue_head && !pool->finished)
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+
+        if (pool->finished)
+            break;
+
+        ctx = pool->queue_head;
+        if (!--ctx->nb_pending) {
+            pool->queue_head = ctx->queue_next;
+            if (!pool->queue_head)
+                pool->queue_tail = NULL;
+            ctx->queue_next = NULL;
+        }
+        ctx->nb_running++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_jobs_pool(ctx);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (!--ctx->nb_running)
+            pthread_cond_signal(&ctx->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+/* called with pool->mutex held */
+static void pool_dequeue(AVThreadPool *pool, AVSliceThread *ctx)
+{
+    AVSliceThread **p = &pool->queue_head, *prev = NULL;
+
+    if (!ctx->nb_pending)
+        return;
+
+    while (*p != ctx) {
+        prev = *p;
+        p    = &(*p)->queue_next;
+    }
+    *p = ctx->queue_next;
+    if (pool->queue_tail == ctx)
+        pool->queue_tail = prev;
+
+    ctx->queue_next = NULL;
+    ctx->nb_pending = 0;
+}
+
+static void slicethread_execute_pool(AVSliceThread *ctx, int nb_jobs, int execute_main)
+{
+    AVThreadPool *pool = ctx->pool;
+    int nb_helpers;
+
+    ctx->nb_jobs           = nb_jobs;
+    ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
+    atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
+    atomic_store_explicit(&ctx->current_job, 0, memory_order_relaxed);
+    nb_helpers             = ctx->nb_active_threads - 1;
+
+    if (nb_helpers > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        ctx->nb_pending = nb_helpers;
+        if (pool->queue_tail)
+            pool->queue_tail->queue_next = ctx;
+        else
+            pool->queue_head = ctx;
+        pool->queue_tail = ctx;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    if (ctx->main_func && execute_main)
+        ctx->main_func(ctx->priv);
+    run_jobs_pool(ctx);
+
+    if (nb_helpers > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        /* all jobs have been taken, drop the helpers that did not start */
+        pool_dequeue(pool, ctx);
+        while (ctx->nb_running)
+            pthread_cond_wait(&ctx->done_cond, &pool->mutex);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+int av_thread_pool_alloc(AVThreadPool **ppool, int nb_threads)
+{
+    AVThreadPool *pool;
+    int ret;
+
+    if (nb_threads < 0)
+        return AVERROR(EINVAL);
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+
+    *ppool = pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+
+    pool->threads = av_calloc(nb_threads, sizeof(*pool->threads));
+    if (!pool->threads) {
+        av_freep(ppool);
+        return AVERROR(ENOMEM);
+    }
+
+    if ((ret = pthread_mutex_init(&pool->mutex, NULL))) {
+        av_freep(&pool->threads);
+        av_freep(ppool);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pool->cond, NULL))) {
+        pthread_mutex_destroy(&pool->mutex);
+        av_freep(&pool->threads);
+        av_freep(ppool);
+        return AVERROR(ret);
+    }
+
+    for (; pool->nb_threads < nb_threads; pool->nb_threads++) {
+        ret = pthread_create(&pool->threads[pool->nb_threads], NULL, pool_worker, pool);
+        if (ret) {
+            av_thread_pool_free(ppool);
+            return AVERROR(ret);
+        }
+    }
+
+    return 0;
+}
+
+int av_thread_pool_nb_threads(const AVThreadPool *pool)
+{
+    return pool->nb_threads;
+}
+
+void av_thread_pool_free(AVThreadPool **ppool)
+{
+    AVThreadPool *pool = *ppool;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    av_assert0(!pool->queue_head);
+    pool->finished = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    av_freep(&pool->threads);
+    av_freep(ppool);
+}
+
+static int slicethread_create_pool(AVSliceThread **pctx, AVThreadPool *pool, void *priv,
+                                   void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                   void (*main_func)(void *priv),
+                                   int nb_threads)
+{
+    AVSliceThread *ctx;
+    int ret;
+
+    /* the caller takes part in the execution, next to the pool threads */
+    if (!nb_threads || nb_threads > pool->nb_threads + 1)
+        nb_threads = pool->nb_threads + 1;
+
+    *pctx = ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    ctx->pool        = pool;
+    ctx->priv        = priv;
+    ctx->worker_func = worker_func;
+    ctx->main_func   = main_func;
+    ctx->nb_threads  = nb_threads;
+
+    atomic_init(&ctx->first_job, 0);
+    atomic_init(&ctx->current_job, 0);
+    if ((ret = pthread_cond_init(&ctx->done_cond, NULL))) {
+        av_freep(pctx);
+        return AVERROR(ret);
+    }
+
+    return nb_threads;
+}
+
+int avpriv_slicethread_create_pool(AVSliceThread **pctx, AVThreadPool *pool, void *priv,
+                                   void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                   void (*main_func)(void *priv),
+                                   int nb_threads)
+{
+    if (pool)
+        return slicethread_create_pool(pctx, pool, priv, worker_func, main_func, nb_threads);
+    return avpriv_slicethread_create(pctx, priv, worker_func, main_func, nb_threads);
+}
+
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
@@ -170,6 +410,12 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     int nb_workers, i, is_last = 0;
 
     av_assert0(nb_jobs > 0);
+
+    if (ctx->pool) {
+        slicethread_execute_pool(ctx, nb_jobs, execute_main);
+        return;
+    }
+
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
@@ -209,6 +455,13 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+
+    if (ctx->pool) {
+        pthread_cond_destroy(&ctx->done_cond);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -237,6 +490,31 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
 
 #else /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS32THREADS */
 
+int av_thread_pool_alloc(AVThreadPool **ppool, int nb_threads)
+{
+    *ppool = NULL;
+    return AVERROR(ENOSYS);
+}
+
+int av_thread_pool_nb_threads(const AVThreadPool *pool)
+{
+    return 0;
+}
+
+void av_thread_pool_free(AVThreadPool **ppool)
+{
+    av_assert0(!*ppool);
+}
+
+int avpriv_slicethread_create_pool(AVSliceThread **pctx, AVThreadPool *pool, void *priv,
+                                   void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                   void (*main_func)(void *priv),
+                                   int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
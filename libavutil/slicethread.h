@@ -19,6 +19,8 @@
 #ifndef AVUTIL_SLICETHREAD_H
 #define AVUTIL_SLICETHREAD_H
 
+#include "threadpool.h"
+
 typedef struct AVSliceThread AVSliceThread;
 
 /**
@@ -35,6 +37,26 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*main_func)(void *priv),
                               int nb_threads);
 
+/**
+ * Create slice threading context running its jobs on a shared thread pool.
+ *
+ * The calling thread of avpriv_slicethread_execute() runs jobs as well, so
+ * the pool may be shared by any number of contexts, including contexts
+ * executed from within the jobs of another one.
+ *
+ * @param pool shared thread pool, must outlive the context; if NULL, this
+ *             behaves like avpriv_slicethread_create()
+ * @param nb_threads maximum number of threads running the jobs of one
+ *                   execution, including the caller; 0 to use all the
+ *                   threads of the pool
+ * @return return number of threads or negative AVERROR on failure
+ * @see avpriv_slicethread_create()
+ */
+int avpriv_slicethread_create_pool(AVSliceThread **pctx, AVThreadPool *pool, void *priv,
+                                   void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                   void (*main_func)(void *priv),
+                                   int nb_threads);
+
 /**
  * Execute slice threading.
  * @param ctx slice threading context
@@ -0,0 +1,103 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program checks that the buffer pools sharing a cache reuse each
+ * other's buffers, that the unused buffers are kept within the budget by
+ * freeing the least recently released ones, and that the cache outlives its
+ * pools and buffers.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/buffer.h"
+
+#define SIZE 1000
+
+#define CHECK(cond) do {                                            \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "%s failed at line %d\n", #cond, __LINE__); \
+            return 1;                                               \
+        }                                                           \
+    } while (0)
+
+int main(void)
+{
+    AVBufferCache *cache = av_buffer_cache_alloc(3 * SIZE);
+    AVBufferPool *pool1, *pool2;
+    AVBufferRef *buf[4];
+    uint8_t *data[4];
+
+    CHECK(cache);
+    pool1 = av_buffer_pool_init_cache(SIZE, cache);
+    pool2 = av_buffer_pool_init_cache(SIZE, cache);
+    CHECK(pool1 && pool2);
+
+    /* a buffer released by a pool is reused by the other one */
+    buf[0] = av_buffer_pool_get(pool1);
+    CHECK(buf[0] && buf[0]->size == SIZE);
+    data[0] = buf[0]->data;
+    av_buffer_unref(&buf[0]);
+    CHECK(av_buffer_cache_get_unused_size(cache) == SIZE);
+    buf[0] = av_buffer_pool_get(pool2);
+    CHECK(buf[0] && buf[0]->data == data[0]);
+    CHECK(av_buffer_cache_get_unused_size(cache) == 0);
+
+    /* buffers of other sizes are not */
+    buf[1] = av_buffer_cache_get(cache, SIZE / 2);
+    CHECK(buf[1] && buf[1]->data != data[0]);
+    av_buffer_unref(&buf[1]);
+    av_buffer_unref(&buf[0]);
+    CHECK(av_buffer_cache_get_unused_size(cache) == SIZE + SIZE / 2);
+
+    for (int i = 0; i < 4; i++) {
+        buf[i] = av_buffer_pool_get(i & 1 ? pool2 : pool1);
+        CHECK(buf[i]);
+        data[i] = buf[i]->data;
+    }
+    /* the buffer of size SIZE / 2 is now the least recently released one */
+    av_buffer_unref(&buf[0]);
+    av_buffer_unref(&buf[1]);
+    CHECK(av_buffer_cache_get_unused_size(cache) == 2 * SIZE + SIZE / 2);
+    av_buffer_unref(&buf[2]);
+    CHECK(av_buffer_cache_get_unused_size(cache) == 3 * SIZE);
+    av_buffer_unref(&buf[3]);
+    CHECK(av_buffer_cache_get_unused_size(cache) == 3 * SIZE);
+
+    /* buf[0] was trimmed, the most recently released buffer comes first */
+    buf[3] = av_buffer_pool_get(pool1);
+    CHECK(buf[3] && buf[3]->data == data[3]);
+    buf[2] = av_buffer_pool_get(pool1);
+    CHECK(buf[2] && buf[2]->data == data[2]);
+    buf[1] = av_buffer_pool_get(pool1);
+    CHECK(buf[1] && buf[1]->data == data[1]);
+    CHECK(av_buffer_cache_get_unused_size(cache) == 0);
+
+    /* the cache is freed with the last pool and buffer */
+    av_buffer_unref(&buf[1]);
+    av_buffer_cache_uninit(&cache);
+    av_buffer_pool_uninit(&pool1);
+    av_buffer_unref(&buf[2]);
+    buf[0] = av_buffer_pool_get(pool2);
+    CHECK(buf[0]);
+    av_buffer_pool_uninit(&pool2);
+    av_buffer_unref(&buf[0]);
+    av_buffer_unref(&buf[3]);
+
+    return 0;
+}
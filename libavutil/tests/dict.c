@@ -69,6 +69,80 @@ static void test_separators(const AVDictionary *m, const char pair, const char v
     av_dict_free(&dict);
 }
 
+static const AVDictionaryEntry *linear_get(const AVDictionary *m, const char *key,
+                                           const AVDictionaryEntry *prev, int flags)
+{
+    const AVDictionaryEntry *e = prev;
+
+    while ((e = av_dict_iterate(m, e)))
+        if (flags & AV_DICT_MATCH_CASE ? !strcmp(e->key, key)
+                                       : !av_strcasecmp(e->key, key))
+            return e;
+    return NULL;
+}
+
+/* compare all the lookups, following duplicate keys, with a linear scan */
+static int check_lookups(const AVDictionary *m, int nb_keys)
+{
+    char key[8];
+    int errors = 0;
+
+    for (int i = 0; i < 2 * nb_keys; i++) {
+        snprintf(key, sizeof(key), "%c%02d", i & 1 ? 'K' : 'k', i >> 1);
+        for (int flags = 0; flags <= AV_DICT_MATCH_CASE; flags += AV_DICT_MATCH_CASE) {
+            const AVDictionaryEntry *e = NULL, *ref = NULL;
+            do {
+                e   = av_dict_get(m, key, e, flags);
+                ref = linear_get(m, key, ref, flags);
+                errors += e != ref;
+            } while (e && e == ref);
+        }
+    }
+    return errors;
+}
+
+static void test_hash_index(void)
+{
+    AVDictionary *dict = NULL;
+    unsigned state = 1;
+    int max_count = 0, indexed = 0, errors = 0;
+    const int nb_keys = 48;
+
+    for (int i = 0; i < 3000; i++) {
+        char key[8], value[16];
+        int flags = 0, r;
+
+        state = state * 1664525 + 1013904223;
+        r = state >> 8;
+        snprintf(key, sizeof(key), "%c%02d", r & 1 ? 'K' : 'k', (r >> 1) % nb_keys);
+        snprintf(value, sizeof(value), "v%d", i);
+        if (r & 0x1000)
+            flags |= AV_DICT_MATCH_CASE;
+
+        switch ((r >> 13) % 8) {
+        case 0: case 1:
+            av_dict_set(&dict, key, value, flags | AV_DICT_MULTIKEY);
+            break;
+        case 2: case 3:
+            av_dict_set(&dict, key, value, flags);
+            break;
+        case 4:
+            av_dict_set(&dict, key, value, flags | AV_DICT_APPEND);
+            break;
+        default:
+            av_dict_set(&dict, key, NULL, flags);
+            break;
+        }
+
+        max_count = FFMAX(max_count, av_dict_count(dict));
+        indexed  += dict && dict->hash;
+        errors   += check_lookups(dict, nb_keys);
+    }
+    printf("max count %d, indexed after %d of 3000 operations, %d mismatches\n",
+           max_count, indexed, errors);
+    av_dict_free(&dict);
+}
+
 int main(void)
 {
     AVDictionary *dict = NULL;
@@ -158,5 +232,8 @@ int main(void)
     printf("%s\n", e->value);
     av_dict_free(&dict);
 
+    printf("\nTesting the hash index against a linear scan\n");
+    test_hash_index();
+
     return 0;
 }
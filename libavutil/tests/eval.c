@@ -138,6 +138,7 @@ int main(int argc, char **argv)
         "clip(0, 2, 1)",
         "clip(0/0, 1, 2)",
         "clip(0, 0/0, 1)",
+        "st(0, 7); clip(ld(0), st(0, 1), 10)",
         NULL
     };
     int ret;
@@ -20,8 +20,53 @@
 
 #undef printf
 
+static int check_image_copy_ext(enum AVPixelFormat pix_fmt, int w, int h,
+                                AVThreadPool *pool, int flags)
+{
+    uint8_t *src[4], *dst0[4], *dst1[4];
+    int src_linesizes[4], dst_linesizes[4];
+    ptrdiff_t src_linesizes1[4], dst_linesizes1[4];
+    int size, ret = -1;
+
+    size = av_image_alloc(src, src_linesizes, w, h, pix_fmt, 32);
+    if (size < 0)
+        return size;
+    if (av_image_alloc(dst0, dst_linesizes, w, h, pix_fmt, 32) < 0)
+        goto fail_src;
+    if (av_image_alloc(dst1, dst_linesizes, w, h, pix_fmt, 32) < 0)
+        goto fail_dst0;
+
+    for (int i = 0; i < size; i++)
+        src[0][i] = i * 7 + (i >> 8);
+    memset(dst0[0], 0, size);
+    memset(dst1[0], 0, size);
+    for (int i = 0; i < 4; i++) {
+        src_linesizes1[i] = src_linesizes[i];
+        dst_linesizes1[i] = dst_linesizes[i];
+    }
+
+    av_image_copy(dst0, dst_linesizes, (const uint8_t **)src, src_linesizes,
+                  pix_fmt, w, h);
+    ret = av_image_copy_ext(dst1, dst_linesizes1, (const uint8_t * const *)src,
+                            src_linesizes1, pix_fmt, w, h, pool, flags);
+    if (ret >= 0)
+        ret = memcmp(dst0[0], dst1[0], size) ? -1 : 0;
+
+    av_freep(&dst1[0]);
+fail_dst0:
+    av_freep(&dst0[0]);
+fail_src:
+    av_freep(&src[0]);
+    return ret;
+}
+
 int main(void)
 {
+    static const enum AVPixelFormat copy_fmts[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVA422P10, AV_PIX_FMT_NV12,
+        AV_PIX_FMT_RGB24, AV_PIX_FMT_PAL8,
+    };
+    AVThreadPool *pool = NULL;
     const AVPixFmtDescriptor *desc = NULL;
     int64_t x, y;
 
@@ -69,6 +114,19 @@ int main(void)
             printf(" %5"PTRDIFF_SPECIFIER, offsets[i]);
         printf(", total_size: %d\n", total_size);
     }
+    printf("\n");
+
+    /* the output does not depend on whether threads are available */
+    av_thread_pool_alloc(&pool, 3);
+    for (int i = 0; i < FF_ARRAY_ELEMS(copy_fmts); i++) {
+        const char *name = av_get_pix_fmt_name(copy_fmts[i]);
+        for (int flags = 0; flags <= AV_IMAGE_COPY_FLAG_NONTEMPORAL; flags++) {
+            printf("%-16s copy_ext flags %d: %s, %s\n", name, flags,
+                   check_image_copy_ext(copy_fmts[i], 333, 37, NULL, flags) ? "failed" : "ok",
+                   check_image_copy_ext(copy_fmts[i], 333, 37, pool, flags) ? "failed" : "ok");
+        }
+    }
+    av_thread_pool_free(&pool);
 
     return 0;
 }
@@ -0,0 +1,170 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program runs several slice threading contexts sharing one pool
+ * from concurrent threads, with nested executions, and checks that every job
+ * runs exactly once and that no two jobs run with the same thread number at
+ * the same time.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadpool.h"
+
+#define NB_CONTEXTS   4
+#define NB_JOBS      64
+#define NB_EXECUTES 100
+
+typedef struct Context {
+    AVSliceThread *thread;
+    int            nb_threads;
+    atomic_int     runs[NB_JOBS];
+    atomic_int     busy[NB_JOBS];
+    atomic_int     errors;
+    /* executed from within the jobs of this context, one per thread number;
+     * may be NULL */
+    struct Context *nested;
+} Context;
+
+static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    Context *c = priv;
+
+    if (threadnr < 0 || threadnr >= nb_threads || nb_threads > c->nb_threads ||
+        atomic_fetch_add(&c->busy[threadnr], 1)) {
+        atomic_fetch_add(&c->errors, 1);
+        return;
+    }
+
+    atomic_fetch_add(&c->runs[jobnr], 1);
+
+    if (c->nested && !(jobnr & 15))
+        avpriv_slicethread_execute(c->nested[threadnr].thread, NB_JOBS, 0);
+
+    atomic_fetch_sub(&c->busy[threadnr], 1);
+}
+
+static void *thread_main(void *arg)
+{
+    Context *c = arg;
+
+    for (int i = 0; i < NB_EXECUTES; i++)
+        avpriv_slicethread_execute(c->thread, NB_JOBS, 0);
+
+    return NULL;
+}
+
+static int create_context(Context *c, AVThreadPool *pool, int nb_threads)
+{
+    int ret = avpriv_slicethread_create_pool(&c->thread, pool, c,
+                                             worker_func, NULL, nb_threads);
+    if (ret < 0) {
+        fprintf(stderr, "avpriv_slicethread_create_pool failed\n");
+        return ret;
+    }
+    c->nb_threads = ret;
+    return 0;
+}
+
+static int check_context(const Context *c, int idx)
+{
+    int ret = 0;
+
+    if (atomic_load(&c->errors)) {
+        fprintf(stderr, "context %d: invalid thread number\n", idx);
+        ret = 2;
+    }
+    for (int j = 0; j < NB_JOBS; j++) {
+        if (atomic_load(&c->runs[j]) != NB_EXECUTES) {
+            fprintf(stderr, "context %d: job %d ran %d times instead of %d\n",
+                    idx, j, atomic_load(&c->runs[j]), NB_EXECUTES);
+            ret = 3;
+        }
+    }
+    return ret;
+}
+
+int main(void)
+{
+    static Context ctx[NB_CONTEXTS];
+    static Context nested[NB_CONTEXTS + 1];
+    pthread_t threads[NB_CONTEXTS];
+    AVThreadPool *pool;
+    int ret, nb_nested;
+
+    ret = av_thread_pool_alloc(&pool, 3);
+    if (ret < 0) {
+        fprintf(stderr, "av_thread_pool_alloc failed\n");
+        return 1;
+    }
+    if (av_thread_pool_nb_threads(pool) != 3)
+        return 1;
+
+    for (int i = 0; i < NB_CONTEXTS; i++)
+        if (create_context(&ctx[i], pool, i == NB_CONTEXTS - 1 ? 0 : i + 1) < 0)
+            return 1;
+
+    /* the last context executes another context from within its jobs */
+    nb_nested = ctx[NB_CONTEXTS - 1].nb_threads;
+    for (int i = 0; i < nb_nested; i++)
+        if (create_context(&nested[i], pool, 0) < 0)
+            return 1;
+    ctx[NB_CONTEXTS - 1].nested = nested;
+
+    for (int i = 0; i < NB_CONTEXTS; i++) {
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &ctx[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    for (int i = 0; i < NB_CONTEXTS; i++)
+        pthread_join(threads[i], NULL);
+
+    ret = 0;
+    for (int i = 0; i < NB_CONTEXTS; i++) {
+        ret |= check_context(&ctx[i], i);
+        avpriv_slicethread_free(&ctx[i].thread);
+    }
+
+    for (int j = 0; j < NB_JOBS; j++) {
+        int runs = 0;
+        for (int i = 0; i < nb_nested; i++)
+            runs += atomic_load(&nested[i].runs[j]);
+        if (runs != NB_EXECUTES * NB_JOBS / 16) {
+            fprintf(stderr, "nested: job %d ran %d times instead of %d\n",
+                    j, runs, NB_EXECUTES * NB_JOBS / 16);
+            ret |= 4;
+        }
+    }
+    for (int i = 0; i < nb_nested; i++) {
+        if (atomic_load(&nested[i].errors)) {
+            fprintf(stderr, "nested %d: invalid thread number\n", i);
+            ret |= 2;
+        }
+        avpriv_slicethread_free(&nested[i].thread);
+    }
+
+    av_thread_pool_free(&pool);
+
+    return ret;
+}
@@ -19,19 +19,42 @@
  */
 
 #include <limits.h>
-#include "fifo.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#include "cpu.h"
 #include "mem.h"
 #include "threadmessage.h"
 #include "thread.h"
 
+/**
+ * The queue is a bounded lock-free ring buffer which any number of threads
+ * may send to and receive from. Every cell carries a stamp telling whether
+ * it is ready to be written or read for a given position. A position keeps
+ * the cell index in its low bits and a lap counter above them, so that the
+ * capacity does not need to be a power of two.
+ *
+ * The mutex and condition variables are only used to put threads to sleep
+ * when the queue is full or empty. A thread that cannot make progress never
+ * spins on another one, and the other side only takes the lock when a
+ * thread is actually sleeping.
+ */
 struct AVThreadMessageQueue {
 #if HAVE_THREADS
-    AVFifo *fifo;
+    uint8_t *buf;
+    atomic_uint *stamp;
+    unsigned nelem;
+    unsigned one_lap;
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_int nb_wait_send;
+    atomic_int nb_wait_recv;
+    int spin;
     pthread_mutex_t lock;
     pthread_cond_t cond_recv;
     pthread_cond_t cond_send;
-    int err_send;
-    int err_recv;
+    atomic_int err_send;
+    atomic_int err_recv;
     unsigned elsize;
     void (*free_func)(void *msg);
 #else
@@ -39,6 +62,8 @@ struct AVThreadMessageQueue {
 #endif
 };
 
+#define SPIN_COUNT 64
+
 int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
                                   unsigned nelem,
                                   unsigned elsize)
@@ -47,7 +72,7 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
     AVThreadMessageQueue *rmq;
     int ret = 0;
 
-    if (nelem > INT_MAX / elsize)
+    if (!nelem || nelem > INT_MAX / elsize)
         return AVERROR(EINVAL);
     if (!(rmq = av_mallocz(sizeof(*rmq))))
         return AVERROR(ENOMEM);
@@ -66,13 +91,32 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
         av_free(rmq);
         return AVERROR(ret);
     }
-    if (!(rmq->fifo = av_fifo_alloc2(nelem, elsize, 0))) {
+    rmq->buf   = av_malloc_array(nelem, elsize);
+    rmq->stamp = av_malloc_array(nelem, sizeof(*rmq->stamp));
+    if (!rmq->buf || !rmq->stamp) {
+        av_free(rmq->buf);
+        av_free(rmq->stamp);
         pthread_cond_destroy(&rmq->cond_send);
         pthread_cond_destroy(&rmq->cond_recv);
         pthread_mutex_destroy(&rmq->lock);
         av_free(rmq);
         return AVERROR(ENOMEM);
     }
+
+    rmq->nelem   = nelem;
+    rmq->one_lap = 1;
+    while (rmq->one_lap <= nelem)
+        rmq->one_lap <<= 1;
+    for (unsigned i = 0; i < nelem; i++)
+        atomic_init(&rmq->stamp[i], i);
+    atomic_init(&rmq->head, 0);
+    atomic_init(&rmq->tail, 0);
+    atomic_init(&rmq->nb_wait_send, 0);
+    atomic_init(&rmq->nb_wait_recv, 0);
+    atomic_init(&rmq->err_send, 0);
+    atomic_init(&rmq->err_recv, 0);
+    /* waiting for the other side only makes sense if it can run meanwhile */
+    rmq->spin   = av_cpu_count() > 1 ? SPIN_COUNT : 0;
     rmq->elsize = elsize;
     *mq = rmq;
     return 0;
@@ -95,7 +139,8 @@ void av_thread_message_queue_free(AVThreadMessageQueue **mq)
 #if HAVE_THREADS
     if (*mq) {
         av_thread_message_flush(*mq);
-        av_fifo_freep2(&(*mq)->fifo);
+        av_freep(&(*mq)->buf);
+        av_freep(&(*mq)->stamp);
         pthread_cond_destroy(&(*mq)->cond_send);
         pthread_cond_destroy(&(*mq)->cond_recv);
         pthread_mutex_destroy(&(*mq)->lock);
@@ -107,11 +152,22 @@ void av_thread_message_queue_free(AVThreadMessageQueue **mq)
 int av_thread_message_queue_nb_elems(AVThreadMessageQueue *mq)
 {
 #if HAVE_THREADS
-    int ret;
-    pthread_mutex_lock(&mq->lock);
-    ret = av_fifo_can_read(mq->fifo);
-    pthread_mutex_unlock(&mq->lock);
-    return ret;
+    while (1) {
+        unsigned tail = atomic_load(&mq->tail);
+        unsigned head = atomic_load(&mq->head);
+        unsigned hix  = head & (mq->one_lap - 1);
+        unsigned tix  = tail & (mq->one_lap - 1);
+
+        /* make sure both were read at the same point in time */
+        if (atomic_load(&mq->tail) != tail)
+            continue;
+
+        if (hix < tix)
+            return tix - hix;
+        else if (hix > tix)
+            return mq->nelem - hix + tix;
+        return tail == head ? 0 : mq->nelem;
+    }
 #else
     return AVERROR(ENOSYS);
 #endif
@@ -119,38 +175,85 @@ int av_thread_message_queue_nb_elems(AVThreadMessageQueue *mq)
 
 #if HAVE_THREADS
 
-static int av_thread_message_queue_send_locked(AVThreadMessageQueue *mq,
-                                               void *msg,
-                                               unsigned flags)
+static unsigned next_pos(const AVThreadMessageQueue *mq, unsigned pos)
 {
-    while (!mq->err_send && !av_fifo_can_write(mq->fifo)) {
-        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+    unsigned idx = pos & (mq->one_lap - 1);
+    unsigned lap = pos & ~(mq->one_lap - 1);
+
+    return idx + 1 < mq->nelem ? pos + 1 : lap + mq->one_lap;
+}
+
+static int can_send(AVThreadMessageQueue *mq)
+{
+    unsigned tail = atomic_load(&mq->tail);
+    return atomic_load(&mq->stamp[tail & (mq->one_lap - 1)]) == tail;
+}
+
+static int can_recv(AVThreadMessageQueue *mq)
+{
+    unsigned head = atomic_load(&mq->head);
+    return atomic_load(&mq->stamp[head & (mq->one_lap - 1)]) == head + 1;
+}
+
+/* Returns 0 on success or EAGAIN if the queue is full, or if the next cell
+ * is still being read by another thread. */
+static int try_send(AVThreadMessageQueue *mq, const void *msg)
+{
+    unsigned tail = atomic_load_explicit(&mq->tail, memory_order_relaxed);
+
+    while (1) {
+        unsigned idx = tail & (mq->one_lap - 1);
+
+        if ((unsigned)atomic_load_explicit(&mq->stamp[idx], memory_order_acquire) != tail)
             return AVERROR(EAGAIN);
-        pthread_cond_wait(&mq->cond_send, &mq->lock);
+
+        if (atomic_compare_exchange_weak_explicit(&mq->tail, &tail,
+                                                  next_pos(mq, tail),
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            memcpy(mq->buf + idx * mq->elsize, msg, mq->elsize);
+            atomic_store(&mq->stamp[idx], tail + 1);
+            return 0;
+        }
     }
-    if (mq->err_send)
-        return mq->err_send;
-    av_fifo_write(mq->fifo, msg, 1);
-    /* one message is sent, signal one receiver */
-    pthread_cond_signal(&mq->cond_recv);
-    return 0;
 }
 
-static int av_thread_message_queue_recv_locked(AVThreadMessageQueue *mq,
-                                               void *msg,
-                                               unsigned flags)
+/* Returns 0 on success or EAGAIN if the queue is empty, or if the next cell
+ * is still being written by another thread. If msg is NULL, the message is
+ * passed to the free function instead of being copied. */
+static int try_recv(AVThreadMessageQueue *mq, void *msg)
 {
-    while (!mq->err_recv && !av_fifo_can_read(mq->fifo)) {
-        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+    unsigned head = atomic_load_explicit(&mq->head, memory_order_relaxed);
+
+    while (1) {
+        unsigned idx = head & (mq->one_lap - 1);
+        uint8_t *cell = mq->buf + idx * mq->elsize;
+
+        if ((unsigned)atomic_load_explicit(&mq->stamp[idx], memory_order_acquire) != head + 1)
             return AVERROR(EAGAIN);
-        pthread_cond_wait(&mq->cond_recv, &mq->lock);
+
+        if (atomic_compare_exchange_weak_explicit(&mq->head, &head,
+                                                  next_pos(mq, head),
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            if (msg)
+                memcpy(msg, cell, mq->elsize);
+            else
+                mq->free_func(cell);
+            atomic_store(&mq->stamp[idx], head + mq->one_lap);
+            return 0;
+        }
     }
-    if (!av_fifo_can_read(mq->fifo))
-        return mq->err_recv;
-    av_fifo_read(mq->fifo, msg, 1);
-    /* one message space appeared, signal one sender */
-    pthread_cond_signal(&mq->cond_send);
-    return 0;
+}
+
+static void wake_one(AVThreadMessageQueue *mq, atomic_int *nb_wait,
+                     pthread_cond_t *cond)
+{
+    if (!atomic_load(nb_wait))
+        return;
+    pthread_mutex_lock(&mq->lock);
+    pthread_cond_signal(cond);
+    pthread_mutex_unlock(&mq->lock);
 }
 
 #endif /* HAVE_THREADS */
@@ -162,10 +265,27 @@ int av_thread_message_queue_send(AVThreadMessageQueue *mq,
 #if HAVE_THREADS
     int ret;
 
-    pthread_mutex_lock(&mq->lock);
-    ret = av_thread_message_queue_send_locked(mq, msg, flags);
-    pthread_mutex_unlock(&mq->lock);
-    return ret;
+    for (int i = 0; ; i++) {
+        if ((ret = atomic_load(&mq->err_send)))
+            return ret;
+        if (!try_send(mq, msg))
+            break;
+        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+            return AVERROR(EAGAIN);
+        if (i < mq->spin)
+            continue;
+
+        pthread_mutex_lock(&mq->lock);
+        atomic_fetch_add(&mq->nb_wait_send, 1);
+        while (!atomic_load(&mq->err_send) && !can_send(mq))
+            pthread_cond_wait(&mq->cond_send, &mq->lock);
+        atomic_fetch_sub(&mq->nb_wait_send, 1);
+        pthread_mutex_unlock(&mq->lock);
+    }
+
+    /* one message is sent, signal one receiver */
+    wake_one(mq, &mq->nb_wait_recv, &mq->cond_recv);
+    return 0;
 #else
     return AVERROR(ENOSYS);
 #endif /* HAVE_THREADS */
@@ -178,10 +298,27 @@ int av_thread_message_queue_recv(AVThreadMessageQueue *mq,
 #if HAVE_THREADS
     int ret;
 
-    pthread_mutex_lock(&mq->lock);
-    ret = av_thread_message_queue_recv_locked(mq, msg, flags);
-    pthread_mutex_unlock(&mq->lock);
-    return ret;
+    for (int i = 0; ; i++) {
+        if (!try_recv(mq, msg))
+            break;
+        if ((ret = atomic_load(&mq->err_recv)))
+            return ret;
+        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+            return AVERROR(EAGAIN);
+        if (i < mq->spin)
+            continue;
+
+        pthread_mutex_lock(&mq->lock);
+        atomic_fetch_add(&mq->nb_wait_recv, 1);
+        while (!atomic_load(&mq->err_recv) && !can_recv(mq))
+            pthread_cond_wait(&mq->cond_recv, &mq->lock);
+        atomic_fetch_sub(&mq->nb_wait_recv, 1);
+        pthread_mutex_unlock(&mq->lock);
+    }
+
+    /* one message space appeared, signal one sender */
+    wake_one(mq, &mq->nb_wait_send, &mq->cond_send);
+    return 0;
 #else
     return AVERROR(ENOSYS);
 #endif /* HAVE_THREADS */
@@ -192,7 +329,7 @@ void av_thread_message_queue_set_err_send(AVThreadMessageQueue *mq,
 {
 #if HAVE_THREADS
     pthread_mutex_lock(&mq->lock);
-    mq->err_send = err;
+    atomic_store(&mq->err_send, err);
     pthread_cond_broadcast(&mq->cond_send);
     pthread_mutex_unlock(&mq->lock);
 #endif /* HAVE_THREADS */
@@ -203,34 +340,22 @@ void av_thread_message_queue_set_err_recv(AVThreadMessageQueue *mq,
 {
 #if HAVE_THREADS
     pthread_mutex_lock(&mq->lock);
-    mq->err_recv = err;
+    atomic_store(&mq->err_recv, err);
     pthread_cond_broadcast(&mq->cond_recv);
     pthread_mutex_unlock(&mq->lock);
 #endif /* HAVE_THREADS */
 }
 
-#if HAVE_THREADS
-static int free_func_wrap(void *arg, void *buf, size_t *nb_elems)
-{
-    AVThreadMessageQueue *mq = arg;
-    uint8_t *msg = buf;
-    for (size_t i = 0; i < *nb_elems; i++)
-        mq->free_func(msg + i * mq->elsize);
-    return 0;
-}
-#endif
-
 void av_thread_message_flush(AVThreadMessageQueue *mq)
 {
 #if HAVE_THREADS
-    size_t used;
-
-    pthread_mutex_lock(&mq->lock);
-    used = av_fifo_can_read(mq->fifo);
     if (mq->free_func)
-        av_fifo_read_to_cb(mq->fifo, free_func_wrap, mq, &used);
+        while (!try_recv(mq, NULL))
+            ;
+
     /* only the senders need to be notified since the queue is empty and there
      * is nothing to read */
+    pthread_mutex_lock(&mq->lock);
     pthread_cond_broadcast(&mq->cond_send);
     pthread_mutex_unlock(&mq->lock);
 #endif /* HAVE_THREADS */
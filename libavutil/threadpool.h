@@ -0,0 +1,74 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_THREADPOOL_H
+#define AVUTIL_THREADPOOL_H
+
+/**
+ * @file
+ * @ingroup lavu_threadpool
+ * Shared thread pool.
+ */
+
+/**
+ * @defgroup lavu_threadpool Thread pool
+ * @ingroup lavu_data
+ *
+ * A set of worker threads that may be shared by any number of codec, filter
+ * graph and scaling contexts, instead of each of them creating its own
+ * threads for slice threading.
+ *
+ * Every execution of parallel jobs is run by the calling thread together
+ * with whichever pool threads are idle, all of them taking jobs from a common
+ * counter. The total number of threads thus stays bounded by the pool size,
+ * no matter how many contexts use it.
+ *
+ * @{
+ */
+
+typedef struct AVThreadPool AVThreadPool;
+
+/**
+ * Allocate a thread pool and start its threads.
+ *
+ * @param ppool      the pool is returned here
+ * @param nb_threads number of threads in the pool, 0 for the number of
+ *                   available CPUs
+ * @return 0 on success, a negative AVERROR code on failure; AVERROR(ENOSYS)
+ *         if FFmpeg was built without threading support
+ */
+int av_thread_pool_alloc(AVThreadPool **ppool, int nb_threads);
+
+/**
+ * @return the number of threads in the pool
+ */
+int av_thread_pool_nb_threads(const AVThreadPool *pool);
+
+/**
+ * Stop the threads of the pool and free it. All the contexts using the pool
+ * must have been freed before.
+ *
+ * @param ppool pointer to the pool, set to NULL
+ */
+void av_thread_pool_free(AVThreadPool **ppool);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_THREADPOOL_H */
@@ -0,0 +1,130 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#if HAVE_W32THREADS
+#include <windows.h>
+#endif
+
+#include "error.h"
+#include "file_open.h"
+#include "thread.h"
+#include "time.h"
+#include "trace.h"
+
+static atomic_int trace_enabled = ATOMIC_VAR_INIT(0);
+static AVMutex trace_mutex = AV_MUTEX_INITIALIZER;
+static FILE *trace_file;
+static int64_t trace_epoch;
+static int trace_nb_events;
+
+static int64_t thread_id(void)
+{
+#if HAVE_PTHREADS
+    return (intptr_t)pthread_self();
+#elif HAVE_W32THREADS
+    return GetCurrentThreadId();
+#else
+    return 0;
+#endif
+}
+
+static void write_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; s && *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', f);
+        if ((unsigned char)*s >= 0x20)
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+int av_trace_open(const char *filename)
+{
+    FILE *f = avpriv_fopen_utf8(filename, "w");
+    if (!f)
+        return AVERROR(errno);
+
+    av_trace_close();
+
+    ff_mutex_lock(&trace_mutex);
+    trace_file      = f;
+    trace_epoch     = av_gettime_relative();
+    trace_nb_events = 0;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    atomic_store_explicit(&trace_enabled, 1, memory_order_release);
+    ff_mutex_unlock(&trace_mutex);
+
+    return 0;
+}
+
+void av_trace_close(void)
+{
+    ff_mutex_lock(&trace_mutex);
+    atomic_store_explicit(&trace_enabled, 0, memory_order_relaxed);
+    if (trace_file) {
+        fputs("\n]}\n", trace_file);
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    ff_mutex_unlock(&trace_mutex);
+}
+
+int av_trace_enabled(void)
+{
+    return atomic_load_explicit(&trace_enabled, memory_order_relaxed);
+}
+
+void av_trace_begin(AVTraceSpan *span, const char *category, const char *name)
+{
+    span->category = category;
+    span->name     = name;
+    span->start    = av_trace_enabled() ? av_gettime_relative() : INT64_MIN;
+}
+
+void av_trace_end(AVTraceSpan *span)
+{
+    int64_t end;
+
+    if (span->start == INT64_MIN || !av_trace_enabled())
+        return;
+    end = av_gettime_relative();
+
+    ff_mutex_lock(&trace_mutex);
+    if (trace_file && span->start >= trace_epoch) {
+        FILE *f = trace_file;
+        fputs(trace_nb_events++ ? ",\n{\"name\":" : "{\"name\":", f);
+        write_string(f, span->name);
+        fputs(",\"cat\":", f);
+        write_string(f, span->category);
+        fprintf(f, ",\"ph\":\"X\",\"ts\":%"PRId64",\"dur\":%"PRId64
+                ",\"pid\":1,\"tid\":%"PRId64"}",
+                span->start - trace_epoch, end - span->start, thread_id());
+    }
+    ff_mutex_unlock(&trace_mutex);
+
+    span->start = INT64_MIN;
+}
@@ -0,0 +1,99 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_trace
+ * Runtime tracing of processing stages.
+ */
+
+#ifndef AVUTIL_TRACE_H
+#define AVUTIL_TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup lavu_trace Tracing
+ * @ingroup lavu_misc
+ *
+ * Record the duration of processing stages, such as demuxing, decoding,
+ * filtering, encoding and muxing, to a file in the Chrome trace event
+ * format, which can be loaded in chrome://tracing or the Perfetto UI.
+ *
+ * Tracing is process-wide. While it is disabled, av_trace_begin() and
+ * av_trace_end() only check a flag and return.
+ *
+ * @{
+ */
+
+/**
+ * A traced span of time. It is normally a local variable of the function
+ * doing the work, opened with av_trace_begin() and closed with
+ * av_trace_end() on the same thread.
+ */
+typedef struct AVTraceSpan {
+    const char *category;
+    const char *name;
+    /**
+     * Start time in microseconds, or INT64_MIN if tracing was disabled
+     * when the span was opened.
+     */
+    int64_t start;
+} AVTraceSpan;
+
+/**
+ * Start writing trace events to a file. Any previous trace file is closed.
+ *
+ * @param filename file to write the trace to
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_trace_open(const char *filename);
+
+/**
+ * Stop tracing and finalize the trace file. Does nothing if tracing was
+ * not enabled.
+ *
+ * Must not be called while other threads may still be closing spans.
+ */
+void av_trace_close(void);
+
+/**
+ * @return nonzero if tracing is currently enabled
+ */
+int av_trace_enabled(void);
+
+/**
+ * Open a span.
+ *
+ * @param span     span to open
+ * @param category category of the event, e.g. "decode"
+ * @param name     name of the event, e.g. the codec or filter name; both
+ *                 strings must stay valid until av_trace_end() is called
+ */
+void av_trace_begin(AVTraceSpan *span, const char *category, const char *name);
+
+/**
+ * Close a span opened with av_trace_begin() and write it to the trace.
+ */
+void av_trace_end(AVTraceSpan *span);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_TRACE_H */
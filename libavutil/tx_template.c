@@ -1294,16 +1294,22 @@ static void TX_NAME(ff_tx_mdct_fwd)(AVTXContext *s, void *_dst, void *_src,
 
     s->fn[0](&s->sub[0], z, z, sizeof(TXComplex));
 
+    /* The output overlaps the FFT's buffer, so only write what was read */
     for (int i = 0; i < len4; i++) {
         const int i0 = len4 + i, i1 = len4 - i - 1;
         TXComplex src1 = { z[i1].re, z[i1].im };
         TXComplex src0 = { z[i0].re, z[i0].im };
 
-        CMUL(dst[2*i1*stride + stride], dst[2*i0*stride], src0.re, src0.im,
+        CMUL(dst[2*i1 + 1], dst[2*i0], src0.re, src0.im,
              exp[i0].im, exp[i0].re);
-        CMUL(dst[2*i0*stride + stride], dst[2*i1*stride], src1.re, src1.im,
+        CMUL(dst[2*i0 + 1], dst[2*i1], src1.re, src1.im,
              exp[i1].im, exp[i1].re);
     }
+
+    /* Going backwards never overwrites a sample which is still to be moved */
+    if (stride > 1)
+        for (int i = s->len - 1; i > 0; i--)
+            dst[i*stride] = dst[i];
 }
 
 static void TX_NAME(ff_tx_mdct_inv)(AVTXContext *s, void *_dst, void *_src,
@@ -16,7 +16,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+
 #include "avassert.h"
+#include "avstring.h"
+#include "file_open.h"
+#include "random_seed.h"
+#include "sha.h"
 
 #include "vulkan.h"
 #include "vulkan_loader.h"
@@ -846,6 +853,111 @@ void ff_vk_print_shader(void *ctx, FFVkSPIRVShader *shd, int prio)
     av_bprint_finalize(&buf, NULL);
 }
 
+/**
+ * Build the path of the SPIR-V cache entry for a shader, or return NULL if
+ * the shader cache is disabled.
+ *
+ * The cache directory is taken from the AV_VULKAN_SHADER_CACHE environment
+ * variable; entries are keyed by a hash of the compiler, stage, entrypoint
+ * and GLSL source. SPIR-V is device independent, so the device is not part
+ * of the key.
+ */
+static char *vk_shader_cache_path(FFVkSPIRVShader *shd, const char *entrypoint)
+{
+    const char *dir = getenv("AV_VULKAN_SHADER_CACHE");
+    const char *compiler = CONFIG_LIBGLSLANG ? "glslang" : "shaderc";
+    uint32_t stage = shd->shader.stage;
+    struct AVSHA *sha;
+    uint8_t digest[32];
+    char hex[2 * sizeof(digest) + 1];
+
+    if (!dir || !*dir)
+        return NULL;
+
+    sha = av_sha_alloc();
+    if (!sha)
+        return NULL;
+    av_sha_init(sha, 256);
+    av_sha_update(sha, (const uint8_t *)compiler, strlen(compiler) + 1);
+    av_sha_update(sha, (const uint8_t *)&stage, sizeof(stage));
+    av_sha_update(sha, (const uint8_t *)entrypoint, strlen(entrypoint) + 1);
+    av_sha_update(sha, (const uint8_t *)shd->src.str, shd->src.len);
+    av_sha_final(sha, digest);
+    av_free(sha);
+
+    for (int i = 0; i < sizeof(digest); i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+
+    return av_asprintf("%s/%s.spv", dir, hex);
+}
+
+static int vk_shader_cache_load(FFVulkanContext *s, const char *path,
+                                uint8_t **spirv, size_t *spirv_size)
+{
+    uint8_t *data;
+    FILE *file;
+    long len;
+
+    file = avpriv_fopen_utf8(path, "rb");
+    if (!file)
+        return AVERROR(ENOENT);
+
+    if (fseek(file, 0, SEEK_END) < 0 || (len = ftell(file)) <= 0 ||
+        len % 4 || fseek(file, 0, SEEK_SET) < 0) {
+        fclose(file);
+        return AVERROR_INVALIDDATA;
+    }
+
+    data = av_malloc(len);
+    if (!data) {
+        fclose(file);
+        return AVERROR(ENOMEM);
+    }
+
+    if (fread(data, 1, len, file) != len) {
+        av_free(data);
+        fclose(file);
+        return AVERROR(EIO);
+    }
+    fclose(file);
+
+    *spirv      = data;
+    *spirv_size = len;
+
+    return 0;
+}
+
+static void vk_shader_cache_store(FFVulkanContext *s, const char *path,
+                                  const uint8_t *spirv, size_t spirv_size)
+{
+    char *tmp_path = av_asprintf("%s.%08"PRIx32, path, av_get_random_seed());
+    FILE *file;
+
+    if (!tmp_path)
+        return;
+
+    /* Write to a temporary file and rename it, so that concurrent
+     * processes never see a partially written entry. */
+    file = avpriv_fopen_utf8(tmp_path, "wb");
+    if (!file) {
+        av_log(s, AV_LOG_WARNING, "Unable to create shader cache entry %s\n",
+               tmp_path);
+        av_free(tmp_path);
+        return;
+    }
+
+    if (fwrite(spirv, 1, spirv_size, file) != spirv_size) {
+        fclose(file);
+        remove(tmp_path);
+    } else {
+        fclose(file);
+        if (rename(tmp_path, path) < 0)
+            remove(tmp_path);
+    }
+
+    av_free(tmp_path);
+}
+
 int ff_vk_compile_shader(FFVulkanContext *s, FFVkSPIRVShader *shd,
                          const char *entrypoint)
 {
@@ -853,31 +965,49 @@ int ff_vk_compile_shader(FFVulkanContext *s, FFVkSPIRVShader *shd,
     VkResult ret;
     FFVulkanFunctions *vk = &s->vkfn;
     VkShaderModuleCreateInfo shader_create;
-    uint8_t *spirv;
+    uint8_t *spirv, *cached = NULL;
     size_t spirv_size;
-    void *priv;
+    char *cache_path;
+    void *priv = NULL;
 
     shd->shader.pName = entrypoint;
 
-    if (!s->spirv_compiler) {
+    cache_path = vk_shader_cache_path(shd, entrypoint);
+    if (cache_path &&
+        vk_shader_cache_load(s, cache_path, &cached, &spirv_size) >= 0) {
+        spirv = cached;
+        av_log(s, AV_LOG_VERBOSE, "Shader %s loaded from cache! Size: %zu bytes\n",
+               shd->name, spirv_size);
+    } else {
+        if (!s->spirv_compiler) {
 #if CONFIG_LIBGLSLANG
-        s->spirv_compiler = ff_vk_glslang_init();
+            s->spirv_compiler = ff_vk_glslang_init();
 #elif CONFIG_LIBSHADERC
-        s->spirv_compiler = ff_vk_shaderc_init();
+            s->spirv_compiler = ff_vk_shaderc_init();
 #else
-        return AVERROR(ENOSYS);
+            av_free(cache_path);
+            return AVERROR(ENOSYS);
 #endif
-        if (!s->spirv_compiler)
-            return AVERROR(ENOMEM);
-    }
+            if (!s->spirv_compiler) {
+                av_free(cache_path);
+                return AVERROR(ENOMEM);
+            }
+        }
 
-    err = s->spirv_compiler->compile_shader(s->spirv_compiler, s, shd, &spirv,
-                                            &spirv_size, entrypoint, &priv);
-    if (err < 0)
-        return err;
+        err = s->spirv_compiler->compile_shader(s->spirv_compiler, s, shd, &spirv,
+                                                &spirv_size, entrypoint, &priv);
+        if (err < 0) {
+            av_free(cache_path);
+            return err;
+        }
 
-    av_log(s, AV_LOG_VERBOSE, "Shader %s compiled! Size: %zu bytes\n",
-           shd->name, spirv_size);
+        av_log(s, AV_LOG_VERBOSE, "Shader %s compiled! Size: %zu bytes\n",
+               shd->name, spirv_size);
+
+        if (cache_path)
+            vk_shader_cache_store(s, cache_path, spirv, spirv_size);
+    }
+    av_free(cache_path);
 
     shader_create.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     shader_create.pNext    = NULL;
@@ -888,7 +1018,10 @@ int ff_vk_compile_shader(FFVulkanContext *s, FFVkSPIRVShader *shd,
     ret = vk->CreateShaderModule(s->hwctx->act_dev, &shader_create, NULL,
                                  &shd->shader.module);
 
-    s->spirv_compiler->free_shader(s->spirv_compiler, &priv);
+    if (cached)
+        av_free(cached);
+    else
+        s->spirv_compiler->free_shader(s->spirv_compiler, &priv);
 
     if (ret != VK_SUCCESS) {
         av_log(s, AV_LOG_ERROR, "Unable to create shader module: %s\n",
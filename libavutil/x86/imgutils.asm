@@ -51,3 +51,36 @@ cglobal image_copy_plane_uc_from, 6, 7, 4, dst, dst_linesize, src, src_linesize,
     jnz .row_start
 
     RET
+
+; Same loop, but plain loads and non-temporal stores: used for planes too
+; large to stay in cache, where the stores would only evict other data.
+INIT_XMM sse2
+cglobal image_copy_plane_nt, 6, 7, 4, dst, dst_linesize, src, src_linesize, bw, height, rowpos
+    add dstq, bwq
+    add srcq, bwq
+    neg bwq
+
+.row_start:
+    mov rowposq, bwq
+
+.loop:
+    mova m0, [srcq + rowposq + 0 * mmsize]
+    mova m1, [srcq + rowposq + 1 * mmsize]
+    mova m2, [srcq + rowposq + 2 * mmsize]
+    mova m3, [srcq + rowposq + 3 * mmsize]
+
+    movnta  [dstq + rowposq + 0 * mmsize], m0
+    movnta  [dstq + rowposq + 1 * mmsize], m1
+    movnta  [dstq + rowposq + 2 * mmsize], m2
+    movnta  [dstq + rowposq + 3 * mmsize], m3
+
+    add rowposq, 4 * mmsize
+    jnz .loop
+
+    add srcq, src_linesizeq
+    add dstq, dst_linesizeq
+    dec heightd
+    jnz .row_start
+
+    sfence
+    RET
@@ -18,6 +18,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "libavutil/cpu.h"
 #include "libavutil/error.h"
@@ -46,3 +47,34 @@ int ff_image_copy_plane_uc_from_x86(uint8_t       *dst, ptrdiff_t dst_linesize,
 
     return 0;
 }
+
+void ff_image_copy_plane_nt_sse2(uint8_t *dst, ptrdiff_t dst_linesize,
+                                 const uint8_t *src, ptrdiff_t src_linesize,
+                                 ptrdiff_t bytewidth, int height);
+
+int ff_image_copy_plane_nt_x86(uint8_t       *dst, ptrdiff_t dst_linesize,
+                               const uint8_t *src, ptrdiff_t src_linesize,
+                               ptrdiff_t bytewidth, int height)
+{
+    int cpu_flags = av_get_cpu_flags();
+    ptrdiff_t bw_aligned = bytewidth & ~63;
+
+    /* Unlike the uc_from case, dst may be a window into a larger picture,
+     * so nothing past bytewidth may be written: the tail of each line
+     * goes through memcpy. */
+    if (EXTERNAL_SSE2(cpu_flags) && bw_aligned &&
+        !(((uintptr_t)dst | (uintptr_t)src | dst_linesize | src_linesize) & 15)) {
+        ff_image_copy_plane_nt_sse2(dst, dst_linesize, src, src_linesize,
+                                    bw_aligned, height);
+        if (bytewidth > bw_aligned) {
+            for (; height > 0; height--) {
+                memcpy(dst + bw_aligned, src + bw_aligned, bytewidth - bw_aligned);
+                dst += dst_linesize;
+                src += src_linesize;
+            }
+        }
+    } else
+        return AVERROR(ENOSYS);
+
+    return 0;
+}
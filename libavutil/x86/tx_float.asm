@@ -1769,6 +1769,168 @@ cglobal mdct_inv_float, 4, 14, 16, 320, ctx, out, in, stride, len, lut, exp, t1,
 IMDCT_FN avx2
 %endif
 
+; Folds and pre-rotates 4 complex values, then scatters them using the map.
+; %1 - 0 for the first half of the input, 1 for the second one
+%macro MDCT_FWD_PRE 1
+    movsldup m0, m0                  ; A re re
+    movshdup m1, m1                  ; B
+    movsldup m2, m2                  ; C/F re re
+    movshdup m3, m3                  ; D
+
+    movaps m4, [expq]                ; tab
+    vpermpd m1, m1, q0123            ; flip
+    vpermpd m3, m3, q0123            ; flip
+    shufps m5, m4, m4, q2301         ; tab imre
+
+%if %1
+    addps m0, m1                     ; -re = A + B
+    subps m2, m3, m2                 ; -im = D - F
+    subps m0, m15, m0                ; re
+%else
+    subps m0, m1, m0                 ; re = B - A
+    addps m2, m3                     ; -im = C + D
+%endif
+
+    mulps m2, m4
+    fmaddsubps m0, m0, m5, m2
+
+    vextractf128 xm1, m0, 1
+
+    ; scatter
+    movsxd strideq, dword [lutq + 0*4]
+    movsxd t4q,     dword [lutq + 1*4]
+    movsxd t5q,     dword [lutq + 2*4]
+    movsxd btmpq,   dword [lutq + 3*4]
+
+    movlps [outq + strideq*8], xm0
+    movhps [outq + t4q*8],     xm0
+    movlps [outq + t5q*8],     xm1
+    movhps [outq + btmpq*8],   xm1
+
+    add lutq, mmsize/2
+    add expq, mmsize
+%endmacro
+
+; The post-rotation is done in place with a unit stride, the output is then
+; spread out to the requested stride.
+%macro MDCT_FWD_FN 1
+INIT_YMM %1
+cglobal mdct_fwd_float, 4, 14, 16, 320, ctx, out, in, stride, len, lut, exp, t1, t2, t3, \
+                                        t4, t5, btmp, ostride
+    mov ostrideq, strideq            ; the FFT call preserves the last 4 GPRs
+    movsxd lenq, dword [ctxq + AVTXContext.len]
+    mov expq, [ctxq + AVTXContext.exp]
+    mov lutq, [ctxq + AVTXContext.map]
+
+    lea t1q, [inq + lenq*2]          ; in + len2, forwards
+    lea t2q, [inq + lenq*2 - mmsize] ; in + len2, backwards
+    mov t3q, lenq
+    shr t3q, 2                       ; len4
+
+    xorps m15, m15                   ; zero
+
+.pre_lo:
+    movups m0, [t1q]                 ; in[len2 + k]
+    movups m1, [t2q]                 ; in[len2 - 1 - k]
+    movups m2, [t1q + lenq*4]        ; in[len3 + k]
+    movups m3, [t2q + lenq*4]        ; in[len3 - 1 - k]
+
+    MDCT_FWD_PRE 0
+
+    add t1q, mmsize
+    sub t2q, mmsize
+    sub t3q, mmsize/8
+    jg .pre_lo
+
+    mov t3q, lenq
+    shr t3q, 2                       ; len4
+
+.pre_hi:
+    movups m0, [t1q]                 ; in[len2 + k]
+    movups m1, [t2q + lenq*8]        ; in[5*len2 - 1 - k]
+    movups m2, [inq]                 ; in[k - len2]
+    movups m3, [t2q + lenq*4]        ; in[len3 - 1 - k]
+
+    MDCT_FWD_PRE 1
+
+    add t1q, mmsize
+    add inq, mmsize
+    sub t2q, mmsize
+    sub t3q, mmsize/8
+    jg .pre_hi
+
+.transform:
+    mov strideq, 2*4
+    mov t4q, ctxq                      ; backup original context
+    mov t5q, [ctxq + AVTXContext.fn]   ; subtransform's jump point
+    mov ctxq, [ctxq + AVTXContext.sub]
+    mov lutq, [ctxq + AVTXContext.map]
+    movsxd lenq, dword [ctxq + AVTXContext.len]
+
+    mov inq, outq                    ; in-place transform
+    call t5q                         ; call the FFT
+
+    mov ctxq, t4q                    ; restore original context
+    movsxd lenq, dword [ctxq + AVTXContext.len]
+    mov expq, [ctxq + AVTXContext.exp]
+
+    xor t1q, t1q                     ; low
+    lea t2q, [lenq*4 - mmsize]       ; high
+
+.post:
+    movaps m2, [expq + t2q]          ; tab h
+    movaps m3, [expq + t1q]          ; tab l
+    movups m0, [outq + t2q]          ; in h
+    movups m1, [outq + t1q]          ; in l
+
+    shufps m4, m2, m2, q2301         ; tab h imre
+    shufps m5, m3, m3, q2301         ; tab l imre
+    movshdup m6, m0                  ; in h imim
+    movshdup m7, m1                  ; in l imim
+    movsldup m0, m0                  ; in h rere
+    movsldup m1, m1                  ; in l rere
+
+    mulps m6, m4
+    mulps m7, m5
+
+    fmsubaddps m0, m0, m2, m6        ; conj(in h) * tab h
+    fmsubaddps m1, m1, m3, m7        ; conj(in l) * tab l
+
+    vpermpd m2, m0, q0123            ; flip
+    vpermpd m3, m1, q0123            ; flip
+
+    blendps m1, m1, m2, 10101010b
+    blendps m0, m0, m3, 10101010b
+
+    movups [outq + t2q], m0
+    movups [outq + t1q], m1
+
+    add t1q, mmsize
+    sub t2q, mmsize
+    sub lenq, mmsize/2
+    jg .post
+
+    cmp ostrideq, 4
+    je .end
+
+    movsxd t1q, dword [ctxq + AVTXContext.len]
+    dec t1q                          ; going backwards never overwrites
+.spread:                             ; a sample that is still to be moved
+    movss xm0, [outq + t1q*4]
+    mov t2q, t1q
+    imul t2q, ostrideq
+    movss [outq + t2q], xm0
+    dec t1q
+    jg .spread
+
+.end:
+    RET
+%endmacro
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+MDCT_FWD_FN avx2
+%endif
+
 %macro PFA_15_FN 2
 INIT_YMM %1
 %if %2
@@ -894,7 +894,10 @@ void  pp_postprocess(const uint8_t * src[3], const int srcStride[3],
     int mbHeight= (height+15)>>4;
     PPMode *mode = vm;
     PPContext *c = vc;
-    int minStride= FFMAX(FFABS(srcStride[0]), FFABS(dstStride[0]));
+    int doLuma = src[0] && dst[0];
+    int minStride= doLuma ? FFMAX(FFABS(srcStride[0]), FFABS(dstStride[0])) :
+                   FFMAX(FFMAX(FFABS(srcStride[1]), FFABS(dstStride[1])),
+                         FFMAX(FFABS(srcStride[2]), FFABS(dstStride[2])));
     int absQPStride = FFABS(QPStride);
 
     // c->stride and c->QPStride are always positive
@@ -960,8 +963,9 @@ void  pp_postprocess(const uint8_t * src[3], const int srcStride[3],
     av_log(c, AV_LOG_DEBUG, "using npp filters 0x%X/0x%X\n",
            mode->lumMode, mode->chromMode);
 
-    postProcess(src[0], srcStride[0], dst[0], dstStride[0],
-                width, height, QP_store, QPStride, 0, mode, c);
+    if (doLuma)
+        postProcess(src[0], srcStride[0], dst[0], dstStride[0],
+                    width, height, QP_store, QPStride, 0, mode, c);
 
     if (!(src[1] && src[2] && dst[1] && dst[2]))
         return;
@@ -66,6 +66,14 @@ typedef void pp_mode;
 
 extern const char pp_help[]; ///< a simple help text
 
+/**
+ * Postprocess one picture.
+ *
+ * The luma plane is skipped if src[0] or dst[0] is NULL, the chroma planes
+ * are skipped if any of src[1], src[2], dst[1] or dst[2] is NULL. Since
+ * each plane only touches the state of its own context, luma and chroma
+ * may be processed concurrently with two contexts, one per call.
+ */
 void  pp_postprocess(const uint8_t * src[3], const int srcStride[3],
                      uint8_t * dst[3], const int dstStride[3],
                      int horizontalSize, int verticalSize,
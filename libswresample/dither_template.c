@@ -40,36 +40,80 @@
 ERROR
 #endif
 
+/**
+ * Shape one sample, d being the sample in units of the output quantization
+ * step. Returns the quantized sample and stores its error at next_pos.
+ */
+static av_always_inline double RENAME(noise_shape_sample)(const float *ns_coeffs, float *ns_errors,
+                                                          int taps, int pos, int next_pos,
+                                                          double d, float noise)
+{
+    double d1;
+    int j;
+
+    for (j=0; j<taps-2; j+=4) {
+        d -= ns_coeffs[j    ] * ns_errors[pos + j    ]
+            +ns_coeffs[j + 1] * ns_errors[pos + j + 1]
+            +ns_coeffs[j + 2] * ns_errors[pos + j + 2]
+            +ns_coeffs[j + 3] * ns_errors[pos + j + 3];
+    }
+    if(j < taps)
+        d -= ns_coeffs[j] * ns_errors[pos + j];
+    d1 = rint(d + noise);
+    ns_errors[next_pos + taps] = ns_errors[next_pos] = d1 - d;
+    return d1;
+}
+
 void RENAME(swri_noise_shaping)(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count){
     int pos = s->dither.ns_pos;
-    int i, j, ch;
+    int i, ch;
     int taps  = s->dither.ns_taps;
     float S   = s->dither.ns_scale;
     float S_1 = s->dither.ns_scale_1;
+    const float *ns_coeffs = s->dither.ns_coeffs;
 
     av_assert2((taps&3) != 2);
     av_assert2((taps&3) != 3 || s->dither.ns_coeffs[taps] == 0);
 
-    for (ch=0; ch<srcs->ch_count; ch++) {
+    /* The error feedback makes each channel a serial dependency chain,
+     * shape two channels at a time so that their chains overlap. */
+    for (ch=0; ch + 1<srcs->ch_count; ch+=2) {
+        const float *noise0 = ((const float *)noises->ch[ch    ]) + s->dither.noise_pos;
+        const float *noise1 = ((const float *)noises->ch[ch + 1]) + s->dither.noise_pos;
+        const DELEM *src0 = (const DELEM*)srcs->ch[ch    ];
+        const DELEM *src1 = (const DELEM*)srcs->ch[ch + 1];
+        DELEM *dst0 = (DELEM*)dsts->ch[ch    ];
+        DELEM *dst1 = (DELEM*)dsts->ch[ch + 1];
+        float *ns_errors0 = s->dither.ns_errors[ch    ];
+        float *ns_errors1 = s->dither.ns_errors[ch + 1];
+        pos  = s->dither.ns_pos;
+        for (i=0; i<count; i++) {
+            int next_pos = pos ? pos - 1 : taps - 1;
+            double d0 = RENAME(noise_shape_sample)(ns_coeffs, ns_errors0, taps, pos, next_pos,
+                                                   src0[i]*S_1, noise0[i]);
+            double d1 = RENAME(noise_shape_sample)(ns_coeffs, ns_errors1, taps, pos, next_pos,
+                                                   src1[i]*S_1, noise1[i]);
+            pos = next_pos;
+            d0 *= S;
+            d1 *= S;
+            CLIP(d0);
+            CLIP(d1);
+            dst0[i] = d0;
+            dst1[i] = d1;
+        }
+    }
+
+    if (ch < srcs->ch_count) {
         const float *noise = ((const float *)noises->ch[ch]) + s->dither.noise_pos;
         const DELEM *src = (const DELEM*)srcs->ch[ch];
         DELEM *dst = (DELEM*)dsts->ch[ch];
         float *ns_errors = s->dither.ns_errors[ch];
-        const float *ns_coeffs = s->dither.ns_coeffs;
         pos  = s->dither.ns_pos;
         for (i=0; i<count; i++) {
-            double d1, d = src[i]*S_1;
-            for(j=0; j<taps-2; j+=4) {
-                d -= ns_coeffs[j    ] * ns_errors[pos + j    ]
-                    +ns_coeffs[j + 1] * ns_errors[pos + j + 1]
-                    +ns_coeffs[j + 2] * ns_errors[pos + j + 2]
-                    +ns_coeffs[j + 3] * ns_errors[pos + j + 3];
-            }
-            if(j < taps)
-                d -= ns_coeffs[j] * ns_errors[pos + j];
-            pos = pos ? pos - 1 : taps - 1;
-            d1 = rint(d + noise[i]);
-            ns_errors[pos + taps] = ns_errors[pos] = d1 - d;
+            int next_pos = pos ? pos - 1 : taps - 1;
+            double d1 = RENAME(noise_shape_sample)(ns_coeffs, ns_errors, taps, pos, next_pos,
+                                                   src[i]*S_1, noise[i]);
+            pos = next_pos;
             d1 *= S;
             CLIP(d1);
             dst[i] = d1;
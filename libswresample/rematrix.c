@@ -21,6 +21,7 @@
 #include "swresample_internal.h"
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/slicethread.h"
 
 #define TEMPLATE_REMATRIX_FLT
 #include "rematrix_template.c"
@@ -490,6 +491,87 @@ av_cold static int auto_matrix(SwrContext *s)
     return ret;
 }
 
+static void rematrix_channel(SwrContext *s, AudioData *out, AudioData *in,
+                             int out_i, int len, int mustcopy)
+{
+    int in_i, i, j;
+    int len1 = 0;
+    int off = 0;
+
+    if(s->mix_2_1_simd || s->mix_1_1_simd){
+        len1= len&~15;
+        off = len1 * out->bps;
+    }
+
+    switch(s->matrix_ch[out_i][0]){
+    case 0:
+        if(mustcopy)
+            memset(out->ch[out_i], 0, len * av_get_bytes_per_sample(s->int_sample_fmt));
+        break;
+    case 1:
+        in_i= s->matrix_ch[out_i][1];
+        if(s->matrix[out_i][in_i]!=1.0){
+            if(s->mix_1_1_simd && len1)
+                s->mix_1_1_simd(out->ch[out_i]    , in->ch[in_i]    , s->native_simd_matrix, in->ch_count*out_i + in_i, len1);
+            if(len != len1)
+                s->mix_1_1_f   (out->ch[out_i]+off, in->ch[in_i]+off, s->native_matrix, in->ch_count*out_i + in_i, len-len1);
+        }else if(mustcopy){
+            memcpy(out->ch[out_i], in->ch[in_i], len*out->bps);
+        }else{
+            out->ch[out_i]= in->ch[in_i];
+        }
+        break;
+    case 2: {
+        int in_i1 = s->matrix_ch[out_i][1];
+        int in_i2 = s->matrix_ch[out_i][2];
+        if(s->mix_2_1_simd && len1)
+            s->mix_2_1_simd(out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_simd_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
+        else
+            s->mix_2_1_f   (out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
+        if(len != len1)
+            s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
+        break;}
+    default:
+        if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
+            for(i=0; i<len; i++){
+                float v=0;
+                for(j=0; j<s->matrix_ch[out_i][0]; j++){
+                    in_i= s->matrix_ch[out_i][1+j];
+                    v+= ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
+                }
+                ((float*)out->ch[out_i])[i]= v;
+            }
+        }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
+            for(i=0; i<len; i++){
+                double v=0;
+                for(j=0; j<s->matrix_ch[out_i][0]; j++){
+                    in_i= s->matrix_ch[out_i][1+j];
+                    v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
+                }
+                ((double*)out->ch[out_i])[i]= v;
+            }
+        }else{
+            for(i=0; i<len; i++){
+                int v=0;
+                for(j=0; j<s->matrix_ch[out_i][0]; j++){
+                    in_i= s->matrix_ch[out_i][1+j];
+                    v+= ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
+                }
+                ((int16_t*)out->ch[out_i])[i]= (v + 16384)>>15;
+            }
+        }
+    }
+}
+
+static void rematrix_worker(void *priv, int jobnr, int threadnr,
+                            int nb_jobs, int nb_threads)
+{
+    SwrContext *s = priv;
+
+    rematrix_channel(s, s->rematrix_out, s->rematrix_in, jobnr,
+                     s->rematrix_len, s->rematrix_mustcopy);
+}
+
 av_cold int swri_rematrix_init(SwrContext *s){
     int i, j;
     int nb_in  = s->used_ch_count;
@@ -589,6 +671,14 @@ av_cold int swri_rematrix_init(SwrContext *s){
         s->matrix_ch[i][0]= ch_in;
     }
 
+    // the output channels are mixed independently of each other
+    if (s->nb_threads != 1 && nb_out > 1 && !s->mix_any_f) {
+        int ret = avpriv_slicethread_create(&s->rematrix_thread, s, rematrix_worker,
+                                            NULL, s->nb_threads);
+        if (ret < 0 && ret != AVERROR(ENOSYS))
+            return ret;
+    }
+
 #if ARCH_X86 && HAVE_X86ASM && HAVE_MMX
     return swri_rematrix_init_x86(s);
 #endif
@@ -597,6 +687,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
 }
 
 av_cold void swri_rematrix_free(SwrContext *s){
+    avpriv_slicethread_free(&s->rematrix_thread);
     av_freep(&s->native_matrix);
     av_freep(&s->native_one);
     av_freep(&s->native_simd_matrix);
@@ -604,82 +695,26 @@ av_cold void swri_rematrix_free(SwrContext *s){
 }
 
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
-    int out_i, in_i, i, j;
-    int len1 = 0;
-    int off = 0;
+    int out_i;
 
     if(s->mix_any_f) {
         s->mix_any_f(out->ch, (const uint8_t **)in->ch, s->native_matrix, len);
         return 0;
     }
 
-    if(s->mix_2_1_simd || s->mix_1_1_simd){
-        len1= len&~15;
-        off = len1 * out->bps;
-    }
-
     av_assert0(s->out_ch_layout.order == AV_CHANNEL_ORDER_UNSPEC || out->ch_count == s->out_ch_layout.nb_channels);
     av_assert0(s-> in_ch_layout.order == AV_CHANNEL_ORDER_UNSPEC || in ->ch_count == s->in_ch_layout.nb_channels);
 
-    for(out_i=0; out_i<out->ch_count; out_i++){
-        switch(s->matrix_ch[out_i][0]){
-        case 0:
-            if(mustcopy)
-                memset(out->ch[out_i], 0, len * av_get_bytes_per_sample(s->int_sample_fmt));
-            break;
-        case 1:
-            in_i= s->matrix_ch[out_i][1];
-            if(s->matrix[out_i][in_i]!=1.0){
-                if(s->mix_1_1_simd && len1)
-                    s->mix_1_1_simd(out->ch[out_i]    , in->ch[in_i]    , s->native_simd_matrix, in->ch_count*out_i + in_i, len1);
-                if(len != len1)
-                    s->mix_1_1_f   (out->ch[out_i]+off, in->ch[in_i]+off, s->native_matrix, in->ch_count*out_i + in_i, len-len1);
-            }else if(mustcopy){
-                memcpy(out->ch[out_i], in->ch[in_i], len*out->bps);
-            }else{
-                out->ch[out_i]= in->ch[in_i];
-            }
-            break;
-        case 2: {
-            int in_i1 = s->matrix_ch[out_i][1];
-            int in_i2 = s->matrix_ch[out_i][2];
-            if(s->mix_2_1_simd && len1)
-                s->mix_2_1_simd(out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_simd_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
-            else
-                s->mix_2_1_f   (out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
-            if(len != len1)
-                s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
-            break;}
-        default:
-            if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
-                    float v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
-                    }
-                    ((float*)out->ch[out_i])[i]= v;
-                }
-            }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
-                    double v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((double*)out->ch[out_i])[i]= v;
-                }
-            }else{
-                for(i=0; i<len; i++){
-                    int v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
-                    }
-                    ((int16_t*)out->ch[out_i])[i]= (v + 16384)>>15;
-                }
-            }
-        }
+    if (s->rematrix_thread) {
+        s->rematrix_out      = out;
+        s->rematrix_in       = in;
+        s->rematrix_len      = len;
+        s->rematrix_mustcopy = mustcopy;
+        avpriv_slicethread_execute(s->rematrix_thread, out->ch_count, 0);
+        return 0;
     }
+
+    for(out_i=0; out_i<out->ch_count; out_i++)
+        rematrix_channel(s, out, in, out_i, len, mustcopy);
     return 0;
 }
@@ -281,13 +281,35 @@ static void resample_free(ResampleContext **cc){
     ResampleContext *c = *cc;
     if(!c)
         return;
+    avpriv_slicethread_free(&c->slicethread);
     av_freep(&c->filter_bank);
     av_freep(cc);
 }
 
+static void resample_worker(void *priv, int jobnr, int threadnr,
+                            int nb_jobs, int nb_threads)
+{
+    ResampleContext *c = priv;
+    void *dst = c->job_dst->ch[jobnr];
+    const void *src = c->job_src->ch[jobnr];
+
+    if (!c->job_func) {
+        c->dsp.resample_one(dst, src, c->job_n, c->job_index, c->job_incr);
+    } else if (jobnr == nb_jobs - 1) {
+        /* the other channels are still reading the position from c */
+        ResampleContext tmp = *c;
+
+        c->job_consumed   = c->job_func(&tmp, dst, src, c->job_n, 1);
+        c->job_next_index = tmp.index;
+        c->job_next_frac  = tmp.frac;
+    } else {
+        c->job_func(c, dst, src, c->job_n, 0);
+    }
+}
+
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta,
-                                    double precision, int cheby, int exact_rational)
+                                    double precision, int cheby, int exact_rational, int nb_threads)
 {
     double cutoff = cutoff0? cutoff0 : 0.97;
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
@@ -354,7 +376,8 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
             goto error;
         if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
             goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
+        /* keep the padding after filter_length zero, the SIMD versions read it */
+        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_length-1)*c->felem_size);
         memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
     }
 
@@ -374,10 +397,18 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
 
     swri_resample_dsp_init(c);
 
+    // the channels are resampled independently of each other
+    avpriv_slicethread_free(&c->slicethread);
+    if (nb_threads != 1) {
+        int ret = avpriv_slicethread_create(&c->slicethread, c, resample_worker,
+                                            NULL, nb_threads);
+        if (ret < 0 && ret != AVERROR(ENOSYS))
+            goto error;
+    }
+
     return c;
 error:
-    av_freep(&c->filter_bank);
-    av_free(c);
+    resample_free(&c);
     return NULL;
 }
 
@@ -403,7 +434,7 @@ static int rebuild_filter_bank_with_compensation(ResampleContext *c)
         av_freep(&new_filter_bank);
         return ret;
     }
-    memcpy(new_filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, new_filter_bank, (c->filter_alloc-1)*c->felem_size);
+    memcpy(new_filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, new_filter_bank, (c->filter_length-1)*c->felem_size);
     memcpy(new_filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, new_filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
 
     if (!av_reduce(&new_src_incr, &new_dst_incr, c->src_incr,
@@ -467,17 +498,24 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
 
         dst_size = FFMAX(FFMIN(dst_size, new_size), 0);
         if (dst_size > 0) {
-            for (i = 0; i < dst->ch_count; i++) {
-                c->dsp.resample_one(dst->ch[i], src->ch[i], dst_size, index2, incr);
-                if (i+1 == dst->ch_count) {
-                    c->index += dst_size * c->dst_incr_div;
-                    c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
-                    av_assert2(c->index >= 0);
-                    *consumed = c->index;
-                    c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
-                    c->index = 0;
-                }
+            if (c->slicethread && dst->ch_count > 1) {
+                c->job_dst   = dst;
+                c->job_src   = src;
+                c->job_n     = dst_size;
+                c->job_index = index2;
+                c->job_incr  = incr;
+                c->job_func  = NULL;
+                avpriv_slicethread_execute(c->slicethread, dst->ch_count, 0);
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    c->dsp.resample_one(dst->ch[i], src->ch[i], dst_size, index2, incr);
             }
+            c->index += dst_size * c->dst_incr_div;
+            c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
+            av_assert2(c->index >= 0);
+            *consumed = c->index;
+            c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
+            c->index = 0;
         }
     } else {
         int64_t end_index = (1LL + src_size - c->filter_length) * c->phase_count;
@@ -492,8 +530,19 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
              * when frac and dst_incr_mod are zero */
             resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
                             c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            if (c->slicethread && dst->ch_count > 1) {
+                c->job_dst  = dst;
+                c->job_src  = src;
+                c->job_n    = dst_size;
+                c->job_func = resample_func;
+                avpriv_slicethread_execute(c->slicethread, dst->ch_count, 0);
+                *consumed = c->job_consumed;
+                c->index  = c->job_next_index;
+                c->frac   = c->job_next_frac;
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            }
         }
     }
 
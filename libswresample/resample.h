@@ -58,6 +58,20 @@ typedef struct ResampleContext {
         int (*resample_linear)(struct ResampleContext *c, void *dst,
                                const void *src, int n, int update_ctx);
     } dsp;
+
+    AVSliceThread *slicethread;        ///< threads resampling the channels, if any
+
+    // values passed to the threads for the current call
+    AudioData *job_dst;
+    AudioData *job_src;
+    int job_n;
+    int64_t job_index;
+    int64_t job_incr;
+    int (*job_func)(struct ResampleContext *c, void *dst,
+                    const void *src, int n, int update_ctx);
+    int job_consumed;
+    int job_next_index;
+    int job_next_frac;
 } ResampleContext;
 
 void swri_resample_dsp_init(ResampleContext *c);
@@ -612,3 +612,215 @@ RESAMPLE_FNS double, 8, 3, d, pdbl_1
 INIT_YMM fma3
 RESAMPLE_FNS double, 8, 3, d, pdbl_1
 %endif
+
+; accumulate the filter taps of the output at index/frac into m%2 and move to
+; the next output
+%macro RESAMPLE_ONE_AVX512 4 ; format, acc, bps, label suffix
+    mov                      filterd, filter_allocd
+    imul                     filterd, indexd
+    lea                      filterq, [filter_bankq+filterq*%3]
+    mov                       countq, lenq
+%ifidn %1, int16
+    movd                        xm%2, [pd_0x4000]
+%else
+    xorps                       xm%2, xm%2
+%endif
+    test                      countq, countq
+    jz .tail%4
+.inner%4:
+    movu                          m4, [srcq+countq]
+%ifidn %1, int16
+    pmaddwd                       m4, [filterq+countq]
+    paddd                       m%2, m4
+%else
+    fmaddps                     m%2, m4, [filterq+countq], m%2
+%endif
+    add                       countq, mmsize
+    js .inner%4
+.tail%4:
+    ; the taps after the last full vector, the masked-out lanes are not read
+%ifidn %1, int16
+    vmovdqu16               m4{k1}{z}, [srcq]
+    vmovdqu16               m5{k1}{z}, [filterq]
+    pmaddwd                       m4, m5
+    paddd                       m%2, m4
+%else
+    vmovups                 m4{k1}{z}, [srcq]
+    vmovups                 m5{k1}{z}, [filterq]
+    fmaddps                     m%2, m4, m5, m%2
+%endif
+
+    add                        fracd, dst_incr_modd
+    add                       indexd, dst_incr_divd
+    cmp                        fracd, src_incrd
+    jl .skip%4
+    sub                        fracd, src_incrd
+    inc                       indexd
+.skip%4:
+    cmp                       indexd, phase_countd
+    jb .index_skip%4
+.index_while%4:
+    sub                       indexd, phase_countd
+    add                         srcq, %3
+    cmp                       indexd, phase_countd
+    jnb .index_while%4
+.index_skip%4:
+%endmacro
+
+; int resample_common_$format(ResampleContext *ctx, $format *dst,
+;                             const $format *src, int size, int update_ctx)
+;
+; Computes 4 output samples per iteration, so that the horizontal sums of
+; their accumulators are shared, and masks the taps after the last full
+; vector instead of rounding the filter length up to the vector size.
+%macro RESAMPLE_COMMON_AVX512 3 ; format, bps, log2_bps
+cglobal resample_common_%1, 5, 15, 11, ctx, dst, src, dst_end, update, index, frac, \
+                                       dst_incr_mod, dst_incr_div, src_incr, \
+                                       phase_count, filter_alloc, filter_bank, \
+                                       filter, count
+    mov                       indexd, [ctxq+ResampleContext.index]
+    mov                        fracd, [ctxq+ResampleContext.frac]
+    mov                dst_incr_modd, [ctxq+ResampleContext.dst_incr_mod]
+    mov                dst_incr_divd, [ctxq+ResampleContext.dst_incr_div]
+    mov                    src_incrd, [ctxq+ResampleContext.src_incr]
+    mov                 phase_countd, [ctxq+ResampleContext.phase_count]
+    mov                filter_allocd, [ctxq+ResampleContext.filter_alloc]
+    mov                 filter_bankq, [ctxq+ResampleContext.filter_bank]
+    movsxd                  dst_endq, dst_endd
+    lea                     dst_endq, [dstq+dst_endq*%2]
+
+    ; keep ctx and update_ctx in vector registers, for the end
+    movq                         xm8, ctxq
+    movd                        xm10, updated
+    mov                         ctxd, [ctxq+ResampleContext.filter_length]
+
+    DEFINE_ARGS len, dst, src, dst_end, tmp, index, frac, dst_incr_mod, \
+                dst_incr_div, src_incr, phase_count, filter_alloc, \
+                filter_bank, filter, count
+
+    ; mask of the taps after the last full vector
+    shl                         lend, %3
+    mov                         tmpd, lend
+    and                         tmpd, mmsize - 1
+    shr                         tmpd, %3
+    xor                       countd, countd
+    bts                       countd, tmpd
+    dec                       countd
+%ifidn %1, int16
+    kmovd                         k1, countd
+%else
+    kmovw                         k1, countd
+%endif
+    and                         lend, ~(mmsize - 1)
+    add                 filter_bankq, lenq
+    add                         srcq, lenq
+    neg                         lenq
+    movq                         xm9, srcq
+
+.loop4:
+    lea                         tmpq, [dstq+4*%2]
+    cmp                         tmpq, dst_endq
+    ja .loop1
+    RESAMPLE_ONE_AVX512 %1, 0, %2, 0
+    RESAMPLE_ONE_AVX512 %1, 1, %2, 1
+    RESAMPLE_ONE_AVX512 %1, 2, %2, 2
+    RESAMPLE_ONE_AVX512 %1, 3, %2, 3
+
+    ; sum the 4 accumulators into the 4 dwords of xm0; the registers are
+    ; xmm16-31 here, so only instructions with an EVEX encoding can be used
+%ifidn %1, int16
+    vextracti64x4                ym4, m0, 1
+    vextracti64x4                ym5, m1, 1
+    paddd                        ym0, ym4
+    paddd                        ym1, ym5
+    vextracti64x4                ym4, m2, 1
+    vextracti64x4                ym5, m3, 1
+    paddd                        ym2, ym4
+    paddd                        ym3, ym5
+    punpckldq                    ym4, ym0, ym1
+    punpckhdq                    ym0, ym1
+    paddd                        ym0, ym4
+    punpckldq                    ym4, ym2, ym3
+    punpckhdq                    ym2, ym3
+    paddd                        ym2, ym4
+    punpcklqdq                   ym4, ym0, ym2
+    punpckhqdq                   ym0, ym2
+    paddd                        ym0, ym4
+    vextracti32x4                xm1, ym0, 1
+    paddd                        xm0, xm1
+    psrad                        xm0, 15
+    packssdw                     xm0, xm0
+    movq                      [dstq], xm0
+%else
+    vextractf64x4                ym4, m0, 1
+    vextractf64x4                ym5, m1, 1
+    addps                        ym0, ym4
+    addps                        ym1, ym5
+    vextractf64x4                ym4, m2, 1
+    vextractf64x4                ym5, m3, 1
+    addps                        ym2, ym4
+    addps                        ym3, ym5
+    unpcklps                     ym4, ym0, ym1
+    unpckhps                     ym0, ym1
+    addps                        ym0, ym4
+    unpcklps                     ym4, ym2, ym3
+    unpckhps                     ym2, ym3
+    addps                        ym2, ym4
+    unpcklpd                     ym4, ym0, ym2
+    unpckhpd                     ym0, ym2
+    addps                        ym0, ym4
+    vextractf32x4                xm1, ym0, 1
+    addps                        xm0, xm1
+    movu                      [dstq], xm0
+%endif
+    add                         dstq, 4*%2
+    jmp .loop4
+
+.loop1:
+    cmp                         dstq, dst_endq
+    je .end
+    RESAMPLE_ONE_AVX512 %1, 0, %2, 4
+%ifidn %1, int16
+    vextracti64x4                ym4, m0, 1
+    paddd                        ym0, ym4
+    vextracti32x4                 xm4, ym0, 1
+    paddd                        xm0, xm4
+    HADDD                        xm0, xm4
+    psrad                        xm0, 15
+    packssdw                     xm0, xm0
+    pextrw                    [dstq], xm0, 0
+%else
+    vextractf64x4                ym4, m0, 1
+    addps                        ym0, ym4
+    vextractf32x4                 xm4, ym0, 1
+    addps                        xm0, xm4
+    movhlps                      xm4, xm0
+    addps                        xm0, xm4
+    shufps                       xm4, xm0, xm0, q0001
+    addss                        xm0, xm4
+    movss                     [dstq], xm0
+%endif
+    add                         dstq, %2
+    jmp .loop1
+
+.end:
+    movd                        tmpd, xm10
+    test                        tmpd, tmpd
+    jz .skip_store
+    movq                        tmpq, xm8
+    mov   [tmpq+ResampleContext.frac ], fracd
+    mov   [tmpq+ResampleContext.index], indexd
+    ; the consumed number of samples, only used if update_ctx is true
+    movq                      countq, xm9
+    sub                         srcq, countq
+    shr                         srcq, %3
+    mov                          eax, srcd
+.skip_store:
+    RET
+%endmacro
+
+%if ARCH_X86_64 && HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+RESAMPLE_COMMON_AVX512 float, 4, 2
+RESAMPLE_COMMON_AVX512 int16, 2, 1
+%endif
@@ -45,6 +45,11 @@ RESAMPLE_FUNCS(double, sse2);
 RESAMPLE_FUNCS(double, avx);
 RESAMPLE_FUNCS(double, fma3);
 
+int ff_resample_common_int16_avx512(ResampleContext *c, void *dst,
+                                    const void *src, int sz, int upd);
+int ff_resample_common_float_avx512(ResampleContext *c, void *dst,
+                                    const void *src, int sz, int upd);
+
 av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
 {
     int av_unused mm_flags = av_get_cpu_flags();
@@ -59,6 +64,10 @@ av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
             c->dsp.resample_linear = ff_resample_linear_int16_xop;
             c->dsp.resample_common = ff_resample_common_int16_xop;
         }
+#if ARCH_X86_64
+        if (EXTERNAL_AVX512(mm_flags))
+            c->dsp.resample_common = ff_resample_common_int16_avx512;
+#endif
         break;
     case AV_SAMPLE_FMT_FLTP:
         if (EXTERNAL_SSE(mm_flags)) {
@@ -77,6 +86,10 @@ av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
             c->dsp.resample_linear = ff_resample_linear_float_fma4;
             c->dsp.resample_common = ff_resample_common_float_fma4;
         }
+#if ARCH_X86_64
+        if (EXTERNAL_AVX512(mm_flags))
+            c->dsp.resample_common = ff_resample_common_float_avx512;
+#endif
         break;
     case AV_SAMPLE_FMT_DBLP:
         if (EXTERNAL_SSE2(mm_flags)) {
@@ -878,6 +878,76 @@ static int scale_cascaded(SwsContext *c,
     return ret;
 }
 
+/* byte offsets of column x in the planes of an image */
+static void tile_offsets(ptrdiff_t offset[4], enum AVPixelFormat format, int x)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    int done = 0;
+
+    memset(offset, 0, 4 * sizeof(*offset));
+    for (int i = 0; i < desc->nb_components; i++) {
+        const AVComponentDescriptor *comp = &desc->comp[i];
+        const int shift = (i == 1 || i == 2) ? desc->log2_chroma_w : 0;
+
+        if (done & (1 << comp->plane))
+            continue;
+        offset[comp->plane] = (ptrdiff_t)(x >> shift) * comp->step;
+        done |= 1 << comp->plane;
+    }
+}
+
+void ff_sws_tile_worker(void *priv, int jobnr, int threadnr,
+                        int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext      *c = parent->tile_ctx[jobnr];
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+    ptrdiff_t src_offset[4], dst_offset[4];
+
+    tile_offsets(src_offset, c->srcFormat, c->tile_src_x);
+    tile_offsets(dst_offset, c->dstFormat, c->tile_dst_x);
+    for (int i = 0; i < 4; i++) {
+        src[i] = parent->tile_src[i] ? parent->tile_src[i] + src_offset[i] : NULL;
+        dst[i] = parent->tile_dst[i] ? parent->tile_dst[i] + dst_offset[i] : NULL;
+    }
+    // modified by swscale()
+    memcpy(srcStride, parent->tile_src_stride, sizeof(srcStride));
+    memcpy(dstStride, parent->tile_dst_stride, sizeof(dstStride));
+
+    parent->tile_err[jobnr] = swscale(c, src, srcStride, 0, c->srcH, dst, dstStride,
+                                      parent->tile_dst_slice_start,
+                                      parent->tile_dst_slice_height);
+}
+
+static int scale_tiles(SwsContext *c, const uint8_t *src[4], const int srcStride[4],
+                       uint8_t *dst[4], const int dstStride[4],
+                       int dstSliceY, int dstSliceH)
+{
+    int ret;
+
+    memcpy(c->tile_src,        src,       sizeof(c->tile_src));
+    memcpy(c->tile_dst,        dst,       sizeof(c->tile_dst));
+    memcpy(c->tile_src_stride, srcStride, sizeof(c->tile_src_stride));
+    memcpy(c->tile_dst_stride, dstStride, sizeof(c->tile_dst_stride));
+    c->tile_dst_slice_start  = dstSliceY;
+    c->tile_dst_slice_height = dstSliceH;
+
+    if (c->tilethread)
+        avpriv_slicethread_execute(c->tilethread, c->nb_tile_ctx, 0);
+    else
+        for (int i = 0; i < c->nb_tile_ctx; i++)
+            ff_sws_tile_worker(c, i, 0, c->nb_tile_ctx, 1);
+
+    ret = c->tile_err[0];
+    for (int i = 1; i < c->nb_tile_ctx; i++)
+        if (c->tile_err[i] < 0)
+            ret = c->tile_err[i];
+
+    return ret;
+}
+
 static int scale_internal(SwsContext *c,
                           const uint8_t * const srcSlice[], const int srcStride[],
                           int srcSliceY, int srcSliceH,
@@ -1041,6 +1111,9 @@ static int scale_internal(SwsContext *c,
                                   dst2, dstStride2);
         if (scale_dst)
             dst2[0] += dstSliceY * dstStride2[0];
+    } else if (c->nb_tile_ctx && srcSliceY_internal == 0 && srcSliceH == c->srcH) {
+        // the tiles need the whole source
+        ret = scale_tiles(c, src2, srcStride2, dst2, dstStride2, dstSliceY, dstSliceH);
     } else {
         ret = swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH,
                       dst2, dstStride2, dstSliceY, dstSliceH);
@@ -1196,6 +1269,95 @@ int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src)
     return ret;
 }
 
+/* number of source lines going through a ladder at once */
+#define LADDER_BAND_HEIGHT 16
+
+static void ladder_slice(const uint8_t *slice[4], const AVFrame *frame, int y)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+
+    for (int i = 0; i < 4; i++) {
+        const int vshift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+
+        if (!frame->data[i] || (i == 1 && usePal(frame->format)))
+            slice[i] = frame->data[i];
+        else
+            slice[i] = frame->data[i] + (y >> vshift) * frame->linesize[i];
+    }
+}
+
+int sws_scale_frame_ladder(struct SwsContext **ctx, AVFrame **dst, int nb_dst,
+                           const AVFrame *src)
+{
+    /* input lines given to and output lines returned by each stage */
+    int *fed, *done, ret = 0;
+
+    if (nb_dst <= 0)
+        return AVERROR(EINVAL);
+
+    fed = av_calloc(2 * nb_dst, sizeof(*fed));
+    if (!fed)
+        return AVERROR(ENOMEM);
+    done = fed + nb_dst;
+
+    for (int i = 0; i < nb_dst; i++) {
+        SwsContext *const c = ctx[i];
+        const AVFrame *const in = i ? dst[i - 1] : src;
+
+        if (in->width != c->srcW || in->height != c->srcH || in->format != c->srcFormat) {
+            av_log(c, AV_LOG_ERROR, "Ladder stage %d does not match its input\n", i);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+        if (!dst[i]->buf[0]) {
+            dst[i]->width  = c->dstW;
+            dst[i]->height = c->dstH;
+            dst[i]->format = c->dstFormat;
+
+            ret = av_frame_get_buffer(dst[i], 0);
+            if (ret < 0)
+                goto end;
+        }
+    }
+
+    /* Push one band of the source through the whole chain at a time. Each
+     * stage is given the input lines available so far, rounded down to its
+     * vertical chroma subsampling, and outputs what it can from them. */
+    while (fed[0] < src->height) {
+        int avail = FFMIN(fed[0] + LADDER_BAND_HEIGHT, src->height);
+
+        for (int i = 0; i < nb_dst; i++) {
+            const SwsContext *const c = ctx[i]->nb_slice_ctx ? ctx[i]->slice_ctx[0] : ctx[i];
+            const AVFrame *const in = i ? dst[i - 1] : src;
+            const uint8_t *slice[4];
+
+            if (avail < in->height) {
+                /* scaling in several passes needs the whole input */
+                if (c->cascaded_context[0])
+                    avail = fed[i];
+                else
+                    avail &= ~((isBayer(c->srcFormat) ? 2 : 1 << c->chrSrcVSubSample) - 1);
+            }
+
+            if (avail > fed[i]) {
+                ladder_slice(slice, in, fed[i]);
+                ret = sws_scale(ctx[i], slice, in->linesize, fed[i], avail - fed[i],
+                                dst[i]->data, dst[i]->linesize);
+                if (ret < 0)
+                    goto end;
+                fed[i]   = avail;
+                done[i] += ret;
+            }
+            avail = done[i];
+        }
+    }
+    ret = 0;
+
+end:
+    av_free(fed);
+    return ret;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -33,6 +33,7 @@
 #include "libavutil/frame.h"
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/threadpool.h"
 #include "version_major.h"
 #ifndef HAVE_AV_CONFIG_H
 /* When included as part of the ffmpeg build, only include the major version
@@ -163,6 +164,16 @@ struct SwsContext *sws_alloc_context(void);
 av_warn_unused_result
 int sws_init_context(struct SwsContext *sws_context, SwsFilter *srcFilter, SwsFilter *dstFilter);
 
+/**
+ * Make the context run its slice threads on a shared thread pool, instead of
+ * creating its own threads. Must be called before sws_init_context(); the
+ * "threads" option then limits the number of pool threads used at once.
+ *
+ * @param pool the pool, must outlive the context; NULL to create private
+ *             threads
+ */
+void sws_set_thread_pool(struct SwsContext *c, AVThreadPool *pool);
+
 /**
  * Free the swscaler context swsContext.
  * If swsContext is NULL, then does nothing.
@@ -243,6 +254,31 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
  */
 int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src);
 
+/**
+ * Scale a source frame into a chain of destination frames, each one scaled
+ * from the previous one, e.g. the renditions of an adaptive bitrate ladder.
+ *
+ * ctx[0] must be set up to scale src into dst[0], and ctx[i] to scale
+ * dst[i - 1] into dst[i]. The source is processed in bands of a few lines,
+ * each of which goes through the whole chain before the next one is read,
+ * so that the lines output by a context are still in the cache when the
+ * next one reads them. The output of each context is the same as with
+ * sws_scale_frame().
+ *
+ * The contexts must not be in the middle of a frame started with
+ * sws_frame_start() or sws_scale(). Slice threading is not used.
+ *
+ * @param ctx    the scaling contexts
+ * @param dst    the destination frames. See documentation for
+ *               sws_frame_start() for more details.
+ * @param nb_dst the number of contexts and destination frames
+ * @param src    the source frame
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_scale_frame_ladder(struct SwsContext **ctx, AVFrame **dst, int nb_dst,
+                           const AVFrame *src);
+
 /**
  * Initialize the scaling process for a given pair of source/destination frames.
  * Must be called before any calls to sws_send_slice() and sws_receive_slice().
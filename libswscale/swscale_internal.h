@@ -339,6 +339,7 @@ typedef struct SwsContext {
     int vChrDrop;                 ///< Binary logarithm of extra vertical subsampling factor in source image chroma planes specified by user.
     int sliceDir;                 ///< Direction that slices are fed to the scaler (1 = top-to-bottom, -1 = bottom-to-top).
     int nb_threads;               ///< Number of threads used for scaling
+    AVThreadPool *thread_pool;    ///< Shared pool running the slice threads, if set
     double param[2];              ///< Input parameters for scaling algorithms that need them.
 
     AVFrame *frame_src;
@@ -682,6 +683,24 @@ typedef struct SwsContext {
     atomic_int   data_unaligned_warned;
 
     Half2FloatTables *h2f_tables;
+
+    // kept after the fields accessed by offset from the asm
+    int tile_width;               ///< Width of the vertical stripes scaled one after the other, 0 to scale whole lines
+
+    AVSliceThread      *tilethread;
+    struct SwsContext **tile_ctx;
+    int                *tile_err;
+    int              nb_tile_ctx;
+    int tile_src_x;               ///< First source column read by a tile context.
+    int tile_dst_x;               ///< First destination column written by a tile context.
+
+    // values passed to the tile contexts for the current frame
+    const uint8_t *tile_src[4];
+    uint8_t       *tile_dst[4];
+    int tile_src_stride[4];
+    int tile_dst_stride[4];
+    int tile_dst_slice_start;
+    int tile_dst_slice_height;
 } SwsContext;
 //FIXME check init (where 0)
 
@@ -1154,6 +1173,8 @@ void ff_init_vscale_pfn(SwsContext *c, yuv2planar1_fn yuv2plane1, yuv2planarX_fn
 
 void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
                          int nb_jobs, int nb_threads);
+void ff_sws_tile_worker(void *priv, int jobnr, int threadnr,
+                        int nb_jobs, int nb_threads);
 
 //number of extra lines to process
 #define MAX_LINES_AHEAD 4
@@ -1013,6 +1013,14 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
         return parent_ret;
     }
 
+    for (int i = 0; i < c->nb_tile_ctx; i++) {
+        int ret = sws_setColorspaceDetails(c->tile_ctx[i], inv_table,
+                                           srcRange, table, dstRange,
+                                           brightness, contrast, saturation);
+        if (ret < 0)
+            return ret;
+    }
+
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
     desc_src = av_pix_fmt_desc_get(c->srcFormat);
@@ -1568,6 +1576,11 @@ static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
         SwsContext *c2;
         c->cascaded_context[0] = NULL;
 
+        // there is no need to carry an alpha plane through all the passes
+        // unless both ends have one
+        if (!isALPHA(srcFormat) || !isALPHA(dstFormat))
+            tmpFmt = AV_PIX_FMT_RGB48LE;
+
         ret = av_image_alloc(c->cascaded_tmp, c->cascaded_tmpStride,
                             srcW, srcH, tmpFmt, 64);
         if (ret < 0)
@@ -1974,13 +1987,18 @@ fail: // FIXME replace things by appropriate error codes
     return ret;
 }
 
+void sws_set_thread_pool(SwsContext *c, AVThreadPool *pool)
+{
+    c->thread_pool = pool;
+}
+
 static int context_init_threaded(SwsContext *c,
                                  SwsFilter *src_filter, SwsFilter *dst_filter)
 {
     int ret;
 
-    ret = avpriv_slicethread_create(&c->slicethread, (void*)c,
-                                    ff_sws_slice_worker, NULL, c->nb_threads);
+    ret = avpriv_slicethread_create_pool(&c->slicethread, c->thread_pool, (void*)c,
+                                         ff_sws_slice_worker, NULL, c->nb_threads);
     if (ret == AVERROR(ENOSYS)) {
         c->nb_threads = 1;
         return 0;
@@ -2023,6 +2041,169 @@ static int context_init_threaded(SwsContext *c,
     return 0;
 }
 
+/* source columns read by the destination columns [start, end) of a filter */
+static void tile_src_range(const int32_t *filter_pos, int filter_size,
+                           int start, int end, int *src_start, int *src_end)
+{
+    /* not monotonic after ff_shuffle_filter_coefficients() */
+    for (int i = start; i < end; i++) {
+        *src_start = FFMIN(*src_start, filter_pos[i]);
+        *src_end   = FFMAX(*src_end,   filter_pos[i] + filter_size);
+    }
+}
+
+/* replace the horizontal filter of a tile context by a part of the parent's */
+static int tile_copy_filter(int16_t **filter, int32_t **filter_pos, int *filter_size,
+                            const int16_t *parent_filter, const int32_t *parent_pos,
+                            int parent_size, int start, int width, int src_start)
+{
+    av_freep(filter);
+    av_freep(filter_pos);
+
+    if (!FF_ALLOC_TYPED_ARRAY(*filter,     parent_size * (width + 3)) ||
+        !FF_ALLOC_TYPED_ARRAY(*filter_pos, width + 3))
+        return AVERROR(ENOMEM);
+
+    /* the parent has 3 padding entries as well, see initFilter() */
+    memcpy(*filter, parent_filter + start * parent_size,
+           parent_size * (width + 3) * sizeof(**filter));
+    for (int i = 0; i < width; i++)
+        (*filter_pos)[i] = parent_pos[start + i] - src_start;
+    for (int i = width; i < width + 3; i++)
+        (*filter_pos)[i] = (*filter_pos)[width - 1];
+    *filter_size = parent_size;
+
+    return 0;
+}
+
+static void free_tiles(SwsContext *c)
+{
+    for (int i = 0; i < c->nb_tile_ctx; i++)
+        sws_freeContext(c->tile_ctx[i]);
+    av_freep(&c->tile_ctx);
+    av_freep(&c->tile_err);
+    c->nb_tile_ctx = 0;
+
+    avpriv_slicethread_free(&c->tilethread);
+}
+
+/**
+ * Split the destination into vertical stripes of tile_width columns, each
+ * scaled by a context reading only the source columns it needs, so that the
+ * line buffers of a stripe fit in the cache. The tile contexts use the
+ * horizontal filters of the parent, their output is identical.
+ */
+static int context_init_tiles(SwsContext *c,
+                              SwsFilter *src_filter, SwsFilter *dst_filter)
+{
+    const AVPixFmtDescriptor *desc_src = av_pix_fmt_desc_get(c->srcFormat);
+    const AVPixFmtDescriptor *desc_dst = av_pix_fmt_desc_get(c->dstFormat);
+    /* keeps the dither offsets and the AVX2 filter layout of the parent */
+    const int tile_width = FFALIGN(c->tile_width, 64);
+    const int src_align  = 1 << FFMAX(c->chrSrcHSubSample, desc_src->log2_chroma_w);
+    const int nb_tiles   = (c->dstW + tile_width - 1) / tile_width;
+    int ret;
+
+    if (nb_tiles < 2)
+        return 0;
+
+    /* the output must only depend on the position of each pixel in its tile
+     * modulo the tile alignment, and the pixels must be addressable */
+    if (c->convert_unscaled || c->cascaded_context[0] ||
+        c->flags & SWS_FAST_BILINEAR || c->alphablend != SWS_ALPHA_BLEND_NONE ||
+        usePal(c->srcFormat) || isBayer(c->srcFormat) || isPacked(c->dstFormat) ||
+        (isPacked(c->srcFormat) && desc_src->log2_chroma_w > 1) ||
+        desc_src->flags & AV_PIX_FMT_FLAG_BITSTREAM ||
+        desc_dst->flags & AV_PIX_FMT_FLAG_BITSTREAM)
+        goto untiled;
+
+    c->tile_ctx = av_calloc(nb_tiles, sizeof(*c->tile_ctx));
+    c->tile_err = av_calloc(nb_tiles, sizeof(*c->tile_err));
+    if (!c->tile_ctx || !c->tile_err)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < nb_tiles; i++) {
+        const int dst_start = i * tile_width;
+        const int dst_end   = FFMIN(dst_start + tile_width, c->dstW);
+        int src_start = INT_MAX, src_end = 0;
+        int chr_start = INT_MAX, chr_end = 0;
+        SwsContext *t;
+
+        tile_src_range(c->hLumFilterPos, c->hLumFilterSize,
+                       dst_start, dst_end, &src_start, &src_end);
+        tile_src_range(c->hChrFilterPos, c->hChrFilterSize,
+                       dst_start >> c->chrDstHSubSample,
+                       AV_CEIL_RSHIFT(dst_end, c->chrDstHSubSample),
+                       &chr_start, &chr_end);
+        src_start = FFMIN(src_start, chr_start << c->chrSrcHSubSample) & ~(src_align - 1);
+        src_end   = FFMIN(FFMAX(src_end, chr_end << c->chrSrcHSubSample), c->srcW);
+
+        t = c->tile_ctx[i] = sws_alloc_context();
+        if (!t)
+            return AVERROR(ENOMEM);
+        c->nb_tile_ctx++;
+
+        t->parent = c;
+
+        ret = av_opt_copy((void*)t, (void*)c);
+        if (ret < 0)
+            return ret;
+
+        t->nb_threads = 1;
+        t->tile_width = 0;
+        t->flags     &= ~SWS_PRINT_INFO;
+        t->srcW       = src_end - src_start;
+        t->dstW       = dst_end - dst_start;
+        t->tile_src_x = src_start;
+        t->tile_dst_x = dst_start;
+
+        ret = sws_init_single_context(t, src_filter, dst_filter);
+        if (ret < 0)
+            return ret;
+        if (t->convert_unscaled || t->cascaded_context[0])
+            goto untiled;
+
+        ret = tile_copy_filter(&t->hLumFilter, &t->hLumFilterPos, &t->hLumFilterSize,
+                               c->hLumFilter, c->hLumFilterPos, c->hLumFilterSize,
+                               dst_start, t->dstW, src_start);
+        if (ret < 0)
+            return ret;
+        ret = tile_copy_filter(&t->hChrFilter, &t->hChrFilterPos, &t->hChrFilterSize,
+                               c->hChrFilter, c->hChrFilterPos, c->hChrFilterSize,
+                               dst_start >> c->chrDstHSubSample, t->chrDstW,
+                               src_start >> c->chrSrcHSubSample);
+        if (ret < 0)
+            return ret;
+
+        // the scaling functions depend on the filter sizes
+        ff_sws_init_scale(t);
+        ff_free_filters(t);
+        if ((ret = ff_init_filters(t)) < 0)
+            return ret;
+    }
+
+    if (c->nb_threads != 1) {
+        ret = avpriv_slicethread_create_pool(&c->tilethread, c->thread_pool, (void*)c,
+                                             ff_sws_tile_worker, NULL, c->nb_threads);
+        if (ret == AVERROR(ENOSYS))
+            c->nb_threads = 1;
+        else if (ret < 0)
+            return ret;
+        else
+            c->nb_threads = ret;
+    }
+
+    av_log(c, AV_LOG_VERBOSE, "Scaling in %d tiles of %d columns\n",
+           c->nb_tile_ctx, tile_width);
+
+    return 0;
+
+untiled:
+    av_log(c, AV_LOG_VERBOSE, "Tiled scaling is not possible for this conversion\n");
+    free_tiles(c);
+    return 0;
+}
+
 av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                              SwsFilter *dstFilter)
 {
@@ -2046,14 +2227,24 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
     if (src_format != c->srcFormat || dst_format != c->dstFormat)
         av_log(c, AV_LOG_WARNING, "deprecated pixel format used, make sure you did set range correctly\n");
 
-    if (c->nb_threads != 1) {
+    // tiled scaling threads over the tiles
+    if (c->nb_threads != 1 && !c->tile_width) {
         ret = context_init_threaded(c, srcFilter, dstFilter);
         if (ret < 0 || c->nb_threads > 1)
             return ret;
         // threading disabled in this build, init as single-threaded
     }
 
-    return sws_init_single_context(c, srcFilter, dstFilter);
+    ret = sws_init_single_context(c, srcFilter, dstFilter);
+    if (ret < 0 || !c->tile_width)
+        return ret;
+
+    ret = context_init_tiles(c, srcFilter, dstFilter);
+    if (ret < 0 || c->nb_tile_ctx || c->nb_threads == 1)
+        return ret;
+
+    // not tiled, thread over slices instead
+    return context_init_threaded(c, srcFilter, dstFilter);
 }
 
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
@@ -2425,6 +2616,8 @@ void sws_freeContext(SwsContext *c)
 
     avpriv_slicethread_free(&c->slicethread);
 
+    free_tiles(c);
+
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
@@ -0,0 +1,169 @@
+;******************************************************************************
+;* AVX-512 horizontal line scaling functions
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 64
+
+; The filter positions are shuffled for the AVX2 functions, see
+; ff_shuffle_filter_coefficients(). Reorder them so that each 128-bit lane of
+; the gathered pixels holds outputs 2n, 2n+1, 2n+8 and 2n+9, which match the
+; layout of the filter coefficients once unpacked to words.
+gather_perm: dd 0, 1, 8, 9, 4, 5, 12, 13, 2, 3, 10, 11, 6, 7, 14, 15
+store_perm:  dd 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15
+four:        dd 4
+
+SECTION .text
+
+;-----------------------------------------------------------------------------
+; horizontal line scaling
+;
+; void hscale8to15_<filterSize>_<opt>
+;                   (SwsContext *c, int16_t *dst,
+;                    int dstW, const uint8_t *src,
+;                    const int16_t *filter,
+;                    const int32_t *filterPos, int filterSize);
+;
+; Same as the AVX2 version, with the same filter layout, but 16 pixels are
+; gathered at once. The AVX512-VNNI version accumulates the products of the
+; multiple of 4 filter sizes with vpdpwssd.
+;-----------------------------------------------------------------------------
+
+; sum the pairs of dwords of %2 and %3 into %1, i.e. vphaddd, which has no
+; EVEX encoding
+%macro HADDD_PAIRS 5 ; dst, src1, src2, tmp1, tmp2
+    shufps %4, %2, %3, q2020
+    shufps %5, %2, %3, q3131
+    paddd  %1, %4, %5
+%endmacro
+
+; multiply-accumulate the words of %2 with the ones at %3 into the dwords of %1
+%macro DPWSSD 3-4 ; acc, src, mem, tmp
+%if cpuflag(avx512icl)
+    vpdpwssd %1, %2, %3
+%else
+    pmaddwd  %4, %2, %3
+    paddd    %1, %4
+%endif
+%endmacro
+
+%macro SCALE_FUNC 1
+cglobal hscale8to15_%1, 7, 9, 16, pos0, dst, w, srcmem, filter, fltpos, fltsize, count, inner
+    pxor m0, m0
+    mova m15, [gather_perm]
+    mova m14, [store_perm]
+    xor countq, countq
+    movsxd wq, wd
+%ifidn %1, X4
+    vpbroadcastd m13, [four]
+    shr fltsized, 2
+%endif
+    cmp wq, 0x10
+    jl .tail_loop
+    sub wq, 0x10
+.loop:
+    vpermd m1, m15, [fltposq]
+%ifidn %1, X4
+    pxor m9, m9
+    pxor m10, m10
+    xor innerq, innerq
+.innerloop:
+%endif
+    kxnorw k1, k1, k1
+    vpgatherdd m3{k1}, [srcmemq + m1]
+    punpcklbw m5, m3, m0
+    punpckhbw m6, m3, m0
+%ifidn %1, X4
+    DPWSSD m9, m5, [filterq], m7
+    DPWSSD m10, m6, [filterq + 64], m8
+    add filterq, 0x80
+    paddd m1, m13
+    add innerq, 1
+    cmp innerq, fltsizeq
+    jl .innerloop
+    HADDD_PAIRS m5, m9, m10, m7, m8
+%else
+    pmaddwd m5, m5, [filterq]
+    pmaddwd m6, m6, [filterq + 64]
+    add filterq, 0x80
+    HADDD_PAIRS m5, m5, m6, m7, m8
+%endif
+    psrad m5, 7
+    packssdw m5, m5, m5
+    vpermd m5, m14, m5
+    movu [dstq + countq * 2], ym5
+    add fltposq, 0x40
+    add countq, 0x10
+    cmp countq, wq
+    jle .loop
+
+    add wq, 0x10
+    cmp countq, wq
+    jge .end
+
+.tail_loop:
+    movu xm1, [fltposq]
+%ifidn %1, X4
+    pxor xm9, xm9
+    pxor xm10, xm10
+    xor innerq, innerq
+.tail_innerloop:
+%endif
+    kxnorw k1, k1, k1
+    vpgatherdd xm3{k1}, [srcmemq + xm1]
+    punpcklbw xm5, xm3, xm0
+    punpckhbw xm6, xm3, xm0
+%ifidn %1, X4
+    DPWSSD xm9, xm5, [filterq], xm7
+    DPWSSD xm10, xm6, [filterq + 0x10], xm8
+    add filterq, 0x20
+    paddd xm1, xm13
+    add innerq, 1
+    cmp innerq, fltsizeq
+    jl .tail_innerloop
+    HADDD_PAIRS xm5, xm9, xm10, xm7, xm8
+%else
+    pmaddwd xm5, xm5, [filterq]
+    pmaddwd xm6, xm6, [filterq + 0x10]
+    add filterq, 0x20
+    HADDD_PAIRS xm5, xm5, xm6, xm7, xm8
+%endif
+    psrad xm5, 7
+    packssdw xm5, xm5, xm5
+    movq [dstq + countq * 2], xm5
+    add fltposq, 0x10
+    add countq, 0x4
+    cmp countq, wq
+    jl .tail_loop
+.end:
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+SCALE_FUNC 4
+SCALE_FUNC X4
+%endif
+%if HAVE_AVX512ICL_EXTERNAL
+INIT_ZMM avx512icl
+SCALE_FUNC X4
+%endif
+%endif
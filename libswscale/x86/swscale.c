@@ -225,6 +225,9 @@ YUV2YUVX_FUNC(sse3, 32)
 #if HAVE_AVX2_EXTERNAL
 YUV2YUVX_FUNC(avx2, 64)
 #endif
+#if ARCH_X86_64 && HAVE_AVX512_EXTERNAL
+YUV2YUVX_FUNC(avx512, 128)
+#endif
 
 #define SCALE_FUNC(filter_n, from_bpc, to_bpc, opt) \
 void ff_hscale ## from_bpc ## to ## to_bpc ## _ ## filter_n ## _ ## opt( \
@@ -264,6 +267,9 @@ SCALE_FUNCS_SSE(sse4);
 
 SCALE_FUNC(4, 8, 15, avx2);
 SCALE_FUNC(X4, 8, 15, avx2);
+SCALE_FUNC(4, 8, 15, avx512);
+SCALE_FUNC(X4, 8, 15, avx512);
+SCALE_FUNC(X4, 8, 15, avx512icl);
 
 #define VSCALEX_FUNC(size, opt) \
 void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filterSize, \
@@ -467,6 +473,10 @@ av_cold void ff_sws_init_swscale_x86(SwsContext *c)
 #if HAVE_AVX2_EXTERNAL
         if (EXTERNAL_AVX2_FAST(cpu_flags))
             c->yuv2planeX = yuv2yuvX_avx2;
+#endif
+#if ARCH_X86_64 && HAVE_AVX512_EXTERNAL
+        if (EXTERNAL_AVX512(cpu_flags))
+            c->yuv2planeX = yuv2yuvX_avx512;
 #endif
     }
 #if ARCH_X86_32 && !HAVE_ALIGNED_STACK
@@ -625,11 +635,26 @@ switch(c->dstBpc){ \
     default:  hscalefn = ff_hscale8to15_X4_avx2; break; \
              break; \
     }
+#define ASSIGN_AVX512_SCALE_FUNC(hscalefn, filtersize) \
+    switch (filtersize) { \
+    case 4:  hscalefn = ff_hscale8to15_4_avx512; break; \
+    default: hscalefn = EXTERNAL_AVX512ICL(cpu_flags) ? ff_hscale8to15_X4_avx512icl : \
+                                                        ff_hscale8to15_X4_avx512; \
+             break; \
+    }
 
+    /* the AVX-512 functions use the filter layout of the AVX2 ones, see
+     * ff_shuffle_filter_coefficients() */
     if (EXTERNAL_AVX2_FAST(cpu_flags) && !(cpu_flags & AV_CPU_FLAG_SLOW_GATHER)) {
         if ((c->srcBpc == 8) && (c->dstBpc <= 14)) {
             ASSIGN_AVX2_SCALE_FUNC(c->hcScale, c->hChrFilterSize);
             ASSIGN_AVX2_SCALE_FUNC(c->hyScale, c->hLumFilterSize);
+#if HAVE_AVX512_EXTERNAL
+            if (EXTERNAL_AVX512(cpu_flags)) {
+                ASSIGN_AVX512_SCALE_FUNC(c->hcScale, c->hChrFilterSize);
+                ASSIGN_AVX512_SCALE_FUNC(c->hyScale, c->hLumFilterSize);
+            }
+#endif
         }
     }
 
@@ -0,0 +1,97 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/ebur128.h"
+#include "libavutil/mem_internal.h"
+
+#define LEN 1024
+/* the functions handle 4 channels out of an interleaved buffer of 6 */
+#define CHANNELS 6
+
+#define randomize_buffer(buf, size)                                 \
+    do {                                                            \
+        for (int j = 0; j < size; j++)                              \
+            buf[j] = ((double)rnd() / UINT_MAX) * 2.0 - 1.0;        \
+    } while (0)
+
+static void check_filter_channels4(const FFEBUR128DSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(double, src,       [LEN * CHANNELS]);
+    LOCAL_ALIGNED_32(double, dst_ref,   [LEN * CHANNELS]);
+    LOCAL_ALIGNED_32(double, dst_new,   [LEN * CHANNELS]);
+    LOCAL_ALIGNED_32(double, state_ref, [6 * 4]);
+    LOCAL_ALIGNED_32(double, state_new, [6 * 4]);
+
+    declare_func(void, double *dst, const double *src, ptrdiff_t stride,
+                 int nb_samples, double *state, const double *coeffs);
+
+    if (check_func(dsp->filter_channels4, "ebur128_filter_channels4")) {
+        randomize_buffer(src, LEN * CHANNELS);
+        randomize_buffer(state_ref, 6 * 4);
+        memcpy(state_new, state_ref, 6 * 4 * sizeof(*state_ref));
+        memset(dst_ref, 0, LEN * CHANNELS * sizeof(*dst_ref));
+        memset(dst_new, 0, LEN * CHANNELS * sizeof(*dst_new));
+
+        /* start at an odd channel to exercise unaligned accesses */
+        call_ref(dst_ref + 1, src + 1, CHANNELS, LEN, state_ref, dsp->coeffs[0]);
+        call_new(dst_new + 1, src + 1, CHANNELS, LEN, state_new, dsp->coeffs[0]);
+        if (memcmp(dst_ref, dst_new, LEN * CHANNELS * sizeof(*dst_ref)) ||
+            memcmp(state_ref, state_new, 6 * 4 * sizeof(*state_ref)))
+            fail();
+
+        bench_new(dst_new + 1, src + 1, CHANNELS, LEN, state_new, dsp->coeffs[0]);
+    }
+}
+
+static void check_find_peaks4(const FFEBUR128DSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(double, src,       [LEN * CHANNELS]);
+    LOCAL_ALIGNED_32(double, peaks_ref, [4]);
+    LOCAL_ALIGNED_32(double, peaks_new, [4]);
+
+    declare_func(void, double *peaks, const double *src, ptrdiff_t stride,
+                 int nb_samples);
+
+    if (check_func(dsp->find_peaks4, "ebur128_find_peaks4")) {
+        randomize_buffer(src, LEN * CHANNELS);
+        for (int i = 0; i < 4; i++)
+            peaks_ref[i] = peaks_new[i] = i * 0.25;
+
+        call_ref(peaks_ref, src + 1, CHANNELS, LEN);
+        call_new(peaks_new, src + 1, CHANNELS, LEN);
+        if (memcmp(peaks_ref, peaks_new, 4 * sizeof(*peaks_ref)))
+            fail();
+
+        bench_new(peaks_new, src + 1, CHANNELS, LEN);
+    }
+}
+
+void checkasm_check_ebur128(void)
+{
+    FFEBUR128DSPContext dsp;
+
+    ff_ebur128_dsp_init(&dsp, 48000);
+
+    check_filter_channels4(&dsp);
+    report("filter_channels4");
+
+    check_find_peaks4(&dsp);
+    report("find_peaks4");
+}
@@ -39,11 +39,20 @@
         }                                                       \
     } while (0)
 
+static int float_near_abs_eps_stride(const float *a, const float *b,
+                                     float eps, int len, int stride)
+{
+    for (int i = 0; i < len; i++)
+        if (!float_near_abs_eps(a[i*stride], b[i*stride], eps))
+            return 0;
+    return 1;
+}
+
 static const int check_lens[] = {
     2, 4, 8, 16, 32, 64, 120, 960, 1024, 1920, 16384,
 };
 
-static AVTXContext *tx_refs[AV_TX_NB][2 /* Direction */][FF_ARRAY_ELEMS(check_lens)] = { 0 };
+static AVTXContext *tx_refs[AV_TX_NB][2 /* Direction */][2 /* Strided */][FF_ARRAY_ELEMS(check_lens)] = { 0 };
 static int init = 0;
 
 static void free_tx_refs(void)
@@ -51,10 +60,11 @@ static void free_tx_refs(void)
     for (int i = 0; i < FF_ARRAY_ELEMS(tx_refs); i++)
         for (int j = 0; j < FF_ARRAY_ELEMS(*tx_refs); j++)
             for (int k = 0; k < FF_ARRAY_ELEMS(**tx_refs); k++)
-                av_tx_uninit(&tx_refs[i][j][k]);
+                for (int l = 0; l < FF_ARRAY_ELEMS(***tx_refs); l++)
+                    av_tx_uninit(&tx_refs[i][j][k][l]);
 }
 
-#define CHECK_TEMPLATE(PREFIX, TYPE, DIR, DATA_TYPE, SCALE_TYPE, LENGTHS, CHECK_EXPRESSION) \
+#define CHECK_TEMPLATE(PREFIX, TYPE, DIR, DATA_TYPE, SCALE_TYPE, STRIDE, LENGTHS, CHECK_EXPRESSION) \
     do {                                                                          \
         int err;                                                                  \
         AVTXContext *tx;                                                          \
@@ -72,21 +82,21 @@ static void free_tx_refs(void)
             }                                                                     \
                                                                                   \
             if (check_func(fn, PREFIX "_%i", len)) {                              \
-                AVTXContext *tx_ref = tx_refs[TYPE][DIR][i];                      \
+                AVTXContext *tx_ref = tx_refs[TYPE][DIR][STRIDE > 1][i];          \
                 if (!tx_ref)                                                      \
                     tx_ref = tx;                                                  \
                 num_checks++;                                                     \
                 last_check = len;                                                 \
-                call_ref(tx_ref, out_ref, in, sizeof(DATA_TYPE));                 \
-                call_new(tx,     out_new, in, sizeof(DATA_TYPE));                 \
+                call_ref(tx_ref, out_ref, in, STRIDE*sizeof(DATA_TYPE));          \
+                call_new(tx,     out_new, in, STRIDE*sizeof(DATA_TYPE));          \
                 if (CHECK_EXPRESSION) {                                           \
                     fail();                                                       \
                     av_tx_uninit(&tx);                                            \
                     break;                                                        \
                 }                                                                 \
-                bench_new(tx, out_new, in, sizeof(DATA_TYPE));                    \
-                av_tx_uninit(&tx_refs[TYPE][DIR][i]);                             \
-                tx_refs[TYPE][DIR][i] = tx;                                       \
+                bench_new(tx, out_new, in, STRIDE*sizeof(DATA_TYPE));             \
+                av_tx_uninit(&tx_refs[TYPE][DIR][STRIDE > 1][i]);                 \
+                tx_refs[TYPE][DIR][STRIDE > 1][i] = tx;                           \
             } else {                                                              \
                 av_tx_uninit(&tx);                                                \
             }                                                                     \
@@ -107,14 +117,21 @@ void checkasm_check_av_tx(void)
     void *out_new = av_malloc(16384*2*8);
 
     randomize_complex(in, 16384, AVComplexFloat, SCALE_NOOP);
-    CHECK_TEMPLATE("float_fft", AV_TX_FLOAT_FFT, 0, AVComplexFloat, float, check_lens,
+    CHECK_TEMPLATE("float_fft", AV_TX_FLOAT_FFT, 0, AVComplexFloat, float, 1, check_lens,
                    !float_near_abs_eps_array(out_ref, out_new, EPS, len*2));
 
-    CHECK_TEMPLATE("float_imdct", AV_TX_FLOAT_MDCT, 1, float, float, check_lens,
+    CHECK_TEMPLATE("float_imdct", AV_TX_FLOAT_MDCT, 1, float, float, 1, check_lens,
                    !float_near_abs_eps_array(out_ref, out_new, EPS, len));
 
+    CHECK_TEMPLATE("float_mdct", AV_TX_FLOAT_MDCT, 0, float, float, 1, check_lens,
+                   !float_near_abs_eps_array(out_ref, out_new, EPS, len));
+
+    /* the forward MDCT output can be strided */
+    CHECK_TEMPLATE("float_mdct_stride", AV_TX_FLOAT_MDCT, 0, float, float, 2, check_lens,
+                   !float_near_abs_eps_stride(out_ref, out_new, EPS, len, 2));
+
     randomize_complex(in, 16384, AVComplexDouble, SCALE_NOOP);
-    CHECK_TEMPLATE("double_fft", AV_TX_DOUBLE_FFT, 0, AVComplexDouble, double, check_lens,
+    CHECK_TEMPLATE("double_fft", AV_TX_DOUBLE_FFT, 0, AVComplexDouble, double, 1, check_lens,
                    !double_near_abs_eps_array(out_ref, out_new, EPS, len*2));
 
     av_free(in);
@@ -0,0 +1,81 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "libavutil/mem_internal.h"
+
+#include "libavfilter/dnn/dnn_backend_native_layer_conv2d.h"
+
+#include "checkasm.h"
+
+#define MAX_PATCH_SIZE  (5 * 5 * 8)
+#define MAX_OUTPUT_NUM  32
+
+#define randomize_buffer(buf, len)                                  \
+    do {                                                            \
+        for (int j = 0; j < len; j++)                               \
+            buf[j] = (float)((int)(rnd() & 0xFFFF) - 32768) / 32768; \
+    } while (0)
+
+void checkasm_check_dnn_conv2d(void)
+{
+    /* kernel_size * kernel_size * input_num, output_num */
+    static const int sizes[][2] = {
+        { 3 * 3 * 1,  1 },
+        { 3 * 3 * 3, 16 },
+        { 5 * 5 * 8, 32 },
+        { 1 * 1 * 8,  3 },
+    };
+    LOCAL_ALIGNED_32(float, patch,   [FFALIGN(MAX_PATCH_SIZE, DNN_CONV2D_PATCH_ALIGN)]);
+    LOCAL_ALIGNED_32(float, kernel,  [FFALIGN(MAX_PATCH_SIZE, DNN_CONV2D_PATCH_ALIGN) * MAX_OUTPUT_NUM]);
+    LOCAL_ALIGNED_32(float, biases,  [MAX_OUTPUT_NUM]);
+    LOCAL_ALIGNED_32(float, dst_ref, [MAX_OUTPUT_NUM]);
+    LOCAL_ALIGNED_32(float, dst_new, [MAX_OUTPUT_NUM]);
+    DNNConv2DDSPContext c;
+
+    declare_func(void, float *dst, const float *patch, const float *kernel,
+                 const float *biases, int patch_size, int output_num);
+
+    ff_dnn_conv2d_dsp_init(&c);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        const int filter_size = sizes[i][0];
+        const int patch_size  = FFALIGN(filter_size, DNN_CONV2D_PATCH_ALIGN);
+        const int output_num  = sizes[i][1];
+
+        if (check_func(c.dot_products, "dot_products_%d_%d", filter_size, output_num)) {
+            /* the padding of the patch and the kernel rows is zeroed */
+            memset(patch, 0, patch_size * sizeof(*patch));
+            memset(kernel, 0, patch_size * output_num * sizeof(*kernel));
+            randomize_buffer(patch, filter_size);
+            for (int n = 0; n < output_num; n++)
+                randomize_buffer((kernel + n * patch_size), filter_size);
+            randomize_buffer(biases, output_num);
+
+            call_ref(dst_ref, patch, kernel, biases, patch_size, output_num);
+            call_new(dst_new, patch, kernel, biases, patch_size, output_num);
+            if (!float_near_abs_eps_array(dst_ref, dst_new, filter_size * FLT_EPSILON, output_num))
+                fail();
+
+            bench_new(dst_new, patch, kernel, biases, patch_size, output_num);
+        }
+    }
+    report("dot_products");
+}
@@ -440,6 +440,62 @@ static void check_loop_filter_intra(void)
     }
 }
 
+static void check_startcode(void)
+{
+#define STARTCODE_BUF_SIZE 4096
+    LOCAL_ALIGNED_32(uint8_t, buf, [STARTCODE_BUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE]);
+    H264DSPContext h;
+    int i, j;
+
+    declare_func(int, const uint8_t *buf, int size);
+
+    /* the word-at-a-time C version may step past the end of the buffer if
+     * it contains no zero byte, any result >= size means none was found */
+#define CALL_STARTCODE(ret, call, buf, size) ret = FFMIN(call(buf, size), size)
+
+    ff_h264dsp_init(&h, 8, 1);
+
+    if (check_func(h.startcode_find_candidate, "startcode_find_candidate")) {
+        /* every size up to beyond two vectors, so that all tails are covered,
+         * with the zero byte before, at and after the end of the buffer */
+        for (i = 0; i < 72; i++) {
+            for (j = 0; j < 80; j++) {
+                int off = j & 1, ref, new;
+                memset(buf, 0xff, STARTCODE_BUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE);
+                if (j < 78)
+                    buf[off + j] = 0;
+                CALL_STARTCODE(ref, call_ref, buf + off, i);
+                CALL_STARTCODE(new, call_new, buf + off, i);
+                if (ref != new) {
+                    fprintf(stderr, "startcode_find_candidate: size:%d zero:%d off:%d, "
+                            "ref:%d new:%d\n", i, j, off, ref, new);
+                    fail();
+                }
+            }
+        }
+
+        /* random data with sparse zero bytes */
+        for (i = 0; i < STARTCODE_BUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE; i++)
+            buf[i] = (rnd() & 0x3f) ? rnd() | 1 : 0;
+        for (i = 0; i < STARTCODE_BUF_SIZE; i++) {
+            int size = STARTCODE_BUF_SIZE - i, ref, new;
+            CALL_STARTCODE(ref, call_ref, buf + i, size);
+            CALL_STARTCODE(new, call_new, buf + i, size);
+            if (ref != new) {
+                fprintf(stderr, "startcode_find_candidate: pos:%d size:%d, "
+                        "ref:%d new:%d\n", i, size, ref, new);
+                fail();
+                break;
+            }
+        }
+
+        memset(buf, 0xff, STARTCODE_BUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE);
+        bench_new(buf, STARTCODE_BUF_SIZE);
+    }
+#undef CALL_STARTCODE
+#undef STARTCODE_BUF_SIZE
+}
+
 void checkasm_check_h264dsp(void)
 {
     check_idct();
@@ -451,4 +507,7 @@ void checkasm_check_h264dsp(void)
 
     check_loop_filter_intra();
     report("loop_filter_intra");
+
+    check_startcode();
+    report("startcode");
 }
@@ -0,0 +1,105 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/imgutils_internal.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#include "checkasm.h"
+
+#define HEIGHT       4
+#define MAX_LINESIZE 1088
+#define BUF_SIZE     (MAX_LINESIZE * HEIGHT + 64)
+
+static const int widths[] = { 1, 15, 63, 64, 65, 127, 128, 200, 1000, 1024 };
+
+typedef void (*copy_plane_fn)(uint8_t *dst, ptrdiff_t dst_linesize,
+                              const uint8_t *src, ptrdiff_t src_linesize,
+                              ptrdiff_t bytewidth, int height);
+
+static void copy_plane_c(uint8_t *dst, ptrdiff_t dst_linesize,
+                         const uint8_t *src, ptrdiff_t src_linesize,
+                         ptrdiff_t bytewidth, int height)
+{
+    av_image_copy_plane(dst, dst_linesize, src, src_linesize, bytewidth, height);
+}
+
+#if ARCH_X86
+/* av_image_copy_ext() uses this path with AV_IMAGE_COPY_FLAG_NONTEMPORAL and
+ * falls back to memcpy when the pointers or linesizes are not suitably aligned */
+static void copy_plane_nt(uint8_t *dst, ptrdiff_t dst_linesize,
+                          const uint8_t *src, ptrdiff_t src_linesize,
+                          ptrdiff_t bytewidth, int height)
+{
+    if (ff_image_copy_plane_nt_x86(dst, dst_linesize, src, src_linesize,
+                                   bytewidth, height) < 0)
+        copy_plane_c(dst, dst_linesize, src, src_linesize, bytewidth, height);
+}
+#endif
+
+static void check_image_copy_plane(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [BUF_SIZE]);
+    copy_plane_fn copy_plane = copy_plane_c;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_linesize,
+                 const uint8_t *src, ptrdiff_t src_linesize,
+                 ptrdiff_t bytewidth, int height);
+
+#if ARCH_X86
+    if (av_get_cpu_flags() & AV_CPU_FLAG_SSE2)
+        copy_plane = copy_plane_nt;
+#endif
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+        int w = widths[i];
+        /* aligned, then unaligned linesizes and pointers */
+        for (int a = 0; a < 2; a++) {
+            ptrdiff_t src_linesize = a ? w + 3 : FFALIGN(w, 16) + 16;
+            ptrdiff_t dst_linesize = a ? w + 5 : FFALIGN(w, 64);
+            int off = a ? 1 : 0;
+
+            if (check_func(copy_plane, "image_copy_plane_%d_%s", w,
+                           a ? "unaligned" : "aligned")) {
+                for (int j = 0; j < BUF_SIZE; j += 4)
+                    AV_WN32A(src + j, rnd());
+                memset(dst0, 0x55, BUF_SIZE);
+                memset(dst1, 0x55, BUF_SIZE);
+
+                call_ref(dst0 + off, dst_linesize, src + off, src_linesize, w, HEIGHT);
+                call_new(dst1 + off, dst_linesize, src + off, src_linesize, w, HEIGHT);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+
+                bench_new(dst1 + off, dst_linesize, src + off, src_linesize, w, HEIGHT);
+            }
+        }
+    }
+}
+
+void checkasm_check_imgutils(void)
+{
+    check_image_copy_plane();
+    report("image_copy_plane");
+}
@@ -272,6 +272,11 @@ static void check_hscale(void)
 #define INPUT_SIZES 6
     static const int input_sizes[INPUT_SIZES] = {8, 24, 128, 144, 256, 512};
 
+    // Whether the reference, i.e. the last version which passed, was tested
+    // with the filter layout of ff_shuffle_filter_coefficients().
+    static int ref_shuffled[HSCALE_PAIRS][FILTER_SIZES][INPUT_SIZES];
+    int shuffled;
+
     int i, j, fsi, hpi, width, dstWi;
     struct SwsContext *ctx;
 
@@ -342,14 +347,22 @@ static void check_hscale(void)
                 memcpy(filterAvx2, filter, sizeof(uint16_t) * (SRC_PIXELS * MAX_FILTER_WIDTH + MAX_FILTER_WIDTH));
                 ff_shuffle_filter_coefficients(ctx, filterPosAvx, width, filterAvx2, ctx->dstW);
 
+                shuffled = memcmp(filterPos, filterPosAvx, sizeof(filterPos[0]) * SRC_PIXELS) ||
+                           memcmp(filter, filterAvx2, sizeof(filter[0]) * SRC_PIXELS * width);
+
                 if (check_func(ctx->hcScale, "hscale_%d_to_%d__fs_%d_dstW_%d", ctx->srcBpc, ctx->dstBpc + 1, width, ctx->dstW)) {
                     memset(dst0, 0, SRC_PIXELS * sizeof(dst0[0]));
                     memset(dst1, 0, SRC_PIXELS * sizeof(dst1[0]));
 
-                    call_ref(NULL, dst0, ctx->dstW, src, filter, filterPos, width);
+                    if (ref_shuffled[hpi][fsi][dstWi])
+                        call_ref(NULL, dst0, ctx->dstW, src, filterAvx2, filterPosAvx, width);
+                    else
+                        call_ref(NULL, dst0, ctx->dstW, src, filter, filterPos, width);
                     call_new(NULL, dst1, ctx->dstW, src, filterAvx2, filterPosAvx, width);
                     if (memcmp(dst0, dst1, ctx->dstW * sizeof(dst0[0])))
                         fail();
+                    else
+                        ref_shuffled[hpi][fsi][dstWi] = shuffled;
                     bench_new(NULL, dst0, ctx->dstW, src, filter, filterPosAvx, width);
                 }
             }
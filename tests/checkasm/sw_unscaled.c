@@ -0,0 +1,216 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define HEIGHT 4
+
+static const int widths[] = { 126, 1920 };
+
+/* the C yuv2rgb converters for 15/16 bpp leave a tail of less than
+ * 8 pixels unwritten, so only test multiples of 8 there */
+static const int yuv2rgb_widths[] = { 128, 1920 };
+
+/* converters which must be bitexact with the C version */
+static const struct {
+    enum AVPixelFormat src, dst;
+} exact_convs[] = {
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_NV12        },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_NV24        },
+    { AV_PIX_FMT_NV12,        AV_PIX_FMT_YUV420P     },
+    { AV_PIX_FMT_NV24,        AV_PIX_FMT_YUV444P     },
+    { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_P010LE      },
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_P010LE      },
+    { AV_PIX_FMT_YUV422P,     AV_PIX_FMT_YUYV422     },
+    { AV_PIX_FMT_YUYV422,     AV_PIX_FMT_YUV420P     },
+    { AV_PIX_FMT_UYVY422,     AV_PIX_FMT_YUV422P     },
+    { AV_PIX_FMT_BGR24,       AV_PIX_FMT_YUV420P     },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_BGR24       },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_BGRA        },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_BGRA        },
+    { AV_PIX_FMT_BGRA,        AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_RGB565LE,    AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_GBRP,        AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_GBRAP,       AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_GBRP        },
+    { AV_PIX_FMT_RGB48LE,     AV_PIX_FMT_GBRP16LE    },
+    { AV_PIX_FMT_GBRP10LE,    AV_PIX_FMT_RGB48LE     },
+    { AV_PIX_FMT_BAYER_BGGR8, AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_BAYER_RGGB8, AV_PIX_FMT_YUV420P     },
+    { AV_PIX_FMT_BAYER_GRBG16LE, AV_PIX_FMT_RGB48LE  },
+    { AV_PIX_FMT_YUV420P16LE, AV_PIX_FMT_YUV420P16BE },
+    { AV_PIX_FMT_GRAY16LE,    AV_PIX_FMT_GRAY16BE    },
+    { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_YUV420P     },
+};
+
+/* the yuv2rgb converters; the SIMD versions are not bitexact */
+static const enum AVPixelFormat yuv2rgb_dst[] = {
+    AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24, AV_PIX_FMT_RGBA, AV_PIX_FMT_BGRA,
+    AV_PIX_FMT_RGB565LE, AV_PIX_FMT_RGB555LE,
+};
+
+static int plane_lines(const AVPixFmtDescriptor *desc, int plane, int h)
+{
+    return (plane == 1 || plane == 2) ? AV_CEIL_RSHIFT(h, desc->log2_chroma_h) : h;
+}
+
+static void randomize_image(uint8_t *data[4], const int linesize[4],
+                            enum AVPixelFormat fmt, int w, int h)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    const int depth = desc->comp[0].depth;
+    const int be    = desc->flags & AV_PIX_FMT_FLAG_BE;
+    const int mask  = ((1 << depth) - 1) << desc->comp[0].shift;
+
+    for (int p = 0; p < 4 && data[p]; p++) {
+        int lines = plane_lines(desc, p, h);
+        for (int i = 0; i < linesize[p] * lines; i += 4)
+            AV_WN32(data[p] + i, rnd());
+
+        /* keep the padding bits of high bit depth formats clear */
+        if (depth > 8 && depth < 16 && !(desc->flags & AV_PIX_FMT_FLAG_FLOAT)) {
+            for (int i = 0; i < linesize[p] * lines; i += 2) {
+                if (be)
+                    AV_WB16(data[p] + i, AV_RB16(data[p] + i) & mask);
+                else
+                    AV_WL16(data[p] + i, AV_RL16(data[p] + i) & mask);
+            }
+        }
+    }
+}
+
+static int image_differs(uint8_t *ref[4], uint8_t *new[4], const int linesize[4],
+                         enum AVPixelFormat fmt, int w, int h, int max_diff)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+
+    for (int p = 0; p < 4 && ref[p]; p++) {
+        int bytes = av_image_get_linesize(fmt, w, p);
+        int lines = plane_lines(desc, p, h);
+
+        for (int y = 0; y < lines; y++) {
+            const uint8_t *r = ref[p] + y * linesize[p];
+            const uint8_t *n = new[p] + y * linesize[p];
+
+            if (!max_diff) {
+                if (memcmp(r, n, bytes))
+                    return 1;
+            } else if (desc->comp[0].depth < 8) {
+                /* 15/16 bpp RGB, compare the components */
+                for (int x = 0; x < w; x++) {
+                    int a = AV_RL16(r + 2 * x), b = AV_RL16(n + 2 * x);
+                    for (int c = 0; c < 3; c++) {
+                        const AVComponentDescriptor *comp = &desc->comp[c];
+                        int shift = comp->shift + 8 * comp->offset;
+                        int ca = (a >> shift) & ((1 << comp->depth) - 1);
+                        int cb = (b >> shift) & ((1 << comp->depth) - 1);
+                        if (FFABS(ca - cb) > max_diff)
+                            return 1;
+                    }
+                }
+            } else {
+                for (int x = 0; x < bytes; x++)
+                    if (FFABS(r[x] - n[x]) > max_diff)
+                        return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void check_conv(enum AVPixelFormat src_fmt, enum AVPixelFormat dst_fmt,
+                       int w, int max_diff)
+{
+    struct SwsContext *ctx;
+    uint8_t *src[4] = { NULL }, *dst0[4] = { NULL }, *dst1[4] = { NULL };
+    const uint8_t *s[4];
+    uint8_t *d[4];
+    int src_linesize[4], dst_linesize[4];
+
+    /* the MMX yuv2rgb converters leave the emms to sws_scale() */
+    declare_func_emms(AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMXEXT, int, struct SwsContext *c,
+                      const uint8_t *src[], int srcStride[], int srcSliceY,
+                      int srcSliceH, uint8_t *dst[], int dstStride[]);
+
+    ctx = sws_getContext(w, HEIGHT, src_fmt, w, HEIGHT, dst_fmt,
+                         SWS_BILINEAR, NULL, NULL, NULL);
+    if (!ctx)
+        return;
+    if (!ctx->convert_unscaled)
+        goto end;
+
+    if (check_func(ctx->convert_unscaled, "%s_to_%s_%d",
+                   av_get_pix_fmt_name(src_fmt), av_get_pix_fmt_name(dst_fmt), w)) {
+        if (av_image_alloc(src,  src_linesize, w, HEIGHT, src_fmt, 64) < 0 ||
+            av_image_alloc(dst0, dst_linesize, w, HEIGHT, dst_fmt, 64) < 0 ||
+            av_image_alloc(dst1, dst_linesize, w, HEIGHT, dst_fmt, 64) < 0) {
+            fail();
+            goto end;
+        }
+        randomize_image(src, src_linesize, src_fmt, w, HEIGHT);
+        for (int p = 0; p < 4 && dst0[p]; p++) {
+            int size = dst_linesize[p] * plane_lines(av_pix_fmt_desc_get(dst_fmt), p, HEIGHT);
+            memset(dst0[p], 0x55, size);
+            memset(dst1[p], 0x55, size);
+        }
+
+        /* some converters advance the plane pointers, pass them copies */
+        memcpy(s, src,  sizeof(s));
+        memcpy(d, dst0, sizeof(d));
+        call_ref(ctx, s, src_linesize, 0, HEIGHT, d, dst_linesize);
+        memcpy(s, src,  sizeof(s));
+        memcpy(d, dst1, sizeof(d));
+        call_new(ctx, s, src_linesize, 0, HEIGHT, d, dst_linesize);
+        if (image_differs(dst0, dst1, dst_linesize, dst_fmt, w, HEIGHT, max_diff))
+            fail();
+
+        memcpy(s, src,  sizeof(s));
+        memcpy(d, dst1, sizeof(d));
+        bench_new(ctx, s, src_linesize, 0, HEIGHT, d, dst_linesize);
+    }
+
+end:
+    av_freep(&src[0]);
+    av_freep(&dst0[0]);
+    av_freep(&dst1[0]);
+    sws_freeContext(ctx);
+}
+
+void checkasm_check_sw_unscaled(void)
+{
+    for (int i = 0; i < FF_ARRAY_ELEMS(exact_convs); i++)
+        for (int j = 0; j < FF_ARRAY_ELEMS(widths); j++)
+            check_conv(exact_convs[i].src, exact_convs[i].dst, widths[j], 0);
+    report("unscaled");
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(yuv2rgb_dst); i++)
+        for (int j = 0; j < FF_ARRAY_ELEMS(yuv2rgb_widths); j++)
+            check_conv(AV_PIX_FMT_YUV420P, yuv2rgb_dst[i], yuv2rgb_widths[j], 3);
+    report("yuv2rgb");
+}
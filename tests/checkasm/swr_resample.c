@@ -0,0 +1,135 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+/* not a multiple of the number of outputs computed per iteration */
+#define DST_LEN 253
+#define SRC_LEN 4096
+
+#define randomize_buffer(buf, len, type, scale)          \
+    do {                                                 \
+        for (int j = 0; j < len; j++)                    \
+            ((type *)buf)[j] = (type)((int)(rnd() & 0xFFFF) - 32768) * scale; \
+    } while (0)
+
+static const struct {
+    int in_rate, out_rate;
+} rates[] = {
+    { 48000, 44100 },
+    { 44100, 48000 },
+    { 48000, 96000 },
+    { 44100,  8000 },
+};
+
+static int compare_output(enum AVSampleFormat format, const void *ref,
+                          const void *new, int filter_length)
+{
+    switch (format) {
+    case AV_SAMPLE_FMT_S16P:
+        return memcmp(ref, new, DST_LEN * sizeof(int16_t));
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array(ref, new, filter_length * FLT_EPSILON, DST_LEN);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array(ref, new, filter_length * DBL_EPSILON, DST_LEN);
+    }
+    return 0;
+}
+
+static void check_resample(enum AVSampleFormat format, const char *name, int linear)
+{
+    LOCAL_ALIGNED_32(double, src,     [SRC_LEN]);
+    LOCAL_ALIGNED_32(double, dst_ref, [DST_LEN]);
+    LOCAL_ALIGNED_32(double, dst_new, [DST_LEN]);
+
+    declare_func(int, ResampleContext *c, void *dst,
+                 const void *src, int n, int update_ctx);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(rates); i++) {
+        const int in_rate  = rates[i].in_rate;
+        const int out_rate = rates[i].out_rate;
+        /* the linear interpolation is only used with a fractional position */
+        ResampleContext *c = swri_resampler.init(NULL, out_rate, in_rate, 32, 10, linear,
+                                                 0, format, SWR_FILTER_TYPE_KAISER, 9,
+                                                 0, 0, !linear, 1);
+        int (*func)(ResampleContext *c, void *dst, const void *src, int n, int update_ctx);
+
+        if (!c) {
+            fail();
+            return;
+        }
+        func = linear ? c->dsp.resample_linear : c->dsp.resample_common;
+
+        if (check_func(func, "resample_%s_%s_%d_%d", linear ? "linear" : "common",
+                       name, in_rate, out_rate)) {
+            ResampleContext c_ref = *c, c_new = *c;
+            int ret_ref, ret_new;
+
+            switch (format) {
+            case AV_SAMPLE_FMT_S16P:
+                randomize_buffer(src, SRC_LEN, int16_t, 1);
+                break;
+            case AV_SAMPLE_FMT_FLTP:
+                randomize_buffer(src, SRC_LEN, float, 1.0f / 32768);
+                break;
+            case AV_SAMPLE_FMT_DBLP:
+                randomize_buffer(src, SRC_LEN, double, 1.0 / 32768);
+                break;
+            }
+            c_ref.index = c_new.index = rnd() % c->phase_count;
+            c_ref.frac  = c_new.frac  = linear ? rnd() % c->src_incr : 0;
+
+            ret_ref = call_ref(&c_ref, dst_ref, src, DST_LEN, 1);
+            ret_new = call_new(&c_new, dst_new, src, DST_LEN, 1);
+            if (ret_ref != ret_new || c_ref.index != c_new.index ||
+                c_ref.frac != c_new.frac ||
+                compare_output(format, dst_ref, dst_new, c->filter_length))
+                fail();
+
+            bench_new(&c_new, dst_new, src, DST_LEN, 0);
+        }
+
+        swri_resampler.free(&c);
+    }
+}
+
+void checkasm_check_swr_resample(void)
+{
+    static const struct {
+        enum AVSampleFormat format;
+        const char *name;
+    } formats[] = {
+        { AV_SAMPLE_FMT_S16P, "int16"  },
+        { AV_SAMPLE_FMT_FLTP, "float"  },
+        { AV_SAMPLE_FMT_DBLP, "double" },
+    };
+
+    for (int linear = 0; linear < 2; linear++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(formats); i++)
+            check_resample(formats[i].format, formats[i].name, linear);
+        report("%s", linear ? "resample_linear" : "resample_common");
+    }
+}
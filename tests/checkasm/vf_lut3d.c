@@ -0,0 +1,206 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/lut3d.h"
+#include "libavutil/frame.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#define WIDTH    67
+#define HEIGHT   4
+#define LUT_SIZE 17
+#define EPS      1e-5
+
+static const enum AVPixelFormat pix_fmts[] = {
+    AV_PIX_FMT_GBRP10, AV_PIX_FMT_GBRAP10,
+    AV_PIX_FMT_GBRP12, AV_PIX_FMT_GBRAP12,
+    AV_PIX_FMT_GBRP14,
+    AV_PIX_FMT_GBRP16, AV_PIX_FMT_GBRAP16,
+    AV_PIX_FMT_GBRPF32, AV_PIX_FMT_GBRAPF32,
+};
+
+static const struct {
+    enum interp_mode mode;
+    const char *name;
+} interps[] = {
+    { INTERPOLATE_TRILINEAR,   "trilinear"   },
+    { INTERPOLATE_TETRAHEDRAL, "tetrahedral" },
+};
+
+static float rnd_float(float min, float max)
+{
+    return min + (max - min) * (rnd() / (float)UINT_MAX);
+}
+
+static int init_lut(LUT3DContext *s, int prelut)
+{
+    const int size3 = LUT_SIZE * LUT_SIZE * LUT_SIZE;
+
+    s->lut = av_malloc_array(size3, sizeof(*s->lut));
+    if (!s->lut)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < size3; i++) {
+        s->lut[i].r = rnd_float(0.f, 1.f);
+        s->lut[i].g = rnd_float(0.f, 1.f);
+        s->lut[i].b = rnd_float(0.f, 1.f);
+    }
+    s->lutsize  = LUT_SIZE;
+    s->lutsize2 = LUT_SIZE * LUT_SIZE;
+    s->scale.r  = s->scale.g = s->scale.b = 1.f;
+
+    if (prelut) {
+        s->prelut.size = PRELUT_SIZE;
+        for (int c = 0; c < 3; c++) {
+            s->prelut.lut[c] = av_malloc_array(PRELUT_SIZE, sizeof(*s->prelut.lut[c]));
+            if (!s->prelut.lut[c])
+                return AVERROR(ENOMEM);
+            s->prelut.min[c]   = -0.1f;
+            s->prelut.max[c]   =  1.1f;
+            s->prelut.scale[c] = (PRELUT_SIZE - 1) / (s->prelut.max[c] - s->prelut.min[c]);
+            /* a monotonic curve, like the ones found in .cube files */
+            for (int i = 0; i < PRELUT_SIZE; i++) {
+                float x = (float)i / (PRELUT_SIZE - 1);
+                s->prelut.lut[c][i] = x * x;
+            }
+        }
+    }
+    return 0;
+}
+
+static void uninit_lut(LUT3DContext *s)
+{
+    av_freep(&s->lut);
+    for (int c = 0; c < 3; c++)
+        av_freep(&s->prelut.lut[c]);
+}
+
+static AVFrame *alloc_frame(enum AVPixelFormat fmt)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+    frame->format = fmt;
+    frame->width  = WIDTH;
+    frame->height = HEIGHT;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+static void randomize_frame(AVFrame *frame, const AVPixFmtDescriptor *desc)
+{
+    const int isfloat = desc->flags & AV_PIX_FMT_FLAG_FLOAT;
+    const int mask    = (1 << desc->comp[0].depth) - 1;
+
+    for (int p = 0; p < 4 && frame->data[p]; p++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            uint8_t *row = frame->data[p] + y * frame->linesize[p];
+            for (int x = 0; x < WIDTH; x++) {
+                /* also exercise the clipping of out of range float input */
+                if (isfloat)
+                    AV_WN32A(row + 4 * x, av_float2int(rnd_float(-0.25f, 1.25f)));
+                else
+                    AV_WN16A(row + 2 * x, rnd() & mask);
+            }
+        }
+    }
+}
+
+static int frames_differ(const AVFrame *a, const AVFrame *b,
+                         const AVPixFmtDescriptor *desc)
+{
+    const int isfloat = desc->flags & AV_PIX_FMT_FLAG_FLOAT;
+
+    for (int p = 0; p < 4 && a->data[p]; p++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            const uint8_t *ra = a->data[p] + y * a->linesize[p];
+            const uint8_t *rb = b->data[p] + y * b->linesize[p];
+            for (int x = 0; x < WIDTH; x++) {
+                if (isfloat) {
+                    if (!float_near_abs_eps(av_int2float(AV_RN32A(ra + 4 * x)),
+                                            av_int2float(AV_RN32A(rb + 4 * x)), EPS))
+                        return 1;
+                } else {
+                    /* the SIMD versions may round differently by one */
+                    if (FFABS(AV_RN16A(ra + 2 * x) - AV_RN16A(rb + 2 * x)) > 1)
+                        return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static void check_lut3d(void)
+{
+    declare_func(int, AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
+
+    for (int prelut = 0; prelut < 2; prelut++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(interps); i++) {
+            for (int j = 0; j < FF_ARRAY_ELEMS(pix_fmts); j++) {
+                const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pix_fmts[j]);
+                LUT3DContext s = { 0 };
+                AVFilterContext ctx = { .priv = &s };
+                AVFrame *in = NULL, *out0 = NULL, *out1 = NULL;
+                ThreadData td;
+
+                s.interpolation = interps[i].mode;
+                ff_lut3d_init(&s, desc);
+
+                if (!check_func(s.interp, "lut3d_%s_%s%s", interps[i].name,
+                                desc->name, prelut ? "_prelut" : ""))
+                    continue;
+
+                if (init_lut(&s, prelut) < 0 ||
+                    !(in   = alloc_frame(pix_fmts[j])) ||
+                    !(out0 = alloc_frame(pix_fmts[j])) ||
+                    !(out1 = alloc_frame(pix_fmts[j]))) {
+                    fail();
+                    goto end;
+                }
+                randomize_frame(in, desc);
+
+                td.in  = in;
+                td.out = out0;
+                call_ref(&ctx, &td, 0, 1);
+                td.out = out1;
+                call_new(&ctx, &td, 0, 1);
+                if (frames_differ(out0, out1, desc))
+                    fail();
+
+                bench_new(&ctx, &td, 0, 1);
+end:
+                av_frame_free(&in);
+                av_frame_free(&out0);
+                av_frame_free(&out1);
+                uninit_lut(&s);
+            }
+        }
+    }
+}
+
+void checkasm_check_vf_lut3d(void)
+{
+    check_lut3d();
+    report("lut3d");
+}
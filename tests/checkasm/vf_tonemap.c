@@ -0,0 +1,87 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/tonemap.h"
+#include "libavutil/mem_internal.h"
+
+/* not a multiple of the number of pixels processed per iteration */
+#define WIDTH 253
+#define WIDTH_PADDED 256
+#define PEAK 10.0f
+
+#define randomize_buffer(buf, size)                            \
+    do {                                                       \
+        for (int j = 0; j < size; j++)                         \
+            buf[j] = (rnd() & 0xFFFF) * (PEAK * 1.2f / 0xFFFF); \
+    } while (0)
+
+static void check_tonemap_lut(const TonemapDSPContext *dsp, float desat)
+{
+    LOCAL_ALIGNED_32(float, src,     [3 * WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(float, dst_ref, [3 * WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(float, dst_new, [3 * WIDTH_PADDED]);
+    float *const in[3]  = { src,     src     + WIDTH_PADDED, src     + 2 * WIDTH_PADDED };
+    float *const ref[3] = { dst_ref, dst_ref + WIDTH_PADDED, dst_ref + 2 * WIDTH_PADDED };
+    float *const new[3] = { dst_new, dst_new + WIDTH_PADDED, dst_new + 2 * WIDTH_PADDED };
+    static float lut[TONEMAP_LUT_SIZE + 1];
+    TonemapLUTParams p = {
+        .coeffs    = { 0.2627f, 0.6780f, 0.0593f },
+        .desat     = desat,
+        .lut_scale = TONEMAP_LUT_SIZE / PEAK,
+    };
+
+    declare_func(void, float *dst_r, float *dst_g, float *dst_b,
+                 const float *src_r, const float *src_g, const float *src_b,
+                 const float *lut, const TonemapLUTParams *p, int width);
+
+    /* reinhard curve */
+    for (int i = 0; i <= TONEMAP_LUT_SIZE; i++) {
+        float sig = i * PEAK / TONEMAP_LUT_SIZE;
+        lut[i] = sig / (sig + 1.0f) * (PEAK + 1.0f) / PEAK;
+    }
+
+    if (check_func(dsp->tonemap_lut, "tonemap_lut%s", desat > 0 ? "_desat" : "")) {
+        randomize_buffer(src, 3 * WIDTH_PADDED);
+        memset(dst_ref, 0, 3 * WIDTH_PADDED * sizeof(float));
+        memset(dst_new, 0, 3 * WIDTH_PADDED * sizeof(float));
+
+        call_ref(ref[0], ref[1], ref[2], in[0], in[1], in[2],
+                 lut, &p, WIDTH);
+        call_new(new[0], new[1], new[2], in[0], in[1], in[2],
+                 lut, &p, WIDTH);
+        for (int i = 0; i < 3; i++)
+            if (!float_near_abs_eps_array(ref[i], new[i], 1e-4f, WIDTH))
+                fail();
+
+        bench_new(new[0], new[1], new[2], in[0], in[1], in[2],
+                  lut, &p, WIDTH);
+    }
+}
+
+void checkasm_check_vf_tonemap(void)
+{
+    TonemapDSPContext dsp;
+
+    ff_tonemap_dsp_init(&dsp);
+
+    check_tonemap_lut(&dsp, 0.0f);
+    check_tonemap_lut(&dsp, 2.0f);
+    report("tonemap_lut");
+}
@@ -0,0 +1,791 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Throughput benchmark of the main pipeline components.
+ *
+ * Each scenario is run a number of times after some warmup runs, and the
+ * frame rate and time per pixel of the measured part are reported with
+ * their spread over the runs. Scenarios are given on the command line or
+ * read from a scenario file, one per line:
+ *
+ *   decode <input>                      decoding (including demuxing)
+ *   scale  <input> <WxH>[,<WxH>...] [<pix_fmt>]
+ *                                       scaling of the decoded frames to
+ *                                       each size of a ladder
+ *   filter <input> <filtergraph>        filtering of the decoded frames
+ *   remux  <input> <format>             demuxing and muxing to memory
+ *   bsf    <input> <bsfs>               bitstream filtering of the demuxed
+ *                                       packets
+ *   startup <input>                     opening the input and the decoder
+ *                                       and decoding the first frame; the
+ *                                       first run also pays the one-time
+ *                                       initialization of the static tables
+ *                                       of the codec, unless an earlier
+ *                                       scenario used it, so no warmup runs
+ *                                       are done
+ *
+ * See tools/bench_scenarios.txt for an example scenario file.
+ */
+
+#include "config.h"
+
+#if HAVE_SCHED_GETAFFINITY
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+#include <sched.h>
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#include "decode_simple.h"
+
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/qsort.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+#include "libavcodec/bsf.h"
+
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#include "libswscale/swscale.h"
+
+#define MAX_RUNS  100
+#define MAX_RUNGS 8
+#define MAX_ARGS  4
+
+typedef struct Scenario {
+    char *line;
+    char *buf;
+    char *path;
+    const char *type;
+    const char *input;
+    const char *args[MAX_ARGS];
+    int nb_args;
+} Scenario;
+
+typedef struct BenchContext {
+    const Scenario *sc;
+
+    /* measured time and amount of work of the current run */
+    int64_t  time;
+    uint64_t frames;
+    uint64_t pixels;
+
+    /* scale */
+    struct SwsContext *sws[MAX_RUNGS];
+    AVFrame *dst[MAX_RUNGS];
+    int nb_rungs;
+    enum AVPixelFormat dst_fmt;
+
+    /* filter */
+    AVFilterGraph   *graph;
+    AVFilterContext *src, *sink;
+    AVFrame         *filtered;
+    AVRational       time_base;
+} BenchContext;
+
+static int stream_idx;
+static int max_frames;
+
+static uint64_t frame_size(const AVFrame *frame)
+{
+    return frame->nb_samples ? frame->nb_samples : (uint64_t)frame->width * frame->height;
+}
+
+static int decode_frame(DecodeContext *dc, AVFrame *frame)
+{
+    BenchContext *bc = dc->opaque;
+
+    if (frame) {
+        bc->frames++;
+        bc->pixels += frame_size(frame);
+    }
+    return 0;
+}
+
+static int scale_frame(DecodeContext *dc, AVFrame *frame)
+{
+    BenchContext *bc = dc->opaque;
+    int64_t start;
+    int ret;
+
+    if (!frame)
+        return 0;
+
+    for (int i = 0; i < bc->nb_rungs; i++) {
+        if (!bc->sws[i]) {
+            bc->sws[i] = sws_getContext(frame->width, frame->height, frame->format,
+                                        bc->dst[i]->width, bc->dst[i]->height,
+                                        bc->dst[i]->format, SWS_BICUBIC,
+                                        NULL, NULL, NULL);
+            if (!bc->sws[i])
+                return AVERROR(EINVAL);
+        }
+    }
+
+    start = av_gettime_relative();
+    for (int i = 0; i < bc->nb_rungs; i++) {
+        ret = sws_scale(bc->sws[i], (const uint8_t * const *)frame->data,
+                        frame->linesize, 0, frame->height,
+                        bc->dst[i]->data, bc->dst[i]->linesize);
+        if (ret < 0)
+            return ret;
+        bc->frames++;
+        bc->pixels += frame_size(bc->dst[i]);
+    }
+    bc->time += av_gettime_relative() - start;
+
+    return 0;
+}
+
+static int init_graph(BenchContext *bc, const AVFrame *frame)
+{
+    const char *src_name = frame->nb_samples ? "abuffer"    : "buffer";
+    const char *dst_name = frame->nb_samples ? "abuffersink" : "buffersink";
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVBufferSrcParameters *par;
+    int ret;
+
+    bc->graph    = avfilter_graph_alloc();
+    bc->filtered = av_frame_alloc();
+    par          = av_buffersrc_parameters_alloc();
+    if (!bc->graph || !bc->filtered || !par) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    /* filters run on this thread only, like the other scenarios */
+    bc->graph->nb_threads = 1;
+
+    bc->src  = avfilter_graph_alloc_filter(bc->graph, avfilter_get_by_name(src_name), "in");
+    ret = avfilter_graph_create_filter(&bc->sink, avfilter_get_by_name(dst_name),
+                                       "out", NULL, NULL, bc->graph);
+    if (!bc->src || ret < 0) {
+        ret = ret < 0 ? ret : AVERROR(ENOMEM);
+        goto end;
+    }
+
+    par->format              = frame->format;
+    par->time_base           = bc->time_base;
+    par->width               = frame->width;
+    par->height              = frame->height;
+    par->sample_aspect_ratio = frame->sample_aspect_ratio;
+    par->sample_rate         = frame->sample_rate;
+    ret = av_channel_layout_copy(&par->ch_layout, &frame->ch_layout);
+    if (ret < 0)
+        goto end;
+    ret = av_buffersrc_parameters_set(bc->src, par);
+    if (ret >= 0)
+        ret = avfilter_init_dict(bc->src, NULL);
+    if (ret < 0)
+        goto end;
+
+    outputs = avfilter_inout_alloc();
+    inputs  = avfilter_inout_alloc();
+    if (!outputs || !inputs) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    outputs->name       = av_strdup("in");
+    outputs->filter_ctx = bc->src;
+    inputs->name        = av_strdup("out");
+    inputs->filter_ctx  = bc->sink;
+    if (!outputs->name || !inputs->name) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = avfilter_graph_parse_ptr(bc->graph, bc->sc->args[0], &inputs, &outputs, NULL);
+    if (ret >= 0)
+        ret = avfilter_graph_config(bc->graph, NULL);
+
+end:
+    if (par)
+        av_channel_layout_uninit(&par->ch_layout);
+    av_freep(&par);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    return ret;
+}
+
+static int filter_frame(DecodeContext *dc, AVFrame *frame)
+{
+    BenchContext *bc = dc->opaque;
+    int64_t start;
+    int ret;
+
+    if (!bc->graph) {
+        if (!frame)
+            return 0;
+        bc->time_base = dc->stream->time_base;
+        ret = init_graph(bc, frame);
+        if (ret < 0) {
+            fprintf(stderr, "Error configuring the filtergraph '%s': %s\n",
+                    bc->sc->args[0], av_err2str(ret));
+            return ret;
+        }
+    }
+
+    start = av_gettime_relative();
+    ret = av_buffersrc_add_frame_flags(bc->src, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
+    while (ret >= 0) {
+        ret = av_buffersink_get_frame(bc->sink, bc->filtered);
+        if (ret < 0)
+            break;
+        bc->frames++;
+        bc->pixels += frame_size(bc->filtered);
+        av_frame_unref(bc->filtered);
+    }
+    bc->time += av_gettime_relative() - start;
+
+    return (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) ? 0 : ret;
+}
+
+static int run_decode(BenchContext *bc)
+{
+    const Scenario *sc = bc->sc;
+    DecodeContext dc;
+    int64_t start = av_gettime_relative();
+    int ret;
+
+    ret = ds_open(&dc, sc->input, stream_idx);
+    if (ret < 0)
+        goto end;
+    ret = avcodec_parameters_to_context(dc.decoder, dc.stream->codecpar);
+    if (ret < 0)
+        goto end;
+    dc.decoder->pkt_timebase = dc.stream->time_base;
+    dc.opaque     = bc;
+    dc.max_frames = max_frames;
+    av_dict_set(&dc.decoder_opts, "threads", "1", 0);
+
+    if (!strcmp(sc->type, "scale")) {
+        dc.process_frame = scale_frame;
+    } else if (!strcmp(sc->type, "filter")) {
+        dc.process_frame = filter_frame;
+    } else if (!strcmp(sc->type, "startup")) {
+        dc.process_frame = decode_frame;
+        dc.max_frames    = 1;
+    } else {
+        dc.process_frame = decode_frame;
+    }
+
+    if (strcmp(sc->type, "startup"))
+        start = av_gettime_relative();
+    ret = ds_run(&dc);
+    if (dc.process_frame == decode_frame)
+        bc->time = av_gettime_relative() - start;
+
+end:
+    ds_free(&dc);
+    for (int i = 0; i < bc->nb_rungs; i++) {
+        sws_freeContext(bc->sws[i]);
+        bc->sws[i] = NULL;
+    }
+    avfilter_graph_free(&bc->graph);
+    av_frame_free(&bc->filtered);
+    return ret;
+}
+
+static int run_remux(BenchContext *bc)
+{
+    const Scenario *sc = bc->sc;
+    AVFormatContext *ic = NULL, *oc = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    uint8_t *buf = NULL;
+    int64_t start;
+    int ret;
+
+    if (!pkt)
+        return AVERROR(ENOMEM);
+
+    ret = avformat_open_input(&ic, sc->input, NULL, NULL);
+    if (ret < 0)
+        goto end;
+    ret = avformat_find_stream_info(ic, NULL);
+    if (ret < 0)
+        goto end;
+    ret = avformat_alloc_output_context2(&oc, NULL, sc->args[0], NULL);
+    if (ret < 0)
+        goto end;
+
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        AVStream *st = avformat_new_stream(oc, NULL);
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = avcodec_parameters_copy(st->codecpar, ic->streams[i]->codecpar);
+        if (ret < 0)
+            goto end;
+        st->codecpar->codec_tag = 0;
+        st->time_base = ic->streams[i]->time_base;
+    }
+
+    ret = avio_open_dyn_buf(&oc->pb);
+    if (ret < 0)
+        goto end;
+
+    start = av_gettime_relative();
+    ret = avformat_write_header(oc, NULL);
+    while (ret >= 0) {
+        const AVStream *ist;
+
+        ret = av_read_frame(ic, pkt);
+        if (ret < 0)
+            break;
+        ist = ic->streams[pkt->stream_index];
+        av_packet_rescale_ts(pkt, ist->time_base, oc->streams[pkt->stream_index]->time_base);
+        bc->frames++;
+        bc->pixels += pkt->size;
+        ret = av_interleaved_write_frame(oc, pkt);
+    }
+    if (ret == AVERROR_EOF)
+        ret = av_write_trailer(oc);
+    bc->time = av_gettime_relative() - start;
+
+end:
+    if (oc && oc->pb)
+        avio_close_dyn_buf(oc->pb, &buf);
+    av_free(buf);
+    avformat_free_context(oc);
+    avformat_close_input(&ic);
+    av_packet_free(&pkt);
+    return ret;
+}
+
+static int run_bsf(BenchContext *bc)
+{
+    const Scenario *sc = bc->sc;
+    AVFormatContext *ic = NULL;
+    AVBSFContext *bsf = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    const AVStream *st;
+    int ret;
+
+    if (!pkt)
+        return AVERROR(ENOMEM);
+
+    ret = avformat_open_input(&ic, sc->input, NULL, NULL);
+    if (ret < 0)
+        goto end;
+    ret = avformat_find_stream_info(ic, NULL);
+    if (ret < 0)
+        goto end;
+    if (stream_idx >= ic->nb_streams) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    st = ic->streams[stream_idx];
+
+    ret = av_bsf_list_parse_str(sc->args[0], &bsf);
+    if (ret < 0)
+        goto end;
+    ret = avcodec_parameters_copy(bsf->par_in, st->codecpar);
+    if (ret < 0)
+        goto end;
+    bsf->time_base_in = st->time_base;
+    ret = av_bsf_init(bsf);
+    if (ret < 0)
+        goto end;
+
+    /* only the filtering is timed, and the packets are passed on as the
+     * demuxer returns them, so that in-place filtering is measured too */
+    for (;;) {
+        int64_t start;
+        int eof;
+
+        ret = av_read_frame(ic, pkt);
+        eof = ret == AVERROR_EOF || (max_frames && bc->frames >= max_frames);
+        if (ret < 0 && !eof)
+            break;
+        if (!eof && pkt->stream_index != stream_idx) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        if (eof) {
+            av_packet_unref(pkt);
+        } else {
+            bc->frames++;
+            bc->pixels += pkt->size;
+        }
+
+        start = av_gettime_relative();
+        ret = av_bsf_send_packet(bsf, eof ? NULL : pkt);
+        while (ret >= 0) {
+            ret = av_bsf_receive_packet(bsf, pkt);
+            if (ret >= 0)
+                av_packet_unref(pkt);
+        }
+        bc->time += av_gettime_relative() - start;
+        if (ret != AVERROR(EAGAIN))
+            break;
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+end:
+    av_bsf_free(&bsf);
+    avformat_close_input(&ic);
+    av_packet_free(&pkt);
+    return ret;
+}
+
+static int parse_rungs(BenchContext *bc)
+{
+    const Scenario *sc = bc->sc;
+    const char *p = sc->args[0];
+
+    if (sc->nb_args < 1)
+        return AVERROR(EINVAL);
+
+    bc->dst_fmt = sc->nb_args > 1 ? av_get_pix_fmt(sc->args[1]) : AV_PIX_FMT_YUV420P;
+    if (bc->dst_fmt == AV_PIX_FMT_NONE)
+        return AVERROR(EINVAL);
+
+    while (*p && bc->nb_rungs < MAX_RUNGS) {
+        AVFrame *frame;
+        char *end;
+        int w, h, ret;
+
+        w = strtol(p, &end, 10);
+        if (*end != 'x')
+            return AVERROR(EINVAL);
+        h = strtol(end + 1, &end, 10);
+        if (w <= 0 || h <= 0 || (*end && *end != ','))
+            return AVERROR(EINVAL);
+        p = *end ? end + 1 : end;
+
+        frame = bc->dst[bc->nb_rungs++] = av_frame_alloc();
+        if (!frame)
+            return AVERROR(ENOMEM);
+        frame->width  = w;
+        frame->height = h;
+        frame->format = bc->dst_fmt;
+        ret = av_frame_get_buffer(frame, 0);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double *da = a, *db = b;
+    return (*da > *db) - (*da < *db);
+}
+
+static int run_scenario(const Scenario *sc, int warmup, int runs)
+{
+    BenchContext bc = { .sc = sc };
+    double fps[MAX_RUNS], nspp[MAX_RUNS], ms[MAX_RUNS];
+    double mean = 0, var = 0;
+    const char *unit;
+    uint64_t frames = 0;
+    int packets = 0, ret = 0;
+
+    if (!strcmp(sc->type, "scale")) {
+        ret = parse_rungs(&bc);
+        unit = "pixel";
+    } else if (!strcmp(sc->type, "filter")) {
+        if (sc->nb_args < 1)
+            ret = AVERROR(EINVAL);
+        unit = "pixel";
+    } else if (!strcmp(sc->type, "remux") || !strcmp(sc->type, "bsf")) {
+        if (sc->nb_args < 1)
+            ret = AVERROR(EINVAL);
+        packets = 1;
+        unit = "byte";
+    } else if (!strcmp(sc->type, "decode")) {
+        unit = "pixel";
+    } else if (!strcmp(sc->type, "startup")) {
+        warmup = 0;
+        unit = "pixel";
+    } else {
+        ret = AVERROR(EINVAL);
+    }
+    if (ret < 0) {
+        fprintf(stderr, "Invalid scenario: %s\n", sc->line);
+        goto end;
+    }
+
+    for (int i = -warmup; i < runs; i++) {
+        bc.time   = 0;
+        bc.frames = 0;
+        bc.pixels = 0;
+
+        if (!strcmp(sc->type, "remux"))
+            ret = run_remux(&bc);
+        else if (!strcmp(sc->type, "bsf"))
+            ret = run_bsf(&bc);
+        else
+            ret = run_decode(&bc);
+        if (ret < 0) {
+            fprintf(stderr, "Error running '%s': %s\n", sc->line, av_err2str(ret));
+            goto end;
+        }
+        if (i < 0)
+            continue;
+
+        bc.time   = FFMAX(bc.time, 1);
+        ms[i]     = bc.time / 1e3;
+        frames    = bc.frames;
+        fps[i]    = bc.frames * 1e6 / bc.time;
+        nspp[i]   = bc.pixels ? bc.time * 1e3 / bc.pixels : 0;
+        mean     += fps[i];
+    }
+
+    if (!strcmp(sc->type, "startup")) {
+        printf("%s\n", sc->line);
+        printf("  time to first frame: first run %.3f ms", ms[0]);
+        if (runs > 1) {
+            AV_QSORT(ms + 1, runs - 1, double, cmp_double);
+            printf(", later runs: min %.3f median %.3f ms", ms[1], ms[1 + (runs - 1) / 2]);
+        }
+        printf("\n");
+        goto end;
+    }
+
+    mean /= runs;
+    for (int i = 0; i < runs; i++)
+        var += (fps[i] - mean) * (fps[i] - mean);
+    AV_QSORT(fps,  runs, double, cmp_double);
+    AV_QSORT(nspp, runs, double, cmp_double);
+
+    printf("%s\n", sc->line);
+    printf("  %"PRIu64" %s/run, %s/s: min %.1f median %.1f max %.1f stddev %.1f, ns/%s: median %.3f\n",
+           frames, packets ? "packets" : "frames", packets ? "packets" : "frames",
+           fps[0], fps[runs / 2], fps[runs - 1], sqrt(var / runs),
+           unit, nspp[runs / 2]);
+
+end:
+    for (int i = 0; i < bc.nb_rungs; i++)
+        av_frame_free(&bc.dst[i]);
+    return ret;
+}
+
+static void free_scenario(Scenario *sc)
+{
+    av_freep(&sc->line);
+    av_freep(&sc->buf);
+    av_freep(&sc->path);
+}
+
+/**
+ * Split a scenario line into its fields. The arguments are separated by
+ * whitespace, except that the filtergraph of a filter scenario is the rest
+ * of the line, so that it may contain spaces.
+ *
+ * @return 0 on success or for an empty or comment line (sc->type is NULL),
+ *         a negative error code otherwise
+ */
+static int parse_scenario(Scenario *sc, const char *line, const char *dir)
+{
+    char *p;
+
+    memset(sc, 0, sizeof(*sc));
+    line += strspn(line, " \t");
+    if (!*line || *line == '#' || *line == '\n' || *line == '\r')
+        return 0;
+
+    sc->line = av_strndup(line, strcspn(line, "\r\n"));
+    sc->buf  = av_strdup(sc->line);
+    if (!sc->line || !sc->buf)
+        return AVERROR(ENOMEM);
+
+    p = sc->buf;
+    sc->type  = av_strtok(p, " \t", &p);
+    sc->input = av_strtok(NULL, " \t", &p);
+    if (!sc->input)
+        return AVERROR(EINVAL);
+
+    if (!strcmp(sc->type, "filter")) {
+        if (p && *(p += strspn(p, " \t")))
+            sc->args[sc->nb_args++] = p;
+    } else {
+        const char *arg;
+        while (sc->nb_args < MAX_ARGS && (arg = av_strtok(NULL, " \t", &p)))
+            sc->args[sc->nb_args++] = arg;
+    }
+
+    if (dir && sc->input[0] != '/' && !strchr(sc->input, ':')) {
+        sc->path = av_asprintf("%s/%s", dir, sc->input);
+        if (!sc->path)
+            return AVERROR(ENOMEM);
+        sc->input = sc->path;
+    }
+
+    return 0;
+}
+
+static int set_affinity(const char *cpus)
+{
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+    cpu_set_t set;
+    const char *p = cpus;
+
+    CPU_ZERO(&set);
+    while (*p) {
+        char *end;
+        long first, last;
+
+        first = last = strtol(p, &end, 10);
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        if (end == p || first < 0 || last < first || last >= CPU_SETSIZE ||
+            (*end && *end != ','))
+            return AVERROR(EINVAL);
+        for (long i = first; i <= last; i++)
+            CPU_SET(i, &set);
+        p = *end ? end + 1 : end;
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) < 0)
+        return AVERROR(errno);
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] <scenario> <input> [<args>...]\n"
+            "       %s [options] -f <scenario file>\n"
+            "Options:\n"
+            "  -r <runs>     number of measured runs (default 5)\n"
+            "  -w <runs>     number of warmup runs (default 1)\n"
+            "  -n <frames>   maximum number of frames to decode per run\n"
+            "  -s <index>    index of the stream to decode (default 0)\n"
+            "  -c <cpus>     pin the benchmark to a list of cpus, e.g. 0,2-3\n"
+            "  -d <dir>      directory of the relative input paths of a scenario file\n"
+            "Scenarios:\n"
+            "  decode <input>\n"
+            "  scale  <input> <WxH>[,<WxH>...] [<pix_fmt>]\n"
+            "  filter <input> <filtergraph>\n"
+            "  remux  <input> <format>\n"
+            "  bsf    <input> <bsfs>\n"
+            "  startup <input>\n",
+            name, name);
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = NULL, *dir = NULL;
+    int runs = 5, warmup = 1;
+    int i, ret, failed = 0;
+
+    for (i = 1; i < argc - 1 && argv[i][0] == '-'; i += 2) {
+        const char *opt = argv[i], *arg = argv[i + 1];
+
+        if (!strcmp(opt, "-r")) {
+            runs = av_clip(atoi(arg), 1, MAX_RUNS);
+        } else if (!strcmp(opt, "-w")) {
+            warmup = FFMAX(atoi(arg), 0);
+        } else if (!strcmp(opt, "-n")) {
+            max_frames = FFMAX(atoi(arg), 0);
+        } else if (!strcmp(opt, "-s")) {
+            stream_idx = FFMAX(atoi(arg), 0);
+        } else if (!strcmp(opt, "-d")) {
+            dir = arg;
+        } else if (!strcmp(opt, "-f")) {
+            file = arg;
+        } else if (!strcmp(opt, "-c")) {
+            ret = set_affinity(arg);
+            if (ret < 0) {
+                fprintf(stderr, "Cannot pin to cpus '%s': %s\n", arg, av_err2str(ret));
+                return 1;
+            }
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    if (file) {
+        char line[4096];
+        FILE *f = fopen(file, "r");
+
+        if (!f) {
+            fprintf(stderr, "Cannot open scenario file '%s'\n", file);
+            return 1;
+        }
+        while (fgets(line, sizeof(line), f)) {
+            Scenario sc;
+
+            ret = parse_scenario(&sc, line, dir);
+            if (ret < 0) {
+                fprintf(stderr, "Invalid scenario: %s", line);
+                failed = 1;
+            } else if (sc.type && run_scenario(&sc, warmup, runs) < 0) {
+                failed = 1;
+            }
+            free_scenario(&sc);
+        }
+        fclose(f);
+    } else if (argc - i >= 2) {
+        Scenario sc = { .type = argv[i], .input = argv[i + 1] };
+        AVBPrint bp;
+
+        for (int j = i + 2; j < argc && sc.nb_args < MAX_ARGS; j++)
+            sc.args[sc.nb_args++] = argv[j];
+
+        av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+        for (int j = i; j < argc; j++)
+            av_bprintf(&bp, "%s%s", j > i ? " " : "", argv[j]);
+        ret = av_bprint_finalize(&bp, &sc.line);
+        if (ret < 0 || run_scenario(&sc, warmup, runs) < 0)
+            failed = 1;
+        av_freep(&sc.line);
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    {
+        struct rusage rusage;
+        getrusage(RUSAGE_SELF, &rusage);
+        printf("peak RSS: %ld kB\n", rusage.ru_maxrss);
+    }
+#endif
+
+    return failed;
+}
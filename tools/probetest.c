@@ -23,6 +23,7 @@
 #include "libavformat/avformat.h"
 #include "libavcodec/put_bits.h"
 #include "libavutil/lfg.h"
+#include "libavutil/time.h"
 #include "libavutil/timer.h"
 
 #define MAX_FORMATS 1000 //this must be larger than the number of formats
@@ -80,6 +81,69 @@ static void print_times(void)
     }
 }
 
+/**
+ * Time av_probe_input_format3() on the head of a real file, growing the
+ * probe buffer the same way av_probe_input_buffer2() does, and list the
+ * demuxers whose read_probe dominates the cost.
+ */
+static int bench_file(const char *filename, int iterations)
+{
+    AVProbeData pd = { 0 };
+    FILE *f = fopen(filename, "rb");
+    int size, file_size;
+
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", filename);
+        return 1;
+    }
+    pd.buf = av_mallocz((1 << 20) + AVPROBE_PADDING_SIZE);
+    if (!pd.buf) {
+        fclose(f);
+        return 1;
+    }
+    file_size = fread(pd.buf, 1, 1 << 20, f);
+    fclose(f);
+    pd.filename = filename;
+
+    for (size = 2048; ; size *= 2) {
+        const AVInputFormat *fmt = NULL, *fmt1;
+        void *fmt_opaque = NULL;
+        int64_t start, sum = 0;
+        int score = 0, i, j = 0;
+
+        pd.buf_size = FFMIN(size, file_size);
+        memset(pd.buf + pd.buf_size, 0, AVPROBE_PADDING_SIZE);
+        memset(time_array, 0, sizeof(time_array));
+
+        start = av_gettime_relative();
+        for (i = 0; i < iterations; i++)
+            fmt = av_probe_input_format3(&pd, 1, &score);
+        printf("size=%7d %-12s score=%3d %8.2f us/probe\n", pd.buf_size,
+               fmt ? fmt->name : "(none)", score,
+               (av_gettime_relative() - start) / (double)iterations);
+
+        while ((fmt1 = av_demuxer_iterate(&fmt_opaque))) {
+            if (fmt1->read_probe && !(fmt1->flags & AVFMT_NOFILE)) {
+                start = av_gettime_relative();
+                for (i = 0; i < iterations; i++)
+                    fmt1->read_probe(&pd);
+                time_array[j] = av_gettime_relative() - start;
+                sum += time_array[j];
+                if (time_array[j] > iterations)
+                    printf("    %8.2f us  %s\n",
+                           time_array[j] / (double)iterations, fmt1->name);
+            }
+            j++;
+        }
+        printf("    %8.2f us  sum of read_probe\n", sum / (double)iterations);
+        if (score > AVPROBE_SCORE_RETRY || pd.buf_size >= file_size ||
+            size >= 1 << 20)
+            break;
+    }
+    av_free(pd.buf);
+    return 0;
+}
+
 static int read_int(char *arg) {
     int ret;
 
@@ -104,6 +168,10 @@ int main(int argc, char **argv)
     for (j = i = 1; i<argc; i++) {
         if (!strcmp(argv[i], "-f") && i+1<argc && !single_format) {
             single_format = argv[++i];
+        } else if (!strcmp(argv[i], "-b") && i+1<argc) {
+            const char *filename = argv[++i];
+            int iterations = i+1<argc ? read_int(argv[i+1]) : 1000;
+            return bench_file(filename, iterations > 0 ? iterations : 1000);
         } else if (read_int(argv[i])>0 && j == 1) {
             retry_count = read_int(argv[i]);
             j++;
@@ -111,7 +179,8 @@ int main(int argc, char **argv)
             max_size = read_int(argv[i]);
             j++;
         } else {
-            fprintf(stderr, "probetest [-f <input format>] [<retry_count> [<max_size>]]\n");
+            fprintf(stderr, "probetest [-f <input format>] [<retry_count> [<max_size>]]\n"
+                            "probetest -b <file> [<iterations>]\n");
             return 1;
         }
     }